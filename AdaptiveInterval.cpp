@@ -0,0 +1,267 @@
+/**
+ * AdaptiveInterval.cpp
+ * Activity-adaptive sampling interval implementation
+ */
+
+#include "AdaptiveInterval.h"
+#include "PhaseProfiler.h"
+#include "Utils.h"
+
+#ifdef HAS_INTERNAL_FS
+  #include <Adafruit_LittleFS.h>
+  #include <InternalFileSystem.h>
+  using AdaptFile = Adafruit_LittleFS_Namespace::File;
+#endif
+
+AdaptiveInterval adaptiveInterval;
+
+// Divisors of 60, so every step lands on a clock boundary
+static const uint8_t intervalLadder[] = { 1, 2, 5, 10, 15, 30, 60 };
+static const uint8_t LADDER_STEPS = sizeof(intervalLadder) / sizeof(intervalLadder[0]);
+
+AdaptiveInterval::AdaptiveInterval() {
+    memset(&config, 0, sizeof(config));
+    config.version = ADAPT_VERSION;
+    config.enabled = 0;
+    config.minInterval = ADAPT_DEFAULT_MIN_INTERVAL;
+    config.budgetMahPerDay = ADAPT_DEFAULT_BUDGET_MAH;
+    step = stepFor(DEFAULT_LOG_INTERVAL);
+    calmCount = 0;
+    lastActivity = ACTIVITY_NORMAL;
+    ledgerDay = 0;
+    wakesToday = 0;
+}
+
+void AdaptiveInterval::begin(uint8_t baseInterval) {
+    load();
+    step = stepFor(baseInterval);
+
+    Serial.print(F("Adaptive interval: "));
+    if (config.enabled) {
+        Serial.print(F("ON, min "));
+        Serial.print(config.minInterval);
+        Serial.print(F(" min, budget "));
+        Serial.print(config.budgetMahPerDay);
+        Serial.println(F(" mAh/day"));
+    } else {
+        Serial.println(F("OFF"));
+    }
+}
+
+uint8_t AdaptiveInterval::stepFor(uint8_t minutes) {
+    for (uint8_t i = 0; i < LADDER_STEPS; i++) {
+        if (intervalLadder[i] >= minutes) return i;
+    }
+    return LADDER_STEPS - 1;
+}
+
+// =============================================================================
+// CLASSIFICATION
+// =============================================================================
+
+ActivityLevel AdaptiveInterval::classify(const SensorData& data, const AudioAnalysisResult* audio) const {
+    uint8_t alerts = data.alertFlags & ADAPT_ALERT_MASK;
+    bool haveAudio = audio && audio->analysisValid;
+    uint8_t risk = haveAudio ? audio->abscondingRisk : 0;
+    float activity = haveAudio ? audio->activityIncrease : 1.0f;
+
+    if ((alerts & (ALERT_SWARM_RISK | ALERT_QUEEN_ISSUE)) ||
+        data.beeState == BEE_PRE_SWARM ||
+        risk >= ADAPT_RISK_HIGH || activity >= ADAPT_ACTIVITY_HIGH) {
+        return ACTIVITY_HIGH;
+    }
+
+    if (alerts ||
+        data.beeState == BEE_DEFENSIVE || data.beeState == BEE_STRESSED ||
+        data.beeState == BEE_QUEEN_MISSING ||
+        risk >= ADAPT_RISK_ELEVATED || activity >= ADAPT_ACTIVITY_ELEVATED) {
+        return ACTIVITY_ELEVATED;
+    }
+
+    if (risk < ADAPT_RISK_CALM && activity < ADAPT_ACTIVITY_CALM) {
+        return ACTIVITY_CALM;
+    }
+    return ACTIVITY_NORMAL;
+}
+
+// =============================================================================
+// ENERGY BUDGET
+// =============================================================================
+
+float AdaptiveInterval::estimateMahPerDay(uint8_t intervalMin) const {
+    if (intervalMin == 0) intervalMin = 1;
+    float wakeMah = phaseProfiler.getWakeMah();
+    if (wakeMah <= 0.0f) wakeMah = ADAPT_DEFAULT_WAKE_MAH;
+    return (1440.0f / intervalMin) * wakeMah + phaseProfiler.getPhaseCurrent(PHASE_SLEEP) * 24.0f;
+}
+
+uint8_t AdaptiveInterval::budgetFloorStep(uint32_t rtcTime, uint8_t baseInterval) const {
+    if (config.budgetMahPerDay == 0) return 0;
+
+    float wakeMah = phaseProfiler.getWakeMah();
+    if (wakeMah <= 0.0f) wakeMah = ADAPT_DEFAULT_WAKE_MAH;
+    float sleepMa = phaseProfiler.getPhaseCurrent(PHASE_SLEEP);
+
+    // Without the RTC there is no day to split; plan a whole one
+    uint16_t minuteOfDay = rtcTime ? (rtcTime % 86400UL) / 60 : 0;
+    uint16_t remaining = 1440 - minuteOfDay;
+    uint16_t burst = min(remaining, (uint16_t)ADAPT_BURST_MINUTES);
+    float spent = wakesToday * wakeMah + sleepMa * minuteOfDay / 60.0f;
+    float rest = (float)(remaining - burst) / max(baseInterval, (uint8_t)1) * wakeMah +
+                 sleepMa * remaining / 60.0f;
+
+    for (uint8_t i = 0; i < LADDER_STEPS; i++) {
+        float projected = spent + (float)burst / intervalLadder[i] * wakeMah + rest;
+        if (projected <= config.budgetMahPerDay) return i;
+    }
+    return LADDER_STEPS - 1;
+}
+
+// =============================================================================
+// INTERVAL SELECTION
+// =============================================================================
+
+uint8_t AdaptiveInterval::update(const SensorData& data, const AudioAnalysisResult* audio,
+                                 int batteryPercent, uint32_t rtcTime, uint8_t baseInterval) {
+    if (rtcTime) {
+        uint32_t day = rtcTime / 86400UL;
+        if (day != ledgerDay) {
+            ledgerDay = day;
+            wakesToday = 0;
+        }
+    }
+    if (wakesToday < 0xFFFF) wakesToday++;
+
+    lastActivity = classify(data, audio);
+    if (!config.enabled) return baseInterval;
+
+    uint8_t fastest = max(stepFor(config.minInterval), budgetFloorStep(rtcTime, baseInterval));
+    uint8_t slowest = batteryPercent < ADAPT_LOW_BATTERY_PCT ? LADDER_STEPS - 1 : stepFor(baseInterval);
+    if (slowest < fastest) slowest = fastest;
+
+    uint8_t previous = step;
+    switch (lastActivity) {
+        case ACTIVITY_HIGH:
+            step = fastest;
+            calmCount = 0;
+            break;
+        case ACTIVITY_ELEVATED:
+            step = min(step, stepFor(ADAPT_ELEVATED_MAX_MIN));
+            calmCount = 0;
+            break;
+        case ACTIVITY_NORMAL:
+            calmCount = 0;
+            break;
+        case ACTIVITY_CALM:
+            if (++calmCount >= ADAPT_CALM_READINGS) {
+                step++;
+                calmCount = 0;
+            }
+            break;
+    }
+    step = constrain(step, fastest, slowest);
+
+    if (step != previous) {
+        Serial.print(F("Adaptive interval: "));
+        Serial.print(intervalLadder[previous]);
+        Serial.print(F(" -> "));
+        Serial.print(intervalLadder[step]);
+        Serial.print(F(" min ("));
+        Serial.print(getActivityString(lastActivity));
+        Serial.println(F(")"));
+    }
+    return intervalLadder[step];
+}
+
+uint8_t AdaptiveInterval::getInterval(uint8_t baseInterval) const {
+    return config.enabled ? intervalLadder[step] : baseInterval;
+}
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+
+void AdaptiveInterval::configure(bool enabled, uint16_t budgetMahPerDay, uint8_t minInterval) {
+    config.enabled = enabled ? 1 : 0;
+    config.budgetMahPerDay = budgetMahPerDay;
+    if (minInterval) config.minInterval = intervalLadder[stepFor(minInterval)];
+    calmCount = 0;
+    save();
+
+    Serial.print(F("Adaptive interval "));
+    Serial.print(enabled ? F("ON") : F("OFF"));
+    Serial.print(F(", budget "));
+    Serial.print(config.budgetMahPerDay);
+    Serial.println(F(" mAh/day"));
+}
+
+uint32_t AdaptiveInterval::configCheck(const AdaptiveConfig& c) {
+    return crc32Update(0, (const uint8_t*)&c, offsetof(AdaptiveConfig, check));
+}
+
+bool AdaptiveInterval::load() {
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+    AdaptFile file(InternalFS);
+    if (!file.open(ADAPT_FILE, Adafruit_LittleFS_Namespace::FILE_O_READ)) return false;
+
+    AdaptiveConfig stored;
+    bool ok = file.read((uint8_t*)&stored, sizeof(stored)) == sizeof(stored);
+    file.close();
+    if (!ok || stored.version != ADAPT_VERSION || stored.check != configCheck(stored)) return false;
+
+    config = stored;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AdaptiveInterval::save() {
+    config.version = ADAPT_VERSION;
+    config.check = configCheck(config);
+
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+    InternalFS.remove(ADAPT_FILE);
+    AdaptFile file(InternalFS);
+    if (!file.open(ADAPT_FILE, Adafruit_LittleFS_Namespace::FILE_O_WRITE)) {
+        Serial.println(F("Adaptive interval: cannot save"));
+        return;
+    }
+    file.write((const uint8_t*)&config, sizeof(config));
+    file.close();
+#endif
+}
+
+// =============================================================================
+// DIAGNOSTICS
+// =============================================================================
+
+const char* AdaptiveInterval::getActivityString(ActivityLevel level) {
+    switch (level) {
+        case ACTIVITY_CALM: return "calm";
+        case ACTIVITY_NORMAL: return "normal";
+        case ACTIVITY_ELEVATED: return "elevated";
+        case ACTIVITY_HIGH: return "high";
+        default: return "?";
+    }
+}
+
+void AdaptiveInterval::printStatus(uint8_t baseInterval) const {
+    uint8_t interval = getInterval(baseInterval);
+    Serial.print(F("Interval: "));
+    Serial.print(interval);
+    Serial.print(F(" min (base "));
+    Serial.print(baseInterval);
+    Serial.print(config.enabled ? F(", adaptive, ") : F(", fixed, "));
+    Serial.print(getActivityString(lastActivity));
+    Serial.print(F("), ~"));
+    Serial.print(estimateMahPerDay(interval), 1);
+    Serial.print(F(" mAh/day"));
+    if (config.enabled && config.budgetMahPerDay) {
+        Serial.print(F(" of "));
+        Serial.print(config.budgetMahPerDay);
+    }
+    Serial.println();
+}
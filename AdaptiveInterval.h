@@ -0,0 +1,121 @@
+/**
+ * AdaptiveInterval.h
+ * Activity-adaptive field mode sampling interval
+ *
+ * settings.logInterval stays the user's base interval. In field mode
+ * every scheduled reading is classified (alerts, absconding risk,
+ * activity versus baseline, bee state) and the next interval is picked
+ * from a ladder of divisors of 60, so wakes stay on clock boundaries:
+ *
+ *   high activity       -> fastest allowed step at once (1 min default)
+ *   elevated activity   -> no slower than 5 min
+ *   normal              -> hold the current step
+ *   calm                -> one step slower after ADAPT_CALM_READINGS calm
+ *                          readings in a row, up to the base interval,
+ *                          or up to 60 min while the battery is low
+ *
+ * Speeding up is immediate and slowing down is gradual, which keeps a
+ * borderline hive from flapping between steps.
+ *
+ * A daily energy budget caps the fastest step: what was spent today,
+ * plus ADAPT_BURST_MINUTES at a candidate interval, plus the rest of the
+ * day at the base interval must fit in it, using the measured charge per
+ * wake from PhaseProfiler. The check is repeated every reading, so a
+ * burst is allowed on a quiet day and throttled after a busy one.
+ *
+ * Configuration is kept in internal flash.
+ */
+
+#ifndef ADAPTIVE_INTERVAL_H
+#define ADAPTIVE_INTERVAL_H
+
+#include "Config.h"
+#include "DataStructures.h"
+#include "Audio.h"
+
+#define ADAPT_FILE "/adaptive.dat"
+#define ADAPT_VERSION 1
+
+#define ADAPT_RISK_HIGH 60               // abscondingRisk % for the fastest step
+#define ADAPT_RISK_ELEVATED 30
+#define ADAPT_RISK_CALM 15
+#define ADAPT_ACTIVITY_HIGH 2.0f         // activityIncrease vs baseline
+#define ADAPT_ACTIVITY_ELEVATED 1.5f
+#define ADAPT_ACTIVITY_CALM 1.2f
+#define ADAPT_CALM_READINGS 3            // Calm readings per step back up
+#define ADAPT_ELEVATED_MAX_MIN 5         // Slowest step while activity is elevated
+#define ADAPT_LOW_BATTERY_PCT 30         // Below this, calm hives may go to 60 min
+#define ADAPT_BURST_MINUTES 60           // Look-ahead for the budget check
+
+#define ADAPT_DEFAULT_MIN_INTERVAL 1
+#define ADAPT_DEFAULT_BUDGET_MAH 15      // Per day; 1200 mAh lasts ~80 days
+#define ADAPT_DEFAULT_WAKE_MAH 0.05f     // Until PhaseProfiler has measured a wake
+
+// Alerts that describe the colony (battery and SD alerts do not count)
+#define ADAPT_ALERT_MASK (ALERT_TEMP_HIGH | ALERT_TEMP_LOW | ALERT_HUMIDITY_HIGH | \
+                          ALERT_HUMIDITY_LOW | ALERT_QUEEN_ISSUE | ALERT_SWARM_RISK)
+
+enum ActivityLevel {
+    ACTIVITY_CALM = 0,
+    ACTIVITY_NORMAL = 1,
+    ACTIVITY_ELEVATED = 2,
+    ACTIVITY_HIGH = 3
+};
+
+struct AdaptiveConfig {
+    uint8_t version;
+    uint8_t enabled;
+    uint8_t minInterval;         // Fastest step allowed, minutes
+    uint8_t reserved;
+    uint16_t budgetMahPerDay;    // 0 = no budget
+    uint16_t reserved2;
+    uint32_t check;
+};
+
+class AdaptiveInterval {
+private:
+    AdaptiveConfig config;
+
+    uint8_t step;                // Index into the interval ladder
+    uint8_t calmCount;
+    ActivityLevel lastActivity;
+
+    // Today's spending, for the budget
+    uint32_t ledgerDay;          // RTC day number
+    uint16_t wakesToday;
+
+    static uint8_t stepFor(uint8_t minutes);
+    uint8_t budgetFloorStep(uint32_t rtcTime, uint8_t baseInterval) const;
+    void save();
+    bool load();
+    static uint32_t configCheck(const AdaptiveConfig& c);
+
+public:
+    AdaptiveInterval();
+
+    void begin(uint8_t baseInterval);
+
+    ActivityLevel classify(const SensorData& data, const AudioAnalysisResult* audio) const;
+
+    // Called once per scheduled reading; returns the interval until the next
+    uint8_t update(const SensorData& data, const AudioAnalysisResult* audio,
+                   int batteryPercent, uint32_t rtcTime, uint8_t baseInterval);
+
+    // Minutes until the next reading; the base interval while disabled
+    uint8_t getInterval(uint8_t baseInterval) const;
+
+    void configure(bool enabled, uint16_t budgetMahPerDay, uint8_t minInterval);
+    bool isEnabled() const { return config.enabled; }
+    uint16_t getBudget() const { return config.budgetMahPerDay; }
+    ActivityLevel getLastActivity() const { return lastActivity; }
+
+    // Projected use for a whole day at the given interval
+    float estimateMahPerDay(uint8_t intervalMin) const;
+
+    static const char* getActivityString(ActivityLevel level);
+    void printStatus(uint8_t baseInterval) const;
+};
+
+extern AdaptiveInterval adaptiveInterval;
+
+#endif // ADAPTIVE_INTERVAL_H
@@ -0,0 +1,240 @@
+/**
+ * AlertHistory.cpp
+ * Persistent alert transition ring implementation
+ */
+
+#include "AlertHistory.h"
+#include "Utils.h"
+#include "Alerts.h"
+
+#ifdef HAS_INTERNAL_FS
+  #include <Adafruit_LittleFS.h>
+  #include <InternalFileSystem.h>
+  using AlertFile = Adafruit_LittleFS_Namespace::File;
+#endif
+
+AlertHistory alertHistory;
+
+AlertHistory::AlertHistory() {
+    loaded = false;
+    nextSeq = 1;
+    activeFlags = ALERT_NONE;
+    memset(raiseCounts, 0, sizeof(raiseCounts));
+}
+
+// =============================================================================
+// RING STORAGE
+// =============================================================================
+
+uint32_t AlertHistory::eventCheck(const AlertEvent& event) {
+    return crc32Update(0, (const uint8_t*)&event, offsetof(AlertEvent, check));
+}
+
+#ifdef HAS_INTERNAL_FS
+static bool readSlotFrom(AlertFile& file, uint16_t slot, AlertEvent& event) {
+    if (!file.seek((uint32_t)slot * sizeof(AlertEvent))) return false;
+    return file.read((uint8_t*)&event, sizeof(AlertEvent)) == sizeof(AlertEvent);
+}
+#endif
+
+bool AlertHistory::writeEvent(AlertEvent& event) {
+    event.check = eventCheck(event);
+
+#ifdef HAS_INTERNAL_FS
+    AlertFile file(InternalFS);
+    if (!file.open(ALERT_HISTORY_FILE, Adafruit_LittleFS_Namespace::FILE_O_WRITE)) {
+        Serial.println(F("Alert history: cannot open ring"));
+        return false;
+    }
+    bool ok = file.seek((uint32_t)(event.seq % ALERT_HISTORY_CAPACITY) * sizeof(AlertEvent)) &&
+              file.write((const uint8_t*)&event, sizeof(AlertEvent)) == sizeof(AlertEvent);
+    file.close();
+    return ok;
+#else
+    return true;
+#endif
+}
+
+void AlertHistory::load() {
+    if (loaded) return;
+    loaded = true;
+
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+
+    if (!InternalFS.exists(ALERT_HISTORY_FILE)) {
+        // Pre-size the ring so every later write is an in-place update
+        AlertFile file(InternalFS);
+        if (file.open(ALERT_HISTORY_FILE, Adafruit_LittleFS_Namespace::FILE_O_WRITE)) {
+            AlertEvent empty;
+            memset(&empty, 0, sizeof(empty));
+            for (uint16_t i = 0; i < ALERT_HISTORY_CAPACITY; i++) {
+                file.write((const uint8_t*)&empty, sizeof(empty));
+            }
+            file.close();
+        }
+        Serial.println(F("Alert history: new ring created"));
+        return;
+    }
+
+    AlertFile file(InternalFS);
+    if (!file.open(ALERT_HISTORY_FILE, Adafruit_LittleFS_Namespace::FILE_O_READ)) return;
+
+    uint32_t newestSeq = 0;
+    uint16_t stored = 0;
+    AlertEvent event;
+    for (uint16_t slot = 0; slot < ALERT_HISTORY_CAPACITY; slot++) {
+        if (!readSlotFrom(file, slot, event)) break;
+        if (event.seq == 0 || event.check != eventCheck(event)) continue;
+
+        stored++;
+        if (event.raised) {
+            for (uint8_t bit = 0; bit < ALERT_FLAG_COUNT; bit++) {
+                if (event.alertFlag & (1 << bit)) raiseCounts[bit]++;
+            }
+        }
+        if (event.seq > newestSeq) {
+            newestSeq = event.seq;
+            activeFlags = event.activeFlags;
+        }
+    }
+    file.close();
+
+    nextSeq = newestSeq + 1;
+
+    Serial.print(F("Alert history: "));
+    Serial.print(stored);
+    Serial.print(F(" events, active 0x"));
+    Serial.println(activeFlags, HEX);
+#endif
+}
+
+void AlertHistory::clear() {
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+    InternalFS.remove(ALERT_HISTORY_FILE);
+#endif
+    loaded = false;
+    nextSeq = 1;
+    activeFlags = ALERT_NONE;
+    memset(raiseCounts, 0, sizeof(raiseCounts));
+    load();
+}
+
+// =============================================================================
+// TRANSITION DETECTION
+// =============================================================================
+
+static float alertValueFor(uint8_t flag, const SensorData& data) {
+    switch (flag) {
+        case ALERT_TEMP_HIGH:
+        case ALERT_TEMP_LOW:
+            return data.temperature;
+        case ALERT_HUMIDITY_HIGH:
+        case ALERT_HUMIDITY_LOW:
+            return data.humidity;
+        case ALERT_QUEEN_ISSUE:
+        case ALERT_SWARM_RISK:
+            return data.dominantFreq;
+        case ALERT_LOW_BATTERY:
+            return data.batteryVoltage;
+        default:
+            return 0;
+    }
+}
+
+uint8_t AlertHistory::update(uint8_t flags, const SensorData& data, uint32_t timestamp) {
+    load();
+
+    uint8_t changed = flags ^ activeFlags;
+    if (changed == 0) return 0;
+
+    uint8_t written = 0;
+    for (uint8_t bit = 0; bit < ALERT_FLAG_COUNT; bit++) {
+        uint8_t flag = 1 << bit;
+        if (!(changed & flag)) continue;
+
+        // Each transition is applied on its own so every event records
+        // the flag set exactly as it stood after that change
+        activeFlags ^= flag;
+
+        AlertEvent event;
+        memset(&event, 0, sizeof(event));
+        event.seq = nextSeq++;
+        event.timestamp = timestamp;
+        event.alertFlag = flag;
+        event.raised = (flags & flag) ? 1 : 0;
+        event.activeFlags = activeFlags;
+        event.value = alertValueFor(flag, data);
+        event.temperature = data.temperature;
+        event.humidity = data.humidity;
+        event.batteryVoltage = data.batteryVoltage;
+        event.dominantFreq = data.dominantFreq;
+        event.soundLevel = data.soundLevel;
+        event.beeState = data.beeState;
+
+        if (event.raised) raiseCounts[bit]++;
+        if (writeEvent(event)) written++;
+
+        Serial.print(F("Alert "));
+        Serial.print(event.raised ? F("raised: ") : F("cleared: "));
+        Serial.println(getAlertDescription(flag));
+    }
+    return written;
+}
+
+// =============================================================================
+// QUERIES
+// =============================================================================
+
+uint8_t AlertHistory::query(const AlertQuery& query, AlertEvent* events, bool& more) {
+    load();
+    more = false;
+
+    uint8_t maxEvents = min(query.maxEvents ? query.maxEvents : (uint8_t)ALERT_HISTORY_MAX_PAGE,
+                            (uint8_t)ALERT_HISTORY_MAX_PAGE);
+    uint32_t newest = nextSeq - 1;
+    if (query.beforeSeq != 0 && query.beforeSeq <= nextSeq) {
+        newest = query.beforeSeq - 1;
+    }
+    uint32_t oldest = (nextSeq > ALERT_HISTORY_CAPACITY) ? nextSeq - ALERT_HISTORY_CAPACITY : 1;
+
+    uint8_t count = 0;
+#ifdef HAS_INTERNAL_FS
+    AlertFile file(InternalFS);
+    if (!file.open(ALERT_HISTORY_FILE, Adafruit_LittleFS_Namespace::FILE_O_READ)) return 0;
+
+    AlertEvent event;
+    for (uint32_t seq = newest; seq >= oldest && seq > 0; seq--) {
+        if (!readSlotFrom(file, seq % ALERT_HISTORY_CAPACITY, event)) break;
+        if (event.seq != seq || event.check != eventCheck(event)) continue;
+
+        if (query.fromTime && event.timestamp < query.fromTime) continue;
+        if (query.toTime && event.timestamp > query.toTime) continue;
+        if (query.typeMask && !(event.alertFlag & query.typeMask)) continue;
+
+        if (count == maxEvents) {
+            more = true;
+            break;
+        }
+        events[count++] = event;
+    }
+    file.close();
+#endif
+    return count;
+}
+
+uint8_t AlertHistory::getActiveFlags() {
+    load();
+    return activeFlags;
+}
+
+uint16_t AlertHistory::getRaiseCount(uint8_t bit) {
+    load();
+    return bit < ALERT_FLAG_COUNT ? raiseCounts[bit] : 0;
+}
+
+uint32_t AlertHistory::getStoredEvents() {
+    load();
+    return min(nextSeq - 1, (uint32_t)ALERT_HISTORY_CAPACITY);
+}
@@ -0,0 +1,80 @@
+/**
+ * AlertHistory.h
+ * Persistent ring of alert flag transitions
+ *
+ * Each time an alert flag is raised or cleared an event is written to a
+ * fixed-size ring file in internal flash, together with a snapshot of
+ * the reading that caused it. Slot = seq % capacity, so writing an event
+ * touches exactly one slot and the newest events survive wraparound.
+ * The ring is rescanned at boot to recover the sequence counter and the
+ * set of currently active flags, so a condition that persists across a
+ * reset is not logged again.
+ */
+
+#ifndef ALERT_HISTORY_H
+#define ALERT_HISTORY_H
+
+#include "Config.h"
+#include "DataStructures.h"
+
+#define ALERT_HISTORY_FILE "/alerts.dat"
+#define ALERT_HISTORY_CAPACITY 128
+#define ALERT_HISTORY_MAX_PAGE 16
+#define ALERT_FLAG_COUNT 8
+
+struct AlertEvent {
+    uint32_t seq;                 // 0 marks an empty slot
+    uint32_t timestamp;           // RTC unix time, 0 if the RTC was down
+    float value;                  // Measurement behind this alert
+    float temperature;
+    float humidity;
+    float batteryVoltage;
+    uint16_t dominantFreq;
+    uint8_t alertFlag;            // Single ALERT_* bit
+    uint8_t raised;               // 1 = raised, 0 = cleared
+    uint8_t activeFlags;          // All flags active after this transition
+    uint8_t soundLevel;
+    uint8_t beeState;
+    uint8_t reserved;
+    uint32_t check;
+};
+
+struct AlertQuery {
+    uint32_t fromTime;            // Inclusive, 0 = no lower bound
+    uint32_t toTime;              // Inclusive, 0 = no upper bound
+    uint8_t typeMask;             // ALERT_* bits to include, 0 = all
+    uint8_t maxEvents;
+    uint32_t beforeSeq;           // Continuation: only events older than this, 0 = newest
+};
+
+class AlertHistory {
+private:
+    bool loaded;
+    uint32_t nextSeq;
+    uint8_t activeFlags;
+    uint16_t raiseCounts[ALERT_FLAG_COUNT];
+
+    void load();
+    bool writeEvent(AlertEvent& event);
+    static uint32_t eventCheck(const AlertEvent& event);
+
+public:
+    AlertHistory();
+
+    // Logs a raise/clear event for every flag that differs from the last
+    // known state. Returns the number of events written.
+    uint8_t update(uint8_t flags, const SensorData& data, uint32_t timestamp);
+
+    // Newest first. more is set when older matching events remain; pass
+    // the seq of the last returned event as beforeSeq to continue.
+    uint8_t query(const AlertQuery& query, AlertEvent* events, bool& more);
+
+    uint8_t getActiveFlags();
+    uint16_t getRaiseCount(uint8_t bit);
+    uint32_t getStoredEvents();
+    void clear();
+};
+
+extern AlertHistory alertHistory;
+
+#endif // ALERT_HISTORY_H
@@ -5,6 +5,9 @@
 
 #include "Alerts.h"
 #include "Utils.h"
+#include "AlertHistory.h"
+
+extern RTC_PCF8523 rtc;
 
 // Alert history for preventing spam
 static unsigned long lastAlertTime[8] = {0, 0, 0, 0, 0, 0, 0, 0};
@@ -53,6 +56,11 @@ void checkAlerts(SensorData& data, SystemSettings& settings, SystemStatus& statu
     if (!status.sdWorking) {
         data.alertFlags |= ALERT_SD_ERROR;
     }
+    
+    // Persist raise/clear transitions (RTC is only read when something changed)
+    if (data.alertFlags != alertHistory.getActiveFlags()) {
+        alertHistory.update(data.alertFlags, data, status.rtcWorking ? rtc.now().unixtime() : 0);
+    }
 }
 
 // =============================================================================
@@ -279,16 +287,12 @@ void handleSDErrorAlert() {
 // =============================================================================
 
 void getAlertStatistics(uint32_t& totalAlerts, uint32_t alertCounts[8]) {
-    // This would typically read from stored data
-    // For now, return example data
+    // Raise counts from the persistent alert history
     totalAlerts = 0;
     
     for (int i = 0; i < 8; i++) {
-        alertCounts[i] = 0;
-        if (lastAlertTime[i] > 0) {
-            alertCounts[i] = 1; // Simple count
-            totalAlerts++;
-        }
+        alertCounts[i] = alertHistory.getRaiseCount(i);
+        totalAlerts += alertCounts[i];
     }
 }
 
@@ -0,0 +1,357 @@
+/**
+ * AppTasks.cpp
+ * FreeRTOS task layout implementation
+ */
+
+#include "AppTasks.h"
+#include "Sensors.h"
+#include "Alerts.h"
+#include "DataLogger.h"
+#include "FieldModeBuffer.h"
+#include "Bluetooth.h"
+#include "EventScheduler.h"
+#include "PowerDomains.h"
+
+extern Adafruit_BME280 bme;
+extern RTC_PCF8523 rtc;
+extern SensorData currentData;
+extern SystemSettings settings;
+extern SystemStatus systemStatus;
+extern BluetoothManager bluetoothManager;
+
+AppTasks appTasks;
+
+AppTasks::AppTasks() {
+    running = false;
+    active = false;
+    lastLog = 0;
+    memset(&audioLive, 0, sizeof(audioLive));
+#ifdef HAS_FREERTOS
+    memset(handles, 0, sizeof(handles));
+    systemLock = nullptr;
+    audioLock = nullptr;
+    storageQueue = nullptr;
+    analysisRequests = nullptr;
+    analysisResults = nullptr;
+#endif
+}
+
+bool AppTasks::begin() {
+#ifdef HAS_FREERTOS
+    if (running) return true;
+
+    systemLock = xSemaphoreCreateMutex();
+    audioLock = xSemaphoreCreateMutex();
+    storageQueue = xQueueCreate(TASK_STORAGE_QUEUE, sizeof(StorageRequest));
+    analysisRequests = xQueueCreate(1, sizeof(uint8_t));
+    analysisResults = xQueueCreate(1, sizeof(AudioAnalysisResult));
+    if (!systemLock || !audioLock || !storageQueue || !analysisRequests || !analysisResults) {
+        Serial.println(F("Tasks: FAILED (out of memory)"));
+        return false;
+    }
+
+    // The loop task takes the lock for each pass from now on, so running
+    // is only set once everything exists
+    bool ok = true;
+    ok &= xTaskCreate(audioTask, "audio", TASK_STACK_AUDIO, this, TASK_PRIO_HIGH, &handles[APP_TASK_AUDIO]) == pdPASS;
+    ok &= xTaskCreate(sensorTask, "sensor", TASK_STACK_SENSOR, this, TASK_PRIO_NORMAL, &handles[APP_TASK_SENSOR]) == pdPASS;
+    ok &= xTaskCreate(storageTask, "storage", TASK_STACK_STORAGE, this, TASK_PRIO_LOW, &handles[APP_TASK_STORAGE]) == pdPASS;
+    ok &= xTaskCreate(bleTask, "ble", TASK_STACK_BLE, this, TASK_PRIO_NORMAL, &handles[APP_TASK_BLE]) == pdPASS;
+    if (!ok) {
+        Serial.println(F("Tasks: FAILED (could not create all tasks)"));
+        return false;
+    }
+
+    // BLE callbacks wake the BLE task instead of the loop
+    eventScheduler.routeToTask(EVT_BLE, handles[APP_TASK_BLE]);
+
+    running = true;
+    Serial.println(F("Tasks: audio, sensor, storage, ble started"));
+    return true;
+#else
+    return false;
+#endif
+}
+
+void AppTasks::setActive(bool on) {
+    if (on == active) return;
+    active = on;
+
+#ifdef HAS_FREERTOS
+    // Sleeping tasks wait for a notification rather than polling the flag
+    if (on && running) {
+        xTaskNotifyGive(handles[APP_TASK_AUDIO]);
+        xTaskNotifyGive(handles[APP_TASK_SENSOR]);
+    }
+#endif
+}
+
+// =============================================================================
+// LOCKS
+// =============================================================================
+
+void AppTasks::lock() {
+#ifdef HAS_FREERTOS
+    if (running) xSemaphoreTake(systemLock, portMAX_DELAY);
+#endif
+}
+
+void AppTasks::unlock() {
+#ifdef HAS_FREERTOS
+    if (running) xSemaphoreGive(systemLock);
+#endif
+}
+
+void AppTasks::lockAudio() {
+#ifdef HAS_FREERTOS
+    if (running) xSemaphoreTake(audioLock, portMAX_DELAY);
+#endif
+}
+
+void AppTasks::unlockAudio() {
+#ifdef HAS_FREERTOS
+    if (running) xSemaphoreGive(audioLock);
+#endif
+}
+
+bool AppTasks::unlockedWait(unsigned long ms) {
+#ifdef HAS_FREERTOS
+    if (running && xSemaphoreGetMutexHolder(systemLock) == xTaskGetCurrentTaskHandle()) {
+        xSemaphoreGive(systemLock);
+        bool event = eventScheduler.waitForEvent(ms);
+        xSemaphoreTake(systemLock, portMAX_DELAY);
+        return event;
+    }
+#endif
+    return eventScheduler.waitForEvent(ms);
+}
+
+// =============================================================================
+// QUEUES
+// =============================================================================
+
+bool AppTasks::queueStorage(uint8_t type, const SensorData* data) {
+#ifdef HAS_FREERTOS
+    if (!running) return false;
+
+    StorageRequest request;
+    request.type = type;
+    if (data) {
+        request.data = *data;
+    } else {
+        memset(&request.data, 0, sizeof(request.data));
+    }
+
+    // Never block the caller; a full queue means the card is stuck
+    if (xQueueSend(storageQueue, &request, 0) != pdTRUE) {
+        Serial.println(F("Storage queue full - request dropped"));
+        return false;
+    }
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool AppTasks::requestAnalysis() {
+#ifdef HAS_FREERTOS
+    if (!running) return false;
+    uint8_t request = 1;
+    return xQueueSend(analysisRequests, &request, 0) == pdTRUE;
+#else
+    return false;
+#endif
+}
+
+bool AppTasks::takeAnalysis(AudioAnalysisResult& result) {
+#ifdef HAS_FREERTOS
+    if (!running) return false;
+    return xQueueReceive(analysisResults, &result, 0) == pdTRUE;
+#else
+    return false;
+#endif
+}
+
+void AppTasks::mergeAudioDisplay(SensorData& data) {
+    lockAudio();
+    data.dominantFreq = audioLive.dominantFreq;
+    data.soundLevel = audioLive.soundLevel;
+    data.beeState = audioLive.beeState;
+    unlockAudio();
+}
+
+// =============================================================================
+// TASKS
+// =============================================================================
+
+#ifdef HAS_FREERTOS
+void AppTasks::waitUntilActive() {
+    while (!active) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+    }
+}
+
+void AppTasks::audioTask(void* arg) {
+    AppTasks* self = (AppTasks*)arg;
+    TickType_t lastWake = xTaskGetTickCount();
+
+    while (true) {
+        if (!self->active) {
+            self->waitUntilActive();
+            lastWake = xTaskGetTickCount();
+        }
+        vTaskDelayUntil(&lastWake, pdMS_TO_TICKS(TASK_AUDIO_PERIOD_MS));
+        if (!systemStatus.pdmWorking) continue;
+
+        self->lockAudio();
+        processAudio(self->audioLive, settings);
+        self->unlockAudio();
+
+        // A pending request gets the full FFT; the result replaces any
+        // the UI has not collected yet
+        uint8_t request;
+        if (xQueueReceive(self->analysisRequests, &request, 0) == pdTRUE) {
+            self->lockAudio();
+            AudioAnalysisResult result = audioProcessor.performFullAnalysis();
+            self->unlockAudio();
+
+            AudioAnalysisResult stale;
+            xQueueReceive(self->analysisResults, &stale, 0);
+            xQueueSend(self->analysisResults, &result, 0);
+        }
+    }
+}
+
+void AppTasks::sensorTask(void* arg) {
+    AppTasks* self = (AppTasks*)arg;
+
+    while (true) {
+        self->waitUntilActive();
+        vTaskDelay(pdMS_TO_TICKS(TASK_SENSOR_PERIOD_MS));
+
+        // Checked again under the lock: the loop clears it and drops its
+        // I2C hold before sleeping, so a reading taken after that would
+        // find the bus switched off
+        self->lock();
+        if (!self->active) {
+            self->unlock();
+            continue;
+        }
+        readAllSensors(bme, currentData, settings, systemStatus);
+        checkAlerts(currentData, settings, systemStatus);
+        bluetoothManager.onNewReading();
+        SensorData snapshot = currentData;
+        bool logDue = settings.logEnabled &&
+                      millis() - self->lastLog >= settings.logInterval * 60000UL;
+        self->unlock();
+
+        Serial.print(F("Sensors: T="));
+        Serial.print(snapshot.temperature, 1);
+        Serial.print(F("C H="));
+        Serial.print(snapshot.humidity, 1);
+        Serial.print(F("% P="));
+        Serial.print(snapshot.pressure, 1);
+        Serial.print(F("hPa Bat="));
+        Serial.print(snapshot.batteryVoltage, 2);
+        Serial.println(F("V"));
+
+        if (logDue) {
+            self->mergeAudioDisplay(snapshot);
+            if (self->queueStorage(STORE_LOG_READING, &snapshot)) {
+                self->lastLog = millis();
+            }
+        }
+    }
+}
+
+void AppTasks::storageTask(void* arg) {
+    AppTasks* self = (AppTasks*)arg;
+    StorageRequest request;
+
+    while (true) {
+        if (xQueueReceive(self->storageQueue, &request, portMAX_DELAY) != pdTRUE) continue;
+
+        // Requests queued while awake may be served after the loop went
+        // to sleep: hold the RTC and the card for the write
+        self->lock();
+        powerDomains.acquire(DOMAIN_I2C, PCLIENT_FLUSH);
+        powerDomains.acquire(DOMAIN_SD_SPI, PCLIENT_FLUSH);
+        switch (request.type) {
+            case STORE_LOG_READING:
+                logData(request.data, rtc, settings, systemStatus);
+                break;
+            case STORE_FLUSH_FIELD_BUFFER:
+                fieldBuffer.flushToSD(rtc, systemStatus);
+                break;
+        }
+        powerDomains.release(DOMAIN_SD_SPI, PCLIENT_FLUSH);
+        powerDomains.release(DOMAIN_I2C, PCLIENT_FLUSH);
+        self->unlock();
+    }
+}
+
+void AppTasks::bleTask(void* arg) {
+    AppTasks* self = (AppTasks*)arg;
+
+    while (true) {
+        // Woken by BLE events. Polls fast only while a client is connected
+        // and once a second for timed gateway, beacon or advertising work;
+        // with the radio idle or off only an event wakes it
+        TickType_t wait = portMAX_DELAY;
+        if (bluetoothManager.isConnected()) {
+            wait = pdMS_TO_TICKS(BT_NOTIFY_RETRY_MS);
+        } else if (bluetoothManager.hasTimedWork()) {
+            wait = pdMS_TO_TICKS(1000);
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        // update() does a bounded slice of work; a queued burst gets
+        // further slices with the lock dropped for a tick in between, so
+        // the lower-priority loop and storage tasks can take it
+        bool more;
+        do {
+            self->lock();
+            bluetoothManager.update();
+            more = bluetoothManager.hasPendingCommands();
+            self->unlock();
+            if (more) vTaskDelay(1);
+        } while (more);
+    }
+}
+#endif
+
+// =============================================================================
+// DIAGNOSTICS
+// =============================================================================
+
+uint32_t AppTasks::getStackFree(uint8_t task) const {
+#ifdef HAS_FREERTOS
+    if (running && task < APP_TASK_COUNT) {
+        return uxTaskGetStackHighWaterMark(handles[task]) * 4;
+    }
+#endif
+    return 0;
+}
+
+void AppTasks::printStackUsage() const {
+#ifdef HAS_FREERTOS
+    static const char* const names[APP_TASK_COUNT] = { "audio", "sensor", "storage", "ble" };
+    static const uint16_t sizes[APP_TASK_COUNT] = {
+        TASK_STACK_AUDIO, TASK_STACK_SENSOR, TASK_STACK_STORAGE, TASK_STACK_BLE
+    };
+
+    Serial.println(F("Task stack free (min bytes / size):"));
+    Serial.print(F("  loop: "));
+    Serial.println(uxTaskGetStackHighWaterMark(NULL) * 4);
+    if (!running) return;
+
+    for (uint8_t i = 0; i < APP_TASK_COUNT; i++) {
+        Serial.print(F("  "));
+        Serial.print(names[i]);
+        Serial.print(F(": "));
+        Serial.print(getStackFree(i));
+        Serial.print(F(" / "));
+        Serial.println(sizes[i] * 4);
+    }
+#endif
+}
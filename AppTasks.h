@@ -0,0 +1,138 @@
+/**
+ * AppTasks.h
+ * FreeRTOS task layout: audio, sensor, storage and BLE tasks
+ *
+ * The Arduino loop() stays the UI task (buttons, display, menu, state
+ * machine). Around it:
+ *
+ *   audio    TASK_PRIO_HIGH    100 ms sampling, full analysis on request
+ *   sensor   TASK_PRIO_NORMAL  5 s environmental readings and alerts
+ *   ble      TASK_PRIO_NORMAL  BluetoothManager::update() on BLE events
+ *   storage  TASK_PRIO_LOW     SD writes queued by the other tasks
+ *
+ * Work is handed over through fixed-size queues (storage requests,
+ * analysis requests and results). Shared globals, the I2C bus and the
+ * SD card sit behind one system lock that every task except audio holds
+ * while it works; the audio task only takes the audio lock, so a slow SD
+ * write, a BLE transfer or a display refresh never delays sampling.
+ *
+ * Lock order is system, then audio: code holding the system lock may
+ * take the audio lock (merging live values, calibration jobs), never the
+ * other way round. The system lock is not recursive and is held for a
+ * bounded slice at a time; the BLE task drops it between commands and
+ * long BLE jobs advance one step per update().
+ *
+ * Tasks block on queues, notifications or vTaskDelayUntil() between
+ * jobs, so the FreeRTOS idle task gets the tickless low-power wait.
+ * The sensor and audio tasks only run while the UI is awake; the
+ * scheduled-wake path keeps doing its reading synchronously.
+ *
+ * On builds without FreeRTOS begin() returns false and loop() keeps
+ * doing all the work itself. The host build runs the same tasks on the
+ * pthreads port in test/host.
+ */
+
+#ifndef APP_TASKS_H
+#define APP_TASKS_H
+
+#include "Config.h"
+#include "DataStructures.h"
+#include "Audio.h"
+
+#ifdef HAS_FREERTOS
+  #include <FreeRTOS.h>
+  #include <semphr.h>
+  #include <queue.h>
+  #include <task.h>
+#endif
+
+// Stack sizes in 32-bit words
+#define TASK_STACK_AUDIO 1536            // Analysis result and features are copied by value
+#define TASK_STACK_SENSOR 768
+#define TASK_STACK_STORAGE 1024
+#define TASK_STACK_BLE 1536              // Response writers hold a full packet
+
+#define TASK_SENSOR_PERIOD_MS 5000
+#define TASK_AUDIO_PERIOD_MS 100
+#define TASK_STORAGE_QUEUE 4
+
+enum AppTaskId {
+    APP_TASK_AUDIO = 0,
+    APP_TASK_SENSOR = 1,
+    APP_TASK_STORAGE = 2,
+    APP_TASK_BLE = 3,
+    APP_TASK_COUNT = 4
+};
+
+enum StorageRequestType {
+    STORE_LOG_READING = 0,       // logData() with the attached reading
+    STORE_FLUSH_FIELD_BUFFER = 1
+};
+
+struct StorageRequest {
+    uint8_t type;
+    SensorData data;
+};
+
+class AppTasks {
+private:
+    bool running;
+    volatile bool active;
+
+    // Latest live audio values, written by the audio task
+    SensorData audioLive;
+    unsigned long lastLog;
+
+#ifdef HAS_FREERTOS
+    TaskHandle_t handles[APP_TASK_COUNT];
+    SemaphoreHandle_t systemLock;
+    SemaphoreHandle_t audioLock;
+    QueueHandle_t storageQueue;
+    QueueHandle_t analysisRequests;
+    QueueHandle_t analysisResults;
+
+    static void audioTask(void* arg);
+    static void sensorTask(void* arg);
+    static void storageTask(void* arg);
+    static void bleTask(void* arg);
+    void waitUntilActive();
+#endif
+
+public:
+    AppTasks();
+
+    // Creates the locks, queues and tasks; false if tasks are not available
+    bool begin();
+    bool isRunning() const { return running; }
+
+    // Sensor and audio work only runs while the UI is awake
+    void setActive(bool on);
+    bool isActive() const { return active; }
+
+    // Shared globals, I2C and SD; not recursive, take once per task
+    void lock();
+    void unlock();
+    void lockAudio();
+    void unlockAudio();
+
+    // Sleeps until a scheduler event or the timeout with the system lock
+    // released if this task holds it; true if an event is pending
+    bool unlockedWait(unsigned long ms);
+
+    bool queueStorage(uint8_t type, const SensorData* data);
+
+    // Full FFT analysis runs on the audio task; results come back queued
+    bool requestAnalysis();
+    bool takeAnalysis(AudioAnalysisResult& result);
+
+    // Copies the live frequency, level and bee state into data
+    void mergeAudioDisplay(SensorData& data);
+
+    // Least free stack a task has had, in bytes; 0 if it is not running
+    uint32_t getStackFree(uint8_t task) const;
+    void printStackUsage() const;
+};
+
+extern AppTasks appTasks;
+
+#endif // APP_TASKS_H
@@ -58,17 +58,22 @@ AudioProcessor::AudioProcessor() {
     for (int i = 0; i < FFT_SIZE/2; i++) {
         prevMagnitude[i] = 0;
     }
+    
+    memset(&lastResult, 0, sizeof(lastResult));
 }
 
-void AudioProcessor::initialize(SystemSettings* sysSettings, SystemStatus* sysStatus) {
+void AudioProcessor::initialize(SystemSettings* sysSettings, SystemStatus* sysStatus, bool probeMicrophone) {
     settings = sysSettings;
     status = sysStatus;
     
     // Set ADC resolution
     analogReadResolution(12);
     
-    // Detect microphone
-    if (detectMicrophone()) {
+    // The probe takes 500 ms; a fast boot reuses the last result
+    if (!probeMicrophone) {
+        Serial.println(status->pdmWorking ? F("AudioProcessor: Microphone (cached)") :
+                                            F("AudioProcessor: No microphone (cached)"));
+    } else if (detectMicrophone()) {
         status->pdmWorking = true;
         Serial.println(F("AudioProcessor: Microphone detected"));
     } else {
@@ -251,6 +256,8 @@ AudioAnalysisResult AudioProcessor::performFullAnalysis() {
         prevMagnitude[i] = fftMagnitude[i];
     }
     
+    lastResult = result;
+    
     // Reset buffer for next analysis
     bufferIndex = 0;
     
@@ -882,12 +889,30 @@ uint8_t AudioProcessor::calculateSignalQuality() {
     return quality;
 }
 
+uint8_t AudioProcessor::getDownsampledSpectrum(uint8_t* bins, uint8_t binCount) const {
+    // Averages the last completed spectrum (prevMagnitude) into binCount
+    // equal-width bands, in 0.5 dB steps so a magnitude fits in a byte
+    if (binCount == 0) return 0;
+    binCount = min(binCount, (uint8_t)(FFT_SIZE / 2));
+    int perBin = (FFT_SIZE / 2) / binCount;
+    
+    for (int b = 0; b < binCount; b++) {
+        float sum = 0;
+        for (int i = 0; i < perBin; i++) {
+            sum += prevMagnitude[b * perBin + i];
+        }
+        float db = 20.0f * log10f(1.0f + sum / perBin);
+        bins[b] = (uint8_t)constrain(db * 2.0f, 0.0f, 255.0f);
+    }
+    return binCount;
+}
+
 // =============================================================================
 // SIMPLE INTERFACE FUNCTIONS FOR COMPATIBILITY
 // =============================================================================
 
-void initializeAudio(SystemStatus& status) {
-    audioProcessor.initialize(nullptr, &status);
+void initializeAudio(SystemStatus& status, bool probeMicrophone) {
+    audioProcessor.initialize(nullptr, &status, probeMicrophone);
 }
 
 void processAudio(SensorData& data, SystemSettings& settings) {
@@ -907,45 +932,75 @@ void runAudioDiagnostics(SystemStatus& status) {
     audioProcessor.runDiagnostics();
 }
 
-void calibrateAudioLevels(SystemSettings& settings, int durationSeconds) {
+void beginAudioCalibration(AudioCalibration& cal, int durationSeconds) {
     Serial.println(F("Starting audio calibration..."));
     Serial.println(F("Ensure hive is in normal state"));
     
-    unsigned long startTime = millis();
-    unsigned long duration = durationSeconds * 1000;
+    cal.startTime = millis();
+    cal.lastSampleTime = 0;
+    cal.durationMs = (unsigned long)durationSeconds * 1000;
+    cal.freqSum = 0;
+    cal.levelSum = 0;
+    cal.sampleCount = 0;
+    cal.active = true;
+}
+
+bool stepAudioCalibration(AudioCalibration& cal) {
+    if (!cal.active) return true;
     
-    float avgFreq = 0;
-    float avgLevel = 0;
-    int sampleCount = 0;
+    unsigned long now = millis();
+    if (now - cal.startTime >= cal.durationMs) {
+        cal.active = false;
+        return true;
+    }
     
-    while (millis() - startTime < duration) {
-        audioProcessor.updateDisplayData();
-        AudioDisplayData data = audioProcessor.getDisplayData();
-        
-        avgFreq += data.dominantFreq;
-        avgLevel += data.soundLevel;
-        sampleCount++;
-        
+    // One reading every 100 ms; callers poll as often as they like
+    if (cal.sampleCount > 0 && now - cal.lastSampleTime < 100) return false;
+    cal.lastSampleTime = now;
+    
+    audioProcessor.updateDisplayData();
+    AudioDisplayData data = audioProcessor.getDisplayData();
+    cal.freqSum += data.dominantFreq;
+    cal.levelSum += data.soundLevel;
+    cal.sampleCount++;
+    return false;
+}
+
+uint8_t getAudioCalibrationProgress(const AudioCalibration& cal) {
+    if (!cal.active || cal.durationMs == 0) return 100;
+    return min((millis() - cal.startTime) * 100UL / cal.durationMs, 100UL);
+}
+
+void finishAudioCalibration(AudioCalibration& cal) {
+    cal.active = false;
+    if (cal.sampleCount == 0) return;
+    
+    float avgFreq = cal.freqSum / cal.sampleCount;
+    float avgLevel = cal.levelSum / cal.sampleCount;
+    
+    Serial.print(F("Average frequency: "));
+    Serial.print(avgFreq);
+    Serial.println(F(" Hz"));
+    Serial.print(F("Average level: "));
+    Serial.print(avgLevel);
+    Serial.println(F("%"));
+    
+    Serial.println(F("\nSuggested settings:"));
+    Serial.print(F("Queen frequency range: "));
+    Serial.print(avgFreq - 50);
+    Serial.print(F(" - "));
+    Serial.println(avgFreq + 50);
+    Serial.print(F("Stress threshold: "));
+    Serial.println(avgLevel + 30);
+}
+
+void calibrateAudioLevels(SystemSettings& settings, int durationSeconds) {
+    AudioCalibration cal;
+    beginAudioCalibration(cal, durationSeconds);
+    
+    while (!stepAudioCalibration(cal)) {
         delay(100);
     }
     
-    if (sampleCount > 0) {
-        avgFreq /= sampleCount;
-        avgLevel /= sampleCount;
-        
-        Serial.print(F("Average frequency: "));
-        Serial.print(avgFreq);
-        Serial.println(F(" Hz"));
-        Serial.print(F("Average level: "));
-        Serial.print(avgLevel);
-        Serial.println(F("%"));
-        
-        Serial.println(F("\nSuggested settings:"));
-        Serial.print(F("Queen frequency range: "));
-        Serial.print(avgFreq - 50);
-        Serial.print(F(" - "));
-        Serial.println(avgFreq + 50);
-        Serial.print(F("Stress threshold: "));
-        Serial.println(avgLevel + 30);
-    }
+    finishAudioCalibration(cal);
 }
\ No newline at end of file
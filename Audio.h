@@ -89,6 +89,17 @@ struct AudioAnalysisResult {
     bool analysisValid;       // Data quality flag
 };
 
+// Incremental calibration state (lets callers interleave other work)
+struct AudioCalibration {
+    unsigned long startTime;
+    unsigned long lastSampleTime;
+    unsigned long durationMs;
+    float freqSum;
+    float levelSum;
+    uint16_t sampleCount;
+    bool active;
+};
+
 // Context flags for rich metadata
 enum AudioContextFlags {
     CONTEXT_AFTER_INSPECTION = 0x01,
@@ -154,6 +165,9 @@ private:
     float midTermEnergySum;
     float longTermEnergySum;
     
+    // Most recent valid full analysis (for BLE streaming)
+    AudioAnalysisResult lastResult;
+    
     // System references
     SystemSettings* settings;
     SystemStatus* status;
@@ -183,7 +197,8 @@ public:
     AudioProcessor();
     
     // Initialization
-    void initialize(SystemSettings* sysSettings, SystemStatus* sysStatus);
+    // probeMicrophone false keeps status->pdmWorking as found (fast boot)
+    void initialize(SystemSettings* sysSettings, SystemStatus* sysStatus, bool probeMicrophone = true);
     bool detectMicrophone();
     
     // Real-time processing (called frequently)
@@ -193,6 +208,8 @@ public:
     
     // Full analysis (called at log intervals)
     AudioAnalysisResult performFullAnalysis();
+    const AudioAnalysisResult& getLastResult() const { return lastResult; }
+    uint8_t getDownsampledSpectrum(uint8_t* bins, uint8_t binCount) const;
     
     // Utility functions
     void resetBuffers();
@@ -215,9 +232,13 @@ extern AudioProcessor audioProcessor;
 // SIMPLE INTERFACE FUNCTIONS (for main.cpp compatibility)
 // =============================================================================
 
-void initializeAudio(SystemStatus& status);
+void initializeAudio(SystemStatus& status, bool probeMicrophone = true);
 void processAudio(SensorData& data, SystemSettings& settings);
 void runAudioDiagnostics(SystemStatus& status);
 void calibrateAudioLevels(SystemSettings& settings, int durationSeconds);
+void beginAudioCalibration(AudioCalibration& cal, int durationSeconds);
+bool stepAudioCalibration(AudioCalibration& cal);
+uint8_t getAudioCalibrationProgress(const AudioCalibration& cal);
+void finishAudioCalibration(AudioCalibration& cal);
 
 #endif // AUDIO_H
\ No newline at end of file
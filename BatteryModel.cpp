@@ -0,0 +1,198 @@
+/**
+ * BatteryModel.cpp
+ * LiPo state of charge estimator implementation
+ */
+
+#include "BatteryModel.h"
+
+BatteryModel batteryModel;
+
+// Typical single-cell LiPo open-circuit voltage at 25 C, light load
+struct OcvPoint {
+    uint8_t percent;
+    float voltage;
+};
+
+static const OcvPoint ocvTable[] = {
+    {   0, 3.27f }, {   5, 3.61f }, {  10, 3.69f }, {  15, 3.71f },
+    {  20, 3.73f }, {  30, 3.77f }, {  40, 3.79f }, {  50, 3.82f },
+    {  60, 3.87f }, {  70, 3.92f }, {  80, 3.98f }, {  90, 4.06f },
+    { 100, 4.20f }
+};
+static const uint8_t OCV_POINTS = sizeof(ocvTable) / sizeof(ocvTable[0]);
+
+int batteryOcvToPercent(float voltage) {
+    return (int)(BatteryModel::ocvToSoc(voltage) * 100.0f + 0.5f);
+}
+
+BatteryModel::BatteryModel() {
+    valid = false;
+    charging = false;
+    soc = 0.0f;
+    variance = BATTERY_INITIAL_VARIANCE;
+    lastOcv = 0.0f;
+    lastTempC = BATTERY_REF_TEMP_C;
+    lastMs = 0;
+    anchorMah = 0.0f;
+    anchorMs = 0;
+    observedDrainMa = 0.0f;
+}
+
+// =============================================================================
+// CELL MODEL
+// =============================================================================
+
+float BatteryModel::ocvToSoc(float ocv) {
+    if (ocv <= ocvTable[0].voltage) return 0.0f;
+    if (ocv >= ocvTable[OCV_POINTS - 1].voltage) return 1.0f;
+
+    for (uint8_t i = 1; i < OCV_POINTS; i++) {
+        if (ocv < ocvTable[i].voltage) {
+            const OcvPoint& a = ocvTable[i - 1];
+            const OcvPoint& b = ocvTable[i];
+            float t = (ocv - a.voltage) / (b.voltage - a.voltage);
+            return (a.percent + t * (b.percent - a.percent)) / 100.0f;
+        }
+    }
+    return 1.0f;
+}
+
+float BatteryModel::ocvSlope(float s) {
+    // Volts per unit of SoC in the table segment holding s
+    float percent = s * 100.0f;
+    for (uint8_t i = 1; i < OCV_POINTS; i++) {
+        if (percent <= ocvTable[i].percent || i == OCV_POINTS - 1) {
+            const OcvPoint& a = ocvTable[i - 1];
+            const OcvPoint& b = ocvTable[i];
+            return (b.voltage - a.voltage) * 100.0f / (b.percent - a.percent);
+        }
+    }
+    return 1.0f;
+}
+
+float BatteryModel::resistanceAt(float tempC) {
+    float t = constrain(tempC, -20.0f, 60.0f);
+    if (t >= BATTERY_REF_TEMP_C) return BATTERY_R_INTERNAL_OHM;
+    return BATTERY_R_INTERNAL_OHM * (1.0f + 0.03f * (BATTERY_REF_TEMP_C - t));
+}
+
+float BatteryModel::capacityFactorAt(float tempC) {
+    float t = constrain(tempC, -20.0f, 60.0f);
+    if (t >= BATTERY_REF_TEMP_C) return 1.0f;
+    return max(0.5f, 1.0f - 0.006f * (BATTERY_REF_TEMP_C - t));
+}
+
+// =============================================================================
+// FILTER
+// =============================================================================
+
+void BatteryModel::restart(float ocv, unsigned long nowMs) {
+    valid = true;
+    soc = ocvToSoc(ocv);
+    variance = BATTERY_INITIAL_VARIANCE;
+    lastMs = nowMs;
+    anchorMah = soc * BATTERY_CAPACITY_MAH;
+    anchorMs = nowMs;
+    observedDrainMa = 0.0f;
+}
+
+void BatteryModel::update(float voltage, float loadMa, float avgMa, float tempC, unsigned long nowMs) {
+    if (voltage < 1.0f) return;   // No battery reading
+    lastTempC = tempC;
+
+    // On USB the terminal voltage says nothing about the cell
+    if (voltage >= BATTERY_USB_THRESHOLD) {
+        charging = true;
+        lastMs = nowMs;
+        return;
+    }
+
+    float ocv = voltage + loadMa / 1000.0f * resistanceAt(tempC);
+    lastOcv = ocv;
+
+    if (!valid || charging) {
+        charging = false;
+        restart(ocv, nowMs);
+        return;
+    }
+
+    // Predict: coulomb counting with the average current
+    float hours = (nowMs - lastMs) / 3600000.0f;
+    lastMs = nowMs;
+    float capacity = BATTERY_CAPACITY_MAH * capacityFactorAt(tempC);
+    soc -= avgMa * hours / capacity;
+    variance += BATTERY_PROCESS_NOISE * hours;
+
+    // Correct: the curve reading counts for little where the curve is flat
+    float measured = ocvToSoc(ocv);
+    float slope = max(ocvSlope(measured), 0.05f);
+    float noise = BATTERY_VOLTAGE_NOISE_V / slope;
+    float gain = variance / (variance + noise * noise);
+    soc += gain * (measured - soc);
+    variance *= 1.0f - gain;
+    soc = constrain(soc, 0.0f, 1.0f);
+
+    // Drain seen over the window, in nominal mAh so temperature swings
+    // in usable capacity do not show up as drain
+    float windowHours = (nowMs - anchorMs) / 3600000.0f;
+    if (windowHours >= BATTERY_RATE_WINDOW_H) {
+        float mah = soc * BATTERY_CAPACITY_MAH;
+        float drain = (anchorMah - mah) / windowHours;
+        if (drain > 0.0f) {
+            observedDrainMa = observedDrainMa > 0.0f ? (observedDrainMa + drain) / 2.0f : drain;
+        }
+        anchorMah = mah;
+        anchorMs = nowMs;
+    }
+}
+
+// =============================================================================
+// RESULTS
+// =============================================================================
+
+int BatteryModel::getLevel(float voltage) const {
+    if (charging || voltage >= BATTERY_USB_THRESHOLD) return 100;
+    if (!valid) return batteryOcvToPercent(voltage);
+    return (int)(soc * 100.0f + 0.5f);
+}
+
+float BatteryModel::getSocSigma() const {
+    return sqrtf(variance);
+}
+
+float BatteryModel::getRemainingMah() const {
+    return soc * BATTERY_CAPACITY_MAH * capacityFactorAt(lastTempC);
+}
+
+float BatteryModel::predictRuntimeHours(float modelMa) const {
+    if (charging || !valid) return 999.0f;
+    float rate = observedDrainMa > 0.0f ? observedDrainMa : modelMa;
+    if (rate <= 0.0f) return 999.0f;
+    return getRemainingMah() / rate;
+}
+
+void BatteryModel::printStatus() const {
+    Serial.print(F("Battery: "));
+    if (charging) {
+        Serial.println(F("USB power"));
+        return;
+    }
+    if (!valid) {
+        Serial.println(F("no reading yet"));
+        return;
+    }
+    Serial.print(soc * 100.0f, 1);
+    Serial.print(F("% +/-"));
+    Serial.print(getSocSigma() * 100.0f, 1);
+    Serial.print(F(" (OCV "));
+    Serial.print(lastOcv, 3);
+    Serial.print(F("V), "));
+    Serial.print(getRemainingMah(), 0);
+    Serial.print(F(" mAh left"));
+    if (observedDrainMa > 0.0f) {
+        Serial.print(F(", drain "));
+        Serial.print(observedDrainMa, 2);
+        Serial.print(F(" mA"));
+    }
+    Serial.println();
+}
@@ -0,0 +1,93 @@
+/**
+ * BatteryModel.h
+ * LiPo state of charge and runtime prediction
+ *
+ * The loaded battery voltage is corrected back to open-circuit voltage
+ * with the current the device draws in its present state (I * R, with
+ * the internal resistance rising in the cold), then looked up in a LiPo
+ * discharge curve. That reading is noisy, and almost useless on the
+ * flat middle of the curve, so it feeds a one-state Kalman filter whose
+ * prediction step is coulomb counting with the average current:
+ *
+ *   predict   soc -= I_avg * dt / capacity(T),  P += Q * dt
+ *   correct   R = (sigmaV / dOCV/dSoC)^2,  K = P / (P + R)
+ *
+ * The hive temperature from the BME280 stands in for the cell
+ * temperature; below 25 C it raises the internal resistance and lowers
+ * the usable capacity.
+ *
+ * Runtime comes from the charge left and the drain rate actually seen
+ * over the last BATTERY_RATE_WINDOW_H hours, or the modelled current
+ * until such a window exists. On USB the filter is held and restarted
+ * from the curve once the cable is gone.
+ */
+
+#ifndef BATTERY_MODEL_H
+#define BATTERY_MODEL_H
+
+#include "Config.h"
+
+#define BATTERY_CAPACITY_MAH 1200.0f
+#define BATTERY_R_INTERNAL_OHM 0.15f     // Cell plus protection, at 25 C
+#define BATTERY_REF_TEMP_C 25.0f
+#define BATTERY_VOLTAGE_NOISE_V 0.02f    // ADC and load uncertainty, 1 sigma
+#define BATTERY_PROCESS_NOISE 0.0004f    // SoC variance added per hour
+#define BATTERY_INITIAL_VARIANCE 0.01f   // 10% sigma on a fresh start
+#define BATTERY_RATE_WINDOW_H 6          // Drain is measured over this span
+
+// Open-circuit voltage to SoC (0-100) from the LiPo curve; no load or
+// temperature correction
+int batteryOcvToPercent(float voltage);
+
+class BatteryModel {
+private:
+    bool valid;
+    bool charging;
+    float soc;                   // 0..1
+    float variance;
+    float lastOcv;
+    float lastTempC;
+    unsigned long lastMs;
+
+    // Drain actually seen between two points BATTERY_RATE_WINDOW_H apart
+    float anchorMah;
+    unsigned long anchorMs;
+    float observedDrainMa;       // 0 until the first window closes
+
+    static float ocvSlope(float soc);
+    static float resistanceAt(float tempC);
+    void restart(float ocv, unsigned long nowMs);
+
+public:
+    BatteryModel();
+
+    // Discharge curve lookup, 0..1
+    static float ocvToSoc(float ocv);
+
+    // Usable share of the rated capacity at a cell temperature
+    static float capacityFactorAt(float tempC);
+
+    // voltage:  loaded battery voltage
+    // loadMa:   current drawn while it was measured
+    // avgMa:    average current since the last update
+    void update(float voltage, float loadMa, float avgMa, float tempC, unsigned long nowMs);
+
+    bool isValid() const { return valid; }
+    bool isCharging() const { return charging; }
+
+    // Filtered SoC, or the plain curve lookup before the first update
+    int getLevel(float voltage) const;
+    float getSoc() const { return soc; }
+    float getSocSigma() const;
+    float getRemainingMah() const;
+
+    // Hours left at the observed drain, or at modelMa until one is known
+    float predictRuntimeHours(float modelMa) const;
+    float getObservedDrainMa() const { return observedDrainMa; }
+
+    void printStatus() const;
+};
+
+extern BatteryModel batteryModel;
+
+#endif // BATTERY_MODEL_H
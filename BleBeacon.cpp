@@ -0,0 +1,109 @@
+/**
+ * BleBeacon.cpp
+ * Status beacon payload encoding and power estimate
+ */
+
+#include "BleBeacon.h"
+#include "Utils.h"
+
+uint8_t encodeBeaconPayload(const BeaconStatus& status, uint8_t* out) {
+    putU16LE(&out[0], BEACON_COMPANY_ID);
+    out[2] = BEACON_VERSION;
+    out[3] = status.deviceId;
+    out[4] = (uint8_t)constrain(lroundf(status.batteryVoltage * 50.0f), 0L, 255L);
+    putU16LE(&out[5], (uint16_t)(int16_t)constrain(lroundf(status.temperature * 100.0f), -32768L, 32767L));
+    out[7] = status.beeState;
+    out[8] = status.abscondingRisk;
+    out[9] = status.alertFlags;
+    out[10] = status.readingAgeMinutes;
+    out[11] = status.counter;
+    out[12] = status.alertLatch;
+    out[13] = status.alertSeq;
+    return BEACON_PAYLOAD_SIZE;
+}
+
+bool decodeBeaconPayload(const uint8_t* in, uint8_t len, BeaconStatus& status) {
+    if (len < BEACON_PAYLOAD_SIZE || getU16LE(&in[0]) != BEACON_COMPANY_ID || in[2] != BEACON_VERSION) {
+        return false;
+    }
+    status.deviceId = in[3];
+    status.batteryVoltage = in[4] / 50.0f;
+    status.temperature = (int16_t)getU16LE(&in[5]) / 100.0f;
+    status.beeState = in[7];
+    status.abscondingRisk = in[8];
+    status.alertFlags = in[9];
+    status.readingAgeMinutes = in[10];
+    status.counter = in[11];
+    status.alertLatch = in[12];
+    status.alertSeq = in[13];
+    return true;
+}
+
+uint8_t encodeBeaconAcks(const BeaconAck* acks, uint8_t count, uint8_t* out) {
+    count = min(count, (uint8_t)BEACON_MAX_ACKS);
+    for (uint8_t i = 0; i < count; i++) {
+        out[2 * i] = acks[i].deviceId;
+        out[2 * i + 1] = acks[i].alertSeq;
+    }
+    return count;
+}
+
+uint8_t decodeBeaconAcks(const uint8_t* in, uint8_t len, BeaconAck* acks, uint8_t maxAcks) {
+    BeaconStatus status;
+    if (!decodeBeaconPayload(in, len, status)) return 0;
+    uint8_t count = min((uint8_t)((len - BEACON_PAYLOAD_SIZE) / 2), maxAcks);
+    for (uint8_t i = 0; i < count; i++) {
+        acks[i].deviceId = in[BEACON_PAYLOAD_SIZE + 2 * i];
+        acks[i].alertSeq = in[BEACON_PAYLOAD_SIZE + 2 * i + 1];
+    }
+    return count;
+}
+
+// =============================================================================
+// ALERT LATCH
+// =============================================================================
+
+void BeaconAlertLatch::onReading(uint8_t alertFlags) {
+    // Every raise moves the sequence, so an ack sent for an earlier one
+    // cannot clear an alert the gateway has not seen yet
+    uint8_t raised = alertFlags & ~previous;
+    if (raised) {
+        flags |= raised;
+        seq++;
+    }
+    previous = alertFlags;
+}
+
+bool BeaconAlertLatch::onGatewayBeacon(uint8_t deviceId, const uint8_t* payload, uint8_t len) {
+    if (!flags) return false;
+    BeaconAck acks[BEACON_MAX_ACKS];
+    uint8_t count = decodeBeaconAcks(payload, len, acks, BEACON_MAX_ACKS);
+    for (uint8_t i = 0; i < count; i++) {
+        if (acks[i].deviceId == deviceId && acks[i].alertSeq == seq) {
+            flags = 0;
+            return true;
+        }
+    }
+    return false;
+}
+
+// =============================================================================
+// POWER
+// =============================================================================
+
+float estimateBeaconCurrentUa(uint16_t intervalMs, uint8_t payloadLen) {
+    if (intervalMs == 0) return 0;
+
+    // Air time of one advertising PDU at 1 Mbit/s (8 us per byte)
+    uint16_t pduBytes = BEACON_PDU_OVERHEAD_BYTES + BEACON_FLAGS_BYTES +
+                        BEACON_AD_HEADER_BYTES + payloadLen;
+    float txUs = pduBytes * 8.0f;
+
+    // Charge per event in microcoulombs (mA x us = nC)
+    float chargeUc = BEACON_STARTUP_CHARGE_UC +
+                     3 * (txUs * BEACON_TX_CURRENT_MA + BEACON_RAMP_US * BEACON_IDLE_CURRENT_MA) / 1000.0f +
+                     2 * BEACON_CHANNEL_GAP_US * BEACON_IDLE_CURRENT_MA / 1000.0f;
+
+    // uC per event x events per second = uA
+    return chargeUc * 1000.0f / intervalMs;
+}
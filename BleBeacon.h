@@ -0,0 +1,103 @@
+/**
+ * BleBeacon.h
+ * Connectionless status beacon in manufacturer-specific advertising data
+ *
+ * Payload (BEACON_PAYLOAD_SIZE bytes, little-endian):
+ *   [companyId u16][version u8][deviceId u8][battery u8, 20 mV steps]
+ *   [temperature i16 x100][beeState u8][abscondingRisk u8][alertFlags u8]
+ *   [readingAge u8][counter u8][alertLatch u8][alertSeq u8]
+ *
+ * readingAge is minutes since the last sensor reading (255 = older or
+ * none). counter increments whenever a new reading is published so a
+ * scanner can tell fresh data from a repeated advertisement.
+ *
+ * alertFlags only holds the alerts of the last reading, so one that
+ * comes and goes between two gateway scans would never be seen.
+ * alertLatch keeps every alert raised since the gateway last
+ * acknowledged, and alertSeq counts the raises. A gateway acknowledges
+ * by appending [deviceId u8][alertSeq u8] pairs to its own beacon; a
+ * node with a latch listens for BEACON_ACK_LISTEN_MS after each reading
+ * and clears the latch on an ack for its current sequence.
+ */
+
+#ifndef BLE_BEACON_H
+#define BLE_BEACON_H
+
+#include "Config.h"
+#include "DataStructures.h"
+
+#define BEACON_COMPANY_ID 0xFFFF          // Bluetooth SIG "no company" id for development
+#define BEACON_VERSION 2
+#define BEACON_PAYLOAD_SIZE 14
+#define BEACON_AGE_UNKNOWN 255
+#define BEACON_MAX_ACKS 6                 // Pairs that fit after the status record
+#define BEACON_MAX_PAYLOAD (BEACON_PAYLOAD_SIZE + 2 * BEACON_MAX_ACKS)
+#define BEACON_ACK_LISTEN_MS (2 * BEACON_DEFAULT_INTERVAL_MS + 1000)
+
+#define BEACON_DEFAULT_INTERVAL_MS 2000
+#define BEACON_MIN_INTERVAL_MS 1000
+#define BEACON_MAX_INTERVAL_MS 10240      // Spec maximum advertising interval
+
+// Power model for one non-connectable advertising event on 3 channels
+// at 1M PHY, 0 dBm, DC/DC enabled (nRF52840 datasheet figures)
+#define BEACON_TX_CURRENT_MA 6.4f         // Radio TX plus CPU
+#define BEACON_IDLE_CURRENT_MA 1.0f       // Radio ramp and channel switch
+#define BEACON_RAMP_US 140                // Per channel
+#define BEACON_CHANNEL_GAP_US 150         // Between channels
+#define BEACON_STARTUP_CHARGE_UC 1.5f     // HFXO start and SoftDevice wakeup
+#define BEACON_PDU_OVERHEAD_BYTES 16      // Preamble, access address, header, AdvA, CRC
+#define BEACON_FLAGS_BYTES 3              // Flags AD structure in front of the payload
+#define BEACON_AD_HEADER_BYTES 2          // Length + type of the manufacturer AD structure
+
+struct BeaconStatus {
+    uint8_t deviceId;
+    float batteryVoltage;
+    float temperature;
+    uint8_t beeState;
+    uint8_t abscondingRisk;
+    uint8_t alertFlags;
+    uint8_t readingAgeMinutes;
+    uint8_t counter;
+    uint8_t alertLatch;
+    uint8_t alertSeq;
+};
+
+struct BeaconAck {
+    uint8_t deviceId;
+    uint8_t alertSeq;
+};
+
+// Alerts raised since the gateway last acknowledged them
+class BeaconAlertLatch {
+private:
+    uint8_t flags;
+    uint8_t seq;
+    uint8_t previous;            // alertFlags of the last reading
+
+public:
+    BeaconAlertLatch() : flags(0), seq(0), previous(0) {}
+
+    // Latches the alerts this reading raised
+    void onReading(uint8_t alertFlags);
+
+    // Clears the latch if payload is a beacon acknowledging deviceId at
+    // the current sequence; true if it did
+    bool onGatewayBeacon(uint8_t deviceId, const uint8_t* payload, uint8_t len);
+
+    bool isPending() const { return flags != 0; }
+    uint8_t getFlags() const { return flags; }
+    uint8_t getSeq() const { return seq; }
+};
+
+// Writes BEACON_PAYLOAD_SIZE bytes into out and returns the length
+uint8_t encodeBeaconPayload(const BeaconStatus& status, uint8_t* out);
+bool decodeBeaconPayload(const uint8_t* in, uint8_t len, BeaconStatus& status);
+
+// Acks go after a status record; both return the number of acks
+uint8_t encodeBeaconAcks(const BeaconAck* acks, uint8_t count, uint8_t* out);
+uint8_t decodeBeaconAcks(const uint8_t* in, uint8_t len, BeaconAck* acks, uint8_t maxAcks);
+
+// Average current drawn by beaconing, in microamps
+float estimateBeaconCurrentUa(uint16_t intervalMs, uint8_t payloadLen);
+
+#endif // BLE_BEACON_H
@@ -0,0 +1,394 @@
+/**
+ * BleGateway.cpp
+ * Apiary gateway implementation
+ */
+
+#include "BleGateway.h"
+#include "Utils.h"
+#include "EventScheduler.h"
+
+#ifdef NRF52_SERIES
+  #include <bluefruit.h>
+#endif
+
+BleGateway bleGateway;
+
+#ifdef NRF52_SERIES
+static void gatewayScanCallback(ble_gap_evt_adv_report_t* report) {
+    uint8_t payload[BEACON_MAX_PAYLOAD];
+    uint8_t len = Bluefruit.Scanner.parseReportByType(report, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA,
+                                                      payload, sizeof(payload));
+    if (len > 0) {
+        bleGateway.queueReport(report->peer_addr.addr, report->rssi, payload, len);
+        eventScheduler.post(EVT_BLE);
+    }
+    Bluefruit.Scanner.resume();
+}
+#endif
+
+BleGateway::BleGateway() {
+    enabled = false;
+    scanning = false;
+    ownDeviceId = 0;
+    periodMin = GATEWAY_DEFAULT_PERIOD_MIN;
+    lastScanStart = 0;
+    scansCompleted = 0;
+    beaconsSeen = 0;
+    reportHead = 0;
+    reportTail = 0;
+    reportsDropped = 0;
+    ackCursor = 0;
+    memset(neighbours, 0, sizeof(neighbours));
+}
+
+void BleGateway::setEnabled(bool on, uint8_t periodMinutes, uint8_t deviceId) {
+    if (!on && scanning) stopScan();
+
+    enabled = on;
+    ownDeviceId = deviceId;
+    periodMin = max(periodMinutes ? periodMinutes : (uint8_t)GATEWAY_DEFAULT_PERIOD_MIN,
+                    (uint8_t)GATEWAY_MIN_PERIOD_MIN);
+    lastScanStart = millis() - periodMin * 60000UL;   // First scan on the next update()
+
+    Serial.print(F("Gateway: "));
+    if (on) {
+        Serial.print(F("scanning every "));
+        Serial.print(periodMin);
+        Serial.print(F(" min, est. "));
+        Serial.print(estimateScanCurrentUa(), 1);
+        Serial.println(F(" uA"));
+    } else {
+        Serial.println(F("OFF"));
+    }
+}
+
+// =============================================================================
+// SCAN SCHEDULE
+// =============================================================================
+
+void BleGateway::startScan() {
+#ifdef NRF52_SERIES
+    // Continuous scanning for the whole window: every neighbour sends at
+    // least two beacons in it, so a short window is enough
+    Bluefruit.Scanner.setRxCallback(gatewayScanCallback);
+    Bluefruit.Scanner.restartOnDisconnect(false);
+    Bluefruit.Scanner.filterMSD(BEACON_COMPANY_ID);
+    Bluefruit.Scanner.useActiveScan(false);
+    Bluefruit.Scanner.setInterval(160, 160);             // 100 ms, 100% duty
+    Bluefruit.Scanner.start(GATEWAY_SCAN_WINDOW_MS / 10);   // 10 ms units
+#endif
+    scanning = true;
+    lastScanStart = millis();
+}
+
+void BleGateway::stopScan() {
+#ifdef NRF52_SERIES
+    Bluefruit.Scanner.stop();
+#endif
+    scanning = false;
+    scansCompleted++;
+}
+
+void BleGateway::update() {
+    if (!enabled) return;
+
+    unsigned long elapsed = millis() - lastScanStart;
+    if (scanning) {
+        if (elapsed >= GATEWAY_SCAN_WINDOW_MS) stopScan();
+    } else if (elapsed >= periodMin * 60000UL) {
+        startScan();
+    }
+}
+
+void BleGateway::processReports(uint32_t now) {
+    while (reportTail != reportHead) {
+        const GatewayReport& r = reports[reportTail];
+        processBeacon(r.addr, r.rssi, r.payload, r.len, now);
+        reportTail = (reportTail + 1) % GATEWAY_REPORT_QUEUE;
+    }
+}
+
+void BleGateway::queueReport(const uint8_t* addr, int8_t rssi, const uint8_t* payload, uint8_t len) {
+    uint8_t next = (reportHead + 1) % GATEWAY_REPORT_QUEUE;
+    if (next == reportTail || len < BEACON_PAYLOAD_SIZE || len > BEACON_MAX_PAYLOAD) {
+        reportsDropped++;
+        return;
+    }
+
+    GatewayReport& r = reports[reportHead];
+    memcpy(r.addr, addr, sizeof(r.addr));
+    r.rssi = rssi;
+    r.len = BEACON_PAYLOAD_SIZE;
+    memcpy(r.payload, payload, BEACON_PAYLOAD_SIZE);
+    reportHead = next;
+}
+
+// =============================================================================
+// NEIGHBOUR TABLE
+// =============================================================================
+
+GatewayNeighbour* BleGateway::findOrAdd(uint8_t deviceId, const uint8_t* addr, uint32_t now) {
+    GatewayNeighbour* free = nullptr;
+    GatewayNeighbour* oldest = nullptr;
+
+    for (uint8_t i = 0; i < GATEWAY_MAX_NEIGHBOURS; i++) {
+        GatewayNeighbour& n = neighbours[i];
+        if (!n.inUse) {
+            if (!free) free = &n;
+            continue;
+        }
+        if (n.deviceId == deviceId) return &n;
+        if (!oldest || n.lastSeen < oldest->lastSeen) oldest = &n;
+    }
+
+    // A full table gives up the neighbour heard from least recently
+    GatewayNeighbour* n = free ? free : oldest;
+    memset(n, 0, sizeof(*n));
+    n->inUse = true;
+    n->deviceId = deviceId;
+    memcpy(n->addr, addr, sizeof(n->addr));
+    n->firstSeen = now;
+    n->day = now / 86400UL;
+    n->tempMin = 32767;
+    n->tempMax = -32768;
+    n->batteryMinMv = 0xFFFF;
+    return n;
+}
+
+bool BleGateway::processBeacon(const uint8_t* addr, int8_t rssi, const uint8_t* payload, uint8_t len, uint32_t now) {
+    BeaconStatus status;
+    if (!decodeBeaconPayload(payload, len, status)) return false;
+    if (status.deviceId == ownDeviceId) return true;
+
+    beaconsSeen++;
+    GatewayNeighbour* n = findOrAdd(status.deviceId, addr, now);
+    bool fresh = (n->lastSample == 0) || status.counter != n->status.counter;
+
+    n->rssi = rssi;
+    n->lastSeen = now;
+
+    // The beacon says how old its reading is
+    uint32_t age = (status.readingAgeMinutes == BEACON_AGE_UNKNOWN) ? 0 : status.readingAgeMinutes * 60UL;
+    uint32_t sampleTime = (now > age) ? now - age : now;
+
+    // The latch can change without a new reading (an ack cleared it)
+    fileAlerts(*n, status, fresh, fresh ? sampleTime : n->lastSample);
+    if (!fresh) return true;
+    n->status = status;
+    n->lastSample = sampleTime;
+
+    SDLib::File f = openPartition(n->deviceId, "SAMPLES.CSV",
+                                  "UnixTime,Battery_V,Temp_C,BeeState,AbscondRisk,Alerts,RSSI");
+    if (f) {
+        f.print(sampleTime); f.print(',');
+        f.print(status.batteryVoltage, 2); f.print(',');
+        f.print(status.temperature, 2); f.print(',');
+        f.print(status.beeState); f.print(',');
+        f.print(status.abscondingRisk); f.print(',');
+        f.print(status.alertFlags); f.print(',');
+        f.println(rssi);
+        f.close();
+    }
+
+    foldSample(*n, status, sampleTime);
+    return true;
+}
+
+void BleGateway::fileAlerts(GatewayNeighbour& n, const BeaconStatus& status, bool fresh, uint32_t sampleTime) {
+    uint8_t raised = 0;
+    if (fresh) raised = status.alertFlags & ~n.alertsOpen;
+
+    if (status.alertLatch == 0) {
+        // Acknowledged, or nothing raised since
+        n.latchFiled = 0;
+        n.ackDue = false;
+    } else if (!n.ackDue || status.alertSeq != n.latchSeq) {
+        // Raises that happened between scans. A new sequence without a
+        // new flag is a latched alert raised again after it cleared
+        uint8_t latched = status.alertLatch & ~n.latchFiled;
+        if (!latched && n.ackDue) latched = status.alertLatch;
+        raised |= latched & ~n.alertsOpen;
+        n.latchFiled |= status.alertLatch;
+        n.latchSeq = status.alertSeq;
+        n.ackDue = true;
+    }
+
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        uint8_t flag = 1 << bit;
+        if (!(raised & flag)) continue;
+        if (n.alertRaises < 255) n.alertRaises++;
+        n.alertsSeen |= flag;
+        n.alertsOpen |= flag;
+        logAlert(n.deviceId, sampleTime, flag, true);
+    }
+
+    // Cleared by the last reading; a raise from the latch that is no
+    // longer active closes straight away
+    uint8_t cleared = n.alertsOpen & ~status.alertFlags;
+    if (!fresh) cleared &= raised;
+    for (uint8_t bit = 0; bit < 8; bit++) {
+        uint8_t flag = 1 << bit;
+        if (!(cleared & flag)) continue;
+        n.alertsOpen &= ~flag;
+        logAlert(n.deviceId, sampleTime, flag, false);
+    }
+}
+
+void BleGateway::logAlert(uint8_t deviceId, uint32_t time, uint8_t flag, bool raised) {
+    SDLib::File f = openPartition(deviceId, "ALERTS.CSV", "UnixTime,Alert,Raised");
+    if (f) {
+        f.print(time); f.print(',');
+        f.print(flag); f.print(',');
+        f.println(raised ? 1 : 0);
+        f.close();
+    }
+}
+
+void BleGateway::foldSample(GatewayNeighbour& n, const BeaconStatus& status, uint32_t now) {
+    uint32_t day = now / 86400UL;
+    if (day != n.day) {
+        closeDay(n);
+        n.day = day;
+    }
+
+    int16_t temp = (int16_t)lroundf(status.temperature * 100.0f);
+    n.samples++;
+    n.tempMin = min(n.tempMin, temp);
+    n.tempMax = max(n.tempMax, temp);
+    n.tempSum += temp;
+    n.batteryMinMv = min(n.batteryMinMv, (uint16_t)lroundf(status.batteryVoltage * 1000.0f));
+    n.alertsSeen |= status.alertFlags;
+}
+
+void BleGateway::closeDay(GatewayNeighbour& n) {
+    if (n.samples > 0) {
+        SDLib::File f = openPartition(n.deviceId, "DAILY.CSV",
+            "DayStart,Samples,TempMin_C,TempMax_C,TempMean_C,BatteryMin_V,AlertRaises,AlertsSeen");
+        if (f) {
+            f.print(n.day * 86400UL); f.print(',');
+            f.print(n.samples); f.print(',');
+            f.print(n.tempMin / 100.0f, 2); f.print(',');
+            f.print(n.tempMax / 100.0f, 2); f.print(',');
+            f.print(n.tempSum / 100.0f / n.samples, 2); f.print(',');
+            f.print(n.batteryMinMv / 1000.0f, 2); f.print(',');
+            f.print(n.alertRaises); f.print(',');
+            f.println(n.alertsSeen);
+            f.close();
+        }
+    }
+
+    n.samples = 0;
+    n.tempMin = 32767;
+    n.tempMax = -32768;
+    n.tempSum = 0;
+    n.batteryMinMv = 0xFFFF;
+    n.alertRaises = 0;
+    n.alertsSeen = 0;
+}
+
+SDLib::File BleGateway::openPartition(uint8_t deviceId, const char* file, const char* header) {
+    char path[32];
+    snprintf(path, sizeof(path), GATEWAY_DIR "/N%03u", deviceId);
+    if (!SD.exists(path) && !SD.mkdir(path)) {
+        return SDLib::File();
+    }
+
+    // Opened for append; the header goes in when the file is created
+    snprintf(path, sizeof(path), GATEWAY_DIR "/N%03u/%s", deviceId, file);
+    bool isNew = !SD.exists(path);
+
+    SDLib::File f = SD.open(path, FILE_WRITE);
+    if (f && isNew) f.println(header);
+    return f;
+}
+
+// =============================================================================
+// ACKNOWLEDGEMENTS
+// =============================================================================
+
+bool BleGateway::hasAcks() const {
+    for (uint8_t i = 0; i < GATEWAY_MAX_NEIGHBOURS; i++) {
+        if (neighbours[i].inUse && neighbours[i].ackDue) return true;
+    }
+    return false;
+}
+
+uint8_t BleGateway::getAcks(BeaconAck* acks, uint8_t maxAcks) {
+    uint8_t due = 0;
+    for (uint8_t i = 0; i < GATEWAY_MAX_NEIGHBOURS; i++) {
+        if (neighbours[i].inUse && neighbours[i].ackDue) due++;
+    }
+
+    // A list that fits stays in one order, so the beacon is not
+    // restarted for nothing; a longer one moves on every call
+    if (due <= maxAcks) ackCursor = 0;
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < GATEWAY_MAX_NEIGHBOURS && count < maxAcks; i++) {
+        uint8_t slot = (ackCursor + i) % GATEWAY_MAX_NEIGHBOURS;
+        const GatewayNeighbour& n = neighbours[slot];
+        if (!n.inUse || !n.ackDue) continue;
+        acks[count].deviceId = n.deviceId;
+        acks[count].alertSeq = n.latchSeq;
+        count++;
+        if (due > maxAcks) ackCursor = (slot + 1) % GATEWAY_MAX_NEIGHBOURS;
+    }
+    return count;
+}
+
+// =============================================================================
+// STATUS
+// =============================================================================
+
+uint8_t BleGateway::getNeighbourCount() const {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < GATEWAY_MAX_NEIGHBOURS; i++) {
+        if (neighbours[i].inUse) count++;
+    }
+    return count;
+}
+
+const GatewayNeighbour* BleGateway::getNeighbour(uint8_t index) const {
+    for (uint8_t i = 0; i < GATEWAY_MAX_NEIGHBOURS; i++) {
+        if (!neighbours[i].inUse) continue;
+        if (index-- == 0) return &neighbours[i];
+    }
+    return nullptr;
+}
+
+bool BleGateway::isOnline(const GatewayNeighbour& n, uint32_t now) const {
+    return now - n.lastSeen <= GATEWAY_OFFLINE_PERIODS * periodMin * 60UL;
+}
+
+float BleGateway::estimateScanCurrentUa() const {
+    // mA x ms per period / ms per period = mA; x1000 for uA
+    return GATEWAY_SCAN_CURRENT_MA * GATEWAY_SCAN_WINDOW_MS * 1000.0f / (periodMin * 60000.0f);
+}
+
+void BleGateway::printStatus(uint32_t now) const {
+    Serial.print(F("Gateway: "));
+    if (!enabled) {
+        Serial.println(F("Off"));
+        return;
+    }
+    Serial.print(getNeighbourCount());
+    Serial.print(F(" neighbours, "));
+    Serial.print(scansCompleted);
+    Serial.print(F(" scans, "));
+    Serial.print(beaconsSeen);
+    Serial.print(F(" beacons, "));
+    Serial.print(reportsDropped);
+    Serial.println(F(" dropped"));
+
+    for (uint8_t i = 0; i < GATEWAY_MAX_NEIGHBOURS; i++) {
+        const GatewayNeighbour& n = neighbours[i];
+        if (!n.inUse) continue;
+        Serial.print(F("  #"));
+        Serial.print(n.deviceId);
+        Serial.print(isOnline(n, now) ? F(" online ") : F(" OFFLINE "));
+        Serial.print(n.status.temperature, 1);
+        Serial.print(F("C "));
+        Serial.print(n.status.batteryVoltage, 2);
+        Serial.print(F("V rssi "));
+        Serial.println(n.rssi);
+    }
+}
@@ -0,0 +1,143 @@
+/**
+ * BleGateway.h
+ * Apiary gateway: collects neighbour status beacons into per-device logs
+ *
+ * A node with the gateway role scans for GATEWAY_SCAN_WINDOW_MS every
+ * gateway period and records the status beacon (BleBeacon.h) of every
+ * other HiveGuard in range. Neighbours need no connection and no extra
+ * radio time: they are beaconing anyway, and the window covers two of
+ * their default beacon intervals. Each neighbour gets a partition on
+ * the gateway's SD card:
+ *
+ *   /GW/Nddd/SAMPLES.CSV  one line per new reading seen
+ *   /GW/Nddd/ALERTS.CSV   one line per alert flag raised or cleared
+ *   /GW/Nddd/DAILY.CSV    one summary line per day (min/max/mean)
+ *
+ * ddd is the neighbour's device id. The partitions show up in the file
+ * listing, so one connection to the gateway covers the whole apiary.
+ *
+ * A scan every period only samples the neighbours' alert flags, so the
+ * raises come from the beacon's alert latch as well (BleBeacon.h): an
+ * alert that came and went between scans is filed as a raise and a
+ * clear. The gateway acknowledges each latch it has filed in its own
+ * beacon, and beacons for that even with SET_BEACON off, until the
+ * neighbour's beacon shows the latch cleared.
+ *
+ * Reports arrive in the Bluefruit scan callback; they are only copied
+ * into a small ring there and filed by processReports().
+ */
+
+#ifndef BLE_GATEWAY_H
+#define BLE_GATEWAY_H
+
+#include "Config.h"
+#include "BleBeacon.h"
+
+#define GATEWAY_DIR "/GW"
+#define GATEWAY_MAX_NEIGHBOURS 24
+#define GATEWAY_REPORT_QUEUE 8
+#define GATEWAY_DEFAULT_PERIOD_MIN 15
+#define GATEWAY_MIN_PERIOD_MIN 1
+#define GATEWAY_SCAN_WINDOW_MS (2 * BEACON_DEFAULT_INTERVAL_MS + 1000)
+#define GATEWAY_SCAN_CURRENT_MA 6.0f     // Radio RX at 100% scan duty plus CPU
+#define GATEWAY_OFFLINE_PERIODS 3        // Missed scans before a neighbour counts as offline
+
+struct GatewayNeighbour {
+    bool inUse;
+    uint8_t deviceId;
+    uint8_t addr[6];
+    int8_t rssi;
+    uint32_t firstSeen;
+    uint32_t lastSeen;           // RTC time of the last beacon
+    uint32_t lastSample;         // RTC time of the last new reading
+    BeaconStatus status;
+
+    // Today's rollup
+    uint32_t day;                // Unix day number
+    uint16_t samples;
+    int16_t tempMin;             // x100
+    int16_t tempMax;
+    int32_t tempSum;
+    uint16_t batteryMinMv;
+    uint8_t alertRaises;
+    uint8_t alertsSeen;          // OR of every flag active today
+
+    // Alerts filed as raised and not yet cleared, and the latch filed
+    uint8_t alertsOpen;
+    uint8_t latchFiled;
+    uint8_t latchSeq;
+    bool ackDue;                 // Latch filed, not yet seen cleared
+};
+
+struct GatewayReport {
+    uint8_t addr[6];
+    int8_t rssi;
+    uint8_t len;
+    uint8_t payload[BEACON_PAYLOAD_SIZE];    // Acks from another gateway are dropped
+};
+
+class BleGateway {
+private:
+    bool enabled;
+    bool scanning;
+    uint8_t ownDeviceId;
+    uint8_t periodMin;
+    unsigned long lastScanStart;
+    uint32_t scansCompleted;
+    uint32_t beaconsSeen;
+
+    GatewayNeighbour neighbours[GATEWAY_MAX_NEIGHBOURS];
+
+    GatewayReport reports[GATEWAY_REPORT_QUEUE];
+    volatile uint8_t reportHead;
+    volatile uint8_t reportTail;
+    uint32_t reportsDropped;
+    uint8_t ackCursor;
+
+    GatewayNeighbour* findOrAdd(uint8_t deviceId, const uint8_t* addr, uint32_t now);
+    void fileAlerts(GatewayNeighbour& n, const BeaconStatus& status, bool fresh, uint32_t sampleTime);
+    void logAlert(uint8_t deviceId, uint32_t time, uint8_t flag, bool raised);
+    void foldSample(GatewayNeighbour& n, const BeaconStatus& status, uint32_t now);
+    void closeDay(GatewayNeighbour& n);
+    SDLib::File openPartition(uint8_t deviceId, const char* file, const char* header);
+    void startScan();
+    void stopScan();
+
+public:
+    BleGateway();
+
+    void setEnabled(bool on, uint8_t periodMinutes, uint8_t deviceId);
+    bool isEnabled() const { return enabled; }
+    bool isScanning() const { return scanning; }
+    uint8_t getPeriodMin() const { return periodMin; }
+
+    // Called from the scan callback; copies and returns immediately
+    void queueReport(const uint8_t* addr, int8_t rssi, const uint8_t* payload, uint8_t len);
+
+    // Starts and stops scan windows; call every loop pass
+    void update();
+
+    // Files reports queued by the scan callback; now is RTC time
+    bool hasPendingReports() const { return reportTail != reportHead; }
+    void processReports(uint32_t now);
+
+    // Files one beacon; returns false if it is not a HiveGuard status beacon
+    bool processBeacon(const uint8_t* addr, int8_t rssi, const uint8_t* payload, uint8_t len, uint32_t now);
+
+    // Latches to acknowledge in the gateway's own beacon, in turns when
+    // there are more than fit
+    bool hasAcks() const;
+    uint8_t getAcks(BeaconAck* acks, uint8_t maxAcks);
+
+    uint8_t getNeighbourCount() const;
+    const GatewayNeighbour* getNeighbour(uint8_t index) const;
+    bool isOnline(const GatewayNeighbour& n, uint32_t now) const;
+
+    // Average gateway current spent scanning, in microamps
+    float estimateScanCurrentUa() const;
+    void printStatus(uint32_t now) const;
+};
+
+extern BleGateway bleGateway;
+
+#endif // BLE_GATEWAY_H
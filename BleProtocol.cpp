@@ -0,0 +1,268 @@
+/**
+ * BleProtocol.cpp
+ * Binary response framing and TLV/CBOR encoding implementation
+ */
+
+#include "BleProtocol.h"
+#include "Utils.h"
+
+// CBOR major types and simple values
+#define CBOR_UINT 0
+#define CBOR_NEGINT 1
+#define CBOR_TEXT 3
+#define CBOR_ARRAY 4
+#define CBOR_MAP 5
+#define CBOR_INDEFINITE 31
+#define CBOR_FALSE 0xF4
+#define CBOR_TRUE 0xF5
+#define CBOR_FLOAT32 0xFA
+#define CBOR_BREAK 0xFF
+
+// =============================================================================
+// REQUEST PARSING
+// =============================================================================
+
+bool parseRequestHeader(uint8_t*& data, uint16_t& len, uint8_t& requestId, BleEncoding& encoding) {
+    requestId = 0;
+    encoding = BT_ENC_TLV;
+
+    if (len < 1 || data[0] != BT_FRAME_V2_MARKER) {
+        return len >= 1;   // Legacy single-byte command framing
+    }
+    if (len < 4) {
+        return false;
+    }
+
+    requestId = data[1];
+    encoding = (data[2] & BT_REQ_FLAG_CBOR) ? BT_ENC_CBOR : BT_ENC_TLV;
+    data += 3;
+    len -= 3;
+    return true;
+}
+
+// =============================================================================
+// RESPONSE WRITER
+// =============================================================================
+
+BleResponseWriter::BleResponseWriter(TransferSendFn fn, uint16_t maxPacketSize, uint8_t responseCode,
+                                     uint8_t reqId, BleEncoding enc) {
+    sendFn = fn;
+    maxPacket = min(maxPacketSize, (uint16_t)BT_CHUNK_SIZE);
+    pos = BT_FRAME_HEADER_SIZE;
+    seq = 0;
+    response = responseCode;
+    requestId = reqId;
+    encoding = enc;
+    totalBytes = 0;
+    framesSent = 0;
+    failed = false;
+
+    if (encoding == BT_ENC_CBOR) {
+        cborStart(CBOR_MAP);
+    }
+}
+
+void BleResponseWriter::writeBytes(const uint8_t* data, uint16_t len) {
+    // Values may straddle frames; the client reassembles the stream.
+    // After a refused frame nothing more is sent (see finish())
+    if (failed) return;
+    while (len > 0) {
+        if (pos >= maxPacket) {
+            flushFrame(false);
+            if (failed) return;
+        }
+        uint16_t n = min(len, (uint16_t)(maxPacket - pos));
+        memcpy(&frame[pos], data, n);
+        pos += n;
+        data += n;
+        len -= n;
+    }
+}
+
+void BleResponseWriter::flushFrame(bool last) {
+    frame[0] = response;
+    frame[1] = requestId;
+    frame[2] = (seq & BT_FRAME_SEQ_MASK) | (last ? BT_FRAME_LAST : 0);
+
+    if (!sendFn || !sendFn(frame, pos)) {
+        failed = true;
+    } else {
+        totalBytes += pos;
+        framesSent++;
+    }
+    seq++;
+    pos = BT_FRAME_HEADER_SIZE;
+}
+
+void BleResponseWriter::cborHead(uint8_t major, uint32_t value) {
+    uint8_t head[5];
+    if (value < 24) {
+        writeByte((major << 5) | value);
+    } else if (value <= 0xFF) {
+        writeByte((major << 5) | 24);
+        writeByte(value);
+    } else if (value <= 0xFFFF) {
+        head[0] = (major << 5) | 25;
+        head[1] = value >> 8;
+        head[2] = value & 0xFF;
+        writeBytes(head, 3);
+    } else {
+        head[0] = (major << 5) | 26;
+        head[1] = value >> 24;
+        head[2] = (value >> 16) & 0xFF;
+        head[3] = (value >> 8) & 0xFF;
+        head[4] = value & 0xFF;
+        writeBytes(head, 5);
+    }
+}
+
+void BleResponseWriter::cborStart(uint8_t major) {
+    // Additional info 31 is only an indefinite length, never a value of 31
+    writeByte((major << 5) | CBOR_INDEFINITE);
+}
+
+void BleResponseWriter::tlvHead(uint8_t tag, uint8_t len) {
+    uint8_t head[2] = { tag, len };
+    writeBytes(head, 2);
+}
+
+void BleResponseWriter::putU8(uint8_t tag, uint8_t value) {
+    if (encoding == BT_ENC_CBOR) {
+        cborHead(CBOR_UINT, tag);
+        cborHead(CBOR_UINT, value);
+        return;
+    }
+    tlvHead(tag, 1);
+    writeByte(value);
+}
+
+void BleResponseWriter::putU16(uint8_t tag, uint16_t value) {
+    if (encoding == BT_ENC_CBOR) {
+        cborHead(CBOR_UINT, tag);
+        cborHead(CBOR_UINT, value);
+        return;
+    }
+    uint8_t v[2];
+    putU16LE(v, value);
+    tlvHead(tag, 2);
+    writeBytes(v, 2);
+}
+
+void BleResponseWriter::putU32(uint8_t tag, uint32_t value) {
+    if (encoding == BT_ENC_CBOR) {
+        cborHead(CBOR_UINT, tag);
+        cborHead(CBOR_UINT, value);
+        return;
+    }
+    uint8_t v[4];
+    putU32LE(v, value);
+    tlvHead(tag, 4);
+    writeBytes(v, 4);
+}
+
+void BleResponseWriter::putI32(uint8_t tag, int32_t value) {
+    if (encoding == BT_ENC_CBOR) {
+        cborHead(CBOR_UINT, tag);
+        if (value < 0) {
+            cborHead(CBOR_NEGINT, (uint32_t)(-1 - value));
+        } else {
+            cborHead(CBOR_UINT, (uint32_t)value);
+        }
+        return;
+    }
+    uint8_t v[4];
+    putU32LE(v, (uint32_t)value);
+    tlvHead(tag, 4);
+    writeBytes(v, 4);
+}
+
+void BleResponseWriter::putF32(uint8_t tag, float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    if (encoding == BT_ENC_CBOR) {
+        cborHead(CBOR_UINT, tag);
+        uint8_t v[5] = { CBOR_FLOAT32, (uint8_t)(bits >> 24), (uint8_t)(bits >> 16),
+                         (uint8_t)(bits >> 8), (uint8_t)bits };
+        writeBytes(v, 5);
+        return;
+    }
+    uint8_t v[4];
+    putU32LE(v, bits);
+    tlvHead(tag, 4);
+    writeBytes(v, 4);
+}
+
+void BleResponseWriter::putBool(uint8_t tag, bool value) {
+    if (encoding == BT_ENC_CBOR) {
+        cborHead(CBOR_UINT, tag);
+        writeByte(value ? CBOR_TRUE : CBOR_FALSE);
+        return;
+    }
+    tlvHead(tag, 1);
+    writeByte(value ? 1 : 0);
+}
+
+void BleResponseWriter::putStr(uint8_t tag, const char* value) {
+    uint16_t len = value ? min(strlen(value), (size_t)255) : 0;
+
+    if (encoding == BT_ENC_CBOR) {
+        cborHead(CBOR_UINT, tag);
+        cborHead(CBOR_TEXT, len);
+    } else {
+        tlvHead(tag, len);
+    }
+    writeBytes((const uint8_t*)value, len);
+}
+
+void BleResponseWriter::beginList(uint8_t tag) {
+    if (encoding == BT_ENC_CBOR) {
+        cborHead(CBOR_UINT, tag);
+        cborStart(CBOR_ARRAY);
+        return;
+    }
+    tlvHead(tag, 0);
+}
+
+void BleResponseWriter::beginRecord() {
+    if (encoding == BT_ENC_CBOR) {
+        cborStart(CBOR_MAP);
+        return;
+    }
+    tlvHead(BT_TAG_RECORD, 0);
+}
+
+void BleResponseWriter::endRecord() {
+    if (encoding == BT_ENC_CBOR) {
+        writeByte(CBOR_BREAK);
+    }
+    // TLV records end implicitly at the next record or list end
+}
+
+void BleResponseWriter::endList() {
+    if (encoding == BT_ENC_CBOR) {
+        writeByte(CBOR_BREAK);
+        return;
+    }
+    tlvHead(BT_TAG_END, 0);
+}
+
+bool BleResponseWriter::finish() {
+    if (!failed) {
+        if (encoding == BT_ENC_CBOR) {
+            writeByte(CBOR_BREAK);
+        }
+        if (!failed) flushFrame(true);
+        if (!failed) return true;
+    }
+
+    // The client holds a response with a hole in it. End it with an error
+    // frame so it is thrown away rather than decoded. The notify queue
+    // holds bare frames behind a full queue (BleQueue.h), so one attempt
+    // is enough and nothing waits here for the link
+    uint8_t abortFrame[BT_FRAME_HEADER_SIZE] = {
+        BT_RESP_ERROR, requestId, (uint8_t)((seq & BT_FRAME_SEQ_MASK) | BT_FRAME_LAST)
+    };
+    if (sendFn) sendFn(abortFrame, sizeof(abortFrame));
+    return false;
+}
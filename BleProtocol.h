@@ -0,0 +1,100 @@
+/**
+ * BleProtocol.h
+ * Versioned binary response framing and TLV/CBOR encoding for BLE
+ *
+ * Request (v2):  [0xA5][requestId][flags][command][args...]
+ *                flags bit0 = reply in CBOR instead of TLV
+ * Request (v1):  [command][args...]  - answered with requestId 0, TLV
+ *
+ * Response frame: [response][requestId][control][payload...]
+ *                control bit7 = last frame, bits0-6 = frame sequence
+ * The payloads of all frames of one response form a single byte stream,
+ * so a response can be any length. Field layout is defined in BleSchema.h.
+ *
+ * The frame sequence counts modulo 128 and wraps from 127 to 0 on long
+ * responses. Notifications arrive in order on one link, so the client
+ * only checks that each frame is the previous one + 1 (mod 128).
+ *
+ * If a frame cannot be queued part way through, the rest of the response
+ * is dropped and a bare [BT_RESP_ERROR][requestId][last | seq] frame ends
+ * it instead; the client discards what it reassembled for that request.
+ *
+ * TLV stream : repeated [tag][len][value]; lists are [listTag][0] followed
+ *              by records, each opened with [BT_TAG_RECORD][0] and running
+ *              to the next record marker; [BT_TAG_END][0] closes the list
+ * CBOR stream: one indefinite-length map keyed by tag; lists are
+ *              indefinite arrays of indefinite maps
+ */
+
+#ifndef BLE_PROTOCOL_H
+#define BLE_PROTOCOL_H
+
+#include "Bluetooth.h"
+#include "BleSchema.h"
+
+#define BT_FRAME_V2_MARKER 0xA5
+#define BT_FRAME_HEADER_SIZE 3
+#define BT_FRAME_LAST 0x80
+#define BT_REQ_FLAG_CBOR 0x01
+#define BT_FRAME_SEQ_MASK 0x7F
+
+enum BleEncoding {
+    BT_ENC_TLV = 0,
+    BT_ENC_CBOR = 1
+};
+
+// =============================================================================
+// RESPONSE WRITER
+// =============================================================================
+
+class BleResponseWriter {
+private:
+    TransferSendFn sendFn;
+    uint8_t frame[BT_CHUNK_SIZE];
+    uint16_t maxPacket;
+    uint16_t pos;
+    uint8_t seq;
+    uint8_t response;
+    uint8_t requestId;
+    BleEncoding encoding;
+
+    uint32_t totalBytes;
+    uint16_t framesSent;
+    bool failed;                 // A frame was refused; the rest is dropped
+
+    void writeBytes(const uint8_t* data, uint16_t len);
+    void writeByte(uint8_t b) { writeBytes(&b, 1); }
+    void flushFrame(bool last);
+    void cborHead(uint8_t major, uint32_t value);
+    void cborStart(uint8_t major);   // Indefinite-length map or array
+    void tlvHead(uint8_t tag, uint8_t len);
+
+public:
+    BleResponseWriter(TransferSendFn fn, uint16_t maxPacketSize, uint8_t responseCode,
+                      uint8_t reqId, BleEncoding enc);
+
+    void putU8(uint8_t tag, uint8_t value);
+    void putU16(uint8_t tag, uint16_t value);
+    void putU32(uint8_t tag, uint32_t value);
+    void putI32(uint8_t tag, int32_t value);
+    void putF32(uint8_t tag, float value);
+    void putBool(uint8_t tag, bool value);
+    void putStr(uint8_t tag, const char* value);
+
+    void beginList(uint8_t tag);
+    void beginRecord();
+    void endRecord();
+    void endList();
+
+    // Sends the final frame, or the error frame if one failed to send;
+    // returns false in that case
+    bool finish();
+
+    uint32_t getTotalBytes() const { return totalBytes; }
+    uint16_t getFrameCount() const { return framesSent; }
+};
+
+// Parses the v2 request header in place. Returns false for malformed frames.
+bool parseRequestHeader(uint8_t*& data, uint16_t& len, uint8_t& requestId, BleEncoding& encoding);
+
+#endif // BLE_PROTOCOL_H
@@ -0,0 +1,173 @@
+/**
+ * BleQueue.cpp
+ * Command ring and notification queue implementation
+ */
+
+#include "BleQueue.h"
+
+// =============================================================================
+// OUTBOUND NOTIFICATIONS
+// =============================================================================
+
+BleNotifyQueue::BleNotifyQueue() {
+    sink = nullptr;
+    head = 0;
+    count = 0;
+    overflowCount = 0;
+    txComplete = false;
+    lastAttempt = 0;
+    memset(lengths, 0, sizeof(lengths));
+    memset(overflowLengths, 0, sizeof(overflowLengths));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool BleNotifyQueue::enqueue(const uint8_t* data, uint16_t len, uint8_t limit) {
+    if (!sink || len == 0 || len > BT_NOTIFY_SLOT_SIZE) return false;
+
+    if (count > 0) pump();
+
+    // Straight through only when nothing is waiting, so order is kept
+    if (count == 0 && sink(data, len)) {
+        stats.sent++;
+        return true;
+    }
+
+    if (count >= limit) {
+        stats.rejected++;
+        return false;
+    }
+
+    uint8_t slot = (head + count) % BT_NOTIFY_QUEUE_DEPTH;
+    memcpy(slots[slot], data, len);
+    lengths[slot] = len;
+    count++;
+    stats.queued++;
+    stats.highWater = max(stats.highWater, count);
+    return true;
+}
+
+bool BleNotifyQueue::send(const uint8_t* data, uint16_t len) {
+    return enqueue(data, len, BT_NOTIFY_QUEUE_DEPTH - BT_NOTIFY_RESERVED_SLOTS);
+}
+
+bool BleNotifyQueue::sendOrDrop(const uint8_t* data, uint16_t len) {
+    if (enqueue(data, len, BT_NOTIFY_QUEUE_DEPTH)) return true;
+
+    // The queue is full. Frames this short end a response, so they wait
+    // here and move into the queue, in order, as it drains
+    if (len <= BT_NOTIFY_OVERFLOW_SIZE && overflowCount < BT_NOTIFY_OVERFLOW_SLOTS) {
+        memcpy(overflow[overflowCount], data, len);
+        overflowLengths[overflowCount] = len;
+        overflowCount++;
+        stats.queued++;
+        return true;
+    }
+    stats.dropped++;
+    return false;
+}
+
+void BleNotifyQueue::promoteOverflow() {
+    uint8_t moved = 0;
+    while (moved < overflowCount && count < BT_NOTIFY_QUEUE_DEPTH) {
+        uint8_t slot = (head + count) % BT_NOTIFY_QUEUE_DEPTH;
+        memcpy(slots[slot], overflow[moved], overflowLengths[moved]);
+        lengths[slot] = overflowLengths[moved];
+        count++;
+        moved++;
+    }
+    if (moved == 0) return;
+    overflowCount -= moved;
+    memmove(overflow, overflow[moved], overflowCount * BT_NOTIFY_OVERFLOW_SIZE);
+    memmove(overflowLengths, &overflowLengths[moved], overflowCount);
+}
+
+void BleNotifyQueue::pump() {
+    if (count == 0 || !sink) return;
+
+    // Wait for a TX-complete event, with a slow poll in case one was missed
+    unsigned long now = millis();
+    if (!txComplete && now - lastAttempt < BT_NOTIFY_RETRY_MS) return;
+    txComplete = false;
+    lastAttempt = now;
+
+    // Overflow frames take each freed slot, so the queue never empties
+    // ahead of them and nothing sent later can overtake them
+    while (count > 0) {
+        if (!sink(slots[head], lengths[head])) break;
+        head = (head + 1) % BT_NOTIFY_QUEUE_DEPTH;
+        count--;
+        stats.sent++;
+        stats.retried++;
+        promoteOverflow();
+    }
+}
+
+void BleNotifyQueue::clear() {
+    stats.dropped += count + overflowCount;
+    head = 0;
+    count = 0;
+    overflowCount = 0;
+    txComplete = false;
+}
+
+void BleNotifyQueue::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+    stats.highWater = count;
+}
+
+// =============================================================================
+// INBOUND COMMANDS
+// =============================================================================
+
+BleCommandQueue::BleCommandQueue() {
+    head = 0;
+    tail = 0;
+    accepted = 0;
+    dropped = 0;
+    rejected = 0;
+    memset(lengths, 0, sizeof(lengths));
+    memset(oversize, 0, sizeof(oversize));
+}
+
+bool BleCommandQueue::push(const uint8_t* data, uint16_t len) {
+    uint8_t next = (head + 1) % BT_COMMAND_QUEUE_DEPTH;
+    if (next == tail || len == 0) {
+        dropped++;
+        return false;
+    }
+
+    oversize[head] = len > BT_COMMAND_MAX_LEN;
+    if (oversize[head]) {
+        rejected++;
+        len = BT_COMMAND_MAX_LEN;
+    } else {
+        accepted++;
+    }
+    memcpy(commands[head], data, len);
+    lengths[head] = len;
+    head = next;   // Publish only after the copy is complete
+    return true;
+}
+
+uint16_t BleCommandQueue::pop(uint8_t* out, bool& tooLong) {
+    // A clear() between reading tail and moving it would bring the
+    // cleared command back, or drop the next one
+    noInterrupts();
+    if (tail == head) {
+        interrupts();
+        return 0;
+    }
+
+    uint16_t len = lengths[tail];
+    tooLong = oversize[tail];
+    memcpy(out, commands[tail], len);
+    tail = (tail + 1) % BT_COMMAND_QUEUE_DEPTH;
+    interrupts();
+    return len;
+}
+
+void BleCommandQueue::clear() {
+    noInterrupts();
+    tail = head;
+    interrupts();
+}
@@ -0,0 +1,130 @@
+/**
+ * BleQueue.h
+ * Inbound command ring and outbound notification queue for BLE
+ *
+ * Commands arrive in the Bluefruit callback task. They are copied into a
+ * small ring and executed from BluetoothManager::update(), so several
+ * requests (each tagged with its own requestId, see BleProtocol.h) can be
+ * outstanding without the callback racing the main loop.
+ *
+ * Outbound notifications go through BleNotifyQueue. When the SoftDevice
+ * TX buffers are full the packet is held and resent, in order, after the
+ * next BLE_GATTS_EVT_HVN_TX_COMPLETE. send() refuses a packet once all
+ * but BT_NOTIFY_RESERVED_SLOTS slots are taken; that refusal is the
+ * back-pressure signal to jobs and transfers, which already retry on
+ * false. The reserve lets a response to a command that arrives during a
+ * long stream still get through. Bare response frames (a header-only
+ * reply, or the error frame that ends a refused response) are not lost
+ * even then: they wait in a few overflow slots and join the queue behind
+ * what is already in it.
+ */
+
+#ifndef BLE_QUEUE_H
+#define BLE_QUEUE_H
+
+#include "Config.h"
+#include "BleTransfer.h"
+
+#define BT_NOTIFY_QUEUE_DEPTH 16
+#define BT_NOTIFY_SLOT_SIZE 244          // Largest notification payload at the maximum MTU
+#define BT_NOTIFY_RETRY_MS 20            // Poll even if no TX-complete event was seen
+#define BT_NOTIFY_RESERVED_SLOTS 4       // Kept for response frames while a job streams
+#define BT_NOTIFY_OVERFLOW_SLOTS 4       // Bare frames held behind a full queue
+#define BT_NOTIFY_OVERFLOW_SIZE 3        // [response][requestId][control]
+#define BT_COMMAND_QUEUE_DEPTH 8
+#define BT_COMMAND_MAX_LEN 64            // Command characteristic length
+
+struct NotifyQueueStats {
+    uint32_t sent;                // Accepted by the stack, directly or from the queue
+    uint32_t queued;              // Held because the stack pushed back
+    uint32_t retried;             // Queued packets later accepted
+    uint32_t rejected;            // Refused with the queue full (producer told to back off)
+    uint32_t dropped;             // Lost: the producer could not retry
+    uint8_t highWater;
+};
+
+// =============================================================================
+// OUTBOUND NOTIFICATIONS
+// =============================================================================
+
+class BleNotifyQueue {
+private:
+    TransferSendFn sink;
+    uint8_t slots[BT_NOTIFY_QUEUE_DEPTH][BT_NOTIFY_SLOT_SIZE];
+    uint8_t lengths[BT_NOTIFY_QUEUE_DEPTH];
+    uint8_t head;
+    uint8_t count;
+    uint8_t overflow[BT_NOTIFY_OVERFLOW_SLOTS][BT_NOTIFY_OVERFLOW_SIZE];
+    uint8_t overflowLengths[BT_NOTIFY_OVERFLOW_SLOTS];
+    uint8_t overflowCount;
+    volatile bool txComplete;
+    unsigned long lastAttempt;
+    NotifyQueueStats stats;
+
+    bool enqueue(const uint8_t* data, uint16_t len, uint8_t limit);
+    void promoteOverflow();
+
+public:
+    BleNotifyQueue();
+
+    void setSink(TransferSendFn fn) { sink = fn; }
+
+    // Sends now or queues. False when only the reserved slots are left.
+    bool send(const uint8_t* data, uint16_t len);
+
+    // For producers that cannot retry; may use the reserved slots, keeps
+    // bare frames in the overflow slots, and counts the loss when refused
+    bool sendOrDrop(const uint8_t* data, uint16_t len);
+
+    // Resends held packets; call from the main loop
+    void pump();
+
+    // Safe from the BLE event callback
+    void onTxComplete() { txComplete = true; }
+
+    void clear();
+    uint8_t getPending() const { return count + overflowCount; }
+    uint8_t getFreeSlots() const { return BT_NOTIFY_QUEUE_DEPTH - count; }
+    const NotifyQueueStats& getStats() const { return stats; }
+    void resetStats();
+};
+
+// =============================================================================
+// INBOUND COMMANDS
+// =============================================================================
+
+// Single producer (write callback), single consumer (main loop). The
+// disconnect callback empties the ring from the producer side, so pop()
+// and clear() both move tail with interrupts off.
+// A write longer than BT_COMMAND_MAX_LEN is never executed: its start is
+// kept, so the request header can be read, and it pops as oversize for
+// the consumer to answer with an error.
+class BleCommandQueue {
+private:
+    uint8_t commands[BT_COMMAND_QUEUE_DEPTH][BT_COMMAND_MAX_LEN];
+    uint8_t lengths[BT_COMMAND_QUEUE_DEPTH];
+    bool oversize[BT_COMMAND_QUEUE_DEPTH];
+    volatile uint8_t head;
+    volatile uint8_t tail;
+    uint32_t accepted;
+    uint32_t dropped;
+    uint32_t rejected;
+
+public:
+    BleCommandQueue();
+
+    bool push(const uint8_t* data, uint16_t len);
+
+    // Copies the oldest command into out; returns its length, 0 if empty.
+    // tooLong is set for a write that must be refused, not executed
+    uint16_t pop(uint8_t* out, bool& tooLong);
+
+    // Drops everything queued; safe from the BLE callbacks
+    void clear();
+    bool isEmpty() const { return head == tail; }
+    uint32_t getAccepted() const { return accepted; }
+    uint32_t getDropped() const { return dropped; }
+    uint32_t getRejected() const { return rejected; }
+};
+
+#endif // BLE_QUEUE_H
@@ -0,0 +1,371 @@
+/**
+ * BleSchema.h
+ * Field schema for the binary BLE protocol
+ *
+ * Every response message is a list of X(msg, tag, name, type) entries.
+ * The firmware expands them into tag enums; host tools include this same
+ * header with BLE_SCHEMA_TABLES defined to get name/type lookup tables,
+ * so both sides decode from one definition. BT_SCHEMA_LISTS names the
+ * message each list's records follow. No Arduino dependencies here.
+ *
+ * Adding a field: append a new tag to the message. Never reuse or renumber
+ * a tag - old clients skip tags they do not know.
+ */
+
+#ifndef BLE_SCHEMA_H
+#define BLE_SCHEMA_H
+
+#include <stdint.h>
+
+#define BT_PROTOCOL_VERSION 2
+
+// Value encodings (TLV lengths are implied by the type, strings carry their own)
+enum BleFieldType {
+    BT_FT_U8 = 0,
+    BT_FT_U16 = 1,
+    BT_FT_U32 = 2,
+    BT_FT_I32 = 3,
+    BT_FT_F32 = 4,
+    BT_FT_BOOL = 5,
+    BT_FT_STR = 6,
+    BT_FT_LIST = 7       // Followed by records, each opened by BT_TAG_RECORD
+};
+
+// Structural tags shared by every message
+#define BT_TAG_RECORD 0xFE   // Starts the next list entry
+#define BT_TAG_END 0xFF      // Closes the current list
+
+// =============================================================================
+// MESSAGE SCHEMAS
+// =============================================================================
+
+#define BT_SCHEMA_CURRENT_DATA(X) \
+    X(CD, 0x01, timestamp,    U32) \
+    X(CD, 0x02, temperature,  F32) \
+    X(CD, 0x03, humidity,     F32) \
+    X(CD, 0x04, pressure,     F32) \
+    X(CD, 0x05, dominantFreq, U16) \
+    X(CD, 0x06, soundLevel,   U8)  \
+    X(CD, 0x07, beeState,     U8)  \
+    X(CD, 0x08, battery,      F32) \
+    X(CD, 0x09, alertFlags,   U8)
+
+#define BT_SCHEMA_DEVICE_INFO(X) \
+    X(DI, 0x01, protocol,      U8)   \
+    X(DI, 0x02, device,        STR)  \
+    X(DI, 0x03, deviceId,      U8)   \
+    X(DI, 0x04, firmware,      STR)  \
+    X(DI, 0x05, uptime,        U32)  \
+    X(DI, 0x06, btEnabled,     BOOL) \
+    X(DI, 0x07, btConnections, U32)  \
+    X(DI, 0x08, freeMemory,    U32)  \
+    X(DI, 0x09, sdCard,        BOOL)
+
+// Tags 1-15 are the BT_CMD_SET_SETTING ids, so a client can echo them back.
+// imageCrc is the CRC32 of the encoded settings image (Settings.h).
+#define BT_SCHEMA_SETTINGS(X) \
+    X(ST, 1,  tempOffset,       F32)  \
+    X(ST, 2,  humidityOffset,   F32)  \
+    X(ST, 3,  audioSensitivity, U8)   \
+    X(ST, 4,  queenFreqMin,     U16)  \
+    X(ST, 5,  queenFreqMax,     U16)  \
+    X(ST, 6,  swarmFreqMin,     U16)  \
+    X(ST, 7,  swarmFreqMax,     U16)  \
+    X(ST, 8,  logInterval,      U8)   \
+    X(ST, 9,  displayTimeout,   U8)   \
+    X(ST, 10, fieldMode,        BOOL) \
+    X(ST, 11, tempMin,          F32)  \
+    X(ST, 12, tempMax,          F32)  \
+    X(ST, 13, humidityMin,      F32)  \
+    X(ST, 14, humidityMax,      F32)  \
+    X(ST, 15, stressThreshold,  U8)   \
+    X(ST, 16, beeType,          U8)   \
+    X(ST, 0x20, imageVersion,   U8)   \
+    X(ST, 0x21, imageCrc,       U32)
+
+// Paging: pass nextKey/nextTie back as the continuation token while more is set
+#define BT_SCHEMA_FILE_LIST(X) \
+    X(FL, 0x10, files,   LIST) \
+    X(FL, 0x11, total,   U32)  \
+    X(FL, 0x12, more,    BOOL) \
+    X(FL, 0x13, nextKey, U32)  \
+    X(FL, 0x14, nextTie, U32)
+
+#define BT_SCHEMA_FILE_ENTRY(X) \
+    X(FE, 0x01, name,      STR) \
+    X(FE, 0x02, size,      U32) \
+    X(FE, 0x03, firstTime, U32) \
+    X(FE, 0x04, lastTime,  U32) \
+    X(FE, 0x05, records,   U32)
+
+#define BT_SCHEMA_FILE_INFO(X) \
+    X(FI, 0x01, name,   STR) \
+    X(FI, 0x02, size,   U32) \
+    X(FI, 0x03, exists, BOOL)
+
+#define BT_SCHEMA_PRESET_LIST(X) \
+    X(PL, 0x10, presets, LIST)
+
+#define BT_SCHEMA_PRESET(X) \
+    X(PR, 0x01, id,          U8)  \
+    X(PR, 0x02, name,        STR) \
+    X(PR, 0x03, description, STR)
+
+#define BT_SCHEMA_DAILY_SUMMARY(X) \
+    X(DS, 0x01, date,        U32) \
+    X(DS, 0x02, avgTemp,     F32) \
+    X(DS, 0x03, avgHumidity, F32) \
+    X(DS, 0x04, alerts,      U16) \
+    X(DS, 0x05, beeActivity, U8)
+
+// Newest first; pass nextBefore back as beforeSeq while more is set
+#define BT_SCHEMA_ALERT_LIST(X) \
+    X(AL, 0x10, alerts,     LIST) \
+    X(AL, 0x11, more,       BOOL) \
+    X(AL, 0x12, nextBefore, U32)  \
+    X(AL, 0x13, active,     U8)   \
+    X(AL, 0x14, stored,     U32)
+
+#define BT_SCHEMA_ALERT(X) \
+    X(AE, 0x01, time,         U32)  \
+    X(AE, 0x02, type,         U8)   \
+    X(AE, 0x03, value,        F32)  \
+    X(AE, 0x04, seq,          U32)  \
+    X(AE, 0x05, raised,       BOOL) \
+    X(AE, 0x06, active,       U8)   \
+    X(AE, 0x07, temperature,  F32)  \
+    X(AE, 0x08, humidity,     F32)  \
+    X(AE, 0x09, battery,      F32)  \
+    X(AE, 0x0A, dominantFreq, U16)  \
+    X(AE, 0x0B, soundLevel,   U8)   \
+    X(AE, 0x0C, beeState,     U8)
+
+#define BT_SCHEMA_AUDIO_CALIBRATION(X) \
+    X(AC, 0x01, avgFreq,  F32) \
+    X(AC, 0x02, avgLevel, F32) \
+    X(AC, 0x03, samples,  U16)
+
+// BT_CMD_GET_QUEUE_STATS, see BleQueue.h
+#define BT_SCHEMA_QUEUE_STATS(X) \
+    X(QS, 0x01, sent,        U32) \
+    X(QS, 0x02, queued,      U32) \
+    X(QS, 0x03, retried,     U32) \
+    X(QS, 0x04, rejected,    U32) \
+    X(QS, 0x05, dropped,     U32) \
+    X(QS, 0x06, highWater,   U8)  \
+    X(QS, 0x07, pending,     U8)  \
+    X(QS, 0x08, cmdAccepted, U32) \
+    X(QS, 0x09, cmdDropped,  U32) \
+    X(QS, 0x0A, cmdTooLong,  U32)
+
+// BT_CMD_GET_NEIGHBOURS, see BleGateway.h
+#define BT_SCHEMA_NEIGHBOUR_LIST(X) \
+    X(NL, 0x10, neighbours,   LIST) \
+    X(NL, 0x11, enabled,      BOOL) \
+    X(NL, 0x12, periodMin,    U8)   \
+    X(NL, 0x13, scanCurrent,  F32)
+
+#define BT_SCHEMA_NEIGHBOUR(X) \
+    X(NB, 0x01, deviceId,       U8)   \
+    X(NB, 0x02, online,         BOOL) \
+    X(NB, 0x03, lastSeen,       U32)  \
+    X(NB, 0x04, lastSample,     U32)  \
+    X(NB, 0x05, rssi,           I32)  \
+    X(NB, 0x06, temperature,    F32)  \
+    X(NB, 0x07, battery,        F32)  \
+    X(NB, 0x08, beeState,       U8)   \
+    X(NB, 0x09, abscondingRisk, U8)   \
+    X(NB, 0x0A, alertFlags,     U8)
+
+// BT_CMD_GET_POWER_PROFILE, see PhaseProfiler.h. Currents in mA.
+#define BT_SCHEMA_POWER_PROFILE(X) \
+    X(PP, 0x10, phases,     LIST) \
+    X(PP, 0x11, cycles,     U32)  \
+    X(PP, 0x12, firstTime,  U32)  \
+    X(PP, 0x13, lastTime,   U32)  \
+    X(PP, 0x14, avgCurrent, F32)  \
+    X(PP, 0x15, mAhPerDay,  F32)  \
+    X(PP, 0x16, measured,   BOOL) \
+    X(PP, 0x17, interval,   U8)   \
+    X(PP, 0x18, adaptive,   BOOL) \
+    X(PP, 0x19, activity,   U8)   \
+    X(PP, 0x1A, budgetMah,  U16)  \
+    X(PP, 0x1B, bootMs,     F32)  \
+    X(PP, 0x1C, fastBoots,  U32)  \
+    X(PP, 0x1D, fastBootMs, F32)  \
+    X(PP, 0x1E, domainsOn,  U8)   \
+    X(PP, 0x1F, domainMa,   F32)
+
+#define BT_SCHEMA_PHASE(X) \
+    X(PH, 0x01, phase,     U8)  \
+    X(PH, 0x02, name,      STR) \
+    X(PH, 0x03, count,     U32) \
+    X(PH, 0x04, avgMs,     F32) \
+    X(PH, 0x05, p90Ms,     U32) \
+    X(PH, 0x06, maxMs,     F32) \
+    X(PH, 0x07, current,   F32) \
+    X(PH, 0x08, mAhPerDay, F32)
+
+// BT_CMD_SIMULATE_POWER, see PowerSimulator.h
+#define BT_SCHEMA_POWER_SIM(X) \
+    X(PS, 0x10, phases,      LIST) \
+    X(PS, 0x11, curve,       LIST) \
+    X(PS, 0x12, days,        U16)  \
+    X(PS, 0x13, intervalS,   U32)  \
+    X(PS, 0x14, wakes,       U32)  \
+    X(PS, 0x15, flushes,     U32)  \
+    X(PS, 0x16, totalMah,    F32)  \
+    X(PS, 0x17, avgCurrent,  F32)  \
+    X(PS, 0x18, usableMah,   F32)  \
+    X(PS, 0x19, daysToEmpty, F32)  \
+    X(PS, 0x1A, measured,    BOOL) \
+    X(PS, 0x1B, runMs,       U32)  \
+    X(PS, 0x1C, maxStepUs,   U32)
+
+#define BT_SCHEMA_SIM_PHASE(X) \
+    X(SP, 0x01, phase,  U8)  \
+    X(SP, 0x02, name,   STR) \
+    X(SP, 0x03, hours,  F32) \
+    X(SP, 0x04, mAh,    F32)
+
+#define BT_SCHEMA_SIM_DAY(X) \
+    X(SC, 0x01, day, U16) \
+    X(SC, 0x02, soc, U8)
+
+// X(msg, list, recordMsg): records of msg's list field follow recordMsg
+#define BT_SCHEMA_LISTS(X) \
+    X(FL, files,      FE) \
+    X(PL, presets,    PR) \
+    X(AL, alerts,     AE) \
+    X(NL, neighbours, NB) \
+    X(PP, phases,     PH) \
+    X(PS, phases,     SP) \
+    X(PS, curve,      SC)
+
+#define BT_SCHEMA_ALL(X) \
+    BT_SCHEMA_CURRENT_DATA(X) \
+    BT_SCHEMA_DEVICE_INFO(X) \
+    BT_SCHEMA_SETTINGS(X) \
+    BT_SCHEMA_FILE_LIST(X) \
+    BT_SCHEMA_FILE_ENTRY(X) \
+    BT_SCHEMA_FILE_INFO(X) \
+    BT_SCHEMA_PRESET_LIST(X) \
+    BT_SCHEMA_PRESET(X) \
+    BT_SCHEMA_DAILY_SUMMARY(X) \
+    BT_SCHEMA_ALERT_LIST(X) \
+    BT_SCHEMA_ALERT(X) \
+    BT_SCHEMA_AUDIO_CALIBRATION(X) \
+    BT_SCHEMA_QUEUE_STATS(X) \
+    BT_SCHEMA_NEIGHBOUR_LIST(X) \
+    BT_SCHEMA_NEIGHBOUR(X) \
+    BT_SCHEMA_POWER_PROFILE(X) \
+    BT_SCHEMA_PHASE(X) \
+    BT_SCHEMA_POWER_SIM(X) \
+    BT_SCHEMA_SIM_PHASE(X) \
+    BT_SCHEMA_SIM_DAY(X)
+
+// =============================================================================
+// LIVE STREAM FIELDS
+// =============================================================================
+
+// X(bit, name, scale): streamed as round(value * scale) in zigzag varints.
+// The bit is the position in the 64-bit subscription field mask.
+#define BT_STREAM_FIELDS(X) \
+    X(0,  temperature,        100)  \
+    X(1,  humidity,           100)  \
+    X(2,  pressure,           10)   \
+    X(3,  batteryVoltage,     1000) \
+    X(4,  alertFlags,         1)    \
+    X(5,  dominantFreq,       1)    \
+    X(6,  soundLevel,         1)    \
+    X(7,  beeState,           1)    \
+    X(8,  bandEnergy0_200Hz,  1000) \
+    X(9,  bandEnergy200_400Hz, 1000) \
+    X(10, bandEnergy400_600Hz, 1000) \
+    X(11, bandEnergy600_800Hz, 1000) \
+    X(12, bandEnergy800_1000Hz, 1000) \
+    X(13, bandEnergy1000PlusHz, 1000) \
+    X(14, spectralCentroid,   1)    \
+    X(15, peakToAvgRatio,     100)  \
+    X(16, harmonicity,        1000) \
+    X(17, queenDetected,      1)    \
+    X(18, abscondingRisk,     1)    \
+    X(19, activityIncrease,   100)  \
+    X(20, spectralRolloff,    1)    \
+    X(21, spectralFlux,       1000) \
+    X(22, zeroCrossingRate,   1000) \
+    X(23, spectralSpread,     1)    \
+    X(24, spectralSkewness,   100)  \
+    X(25, spectralKurtosis,   100)  \
+    X(26, shortTermEnergy,    1000) \
+    X(27, midTermEnergy,      1000) \
+    X(28, longTermEnergy,     1000) \
+    X(29, energyEntropy,      1000) \
+    X(30, hourOfDaySin,       1000) \
+    X(31, hourOfDayCos,       1000) \
+    X(32, dayOfYearSin,       1000) \
+    X(33, dayOfYearCos,       1000) \
+    X(34, contextFlags,       1)    \
+    X(35, ambientNoiseLevel,  10)   \
+    X(36, signalQuality,      1)    \
+    X(37, analysisValid,      1)
+
+// =============================================================================
+// GENERATED DECLARATIONS
+// =============================================================================
+
+// BT_CD_temperature, BT_ST_logInterval, ...
+#define BT_SCHEMA_DECLARE_TAG(msg, tag, name, type) BT_##msg##_##name = tag,
+enum BleSchemaTag {
+    BT_SCHEMA_ALL(BT_SCHEMA_DECLARE_TAG)
+};
+#undef BT_SCHEMA_DECLARE_TAG
+
+// BT_SF_temperature, ... and BT_SF_COUNT
+#define BT_STREAM_DECLARE_FIELD(bit, name, scale) BT_SF_##name = bit,
+enum BleStreamField {
+    BT_STREAM_FIELDS(BT_STREAM_DECLARE_FIELD)
+    BT_SF_COUNT
+};
+#undef BT_STREAM_DECLARE_FIELD
+
+struct BleFieldDesc {
+    const char* message;
+    uint8_t tag;
+    const char* name;
+    uint8_t type;
+};
+
+struct BleListDesc {
+    const char* message;
+    uint8_t tag;
+    const char* recordMessage;
+};
+
+#ifdef BLE_SCHEMA_TABLES
+#define BT_SCHEMA_DESCRIBE(msg, tag, name, type) { #msg, tag, #name, BT_FT_##type },
+static const BleFieldDesc BLE_SCHEMA_FIELDS[] = {
+    BT_SCHEMA_ALL(BT_SCHEMA_DESCRIBE)
+};
+#undef BT_SCHEMA_DESCRIBE
+
+#define BT_SCHEMA_DESCRIBE_LIST(msg, list, recordMsg) { #msg, BT_##msg##_##list, #recordMsg },
+static const BleListDesc BLE_SCHEMA_LISTS[] = {
+    BT_SCHEMA_LISTS(BT_SCHEMA_DESCRIBE_LIST)
+};
+#undef BT_SCHEMA_DESCRIBE_LIST
+
+struct BleStreamFieldDesc {
+    uint8_t bit;
+    const char* name;
+    uint16_t scale;
+};
+
+#define BT_STREAM_DESCRIBE(bit, name, scale) { bit, #name, scale },
+static const BleStreamFieldDesc BLE_STREAM_FIELDS[] = {
+    BT_STREAM_FIELDS(BT_STREAM_DESCRIBE)
+};
+#undef BT_STREAM_DESCRIBE
+#endif
+
+#endif // BLE_SCHEMA_H
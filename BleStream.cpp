@@ -0,0 +1,296 @@
+/**
+ * BleStream.cpp
+ * Live feature streaming implementation
+ */
+
+#include "BleStream.h"
+#include "Bluetooth.h"
+#include "Audio.h"
+#include "AppTasks.h"
+
+extern SensorData currentData;
+
+// Per-field fixed-point scale, indexed by BleStreamField
+#define BT_STREAM_SCALE_ENTRY(bit, name, scale) scale,
+static const uint16_t STREAM_SCALE[BT_SF_COUNT] = {
+    BT_STREAM_FIELDS(BT_STREAM_SCALE_ENTRY)
+};
+#undef BT_STREAM_SCALE_ENTRY
+
+// =============================================================================
+// VARINT HELPERS
+// =============================================================================
+
+static inline uint32_t zigzag32(int32_t v) {
+    return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31);
+}
+
+static uint8_t writeVarint(uint8_t* out, uint32_t v) {
+    uint8_t n = 0;
+    while (v >= 0x80) {
+        out[n++] = (v & 0x7F) | 0x80;
+        v >>= 7;
+    }
+    out[n++] = v;
+    return n;
+}
+
+// =============================================================================
+// FIELD SAMPLING
+// =============================================================================
+
+static float streamFieldValue(uint8_t field, const SensorData& d, const AudioAnalysisResult& a) {
+    switch (field) {
+        case BT_SF_temperature:          return d.temperature;
+        case BT_SF_humidity:             return d.humidity;
+        case BT_SF_pressure:             return d.pressure;
+        case BT_SF_batteryVoltage:       return d.batteryVoltage;
+        case BT_SF_alertFlags:           return d.alertFlags;
+        // Real-time audio values come from the continuously updated readings
+        case BT_SF_dominantFreq:         return d.dominantFreq;
+        case BT_SF_soundLevel:           return d.soundLevel;
+        case BT_SF_beeState:             return d.beeState;
+        case BT_SF_bandEnergy0_200Hz:    return a.bandEnergy0_200Hz;
+        case BT_SF_bandEnergy200_400Hz:  return a.bandEnergy200_400Hz;
+        case BT_SF_bandEnergy400_600Hz:  return a.bandEnergy400_600Hz;
+        case BT_SF_bandEnergy600_800Hz:  return a.bandEnergy600_800Hz;
+        case BT_SF_bandEnergy800_1000Hz: return a.bandEnergy800_1000Hz;
+        case BT_SF_bandEnergy1000PlusHz: return a.bandEnergy1000PlusHz;
+        case BT_SF_spectralCentroid:     return a.spectralCentroid;
+        case BT_SF_peakToAvgRatio:       return a.peakToAvgRatio;
+        case BT_SF_harmonicity:          return a.harmonicity;
+        case BT_SF_queenDetected:        return a.queenDetected;
+        case BT_SF_abscondingRisk:       return a.abscondingRisk;
+        case BT_SF_activityIncrease:     return a.activityIncrease;
+        case BT_SF_spectralRolloff:      return a.spectralRolloff;
+        case BT_SF_spectralFlux:         return a.spectralFlux;
+        case BT_SF_zeroCrossingRate:     return a.zeroCrossingRate;
+        case BT_SF_spectralSpread:       return a.spectralSpread;
+        case BT_SF_spectralSkewness:     return a.spectralSkewness;
+        case BT_SF_spectralKurtosis:     return a.spectralKurtosis;
+        case BT_SF_shortTermEnergy:      return a.shortTermEnergy;
+        case BT_SF_midTermEnergy:        return a.midTermEnergy;
+        case BT_SF_longTermEnergy:       return a.longTermEnergy;
+        case BT_SF_energyEntropy:        return a.energyEntropy;
+        case BT_SF_hourOfDaySin:         return a.hourOfDaySin;
+        case BT_SF_hourOfDayCos:         return a.hourOfDayCos;
+        case BT_SF_dayOfYearSin:         return a.dayOfYearSin;
+        case BT_SF_dayOfYearCos:         return a.dayOfYearCos;
+        case BT_SF_contextFlags:         return a.contextFlags;
+        case BT_SF_ambientNoiseLevel:    return a.ambientNoiseLevel;
+        case BT_SF_signalQuality:        return a.signalQuality;
+        case BT_SF_analysisValid:        return a.analysisValid;
+        default:                         return 0;
+    }
+}
+
+// =============================================================================
+// SUBSCRIPTION
+// =============================================================================
+
+BleStream::BleStream() {
+    sendFn = nullptr;
+    active = false;
+    fieldMask = 0;
+    requestedIntervalMs = 1000;
+    backoffMs = 0;
+    spectrumBins = 0;
+    seq = 0;
+    packetsSinceKeyframe = 0;
+    consecutiveOk = 0;
+    lastSendTime = 0;
+    lastPacketLen = 0;
+    memset(prevValues, 0, sizeof(prevValues));
+    memset(prevSpectrum, 0, sizeof(prevSpectrum));
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool BleStream::subscribe(uint64_t mask, uint16_t intervalMs, uint8_t bins) {
+    mask &= (BT_SF_COUNT >= 64) ? ~0ULL : ((1ULL << BT_SF_COUNT) - 1);
+    if (mask == 0 && bins == 0) return false;
+
+    // Bin counts must divide the FFT half-spectrum evenly
+    uint8_t validBins = 0;
+    for (uint8_t b = BT_STREAM_MAX_BINS; b >= 1; b /= 2) {
+        if (bins >= b) { validBins = b; break; }
+    }
+
+    fieldMask = mask;
+    requestedIntervalMs = constrain(intervalMs, BT_STREAM_MIN_INTERVAL_MS, BT_STREAM_MAX_INTERVAL_MS);
+    spectrumBins = validBins;
+    backoffMs = 0;
+    consecutiveOk = 0;
+    packetsSinceKeyframe = BT_STREAM_KEYFRAME_EVERY;   // First packet is a keyframe
+    lastSendTime = 0;
+    lastPacketLen = 0;
+    memset(&stats, 0, sizeof(stats));
+    stats.startTime = millis();
+    active = true;
+
+    Serial.print(F("Stream subscribed: mask 0x"));
+    Serial.print((uint32_t)(fieldMask >> 32), HEX);
+    Serial.print((uint32_t)fieldMask, HEX);
+    Serial.print(F(", "));
+    Serial.print(requestedIntervalMs);
+    Serial.print(F(" ms, "));
+    Serial.print(spectrumBins);
+    Serial.println(F(" bins"));
+    return true;
+}
+
+void BleStream::unsubscribe() {
+    if (!active) return;
+    active = false;
+    printStreamStatus();
+}
+
+// =============================================================================
+// RATE CONTROL
+// =============================================================================
+
+uint16_t BleStream::getEffectiveInterval(uint16_t maxPacketSize, uint16_t connInterval) const {
+    uint32_t interval = requestedIntervalMs;
+
+    // Budget assumes one notification per connection event and leaves the
+    // rest of the link for commands and transfers
+    if (connInterval > 0 && lastPacketLen > 0) {
+        uint32_t eventMs = max((uint32_t)connInterval * 5 / 4, (uint32_t)1);
+        uint32_t budgetBytesPerSec = (uint32_t)maxPacketSize * 1000UL / eventMs / BT_STREAM_LINK_SHARE;
+        uint32_t minInterval = (uint32_t)lastPacketLen * 1000UL / max(budgetBytesPerSec, (uint32_t)1);
+        interval = max(interval, minInterval);
+    }
+
+    interval = max(interval, (uint32_t)backoffMs);
+    return min(interval, (uint32_t)BT_STREAM_MAX_INTERVAL_MS);
+}
+
+// =============================================================================
+// PACKET ENCODING
+// =============================================================================
+
+uint16_t BleStream::buildPacket(uint8_t* out, uint16_t maxLen, bool keyframe,
+                                int32_t* values, uint8_t* spectrum) {
+    unsigned long now = millis();
+    uint16_t pos = BT_STREAM_HEADER_SIZE;
+
+    out[0] = BT_RESP_STREAM;
+    out[1] = seq;
+    out[2] = (keyframe ? 0x01 : 0) | (spectrumBins ? 0x02 : 0);
+    pos += writeVarint(&out[pos], lastSendTime ? now - lastSendTime : 0);
+
+    for (uint8_t f = 0; f < BT_SF_COUNT; f++) {
+        if (!(fieldMask & (1ULL << f))) continue;
+        if (pos + 5 > maxLen) return 0;
+        int32_t delta = keyframe ? values[f] : values[f] - prevValues[f];
+        pos += writeVarint(&out[pos], zigzag32(delta));
+    }
+
+    for (uint8_t b = 0; b < spectrumBins; b++) {
+        if (keyframe) {
+            if (pos + 1 > maxLen) return 0;
+            out[pos++] = spectrum[b];
+        } else {
+            if (pos + 2 > maxLen) return 0;
+            pos += writeVarint(&out[pos], zigzag32((int32_t)spectrum[b] - prevSpectrum[b]));
+        }
+    }
+    return pos;
+}
+
+void BleStream::pump(uint16_t maxPacketSize, uint16_t connInterval) {
+    if (!active || !sendFn) return;
+
+    unsigned long now = millis();
+    uint16_t interval = getEffectiveInterval(maxPacketSize, connInterval);
+    if (lastSendTime && now - lastSendTime < interval) {
+        if (now - lastSendTime >= requestedIntervalMs) stats.rateLimited++;
+        return;
+    }
+
+    // Quantize everything once so deltas and keyframes agree exactly.
+    // The audio task may be mid-analysis, so read under the audio lock
+    appTasks.lockAudio();
+    const AudioAnalysisResult& audio = audioProcessor.getLastResult();
+    int32_t values[BT_SF_COUNT];
+    for (uint8_t f = 0; f < BT_SF_COUNT; f++) {
+        if (fieldMask & (1ULL << f)) {
+            values[f] = lroundf(streamFieldValue(f, currentData, audio) * STREAM_SCALE[f]);
+        }
+    }
+    uint8_t spectrum[BT_STREAM_MAX_BINS];
+    if (spectrumBins) {
+        audioProcessor.getDownsampledSpectrum(spectrum, spectrumBins);
+    }
+    appTasks.unlockAudio();
+
+    uint8_t packet[BT_CHUNK_SIZE];
+    uint16_t maxLen = min(maxPacketSize, (uint16_t)BT_CHUNK_SIZE);
+    bool keyframe = packetsSinceKeyframe >= BT_STREAM_KEYFRAME_EVERY;
+    uint16_t len = buildPacket(packet, maxLen, keyframe, values, spectrum);
+
+    if (len == 0) {
+        // Subscription no longer fits the link (e.g. MTU fell back to 23):
+        // halve the spectrum and try again on the next pump
+        if (spectrumBins > 0) {
+            spectrumBins /= 2;
+            packetsSinceKeyframe = BT_STREAM_KEYFRAME_EVERY;
+            Serial.print(F("Stream: spectrum reduced to "));
+            Serial.println(spectrumBins);
+        } else {
+            Serial.println(F("Stream: field set exceeds packet size, unsubscribing"));
+            unsubscribe();
+        }
+        return;
+    }
+
+    if (!sendFn(packet, len)) {
+        // Back off multiplicatively. prevValues only advance on success,
+        // so the next delta is still relative to what the client has.
+        stats.notifyFailures++;
+        backoffMs = min(max((uint32_t)backoffMs * 2, (uint32_t)requestedIntervalMs * 2),
+                        (uint32_t)BT_STREAM_MAX_INTERVAL_MS);
+        consecutiveOk = 0;
+        lastSendTime = now;
+        return;
+    }
+
+    for (uint8_t f = 0; f < BT_SF_COUNT; f++) {
+        if (fieldMask & (1ULL << f)) prevValues[f] = values[f];
+    }
+    memcpy(prevSpectrum, spectrum, spectrumBins);
+
+    seq++;
+    packetsSinceKeyframe = keyframe ? 1 : packetsSinceKeyframe + 1;
+    lastSendTime = now;
+    lastPacketLen = len;
+    stats.packetsSent++;
+    stats.bytesSent += len;
+
+    if (backoffMs && ++consecutiveOk >= BT_STREAM_RECOVER_AFTER) {
+        backoffMs /= 2;
+        if (backoffMs < requestedIntervalMs) backoffMs = 0;
+        consecutiveOk = 0;
+    }
+}
+
+void BleStream::printStreamStatus() const {
+    unsigned long elapsed = millis() - stats.startTime;
+    uint8_t fields = 0;
+    for (uint8_t f = 0; f < BT_SF_COUNT; f++) {
+        if (fieldMask & (1ULL << f)) fields++;
+    }
+
+    Serial.println(F("\n=== BLE Stream ==="));
+    Serial.print(F("Fields: ")); Serial.print(fields);
+    Serial.print(F(", bins: ")); Serial.println(spectrumBins);
+    Serial.print(F("Packets: ")); Serial.print(stats.packetsSent);
+    Serial.print(F(", last size: ")); Serial.println(lastPacketLen);
+    Serial.print(F("Notify failures: ")); Serial.println(stats.notifyFailures);
+    Serial.print(F("Rate limited: ")); Serial.println(stats.rateLimited);
+    if (elapsed > 0) {
+        Serial.print(F("Rate: "));
+        Serial.print(stats.bytesSent * 1000UL / elapsed);
+        Serial.println(F(" B/s"));
+    }
+    Serial.println(F("==================\n"));
+}
@@ -0,0 +1,77 @@
+/**
+ * BleStream.h
+ * Live feature streaming subscription over BLE notifications
+ *
+ * Subscribe: [BT_CMD_STREAM_SUBSCRIBE][fieldMask u64][intervalMs u16][spectrumBins u8]
+ * Packet   : [BT_RESP_STREAM][seq][flags][dtMs varint][field values...][spectrum...]
+ *            flags bit0 = keyframe, bit1 = spectrum present
+ *
+ * Fields (BleSchema.h BT_STREAM_FIELDS) are sent in mask bit order as
+ * zigzag varints of round(value * scale). Keyframes carry absolute values,
+ * other packets carry the difference from the previous packet. Spectrum
+ * bins are 0.5 dB bytes: absolute in keyframes, zigzag deltas otherwise.
+ * A client that sees a seq gap discards deltas until the next keyframe.
+ */
+
+#ifndef BLE_STREAM_H
+#define BLE_STREAM_H
+
+#include "Config.h"
+#include "DataStructures.h"
+#include "BleTransfer.h"
+#include "BleSchema.h"
+
+#define BT_STREAM_MIN_INTERVAL_MS 100
+#define BT_STREAM_MAX_INTERVAL_MS 60000
+#define BT_STREAM_MAX_BINS 32
+#define BT_STREAM_KEYFRAME_EVERY 16       // Packets between keyframes
+#define BT_STREAM_HEADER_SIZE 3
+#define BT_STREAM_LINK_SHARE 2            // Use at most 1/N of the link budget
+#define BT_STREAM_RECOVER_AFTER 20        // Good packets before easing back-off
+
+struct StreamStats {
+    uint32_t packetsSent;
+    uint32_t bytesSent;
+    uint32_t notifyFailures;
+    uint32_t rateLimited;             // Sends deferred by the rate limiter
+    unsigned long startTime;
+};
+
+class BleStream {
+private:
+    TransferSendFn sendFn;
+    bool active;
+    uint64_t fieldMask;
+    uint16_t requestedIntervalMs;
+    uint16_t backoffMs;                // Grows on TX failures
+    uint8_t spectrumBins;
+
+    int32_t prevValues[BT_SF_COUNT];
+    uint8_t prevSpectrum[BT_STREAM_MAX_BINS];
+    uint8_t seq;
+    uint8_t packetsSinceKeyframe;
+    uint16_t consecutiveOk;
+    unsigned long lastSendTime;
+    uint16_t lastPacketLen;
+    StreamStats stats;
+
+    uint16_t buildPacket(uint8_t* out, uint16_t maxLen, bool keyframe, int32_t* values, uint8_t* spectrum);
+
+public:
+    BleStream();
+
+    void setSender(TransferSendFn fn) { sendFn = fn; }
+
+    bool subscribe(uint64_t mask, uint16_t intervalMs, uint8_t bins);
+    void unsubscribe();
+    bool isActive() const { return active; }
+
+    // connInterval in 1.25 ms units (0 = unknown)
+    uint16_t getEffectiveInterval(uint16_t maxPacketSize, uint16_t connInterval) const;
+    void pump(uint16_t maxPacketSize, uint16_t connInterval);
+
+    const StreamStats& getStats() const { return stats; }
+    void printStreamStatus() const;
+};
+
+#endif // BLE_STREAM_H
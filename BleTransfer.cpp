@@ -0,0 +1,325 @@
+/**
+ * BleTransfer.cpp
+ * Windowed, resumable chunked file transfer implementation
+ */
+
+#include "BleTransfer.h"
+#include "Bluetooth.h"
+#include "Utils.h"
+
+// =============================================================================
+// CONSTRUCTOR AND SESSION SETUP
+// =============================================================================
+
+BleTransfer::BleTransfer() {
+    sendFn = nullptr;
+    state = XFER_IDLE;
+    transferId = 0;
+    filename[0] = '\0';
+    fileSize = 0;
+    startOffset = 0;
+    payloadSize = 0;
+    totalChunks = 0;
+    window = BT_XFER_DEFAULT_WINDOW;
+    baseSeq = 0;
+    nextSeq = 0;
+    crcSeq = 0;
+    crc = 0;
+    lastProgressTime = 0;
+    retries = 0;
+    rewound = false;
+    memset(&stats, 0, sizeof(stats));
+}
+
+TransferStartResult BleTransfer::begin(const char* name, uint32_t offset, uint8_t windowSize,
+                                       uint16_t maxPacketSize, uint8_t* info, uint16_t& infoLen) {
+    // A new start always supersedes the previous session (this is how a
+    // client resumes after reconnecting: same file, offset = bytes it has)
+    closeFile();
+    state = XFER_IDLE;
+    infoLen = 0;
+
+    file = SD.open(name, FILE_READ);
+    if (!file) {
+        return XFER_START_NOT_FOUND;
+    }
+
+    // A packet size below the chunk header would underflow payloadSize
+    uint16_t packetSize = min(maxPacketSize, (uint16_t)BT_CHUNK_SIZE);
+    if (packetSize < BT_XFER_HEADER_SIZE + BT_XFER_MIN_PAYLOAD) {
+        closeFile();
+        return XFER_START_BAD_LINK;
+    }
+
+    fileSize = file.size();
+    if (offset > fileSize) {
+        closeFile();
+        return XFER_START_BAD_OFFSET;
+    }
+
+    payloadSize = packetSize - BT_XFER_HEADER_SIZE;
+    uint32_t chunks = (fileSize - offset + payloadSize - 1) / payloadSize;
+    if (chunks > 0xFFFF) {
+        closeFile();
+        return XFER_START_TOO_LARGE;
+    }
+
+    strncpy(filename, name, sizeof(filename) - 1);
+    filename[sizeof(filename) - 1] = '\0';
+    startOffset = offset;
+    totalChunks = (uint16_t)chunks;
+    window = constrain(windowSize, 1, BT_XFER_MAX_WINDOW);
+    baseSeq = 0;
+    nextSeq = 0;
+    crcSeq = 0;
+    crc = 0;
+    retries = 0;
+    rewound = false;
+    transferId++;
+    if (transferId == 0) transferId = 1;   // 0 is never a valid id
+
+    // The end CRC covers the whole file, so fold in what the client
+    // already holds before streaming the remainder
+    if (!foldPrefixCrc()) {
+        closeFile();
+        return XFER_START_IO_ERROR;
+    }
+
+    memset(&stats, 0, sizeof(stats));
+    stats.startTime = millis();
+    lastProgressTime = stats.startTime;
+    state = (totalChunks > 0) ? XFER_SENDING : XFER_FINISHING;
+
+    info[0] = transferId;
+    putU32LE(&info[1], fileSize);
+    putU32LE(&info[5], startOffset);
+    putU16LE(&info[9], payloadSize);
+    putU16LE(&info[11], totalChunks);
+    infoLen = 13;
+
+    Serial.print(F("Transfer "));
+    Serial.print(transferId);
+    Serial.print(F(" started: "));
+    Serial.print(filename);
+    Serial.print(F(" from offset "));
+    Serial.print(startOffset);
+    Serial.print(F(", "));
+    Serial.print(totalChunks);
+    Serial.println(F(" chunks"));
+
+    return XFER_START_OK;
+}
+
+bool BleTransfer::foldPrefixCrc() {
+    if (startOffset == 0) return true;
+
+    uint8_t buffer[128];
+    uint32_t remaining = startOffset;
+    file.seek(0);
+    while (remaining > 0) {
+        uint16_t want = min((uint32_t)sizeof(buffer), remaining);
+        int got = file.read(buffer, want);
+        if (got <= 0) return false;
+        crc = crc32Update(crc, buffer, got);
+        remaining -= got;
+    }
+    return true;
+}
+
+void BleTransfer::closeFile() {
+    if (file) {
+        file.close();
+    }
+}
+
+// =============================================================================
+// CLIENT FEEDBACK
+// =============================================================================
+
+bool BleTransfer::acknowledge(uint8_t id, uint16_t nextExpected) {
+    if (state == XFER_IDLE || state == XFER_FAILING || id != transferId) return false;
+
+    if (state == XFER_DONE) {
+        // End packet was lost; the client re-ACKs everything to ask again
+        if (nextExpected == totalChunks) {
+            state = XFER_FINISHING;
+        }
+        return true;
+    }
+
+    if (nextExpected > nextSeq) {
+        return false;   // Cannot acknowledge what was never sent
+    }
+    if (nextExpected < baseSeq) {
+        return true;    // Stale ACK overtaken by a later one
+    }
+
+    if (nextExpected > baseSeq) {
+        // Progress; chunks past it are usually still in flight, not lost
+        baseSeq = nextExpected;
+        retries = 0;
+        rewound = false;
+        lastProgressTime = millis();
+    } else if (nextExpected < nextSeq && !rewound) {
+        // A repeated ACK means the chunk after it was lost: resend
+        // everything from there, once per gap
+        stats.chunksRetransmitted += nextSeq - nextExpected;
+        nextSeq = nextExpected;
+        rewound = true;
+    }
+
+    if (baseSeq >= totalChunks) {
+        state = XFER_FINISHING;
+    }
+    return true;
+}
+
+void BleTransfer::abort() {
+    if (state == XFER_IDLE) return;
+
+    closeFile();
+    state = XFER_IDLE;
+    Serial.print(F("Transfer "));
+    Serial.print(transferId);
+    Serial.print(F(" aborted at chunk "));
+    Serial.print(baseSeq);
+    Serial.print(F("/"));
+    Serial.println(totalChunks);
+}
+
+// =============================================================================
+// SENDING
+// =============================================================================
+
+void BleTransfer::pump() {
+    if (!sendFn) return;
+
+    if (state == XFER_FAILING) {
+        if (sendError()) {
+            abort();
+        }
+        return;
+    }
+
+    if (state == XFER_FINISHING) {
+        if (sendEnd()) {
+            closeFile();
+            state = XFER_DONE;
+            stats.endTime = millis();
+            printTransferStatus();
+        }
+        return;
+    }
+
+    if (state != XFER_SENDING) return;
+
+    unsigned long now = millis();
+    if (nextSeq > baseSeq && now - lastProgressTime > BT_XFER_ACK_TIMEOUT_MS) {
+        if (++retries > BT_XFER_MAX_RETRIES) {
+            Serial.println(F("Transfer: client stopped acknowledging"));
+            abort();
+            return;
+        }
+        stats.timeouts++;
+        stats.chunksRetransmitted += nextSeq - baseSeq;
+        nextSeq = baseSeq;
+        rewound = false;
+        lastProgressTime = now;
+    }
+
+    uint8_t sentThisPump = 0;
+    while (nextSeq < totalChunks &&
+           (uint16_t)(nextSeq - baseSeq) < window &&
+           sentThisPump < BT_XFER_MAX_CHUNKS_PER_PUMP) {
+        ChunkSendResult result = sendChunk(nextSeq);
+        if (result == CHUNK_READ_ERROR) {
+            // Retrying would only fail again until the client times out
+            Serial.print(F("Transfer: read error at chunk "));
+            Serial.println(nextSeq);
+            closeFile();
+            state = XFER_FAILING;
+            if (sendError()) {
+                abort();
+            }
+            return;
+        }
+        if (result == CHUNK_REFUSED) {
+            // TX buffers full - try the same chunk again next pump
+            stats.notifyFailures++;
+            break;
+        }
+        nextSeq++;
+        sentThisPump++;
+    }
+}
+
+ChunkSendResult BleTransfer::sendChunk(uint16_t seq) {
+    uint8_t packet[BT_CHUNK_SIZE];
+    uint32_t position = startOffset + (uint32_t)seq * payloadSize;
+    uint16_t len = min((uint32_t)payloadSize, fileSize - position);
+
+    if (file.position() != position && !file.seek(position)) {
+        return CHUNK_READ_ERROR;
+    }
+    int got = file.read(&packet[BT_XFER_HEADER_SIZE], len);
+    if (got != len) {
+        return CHUNK_READ_ERROR;
+    }
+
+    packet[0] = BT_RESP_TRANSFER_DATA;
+    packet[1] = transferId;
+    putU16LE(&packet[2], seq);
+
+    if (!sendFn(packet, len + BT_XFER_HEADER_SIZE)) {
+        return CHUNK_REFUSED;
+    }
+
+    // Chunks always go out in order the first time, so the CRC can be
+    // built while streaming without a second pass over the file
+    if (seq == crcSeq) {
+        crc = crc32Update(crc, &packet[BT_XFER_HEADER_SIZE], len);
+        crcSeq++;
+    }
+
+    stats.chunksSent++;
+    stats.bytesSent += len + BT_XFER_HEADER_SIZE;
+    return CHUNK_SENT;
+}
+
+bool BleTransfer::sendEnd() {
+    uint8_t packet[12];
+    packet[0] = BT_RESP_TRANSFER_END;
+    packet[1] = transferId;
+    putU16LE(&packet[2], totalChunks);
+    putU32LE(&packet[4], fileSize);
+    putU32LE(&packet[8], crc);
+    return sendFn(packet, sizeof(packet));
+}
+
+bool BleTransfer::sendError() {
+    uint8_t packet[4];
+    packet[0] = BT_RESP_TRANSFER_ERROR;
+    packet[1] = transferId;
+    putU16LE(&packet[2], nextSeq);
+    return sendFn(packet, sizeof(packet));
+}
+
+void BleTransfer::printTransferStatus() const {
+    unsigned long elapsed = (stats.endTime ? stats.endTime : millis()) - stats.startTime;
+
+    Serial.println(F("\n=== BLE Transfer ==="));
+    Serial.print(F("File: ")); Serial.println(filename);
+    Serial.print(F("Id: ")); Serial.println(transferId);
+    Serial.print(F("Acked: ")); Serial.print(baseSeq); Serial.print(F("/")); Serial.println(totalChunks);
+    Serial.print(F("Sent: ")); Serial.print(stats.chunksSent);
+    Serial.print(F(" (retransmitted ")); Serial.print(stats.chunksRetransmitted); Serial.println(F(")"));
+    Serial.print(F("Notify failures: ")); Serial.println(stats.notifyFailures);
+    Serial.print(F("Timeouts: ")); Serial.println(stats.timeouts);
+    Serial.print(F("CRC32: 0x")); Serial.println(crc, HEX);
+    if (elapsed > 0) {
+        Serial.print(F("Throughput: "));
+        Serial.print(stats.bytesSent * 1000UL / elapsed);
+        Serial.println(F(" B/s"));
+    }
+    Serial.println(F("====================\n"));
+}
@@ -0,0 +1,137 @@
+/**
+ * BleTransfer.h
+ * Windowed, resumable chunked file transfer over BLE notifications
+ *
+ * Packet layout (all multi-byte fields little-endian):
+ *   Start reply : framed BT_RESP_OK (BleProtocol.h) carrying
+ *                 [transferId][fileSize u32][startOffset u32][payloadSize u16][totalChunks u16]
+ *   Data chunk  : [BT_RESP_TRANSFER_DATA][transferId][seq u16][payload...]
+ *   End         : [BT_RESP_TRANSFER_END][transferId][totalChunks u16][fileSize u32][crc32 u32]
+ *   Error       : [BT_RESP_TRANSFER_ERROR][transferId][seq u16]
+ *
+ * Chunk seq N carries file bytes starting at startOffset + N * payloadSize.
+ * The client ACKs cumulatively with the next sequence number it expects.
+ * An ACK that repeats the last one rewinds the sender to it (go-back-N),
+ * once per gap, so a client that spots a gap simply ACKs the missing
+ * sequence number; a lost last chunk is recovered by the ACK timeout.
+ * The CRC always covers the whole file, including any resumed prefix.
+ * A chunk the card cannot read ends the transfer with the error packet,
+ * carrying the chunk that failed; the client may resume from there.
+ */
+
+#ifndef BLE_TRANSFER_H
+#define BLE_TRANSFER_H
+
+#include "Config.h"
+#include "DataStructures.h"
+
+// =============================================================================
+// TRANSFER CONFIGURATION
+// =============================================================================
+
+#define BT_XFER_HEADER_SIZE 4            // [resp][transferId][seq lo][seq hi]
+#define BT_XFER_DEFAULT_WINDOW 8         // Chunks in flight before waiting for an ACK
+#define BT_XFER_MAX_WINDOW 32
+#define BT_XFER_ACK_TIMEOUT_MS 1500      // Go back to the oldest unacked chunk after this
+#define BT_XFER_MAX_RETRIES 8            // Consecutive timeouts before giving up
+#define BT_XFER_MAX_CHUNKS_PER_PUMP 8    // Bound work done per pump() call
+#define BT_XFER_MIN_PAYLOAD 16           // Smaller links are refused rather than crawled over
+#define BT_XFER_FILENAME_LEN 32
+
+// Sends one notification; returns false when the stack could not queue it
+typedef bool (*TransferSendFn)(const uint8_t* data, uint16_t len);
+
+enum TransferState {
+    XFER_IDLE = 0,
+    XFER_SENDING = 1,      // Data chunks outstanding
+    XFER_FINISHING = 2,    // Everything ACKed, end packet not yet queued
+    XFER_DONE = 3,         // End packet sent, waiting for next start/abort
+    XFER_FAILING = 4       // Read error, error packet not yet queued
+};
+
+enum ChunkSendResult {
+    CHUNK_SENT = 0,
+    CHUNK_REFUSED,         // TX buffers full, try again
+    CHUNK_READ_ERROR       // The card could not return the chunk
+};
+
+enum TransferStartResult {
+    XFER_START_OK = 0,
+    XFER_START_NOT_FOUND,
+    XFER_START_BAD_OFFSET,
+    XFER_START_TOO_LARGE,
+    XFER_START_IO_ERROR,
+    XFER_START_BAD_LINK        // Packet size leaves no room for a payload
+};
+
+struct TransferStats {
+    uint32_t chunksSent;
+    uint32_t chunksRetransmitted;
+    uint32_t notifyFailures;
+    uint32_t timeouts;
+    uint32_t bytesSent;
+    unsigned long startTime;
+    unsigned long endTime;
+};
+
+// =============================================================================
+// TRANSFER SESSION CLASS
+// =============================================================================
+
+class BleTransfer {
+private:
+    TransferSendFn sendFn;
+    TransferState state;
+    uint8_t transferId;
+    char filename[BT_XFER_FILENAME_LEN];
+    SDLib::File file;
+
+    uint32_t fileSize;
+    uint32_t startOffset;
+    uint16_t payloadSize;
+    uint16_t totalChunks;
+    uint8_t window;
+
+    uint16_t baseSeq;          // Oldest unacknowledged chunk
+    uint16_t nextSeq;          // Next chunk to put on the air
+    uint16_t crcSeq;           // Next chunk still to be folded into the CRC
+    uint32_t crc;
+
+    unsigned long lastProgressTime;
+    uint8_t retries;
+    bool rewound;              // Already went back for the gap at baseSeq
+    TransferStats stats;
+
+    ChunkSendResult sendChunk(uint16_t seq);
+    bool sendEnd();
+    bool sendError();
+    bool foldPrefixCrc();
+    void closeFile();
+
+public:
+    BleTransfer();
+
+    void setSender(TransferSendFn fn) { sendFn = fn; }
+
+    // Opens the file and prepares a session. Fills the 13-byte start reply
+    // payload into info.
+    TransferStartResult begin(const char* name, uint32_t offset, uint8_t windowSize,
+                              uint16_t maxPacketSize, uint8_t* info, uint16_t& infoLen);
+
+    // Cumulative ACK: all chunks below nextExpected were received
+    bool acknowledge(uint8_t id, uint16_t nextExpected);
+    void abort();
+
+    // Sends as much as the window allows; call often from the main loop
+    void pump();
+
+    bool isActive() const { return state == XFER_SENDING || state == XFER_FINISHING || state == XFER_FAILING; }
+    TransferState getState() const { return state; }
+    uint8_t getTransferId() const { return transferId; }
+    uint16_t getAckedChunks() const { return baseSeq; }
+    uint16_t getTotalChunks() const { return totalChunks; }
+    const TransferStats& getStats() const { return stats; }
+    void printTransferStatus() const;
+};
+
+#endif // BLE_TRANSFER_H
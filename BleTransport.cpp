@@ -0,0 +1,196 @@
+/**
+ * BleTransport.cpp
+ * Bluefruit GATT transport and simulated link
+ */
+
+#include "BleTransport.h"
+
+// =============================================================================
+// BLUEFRUIT GATT SERVICE
+// =============================================================================
+
+#ifdef NRF52_SERIES
+BluefruitTransport::BluefruitTransport(const char* serviceUuid, const char* dataUuid,
+                                       const char* commandUuid, const char* statusUuid)
+    : dataService(serviceUuid),
+      dataCharacteristic(dataUuid),
+      commandCharacteristic(commandUuid),
+      statusCharacteristic(statusUuid) {
+}
+
+void BluefruitTransport::begin(BLECharacteristic::write_cb_t writeCallback, uint16_t commandLen) {
+    Serial.println("Setting up BLE service...");
+
+    // Setup service
+    dataService.begin();
+    Serial.println("Data service started");
+
+    // Setup data characteristic
+    dataCharacteristic.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
+    dataCharacteristic.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
+    dataCharacteristic.setMaxLen(BT_TRANSPORT_MAX_PACKET);
+    dataCharacteristic.begin();
+    Serial.println("Data characteristic started");
+
+    // Setup command characteristic
+    commandCharacteristic.setProperties(CHR_PROPS_WRITE | CHR_PROPS_WRITE_WO_RESP);
+    commandCharacteristic.setPermission(SECMODE_OPEN, SECMODE_OPEN);
+    commandCharacteristic.setWriteCallback(writeCallback);
+    commandCharacteristic.setFixedLen(commandLen);
+    commandCharacteristic.begin();
+    Serial.println("Command characteristic started");
+
+    // Setup status characteristic
+    statusCharacteristic.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
+    statusCharacteristic.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
+    statusCharacteristic.setMaxLen(32);
+    statusCharacteristic.begin();
+    Serial.println("Status characteristic started");
+}
+
+bool BluefruitTransport::notifyData(const uint8_t* data, uint16_t len) {
+    return dataCharacteristic.notify(data, len);
+}
+
+bool BluefruitTransport::notifyStatus(const uint8_t* data, uint16_t len) {
+    return statusCharacteristic.notify(data, len);
+}
+
+bool BluefruitTransport::requestFastLink(uint16_t connHandle) {
+    BLEConnection* conn = Bluefruit.Connection(connHandle);
+    if (!conn) return false;
+
+    // All three are negotiated asynchronously; getLinkInfo() picks up the
+    // results. Clients that refuse simply keep the defaults.
+    bool phy2M = conn->requestPHY(BLE_GAP_PHY_2MBPS);
+    conn->requestDataLengthUpdate();
+    conn->requestMtuExchange(BT_TRANSPORT_MAX_PACKET + 3);
+    return phy2M;
+}
+
+bool BluefruitTransport::getLinkInfo(uint16_t connHandle, TransportLinkInfo& info) {
+    BLEConnection* conn = Bluefruit.Connection(connHandle);
+    if (!conn) return false;
+
+    info.mtu = conn->getMtu();
+    info.dataLength = conn->getDataLength();
+    info.connInterval = conn->getConnectionInterval();
+    return true;
+}
+
+void BluefruitTransport::requestConnInterval(uint16_t connHandle, uint16_t interval) {
+    BLEConnection* conn = Bluefruit.Connection(connHandle);
+    if (conn) {
+        conn->requestConnectionParameter(interval);
+    }
+}
+#endif
+
+// =============================================================================
+// SIMULATED LINK
+// =============================================================================
+
+SimTransport::SimTransport() {
+    SimLinkConfig defaults = { 23, 24, 4, 4, 0, 1 };
+    clientRx = nullptr;
+    txComplete = nullptr;
+    nowUs = 0;
+    configure(defaults);
+}
+
+void SimTransport::configure(const SimLinkConfig& cfg) {
+    config = cfg;
+    config.mtu = constrain(config.mtu, (uint16_t)23, (uint16_t)(BT_TRANSPORT_MAX_PACKET + 3));
+    config.bufferDepth = constrain(config.bufferDepth, (uint8_t)1, (uint8_t)SIM_MAX_BUFFER_DEPTH);
+    config.packetsPerEvent = max(config.packetsPerEvent, (uint8_t)1);
+    config.connInterval = max(config.connInterval, (uint16_t)6);
+    rng = config.seed ? config.seed : 1;
+    head = 0;
+    count = 0;
+    nextEventUs = nowUs + config.connInterval * 1250UL;
+    resetStats();
+}
+
+void SimTransport::resetStats() {
+    memset(&stats, 0, sizeof(stats));
+}
+
+bool SimTransport::enqueue(const uint8_t* data, uint16_t len, bool status) {
+    if (len > config.mtu - 3) return false;   // Larger than the negotiated MTU allows
+    if (count == config.bufferDepth) {
+        stats.refused++;
+        return false;
+    }
+
+    uint8_t slot = (head + count) % SIM_MAX_BUFFER_DEPTH;
+    memcpy(buffer[slot], data, len);
+    lengths[slot] = len;
+    statusFlags[slot] = status;
+    count++;
+    stats.accepted++;
+    return true;
+}
+
+bool SimTransport::loseNext() {
+    if (config.lossPermille == 0) return false;
+
+    // xorshift32 so runs are repeatable for a given seed
+    rng ^= rng << 13;
+    rng ^= rng >> 17;
+    rng ^= rng << 5;
+    return (rng % 1000) < config.lossPermille;
+}
+
+void SimTransport::advanceTo(uint32_t timeUs) {
+    while ((int32_t)(timeUs - nextEventUs) >= 0) {
+        nowUs = nextEventUs;
+        nextEventUs += config.connInterval * 1250UL;
+        stats.events++;
+
+        uint8_t sent = 0;
+        while (count > 0 && sent < config.packetsPerEvent) {
+            uint8_t slot = head;
+            head = (head + 1) % SIM_MAX_BUFFER_DEPTH;
+            count--;
+            sent++;
+
+            if (loseNext()) {
+                stats.lost++;
+                continue;
+            }
+            stats.delivered++;
+            stats.bytesDelivered += lengths[slot];
+            if (clientRx) clientRx(buffer[slot], lengths[slot], statusFlags[slot], nowUs);
+        }
+
+        if (sent > 0 && txComplete) txComplete();
+    }
+    nowUs = timeUs;
+}
+
+bool SimTransport::notifyData(const uint8_t* data, uint16_t len) {
+    return enqueue(data, len, false);
+}
+
+bool SimTransport::notifyStatus(const uint8_t* data, uint16_t len) {
+    return enqueue(data, len, true);
+}
+
+bool SimTransport::requestFastLink(uint16_t connHandle) {
+    (void)connHandle;
+    return false;
+}
+
+bool SimTransport::getLinkInfo(uint16_t connHandle, TransportLinkInfo& info) {
+    (void)connHandle;
+    info.mtu = config.mtu;
+    info.dataLength = min((uint16_t)251, (uint16_t)(config.mtu + 4));
+    info.connInterval = config.connInterval;
+    return true;
+}
+
+void SimTransport::requestConnInterval(uint16_t connHandle, uint16_t interval) {
+    (void)connHandle;
+    // Central accepts whatever is asked, from the next event on
+    config.connInterval = max(interval, (uint16_t)6);
+}
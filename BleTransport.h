@@ -0,0 +1,144 @@
+/**
+ * BleTransport.h
+ * Connection transport between BluetoothManager and the radio
+ *
+ * BluetoothManager talks to the link only through BleTransport: two
+ * notification channels (data and status), link parameter queries and
+ * requests. Commands and TX-complete events come back in through
+ * BluetoothManager::queueCommand() and onTxComplete().
+ *
+ * BluefruitTransport is the real GATT service. SimTransport is an
+ * in-process model of a link with a given MTU, connection interval,
+ * SoftDevice buffer depth and packet loss, driven by explicit time so
+ * protocol changes can be measured without a radio.
+ */
+
+#ifndef BLE_TRANSPORT_H
+#define BLE_TRANSPORT_H
+
+#include "Config.h"
+#include "BleTransfer.h"
+
+#ifdef NRF52_SERIES
+  #include <bluefruit.h>
+#endif
+
+#define BT_TRANSPORT_MAX_PACKET 244      // Notification payload at the largest MTU
+#define SIM_MAX_BUFFER_DEPTH 8
+
+struct TransportLinkInfo {
+    uint16_t mtu;
+    uint16_t dataLength;
+    uint16_t connInterval;       // 1.25 ms units
+};
+
+class BleTransport {
+public:
+    virtual ~BleTransport() {}
+
+    // false means the stack's TX buffers are full; retry after TX complete
+    virtual bool notifyData(const uint8_t* data, uint16_t len) = 0;
+    virtual bool notifyStatus(const uint8_t* data, uint16_t len) = 0;
+
+    // Starts PHY, data length and MTU negotiation; true if 2M PHY was requested
+    virtual bool requestFastLink(uint16_t connHandle) = 0;
+    virtual bool getLinkInfo(uint16_t connHandle, TransportLinkInfo& info) = 0;
+    virtual void requestConnInterval(uint16_t connHandle, uint16_t interval) = 0;
+};
+
+// =============================================================================
+// BLUEFRUIT GATT SERVICE
+// =============================================================================
+
+#ifdef NRF52_SERIES
+class BluefruitTransport : public BleTransport {
+private:
+    BLEService dataService;
+    BLECharacteristic dataCharacteristic;
+    BLECharacteristic commandCharacteristic;
+    BLECharacteristic statusCharacteristic;
+
+public:
+    BluefruitTransport(const char* serviceUuid, const char* dataUuid,
+                       const char* commandUuid, const char* statusUuid);
+
+    // Adds the service and characteristics; commands go to writeCallback
+    void begin(BLECharacteristic::write_cb_t writeCallback, uint16_t commandLen);
+    BLEService& getService() { return dataService; }
+
+    bool notifyData(const uint8_t* data, uint16_t len);
+    bool notifyStatus(const uint8_t* data, uint16_t len);
+    bool requestFastLink(uint16_t connHandle);
+    bool getLinkInfo(uint16_t connHandle, TransportLinkInfo& info);
+    void requestConnInterval(uint16_t connHandle, uint16_t interval);
+};
+#endif
+
+// =============================================================================
+// SIMULATED LINK
+// =============================================================================
+
+struct SimLinkConfig {
+    uint16_t mtu;
+    uint16_t connInterval;       // 1.25 ms units
+    uint8_t bufferDepth;         // SoftDevice HVN TX queue size, up to SIM_MAX_BUFFER_DEPTH
+    uint8_t packetsPerEvent;     // Notifications sent per connection event
+    uint16_t lossPermille;       // Delivered packets lost before the client
+    uint32_t seed;
+};
+
+struct SimLinkStats {
+    uint32_t accepted;
+    uint32_t refused;            // Buffer full
+    uint32_t delivered;
+    uint32_t lost;
+    uint32_t bytesDelivered;
+    uint32_t events;
+};
+
+// Client side of the simulated link; status is true for the status channel
+typedef void (*SimClientRxFn)(const uint8_t* data, uint16_t len, bool status, uint32_t timeUs);
+typedef void (*SimTxCompleteFn)();
+
+class SimTransport : public BleTransport {
+private:
+    SimLinkConfig config;
+    SimLinkStats stats;
+    SimClientRxFn clientRx;
+    SimTxCompleteFn txComplete;
+
+    uint8_t buffer[SIM_MAX_BUFFER_DEPTH][BT_TRANSPORT_MAX_PACKET];
+    uint8_t lengths[SIM_MAX_BUFFER_DEPTH];
+    bool statusFlags[SIM_MAX_BUFFER_DEPTH];
+    uint8_t head;
+    uint8_t count;
+    uint32_t nowUs;
+    uint32_t nextEventUs;
+    uint32_t rng;
+
+    bool enqueue(const uint8_t* data, uint16_t len, bool status);
+    bool loseNext();
+
+public:
+    SimTransport();
+
+    void configure(const SimLinkConfig& cfg);
+    void setClient(SimClientRxFn rx) { clientRx = rx; }
+    void setTxCompleteHandler(SimTxCompleteFn fn) { txComplete = fn; }
+
+    // Runs every connection event up to timeUs
+    void advanceTo(uint32_t timeUs);
+    uint32_t getTime() const { return nowUs; }
+    uint8_t getBuffered() const { return count; }
+
+    const SimLinkStats& getStats() const { return stats; }
+    void resetStats();
+
+    bool notifyData(const uint8_t* data, uint16_t len);
+    bool notifyStatus(const uint8_t* data, uint16_t len);
+    bool requestFastLink(uint16_t connHandle);
+    bool getLinkInfo(uint16_t connHandle, TransportLinkInfo& info);
+    void requestConnInterval(uint16_t connHandle, uint16_t interval);
+};
+
+#endif // BLE_TRANSPORT_H
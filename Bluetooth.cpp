@@ -9,8 +9,16 @@
 #include "Sensors.h"
 #include "Alerts.h"
 #include "Settings.h" 
-
-#ifdef NRF52_SERIES
+#include "BleProtocol.h"
+#include "EventScheduler.h"
+#include "AppTasks.h"
+#include "PhaseProfiler.h"
+#include "AdaptiveInterval.h"
+#include "WakeSchedule.h"
+#include "PowerSimulator.h"
+#include "BatteryModel.h"
+#include "PowerDomains.h"
+#include "FastBoot.h"
 
 extern const BeePresetInfo BEE_PRESETS[];
 extern const int NUM_BEE_PRESETS;
@@ -32,16 +40,22 @@ BluetoothManager* bluetoothManagerInstance = nullptr;
 
 BluetoothManager::BluetoothManager()
 #ifdef NRF52_SERIES
-    : dataService(BT_SERVICE_UUID),
-      dataCharacteristic(BT_DATA_CHAR_UUID),
-      commandCharacteristic(BT_COMMAND_CHAR_UUID),
-      statusCharacteristic(BT_STATUS_CHAR_UUID)
+    : radio(BT_SERVICE_UUID, BT_DATA_CHAR_UUID, BT_COMMAND_CHAR_UUID, BT_STATUS_CHAR_UUID)
 #endif
 {
+#ifdef NRF52_SERIES
+    transport = &radio;
+#else
+    transport = nullptr;
+#endif
      // Initialize simplified settings
     settings.enabled = true;          // Default enabled for testing
     settings.deviceId = 1;            // Default device ID
     settings.timeoutMin = 2;          // Default 2 minutes (same as display)
+    settings.beaconEnabled = false;
+    settings.beaconIntervalMs = BEACON_DEFAULT_INTERVAL_MS;
+    settings.gatewayEnabled = false;
+    settings.gatewayPeriodMin = GATEWAY_DEFAULT_PERIOD_MIN;
     
     // Initialize state
     state.status = BT_STATUS_OFF;    
@@ -53,6 +67,44 @@ BluetoothManager::BluetoothManager()
     state.currentTransferProgress = 0;
     state.currentTransferTotal = 0;
     lastUpdate = 0;
+    radioStarted = false;
+    
+    // Link starts at the BLE defaults until the client negotiates
+    link.connHandle = 0xFFFF;
+    link.mtu = BT_DEFAULT_MTU;
+    link.maxPacketSize = notifyPayloadForMtu(BT_DEFAULT_MTU);
+    link.dataLength = 27;
+    link.connInterval = 0;
+    link.phy2MRequested = false;
+    link.bulkProfile = false;
+    memset(&bench, 0, sizeof(bench));
+    currentRequestId = 0;
+    currentEncoding = 0;
+    
+    job.type = BT_JOB_NONE;
+    job.requestId = 0;
+    job.encoding = 0;
+    job.frameSeq = 0;
+    job.done = 0;
+    job.total = 0;
+    job.calibration.active = false;
+    job.syncCursor = 0;
+    job.syncCrc = 0;
+    job.seriesBuckets = 0;
+    job.seriesBytes = 0;
+    job.startedAt = 0;
+    job.lastProgressReport = 0;
+    statusPending = false;
+    seriesPending = false;
+    seriesPacketLen = BT_SERIES_HEADER_SIZE;
+    
+    memset(beaconPayload, 0, sizeof(beaconPayload));
+    beaconPayloadLen = 0;
+    beaconCounter = 0;
+    lastReadingTime = 0;
+    ackListening = false;
+    ackListenStart = 0;
+    ackReportLen = 0;
     
     systemStatus = nullptr;
     systemSettings = nullptr;
@@ -60,26 +112,44 @@ BluetoothManager::BluetoothManager()
     bluetoothManagerInstance = this;
 }
 
-void BluetoothManager::initialize(SystemStatus* sysStatus, SystemSettings* sysSettings) {
+void BluetoothManager::initialize(SystemStatus* sysStatus, SystemSettings* sysSettings, bool startRadio) {
     systemStatus = sysStatus;
     systemSettings = sysSettings;
     
+    transfer.setSender(bluetoothNotifyData);
+    stream.setSender(bluetoothNotifyData);
+    notifyQueue.setSink(bluetoothNotifyRaw);
     loadBluetoothSettings();
-#if 1
-//#ifdef NRF52_SERIES
-    // Initialize Bluefruit
-    Bluefruit.begin();
-    Bluefruit.setTxPower(0);
+    if (startRadio) {
+        start();
+    }
+}
+
+void BluetoothManager::start() {
+    if (radioStarted) return;
+    radioStarted = true;
     
     String deviceName = getDeviceName();
+#ifdef NRF52_SERIES
+    // Initialize Bluefruit - bandwidth must be configured before begin()
+    // so the SoftDevice reserves room for 247-byte MTU and long events
+    Bluefruit.configPrphBandwidth(BANDWIDTH_MAX);
+    // One central link so the gateway role can scan for neighbour beacons
+    Bluefruit.begin(1, 1);
+    Bluefruit.setTxPower(0);
     Bluefruit.setName(deviceName.c_str());
     
     // Setup callbacks
     Bluefruit.Periph.setConnectCallback(bluetoothConnectCallback);
     Bluefruit.Periph.setDisconnectCallback(bluetoothDisconnectCallback);
+    Bluefruit.setEventCallback(bluetoothBleEventCallback);
+    
+    // Relaxed interval by default; transfers ask for the bulk profile
+    Bluefruit.Periph.setConnInterval(BT_CONN_INTERVAL_BULK, BT_CONN_INTERVAL_IDLE);
     
     // Setup BLE service BEFORE starting advertising
     setupBLEService();
+#endif
     
     Serial.print(F("Bluetooth initialized as: "));
     Serial.println(deviceName);
@@ -99,40 +169,18 @@ void BluetoothManager::initialize(SystemStatus* sysStatus, SystemSettings* sysSe
     if (shouldBeDiscoverable()) {
         startAdvertising();
     }
-#endif
+    if (settings.gatewayEnabled) {
+        setGateway(true, settings.gatewayPeriodMin);
+    }
+    
+    // The BLE task may be blocked with nothing to time
+    eventScheduler.post(EVT_BLE);
 }
 
 void BluetoothManager::setupBLEService() {
 
-#if 1
-//#ifdef NRF52_SERIES
-    Serial.println("Setting up BLE service...");
-    
-    // Setup service
-    dataService.begin();
-    Serial.println("Data service started");
-    
-    // Setup data characteristic
-    dataCharacteristic.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
-    dataCharacteristic.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
-    dataCharacteristic.setFixedLen(BT_CHUNK_SIZE);
-    dataCharacteristic.begin();
-    Serial.println("Data characteristic started");
-    
-    // Setup command characteristic
-    commandCharacteristic.setProperties(CHR_PROPS_WRITE | CHR_PROPS_WRITE_WO_RESP);
-    commandCharacteristic.setPermission(SECMODE_OPEN, SECMODE_OPEN);
-    commandCharacteristic.setWriteCallback(bluetoothCommandCallback);
-    commandCharacteristic.setFixedLen(64);
-    commandCharacteristic.begin();
-    Serial.println("Command characteristic started");
-    
-    // Setup status characteristic
-    statusCharacteristic.setProperties(CHR_PROPS_READ | CHR_PROPS_NOTIFY);
-    statusCharacteristic.setPermission(SECMODE_OPEN, SECMODE_NO_ACCESS);
-    statusCharacteristic.setFixedLen(32);
-    statusCharacteristic.begin();
-    Serial.println("Status characteristic started");
+#ifdef NRF52_SERIES
+    radio.begin(bluetoothCommandCallback, BT_COMMAND_MAX_LEN);
     
     Serial.print("Service UUID: ");
     Serial.println(BT_SERVICE_UUID);
@@ -145,16 +193,92 @@ void BluetoothManager::setupBLEService() {
 // =============================================================================
 
 void BluetoothManager::update() {
+    // Nothing on air until start()
+    if (!radioStarted) return;
     unsigned long currentTime = millis();
     
+    // Jobs and transfers are paced by the link, not by the 1 s housekeeping
+    // tick; each call does a bounded amount of work so loop() stays responsive
+    if (state.clientConnected) {
+        // Held notifications go first so everything leaves in order
+        if (statusPending && transport) {
+            statusPending = !transport->notifyStatus(pendingStatus, sizeof(pendingStatus));
+        }
+        notifyQueue.pump();
+        
+        // Commands queued by the write callback, oldest first; a burst is
+        // spread over several calls so the caller's lock is not held for
+        // the whole queue
+        uint8_t command[BT_COMMAND_MAX_LEN];
+        uint16_t commandLen;
+        bool tooLong;
+        for (uint8_t handled = 0; handled < BT_COMMANDS_PER_UPDATE &&
+             (commandLen = commandQueue.pop(command, tooLong)) > 0; handled++) {
+            if (tooLong) {
+                rejectCommand(command, commandLen);
+            } else {
+                handleCommand(command, commandLen);
+            }
+        }
+        
+        transfer.pump();
+        pumpBenchmark();
+        runJob();
+        stream.pump(link.maxPacketSize, link.connInterval);
+        
+        bool wantBulk = transfer.isActive() || bench.active ||
+                        job.type == BT_JOB_FILE_STREAM || job.type == BT_JOB_RECORD_SYNC ||
+                        job.type == BT_JOB_SERIES_QUERY;
+        if (wantBulk != link.bulkProfile) {
+            setLinkProfile(wantBulk);
+        }
+    }
+    
+    // Scan windows are short and timed in ms, so this runs every pass;
+    // the RTC is only read when there are beacons to file
+    bleGateway.update();
+    if (bleGateway.hasPendingReports()) {
+        // May run while the loop sleeps with the bus released
+        powerDomains.acquire(DOMAIN_I2C, PCLIENT_GATEWAY);
+        bleGateway.processReports(rtc.now().unixtime());
+        powerDomains.release(DOMAIN_I2C, PCLIENT_GATEWAY);
+    }
+    
+    if (ackListening) {
+        if (ackReportLen) {
+            if (alertLatch.onGatewayBeacon(settings.deviceId, ackReport, ackReportLen)) {
+                Serial.println(F("Beacon: alerts acknowledged by the gateway"));
+            }
+            ackReportLen = 0;
+        }
+        if (!alertLatch.isPending() || currentTime - ackListenStart >= BEACON_ACK_LISTEN_MS) {
+            stopAckListen();
+        }
+    }
+    
     // Update every second
     if (currentTime - lastUpdate < 1000) return;
     lastUpdate = currentTime;
     
-    // Simple logic: if enabled and not advertising, start advertising
-    if (settings.enabled && state.status == BT_STATUS_OFF) {
-        startAdvertising();
-    } else if (!settings.enabled && state.status != BT_STATUS_OFF) {
+    // MTU and data length exchanges complete asynchronously after connect
+    if (state.clientConnected) {
+        refreshLinkInfo();
+    }
+    
+    // Discoverable wins; otherwise fall back to the status beacon or off
+    if (settings.enabled) {
+        if (state.status == BT_STATUS_OFF || state.status == BT_STATUS_BEACON) {
+            startAdvertising();
+        }
+    } else if (settings.beaconEnabled || bleGateway.hasAcks()) {
+        // A gateway beacons its acks even with its own beacon off
+        if (state.status != BT_STATUS_BEACON) {
+            stopAdvertising();
+            startBeacon();
+        } else {
+            refreshBeacon();
+        }
+    } else if (state.status != BT_STATUS_OFF) {
         stopAdvertising();
     }
     
@@ -162,6 +286,18 @@ void BluetoothManager::update() {
     updateAdvertising();
 }
 
+bool BluetoothManager::hasTimedWork() const {
+    if (!radioStarted) return false;
+    if (bleGateway.isEnabled() || ackListening) return true;
+    if (settings.beaconEnabled || bleGateway.hasAcks()) return true;
+    
+    // The housekeeping tick would start or stop advertising
+    if (settings.enabled) {
+        return state.status == BT_STATUS_OFF || state.status == BT_STATUS_BEACON;
+    }
+    return state.status != BT_STATUS_OFF;
+}
+
 BluetoothMode BluetoothManager::getMode() const {
     return settings.enabled ? BT_MODE_ON : BT_MODE_OFF;
 }
@@ -180,35 +316,42 @@ void BluetoothManager::resetStatistics() {
     state.totalConnections = 0;
     state.totalDataTransferred = 0;
     state.lastConnectionTime = 0;
+    notifyQueue.resetStats();
     Serial.println(F("Bluetooth statistics reset"));
 }
 
 
 
 void BluetoothManager::startAdvertising() {
-#if 1
-//#ifdef NRF52_SERIES
     if (state.status == BT_STATUS_ADVERTISING) return;
     
+#ifdef NRF52_SERIES
     // IMPORTANT: Stop any existing advertising first
     Bluefruit.Advertising.stop();
     
     // IMPORTANT: Clear all advertising data
     Bluefruit.Advertising.clearData();
+    Bluefruit.ScanResponse.clearData();
+    Bluefruit.Advertising.setType(BLE_GAP_ADV_TYPE_CONNECTABLE_SCANNABLE_UNDIRECTED);
     
     // Setup advertising packet in the correct order
     Bluefruit.Advertising.addFlags(BLE_GAP_ADV_FLAGS_LE_ONLY_GENERAL_DISC_MODE);
     Bluefruit.Advertising.addTxPower();
     
     // Add the service BEFORE the name (order matters!)
-    Bluefruit.Advertising.addService(dataService);
+    Bluefruit.Advertising.addService(radio.getService());
     Bluefruit.Advertising.addName();
+    
+    // Scanners that request a scan response also get the status record
+    beaconPayloadLen = buildBeaconPayload(beaconPayload);
+    Bluefruit.ScanResponse.addManufacturerData(beaconPayload, beaconPayloadLen);
         
     // Simple advertising interval
     Bluefruit.Advertising.setInterval(32, 244);
     
     Bluefruit.Advertising.setFastTimeout(30);
     Bluefruit.Advertising.start(0);
+#endif
     
     state.status = BT_STATUS_ADVERTISING;
     Serial.println(F("Bluetooth advertising started with service"));
@@ -216,7 +359,145 @@ void BluetoothManager::startAdvertising() {
     // Debug: Print what we're advertising
     Serial.print(F("Advertising service UUID: "));
     Serial.println(BT_SERVICE_UUID);
+}
+
+// =============================================================================
+// STATUS BEACON
+// =============================================================================
+
+void BluetoothManager::onNewReading() {
+    lastReadingTime = millis();
+    beaconCounter++;
+    
+    // Alerts of this reading stay on the beacon until a gateway has them;
+    // without a beacon there is nothing to hand over
+    alertLatch.onReading(currentData.alertFlags);
+    if (alertLatch.isPending() && settings.beaconEnabled && !settings.gatewayEnabled && radioStarted) {
+        startAckListen();
+    }
+}
+
+uint8_t BluetoothManager::buildBeaconPayload(uint8_t* out) {
+    BeaconStatus status;
+    status.deviceId = settings.deviceId;
+    status.batteryVoltage = currentData.batteryVoltage;
+    status.temperature = currentData.temperature;
+    status.beeState = currentData.beeState;
+    appTasks.lockAudio();
+    status.abscondingRisk = audioProcessor.getLastResult().abscondingRisk;
+    appTasks.unlockAudio();
+    status.alertFlags = currentData.alertFlags;
+    status.counter = beaconCounter;
+    status.alertLatch = alertLatch.getFlags();
+    status.alertSeq = alertLatch.getSeq();
+    
+    unsigned long ageMinutes = (millis() - lastReadingTime) / 60000UL;
+    status.readingAgeMinutes = lastReadingTime == 0 ? BEACON_AGE_UNKNOWN
+                             : min(ageMinutes, (unsigned long)BEACON_AGE_UNKNOWN);
+    uint8_t len = encodeBeaconPayload(status, out);
+    
+    // The gateway acknowledges the alert latches it has filed
+    if (bleGateway.isEnabled()) {
+        BeaconAck acks[BEACON_MAX_ACKS];
+        uint8_t count = bleGateway.getAcks(acks, BEACON_MAX_ACKS);
+        len += 2 * encodeBeaconAcks(acks, count, out + len);
+    }
+    return len;
+}
+
+void BluetoothManager::startBeacon() {
+    beaconPayloadLen = buildBeaconPayload(beaconPayload);
+    
+#ifdef NRF52_SERIES
+    Bluefruit.Advertising.stop();
+    Bluefruit.Advertising.clearData();
+    Bluefruit.ScanResponse.clearData();
+    
+    Bluefruit.Advertising.setType(BLE_GAP_ADV_TYPE_NONCONNECTABLE_NONSCANNABLE_UNDIRECTED);
+    Bluefruit.Advertising.addFlags(BLE_GAP_ADV_FLAGS_BR_EDR_NOT_SUPPORTED);
+    Bluefruit.Advertising.addManufacturerData(beaconPayload, beaconPayloadLen);
+    
+    // Interval is in 0.625 ms units; no fast phase for a beacon
+    uint16_t interval = (uint32_t)settings.beaconIntervalMs * 8 / 5;
+    Bluefruit.Advertising.setInterval(interval, interval);
+    Bluefruit.Advertising.setFastTimeout(0);
+    Bluefruit.Advertising.start(0);
+#endif
+    
+    state.status = BT_STATUS_BEACON;
+}
+
+void BluetoothManager::refreshBeacon() {
+    // Advertising data only changes on a restart, so only restart when
+    // the payload changed (new reading, or once a minute for the age)
+    uint8_t payload[BEACON_MAX_PAYLOAD];
+    uint8_t len = buildBeaconPayload(payload);
+    if (len != beaconPayloadLen || memcmp(payload, beaconPayload, len) != 0) {
+        startBeacon();
+    }
+}
+
+void BluetoothManager::startAckListen() {
+    if (bleGateway.isScanning()) return;
+#ifdef NRF52_SERIES
+    // Passive, for as long as the gateway takes to scan: its beacon
+    // carries the ack from its next scan on
+    Bluefruit.Scanner.setRxCallback(bluetoothAckScanCallback);
+    Bluefruit.Scanner.restartOnDisconnect(false);
+    Bluefruit.Scanner.filterMSD(BEACON_COMPANY_ID);
+    Bluefruit.Scanner.useActiveScan(false);
+    Bluefruit.Scanner.setInterval(160, 160);
+    Bluefruit.Scanner.start(BEACON_ACK_LISTEN_MS / 10);
+#endif
+    ackListening = true;
+    ackListenStart = millis();
+    ackReportLen = 0;
+}
+
+void BluetoothManager::stopAckListen() {
+#ifdef NRF52_SERIES
+    Bluefruit.Scanner.stop();
 #endif
+    ackListening = false;
+}
+
+void BluetoothManager::queueGatewayBeacon(const uint8_t* payload, uint8_t len) {
+    // Only what carries acks; the last one heard is enough
+    if (!ackListening || ackReportLen || len <= BEACON_PAYLOAD_SIZE || len > BEACON_MAX_PAYLOAD) return;
+    memcpy(ackReport, payload, len);
+    ackReportLen = len;
+}
+
+void BluetoothManager::setBeacon(bool enabled, uint16_t intervalMs) {
+    settings.beaconEnabled = enabled;
+    settings.beaconIntervalMs = constrain(intervalMs ? intervalMs : BEACON_DEFAULT_INTERVAL_MS,
+                                          BEACON_MIN_INTERVAL_MS, BEACON_MAX_INTERVAL_MS);
+    saveBluetoothSettings();
+    
+    Serial.print(F("Beacon: "));
+    Serial.print(enabled ? F("ON every ") : F("OFF"));
+    if (enabled) {
+        Serial.print(settings.beaconIntervalMs);
+        Serial.print(F(" ms, est. "));
+        Serial.print(estimateBeaconCurrentUa(settings.beaconIntervalMs, BEACON_PAYLOAD_SIZE), 1);
+        Serial.print(F(" uA"));
+    }
+    Serial.println();
+    
+    // Restart with the new interval on the next update() tick
+    if (state.status == BT_STATUS_BEACON) {
+        stopAdvertising();
+    }
+}
+
+void BluetoothManager::setGateway(bool enabled, uint8_t periodMin) {
+    settings.gatewayEnabled = enabled;
+    settings.gatewayPeriodMin = periodMin ? periodMin : GATEWAY_DEFAULT_PERIOD_MIN;
+    saveBluetoothSettings();
+    
+    // Neighbour logs live on the SD card
+    bool canLog = systemStatus && systemStatus->sdWorking;
+    bleGateway.setEnabled(enabled && canLog, settings.gatewayPeriodMin, settings.deviceId);
 }
 
 void BluetoothManager::stopAdvertising() {
@@ -240,11 +521,11 @@ void BluetoothManager::updateAdvertising() {
     // Adjust advertising based on power mode and battery level
     if (state.status != BT_STATUS_ADVERTISING) return;
     
+#ifdef NRF52_SERIES
     // Get current battery level
     extern SensorData currentData;
     float batteryLevel = getBatteryLevel(currentData.batteryVoltage);
     
-#ifdef NRF52_SERIES
     // Reduce advertising frequency when battery is low
     if (batteryLevel < 20) {
         Bluefruit.Advertising.setInterval(5000, 10000);  // Very slow advertising
@@ -260,8 +541,26 @@ void BluetoothManager::updateAdvertising() {
 // COMMAND HANDLING
 // =============================================================================
 
+void BluetoothManager::rejectCommand(uint8_t* data, uint16_t len) {
+    // Truncated arguments could be misread, so the command never runs
+    uint8_t requestId;
+    BleEncoding encoding;
+    if (!parseRequestHeader(data, len, requestId, encoding)) return;
+    currentRequestId = requestId;
+    currentEncoding = encoding;
+    
+    Serial.print(F("BT Command: 0x"));
+    Serial.print(data[0], HEX);
+    Serial.println(F(" refused, longer than the command characteristic"));
+    sendResponse(BT_RESP_TOO_LARGE);
+}
+
 void BluetoothManager::handleCommand(uint8_t* data, uint16_t len) {
-    if (len < 1) return;
+    uint8_t requestId;
+    BleEncoding encoding;
+    if (!parseRequestHeader(data, len, requestId, encoding)) return;
+    currentRequestId = requestId;
+    currentEncoding = encoding;
     
     BluetoothCommand cmd = (BluetoothCommand)data[0];
     Serial.print(F("BT Command: 0x"));
@@ -280,9 +579,22 @@ void BluetoothManager::handleCommand(uint8_t* data, uint16_t len) {
             sendCurrentData();
             break;
             
-        case BT_CMD_LIST_FILES:
-            sendFileList();
+        case BT_CMD_LIST_FILES: {
+            CatalogQuery query;
+            query.sort = (len >= 2) ? data[1] : (uint8_t)CATALOG_SORT_DIRECTORY;
+            if (query.sort > CATALOG_SORT_SIZE_DESC) {
+                sendResponse(BT_RESP_ERROR);
+                break;
+            }
+            query.pageSize = (len >= 3 && data[2]) ? min(data[2], (uint8_t)CATALOG_MAX_PAGE) : CATALOG_MAX_PAGE;
+            query.year = (len >= 5) ? getU16LE(&data[3]) : 0;
+            query.month = (len >= 6) ? data[5] : 0;
+            query.hasToken = (len >= 14);
+            query.tokenKey = query.hasToken ? getU32LE(&data[6]) : 0;
+            query.tokenTie = query.hasToken ? getU32LE(&data[10]) : 0;
+            sendFileList(query);
             break;
+        }
             
         case BT_CMD_GET_FILE:
             if (len > 1) {
@@ -304,9 +616,16 @@ void BluetoothManager::handleCommand(uint8_t* data, uint16_t len) {
             }
             break;
             
-        case BT_CMD_GET_ALERTS:
-            sendAlerts();
+        case BT_CMD_GET_ALERTS: {
+            AlertQuery query;
+            query.fromTime = (len >= 5) ? getU32LE(&data[1]) : 0;
+            query.toTime = (len >= 9) ? getU32LE(&data[5]) : 0;
+            query.typeMask = (len >= 10) ? data[9] : 0;
+            query.maxEvents = (len >= 11) ? data[10] : 0;
+            query.beforeSeq = (len >= 15) ? getU32LE(&data[11]) : 0;
+            sendAlerts(query);
             break;
+        }
             
         case BT_CMD_GET_DEVICE_INFO:
             sendDeviceInfo();
@@ -329,13 +648,21 @@ void BluetoothManager::handleCommand(uint8_t* data, uint16_t len) {
             break;
     
         case BT_CMD_SET_SETTING:
-            if (len >= 3) {  // Command + Setting ID + Value
+            if (len >= 6) {  // Command + Setting ID + f32 value
                 uint8_t settingId = data[1];
-                float value = *(float*)&data[2];  // or parse appropriately
+                uint32_t bits = getU32LE(&data[2]);
+                float value;
+                memcpy(&value, &bits, sizeof(value));
                 updateSetting(settingId, value);
+            } else {
+                sendResponse(BT_RESP_ERROR);
             }
             break;
 
+        case BT_CMD_SET_SETTINGS_BULK:
+            applySettingsBulk(&data[1], len - 1);
+            break;
+
         case BT_CMD_SET_DATE_TIME:
             if (len >= 7) {  // Command + 6 bytes (year, month, day, hour, minute, second)
                 uint16_t year = (data[1] << 8) | data[2];
@@ -421,6 +748,184 @@ void BluetoothManager::handleCommand(uint8_t* data, uint16_t len) {
             sendBeePresetList();
             break;
             
+        case BT_CMD_TRANSFER_START:
+            if (len > 6) {
+                uint32_t offset = getU32LE(&data[1]);
+                uint8_t window = data[5];
+                char filename[BT_XFER_FILENAME_LEN];
+                uint16_t nameLen = min(len - 6, BT_XFER_FILENAME_LEN - 1);
+                memcpy(filename, &data[6], nameLen);
+                filename[nameLen] = '\0';
+                startTransfer(filename, offset, window);
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
+        case BT_CMD_TRANSFER_ACK:
+            if (len >= 4) {
+                uint16_t nextExpected = getU16LE(&data[2]);
+                if (transfer.acknowledge(data[1], nextExpected)) {
+                    transfer.pump();
+                }
+            }
+            break;
+            
+        case BT_CMD_GET_LINK_INFO:
+            refreshLinkInfo();
+            sendLinkInfo();
+            break;
+            
+        case BT_CMD_LINK_BENCHMARK:
+            if (len >= 3) {
+                startBenchmark(getU16LE(&data[1]));
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
+        case BT_CMD_TRANSFER_ABORT:
+            if (len >= 2 && data[1] == transfer.getTransferId()) {
+                transfer.abort();
+                sendResponse(BT_RESP_OK);
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
+        case BT_CMD_STREAM_SUBSCRIBE:
+            if (len >= 12) {
+                uint64_t mask = ((uint64_t)getU32LE(&data[5]) << 32) | getU32LE(&data[1]);
+                if (stream.subscribe(mask, getU16LE(&data[9]), data[11])) {
+                    // Reply with the interval the link budget actually allows
+                    uint8_t reply[2];
+                    putU16LE(reply, stream.getEffectiveInterval(link.maxPacketSize, link.connInterval));
+                    sendResponse(BT_RESP_OK, reply, sizeof(reply));
+                    break;
+                }
+            }
+            sendResponse(BT_RESP_ERROR);
+            break;
+            
+        case BT_CMD_STREAM_UNSUBSCRIBE:
+            stream.unsubscribe();
+            sendResponse(BT_RESP_OK);
+            break;
+            
+        case BT_CMD_SYNC_START:
+            if (len >= 13) {
+                startSync(&data[1], getU32LE(&data[9]));
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
+        case BT_CMD_SET_BEACON:
+            if (len >= 2) {
+                setBeacon(data[1] != 0, (len >= 4) ? getU16LE(&data[2]) : 0);
+                
+                // Reply with the estimated average beacon current in 0.1 uA
+                uint8_t reply[2];
+                putU16LE(reply, settings.beaconEnabled
+                    ? (uint16_t)(estimateBeaconCurrentUa(settings.beaconIntervalMs, BEACON_PAYLOAD_SIZE) * 10)
+                    : 0);
+                sendResponse(BT_RESP_OK, reply, sizeof(reply));
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
+        case BT_CMD_QUERY_SERIES:
+            if (len >= 15) {
+                SeriesQuery query;
+                query.fromTime = getU32LE(&data[1]);
+                query.toTime = getU32LE(&data[5]);
+                query.bucketSeconds = getU32LE(&data[9]);
+                query.fieldMask = data[13];
+                query.aggMask = data[14];
+                startSeriesQuery(query);
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
+        case BT_CMD_GET_QUEUE_STATS:
+            sendQueueStats();
+            break;
+            
+        case BT_CMD_GET_NEIGHBOURS:
+            sendNeighbours();
+            break;
+            
+        case BT_CMD_SET_ADAPTIVE_INTERVAL:
+            if (len >= 4) {
+                adaptiveInterval.configure(data[1] != 0, getU16LE(&data[2]), (len >= 5) ? data[4] : 0);
+                
+                // Reply with the interval now in force and its daily cost in 0.1 mAh
+                uint8_t interval = adaptiveInterval.getInterval(systemSettings->logInterval);
+                uint8_t reply[3];
+                reply[0] = interval;
+                putU16LE(&reply[1], (uint16_t)(adaptiveInterval.estimateMahPerDay(interval) * 10));
+                sendResponse(BT_RESP_OK, reply, sizeof(reply));
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
+        case BT_CMD_SET_WAKE_SCHEDULE:
+            if (len >= 6) {
+                wakeSchedule.configure(getU32LE(&data[1]), (WakeMode)data[5],
+                                       (len >= 8) ? getU16LE(&data[6]) : 0);
+                
+                // Reply with the upcoming wake times (RTC unix time)
+                uint8_t reply[WAKE_PREVIEW_COUNT * 4];
+                uint32_t times[WAKE_PREVIEW_COUNT];
+                uint32_t now = systemStatus->rtcWorking ? rtc.now().unixtime() : 0;
+                uint32_t defaultS = adaptiveInterval.getInterval(systemSettings->logInterval) * 60UL;
+                wakeSchedule.upcoming(now, defaultS, times, WAKE_PREVIEW_COUNT);
+                for (uint8_t i = 0; i < WAKE_PREVIEW_COUNT; i++) {
+                    putU32LE(&reply[i * 4], times[i]);
+                }
+                sendResponse(BT_RESP_OK, reply, sizeof(reply));
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
+        case BT_CMD_SIMULATE_POWER:
+            startPowerSimulation(data, len);
+            break;
+            
+        case BT_CMD_GET_POWER_PROFILE:
+            sendPowerProfile();
+            if (len >= 2 && data[1]) {
+                phaseProfiler.reset();
+            }
+            break;
+            
+        case BT_CMD_SET_GATEWAY:
+            if (len >= 2) {
+                setGateway(data[1] != 0, (len >= 3) ? data[2] : 0);
+                
+                // Reply with the estimated average scan current in 0.1 uA
+                uint8_t reply[2];
+                putU16LE(reply, bleGateway.isEnabled()
+                    ? (uint16_t)(bleGateway.estimateScanCurrentUa() * 10) : 0);
+                sendResponse(BT_RESP_OK, reply, sizeof(reply));
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
+        case BT_CMD_SYNC_COMMIT:
+            // Sent by the client only after the records are stored on its side
+            if (len >= 13 && recordStore.commitClientCursor(&data[1], getU32LE(&data[9]), rtc.now().unixtime())) {
+                sendResponse(BT_RESP_OK);
+            } else {
+                sendResponse(BT_RESP_ERROR);
+            }
+            break;
+            
         default:
             sendResponse(BT_RESP_ERROR);
             break;
@@ -429,40 +934,216 @@ void BluetoothManager::handleCommand(uint8_t* data, uint16_t len) {
 
 void BluetoothManager::sendAllSettings() {
     extern BeeType detectCurrentBeeType(const SystemSettings& settings);
-    extern const char* getBeeTypeName(BeeType beeType);
-    
-    BeeType currentType = detectCurrentBeeType(*systemSettings);
-    
-    char jsonSettings[BT_CHUNK_SIZE];
-    
-    snprintf(jsonSettings, sizeof(jsonSettings),
-        "{"
-        "\"beeType\":\"%s\","              // NEW FIELD
-        "\"tempOffset\":%.1f,"
-        "\"humidityOffset\":%.1f,"
-        "\"audioSensitivity\":%d,"
-        "\"queenFreqMin\":%d,"
-        "\"queenFreqMax\":%d,"
-        "\"swarmFreqMin\":%d,"
-        "\"swarmFreqMax\":%d,"
-        "\"logInterval\":%d,"
-        "\"displayTimeout\":%d,"
-        "\"fieldMode\":%s"
-        "}",
-        getBeeTypeName(currentType),        // NEW FIELD
-        systemSettings->tempOffset,
-        systemSettings->humidityOffset,
-        systemSettings->audioSensitivity,
-        systemSettings->queenFreqMin,
-        systemSettings->queenFreqMax,
-        systemSettings->swarmFreqMin,
-        systemSettings->swarmFreqMax,
-        systemSettings->logInterval,
-        systemSettings->displayTimeoutMin,
-        systemSettings->fieldModeEnabled ? "true" : "false"
-    );
-    
-    sendResponse(BT_RESP_OK, (uint8_t*)jsonSettings, strlen(jsonSettings));
+    
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.putF32(BT_ST_tempOffset, systemSettings->tempOffset);
+    w.putF32(BT_ST_humidityOffset, systemSettings->humidityOffset);
+    w.putU8(BT_ST_audioSensitivity, systemSettings->audioSensitivity);
+    w.putU16(BT_ST_queenFreqMin, systemSettings->queenFreqMin);
+    w.putU16(BT_ST_queenFreqMax, systemSettings->queenFreqMax);
+    w.putU16(BT_ST_swarmFreqMin, systemSettings->swarmFreqMin);
+    w.putU16(BT_ST_swarmFreqMax, systemSettings->swarmFreqMax);
+    w.putU8(BT_ST_logInterval, systemSettings->logInterval);
+    w.putU8(BT_ST_displayTimeout, systemSettings->displayTimeoutMin);
+    w.putBool(BT_ST_fieldMode, systemSettings->fieldModeEnabled);
+    w.putF32(BT_ST_tempMin, systemSettings->tempMin);
+    w.putF32(BT_ST_tempMax, systemSettings->tempMax);
+    w.putF32(BT_ST_humidityMin, systemSettings->humidityMin);
+    w.putF32(BT_ST_humidityMax, systemSettings->humidityMax);
+    w.putU8(BT_ST_stressThreshold, systemSettings->stressThreshold);
+    w.putU8(BT_ST_beeType, detectCurrentBeeType(*systemSettings));
+    w.putU8(BT_ST_imageVersion, SETTINGS_IMAGE_VERSION);
+    w.putU32(BT_ST_imageCrc, settingsImageCrc(*systemSettings));
+    w.finish();
+}
+
+void BluetoothManager::sendQueueStats() {
+    const NotifyQueueStats& q = notifyQueue.getStats();
+    
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.putU32(BT_QS_sent, q.sent);
+    w.putU32(BT_QS_queued, q.queued);
+    w.putU32(BT_QS_retried, q.retried);
+    w.putU32(BT_QS_rejected, q.rejected);
+    w.putU32(BT_QS_dropped, q.dropped);
+    w.putU8(BT_QS_highWater, q.highWater);
+    w.putU8(BT_QS_pending, notifyQueue.getPending());
+    w.putU32(BT_QS_cmdAccepted, commandQueue.getAccepted());
+    w.putU32(BT_QS_cmdDropped, commandQueue.getDropped());
+    w.putU32(BT_QS_cmdTooLong, commandQueue.getRejected());
+    w.finish();
+}
+
+void BluetoothManager::sendNeighbours() {
+    uint32_t now = rtc.now().unixtime();
+    
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.beginList(BT_NL_neighbours);
+    for (uint8_t i = 0; i < bleGateway.getNeighbourCount(); i++) {
+        const GatewayNeighbour* n = bleGateway.getNeighbour(i);
+        w.beginRecord();
+        w.putU8(BT_NB_deviceId, n->deviceId);
+        w.putBool(BT_NB_online, bleGateway.isOnline(*n, now));
+        w.putU32(BT_NB_lastSeen, n->lastSeen);
+        w.putU32(BT_NB_lastSample, n->lastSample);
+        w.putI32(BT_NB_rssi, n->rssi);
+        w.putF32(BT_NB_temperature, n->status.temperature);
+        w.putF32(BT_NB_battery, n->status.batteryVoltage);
+        w.putU8(BT_NB_beeState, n->status.beeState);
+        w.putU8(BT_NB_abscondingRisk, n->status.abscondingRisk);
+        w.putU8(BT_NB_alertFlags, n->status.alertFlags);
+        w.endRecord();
+    }
+    w.endList();
+    
+    w.putBool(BT_NL_enabled, bleGateway.isEnabled());
+    w.putU8(BT_NL_periodMin, bleGateway.getPeriodMin());
+    w.putF32(BT_NL_scanCurrent, bleGateway.isEnabled() ? bleGateway.estimateScanCurrentUa() : 0.0f);
+    w.finish();
+}
+
+void BluetoothManager::sendPowerProfile() {
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.beginList(BT_PP_phases);
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        const PhaseStats& s = phaseProfiler.getStats(i);
+        if (s.count == 0) continue;
+        w.beginRecord();
+        w.putU8(BT_PH_phase, i);
+        w.putStr(BT_PH_name, PhaseProfiler::getPhaseName(i));
+        w.putU32(BT_PH_count, s.count);
+        w.putF32(BT_PH_avgMs, (float)s.totalUs / s.count / 1000.0f);
+        w.putU32(BT_PH_p90Ms, phaseProfiler.getPercentileMs(i, 90));
+        w.putF32(BT_PH_maxMs, s.maxUs / 1000.0f);
+        w.putF32(BT_PH_current, phaseProfiler.getPhaseCurrent((WakePhase)i));
+        w.putF32(BT_PH_mAhPerDay, phaseProfiler.getPhaseMahPerDay(i));
+        w.endRecord();
+    }
+    w.endList();
+    
+    w.putU32(BT_PP_cycles, phaseProfiler.getCycles());
+    w.putU32(BT_PP_firstTime, phaseProfiler.getFirstTime());
+    w.putU32(BT_PP_lastTime, phaseProfiler.getLastTime());
+    w.putF32(BT_PP_avgCurrent, phaseProfiler.getAverageCurrentMa());
+    w.putF32(BT_PP_mAhPerDay, phaseProfiler.getMahPerDay());
+    w.putBool(BT_PP_measured, phaseProfiler.hasEnergyData());
+    w.putU8(BT_PP_interval, adaptiveInterval.getInterval(systemSettings->logInterval));
+    w.putBool(BT_PP_adaptive, adaptiveInterval.isEnabled());
+    w.putU8(BT_PP_activity, adaptiveInterval.getLastActivity());
+    w.putU16(BT_PP_budgetMah, adaptiveInterval.getBudget());
+    w.putF32(BT_PP_bootMs, fastBoot.getLatencyUs() / 1000.0f);
+    w.putU32(BT_PP_fastBoots, fastBoot.getFastBoots());
+    w.putF32(BT_PP_fastBootMs, fastBoot.getAverageLatencyMs());
+    w.putU8(BT_PP_domainsOn, powerDomains.getOnMask());
+    w.putF32(BT_PP_domainMa, powerDomains.getAverageCurrentMa());
+    w.finish();
+}
+
+void BluetoothManager::startPowerSimulation(const uint8_t* data, uint16_t len) {
+    if (jobBusy()) {
+        sendResponse(BT_RESP_BUSY);
+        return;
+    }
+    
+    // Every argument is optional: 40 days, the schedule in force, 25 C and
+    // the battery model's charge
+    SimConfig config;
+    config.days = (len >= 2 && data[1]) ? data[1] : SIM_DEFAULT_DAYS;
+    config.intervalS = (len >= 6) ? getU32LE(&data[2]) : 0;
+    config.tempC = (len >= 7) ? (int8_t)data[6] : BATTERY_REF_TEMP_C;
+    config.startSoc = (len >= 8 && data[7]) ? data[7] / 100.0f : -1.0f;
+    
+    uint32_t now = systemStatus->rtcWorking ? rtc.now().unixtime() : 0;
+    powerSimulator.begin(config, now, adaptiveInterval.getInterval(systemSettings->logInterval));
+    
+    // Accept now; the result arrives as a second response with the same
+    // request id once the job has simulated every day
+    sendResponse(BT_RESP_OK);
+    
+    job.type = BT_JOB_POWER_SIMULATION;
+    job.requestId = currentRequestId;
+    job.encoding = currentEncoding;
+    job.done = 0;
+    job.total = powerSimulator.getDays();
+    reportProgress(true);
+}
+
+// The simulation result can be more frames than the notify queue holds on
+// a small MTU. It is rendered again on each update(); frames queued on an
+// earlier pass are skipped and the first refusal ends the pass, so the
+// writer never sees a failure and the response goes out whole, in order.
+static struct {
+    uint8_t skip;            // Frames already queued
+    uint8_t index;           // Frame being rendered this pass
+    bool refused;
+} resumableResult;
+
+static bool sendResumableFrame(const uint8_t* data, uint16_t len) {
+    if (resumableResult.refused) return true;
+    if (resumableResult.index++ < resumableResult.skip) return true;
+    if (!bluetoothNotifyData(data, len)) {
+        resumableResult.refused = true;
+        return true;
+    }
+    resumableResult.skip++;
+    return true;
+}
+
+void BluetoothManager::stepPowerSimulationJob() {
+    if (powerSimulator.isRunning()) {
+        bool complete = powerSimulator.step(SIM_DAYS_PER_STEP);
+        job.done = powerSimulator.getDay();
+        if (!complete) return;
+        
+        powerSimulator.printReport();
+        job.frameSeq = 0;
+    }
+    const SimResult& r = powerSimulator.getResult();
+    
+    resumableResult.skip = job.frameSeq;
+    resumableResult.index = 0;
+    resumableResult.refused = false;
+    BleResponseWriter w(sendResumableFrame, link.maxPacketSize, BT_RESP_OK,
+                        job.requestId, (BleEncoding)job.encoding);
+    w.beginList(BT_PS_phases);
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        w.beginRecord();
+        w.putU8(BT_SP_phase, i);
+        w.putStr(BT_SP_name, PhaseProfiler::getPhaseName(i));
+        w.putF32(BT_SP_hours, r.phaseHours[i]);
+        w.putF32(BT_SP_mAh, r.phaseMah[i]);
+        w.endRecord();
+    }
+    w.endList();
+    
+    w.beginList(BT_PS_curve);
+    for (uint16_t d = 0; d <= r.days; d++) {
+        w.beginRecord();
+        w.putU16(BT_SC_day, d);
+        w.putU8(BT_SC_soc, r.socByDay[d]);
+        w.endRecord();
+    }
+    w.endList();
+    
+    w.putU16(BT_PS_days, r.days);
+    w.putU32(BT_PS_intervalS, r.intervalS);
+    w.putU32(BT_PS_wakes, r.wakes);
+    w.putU32(BT_PS_flushes, r.flushes);
+    w.putF32(BT_PS_totalMah, r.totalMah);
+    w.putF32(BT_PS_avgCurrent, r.avgCurrentMa);
+    w.putF32(BT_PS_usableMah, r.usableMah);
+    w.putF32(BT_PS_daysToEmpty, r.daysToEmpty);
+    w.putBool(BT_PS_measured, r.measured);
+    w.putU32(BT_PS_runMs, r.runMs);
+    w.putU32(BT_PS_maxStepUs, r.maxStepUs);
+    w.finish();
+    
+    job.frameSeq = resumableResult.skip;
+    if (!resumableResult.refused) finishJob();
 }
 
 void BluetoothManager::sendFileData(const char* filename) {
@@ -470,23 +1151,28 @@ void BluetoothManager::sendFileData(const char* filename) {
         sendResponse(BT_RESP_ERROR);
         return;
     }
-    
-    SDLib::File file = SD.open(filename, FILE_READ);
-    if (!file) {
-        sendResponse(BT_RESP_NOT_FOUND);
+    if (jobBusy()) {
+        sendResponse(BT_RESP_BUSY);
         return;
     }
     
-    // Send file in chunks
-    uint8_t buffer[BT_CHUNK_SIZE - 1];
-    while (file.available()) {
-        size_t bytesRead = file.read(buffer, sizeof(buffer));
-        sendResponse(BT_RESP_OK, buffer, bytesRead);
-        delay(50); // Small delay between chunks
+    job.file = SD.open(filename, FILE_READ);
+    if (!job.file) {
+        sendResponse(BT_RESP_NOT_FOUND);
+        return;
     }
     
-    file.close();
-    Serial.print(F("File sent: "));
+    // File content goes out as one multi-frame BT_RESP_OK response,
+    // a few frames per update() - see stepFileStreamJob()
+    job.type = BT_JOB_FILE_STREAM;
+    job.requestId = currentRequestId;
+    job.frameSeq = 0;
+    job.done = 0;
+    job.total = job.file.size();
+    state.status = BT_STATUS_TRANSFERRING;
+    reportProgress(true);
+    
+    Serial.print(F("File stream started: "));
     Serial.println(filename);
 }
 
@@ -497,6 +1183,7 @@ void BluetoothManager::deleteFile(const char* filename) {
     }
     
     if (SD.remove(filename)) {
+        recordStore.invalidate();   // Re-scan in case the journal was removed
         sendResponse(BT_RESP_OK);
         Serial.print(F("File deleted: "));
         Serial.println(filename);
@@ -517,41 +1204,31 @@ void BluetoothManager::sendFileInfo(const char* filename) {
         return;
     }
     
-    char fileInfo[BT_CHUNK_SIZE];
-    snprintf(fileInfo, sizeof(fileInfo),
-        "{"
-        "\"name\":\"%s\","
-        "\"size\":%lu,"
-        "\"exists\":true"
-        "}",
-        filename,
-        file.size()
-    );
-    
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.putStr(BT_FI_name, filename);
+    w.putU32(BT_FI_size, file.size());
+    w.putBool(BT_FI_exists, true);
     file.close();
-    sendResponse(BT_RESP_OK, (uint8_t*)fileInfo, strlen(fileInfo));
+    w.finish();
 }
 
 void BluetoothManager::sendBeePresetList() {
     extern const BeePresetInfo BEE_PRESETS[];
     extern const int NUM_BEE_PRESETS;
     
-    String presetList = "{\"presets\":[";
-    
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.beginList(BT_PL_presets);
     for (int i = 1; i < NUM_BEE_PRESETS; i++) { // Skip custom (index 0)
-        if (i > 1) presetList += ",";
-        
-        presetList += "{\"id\":";
-        presetList += i;
-        presetList += ",\"name\":\"";
-        presetList += BEE_PRESETS[i].name;
-        presetList += "\",\"desc\":\"";
-        presetList += BEE_PRESETS[i].description;
-        presetList += "\"}";
+        w.beginRecord();
+        w.putU8(BT_PR_id, i);
+        w.putStr(BT_PR_name, BEE_PRESETS[i].name);
+        w.putStr(BT_PR_description, BEE_PRESETS[i].description);
+        w.endRecord();
     }
-    
-    presetList += "]}";
-    sendResponse(BT_RESP_OK, (uint8_t*)presetList.c_str(), presetList.length());
+    w.endList();
+    w.finish();
 }
 
 void BluetoothManager::setDateTime(uint16_t year, uint8_t month, uint8_t day, 
@@ -569,80 +1246,145 @@ void BluetoothManager::setDateTime(uint16_t year, uint8_t month, uint8_t day,
 }
 
 void BluetoothManager::startAudioCalibration(uint8_t durationSeconds) {
+    if (jobBusy()) {
+        sendResponse(BT_RESP_BUSY);
+        return;
+    }
+    
     Serial.print(F("Starting audio calibration for "));
     Serial.print(durationSeconds);
     Serial.println(F(" seconds"));
     
-    // Use your existing calibration function
-    extern void calibrateAudioLevels(SystemSettings& settings, int durationSeconds);
-    calibrateAudioLevels(*systemSettings, durationSeconds);
-    
+    // Accept now; the result arrives as a second response with the same
+    // request id once the job finishes
     sendResponse(BT_RESP_OK);
-    Serial.println(F("Audio calibration completed via Bluetooth"));
+    
+    beginAudioCalibration(job.calibration, durationSeconds);
+    job.type = BT_JOB_AUDIO_CALIBRATION;
+    job.requestId = currentRequestId;
+    job.encoding = currentEncoding;
+    job.done = 0;
+    job.total = durationSeconds;
+    reportProgress(true);
+}
+
+void BluetoothManager::startSync(const uint8_t* clientId, uint32_t cursor) {
+    if (!systemStatus || !systemStatus->sdWorking) {
+        sendResponse(BT_RESP_ERROR);
+        return;
+    }
+    if (jobBusy()) {
+        sendResponse(BT_RESP_BUSY);
+        return;
+    }
+    if (link.maxPacketSize < BT_SYNC_HEADER_SIZE + RECORD_SIZE) {
+        sendResponse(BT_RESP_TOO_LARGE);   // Needs an MTU exchange first
+        return;
+    }
+    
+    if (cursor == SYNC_CURSOR_STORED) {
+        cursor = recordStore.getClientCursor(clientId);
+    }
+    uint32_t count = recordStore.countAfter(cursor);
+    if (!recordStore.openAfter(job.file, cursor)) {
+        sendResponse(BT_RESP_ERROR);
+        return;
+    }
+    uint32_t lastSeq = recordStore.getLastSeq();
+    
+    // [firstSeq u32][lastSeq u32][count u32][recordSize u8]. firstSeq above
+    // cursor + 1 means older records are no longer on the card.
+    uint8_t reply[13];
+    putU32LE(&reply[0], lastSeq - count + 1);
+    putU32LE(&reply[4], lastSeq);
+    putU32LE(&reply[8], count);
+    reply[12] = RECORD_SIZE;
+    sendResponse(BT_RESP_OK, reply, sizeof(reply));
+    
+    job.type = BT_JOB_RECORD_SYNC;
+    job.requestId = currentRequestId;
+    job.done = 0;
+    job.total = count;
+    job.syncCursor = lastSeq - count;
+    job.syncCrc = 0;
+    state.status = BT_STATUS_TRANSFERRING;
+    reportProgress(true);
+    
+    Serial.print(F("Record sync: "));
+    Serial.print(count);
+    Serial.print(F(" records after "));
+    Serial.println(cursor);
+}
+
+void BluetoothManager::startSeriesQuery(const SeriesQuery& query) {
+    if (!systemStatus || !systemStatus->sdWorking) {
+        sendResponse(BT_RESP_ERROR);
+        return;
+    }
+    if (jobBusy()) {
+        sendResponse(BT_RESP_BUSY);
+        return;
+    }
+    if (!validateSeriesQuery(query)) {
+        sendResponse(BT_RESP_ERROR);
+        return;
+    }
+    uint8_t bucketSize = seriesBucketSize(query);
+    if (link.maxPacketSize < BT_SERIES_HEADER_SIZE + bucketSize) {
+        sendResponse(BT_RESP_TOO_LARGE);   // Needs an MTU exchange first
+        return;
+    }
+    
+    unsigned long started = millis();
+    if (!recordStore.openAfter(job.file, 0)) {
+        sendResponse(BT_RESP_ERROR);
+        return;
+    }
+    
+    // The journal is in time order, so the range start is a binary search
+    // and the scan stops at the first record past the range end
+    uint32_t firstSeq = recordStore.findTime(job.file, query.fromTime);
+    uint32_t lastSeq = recordStore.getLastSeq();
+    uint32_t toScan = (firstSeq <= lastSeq) ? lastSeq - firstSeq + 1 : 0;
+    
+    // [buckets u32][bucketSize u8][fieldMask u8][aggMask u8][maxRecords u32]
+    uint8_t reply[11];
+    putU32LE(&reply[0], seriesBucketCount(query));
+    reply[4] = bucketSize;
+    reply[5] = query.fieldMask;
+    reply[6] = query.aggMask;
+    putU32LE(&reply[7], toScan);
+    sendResponse(BT_RESP_OK, reply, sizeof(reply));
+    
+    series.begin(query);
+    seriesPending = false;
+    seriesPacketLen = BT_SERIES_HEADER_SIZE;
+    seriesPacket[2] = 0;
+    
+    job.type = BT_JOB_SERIES_QUERY;
+    job.requestId = currentRequestId;
+    job.done = 0;
+    job.total = toScan;
+    job.syncCursor = firstSeq - 1;
+    job.seriesBuckets = 0;
+    job.seriesBytes = 0;
+    job.startedAt = started;
+    state.status = BT_STATUS_TRANSFERRING;
+    reportProgress(true);
+    
+    Serial.print(F("Series query: up to "));
+    Serial.print(toScan);
+    Serial.print(F(" records from seq "));
+    Serial.println(firstSeq);
 }
 
 void BluetoothManager::updateSetting(uint8_t settingId, float value) {
-    switch (settingId) {
-        case 1: // Temperature offset
-            systemSettings->tempOffset = constrain(value, -10.0f, 10.0f);
-            break;
-        case 2: // Humidity offset
-            systemSettings->humidityOffset = constrain(value, -20.0f, 20.0f);
-            break;
-        case 3: // Audio sensitivity
-            systemSettings->audioSensitivity = constrain((uint8_t)value, 0, 10);
-            break;
-        case 4: // Queen freq min
-            systemSettings->queenFreqMin = constrain((uint16_t)value, 50, 1000);
-            break;
-        case 5: // Queen freq max
-            systemSettings->queenFreqMax = constrain((uint16_t)value, 50, 1000);
-            break;
-        case 6: // Swarm freq min
-            systemSettings->swarmFreqMin = constrain((uint16_t)value, 50, 1000);
-            break;
-        case 7: // Swarm freq max
-            systemSettings->swarmFreqMax = constrain((uint16_t)value, 50, 1000);
-            break;
-        case 8: // Log interval
-            {
-                uint8_t interval = (uint8_t)value;
-                if (interval == 5 || interval == 10 || interval == 30 || interval == 60) {
-                    systemSettings->logInterval = interval;
-                } else {
-                    sendResponse(BT_RESP_ERROR);
-                    return;
-                }
-            }
-            break;
-        case 9: // Display timeout
-            systemSettings->displayTimeoutMin = constrain((uint8_t)value, 1, 30);
-            break;
-        case 10: // Field mode
-            systemSettings->fieldModeEnabled = (value > 0);
-            break;
-        case 11: // Temperature min threshold
-            systemSettings->tempMin = constrain(value, -10.0f, 40.0f);
-            break;
-        case 12: // Temperature max threshold
-            systemSettings->tempMax = constrain(value, 0.0f, 60.0f);
-            break;
-        case 13: // Humidity min threshold
-            systemSettings->humidityMin = constrain(value, 0.0f, 90.0f);
-            break;
-        case 14: // Humidity max threshold
-            systemSettings->humidityMax = constrain(value, 20.0f, 100.0f);
-            break;
-        case 15: // Stress threshold
-            systemSettings->stressThreshold = constrain((uint8_t)value, 0, 100);
-            break;
-        default:
-            sendResponse(BT_RESP_ERROR);
-            return;
+    if (value != value || !applySettingValue(*systemSettings, settingId, value)) {
+        sendResponse(BT_RESP_ERROR);
+        return;
     }
     
     // Validate settings after update
-    extern void validateSettings(SystemSettings& settings);
     validateSettings(*systemSettings);
     
     // Save to flash memory
@@ -657,245 +1399,731 @@ void BluetoothManager::updateSetting(uint8_t settingId, float value) {
     Serial.println(value);
 }
 
+void BluetoothManager::applySettingsBulk(const uint8_t* data, uint16_t len) {
+    // Everything is applied to a staged copy; the live settings change
+    // only if the whole transaction is accepted
+    SystemSettings staged = *systemSettings;
+    uint8_t badId = 0;
+    bool ok = false;
+    
+    if (len >= 1 && data[0] == BT_SETTINGS_IMAGE) {
+        ok = decodeSettingsImage(&data[1], len - 1, staged, badId);
+    } else if (len >= 2 && data[0] == BT_SETTINGS_PAIRS) {
+        uint8_t count = data[1];
+        ok = count > 0 && count <= BT_SETTINGS_MAX_PAIRS && len >= 2 + count * BT_SETTINGS_PAIR_SIZE;
+        for (uint8_t i = 0; ok && i < count; i++) {
+            const uint8_t* pair = &data[2 + i * BT_SETTINGS_PAIR_SIZE];
+            uint32_t bits = getU32LE(&pair[1]);
+            float value;
+            memcpy(&value, &bits, sizeof(value));
+            // Out of range rejects the batch; only the single-setting
+            // command clamps
+            if (!isSettingValueValid(pair[0], value) || !applySettingValue(staged, pair[0], value)) {
+                badId = pair[0];
+                ok = false;
+            }
+        }
+    }
+    
+    // Cross-field rules (min < max pairs) are checked on the result as a
+    // whole; validateSettings repairs rather than rejects, so any repair
+    // means the transaction was inconsistent
+    if (ok) {
+        SystemSettings checked = staged;
+        validateSettings(checked);
+        ok = settingsImageCrc(checked) == settingsImageCrc(staged);
+    }
+    
+    if (!ok) {
+        Serial.print(F("Bulk settings rejected, id "));
+        Serial.println(badId);
+        sendResponse(BT_RESP_ERROR, &badId, 1);
+        return;
+    }
+    
+    *systemSettings = staged;
+    saveSettings(*systemSettings);
+    
+    Serial.print(F("Bulk settings applied, crc 0x"));
+    Serial.println(settingsImageCrc(*systemSettings), HEX);
+    
+    // Acknowledge with the resulting settings and image checksum
+    sendAllSettings();
+}
+
 void BluetoothManager::sendResponse(BluetoothResponse response, uint8_t* data, uint16_t len) {
-#ifdef NRF52_SERIES
     if (!state.clientConnected) {
         Serial.println(F("Cannot send response - no client connected"));
         return;
     }
     
+    // Single-frame response: [resp][requestId][last|0][payload]
     uint8_t buffer[BT_CHUNK_SIZE];
     buffer[0] = (uint8_t)response;
+    buffer[1] = currentRequestId;
+    buffer[2] = BT_FRAME_LAST;
     
+    uint16_t actualLen = 0;
     if (data && len > 0) {
-        uint16_t actualLen = min(len, (uint16_t)(BT_CHUNK_SIZE - 1));
-        memcpy(&buffer[1], data, actualLen);
-        
-        if (dataCharacteristic.notify(buffer, actualLen + 1)) {
-            state.totalDataTransferred += actualLen + 1;
-            Serial.print(F("BT: Sent "));
-            Serial.print(actualLen + 1);
-            Serial.println(F(" bytes"));
-        } else {
-            Serial.println(F("BT: Failed to send data"));
-        }
-    } else {
-        if (dataCharacteristic.notify(buffer, 1)) {
-            state.totalDataTransferred += 1;
-            Serial.print(F("BT: Sent response 0x"));
-            Serial.println(response, HEX);
-        } else {
-            Serial.println(F("BT: Failed to send response"));
-        }
+        actualLen = min(len, (uint16_t)(link.maxPacketSize - BT_FRAME_HEADER_SIZE));
+        memcpy(&buffer[BT_FRAME_HEADER_SIZE], data, actualLen);
     }
-#else
-    Serial.print(F("BT: Would send response 0x"));
-    Serial.print(response, HEX);
-    if (data && len > 0) {
-        Serial.print(F(" with "));
-        Serial.print(len);
-        Serial.print(F(" bytes"));
+    
+    if (notifyResponse(buffer, actualLen + BT_FRAME_HEADER_SIZE)) {
+        state.totalDataTransferred += actualLen + BT_FRAME_HEADER_SIZE;
+        Serial.print(F("BT: Sent response 0x"));
+        Serial.print(response, HEX);
+        Serial.print(F(", "));
+        Serial.print(actualLen + BT_FRAME_HEADER_SIZE);
+        Serial.println(F(" bytes"));
+    } else {
+        Serial.println(F("BT: Failed to send response"));
     }
-    Serial.println(F(" (platform not supported)"));
-#endif
+}
+
+bool BluetoothManager::notifyData(const uint8_t* data, uint16_t len) {
+    // Streamed packets; false means the notification queue is full and
+    // the caller should retry later
+    return notifyQueue.send(data, len);
+}
+
+bool BluetoothManager::notifyResponse(const uint8_t* data, uint16_t len) {
+    // Response frames are not regenerated, so a refusal is a loss
+    return notifyQueue.sendOrDrop(data, len);
+}
+
+bool BluetoothManager::notifyRaw(const uint8_t* data, uint16_t len) {
+    // false means the transport's TX buffers are full
+    return transport && transport->notifyData(data, len);
+}
+
+bool BluetoothManager::queueCommand(const uint8_t* data, uint16_t len) {
+    if (commandQueue.push(data, len)) return true;
+    Serial.println(F("BT: command queue full, command dropped"));
+    return false;
 }
 
 void BluetoothManager::sendCurrentData() {
     extern SensorData currentData;
     extern RTC_PCF8523 rtc;
     
-    char jsonData[BT_CHUNK_SIZE];
-    
-    // Create JSON response with current data
-    snprintf(jsonData, sizeof(jsonData),
-        "{"
-        "\"timestamp\":%lu,"
-        "\"temperature\":%.1f,"
-        "\"humidity\":%.1f,"
-        "\"pressure\":%.1f,"
-        "\"frequency\":%d,"
-        "\"soundLevel\":%d,"
-        "\"beeState\":\"%s\","
-        "\"battery\":%.2f,"
-        "\"alerts\":\"0x%02X\""
-        "}",
-        systemStatus && systemStatus->rtcWorking ? rtc.now().unixtime() : millis()/1000,
-        currentData.temperature,
-        currentData.humidity,
-        currentData.pressure,
-        currentData.dominantFreq,
-        currentData.soundLevel,
-        getBeeStateString(currentData.beeState),
-        currentData.batteryVoltage,
-        currentData.alertFlags
-    );
-    
-    sendResponse(BT_RESP_OK, (uint8_t*)jsonData, strlen(jsonData));
-    
-    state.totalDataTransferred += strlen(jsonData);
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.putU32(BT_CD_timestamp, systemStatus && systemStatus->rtcWorking ? rtc.now().unixtime() : millis()/1000);
+    w.putF32(BT_CD_temperature, currentData.temperature);
+    w.putF32(BT_CD_humidity, currentData.humidity);
+    w.putF32(BT_CD_pressure, currentData.pressure);
+    w.putU16(BT_CD_dominantFreq, currentData.dominantFreq);
+    w.putU8(BT_CD_soundLevel, currentData.soundLevel);
+    w.putU8(BT_CD_beeState, currentData.beeState);
+    w.putF32(BT_CD_battery, currentData.batteryVoltage);
+    w.putU8(BT_CD_alertFlags, currentData.alertFlags);
+    w.finish();
+    
+    state.totalDataTransferred += w.getTotalBytes();
     Serial.println(F("Sent current data via Bluetooth"));
 }
 
 void BluetoothManager::sendDeviceInfo() {
-    char deviceInfo[BT_CHUNK_SIZE];
-    
-    snprintf(deviceInfo, sizeof(deviceInfo),
-    "{"
-    "\"device\":\"%s\","
-    "\"deviceId\":%d,"
-    "\"firmware\":\"v2.0\","
-    "\"uptime\":%lu,"
-    "\"btEnabled\":%s,"
-    "\"btConnections\":%lu,"
-    "\"freeMemory\":%d,"
-    "\"sdCard\":%s"
-    "}",
-    getDeviceName().c_str(),
-    settings.deviceId,
-    millis() / 1000,
-    settings.enabled ? "true" : "false",
-    state.totalConnections,
-    getFreeMemory(),
-    (systemStatus && systemStatus->sdWorking) ? "true" : "false"
-    );
-    
-    sendResponse(BT_RESP_OK, (uint8_t*)deviceInfo, strlen(deviceInfo));
-}
-
-void BluetoothManager::sendFileList() {
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.putU8(BT_DI_protocol, BT_PROTOCOL_VERSION);
+    w.putStr(BT_DI_device, getDeviceName().c_str());
+    w.putU8(BT_DI_deviceId, settings.deviceId);
+    w.putStr(BT_DI_firmware, "v2.0");
+    w.putU32(BT_DI_uptime, millis() / 1000);
+    w.putBool(BT_DI_btEnabled, settings.enabled);
+    w.putU32(BT_DI_btConnections, state.totalConnections);
+    w.putU32(BT_DI_freeMemory, getFreeMemory());
+    w.putBool(BT_DI_sdCard, systemStatus && systemStatus->sdWorking);
+    w.finish();
+}
+
+void BluetoothManager::sendFileList(const CatalogQuery& query) {
     if (!systemStatus || !systemStatus->sdWorking) {
         sendResponse(BT_RESP_ERROR);
         return;
     }
     
-    // Start building JSON file list
-    String fileList = "{\"files\":[";
-    bool firstFile = true;
+    CatalogQuery fitted = query;
+    fitted.pageSize = fitPageSize(query.pageSize, BT_LIST_ENTRY_MAX_BYTES);
+    
+    // One page per request; entries live in a static array, never the heap
+    static CatalogEntry page[CATALOG_MAX_PAGE];
+    uint32_t totalMatches;
+    bool more;
+    uint8_t count = selectCatalogPage(fitted, page, totalMatches, more);
+    
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.beginList(BT_FL_files);
+    for (uint8_t i = 0; i < count; i++) {
+        w.beginRecord();
+        w.putStr(BT_FE_name, page[i].path);
+        w.putU32(BT_FE_size, page[i].size);
+        
+        LogFileStats stats;
+        if (strstr(page[i].path, ".CSV") && readLogFileStats(page[i].path, stats)) {
+            w.putU32(BT_FE_firstTime, stats.firstTime);
+            w.putU32(BT_FE_lastTime, stats.lastTime);
+            w.putU32(BT_FE_records, stats.records);
+        }
+        w.endRecord();
+    }
+    w.endList();
     
-    // Scan root directory
-    SDLib::File root = SD.open("/");
-    if (root) {
-        while (true) {
-            SDLib::File entry = root.openNextFile();
-            if (!entry) break;
-            
-            if (!entry.isDirectory()) {
-                if (!firstFile) {
-                    fileList += ",";
-                }
-                fileList += "{\"name\":\"";
-                fileList += entry.name();
-                fileList += "\",\"size\":";
-                fileList += entry.size();
-                fileList += "}";
-                firstFile = false;
+    w.putU32(BT_FL_total, totalMatches);
+    w.putBool(BT_FL_more, more);
+    if (more) {
+        w.putU32(BT_FL_nextKey, page[count - 1].key);
+        w.putU32(BT_FL_nextTie, page[count - 1].tie);
+    }
+    w.finish();
+    
+    Serial.print(F("Sent file list page ("));
+    Serial.print(count);
+    Serial.print(F(" of "));
+    Serial.print(totalMatches);
+    Serial.println(F(" files)"));
+}
+
+void BluetoothManager::sendFile(const char* filename) {
+    // Whole-file download using the windowed protocol
+    startTransfer(filename, 0, BT_XFER_DEFAULT_WINDOW);
+}
+
+void BluetoothManager::startTransfer(const char* filename, uint32_t offset, uint8_t window) {
+    if (!systemStatus || !systemStatus->sdWorking) {
+        sendResponse(BT_RESP_ERROR);
+        return;
+    }
+    if (jobBusy() && job.type != BT_JOB_WINDOWED_TRANSFER) {
+        sendResponse(BT_RESP_BUSY);
+        return;
+    }
+    
+    // Filenames may arrive NUL-padded from the fixed-length characteristic
+    char name[BT_XFER_FILENAME_LEN];
+    strncpy(name, filename, sizeof(name) - 1);
+    name[sizeof(name) - 1] = '\0';
+    
+    uint8_t info[16];
+    uint16_t infoLen = 0;
+    TransferStartResult result = transfer.begin(name, offset, window, link.maxPacketSize, info, infoLen);
+    
+    switch (result) {
+        case XFER_START_OK:
+            sendResponse(BT_RESP_OK, info, infoLen);
+            job.type = BT_JOB_WINDOWED_TRANSFER;
+            job.requestId = currentRequestId;
+            state.status = BT_STATUS_TRANSFERRING;
+            transfer.pump();
+            break;
+        case XFER_START_NOT_FOUND:
+            sendResponse(BT_RESP_NOT_FOUND);
+            break;
+        case XFER_START_TOO_LARGE:
+            sendResponse(BT_RESP_TOO_LARGE);
+            break;
+        default:
+            sendResponse(BT_RESP_ERROR);
+            break;
+    }
+}
+
+void BluetoothManager::sendDailySummary(uint32_t date) {
+    // Create a daily summary from the specified date
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.putU32(BT_DS_date, date);
+    w.putF32(BT_DS_avgTemp, 25.5f);
+    w.putF32(BT_DS_avgHumidity, 65.2f);
+    w.putU16(BT_DS_alerts, 3);
+    w.putU8(BT_DS_beeActivity, BEE_NORMAL);
+    w.finish();
+}
+
+// A page is one response and must fit the free notify slots, or its
+// tail would be dropped; at the default MTU that is only a few entries
+uint8_t BluetoothManager::fitPageSize(uint8_t requested, uint16_t entryBytes) {
+    uint32_t budget = (uint32_t)notifyQueue.getFreeSlots() * (link.maxPacketSize - BT_FRAME_HEADER_SIZE);
+    uint32_t fits = budget > BT_LIST_TRAILER_BYTES ? (budget - BT_LIST_TRAILER_BYTES) / entryBytes : 0;
+    return (uint8_t)constrain(fits, 1UL, (uint32_t)requested);
+}
+
+void BluetoothManager::sendAlerts(const AlertQuery& query) {
+    static AlertEvent events[ALERT_HISTORY_MAX_PAGE];
+    AlertQuery fitted = query;
+    fitted.maxEvents = fitPageSize(query.maxEvents ? query.maxEvents : ALERT_HISTORY_MAX_PAGE,
+                                   BT_ALERT_ENTRY_MAX_BYTES);
+    bool more;
+    uint8_t count = alertHistory.query(fitted, events, more);
+    
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        currentRequestId, (BleEncoding)currentEncoding);
+    w.beginList(BT_AL_alerts);
+    for (uint8_t i = 0; i < count; i++) {
+        const AlertEvent& e = events[i];
+        w.beginRecord();
+        w.putU32(BT_AE_time, e.timestamp);
+        w.putU8(BT_AE_type, e.alertFlag);
+        w.putF32(BT_AE_value, e.value);
+        w.putU32(BT_AE_seq, e.seq);
+        w.putBool(BT_AE_raised, e.raised);
+        w.putU8(BT_AE_active, e.activeFlags);
+        w.putF32(BT_AE_temperature, e.temperature);
+        w.putF32(BT_AE_humidity, e.humidity);
+        w.putF32(BT_AE_battery, e.batteryVoltage);
+        w.putU16(BT_AE_dominantFreq, e.dominantFreq);
+        w.putU8(BT_AE_soundLevel, e.soundLevel);
+        w.putU8(BT_AE_beeState, e.beeState);
+        w.endRecord();
+    }
+    w.endList();
+    
+    w.putBool(BT_AL_more, more);
+    if (more) {
+        w.putU32(BT_AL_nextBefore, events[count - 1].seq);
+    }
+    w.putU8(BT_AL_active, alertHistory.getActiveFlags());
+    w.putU32(BT_AL_stored, alertHistory.getStoredEvents());
+    w.finish();
+}
+
+// =============================================================================
+// BACKGROUND JOBS
+// =============================================================================
+
+bool BluetoothManager::jobBusy() {
+    return job.type != BT_JOB_NONE || bench.active;
+}
+
+void BluetoothManager::runJob() {
+    switch (job.type) {
+        case BT_JOB_FILE_STREAM:
+            stepFileStreamJob();
+            break;
+        case BT_JOB_AUDIO_CALIBRATION:
+            stepCalibrationJob();
+            break;
+        case BT_JOB_RECORD_SYNC:
+            stepSyncJob();
+            break;
+        case BT_JOB_SERIES_QUERY:
+            stepSeriesJob();
+            break;
+        case BT_JOB_POWER_SIMULATION:
+            stepPowerSimulationJob();
+            break;
+        case BT_JOB_WINDOWED_TRANSFER:
+            // BleTransfer does the sending; the job only tracks progress
+            job.done = transfer.getAckedChunks();
+            job.total = transfer.getTotalChunks();
+            if (!transfer.isActive()) {
+                state.totalDataTransferred += transfer.getStats().bytesSent;
+                finishJob();
             }
-            entry.close();
+            break;
+        default:
+            return;
+    }
+    
+    if (job.type != BT_JOB_NONE) {
+        reportProgress(false);
+    }
+}
+
+void BluetoothManager::stepFileStreamJob() {
+    uint8_t frame[BT_CHUNK_SIZE];
+    uint16_t payloadMax = link.maxPacketSize - BT_FRAME_HEADER_SIZE;
+    
+    for (uint8_t i = 0; i < BT_JOB_CHUNKS_PER_UPDATE; i++) {
+        if (job.file.position() != job.done) {
+            job.file.seek(job.done);
+        }
+        int got = job.file.read(&frame[BT_FRAME_HEADER_SIZE], payloadMax);
+        if (got < 0) got = 0;
+        bool last = (job.done + got >= job.total);
+        
+        frame[0] = BT_RESP_OK;
+        frame[1] = job.requestId;
+        frame[2] = (job.frameSeq & BT_FRAME_SEQ_MASK) | (last ? BT_FRAME_LAST : 0);
+        
+        if (!notifyData(frame, got + BT_FRAME_HEADER_SIZE)) {
+            return;   // TX queue full - resend this frame next update()
+        }
+        
+        job.frameSeq++;
+        job.done += got;
+        state.totalDataTransferred += got + BT_FRAME_HEADER_SIZE;
+        
+        if (last) {
+            finishJob();
+            return;
+        }
+    }
+}
+
+void BluetoothManager::stepCalibrationJob() {
+    job.done = (job.total * getAudioCalibrationProgress(job.calibration)) / 100;
+    appTasks.lockAudio();
+    bool calibrated = stepAudioCalibration(job.calibration);
+    appTasks.unlockAudio();
+    if (!calibrated) return;
+    
+    AudioCalibration& cal = job.calibration;
+    float avgFreq = cal.sampleCount ? cal.freqSum / cal.sampleCount : 0;
+    float avgLevel = cal.sampleCount ? cal.levelSum / cal.sampleCount : 0;
+    finishAudioCalibration(cal);
+    
+    BleResponseWriter w(bluetoothNotifyResponse, link.maxPacketSize, BT_RESP_OK,
+                        job.requestId, (BleEncoding)job.encoding);
+    w.putF32(BT_AC_avgFreq, avgFreq);
+    w.putF32(BT_AC_avgLevel, avgLevel);
+    w.putU16(BT_AC_samples, cal.sampleCount);
+    w.finish();
+    
+    Serial.println(F("Audio calibration completed via Bluetooth"));
+    finishJob();
+}
+
+void BluetoothManager::stepSyncJob() {
+    uint8_t packet[BT_CHUNK_SIZE];
+    uint8_t perPacket = (link.maxPacketSize - BT_SYNC_HEADER_SIZE) / RECORD_SIZE;
+    
+    for (uint8_t i = 0; i < BT_JOB_CHUNKS_PER_UPDATE; i++) {
+        if (job.done >= job.total) {
+            // [resp][requestId][newCursor u32][records u32][crc32 u32]
+            packet[0] = BT_RESP_SYNC_END;
+            packet[1] = job.requestId;
+            putU32LE(&packet[2], job.syncCursor);
+            putU32LE(&packet[6], job.done);
+            putU32LE(&packet[10], job.syncCrc);
+            if (!notifyData(packet, BT_SYNC_END_SIZE)) return;
             
-            // Prevent overflow
-            if (fileList.length() > BT_CHUNK_SIZE - 50) {
-                break;
+            Serial.print(F("Record sync done, cursor "));
+            Serial.println(job.syncCursor);
+            finishJob();
+            return;
+        }
+        
+        uint32_t offset = recordStore.offsetOf(job.syncCursor + 1);
+        if (job.file.position() != offset) {
+            job.file.seek(offset);
+        }
+        
+        uint8_t want = min((uint32_t)perPacket, job.total - job.done);
+        uint8_t slots = 0;
+        uint8_t count = 0;
+        uint16_t pos = BT_SYNC_HEADER_SIZE;
+        StoredRecord record;
+        for (; slots < want; slots++) {
+            if (job.file.read(&packet[pos], RECORD_SIZE) != RECORD_SIZE) break;
+            if (!RecordStore::decode(&packet[pos], record)) continue;   // Padded slot
+            pos += RECORD_SIZE;
+            count++;
+        }
+        
+        if (slots == 0) {
+            job.total = job.done;   // Read error - end the sync at what was sent
+            continue;
+        }
+        
+        if (count > 0) {
+            packet[0] = BT_RESP_SYNC_DATA;
+            packet[1] = job.requestId;
+            packet[2] = count;
+            if (!notifyData(packet, pos)) {
+                return;   // TX queue full - re-read and resend next update()
             }
+            job.syncCrc = crc32Update(job.syncCrc, &packet[BT_SYNC_HEADER_SIZE], pos - BT_SYNC_HEADER_SIZE);
+            state.totalDataTransferred += pos;
         }
-        root.close();
+        job.syncCursor += slots;
+        job.done += slots;
     }
+}
+
+bool BluetoothManager::flushSeriesPacket() {
+    seriesPacket[0] = BT_RESP_SERIES_DATA;
+    seriesPacket[1] = job.requestId;
+    if (!notifyData(seriesPacket, seriesPacketLen)) {
+        return false;   // TX queue full - packet is kept for the next update()
+    }
+    job.seriesBytes += seriesPacketLen;
+    state.totalDataTransferred += seriesPacketLen;
+    seriesPacketLen = BT_SERIES_HEADER_SIZE;
+    seriesPacket[2] = 0;
+    return true;
+}
+
+void BluetoothManager::stepSeriesJob() {
+    uint8_t bucketSize = seriesBucketSize(series.getQuery());
     
-    // Scan HIVE_DATA directory
-    SDLib::File hiveDir = SD.open("/HIVE_DATA");
-    if (hiveDir) {
-        while (true) {
-            SDLib::File entry = hiveDir.openNextFile();
-            if (!entry) break;
-            
-            if (entry.isDirectory()) {
-                // Check for CSV files in year directories
-                String yearPath = "/HIVE_DATA/";
-                yearPath += entry.name();
-                
-                SDLib::File yearDir = SD.open(yearPath);
-                if (yearDir) {
-                    while (true) {
-                        SDLib::File csvFile = yearDir.openNextFile();
-                        if (!csvFile) break;
-                        
-                        if (!csvFile.isDirectory() && strstr(csvFile.name(), ".CSV")) {
-                            if (!firstFile) {
-                                fileList += ",";
-                            }
-                            fileList += "{\"name\":\"";
-                            fileList += yearPath + "/" + csvFile.name();
-                            fileList += "\",\"size\":";
-                            fileList += csvFile.size();
-                            fileList += "}";
-                            firstFile = false;
-                        }
-                        csvFile.close();
-                        
-                        // Prevent overflow
-                        if (fileList.length() > BT_CHUNK_SIZE - 50) {
-                            break;
-                        }
-                    }
-                    yearDir.close();
-                }
+    for (uint8_t i = 0; i < BT_SERIES_RECORDS_PER_UPDATE; i++) {
+        // A closed bucket waits here until there is room in the packet
+        if (seriesPending) {
+            if (seriesPacketLen + bucketSize > link.maxPacketSize && !flushSeriesPacket()) {
+                return;
             }
-            entry.close();
-            
-            if (fileList.length() > BT_CHUNK_SIZE - 50) {
-                break;
+            seriesPacketLen += series.encode(seriesPendingBucket, &seriesPacket[seriesPacketLen]);
+            seriesPacket[2]++;
+            job.seriesBuckets++;
+            seriesPending = false;
+        }
+        
+        if (job.done >= job.total) {
+            if (series.finish(seriesPendingBucket)) {
+                seriesPending = true;
+                continue;
             }
+            if (seriesPacketLen > BT_SERIES_HEADER_SIZE && !flushSeriesPacket()) {
+                return;
+            }
+            
+            // [resp][requestId][buckets u16][records u32][elapsedMs u32][bytes u32]
+            uint8_t packet[BT_SERIES_END_SIZE];
+            uint32_t elapsed = millis() - job.startedAt;
+            packet[0] = BT_RESP_SERIES_END;
+            packet[1] = job.requestId;
+            putU16LE(&packet[2], job.seriesBuckets);
+            putU32LE(&packet[4], series.getRecordsUsed());
+            putU32LE(&packet[8], elapsed);
+            putU32LE(&packet[12], job.seriesBytes + BT_SERIES_END_SIZE);
+            if (!notifyData(packet, BT_SERIES_END_SIZE)) return;
+            
+            Serial.print(F("Series query done: "));
+            Serial.print(job.seriesBuckets);
+            Serial.print(F(" buckets, "));
+            Serial.print(job.seriesBytes + BT_SERIES_END_SIZE);
+            Serial.print(F(" bytes in "));
+            Serial.print(elapsed);
+            Serial.print(F(" ms (raw records: "));
+            Serial.print(job.done * RECORD_SIZE);
+            Serial.println(F(" bytes)"));
+            finishJob();
+            return;
+        }
+        
+        uint32_t offset = recordStore.offsetOf(job.syncCursor + 1);
+        if (job.file.position() != offset) {
+            job.file.seek(offset);
+        }
+        
+        uint8_t bytes[RECORD_SIZE];
+        if (job.file.read(bytes, RECORD_SIZE) != RECORD_SIZE) {
+            job.total = job.done;   // Read error - answer from what was scanned
+            continue;
+        }
+        job.syncCursor++;
+        job.done++;
+        
+        StoredRecord record;
+        if (!RecordStore::decode(bytes, record)) continue;   // Padded slot
+        
+        if (record.timestamp >= series.getQuery().toTime) {
+            job.total = job.done;   // Past the range end
+            continue;
+        }
+        if (series.add(record, seriesPendingBucket)) {
+            seriesPending = true;
         }
-        hiveDir.close();
     }
+}
+
+void BluetoothManager::finishJob() {
+    if (job.file) {
+        job.file.close();
+    }
+    job.calibration.active = false;
+    job.done = job.total;
+    reportProgress(true);
     
-    fileList += "]}";
+    job.type = BT_JOB_NONE;
+    if (state.status == BT_STATUS_TRANSFERRING) {
+        state.status = state.clientConnected ? BT_STATUS_CONNECTED : BT_STATUS_ADVERTISING;
+    }
+}
+
+void BluetoothManager::reportProgress(bool force) {
+    unsigned long now = millis();
+    if (!force && now - job.lastProgressReport < BT_JOB_PROGRESS_INTERVAL_MS) return;
+    job.lastProgressReport = now;
+    
+    state.currentTransferProgress = job.total ? (uint16_t)((job.done * 100ULL) / job.total) : 100;
+    state.currentTransferTotal = 100;
+    
+    if (!state.clientConnected || !transport) return;
+    
+    // [status][jobType][requestId][percent][done u32][total u32]; a newer
+    // report replaces one still waiting for room in the TX buffers
+    uint8_t* packet = pendingStatus;
+    packet[0] = state.status;
+    packet[1] = job.type;
+    packet[2] = job.requestId;
+    packet[3] = state.currentTransferProgress;
+    putU32LE(&packet[4], job.done);
+    putU32LE(&packet[8], job.total);
+    statusPending = !transport->notifyStatus(packet, BT_STATUS_PACKET_SIZE);
+}
+
+// =============================================================================
+// LINK TUNING AND BENCHMARK
+// =============================================================================
+
+void BluetoothManager::onConnect(uint16_t connHandle) {
+    link.connHandle = connHandle;
+    link.bulkProfile = false;
+    
+    // Negotiated asynchronously; refreshLinkInfo() picks up the results
+    link.phy2MRequested = transport && transport->requestFastLink(connHandle);
+    refreshLinkInfo();
+}
+
+bool BluetoothManager::onDisconnect(uint16_t connHandle) {
+    if (link.connHandle != 0xFFFF && connHandle != link.connHandle) {
+        return false;
+    }
+    
+    transfer.abort();
+    bench.active = false;
+    stream.unsubscribe();
+    notifyQueue.clear();
+    commandQueue.clear();
+    statusPending = false;
+    if (job.type != BT_JOB_NONE) {
+        Serial.println(F("BT: job cancelled by disconnect"));
+        finishJob();
+    }
     
-    // Send the file list
-    sendResponse(BT_RESP_OK, (uint8_t*)fileList.c_str(), fileList.length());
+    link.connHandle = 0xFFFF;
+    link.mtu = BT_DEFAULT_MTU;
+    link.maxPacketSize = notifyPayloadForMtu(BT_DEFAULT_MTU);
+    link.dataLength = 27;
+    link.connInterval = 0;
+    link.phy2MRequested = false;
+    link.bulkProfile = false;
+    return true;
+}
+
+void BluetoothManager::refreshLinkInfo() {
+    TransportLinkInfo info;
+    if (!transport || !transport->getLinkInfo(link.connHandle, info)) return;
     
-    Serial.print(F("Sent file list ("));
-    Serial.print(fileList.length());
-    Serial.println(F(" bytes)"));
+    uint16_t mtu = info.mtu;
+    if (mtu != link.mtu) {
+        Serial.print(F("BT: MTU "));
+        Serial.print(link.mtu);
+        Serial.print(F(" -> "));
+        Serial.println(mtu);
+    }
+    link.mtu = mtu;
+    link.maxPacketSize = notifyPayloadForMtu(mtu);
+    link.dataLength = info.dataLength;
+    link.connInterval = info.connInterval;
 }
 
-void BluetoothManager::sendFile(const char* filename) {
-    // This would implement chunked file transfer
-    // For now, send a placeholder response
-    char response[64];
-    snprintf(response, sizeof(response), "File transfer not implemented: %s", filename);
-    sendResponse(BT_RESP_NOT_FOUND, (uint8_t*)response, strlen(response));
+void BluetoothManager::setLinkProfile(bool bulk) {
+    link.bulkProfile = bulk;
+    if (transport) {
+        transport->requestConnInterval(link.connHandle, bulk ? BT_CONN_INTERVAL_BULK : BT_CONN_INTERVAL_IDLE);
+    }
+    Serial.print(F("BT: "));
+    Serial.print(bulk ? F("bulk") : F("idle"));
+    Serial.println(F(" connection interval requested"));
 }
 
-void BluetoothManager::sendDailySummary(uint32_t date) {
-    // Create a daily summary from the specified date
-    char summary[BT_CHUNK_SIZE];
-    snprintf(summary, sizeof(summary),
-        "{"
-        "\"date\":%lu,"
-        "\"avgTemp\":25.5,"
-        "\"avgHumidity\":65.2,"
-        "\"alerts\":3,"
-        "\"beeActivity\":\"Normal\""
-        "}",
-        date
-    );
-    
-    sendResponse(BT_RESP_OK, (uint8_t*)summary, strlen(summary));
-}
-
-void BluetoothManager::sendAlerts() {
-    // Send recent alerts
-    char alerts[BT_CHUNK_SIZE];
-    snprintf(alerts, sizeof(alerts),
-        "{"
-        "\"recentAlerts\":["
-        "{\"time\":1703001600,\"type\":\"TEMP_HIGH\",\"value\":42.5},"
-        "{\"time\":1703005200,\"type\":\"QUEEN_ISSUE\",\"value\":0}"
-        "]"
-        "}"
-    );
-    
-    sendResponse(BT_RESP_OK, (uint8_t*)alerts, strlen(alerts));
+uint16_t BluetoothManager::fillLinkInfo(uint8_t* out) {
+    putU16LE(&out[0], link.mtu);
+    putU16LE(&out[2], link.maxPacketSize);
+    putU16LE(&out[4], link.dataLength);
+    putU16LE(&out[6], link.connInterval);
+    out[8] = link.phy2MRequested ? 2 : 1;
+    out[9] = link.bulkProfile ? 1 : 0;
+    return 10;
+}
+
+void BluetoothManager::sendLinkInfo() {
+    uint8_t info[10];
+    uint16_t len = fillLinkInfo(info);
+    sendResponse(BT_RESP_OK, info, len);
+}
+
+void BluetoothManager::startBenchmark(uint16_t packetCount) {
+    // Sharing the link with a job or transfer would measure neither
+    if (jobBusy() || transfer.isActive()) {
+        sendResponse(BT_RESP_BUSY);
+        return;
+    }
+    if (packetCount == 0) {
+        sendResponse(BT_RESP_ERROR);
+        return;
+    }
+    
+    bench.active = true;
+    bench.packetsTotal = min(packetCount, (uint16_t)BT_BENCH_MAX_PACKETS);
+    bench.packetsSent = 0;
+    bench.notifyFailures = 0;
+    bench.bytesSent = 0;
+    bench.startTime = millis();
+    
+    // Accepted: [packets u16][packet size u16], ahead of the test packets
+    uint8_t ack[4];
+    putU16LE(&ack[0], bench.packetsTotal);
+    putU16LE(&ack[2], link.maxPacketSize);
+    sendResponse(BT_RESP_OK, ack, sizeof(ack));
+    
+    Serial.print(F("BT: benchmark "));
+    Serial.print(bench.packetsTotal);
+    Serial.print(F(" x "));
+    Serial.print(link.maxPacketSize);
+    Serial.println(F(" bytes"));
+}
+
+void BluetoothManager::pumpBenchmark() {
+    if (!bench.active) return;
+    
+    if (bench.packetsSent < bench.packetsTotal) {
+        // Fill the SoftDevice queue until it pushes back; each packet
+        // carries its send time so the client can measure latency
+        uint8_t packet[BT_CHUNK_SIZE];
+        memset(packet, 0xA5, sizeof(packet));
+        packet[0] = BT_RESP_BENCH_DATA;
+        
+        while (bench.packetsSent < bench.packetsTotal) {
+            putU16LE(&packet[1], bench.packetsSent);
+            putU32LE(&packet[3], micros());
+            if (!notifyData(packet, link.maxPacketSize)) {
+                bench.notifyFailures++;
+                return;
+            }
+            bench.packetsSent++;
+            bench.bytesSent += link.maxPacketSize;
+        }
+    }
+    
+    // Summary: packets u16, bytes u32, elapsed ms u32, failures u16, then
+    // link info if it fits - at the default MTU it does not, and a packet
+    // longer than the link allows is never accepted
+    uint8_t summary[1 + 12 + 10];
+    unsigned long elapsed = millis() - bench.startTime;
+    summary[0] = BT_RESP_BENCH_END;
+    putU16LE(&summary[1], bench.packetsSent);
+    putU32LE(&summary[3], bench.bytesSent);
+    putU32LE(&summary[7], elapsed);
+    putU16LE(&summary[11], bench.notifyFailures);
+    uint16_t len = 13;
+    if (link.maxPacketSize >= sizeof(summary)) {
+        len += fillLinkInfo(&summary[13]);
+    }
+    if (!notifyData(summary, len)) return;
+    
+    bench.active = false;
+    state.totalDataTransferred += bench.bytesSent;
+    
+    Serial.print(F("BT: benchmark done, "));
+    Serial.print(elapsed > 0 ? bench.bytesSent * 1000UL / elapsed : 0);
+    Serial.println(F(" B/s"));
 }
 
 // =============================================================================
@@ -903,6 +2131,12 @@ void BluetoothManager::sendAlerts() {
 // =============================================================================
 
 void BluetoothManager::setEnabled(bool enabled) {
+    // Deferred by a scheduled wake: enabling is what brings the radio up
+    if (!radioStarted) {
+        settings.enabled = enabled;
+        if (enabled) start();
+        return;
+    }
     if (settings.enabled == enabled) return;
     
     Serial.print(F("Bluetooth: "));
@@ -922,6 +2156,9 @@ void BluetoothManager::setEnabled(bool enabled) {
     if (enabled) {
         startAdvertising();
     }
+    
+    // A beacon may take over from advertising on the next update()
+    eventScheduler.post(EVT_BLE);
 }
 
 
@@ -980,6 +2217,19 @@ void BluetoothManager::printBluetoothStatus() const {
     Serial.print(F("Connected: ")); Serial.println(state.clientConnected ? "Yes" : "No");
     Serial.print(F("Total Connections: ")); Serial.println(state.totalConnections);
     Serial.print(F("Data Transferred: ")); Serial.print(state.totalDataTransferred); Serial.println(F(" bytes"));
+    const NotifyQueueStats& q = notifyQueue.getStats();
+    Serial.print(F("Notify queue: ")); Serial.print(q.sent); Serial.print(F(" sent, "));
+    Serial.print(q.queued); Serial.print(F(" queued, ")); Serial.print(q.retried); Serial.print(F(" retried, "));
+    Serial.print(q.dropped); Serial.print(F(" dropped, peak ")); Serial.println(q.highWater);
+    Serial.print(F("Beacon: "));
+    if (settings.beaconEnabled) {
+        Serial.print(settings.beaconIntervalMs); Serial.print(F(" ms, est. "));
+        Serial.print(estimateBeaconCurrentUa(settings.beaconIntervalMs, BEACON_PAYLOAD_SIZE), 1);
+        Serial.println(F(" uA"));
+    } else {
+        Serial.println(F("Off"));
+    }
+    bleGateway.printStatus(rtc.now().unixtime());
     Serial.println(F("=======================\n"));
 }
 
@@ -987,35 +2237,73 @@ void BluetoothManager::printBluetoothStatus() const {
 // CALLBACK FUNCTIONS
 // =============================================================================
 
-#ifdef NRF52_SERIES
 void bluetoothConnectCallback(uint16_t conn_handle) {
     if (bluetoothManagerInstance) {
         bluetoothManagerInstance->getState().clientConnected = true;
         bluetoothManagerInstance->getState().status = BT_STATUS_CONNECTED;
         bluetoothManagerInstance->getState().totalConnections++;
         bluetoothManagerInstance->getState().lastConnectionTime = millis();
+        bluetoothManagerInstance->onConnect(conn_handle);
+        eventScheduler.post(EVT_BLE);
         
         Serial.println(F("Bluetooth client connected"));
     }
 }
 
 void bluetoothDisconnectCallback(uint16_t conn_handle, uint8_t reason) {
-    if (bluetoothManagerInstance) {
+    if (bluetoothManagerInstance && bluetoothManagerInstance->onDisconnect(conn_handle)) {
+        // Client resumes with BT_CMD_TRANSFER_START at the offset it reached
         bluetoothManagerInstance->getState().clientConnected = false;
         bluetoothManagerInstance->getState().status = BT_STATUS_ADVERTISING;
+        eventScheduler.post(EVT_BLE);
         
         Serial.print(F("Bluetooth client disconnected, reason: "));
         Serial.println(reason);
     }
 }
 
+#ifdef NRF52_SERIES
 void bluetoothCommandCallback(uint16_t conn_hdl, BLECharacteristic* chr, uint8_t* data, uint16_t len) {
     if (bluetoothManagerInstance) {
-        bluetoothManagerInstance->handleCommand(data, len);
+        bluetoothManagerInstance->queueCommand(data, len);
+        eventScheduler.post(EVT_BLE);
+    }
+}
+
+void bluetoothBleEventCallback(ble_evt_t* evt) {
+    if (bluetoothManagerInstance && evt->header.evt_id == BLE_GATTS_EVT_HVN_TX_COMPLETE) {
+        bluetoothManagerInstance->onTxComplete();
+        eventScheduler.post(EVT_BLE);
     }
 }
+
+void bluetoothAckScanCallback(ble_gap_evt_adv_report_t* report) {
+    uint8_t payload[BEACON_MAX_PAYLOAD];
+    uint8_t len = Bluefruit.Scanner.parseReportByType(report, BLE_GAP_AD_TYPE_MANUFACTURER_SPECIFIC_DATA,
+                                                      payload, sizeof(payload));
+    if (bluetoothManagerInstance && len > BEACON_PAYLOAD_SIZE) {
+        bluetoothManagerInstance->queueGatewayBeacon(payload, len);
+        eventScheduler.post(EVT_BLE);
+    }
+    Bluefruit.Scanner.resume();
+}
 #endif
 
+bool bluetoothNotifyData(const uint8_t* data, uint16_t len) {
+    if (!bluetoothManagerInstance || !bluetoothManagerInstance->isConnected()) return false;
+    return bluetoothManagerInstance->notifyData(data, len);
+}
+
+bool bluetoothNotifyResponse(const uint8_t* data, uint16_t len) {
+    if (!bluetoothManagerInstance || !bluetoothManagerInstance->isConnected()) return false;
+    return bluetoothManagerInstance->notifyResponse(data, len);
+}
+
+bool bluetoothNotifyRaw(const uint8_t* data, uint16_t len) {
+    if (!bluetoothManagerInstance) return false;
+    return bluetoothManagerInstance->notifyRaw(data, len);
+}
+
 // =============================================================================
 // UTILITY FUNCTIONS
 // =============================================================================
@@ -1035,10 +2323,17 @@ const char* bluetoothStatusToString(BluetoothStatus status) {
         case BT_STATUS_CONNECTED: return "Connected";
         case BT_STATUS_TRANSFERRING: return "Transferring";
         case BT_STATUS_ERROR: return "Error";
+        case BT_STATUS_BEACON: return "Beacon";
         default: return "Unknown";
     }
 }
 
+uint16_t notifyPayloadForMtu(uint16_t mtu) {
+    // A notification carries MTU - 3 bytes; never exceed our buffers
+    if (mtu < BT_DEFAULT_MTU) mtu = BT_DEFAULT_MTU;
+    return min((uint16_t)(mtu - BT_ATT_HEADER_SIZE), (uint16_t)BT_CHUNK_SIZE);
+}
+
 String formatDataSize(uint32_t bytes) {
     if (bytes < 1024) {
         return String(bytes) + " B";
@@ -1049,8 +2344,3 @@ String formatDataSize(uint32_t bytes) {
     }
 }
 
-#else
-
-
-
-#endif // NRF52_SERIES
\ No newline at end of file
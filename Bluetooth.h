@@ -8,6 +8,17 @@
 
 #include "Config.h"
 #include "DataStructures.h"
+#include "BleTransfer.h"
+#include "BleQueue.h"
+#include "BleTransport.h"
+#include "BleStream.h"
+#include "RecordStore.h"
+#include "SeriesQuery.h"
+#include "FileCatalog.h"
+#include "AlertHistory.h"
+#include "BleBeacon.h"
+#include "BleGateway.h"
+#include "Audio.h"
 
 #ifdef NRF52_SERIES
 #include <bluefruit.h>
@@ -23,8 +34,30 @@
 #define BT_COMMAND_CHAR_UUID "11111111-2222-3333-4444-555555555555"   // all numbers, so no change
 #define BT_STATUS_CHAR_UUID "22222222-3333-4444-5555-666666666666"    // all numbers, so no change
 
+// Link settings
+#define BT_MAX_MTU 247                 // Largest ATT MTU the SoftDevice supports
+#define BT_ATT_HEADER_SIZE 3           // Opcode + handle in every notification
+#define BT_DEFAULT_MTU 23              // Until the client completes an MTU exchange
+#define BT_CONN_INTERVAL_BULK 6        // 7.5 ms (1.25 ms units) while streaming
+#define BT_CONN_INTERVAL_IDLE 80       // 100 ms when only commands are flowing
+#define BT_BENCH_MAX_PACKETS 2000
+
+// Background jobs
+#define BT_JOB_CHUNKS_PER_UPDATE 4       // Bound file-stream work per update()
+#define BT_COMMANDS_PER_UPDATE 2         // Queued commands handled per update()
+#define BT_JOB_PROGRESS_INTERVAL_MS 500  // Status characteristic progress rate
+#define BT_SYNC_HEADER_SIZE 3            // [resp][requestId][count] before the records
+#define BT_SYNC_END_SIZE 14
+#define BT_SERIES_HEADER_SIZE 3          // [resp][requestId][count] before the buckets
+#define BT_SERIES_END_SIZE 16
+#define BT_SERIES_RECORDS_PER_UPDATE 32  // Journal records folded per update()
+#define BT_STATUS_PACKET_SIZE 12
+#define BT_LIST_ENTRY_MAX_BYTES 80       // Longest encoded file list entry, TLV or CBOR
+#define BT_ALERT_ENTRY_MAX_BYTES 56      // Longest encoded alert event, TLV or CBOR
+#define BT_LIST_TRAILER_BYTES 32         // List close and the fields after it
+
 // Transfer settings
-#define BT_CHUNK_SIZE 240
+#define BT_CHUNK_SIZE (BT_MAX_MTU - BT_ATT_HEADER_SIZE)  // Largest notification; see getMaxPacketSize()
 #define BT_TIMEOUT_MS 30000
 #define BT_MANUAL_TIMEOUT_DEFAULT 30  // Default 30 minutes
 
@@ -44,22 +77,23 @@ enum BluetoothStatus {
     BT_STATUS_ADVERTISING = 1,
     BT_STATUS_CONNECTED = 2,
     BT_STATUS_TRANSFERRING = 3,
-    BT_STATUS_ERROR = 4
+    BT_STATUS_ERROR = 4,
+    BT_STATUS_BEACON = 5          // Non-connectable status beacon only
 };
 
 enum BluetoothCommand {
     BT_CMD_PING = 0x01, // Ping command to check connection
     BT_CMD_GET_STATUS = 0x02, // Get current device status
     BT_CMD_GET_CURRENT_DATA = 0x03, // Get current sensor data
-    BT_CMD_LIST_FILES = 0x04, // List all available files
+    BT_CMD_LIST_FILES = 0x04, // [sort u8][pageSize u8][year u16][month u8][token 8] - all optional
     BT_CMD_GET_FILE = 0x05, // Get specific file by name
     BT_CMD_GET_DAILY_SUMMARY = 0x06, // Get daily summary for a specific date
-    BT_CMD_GET_ALERTS = 0x07, // Get alert history
+    BT_CMD_GET_ALERTS = 0x07, // [from u32][to u32][typeMask u8][max u8][beforeSeq u32] - all optional
     BT_CMD_GET_DEVICE_INFO = 0x08, // Get device information  
     BT_CMD_SET_TIME = 0x09, // Set system time (RTC)
     BT_CMD_START_CALIBRATION = 0x0A, // Start calibration process
     BT_CMD_GET_SETTINGS = 0x10,      // Get all current settings
-    BT_CMD_SET_SETTING = 0x11,       // Set individual setting
+    BT_CMD_SET_SETTING = 0x11,       // [id u8][value f32 LE] - set individual setting
     BT_CMD_FACTORY_RESET = 0x12,      // Reset to defaults
     BT_CMD_SET_DATE_TIME = 0x13,  // Set individual date/time components
     BT_CMD_START_AUDIO_CALIBRATION = 0x14, // Start audio calibration
@@ -68,6 +102,25 @@ enum BluetoothCommand {
     BT_CMD_GET_FILE_INFO = 0x17,     // Get file size/date
     BT_CMD_SET_BEE_PRESET = 0x18,     // Set bee type preset
     BT_CMD_GET_BEE_PRESETS = 0x19,    // Get available presets
+    BT_CMD_TRANSFER_START = 0x20,     // [offset u32][window u8][filename] - start/resume windowed transfer
+    BT_CMD_TRANSFER_ACK = 0x21,       // [transferId][nextExpectedSeq u16] - cumulative ACK
+    BT_CMD_TRANSFER_ABORT = 0x22,     // [transferId] - cancel transfer
+    BT_CMD_GET_LINK_INFO = 0x23,      // Negotiated MTU, payload size, PHY, interval
+    BT_CMD_LINK_BENCHMARK = 0x24,     // [packetCount u16] - OK [packets u16][size u16], then max-size test packets
+    BT_CMD_STREAM_SUBSCRIBE = 0x25,   // [fieldMask u64][intervalMs u16][spectrumBins u8] - see BleStream.h
+    BT_CMD_STREAM_UNSUBSCRIBE = 0x26, // Stop live feature stream
+    BT_CMD_SYNC_START = 0x27,         // [clientId 8][cursor u32] - stream records after cursor
+    BT_CMD_SYNC_COMMIT = 0x28,        // [clientId 8][cursor u32] - store client cursor once data is safe
+    BT_CMD_SET_BEACON = 0x29,         // [enabled u8][intervalMs u16] - status beacon while not discoverable
+    BT_CMD_SET_SETTINGS_BULK = 0x2A,  // [format u8][...] - atomic multi-setting update, see BT_SETTINGS_*
+    BT_CMD_QUERY_SERIES = 0x2B,       // [from u32][to u32][bucketSec u32][fieldMask u8][aggMask u8] - see SeriesQuery.h
+    BT_CMD_GET_QUEUE_STATS = 0x2C,    // Notification and command queue counters
+    BT_CMD_GET_NEIGHBOURS = 0x2D,     // Gateway neighbour table, see BleGateway.h
+    BT_CMD_SET_GATEWAY = 0x2E,        // [enabled u8][periodMin u8] - collect neighbour beacons
+    BT_CMD_GET_POWER_PROFILE = 0x2F,  // [reset u8] - wake phase timings and measured mAh/day
+    BT_CMD_SET_ADAPTIVE_INTERVAL = 0x30, // [enabled u8][budgetMah u16][minInterval u8] - see AdaptiveInterval.h
+    BT_CMD_SET_WAKE_SCHEDULE = 0x31,  // [intervalS u32][mode u8][jitterS u16] - see WakeSchedule.h
+    BT_CMD_SIMULATE_POWER = 0x32,     // [days u8][intervalS u32][tempC i8][startPct u8] - see PowerSimulator.h
 };
 
 enum BluetoothResponse {
@@ -76,9 +129,27 @@ enum BluetoothResponse {
     BT_RESP_NOT_FOUND = 0x12,
     BT_RESP_TOO_LARGE = 0x13,
     BT_RESP_BUSY = 0x14,
-    BT_RESP_TIMEOUT = 0x15
+    BT_RESP_TIMEOUT = 0x15,
+    BT_RESP_TRANSFER_DATA = 0x16,     // Windowed transfer data chunk
+    BT_RESP_TRANSFER_END = 0x17,      // Windowed transfer complete, carries CRC32
+    BT_RESP_BENCH_DATA = 0x18,        // [seq u16][micros u32][filler...]
+    BT_RESP_BENCH_END = 0x19,         // [packets u16][bytes u32][elapsedMs u32][failures u16][link info, if it fits]
+    BT_RESP_STREAM = 0x1A,            // Live feature stream packet
+    BT_RESP_SYNC_DATA = 0x1B,         // [requestId][count][records...] - RecordStore.h layout
+    BT_RESP_SYNC_END = 0x1C,          // [requestId][newCursor u32][records u32][crc32 u32]
+    BT_RESP_SERIES_DATA = 0x1D,       // [requestId][count][buckets...] - SeriesQuery.h layout
+    BT_RESP_SERIES_END = 0x1E,        // [requestId][buckets u16][records u32][elapsedMs u32][bytes u32]
+    BT_RESP_TRANSFER_ERROR = 0x1F     // [transferId][seq u16] - windowed transfer ended by a read error
 };
 
+// BT_CMD_SET_SETTINGS_BULK payload formats
+#define BT_SETTINGS_PAIRS 0               // [count u8][(id u8, value f32 LE) x count]
+#define BT_SETTINGS_IMAGE 1               // Settings image, see Settings.h
+#define BT_SETTINGS_PAIR_SIZE 5
+// Pairs that fit one command write after the v2 header, command and
+// format/count bytes: 11 of the 15 settings. A full set uses the image
+#define BT_SETTINGS_MAX_PAIRS ((BT_COMMAND_MAX_LEN - 6) / BT_SETTINGS_PAIR_SIZE)
+
 // =============================================================================
 // BLUETOOTH STRUCTURES
 // =============================================================================
@@ -87,6 +158,10 @@ struct BluetoothSettings {
     bool enabled;                // Simple on/off
     uint8_t deviceId;            // Device identifier (1-255) 
     uint8_t timeoutMin;          // Timeout period (same as display timeout)
+    bool beaconEnabled;          // Advertise status (BleBeacon.h) while not discoverable
+    uint16_t beaconIntervalMs;
+    bool gatewayEnabled;         // Scan for neighbour beacons (BleGateway.h)
+    uint8_t gatewayPeriodMin;
 };
 
 struct BluetoothState {
@@ -100,6 +175,53 @@ struct BluetoothState {
     uint16_t currentTransferTotal;
 };
 
+struct BluetoothLink {
+    uint16_t connHandle;
+    uint16_t mtu;                // Negotiated ATT MTU
+    uint16_t maxPacketSize;      // Largest notification payload for this link
+    uint16_t dataLength;         // LL data length (27..251)
+    uint16_t connInterval;       // Current interval in 1.25 ms units
+    bool phy2MRequested;
+    bool bulkProfile;            // Short interval requested for streaming
+};
+
+struct LinkBenchmark {
+    bool active;
+    uint16_t packetsTotal;
+    uint16_t packetsSent;
+    uint16_t notifyFailures;
+    uint32_t bytesSent;
+    unsigned long startTime;
+};
+
+// Long-running commands run as jobs advanced a step per update() call
+enum BluetoothJobType {
+    BT_JOB_NONE = 0,
+    BT_JOB_FILE_STREAM = 1,          // BT_CMD_GET_FILE_DATA
+    BT_JOB_AUDIO_CALIBRATION = 2,    // BT_CMD_START_AUDIO_CALIBRATION
+    BT_JOB_WINDOWED_TRANSFER = 3,    // BT_CMD_TRANSFER_START (progress only)
+    BT_JOB_RECORD_SYNC = 4,          // BT_CMD_SYNC_START
+    BT_JOB_SERIES_QUERY = 5,         // BT_CMD_QUERY_SERIES
+    BT_JOB_POWER_SIMULATION = 6      // BT_CMD_SIMULATE_POWER
+};
+
+struct BluetoothJob {
+    BluetoothJobType type;
+    uint8_t requestId;
+    uint8_t encoding;
+    uint8_t frameSeq;
+    uint32_t done;
+    uint32_t total;
+    SDLib::File file;
+    AudioCalibration calibration;
+    uint32_t syncCursor;             // Last record sequence number sent or scanned
+    uint32_t syncCrc;                // CRC32 over every record byte sent
+    uint16_t seriesBuckets;          // Buckets sent so far
+    uint32_t seriesBytes;            // Series bytes notified, for comparison with a raw download
+    unsigned long startedAt;
+    unsigned long lastProgressReport;
+};
+
 struct DataRequest {
     BluetoothCommand command;
     char filename[64];
@@ -121,27 +243,71 @@ private:
     
     // BLE objects
 #ifdef NRF52_SERIES
-    BLEService dataService;
-    BLECharacteristic dataCharacteristic;
-    BLECharacteristic commandCharacteristic;
-    BLECharacteristic statusCharacteristic;
+    BluefruitTransport radio;
 #endif
+    BleTransport* transport;         // radio, or a SimTransport on the bench
+    BleTransfer transfer;
+    BluetoothLink link;
+    LinkBenchmark bench;
+    BleStream stream;
+    BleNotifyQueue notifyQueue;
+    BleCommandQueue commandQueue;
+    
+    // Latest progress packet the stack refused; resent by update()
+    uint8_t pendingStatus[BT_STATUS_PACKET_SIZE];
+    bool statusPending;
+    
+    // Series query output: closed buckets are packed here until a packet is full
+    SeriesAggregator series;
+    SeriesBucket seriesPendingBucket;
+    bool seriesPending;
+    uint8_t seriesPacket[BT_CHUNK_SIZE];
+    uint16_t seriesPacketLen;
+    
+    // Request being answered (see BleProtocol.h for framing)
+    uint8_t currentRequestId;
+    uint8_t currentEncoding;
+    
+    BluetoothJob job;
+    
+    // Status beacon, with the gateway's acks after it
+    uint8_t beaconPayload[BEACON_MAX_PAYLOAD];
+    uint8_t beaconPayloadLen;
+    uint8_t beaconCounter;
+    unsigned long lastReadingTime;
+    
+    // Alerts latched until the gateway acknowledges them (BleBeacon.h)
+    BeaconAlertLatch alertLatch;
+    bool ackListening;
+    unsigned long ackListenStart;
+    uint8_t ackReport[BEACON_MAX_PAYLOAD];
+    volatile uint8_t ackReportLen;
     
     void sendAllSettings();
+    void sendQueueStats();
+    void sendNeighbours();
+    void sendPowerProfile();
+    void startPowerSimulation(const uint8_t* data, uint16_t len);
     void updateSetting(uint8_t settingId, float value);
+    void applySettingsBulk(const uint8_t* data, uint16_t len);
     
     // Internal timing
     unsigned long lastUpdate;
+    
+    // Bluefruit is up; advertising, scans and the link need it
+    bool radioStarted;
         
     // Internal methods
     void setupBLEService();
     
     void sendResponse(BluetoothResponse response, uint8_t* data = nullptr, uint16_t len = 0);
     void sendCurrentData();
-    void sendFileList();
+    void sendFileList(const CatalogQuery& query);
     void sendFile(const char* filename);
+    void startTransfer(const char* filename, uint32_t offset, uint8_t window);
     void sendDailySummary(uint32_t date);
-    void sendAlerts();
+    void sendAlerts(const AlertQuery& query);
+    uint8_t fitPageSize(uint8_t requested, uint16_t entryBytes);
     void sendBeePresetList();
     void sendDeviceInfo();
     void sendFileData(const char* filename);
@@ -149,18 +315,46 @@ private:
     void sendFileInfo(const char* filename);
     void setDateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute);
     void startAudioCalibration(uint8_t durationSeconds);        
+    void startSync(const uint8_t* clientId, uint32_t cursor);
+    void startSeriesQuery(const SeriesQuery& query);
     void updateAdvertising();
+    uint8_t buildBeaconPayload(uint8_t* out);
+    void startBeacon();
+    void refreshBeacon();
+    void startAckListen();
+    void stopAckListen();
+    void refreshLinkInfo();
+    void setLinkProfile(bool bulk);
+    uint16_t fillLinkInfo(uint8_t* out);
+    void sendLinkInfo();
+    void startBenchmark(uint16_t packetCount);
+    void pumpBenchmark();
+    bool jobBusy();
+    void runJob();
+    void stepFileStreamJob();
+    void stepCalibrationJob();
+    void stepSyncJob();
+    void stepSeriesJob();
+    void stepPowerSimulationJob();
+    bool flushSeriesPacket();
+    void finishJob();
+    void reportProgress(bool force);
     
 public:
     BluetoothManager();
     
-    // Initialization
-    void initialize(SystemStatus* sysStatus, SystemSettings* sysSettings);
+    // Initialization. A scheduled wake passes startRadio = false: the
+    // SoftDevice stays off until a user wake enables Bluetooth
+    void initialize(SystemStatus* sysStatus, SystemSettings* sysSettings, bool startRadio = true);
+    void start();
+    bool isStarted() const { return radioStarted; }
     void loadBluetoothSettings();
     void saveBluetoothSettings();
     
     // Core Bluetooth management
     void update();    
+    // Commands left queued by a bounded update(); call it again soon
+    bool hasPendingCommands() const { return !commandQueue.isEmpty(); }
     void setEnabled(bool enabled);
     
     // Mode management
@@ -172,6 +366,14 @@ public:
     BluetoothStatus getStatus() const;
     bool isDiscoverable() const;
     bool isConnected() const;
+    // Beacon, gateway scans and a live link all stop in System OFF
+    bool needsRadioWhileAsleep() const {
+        return settings.beaconEnabled || settings.gatewayEnabled || state.clientConnected;
+    }
+    // Work update() has to come back for without a BLE event while no
+    // client is connected: gateway scans, the ack window, beacon refreshes
+    // and a pending advertising change
+    bool hasTimedWork() const;
     unsigned long getTimeRemaining() const;  // For manual mode
     void forceDisconnect();
     void startAdvertising();
@@ -180,6 +382,7 @@ public:
     // Settings access
     BluetoothSettings& getSettings() { return settings; }
     BluetoothState& getState() { return state; }
+    BleTransfer& getTransfer() { return transfer; }
     
     // Statistics
     void printBluetoothStatus() const;
@@ -189,6 +392,26 @@ public:
     String getDeviceName() const;
     bool shouldBeDiscoverable() const;
     void handleCommand(uint8_t* data, uint16_t len);
+    void rejectCommand(uint8_t* data, uint16_t len);
+    bool notifyData(const uint8_t* data, uint16_t len);
+    bool notifyResponse(const uint8_t* data, uint16_t len);
+    bool notifyRaw(const uint8_t* data, uint16_t len);
+    bool queueCommand(const uint8_t* data, uint16_t len);
+    void onTxComplete() { notifyQueue.onTxComplete(); }
+    void setTransport(BleTransport* t) { transport = t; }
+    void onConnect(uint16_t connHandle);
+    bool onDisconnect(uint16_t connHandle);   // false when not the link being served
+    void onNewReading();
+    void setBeacon(bool enabled, uint16_t intervalMs);
+    // The status record last put on air (BleBeacon.h)
+    const uint8_t* getBeaconPayload() const { return beaconPayload; }
+    uint8_t getBeaconPayloadLength() const { return beaconPayloadLen; }
+    const BeaconAlertLatch& getAlertLatch() const { return alertLatch; }
+    bool isListeningForAck() const { return ackListening; }
+    // A gateway beacon heard while listening; called from the scan callback
+    void queueGatewayBeacon(const uint8_t* payload, uint8_t len);
+    void setGateway(bool enabled, uint8_t periodMin);
+    uint16_t getMaxPacketSize() const { return link.maxPacketSize; }
     bool isInScheduledHours(uint8_t currentHour) const;
 };
 
@@ -196,16 +419,23 @@ public:
 // GLOBAL BLUETOOTH FUNCTIONS
 // =============================================================================
 
-// Callback functions for BLE events
-#ifdef NRF52_SERIES
+// Callback functions for BLE events; the link ones are also driven by
+// the host simulator
 void bluetoothConnectCallback(uint16_t conn_handle);
 void bluetoothDisconnectCallback(uint16_t conn_handle, uint8_t reason);
+bool bluetoothNotifyData(const uint8_t* data, uint16_t len);
+bool bluetoothNotifyResponse(const uint8_t* data, uint16_t len);
+bool bluetoothNotifyRaw(const uint8_t* data, uint16_t len);
+#ifdef NRF52_SERIES
 void bluetoothCommandCallback(uint16_t conn_hdl, BLECharacteristic* chr, uint8_t* data, uint16_t len);
+void bluetoothBleEventCallback(ble_evt_t* evt);
+void bluetoothAckScanCallback(ble_gap_evt_adv_report_t* report);
 #endif
 
 // Utility functions
 const char* bluetoothModeToString(BluetoothMode mode);
 const char* bluetoothStatusToString(BluetoothStatus status);
 String formatDataSize(uint32_t bytes);
+uint16_t notifyPayloadForMtu(uint16_t mtu);
 
-#endif // BLUETOOTH_H
\ No newline at end of file
+#endif // BLUETOOTH_H
\ No newline at end of file
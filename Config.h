@@ -30,6 +30,7 @@
 
 // SD Card
 #define SD_CS_PIN 10
+#define SD_POWER_PIN -1         // Load switch enable for the card, -1 if not fitted
 
 // Battery monitoring
 #define VBATPIN A6
@@ -180,6 +181,25 @@ const unsigned long DEBOUNCE_DELAY = 50;       // 50ms
 #define FIELD_DISPLAY_TIMEOUT 30000  // Display off after 30 seconds
 #define FIELD_SENSOR_INTERVAL 10000  // Read sensors every 10 seconds
 
+// Field builds (-DFIELD_BUILD) boot without waiting for a serial monitor
+#ifdef FIELD_BUILD
+#define SERIAL_BOOT_WAIT_MS 0
+#else
+#define SERIAL_BOOT_WAIT_MS 1000
+#endif
+
+// FreeRTOS comes with the nRF52 core; the host build can run the task
+// layout on the pthreads port in test/host (-DHOST_FREERTOS)
+#if defined(NRF52_SERIES) || defined(HOST_FREERTOS)
+#define HAS_FREERTOS
+#endif
+
+// Internal flash (LittleFS) on the nRF52; the host build keeps it in
+// memory through the shim in test/host (-DHOST_INTERNAL_FS)
+#if defined(NRF52_SERIES) || defined(HOST_INTERNAL_FS)
+#define HAS_INTERNAL_FS
+#endif
+
 // Critical alert thresholds
 #define CRITICAL_BATTERY_VOLTAGE 3.3  // Must last weeks in field
 #define QUEEN_ABSENCE_ALERT_HOURS 3  // Alert after 3 hours no queen
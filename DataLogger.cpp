@@ -8,6 +8,7 @@
 #include "Alerts.h" 
 #include "Sensors.h"
 #include "Display.h"  // For updateDiagnosticLine
+#include "RecordStore.h"
 
 // Use SDLib namespace to avoid ambiguity
 using SDFile = SDLib::File;
@@ -75,6 +76,9 @@ void logData(SensorData& data, RTC_PCF8523& rtc, SystemSettings& settings,
             dataFile.flush();
             dataFile.close();
             
+            // Sequence-numbered copy for incremental BLE sync
+            recordStore.append(data, now.unixtime());
+            
             Serial.println(F("Log entry written successfully"));
             
             // Success - flush any buffered data
@@ -172,6 +176,7 @@ void flushBufferedData(RTC_PCF8523& rtc, SystemSettings& settings, SystemStatus&
                 // Write the buffered entry
                 writeLogEntry(dataFile, now, emergencyBuffer.readings[index]);
                 dataFile.close();
+                recordStore.append(emergencyBuffer.readings[index], now.unixtime());
             } else {
                 Serial.println(F("Buffer flush FAILED: Could not open SD file."));
                 flushSucceeded = false;
@@ -268,6 +268,7 @@ struct BufferedReading {
     float environmentalStress;       // 0-100 stress level
     
     bool analysisValid;
+    uint32_t intervalS;              // Interval to the next wake, seconds
 
     
 };
@@ -0,0 +1,251 @@
+/**
+ * EventScheduler.cpp
+ * Tickless main loop scheduling implementation
+ */
+
+#include "EventScheduler.h"
+
+#ifdef HAS_FREERTOS
+  #include <FreeRTOS.h>
+  #include <semphr.h>
+  #include <task.h>
+
+  // Given by post(); the loop task blocks on it in idle()
+  static SemaphoreHandle_t wakeSemaphore = nullptr;
+#endif
+
+#ifdef NRF52_SERIES
+  #include <nrf.h>
+  #define IN_ISR() ((SCB->ICSR & SCB_ICSR_VECTACTIVE_Msk) != 0)
+#else
+  #define IN_ISR() false
+#endif
+
+EventScheduler eventScheduler;
+
+static unsigned long defaultClock() {
+    return millis();
+}
+
+EventScheduler::EventScheduler() {
+    clock = defaultClock;
+    sleeper = nullptr;
+    mode = 0;
+    lastIdle = 0;
+    memset(timers, 0, sizeof(timers));
+    for (uint8_t i = 0; i < EVT_COUNT; i++) {
+        pending[i] = 0;
+        routes[i] = nullptr;
+    }
+    memset(modeStats, 0, sizeof(modeStats));
+}
+
+void EventScheduler::begin() {
+#ifdef HAS_FREERTOS
+    if (!wakeSemaphore) {
+        wakeSemaphore = xSemaphoreCreateBinary();
+    }
+#endif
+    lastIdle = clock();
+    Serial.println(F("Event scheduler: OK"));
+}
+
+void EventScheduler::setClock(SchedulerClockFn now, SchedulerSleepFn sleep) {
+    clock = now ? now : defaultClock;
+    sleeper = sleep;
+    lastIdle = clock();
+    memset(timers, 0, sizeof(timers));
+}
+
+// =============================================================================
+// TIMERS
+// =============================================================================
+
+bool EventScheduler::every(uint8_t timer, unsigned long periodMs) {
+    if (timer >= TIMER_COUNT || periodMs == 0) return false;
+
+    Timer& t = timers[timer];
+    unsigned long current = clock();
+    t.polled = true;
+
+    if (!t.active || t.periodMs != periodMs) {
+        t.active = true;
+        t.periodMs = periodMs;
+        t.due = current + periodMs;
+        return false;
+    }
+
+    if ((long)(current - t.due) < 0) return false;
+
+    // Stay on the original phase, but skip missed periods instead of
+    // firing them back to back
+    t.due += periodMs;
+    if ((long)(current - t.due) >= 0) {
+        t.due = current + periodMs;
+    }
+    return true;
+}
+
+void EventScheduler::restart(uint8_t timer) {
+    if (timer >= TIMER_COUNT) return;
+    timers[timer].due = clock() + timers[timer].periodMs;
+}
+
+void EventScheduler::stop(uint8_t timer) {
+    if (timer >= TIMER_COUNT) return;
+    timers[timer].active = false;
+    timers[timer].polled = false;
+}
+
+// =============================================================================
+// EVENTS
+// =============================================================================
+
+void EventScheduler::post(SchedulerEvent event) {
+    if (event >= EVT_COUNT) return;
+
+#ifdef HAS_FREERTOS
+    bool inIsr = IN_ISR();
+    if (routes[event]) {
+        TaskHandle_t task = (TaskHandle_t)routes[event];
+        if (inIsr) {
+            BaseType_t woken = pdFALSE;
+            vTaskNotifyGiveFromISR(task, &woken);
+            portYIELD_FROM_ISR(woken);
+        } else {
+            xTaskNotifyGive(task);
+        }
+        return;
+    }
+#endif
+
+    // Each event has its own counter, so concurrent posters of different
+    // events never touch the same byte
+    if (pending[event] < 255) pending[event]++;
+
+#ifdef HAS_FREERTOS
+    if (!wakeSemaphore) return;
+    if (inIsr) {
+        BaseType_t woken = pdFALSE;
+        xSemaphoreGiveFromISR(wakeSemaphore, &woken);
+        portYIELD_FROM_ISR(woken);
+    } else {
+        xSemaphoreGive(wakeSemaphore);
+    }
+#endif
+}
+
+void EventScheduler::routeToTask(SchedulerEvent event, void* taskHandle) {
+    if (event < EVT_COUNT) routes[event] = taskHandle;
+}
+
+bool EventScheduler::take(SchedulerEvent event) {
+    if (event >= EVT_COUNT) return false;
+
+    noInterrupts();
+    uint8_t count = pending[event];
+    pending[event] = 0;
+    interrupts();
+    return count > 0;
+}
+
+bool EventScheduler::hasPendingEvents() const {
+    for (uint8_t i = 0; i < EVT_COUNT; i++) {
+        if (pending[i]) return true;
+    }
+    return false;
+}
+
+// =============================================================================
+// IDLE
+// =============================================================================
+
+void EventScheduler::wait(unsigned long ms) {
+    if (sleeper) {
+        sleeper(ms);
+        return;
+    }
+
+#ifdef HAS_FREERTOS
+    if (wakeSemaphore) {
+        // Returns early when post() gives the semaphore
+        xSemaphoreTake(wakeSemaphore, pdMS_TO_TICKS(ms));
+        return;
+    }
+#endif
+    delay(ms);
+}
+
+bool EventScheduler::waitForEvent(unsigned long timeoutMs) {
+    if (!hasPendingEvents()) wait(timeoutMs);
+    return hasPendingEvents();
+}
+
+void EventScheduler::idle() {
+    unsigned long current = clock();
+    SchedulerModeStats& s = modeStats[mode];
+    s.passes++;
+    s.totalMs += current - lastIdle;
+    lastIdle = current;
+
+    // Only deadlines someone asked about since the last pass count
+    unsigned long waitMs = SCHED_MAX_IDLE_MS;
+    bool due = false;
+    for (uint8_t i = 0; i < TIMER_COUNT; i++) {
+        Timer& t = timers[i];
+        if (!t.active || !t.polled) continue;
+        t.polled = false;
+
+        long remaining = (long)(t.due - current);
+        if (remaining <= 0) {
+            due = true;
+        } else {
+            waitMs = min(waitMs, (unsigned long)remaining);
+        }
+    }
+    if (due || hasPendingEvents()) return;
+
+    wait(waitMs);
+
+    unsigned long woke = clock();
+    s.wakeups++;
+    s.sleepMs += woke - current;
+    s.totalMs += woke - current;
+    lastIdle = woke;
+}
+
+// =============================================================================
+// STATISTICS
+// =============================================================================
+
+void EventScheduler::setMode(uint8_t newMode) {
+    if (newMode < SCHED_MAX_MODES) mode = newMode;
+}
+
+float EventScheduler::getWakeupsPerHour(uint8_t m) const {
+    const SchedulerModeStats& s = getModeStats(m);
+    if (s.totalMs == 0) return 0.0f;
+    return s.wakeups * 3600000.0f / s.totalMs;
+}
+
+void EventScheduler::resetStats() {
+    memset(modeStats, 0, sizeof(modeStats));
+    lastIdle = clock();
+}
+
+void EventScheduler::printStats() const {
+    static const char* const modeNames[SCHED_MAX_MODES] = { "Awake", "Sleeping", "Sched wake", "User wake" };
+
+    Serial.println(F("Scheduler (wakeups/h, % asleep):"));
+    for (uint8_t m = 0; m < SCHED_MAX_MODES; m++) {
+        const SchedulerModeStats& s = modeStats[m];
+        if (s.totalMs == 0) continue;
+        Serial.print(F("  "));
+        Serial.print(modeNames[m]);
+        Serial.print(F(": "));
+        Serial.print(getWakeupsPerHour(m), 0);
+        Serial.print(F(", "));
+        Serial.print(s.sleepMs * 100.0f / s.totalMs, 1);
+        Serial.println(F("%"));
+    }
+}
@@ -0,0 +1,127 @@
+/**
+ * EventScheduler.h
+ * Cooperative timers and wake events for a tickless main loop
+ *
+ * loop() no longer spins: each pass asks the scheduler whether its
+ * periodic work is due (every()) and which events arrived (take()),
+ * then calls idle(). idle() sleeps until the nearest timer deadline or
+ * until an interrupt or BLE callback posts an event.
+ *
+ * Only timers that were asked about since the last idle() count toward
+ * the deadline, so work that stops being polled (a state handler that no
+ * longer runs, a screen that is not shown) stops waking the CPU without
+ * having to cancel anything.
+ *
+ * On the nRF52 the wait blocks the loop task on a semaphore; the FreeRTOS
+ * idle task then sleeps in sd_app_evt_wait() with the tick suppressed.
+ * The clock and sleep functions can be replaced, so the same schedule
+ * can be run against a virtual clock.
+ */
+
+#ifndef EVENT_SCHEDULER_H
+#define EVENT_SCHEDULER_H
+
+#include "Config.h"
+
+#define SCHED_MAX_IDLE_MS 3600000UL      // Longest single sleep with no timers polled
+#define SCHED_MAX_MODES 4                // Wake statistics kept per SystemState
+#define BUTTON_POLL_MS 10                // Debounce polling while a button is active
+
+// Posted from interrupts and BLE callbacks
+enum SchedulerEvent {
+    EVT_BUTTON = 0,              // A button pin changed
+    EVT_RTC_ALARM = 1,           // PCF8523 interrupt line
+    EVT_BLE = 2,                 // Command written, TX complete, connection change, scan report
+    EVT_COUNT = 3
+};
+
+// Periodic work in the main loop
+enum SchedulerTimer {
+    TIMER_BUTTONS = 0,
+    TIMER_BLUETOOTH,
+    TIMER_SENSORS,
+    TIMER_POWER,
+    TIMER_POWER_DEBUG,
+    TIMER_AUDIO_SAMPLE,
+    TIMER_FULL_ANALYSIS,
+    TIMER_LOG,
+    TIMER_DISPLAY,
+    TIMER_COUNT
+};
+
+typedef unsigned long (*SchedulerClockFn)();
+typedef void (*SchedulerSleepFn)(unsigned long ms);
+
+struct SchedulerModeStats {
+    uint32_t wakeups;            // Returns from a sleep
+    uint32_t passes;             // idle() calls, slept or not
+    uint32_t sleepMs;
+    uint32_t totalMs;
+};
+
+class EventScheduler {
+private:
+    struct Timer {
+        bool active;
+        bool polled;             // Asked about since the last idle()
+        unsigned long periodMs;
+        unsigned long due;
+    };
+
+    Timer timers[TIMER_COUNT];
+    volatile uint8_t pending[EVT_COUNT];
+    void* routes[EVT_COUNT];     // Task notified instead of the loop, see AppTasks.h
+
+    SchedulerClockFn clock;
+    SchedulerSleepFn sleeper;
+
+    uint8_t mode;
+    unsigned long lastIdle;
+    SchedulerModeStats modeStats[SCHED_MAX_MODES];
+
+    void wait(unsigned long ms);
+
+public:
+    EventScheduler();
+
+    void begin();
+
+    // Replaces millis()/the real sleep, e.g. with a virtual clock
+    void setClock(SchedulerClockFn now, SchedulerSleepFn sleep);
+    unsigned long now() const { return clock(); }
+
+    // True once per periodMs; the first call arms the timer. A changed
+    // period re-arms it from now.
+    bool every(uint8_t timer, unsigned long periodMs);
+
+    // Pushes the next expiry one full period out
+    void restart(uint8_t timer);
+    void stop(uint8_t timer);
+
+    // ISR and task safe
+    void post(SchedulerEvent event);
+
+    // Sends an event to a FreeRTOS task (notification) instead of loop()
+    void routeToTask(SchedulerEvent event, void* taskHandle);
+
+    // Consumes an event; true if it was posted since the last take
+    bool take(SchedulerEvent event);
+    bool hasPendingEvents() const;
+
+    // Sleeps until the nearest polled deadline or the next event
+    void idle();
+
+    // Sleeps up to timeoutMs regardless of timers; true if an event is pending
+    bool waitForEvent(unsigned long timeoutMs);
+
+    // Attributes wakeups to a mode (the SystemState) for the statistics
+    void setMode(uint8_t newMode);
+    const SchedulerModeStats& getModeStats(uint8_t m) const { return modeStats[m < SCHED_MAX_MODES ? m : 0]; }
+    float getWakeupsPerHour(uint8_t m) const;
+    void resetStats();
+    void printStats() const;
+};
+
+extern EventScheduler eventScheduler;
+
+#endif // EVENT_SCHEDULER_H
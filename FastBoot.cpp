@@ -0,0 +1,174 @@
+/**
+ * FastBoot.cpp
+ * Wake-to-measure fast path implementation
+ */
+
+#include "FastBoot.h"
+#include "Settings.h"
+#include "Utils.h"
+
+FastBoot fastBoot;
+
+// Retained through System OFF (see PowerManager::enterDeepSleepMode)
+__attribute__((section(".noinit"))) static FastBootCache cache;
+
+BootPath chooseBootPath(WakeUpSource reason, bool retainedValid, bool cacheValid) {
+    // Only a scheduled wake with field mode state to resume skips the
+    // normal boot; everything else is a user in front of the device
+    if (reason != WAKE_RTC || !retainedValid) return BOOT_FULL;
+    return cacheValid ? BOOT_FAST : BOOT_QUICK;
+}
+
+FastBoot::FastBoot() {
+    path = BOOT_FULL;
+    bootUs = 0;
+    latencyUs = 0;
+    cacheOk = false;
+    storagePending = false;
+}
+
+void FastBoot::markBootStart() {
+    bootUs = micros();
+}
+
+// =============================================================================
+// BOOT DECISION
+// =============================================================================
+
+uint32_t FastBoot::cacheCheck(const FastBootCache& c) {
+    return crc32Update(0, (const uint8_t*)&c, offsetof(FastBootCache, check));
+}
+
+BootPath FastBoot::choose(WakeUpSource reason, bool retainedValid) {
+    cacheOk = cache.magic == FAST_BOOT_MAGIC &&
+              cache.version == FAST_BOOT_VERSION &&
+              cache.check == cacheCheck(cache);
+
+    if (cacheOk) {
+        SystemSettings cached = cache.settings;
+        cacheOk = cached.magicNumber == SETTINGS_MAGIC_NUMBER &&
+                  cached.checksum == calculateChecksum(&cached);
+    }
+
+    path = chooseBootPath(reason, retainedValid, cacheOk);
+    return path;
+}
+
+void FastBoot::restore(SystemSettings& settings, SystemStatus& status, FieldModeBuffer& buffer) {
+    settings = cache.settings;
+    status.pdmWorking = cache.micPresent;
+    buffer = cache.buffer;
+    buffer.lastFlushTime = millis();
+
+    Serial.print(F("Fast boot: settings cached, "));
+    Serial.print(buffer.count);
+    Serial.println(F(" readings restored"));
+}
+
+void FastBoot::save(const SystemSettings& settings, const SystemStatus& status,
+                    const FieldModeBuffer& buffer, uint32_t rtcTime) {
+    if (!cacheOk) {
+        memset(&cache, 0, sizeof(cache));
+        cache.lastFlushTime = rtcTime;
+    }
+
+    cache.magic = FAST_BOOT_MAGIC;
+    cache.version = FAST_BOOT_VERSION;
+    cache.micPresent = status.pdmWorking ? 1 : 0;
+    cache.settings = settings;
+    cache.buffer = buffer;
+    cache.check = cacheCheck(cache);
+    cacheOk = true;
+}
+
+const FastBootCache* FastBoot::getCache() const {
+    return &cache;
+}
+
+// =============================================================================
+// LATENCY
+// =============================================================================
+
+void FastBoot::markFirstSample() {
+    if (latencyUs) return;
+    latencyUs = max((uint32_t)(micros() - bootUs), (uint32_t)1);
+
+    if (path == BOOT_FAST && cacheOk) {
+        cache.fastBoots++;
+        cache.lastLatencyUs = latencyUs;
+        cache.maxLatencyUs = max(cache.maxLatencyUs, latencyUs);
+        cache.totalLatencyMs += (latencyUs + 500) / 1000;
+    }
+
+    Serial.print(F("Wake to first sample: "));
+    Serial.print(latencyUs / 1000.0f, 1);
+    Serial.print(F(" ms ("));
+    Serial.print(getPathString(path));
+    Serial.println(F(" boot)"));
+}
+
+uint32_t FastBoot::getFastBoots() const {
+    return cacheOk ? cache.fastBoots : 0;
+}
+
+float FastBoot::getAverageLatencyMs() const {
+    if (!cacheOk || cache.fastBoots == 0) return 0.0f;
+    return (float)cache.totalLatencyMs / cache.fastBoots;
+}
+
+// =============================================================================
+// STORAGE
+// =============================================================================
+
+bool FastBoot::ensureStorage(SystemStatus& status) {
+    if (!storagePending) return status.sdWorking;
+    storagePending = false;
+
+    status.sdWorking = SD.begin(SD_CS_PIN);
+    Serial.println(status.sdWorking ? F("SD: OK (on demand)") : F("SD: FAILED (on demand)"));
+    return status.sdWorking;
+}
+
+bool FastBoot::isFlushDue(uint32_t rtcTime) const {
+    // millis() restarts with every System OFF wake, so the hourly flush
+    // is timed on the RTC instead
+    if (!cacheOk || rtcTime == 0 || cache.lastFlushTime == 0) return false;
+    return rtcTime - cache.lastFlushTime >= FAST_BOOT_FLUSH_INTERVAL_S;
+}
+
+void FastBoot::noteFlush(uint32_t rtcTime) {
+    if (cacheOk && rtcTime) cache.lastFlushTime = rtcTime;
+}
+
+// =============================================================================
+// DIAGNOSTICS
+// =============================================================================
+
+const char* FastBoot::getPathString(BootPath p) {
+    switch (p) {
+        case BOOT_FULL: return "full";
+        case BOOT_QUICK: return "quick";
+        case BOOT_FAST: return "fast";
+        default: return "?";
+    }
+}
+
+void FastBoot::printStatus() const {
+    Serial.print(F("Boot: "));
+    Serial.print(getPathString(path));
+    if (latencyUs) {
+        Serial.print(F(", first sample after "));
+        Serial.print(latencyUs / 1000.0f, 1);
+        Serial.print(F(" ms"));
+    }
+    if (getFastBoots()) {
+        Serial.print(F(", fast boots "));
+        Serial.print(cache.fastBoots);
+        Serial.print(F(" avg "));
+        Serial.print(getAverageLatencyMs(), 1);
+        Serial.print(F(" ms max "));
+        Serial.print(cache.maxLatencyUs / 1000.0f, 1);
+        Serial.print(F(" ms"));
+    }
+    Serial.println();
+}
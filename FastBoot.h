@@ -0,0 +1,109 @@
+/**
+ * FastBoot.h
+ * Wake-to-measure fast path after System OFF
+ *
+ * A scheduled wake from System OFF is a reset, so setup() runs again.
+ * Before going down, the settings (with the sensor calibration), the
+ * microphone detection result and the readings not yet on SD are cached
+ * in a retained RAM block. On the next RTC wake the cache replaces the
+ * settings load, the SD bring-up and the microphone probe. Buttons, the
+ * tasks and the configuration kept in InternalFS (wake schedule, adaptive
+ * interval, phase profile) start on every path; a scheduled wake leaves
+ * the SoftDevice off until a button enables Bluetooth:
+ *
+ *   BOOT_FULL    power-on, reset pin, button wake, or no retained field
+ *                mode state
+ *   BOOT_QUICK   scheduled wake, cache unusable: settings from flash,
+ *                microphone probed, SD mounted
+ *   BOOT_FAST    scheduled wake from the cache; SD is only brought up
+ *                when a flush is due (buffer full or an hour of RTC time)
+ *
+ * The time from the start of setup() to the first sensor sample is
+ * measured on every boot and kept over fast boots. The bootloader's
+ * share of the wake is not visible to the application.
+ */
+
+#ifndef FAST_BOOT_H
+#define FAST_BOOT_H
+
+#include "Config.h"
+#include "DataStructures.h"
+#include "PowerManager.h"
+
+#define FAST_BOOT_MAGIC 0xFA57B007
+#define FAST_BOOT_VERSION 2
+#define FAST_BOOT_FLUSH_INTERVAL_S 3600UL    // As isTimeForBufferFlush()
+
+enum BootPath {
+    BOOT_FULL = 0,
+    BOOT_QUICK = 1,
+    BOOT_FAST = 2
+};
+
+// The decision on its own, free of hardware state
+BootPath chooseBootPath(WakeUpSource reason, bool retainedValid, bool cacheValid);
+
+// Kept in RAM through System OFF
+struct FastBootCache {
+    uint32_t magic;
+    uint8_t version;
+    uint8_t micPresent;
+    uint8_t reserved[2];
+    SystemSettings settings;     // Includes the calibration offsets
+    FieldModeBuffer buffer;      // Readings not yet on SD
+    uint32_t lastFlushTime;      // RTC time of the last SD flush
+
+    // Wake to first sample over fast boots
+    uint32_t fastBoots;
+    uint32_t lastLatencyUs;
+    uint32_t maxLatencyUs;
+    uint32_t totalLatencyMs;
+    uint32_t check;
+};
+
+class FastBoot {
+private:
+    BootPath path;
+    unsigned long bootUs;        // micros() at the start of setup()
+    uint32_t latencyUs;          // This boot, 0 until the first sample
+    bool cacheOk;                // Checked once at boot, then kept by save()
+    bool storagePending;
+
+    static uint32_t cacheCheck(const FastBootCache& c);
+
+public:
+    FastBoot();
+
+    // First thing in setup()
+    void markBootStart();
+
+    BootPath choose(WakeUpSource reason, bool retainedValid);
+    BootPath getPath() const { return path; }
+    bool isCacheValid() const { return cacheOk; }
+
+    // BOOT_FAST: settings, microphone flag and buffered readings
+    void restore(SystemSettings& settings, SystemStatus& status, FieldModeBuffer& buffer);
+
+    // Before System OFF; rtcTime seeds the flush clock on a fresh cache
+    void save(const SystemSettings& settings, const SystemStatus& status,
+              const FieldModeBuffer& buffer, uint32_t rtcTime);
+    const FastBootCache* getCache() const;
+
+    void markFirstSample();
+    uint32_t getLatencyUs() const { return latencyUs; }
+    uint32_t getFastBoots() const;
+    float getAverageLatencyMs() const;
+
+    // SD is mounted on first use after a fast boot
+    void deferStorage() { storagePending = true; }
+    bool ensureStorage(SystemStatus& status);
+    bool isFlushDue(uint32_t rtcTime) const;
+    void noteFlush(uint32_t rtcTime);
+
+    static const char* getPathString(BootPath p);
+    void printStatus() const;
+};
+
+extern FastBoot fastBoot;
+
+#endif // FAST_BOOT_H
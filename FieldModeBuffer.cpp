@@ -4,6 +4,7 @@
 #include "Utils.h"    // For getBeeStateString
 #include "Alerts.h"   // For getAlertString
 #include "Audio.h"
+#include "RecordStore.h"
 
 FieldModeBufferManager fieldBuffer;
 
@@ -11,7 +12,8 @@ FieldModeBufferManager::FieldModeBufferManager() {
     clearBuffer();
 }
 
-bool FieldModeBufferManager::addReading(const SensorData& data, uint32_t timestamp, const AudioAnalysisResult* audioResult) {
+bool FieldModeBufferManager::addReading(const SensorData& data, uint32_t timestamp, const AudioAnalysisResult* audioResult,
+                                        uint32_t intervalS) {
     if (buffer.count >= MAX_BUFFERED_READINGS) {
         return false; // Buffer full
     }
@@ -75,6 +77,9 @@ bool FieldModeBufferManager::addReading(const SensorData& data, uint32_t timesta
         data.temperature, data.humidity, data.pressure,
         settings.tempMin, settings.tempMax, settings.humidityMin, settings.humidityMax);
     
+    // Interval in force after this reading (0 = the configured one)
+    reading.intervalS = intervalS ? intervalS : settings.logInterval * 60UL;
+    
 
 
     // FULL ML AUDIO DATA 
@@ -179,6 +184,29 @@ void FieldModeBufferManager::clearBuffer() {
     buffer.lastFlushTime = millis();
 }
 
+// Whether the first line of a file ends with the given column
+static bool headerEndsWith(const char* filename, const char* column) {
+    SDLib::File file = SD.open(filename, FILE_READ);
+    if (!file) {
+        return false;
+    }
+    
+    char tail[16];
+    size_t len = 0;
+    int c;
+    while ((c = file.read()) >= 0 && c != '\n') {
+        if (c == '\r') continue;
+        if (len == sizeof(tail)) {
+            memmove(tail, tail + 1, --len);
+        }
+        tail[len++] = (char)c;
+    }
+    file.close();
+    
+    size_t n = strlen(column);
+    return len >= n && memcmp(tail + len - n, column, n) == 0;
+}
+
 bool FieldModeBufferManager::flushToSD(RTC_PCF8523& rtc, SystemStatus& status) {
     if (buffer.count == 0) {
         return true; // Nothing to flush
@@ -197,8 +225,11 @@ bool FieldModeBufferManager::flushToSD(RTC_PCF8523& rtc, SystemStatus& status) {
     char filename[12];
     sprintf(filename, "/H%02d%02d.CSV", now.year() % 100, now.month());
     
-    // Check if file exists to write header
+    // Check if file exists to write header. A file begun by older
+    // firmware has no interval column and keeps its layout to the end of
+    // the month
     bool fileExists = SD.exists(filename);
+    bool withInterval = !fileExists || headerEndsWith(filename, ",Interval_S");
     SDLib::File dataFile = SD.open(filename, FILE_WRITE);
     
     if (dataFile) {
@@ -213,7 +244,8 @@ bool FieldModeBufferManager::flushToSD(RTC_PCF8523& rtc, SystemStatus& status) {
                             "HourSin,HourCos,DayYearSin,DayYearCos,"
                             "ContextFlags,AmbientNoise,SignalQuality,"
                             "QueenDetected,AbscondingRisk,ActivityIncrease,AnalysisValid,"
-                            "DewPoint,VPD,HeatIndex,TempRate,HumidityRate,PressureRate,ForagingIndex,EnvStress"));
+                            "DewPoint,VPD,HeatIndex,TempRate,HumidityRate,PressureRate,ForagingIndex,EnvStress,"
+                            "Interval_S"));
         }
         
         // Write all buffered readings with FULL ML DATA
@@ -265,7 +297,7 @@ bool FieldModeBufferManager::flushToSD(RTC_PCF8523& rtc, SystemStatus& status) {
             dataFile.print(reading.queenDetected ? "TRUE" : "FALSE"); dataFile.print(',');
             dataFile.print(reading.abscondingRisk); dataFile.print(',');
             dataFile.print(reading.activityIncrease, 3); dataFile.print(',');
-            dataFile.println(reading.analysisValid ? "TRUE" : "FALSE");
+            dataFile.print(reading.analysisValid ? "TRUE" : "FALSE"); dataFile.print(',');
 
             // Environmental ML data
             dataFile.print(reading.dewPoint, 2); dataFile.print(',');
@@ -275,11 +307,32 @@ bool FieldModeBufferManager::flushToSD(RTC_PCF8523& rtc, SystemStatus& status) {
             dataFile.print(reading.humidityRate, 3); dataFile.print(',');
             dataFile.print(reading.pressureRate, 3); dataFile.print(',');
             dataFile.print(reading.foragingComfortIndex, 1); dataFile.print(',');
-            dataFile.println(reading.environmentalStress, 1);
+            if (withInterval) {
+                dataFile.print(reading.environmentalStress, 1); dataFile.print(',');
+                dataFile.println(reading.intervalS);
+            } else {
+                dataFile.println(reading.environmentalStress, 1);
+            }
         }
         
         dataFile.close();
         
+        // Sequence-numbered copies for incremental BLE sync
+        for (uint8_t i = 0; i < buffer.count; i++) {
+            const BufferedReading& reading = buffer.readings[i];
+            SensorData data;
+            data.temperature = reading.temperature;
+            data.humidity = reading.humidity;
+            data.pressure = reading.pressure;
+            data.batteryVoltage = reading.batteryVoltage;
+            data.dominantFreq = reading.dominantFreq;
+            data.soundLevel = reading.soundLevel;
+            data.beeState = reading.beeState;
+            data.alertFlags = reading.alertFlags;
+            data.sensorsValid = true;
+            recordStore.append(data, reading.timestamp, RECORD_FLAG_FIELD_MODE);
+        }
+        
         Serial.println(F("FULL ML buffer flushed successfully - PURE DATA GOLD!"));
         clearBuffer();
         return true;
@@ -13,7 +13,8 @@ public:
     FieldModeBufferManager();
     
     // Buffer management
-    bool addReading(const SensorData& data, uint32_t timestamp, const AudioAnalysisResult* audioResult = nullptr);
+    bool addReading(const SensorData& data, uint32_t timestamp, const AudioAnalysisResult* audioResult = nullptr,
+                    uint32_t intervalS = 0);
     bool isBufferFull() const;
     uint8_t getBufferCount() const;
     void clearBuffer();
@@ -0,0 +1,266 @@
+/**
+ * FileCatalog.cpp
+ * Paged SD card file listing implementation
+ */
+
+#include "FileCatalog.h"
+#include "Utils.h"
+#include "BleGateway.h"
+
+#define CATALOG_TAIL_BYTES 128
+
+// =============================================================================
+// DIRECTORY WALK
+// =============================================================================
+
+void forEachCatalogFile(CatalogVisitFn visit, void* context) {
+    // Root directory
+    SDLib::File root = SD.open("/");
+    if (root) {
+        while (true) {
+            SDLib::File entry = root.openNextFile();
+            if (!entry) break;
+
+            if (!entry.isDirectory()) {
+                visit(entry.name(), entry.size(), context);
+            }
+            entry.close();
+        }
+        root.close();
+    }
+
+    // Gateway partitions, one directory per neighbour (BleGateway.h)
+    SDLib::File gatewayDir = SD.open(GATEWAY_DIR);
+    if (gatewayDir) {
+        while (true) {
+            SDLib::File entry = gatewayDir.openNextFile();
+            if (!entry) break;
+
+            if (entry.isDirectory()) {
+                char nodePath[24];
+                snprintf(nodePath, sizeof(nodePath), GATEWAY_DIR "/%s", entry.name());
+
+                SDLib::File nodeDir = SD.open(nodePath);
+                if (nodeDir) {
+                    while (true) {
+                        SDLib::File csvFile = nodeDir.openNextFile();
+                        if (!csvFile) break;
+
+                        if (!csvFile.isDirectory()) {
+                            char fullPath[CATALOG_PATH_LEN];
+                            snprintf(fullPath, sizeof(fullPath), "%s/%s", nodePath, csvFile.name());
+                            visit(fullPath, csvFile.size(), context);
+                        }
+                        csvFile.close();
+                    }
+                    nodeDir.close();
+                }
+            }
+            entry.close();
+        }
+        gatewayDir.close();
+    }
+
+    // HIVE_DATA year directories
+    SDLib::File hiveDir = SD.open("/HIVE_DATA");
+    if (!hiveDir) return;
+
+    while (true) {
+        SDLib::File entry = hiveDir.openNextFile();
+        if (!entry) break;
+
+        if (entry.isDirectory()) {
+            char yearPath[32];
+            snprintf(yearPath, sizeof(yearPath), "/HIVE_DATA/%s", entry.name());
+
+            SDLib::File yearDir = SD.open(yearPath);
+            if (yearDir) {
+                while (true) {
+                    SDLib::File csvFile = yearDir.openNextFile();
+                    if (!csvFile) break;
+
+                    if (!csvFile.isDirectory() && strstr(csvFile.name(), ".CSV")) {
+                        char fullPath[CATALOG_PATH_LEN];
+                        snprintf(fullPath, sizeof(fullPath), "%s/%s", yearPath, csvFile.name());
+                        visit(fullPath, csvFile.size(), context);
+                    }
+                    csvFile.close();
+                }
+                yearDir.close();
+            }
+        }
+        entry.close();
+    }
+    hiveDir.close();
+}
+
+bool parseLogFileMonth(const char* path, uint16_t& year, uint8_t& month) {
+    year = 0;
+    month = 0;
+
+    const char* name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+
+    unsigned y, m;
+    if (name[0] == 'H' && strlen(name) >= 5 && isdigit(name[1]) && isdigit(name[4]) &&
+        sscanf(name + 1, "%2u%2u", &y, &m) == 2) {
+        y += 2000;                                   // H2507.CSV
+    } else if (sscanf(name, "%4u-%2u", &y, &m) != 2) {  // 2025-07.CSV
+        return false;
+    }
+
+    if (m < 1 || m > 12) return false;
+    year = y;
+    month = m;
+    return true;
+}
+
+// =============================================================================
+// LOG FILE SUMMARY
+// =============================================================================
+
+// Reads one line, keeping the first bufLen-1 characters. Returns the full
+// line length including the newline, or -1 if none ends within limit bytes.
+static int16_t readLine(SDLib::File& file, char* buf, uint16_t bufLen, uint16_t limit) {
+    uint16_t len = 0;
+    while (len < limit) {
+        int c = file.read();
+        if (c < 0) break;
+        len++;
+        if (c == '\n') {
+            buf[min(len - 1, bufLen - 1)] = '\0';
+            return len;
+        }
+        if (len < bufLen) buf[len - 1] = c;
+    }
+    buf[min(len, (uint16_t)(bufLen - 1))] = '\0';
+    return -1;
+}
+
+// Every log format has the unix time as its second column
+static uint32_t parseUnixTimeColumn(const char* line) {
+    const char* comma = strchr(line, ',');
+    return comma ? strtoul(comma + 1, nullptr, 10) : 0;
+}
+
+bool readLogFileStats(const char* path, LogFileStats& stats) {
+    memset(&stats, 0, sizeof(stats));
+
+    SDLib::File file = SD.open(path, FILE_READ);
+    if (!file) return false;
+
+    uint32_t size = file.size();
+    char line[64];
+    uint32_t headerLen = 0;
+
+    int16_t len = readLine(file, line, sizeof(line), CATALOG_SCAN_BYTES);
+    if (len > 0 && strncmp(line, "DateTime", 8) == 0) {
+        headerLen = len;
+        len = readLine(file, line, sizeof(line), CATALOG_SCAN_BYTES);
+    }
+    if (len <= 0) {
+        file.close();
+        return false;
+    }
+
+    stats.firstTime = parseUnixTimeColumn(line);
+    stats.records = (size - headerLen + len / 2) / len;
+
+    // Last complete line: newest timestamp found in the tail
+    uint32_t tailStart = max(size - min(size, (uint32_t)CATALOG_TAIL_BYTES), headerLen);
+    char tail[CATALOG_TAIL_BYTES + 1];
+    file.seek(tailStart);
+    int got = file.read((uint8_t*)tail, size - tailStart);
+    file.close();
+    if (got <= 0) return true;
+    tail[got] = '\0';
+
+    // Skip the partial first line unless the tail starts on a line boundary
+    char* p = (tailStart == headerLen) ? tail : strchr(tail, '\n');
+    while (p && *p) {
+        if (*p == '\n') p++;
+        uint32_t t = parseUnixTimeColumn(p);
+        if (t >= stats.firstTime) {
+            stats.lastTime = max(stats.lastTime, t);
+        }
+        p = strchr(p, '\n');
+    }
+    return true;
+}
+
+// =============================================================================
+// PAGE SELECTION
+// =============================================================================
+
+struct PageContext {
+    const CatalogQuery* query;
+    CatalogEntry* entries;
+    uint8_t count;
+    uint32_t ordinal;
+    uint32_t matches;
+    uint32_t remaining;          // Matches after the token
+};
+
+static inline bool keyBefore(uint32_t k1, uint32_t t1, uint32_t k2, uint32_t t2) {
+    return k1 < k2 || (k1 == k2 && t1 < t2);
+}
+
+static void collectEntry(const char* path, uint32_t size, void* context) {
+    PageContext* c = (PageContext*)context;
+    const CatalogQuery& q = *c->query;
+    uint32_t ordinal = c->ordinal++;
+
+    uint16_t year;
+    uint8_t month;
+    parseLogFileMonth(path, year, month);
+    if (q.year && year != q.year) return;
+    if (q.month && month != q.month) return;
+    c->matches++;
+
+    // Descending orders invert the key so selection is always ascending
+    uint32_t tie = crc32Update(0, (const uint8_t*)path, strlen(path));
+    uint32_t key;
+    switch (q.sort) {
+        case CATALOG_SORT_TIME_ASC:  key = year * 12UL + month; break;
+        case CATALOG_SORT_TIME_DESC: key = ~(year * 12UL + month); tie = ~tie; break;
+        case CATALOG_SORT_SIZE_DESC: key = ~size; break;
+        default:                     key = ordinal; tie = 0; break;
+    }
+
+    if (q.hasToken && !keyBefore(q.tokenKey, q.tokenTie, key, tie)) return;
+    c->remaining++;
+
+    // Insertion into the fixed page array, dropping the largest key
+    uint8_t n = c->count;
+    if (n == q.pageSize) {
+        const CatalogEntry& last = c->entries[n - 1];
+        if (!keyBefore(key, tie, last.key, last.tie)) return;
+        n--;
+    }
+    uint8_t i = n;
+    while (i > 0 && keyBefore(key, tie, c->entries[i - 1].key, c->entries[i - 1].tie)) {
+        c->entries[i] = c->entries[i - 1];
+        i--;
+    }
+
+    CatalogEntry& e = c->entries[i];
+    strncpy(e.path, path, CATALOG_PATH_LEN - 1);
+    e.path[CATALOG_PATH_LEN - 1] = '\0';
+    e.size = size;
+    e.year = year;
+    e.month = month;
+    e.key = key;
+    e.tie = tie;
+    c->count = n + 1;
+}
+
+uint8_t selectCatalogPage(const CatalogQuery& query, CatalogEntry* entries,
+                          uint32_t& totalMatches, bool& more) {
+    PageContext c = { &query, entries, 0, 0, 0, 0 };
+    if (query.pageSize > 0) {
+        forEachCatalogFile(collectEntry, &c);
+    }
+    totalMatches = c.matches;
+    more = c.remaining > c.count;
+    return c.count;
+}
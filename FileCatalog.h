@@ -0,0 +1,71 @@
+/**
+ * FileCatalog.h
+ * Paged, heap-free listing of the files on the SD card
+ *
+ * A page is chosen by scanning the card once and keeping the best
+ * pageSize entries after the continuation token in a fixed array, so
+ * listing thousands of files costs O(files x pageSize) time and no heap.
+ * Each entry gets a 64-bit sort key (key, tie); the token is simply the
+ * key of the last entry sent, which makes paging stable without keeping
+ * any state on the device between requests.
+ */
+
+#ifndef FILE_CATALOG_H
+#define FILE_CATALOG_H
+
+#include "Config.h"
+#include "DataStructures.h"
+
+#define CATALOG_PATH_LEN 48
+#define CATALOG_MAX_PAGE 16
+#define CATALOG_SCAN_BYTES 1024       // Longest header line searched for the first record
+
+enum CatalogSort {
+    CATALOG_SORT_DIRECTORY = 0,       // Card order
+    CATALOG_SORT_TIME_ASC = 1,        // Oldest month first (year/month from the name)
+    CATALOG_SORT_TIME_DESC = 2,
+    CATALOG_SORT_SIZE_DESC = 3
+};
+
+struct CatalogQuery {
+    uint8_t sort;
+    uint8_t pageSize;
+    uint16_t year;                    // 0 = any
+    uint8_t month;                    // 0 = any
+    bool hasToken;
+    uint32_t tokenKey;
+    uint32_t tokenTie;
+};
+
+struct CatalogEntry {
+    char path[CATALOG_PATH_LEN];
+    uint32_t size;
+    uint16_t year;                    // 0 when the name carries no date
+    uint8_t month;
+    uint32_t key;
+    uint32_t tie;
+};
+
+// Summary of a CSV log read from its first and last lines only
+struct LogFileStats {
+    uint32_t firstTime;
+    uint32_t lastTime;
+    uint32_t records;                 // Estimated from the first record's length
+};
+
+typedef void (*CatalogVisitFn)(const char* path, uint32_t size, void* context);
+
+// Visits root files and /HIVE_DATA/<year>/*.CSV
+void forEachCatalogFile(CatalogVisitFn visit, void* context);
+
+// H2507.CSV and /HIVE_DATA/2025/2025-07.CSV both give 2025/7
+bool parseLogFileMonth(const char* path, uint16_t& year, uint8_t& month);
+
+bool readLogFileStats(const char* path, LogFileStats& stats);
+
+// Fills up to query.pageSize entries; returns how many. totalMatches
+// counts every file passing the filter, more is set when entries remain.
+uint8_t selectCatalogPage(const CatalogQuery& query, CatalogEntry* entries,
+                          uint32_t& totalMatches, bool& more);
+
+#endif // FILE_CATALOG_H
@@ -0,0 +1,324 @@
+/**
+ * PhaseProfiler.cpp
+ * Wake-cycle phase timing implementation
+ */
+
+#include "PhaseProfiler.h"
+#include "Utils.h"
+
+#ifdef NRF52_SERIES
+  #include <nrf.h>
+#endif
+
+#ifdef HAS_INTERNAL_FS
+  #include <Adafruit_LittleFS.h>
+  #include <InternalFileSystem.h>
+  using ProfileFile = Adafruit_LittleFS_Namespace::File;
+#endif
+
+PhaseProfiler phaseProfiler;
+
+// Board current per phase (mA). Rough bench figures; setPhaseCurrent()
+// replaces them once a phase has been measured with a meter.
+static const float defaultPhaseCurrentMa[PHASE_COUNT] = {
+    4.0f,    // Stabilize: CPU mostly waiting, BME280 powered
+    6.0f,    // Sensors: I2C transfers, forced conversion
+    9.0f,    // Audio capture: PDM microphone and DMA
+    7.0f,    // FFT: CPU and FPU busy
+    5.0f,    // Buffer
+    25.0f,   // SD flush: card write current dominates
+    5.0f,    // Other: mostly Serial output
+    0.15f    // Sleep: System ON idle, see PowerManager POWER_SLEEP_MA
+};
+
+static uint32_t defaultTicks() {
+#ifdef NRF52_SERIES
+    return DWT->CYCCNT;
+#else
+    return micros();
+#endif
+}
+
+PhaseProfiler::PhaseProfiler() {
+    memset(&image, 0, sizeof(image));
+    image.version = PHASE_PROFILE_VERSION;
+    memcpy(currentMa, defaultPhaseCurrentMa, sizeof(currentMa));
+    clock = defaultTicks;
+    ticksPerUs = 1;
+    inCycle = false;
+    openPhase = -1;
+    phaseStartTicks = 0;
+    phaseStartMs = 0;
+    cycleStartTicks = 0;
+    cycleStartMs = 0;
+    memset(cycleUs, 0, sizeof(cycleUs));
+    unsavedCycles = 0;
+}
+
+void PhaseProfiler::begin() {
+#ifdef NRF52_SERIES
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+    if (clock == defaultTicks) ticksPerUs = SystemCoreClock / 1000000;
+#endif
+
+    if (load()) {
+        Serial.print(F("Phase profile: "));
+        Serial.print(image.cycles);
+        Serial.println(F(" wake cycles restored"));
+    } else {
+        Serial.println(F("Phase profile: new"));
+    }
+}
+
+void PhaseProfiler::setClock(PhaseClockFn fn, uint32_t ticksPerMicrosecond) {
+    clock = fn ? fn : defaultTicks;
+    ticksPerUs = ticksPerMicrosecond ? ticksPerMicrosecond : 1;
+    inCycle = false;
+    openPhase = -1;
+}
+
+// =============================================================================
+// TIMING
+// =============================================================================
+
+uint32_t PhaseProfiler::elapsedUs(uint32_t startTicks, unsigned long startMs) const {
+    // The cycle counter wraps after ~67 s at 64 MHz; longer spans are
+    // timed with millis() instead
+    unsigned long ms = millis() - startMs;
+    if (ms >= 60000UL) return ms * 1000UL;
+    return (clock() - startTicks) / ticksPerUs;
+}
+
+void PhaseProfiler::beginCycle(uint32_t rtcTime) {
+    if (inCycle) endCycle();
+
+    inCycle = true;
+    openPhase = -1;
+    memset(cycleUs, 0, sizeof(cycleUs));
+    cycleStartTicks = clock();
+    cycleStartMs = millis();
+
+    if (rtcTime) {
+        if (!image.firstTime) image.firstTime = rtcTime;
+        image.lastTime = rtcTime;
+    }
+}
+
+void PhaseProfiler::begin(WakePhase phase) {
+    if (!inCycle || phase >= PHASE_COUNT) return;
+    end();
+    openPhase = phase;
+    phaseStartTicks = clock();
+    phaseStartMs = millis();
+}
+
+void PhaseProfiler::end() {
+    if (!inCycle || openPhase < 0) return;
+    cycleUs[openPhase] += elapsedUs(phaseStartTicks, phaseStartMs);
+    openPhase = -1;
+}
+
+void PhaseProfiler::endCycle() {
+    if (!inCycle) return;
+    end();
+
+    // Whatever the named phases did not cover
+    uint32_t totalUs = elapsedUs(cycleStartTicks, cycleStartMs);
+    uint32_t namedUs = 0;
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        if (i != PHASE_OTHER) namedUs += cycleUs[i];
+    }
+    cycleUs[PHASE_OTHER] = totalUs > namedUs ? totalUs - namedUs : 0;
+
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        if (cycleUs[i]) addSample(i, cycleUs[i]);
+    }
+    image.cycles++;
+    inCycle = false;
+
+    if (++unsavedCycles >= PHASE_SAVE_CYCLES) save();
+}
+
+void PhaseProfiler::record(WakePhase phase, uint32_t us) {
+    if (phase >= PHASE_COUNT) return;
+    addSample(phase, us);
+}
+
+void PhaseProfiler::addSample(uint8_t phase, uint32_t us) {
+    PhaseStats& s = image.phases[phase];
+    s.totalUs += us;
+    s.count++;
+    if (us > s.maxUs) s.maxUs = us;
+
+    // Bucket b >= 1 holds [2^(b-1), 2^b) ms
+    uint32_t ms = us / 1000;
+    uint8_t bucket = 0;
+    while (ms && bucket < PHASE_HIST_BUCKETS - 1) {
+        ms >>= 1;
+        bucket++;
+    }
+    if (s.histogram[bucket] < 0xFFFF) s.histogram[bucket]++;
+}
+
+// =============================================================================
+// ENERGY MODEL
+// =============================================================================
+
+void PhaseProfiler::setPhaseCurrent(WakePhase phase, float ma) {
+    if (phase < PHASE_COUNT && ma >= 0.0f) currentMa[phase] = ma;
+}
+
+float PhaseProfiler::getPhaseCurrent(WakePhase phase) const {
+    return phase < PHASE_COUNT ? currentMa[phase] : 0.0f;
+}
+
+uint32_t PhaseProfiler::getPercentileMs(uint8_t phase, uint8_t percent) const {
+    const PhaseStats& s = getStats(phase);
+    if (s.count == 0) return 0;
+
+    uint32_t target = ((uint32_t)s.count * percent + 99) / 100;
+    uint32_t seen = 0;
+    for (uint8_t b = 0; b < PHASE_HIST_BUCKETS; b++) {
+        seen += s.histogram[b];
+        if (seen >= target) {
+            // The last bucket is open-ended
+            return b < PHASE_HIST_BUCKETS - 1 ? 1UL << b : s.maxUs / 1000;
+        }
+    }
+    return s.maxUs / 1000;
+}
+
+bool PhaseProfiler::hasEnergyData() const {
+    return image.cycles > 0 && image.phases[PHASE_SLEEP].count > 0;
+}
+
+float PhaseProfiler::getAverageCurrentMa() const {
+    float chargeMaUs = 0.0f;
+    float timeUs = 0.0f;
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        chargeMaUs += (float)image.phases[i].totalUs * currentMa[i];
+        timeUs += (float)image.phases[i].totalUs;
+    }
+    return timeUs > 0.0f ? chargeMaUs / timeUs : 0.0f;
+}
+
+float PhaseProfiler::getMahPerDay() const {
+    return getAverageCurrentMa() * 24.0f;
+}
+
+float PhaseProfiler::getPhaseMahPerDay(uint8_t phase) const {
+    if (phase >= PHASE_COUNT) return 0.0f;
+    float timeUs = 0.0f;
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        timeUs += (float)image.phases[i].totalUs;
+    }
+    if (timeUs <= 0.0f) return 0.0f;
+    return (float)image.phases[phase].totalUs * currentMa[phase] / timeUs * 24.0f;
+}
+
+float PhaseProfiler::getWakeMah() const {
+    if (image.cycles == 0) return 0.0f;
+    float chargeMaUs = 0.0f;
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        if (i != PHASE_SLEEP) chargeMaUs += (float)image.phases[i].totalUs * currentMa[i];
+    }
+    return chargeMaUs / image.cycles / 3.6e9f;
+}
+
+const char* PhaseProfiler::getPhaseName(uint8_t phase) {
+    static const char* const names[PHASE_COUNT] = {
+        "stabilize", "sensors", "audio", "fft", "buffer", "sd flush", "other", "sleep"
+    };
+    return phase < PHASE_COUNT ? names[phase] : "?";
+}
+
+// =============================================================================
+// PERSISTENCE
+// =============================================================================
+
+uint32_t PhaseProfiler::imageCheck(const PhaseProfileImage& img) {
+    return crc32Update(0, (const uint8_t*)&img, offsetof(PhaseProfileImage, check));
+}
+
+bool PhaseProfiler::load() {
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+    ProfileFile file(InternalFS);
+    if (!file.open(PHASE_PROFILE_FILE, Adafruit_LittleFS_Namespace::FILE_O_READ)) return false;
+
+    PhaseProfileImage stored;
+    bool ok = file.read((uint8_t*)&stored, sizeof(stored)) == sizeof(stored);
+    file.close();
+
+    // A different layout or a torn write starts a fresh profile
+    if (!ok || stored.version != PHASE_PROFILE_VERSION || stored.check != imageCheck(stored)) {
+        return false;
+    }
+    image = stored;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void PhaseProfiler::save() {
+    unsavedCycles = 0;
+    image.version = PHASE_PROFILE_VERSION;
+    image.check = imageCheck(image);
+
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+    InternalFS.remove(PHASE_PROFILE_FILE);
+    ProfileFile file(InternalFS);
+    if (!file.open(PHASE_PROFILE_FILE, Adafruit_LittleFS_Namespace::FILE_O_WRITE)) {
+        Serial.println(F("Phase profile: cannot save"));
+        return;
+    }
+    file.write((const uint8_t*)&image, sizeof(image));
+    file.close();
+#endif
+}
+
+void PhaseProfiler::reset() {
+    memset(&image, 0, sizeof(image));
+    image.version = PHASE_PROFILE_VERSION;
+    inCycle = false;
+    openPhase = -1;
+    save();
+    Serial.println(F("Phase profile reset"));
+}
+
+// =============================================================================
+// DIAGNOSTICS
+// =============================================================================
+
+void PhaseProfiler::printStats() const {
+    Serial.print(F("Wake phases ("));
+    Serial.print(image.cycles);
+    Serial.println(F(" cycles): avg / p90 / max ms, mAh/day"));
+
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        const PhaseStats& s = image.phases[i];
+        if (s.count == 0) continue;
+        Serial.print(F("  "));
+        Serial.print(getPhaseName(i));
+        Serial.print(F(": "));
+        Serial.print((float)s.totalUs / s.count / 1000.0f, 1);
+        Serial.print(F(" / "));
+        Serial.print(getPercentileMs(i, 90));
+        Serial.print(F(" / "));
+        Serial.print(s.maxUs / 1000.0f, 1);
+        Serial.print(F(", "));
+        Serial.println(getPhaseMahPerDay(i), 2);
+    }
+
+    if (hasEnergyData()) {
+        Serial.print(F("  Measured: "));
+        Serial.print(getAverageCurrentMa(), 3);
+        Serial.print(F(" mA avg, "));
+        Serial.print(getMahPerDay(), 1);
+        Serial.println(F(" mAh/day"));
+    }
+}
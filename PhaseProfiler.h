@@ -0,0 +1,136 @@
+/**
+ * PhaseProfiler.h
+ * Wake-cycle phase timing and measured energy use
+ *
+ * Each scheduled wake is a cycle split into phases (sensor warm-up,
+ * reading, audio capture, FFT, buffering, SD flush). Phases are timed
+ * with the DWT cycle counter, so even sub-millisecond steps show up; the
+ * rest of the wake (Serial output, state changes) lands in PHASE_OTHER.
+ * The System ON sleep between cycles is recorded as PHASE_SLEEP.
+ *
+ * Per phase the profiler keeps a count, total and maximum and a log2
+ * histogram of the per-cycle duration. Multiplied with a per-phase
+ * current it gives the average current and mAh per day that were
+ * actually measured, rather than assumed. The statistics live in
+ * internal flash and are saved every PHASE_SAVE_CYCLES cycles.
+ *
+ * The clock can be replaced (setClock), e.g. with a fake one.
+ */
+
+#ifndef PHASE_PROFILER_H
+#define PHASE_PROFILER_H
+
+#include "Config.h"
+
+#define PHASE_PROFILE_FILE "/phases.dat"
+#define PHASE_PROFILE_VERSION 1
+#define PHASE_HIST_BUCKETS 16            // <1 ms, 1 ms, 2-3 ms, 4-7 ms ... >=16 s
+#define PHASE_SAVE_CYCLES 12             // Flash write every N wake cycles
+
+enum WakePhase {
+    PHASE_STABILIZE = 0,         // Sensors powered up, waiting for the reading pass
+    PHASE_SENSORS = 1,           // Sensor start and collection, alerts
+    PHASE_AUDIO_CAPTURE = 2,     // Sample collection, BME280 converting meanwhile
+    PHASE_FFT = 3,               // performFullAnalysis()
+    PHASE_BUFFER = 4,            // Field buffer insert
+    PHASE_SD_FLUSH = 5,          // Field buffer written to SD
+    PHASE_OTHER = 6,             // Rest of the wake cycle
+    PHASE_SLEEP = 7,             // System ON sleep between cycles
+    PHASE_COUNT = 8
+};
+
+typedef uint32_t (*PhaseClockFn)();
+
+struct PhaseStats {
+    uint64_t totalUs;
+    uint32_t count;              // Cycles in which the phase ran
+    uint32_t maxUs;
+    uint16_t histogram[PHASE_HIST_BUCKETS];
+};
+
+// Persisted as-is to PHASE_PROFILE_FILE
+struct PhaseProfileImage {
+    uint8_t version;
+    uint8_t reserved[3];
+    uint32_t cycles;
+    uint32_t firstTime;          // RTC unix time of the first profiled cycle
+    uint32_t lastTime;           // RTC unix time of the latest one
+    PhaseStats phases[PHASE_COUNT];
+    uint32_t check;
+};
+
+class PhaseProfiler {
+private:
+    PhaseProfileImage image;
+    float currentMa[PHASE_COUNT];
+
+    PhaseClockFn clock;
+    uint32_t ticksPerUs;
+
+    // Open cycle
+    bool inCycle;
+    int8_t openPhase;
+    uint32_t phaseStartTicks;
+    unsigned long phaseStartMs;
+    uint32_t cycleStartTicks;
+    unsigned long cycleStartMs;
+    uint32_t cycleUs[PHASE_COUNT];
+    uint8_t unsavedCycles;
+
+    uint32_t elapsedUs(uint32_t startTicks, unsigned long startMs) const;
+    void addSample(uint8_t phase, uint32_t us);
+    bool load();
+    static uint32_t imageCheck(const PhaseProfileImage& img);
+
+public:
+    PhaseProfiler();
+
+    // Enables the cycle counter and restores the saved statistics
+    void begin();
+
+    // Ticks source and rate; null restores the DWT counter
+    void setClock(PhaseClockFn fn, uint32_t ticksPerMicrosecond);
+
+    // One cycle per scheduled wake; rtcTime may be 0 if the RTC is down
+    void beginCycle(uint32_t rtcTime);
+    void endCycle();
+    bool isInCycle() const { return inCycle; }
+
+    // Starting a phase ends the open one; time adds up per cycle
+    void begin(WakePhase phase);
+    void end();
+
+    // Outside a cycle, e.g. the measured sleep
+    void record(WakePhase phase, uint32_t us);
+
+    // Energy model, mA per phase
+    void setPhaseCurrent(WakePhase phase, float ma);
+    float getPhaseCurrent(WakePhase phase) const;
+
+    const PhaseStats& getStats(uint8_t phase) const { return image.phases[phase < PHASE_COUNT ? phase : 0]; }
+    uint32_t getCycles() const { return image.cycles; }
+    uint32_t getFirstTime() const { return image.firstTime; }
+    uint32_t getLastTime() const { return image.lastTime; }
+
+    // Upper bound in ms of the bucket holding the given percentile
+    uint32_t getPercentileMs(uint8_t phase, uint8_t percent) const;
+
+    // False until at least one wake and one sleep have been measured
+    bool hasEnergyData() const;
+    float getAverageCurrentMa() const;
+    float getMahPerDay() const;
+    float getPhaseMahPerDay(uint8_t phase) const;
+
+    // Average charge of one wake cycle (all phases but sleep), 0 before the first
+    float getWakeMah() const;
+
+    static const char* getPhaseName(uint8_t phase);
+
+    void save();
+    void reset();
+    void printStats() const;
+};
+
+extern PhaseProfiler phaseProfiler;
+
+#endif // PHASE_PROFILER_H
@@ -0,0 +1,249 @@
+/**
+ * PowerDomains.cpp
+ * Peripheral power domain implementation
+ */
+
+#include "PowerDomains.h"
+#include <Wire.h>
+#include <SPI.h>
+#include <SD.h>
+
+#ifdef NRF52_SERIES
+  #include <nrf.h>
+#endif
+
+PowerDomainManager powerDomains;
+
+struct PowerDomainInfo {
+    const char* name;
+    int8_t parent;               // -1 for none
+    uint16_t settleMs;           // After switching on, before use
+    float currentMa;             // While on; same figures as PowerManager
+};
+
+static const PowerDomainInfo domainInfo[DOMAIN_COUNT] = {
+    { "i2c",     -1,         0,  0.1f  },
+    { "bme280",  DOMAIN_I2C, 0,  2.0f  },   // POWER_SENSORS_MA
+    { "mic/adc", -1,         0,  5.0f  },   // POWER_AUDIO_MA
+    { "sd/spi",  -1,         0,  1.0f  },   // Card idle
+    { "display", DOMAIN_I2C, 50, 8.0f  },   // POWER_DISPLAY_MA
+    { "radio",   -1,         0,  12.0f }    // POWER_BLUETOOTH_MA
+};
+
+#define SD_POWER_SETTLE_MS 5
+
+PowerDomainManager::PowerDomainManager() {
+    memset(refs, 0, sizeof(refs));
+    memset(clients, 0, sizeof(clients));
+    // setup() starts every peripheral; begin() switches off the unheld ones
+    for (uint8_t i = 0; i < DOMAIN_COUNT; i++) on[i] = true;
+    managed = false;
+    accountStartMs = 0;
+    memset(onSinceMs, 0, sizeof(onSinceMs));
+    memset(onMs, 0, sizeof(onMs));
+    memset(switchOns, 0, sizeof(switchOns));
+}
+
+void PowerDomainManager::begin() {
+#if SD_POWER_PIN >= 0
+    pinMode(SD_POWER_PIN, OUTPUT);
+    digitalWrite(SD_POWER_PIN, HIGH);
+#endif
+
+    managed = true;
+    accountStartMs = millis();
+    for (uint8_t i = 0; i < DOMAIN_COUNT; i++) {
+        onSinceMs[i] = accountStartMs;
+        onMs[i] = 0;
+        switchOns[i] = 0;
+    }
+
+    // Dependants sit after their parents, so this goes leaf first
+    for (int8_t i = DOMAIN_COUNT - 1; i >= 0; i--) {
+        if (on[i] && refs[i] == 0) setPower(i, false);
+    }
+
+    Serial.print(F("Power domains on:"));
+    for (uint8_t i = 0; i < DOMAIN_COUNT; i++) {
+        if (on[i]) {
+            Serial.print(F(" "));
+            Serial.print(domainInfo[i].name);
+        }
+    }
+    Serial.println();
+}
+
+// =============================================================================
+// REFERENCE COUNTING
+// =============================================================================
+
+void PowerDomainManager::acquire(PowerDomain domain, PowerClient client) {
+    if (domain >= DOMAIN_COUNT || (clients[domain] & client)) return;
+    clients[domain] |= client;
+    addRef(domain);
+}
+
+void PowerDomainManager::release(PowerDomain domain, PowerClient client) {
+    if (domain >= DOMAIN_COUNT || !(clients[domain] & client)) return;
+    clients[domain] &= ~client;
+    dropRef(domain);
+}
+
+void PowerDomainManager::addRef(uint8_t domain) {
+    if (refs[domain]++ > 0) return;
+
+    // Parent first, so the bus is up before the device on it
+    int8_t parent = domainInfo[domain].parent;
+    if (parent >= 0) addRef(parent);
+    if (managed && !on[domain]) setPower(domain, true);
+}
+
+void PowerDomainManager::dropRef(uint8_t domain) {
+    if (refs[domain] == 0 || --refs[domain] > 0) return;
+
+    if (managed && on[domain]) setPower(domain, false);
+    int8_t parent = domainInfo[domain].parent;
+    if (parent >= 0) dropRef(parent);
+}
+
+// =============================================================================
+// SWITCHING
+// =============================================================================
+
+void PowerDomainManager::setPower(uint8_t domain, bool powered) {
+    unsigned long now = millis();
+    if (powered) {
+        gate(domain, true);
+        if (domainInfo[domain].settleMs) delay(domainInfo[domain].settleMs);
+        on[domain] = true;
+        onSinceMs[domain] = millis();
+        switchOns[domain]++;
+    } else {
+        onMs[domain] += now - onSinceMs[domain];
+        on[domain] = false;
+        gate(domain, false);
+    }
+}
+
+void PowerDomainManager::gate(uint8_t domain, bool powered) {
+    switch (domain) {
+        case DOMAIN_I2C:
+            if (powered) {
+                Wire.begin();
+                Wire.setClock(100000);  // As in setup(), for the PCF8523
+            } else {
+                Wire.end();
+            }
+            break;
+
+        case DOMAIN_SD_SPI:
+            if (powered) {
+#if SD_POWER_PIN >= 0
+                digitalWrite(SD_POWER_PIN, HIGH);
+                delay(SD_POWER_SETTLE_MS);
+                SPI.begin();
+                SD.begin(SD_CS_PIN);   // The card lost its state with the power
+#else
+                SPI.begin();
+#endif
+            } else {
+                SPI.end();
+#if SD_POWER_PIN >= 0
+                digitalWrite(SD_POWER_PIN, LOW);
+#endif
+            }
+            break;
+
+        case DOMAIN_MIC_ADC:
+#ifdef NRF52_SERIES
+            // analogRead() enables the SAADC for each conversion; this
+            // makes sure nothing left it on
+            if (!powered) NRF_SAADC->ENABLE = 0;
+#endif
+            break;
+
+        case DOMAIN_DISPLAY:
+            digitalWrite(DISPLAY_POWER_PIN, powered ? DISPLAY_POWER_ON : DISPLAY_POWER_OFF);
+            break;
+
+        default:
+            // BME280 sleeps between forced conversions; the SoftDevice
+            // switches the radio
+            break;
+    }
+}
+
+// =============================================================================
+// STATE AND ACCOUNTING
+// =============================================================================
+
+bool PowerDomainManager::isOn(PowerDomain domain) const {
+    return domain < DOMAIN_COUNT && on[domain];
+}
+
+uint8_t PowerDomainManager::getOnMask() const {
+    uint8_t mask = 0;
+    for (uint8_t i = 0; i < DOMAIN_COUNT; i++) {
+        if (on[i]) mask |= DOMAIN_BIT(i);
+    }
+    return mask;
+}
+
+uint8_t PowerDomainManager::getClients(PowerDomain domain) const {
+    return domain < DOMAIN_COUNT ? clients[domain] : 0;
+}
+
+uint32_t PowerDomainManager::getOnMs(PowerDomain domain) const {
+    if (domain >= DOMAIN_COUNT) return 0;
+    uint64_t ms = onMs[domain];
+    if (managed && on[domain]) ms += millis() - onSinceMs[domain];
+    return (uint32_t)ms;
+}
+
+uint32_t PowerDomainManager::getSwitchOns(PowerDomain domain) const {
+    return domain < DOMAIN_COUNT ? switchOns[domain] : 0;
+}
+
+float PowerDomainManager::getCurrentMa(PowerDomain domain) const {
+    return domain < DOMAIN_COUNT ? domainInfo[domain].currentMa : 0.0f;
+}
+
+float PowerDomainManager::getAverageCurrentMa(uint8_t domainMask) const {
+    if (!managed) return 0.0f;
+    unsigned long elapsed = millis() - accountStartMs;
+    if (elapsed == 0) return 0.0f;
+
+    float chargeMaMs = 0.0f;
+    for (uint8_t i = 0; i < DOMAIN_COUNT; i++) {
+        if (domainMask & DOMAIN_BIT(i)) {
+            chargeMaMs += (float)getOnMs((PowerDomain)i) * domainInfo[i].currentMa;
+        }
+    }
+    return chargeMaMs / elapsed;
+}
+
+const char* PowerDomainManager::getName(uint8_t domain) {
+    return domain < DOMAIN_COUNT ? domainInfo[domain].name : "?";
+}
+
+void PowerDomainManager::printStatus() const {
+    unsigned long elapsed = managed ? millis() - accountStartMs : 0;
+
+    Serial.println(F("Power domains:"));
+    for (uint8_t i = 0; i < DOMAIN_COUNT; i++) {
+        Serial.print(F("  "));
+        Serial.print(domainInfo[i].name);
+        Serial.print(on[i] ? F(": ON  refs ") : F(": off refs "));
+        Serial.print(refs[i]);
+        Serial.print(F(" clients 0x"));
+        Serial.print(clients[i], HEX);
+        Serial.print(F(", on "));
+        Serial.print(elapsed ? getOnMs((PowerDomain)i) * 100.0f / elapsed : 0.0f, 1);
+        Serial.print(F("%, "));
+        Serial.print(switchOns[i]);
+        Serial.println(F(" switch-ons"));
+    }
+    Serial.print(F("  Peripheral average: "));
+    Serial.print(getAverageCurrentMa(), 2);
+    Serial.println(F(" mA"));
+}
@@ -0,0 +1,110 @@
+/**
+ * PowerDomains.h
+ * Reference-counted peripheral power domains
+ *
+ * Each peripheral group is a domain that is powered while anyone holds
+ * it. Holders are PowerClient bits, so a client acquiring twice or
+ * releasing something it never took changes nothing. A domain that
+ * depends on another (the BME280 and the display on the I2C bus) holds
+ * its parent while it is on, so the bus is up before the sensor and goes
+ * down after it.
+ *
+ *   I2C       TWIM (Wire.end / Wire.begin); RTC, BME280, display
+ *   BME280    sleeps by itself between forced conversions
+ *   MIC/ADC   SAADC disabled; the MAX9814 has no shutdown pin
+ *   SD/SPI    SPIM (SPI.end / SPI.begin), card power if SD_POWER_PIN
+ *   DISPLAY   DISPLAY_POWER_PIN, 50 ms to come up
+ *   RADIO     switched by the SoftDevice, tracked here for the accounting
+ *
+ * Until begin() everything is left as setup() made it and only the
+ * counts are kept; begin() switches off whatever nobody holds. From then
+ * on time in the on state is accounted per domain and, multiplied by a
+ * per-domain current, gives the average current the peripherals drew.
+ *
+ * All calls come from code holding the application lock (loop or the
+ * app tasks), which serialises the counts. The lock does not keep a bus
+ * powered: a domain that is off has its peripheral disabled, so code
+ * touching the RTC, sensor or card must run while some client holds the
+ * domain. For I2C that is SYSTEM while the loop is awake, RADIO while
+ * Bluetooth is on (the BLE task serves commands during the loop's sleep),
+ * GATEWAY while a beacon is filed and FLUSH while the storage task or a
+ * field buffer flush writes.
+ */
+
+#ifndef POWER_DOMAINS_H
+#define POWER_DOMAINS_H
+
+#include "Config.h"
+
+enum PowerDomain {
+    DOMAIN_I2C = 0,
+    DOMAIN_BME280 = 1,
+    DOMAIN_MIC_ADC = 2,
+    DOMAIN_SD_SPI = 3,
+    DOMAIN_DISPLAY = 4,
+    DOMAIN_RADIO = 5,
+    DOMAIN_COUNT = 6
+};
+
+#define DOMAIN_BIT(d) (1 << (d))
+#define DOMAIN_MASK_ALL ((1 << DOMAIN_COUNT) - 1)
+
+enum PowerClient {
+    PCLIENT_SYSTEM = 0x01,       // CPU awake: the loop reads the RTC throughout
+    PCLIENT_SENSORS = 0x02,      // powerUpSensors() / powerDownSensors()
+    PCLIENT_AUDIO = 0x04,        // powerUpAudio() / powerDownAudio()
+    PCLIENT_DISPLAY = 0x08,      // turnOnDisplay() / turnOffDisplay()
+    PCLIENT_RADIO = 0x10,        // Bluetooth on, including file transfers
+    PCLIENT_LOGGER = 0x20,       // Testing mode logs to SD continuously
+    PCLIENT_FLUSH = 0x40,        // Field buffer flush, storage task writes
+    PCLIENT_GATEWAY = 0x80       // Gateway filing neighbour beacons
+};
+
+class PowerDomainManager {
+private:
+    uint8_t refs[DOMAIN_COUNT];      // Clients plus powered dependants
+    uint8_t clients[DOMAIN_COUNT];   // PowerClient bits
+    bool on[DOMAIN_COUNT];
+    bool managed;
+
+    // Accounting since begin()
+    unsigned long accountStartMs;
+    unsigned long onSinceMs[DOMAIN_COUNT];
+    uint64_t onMs[DOMAIN_COUNT];
+    uint32_t switchOns[DOMAIN_COUNT];
+
+    void addRef(uint8_t domain);
+    void dropRef(uint8_t domain);
+    void setPower(uint8_t domain, bool powered);
+    static void gate(uint8_t domain, bool powered);
+
+public:
+    PowerDomainManager();
+
+    // Call at the end of setup(), once the holds for the current mode
+    // are taken; switches off every domain nobody holds
+    void begin();
+    bool isManaged() const { return managed; }
+
+    // Powers the domain (and its parent) and waits for it to settle
+    void acquire(PowerDomain domain, PowerClient client);
+    void release(PowerDomain domain, PowerClient client);
+
+    bool isOn(PowerDomain domain) const;
+    uint8_t getOnMask() const;
+    uint8_t getClients(PowerDomain domain) const;
+
+    uint32_t getOnMs(PowerDomain domain) const;
+    uint32_t getSwitchOns(PowerDomain domain) const;
+    float getCurrentMa(PowerDomain domain) const;
+
+    // Average over the time since begin() of the domains in the mask
+    float getAverageCurrentMa(uint8_t domainMask = DOMAIN_MASK_ALL) const;
+
+    static const char* getName(uint8_t domain);
+    void printStatus() const;
+};
+
+extern PowerDomainManager powerDomains;
+
+#endif // POWER_DOMAINS_H
@@ -5,7 +5,15 @@
 #include "PowerManager.h"
 #include "Utils.h"
 #include "Sensors.h"  // For getBatteryLevel
+#include "EventScheduler.h"
+#include "AppTasks.h"
+#include "PhaseProfiler.h"
+#include "AdaptiveInterval.h"
 #include "Bluetooth.h"
+#include "BatteryModel.h"
+#include "FastBoot.h"
+#include "FieldModeBuffer.h"
+#include "PowerDomains.h"
 
 #ifdef NRF52_SERIES
 #include <nrf.h>
@@ -24,6 +32,25 @@ static PowerManager* powerManagerInstance = nullptr;
 // Retained state in special RAM section that survives System OFF
 __attribute__((section(".noinit"))) static RetainedState retainedState;
 
+// Pins sensed for a wake from System OFF besides RTC_INT_PIN, so the
+// device can still be woken by hand
+static const uint8_t systemOffWakeButtons[] = { BTN_SELECT, BTN_BLUETOOTH };
+
+// Bluetooth up, and the buses with it: file transfers read SD, and the
+// BLE task serves commands that read or set the RTC while the loop
+// sleeps with its own I2C hold dropped
+static void holdRadio(bool hold) {
+    if (hold) {
+        powerDomains.acquire(DOMAIN_RADIO, PCLIENT_RADIO);
+        powerDomains.acquire(DOMAIN_SD_SPI, PCLIENT_RADIO);
+        powerDomains.acquire(DOMAIN_I2C, PCLIENT_RADIO);
+    } else {
+        powerDomains.release(DOMAIN_I2C, PCLIENT_RADIO);
+        powerDomains.release(DOMAIN_SD_SPI, PCLIENT_RADIO);
+        powerDomains.release(DOMAIN_RADIO, PCLIENT_RADIO);
+    }
+}
+
 // =============================================================================
 // POWER CONSUMPTION CONSTANTS (mA)
 // =============================================================================
@@ -33,7 +60,7 @@ const float PowerManager::POWER_DISPLAY_MA = 8.0f;
 const float PowerManager::POWER_SENSORS_MA = 2.0f;
 const float PowerManager::POWER_AUDIO_MA = 5.0f;
 const float PowerManager::POWER_BLUETOOTH_MA = 12.0f;
-const float PowerManager::POWER_SLEEP_MA = 1.0f;      // Polling sleep
+const float PowerManager::POWER_SLEEP_MA = 0.15f;     // System ON idle, peripherals off
 const float PowerManager::POWER_DEEP_SLEEP_MA = 0.001f; // True deep sleep
 
 // =============================================================================
@@ -76,6 +103,10 @@ PowerManager::PowerManager() {
     status.deepSleepCycles = 0;
     status.wakeFromDeepSleep = false;
     
+    status.lastSleepMs = 0;
+    status.totalSleepMs = 0;
+    status.sleepAccountingStart = 0;
+    
     // Initialize settings
     settings.fieldModeEnabled = false;
     settings.displayTimeoutMin = 2;
@@ -111,10 +142,15 @@ void PowerManager::initialize(SystemStatus* sysStatus, SystemSettings* sysSettin
     
     // Initialize display power control hardware
     initializeDisplayPower();
+    
+    // Holds for the state setup() leaves things in; powerDomains.begin()
+    // switches off the rest at the end of setup(). The loop reads the RTC
+    // whenever it runs, so the bus is only let go while asleep
+    powerDomains.acquire(DOMAIN_I2C, PCLIENT_SYSTEM);
+    powerDomains.acquire(DOMAIN_DISPLAY, PCLIENT_DISPLAY);
 
-    // Initialize retained state (clear on normal boots)
-    // Note: This will be overridden by restoreRetainedState() if called later
-    memset(&retainedState, 0, sizeof(retainedState));
+    // Retained state is left alone here: restoreRetainedState() runs after
+    // this on a scheduled wake, and the normal boot clears it explicitly
 
     // Initialize Bluetooth button
     pinMode(BTN_BLUETOOTH, INPUT_PULLUP);
@@ -129,6 +165,12 @@ void PowerManager::initialize(SystemStatus* sysStatus, SystemSettings* sysSettin
         
         if (settings.fieldModeEnabled) {
             enableFieldMode();
+        } else {
+            // Testing mode keeps everything up
+            powerDomains.acquire(DOMAIN_BME280, PCLIENT_SENSORS);
+            powerDomains.acquire(DOMAIN_MIC_ADC, PCLIENT_AUDIO);
+            powerDomains.acquire(DOMAIN_SD_SPI, PCLIENT_LOGGER);
+            holdRadio(true);
         }
     }
     
@@ -219,8 +261,10 @@ bool PowerManager::restoreRetainedState() {
         // Keep display OFF since this is a scheduled wake
         turnOffDisplay();
         
-        // Power down non-essential components
+        // Power down non-essential components; the card is only taken
+        // while the field buffer flushes, as in enableFieldMode()
         powerDownNonEssential();
+        powerDomains.release(DOMAIN_SD_SPI, PCLIENT_LOGGER);
         
         Serial.println(F("Field mode restored from retained state"));
         return true;
@@ -238,8 +282,9 @@ uint16_t PowerManager::calculateRetainedChecksum(const RetainedState& state) {
     uint16_t checksum = 0;
     const uint8_t* data = (const uint8_t*)&state;
     
-    // Calculate checksum for all fields except the checksum field itself
-    for (size_t i = 0; i < sizeof(RetainedState) - sizeof(uint16_t); i++) {
+    // Calculate checksum for all fields before the checksum field; the
+    // struct is padded after it, so sizeof() would take the field in too
+    for (size_t i = 0; i < offsetof(RetainedState, checksum); i++) {
         checksum += data[i];
     }
     
@@ -268,6 +313,8 @@ bool PowerManager::initializeDeepSleep() {
         delay(100); // Let oscillator stabilize
     }
     
+    // The RTC can wake the chip from System OFF, so field sleeps may use it
+    status.deepSleepCapable = true;
     Serial.println(F("Deep sleep initialization complete"));
     return true;
 #else
@@ -279,7 +326,8 @@ bool PowerManager::initializeDeepSleep() {
 void PowerManager::initializeWakeDetection(WakeUpSource bootReason) {
     status.lastWakeSource = bootReason;
     
-    if (bootReason == WAKE_RTC) {
+    // At boot a button source can only come from a System OFF wake
+    if (bootReason == WAKE_RTC || bootReason == WAKE_BUTTON || bootReason == WAKE_BLUETOOTH_BUTTON) {
         status.wakeFromDeepSleep = true;
         status.deepSleepCycles++;
         Serial.println(F("PowerManager: Detected wake from deep sleep"));
@@ -294,13 +342,48 @@ void PowerManager::initializeWakeDetection(WakeUpSource bootReason) {
 // =============================================================================
 
 void PowerManager::setupRTCInterrupt() {
-    // This is now fallback only
+    // The interrupt itself is attached only for the duration of a sleep
     pinMode(RTC_INT_PIN, INPUT_PULLUP);
     wakeupFromRTC = false;
     wakeupFromButton = false;
     rtcInterruptWorking = false;
     
-    Serial.println(F("RTC interrupt setup (polling fallback mode)"));
+    Serial.println(F("RTC interrupt pin ready"));
+}
+
+// PCF8523 registers used for the scheduled wake
+#define PCF8523_ADDRESS 0x68
+#define PCF8523_REG_CONTROL_1 0x00
+#define PCF8523_REG_CONTROL_2 0x01
+#define PCF8523_REG_MINUTE_ALARM 0x0A     // Then hour, day and weekday alarm
+#define PCF8523_REG_TMR_CLKOUT 0x0F
+#define PCF8523_REG_TMR_A_FREQ 0x10
+#define PCF8523_REG_TMR_A 0x11
+#define PCF8523_AIE 0x02                  // Control_1: alarm interrupt
+#define PCF8523_CTAIE 0x02                // Control_2: timer A interrupt
+#define PCF8523_CTAF 0x40                 // Control_2: timer A flag
+#define PCF8523_AF 0x08                   // Control_2: alarm flag
+#define PCF8523_TAM 0x80                  // Pulsed rather than level interrupt
+#define PCF8523_COF_DISABLED 0x38         // INT1 shares its pin with CLKOUT
+#define PCF8523_TAC_MASK 0x06
+#define PCF8523_TAC_COUNTDOWN 0x02
+#define PCF8523_TMR_1HZ 0x02
+#define PCF8523_ALARM_DISABLE 0x80
+
+// Read-modify-write of one PCF8523 register; left alone if the read fails
+static bool updateRtcRegister(uint8_t reg, uint8_t clearBits, uint8_t setBits) {
+    Wire.beginTransmission(PCF8523_ADDRESS);
+    Wire.write(reg);
+    if (Wire.endTransmission() != 0) return false;
+    
+    Wire.requestFrom(PCF8523_ADDRESS, 1);
+    if (!Wire.available()) return false;
+    uint8_t value = (Wire.read() & ~clearBits) | setBits;
+    
+    Wire.beginTransmission(PCF8523_ADDRESS);
+    Wire.write(reg);
+    Wire.write(value);
+    return Wire.endTransmission() == 0;
 }
 
 void PowerManager::clearRTCAlarmFlag() {
@@ -318,8 +401,8 @@ void PowerManager::clearRTCAlarmFlag() {
         Serial.print(F("Control_2 before clear: 0x"));
         Serial.println(control2, HEX);
         
-        // Clear the alarm flag (AF) bit (bit 3)
-        control2 &= ~0x08;
+        // Clear the alarm (AF, bit 3) and timer A (CTAF, bit 6) flags
+        control2 &= ~(PCF8523_AF | PCF8523_CTAF);
         
         Wire.beginTransmission(0x68);
         Wire.write(0x01);
@@ -337,6 +420,7 @@ void PowerManager::rtcInterruptHandler() {
     if (powerManagerInstance) {
         powerManagerInstance->wakeupFromRTC = true;
     }
+    eventScheduler.post(EVT_RTC_ALARM);
 }
 
 void PowerManager::configureRTCWakeup(uint32_t wakeupTimeUnix) {
@@ -348,14 +432,12 @@ void PowerManager::configureRTCWakeup(uint32_t wakeupTimeUnix) {
     scheduledWakeTime = wakeupTimeUnix;
     DateTime alarmTime(wakeupTimeUnix);
     
-    // For now, store the wake time and use polling method
-    // TODO: Implement PCF8523 alarm register programming directly
+    // enterNRF52Sleep() programs the alarm for this time
     Serial.print(F("PowerManager: Wake scheduled for "));
     Serial.print(alarmTime.hour());
     Serial.print(F(":"));
     if (alarmTime.minute() < 10) Serial.print(F("0"));
     Serial.println(alarmTime.minute());
-    Serial.println(F("Note: Using polling method until PCF8523 alarm is implemented"));
 }
 
 bool PowerManager::handleRTCWakeup() {
@@ -375,67 +457,144 @@ bool PowerManager::handleRTCWakeup() {
 
 
 void PowerManager::enterNRF52Sleep() {
-    Serial.println(F("Entering polling-based sleep"));
+    Serial.println(F("Entering System ON sleep"));
     Serial.flush();
     
     prepareSleep();
     
-    // Calculate how many milliseconds until the next wake time
-    DateTime now = rtc.now();
-    DateTime nextWake(scheduledWakeTime);
-    long secondsUntilWake = nextWake.unixtime() - now.unixtime();
-
-    // If negative or too far in future, wake in 5 minutes as fallback
-    if (secondsUntilWake <= 0 || secondsUntilWake > 3600) {
-        secondsUntilWake = 300;  // 5 minutes fallback
+    // The PCF8523 is the primary wake; the timeout below only backstops a
+    // missed interrupt, so it runs a little past the RTC. Without the RTC
+    // the timeout is the wake and only the interval is known
+    bool useAlarm = systemStatus && systemStatus->rtcWorking;
+    uint32_t nowUnix = 0;
+    long secondsUntilWake;
+    if (useAlarm) {
+        nowUnix = rtc.now().unixtime();
+        secondsUntilWake = ensureScheduledWake(nowUnix) - nowUnix;
+    } else {
+        secondsUntilWake = getWakeIntervalS();
     }
-
-    unsigned long targetWakeTime = millis() + (secondsUntilWake * 1000UL);
-    
-    // DEBUG: Show timing info
-    Serial.print(F("scheduledWakeTime (unix): "));
-    Serial.println(scheduledWakeTime);
-    Serial.print(F("Current millis(): "));
-    Serial.println(millis());
-    Serial.print(F("Target wake millis: "));
-    Serial.println(targetWakeTime);
     
-    // Check if target time is in the past
-    if (targetWakeTime <= millis()) {
-        Serial.println(F("ERROR: Target wake time is in the past!"));
-        Serial.println(F("Waking immediately"));
-        status.lastWakeSource = WAKE_TIMER;
-        return;
+    wakeupFromRTC = false;
+    wakeupFromButton = false;
+    if (useAlarm) {
+        programRTCWake(WakeSchedule::planRtcWake(nowUnix, scheduledWakeTime));
+        attachInterrupt(digitalPinToInterrupt(RTC_INT_PIN), rtcInterruptHandler, FALLING);
     }
+    unsigned long backstopMs = secondsUntilWake * 1000UL + (useAlarm ? SLEEP_ALARM_MARGIN_MS : 0);
     
     Serial.print(F("Will wake in: "));
-    Serial.print((targetWakeTime - millis()) / 1000);
-    Serial.println(F(" seconds"));
-    
-    while (millis() < targetWakeTime) {
-        // Show countdown every 30 seconds
-        static unsigned long lastDebug = 0;
-        if (millis() - lastDebug > 30000) {
-            unsigned long remaining = (targetWakeTime - millis()) / 1000;
-            Serial.print(F("Sleeping... wake in "));
-            Serial.print(remaining);
-            Serial.println(F(" seconds"));
-            lastDebug = millis();
+    Serial.print(secondsUntilWake);
+    Serial.println(useAlarm ? F(" seconds (RTC)") : F(" seconds (timer)"));
+    Serial.flush();
+    
+    // Everything should be off for the wait; whatever is not is named
+    powerDomains.release(DOMAIN_I2C, PCLIENT_SYSTEM);
+    if (powerDomains.getOnMask()) {
+        Serial.println(F("Sleeping with power domains still on"));
+        powerDomains.printStatus();
+    }
+    
+    // Drop anything posted before we got here, then block until an
+    // interrupt: the loop task waits on the scheduler semaphore with the
+    // system lock released and the idle task halts the CPU in between
+    eventScheduler.take(EVT_BUTTON);
+    eventScheduler.take(EVT_RTC_ALARM);
+    eventScheduler.take(EVT_BLE);
+    
+    unsigned long sleepStart = millis();
+    WakeUpSource source = WAKE_TIMER;
+    
+    while (true) {
+        unsigned long elapsed = millis() - sleepStart;
+        if (elapsed >= backstopMs) break;
+        
+        appTasks.unlockedWait(backstopMs - elapsed);
+        
+        // BLE work waits for the wake; left pending it would keep the
+        // wait from blocking and the sleep would spin
+        eventScheduler.take(EVT_BLE);
+        
+        if (eventScheduler.take(EVT_RTC_ALARM) || wakeupFromRTC) {
+            rtcInterruptWorking = true;
+            wakeupFromRTC = false;
+            
+            // The alarm only matches whole minutes: count down the seconds
+            // left (also covers a countdown that ends a second early)
+            powerDomains.acquire(DOMAIN_I2C, PCLIENT_SYSTEM);
+            uint32_t rtcNow = rtc.now().unixtime();
+            if (rtcNow < scheduledWakeTime) {
+                programRTCWake(WakeSchedule::planRtcWake(rtcNow, scheduledWakeTime));
+                powerDomains.release(DOMAIN_I2C, PCLIENT_SYSTEM);
+                continue;
+            }
+            source = WAKE_RTC;
+            break;
         }
         
+        if (eventScheduler.take(EVT_BUTTON) && confirmButtonWake()) {
+            source = WAKE_BUTTON;
+            wakeupFromButton = true;
+            break;
+        }
+        // Bounce or release edge: back to sleep
+    }
+    
+    powerDomains.acquire(DOMAIN_I2C, PCLIENT_SYSTEM);
+    if (useAlarm) {
+        detachInterrupt(digitalPinToInterrupt(RTC_INT_PIN));
+        disableRTCWake();
+        clearRTCAlarmFlag();
+    }
+    wakeupFromRTC = false;
+    
+    recordSleep(millis() - sleepStart);
+    status.lastWakeSource = source;
+    
+    if (source == WAKE_RTC) {
+        Serial.println(F("Woke from RTC alarm"));
+    } else if (source == WAKE_BUTTON) {
+        Serial.println(F("Woke from button press"));
+    } else {
+        Serial.println(F("Woke from timer"));
+    }
+    Serial.print(F("Slept "));
+    Serial.print(status.lastSleepMs / 1000);
+    Serial.println(F(" s"));
+}
+
+bool PowerManager::confirmButtonWake() {
+    // The edge only says a pin moved; a press counts once it survives the
+    // debounce window. Only this short check polls.
+    unsigned long start = millis();
+    while (millis() - start <= DEBOUNCE_DELAY + BUTTON_POLL_MS * 2) {
         updateButtonStates();
         if (wasButtonPressed(0) || wasButtonPressed(1) || wasButtonPressed(2) || 
             wasButtonPressed(3) || wasBluetoothButtonPressed()) {
-            Serial.println(F("Woke from button press"));
-            status.lastWakeSource = WAKE_BUTTON;
-            wakeupFromButton = true;
-            return;
+            return true;
         }
-        delay(100);
+        
+        // Edges inside the window are what this polls for; left pending
+        // they would end every wait at once. An alarm ends the check: the
+        // caller takes it, and the loop still sees a real press
+        eventScheduler.take(EVT_BUTTON);
+        if (wakeupFromRTC) return false;
+        appTasks.unlockedWait(BUTTON_POLL_MS);
     }
-    
-    Serial.println(F("Woke from timer"));
-    status.lastWakeSource = WAKE_TIMER;
+    return false;
+}
+
+void PowerManager::recordSleep(unsigned long sleptMs) {
+    status.lastSleepMs = sleptMs;
+    status.totalSleepMs += sleptMs;
+    phaseProfiler.record(PHASE_SLEEP, sleptMs * 1000UL);
+}
+
+float PowerManager::getMeasuredAwakeRatio() const {
+    // Time since field mode started, minus time spent in enterNRF52Sleep()
+    unsigned long span = millis() - status.sleepAccountingStart;
+    if (status.totalSleepMs == 0 || span <= status.totalSleepMs) return -1.0f;
+    return 1.0f - (float)status.totalSleepMs / span;
 }
 
 
@@ -475,6 +634,7 @@ void PowerManager::activateBluetooth() {
     status.lastBluetoothActivity = millis();
     
     // Turn on Bluetooth through the manager
+    holdRadio(true);
     bluetoothManager->setEnabled(true);
     
     Serial.print(F("Bluetooth activated for "));
@@ -500,6 +660,7 @@ void PowerManager::deactivateBluetooth() {
     
     // Turn off Bluetooth through the manager
     bluetoothManager->setEnabled(false);
+    holdRadio(false);
 }
 
 bool PowerManager::isBluetoothOn() const {
@@ -573,8 +734,8 @@ void PowerManager::initializeDisplayPower() {
 
 void PowerManager::turnOnDisplay() {
     if (!status.displayOn) {
-        digitalWrite(DISPLAY_POWER_PIN, DISPLAY_POWER_ON);
-        delay(50); // Small delay for display to power up
+        // Switches the pin and waits for the display to power up
+        powerDomains.acquire(DOMAIN_DISPLAY, PCLIENT_DISPLAY);
         status.displayOn = true;
         status.displayState = COMP_POWER_ON;
         Serial.println(F("PowerManager: Display turned ON (pin 12 HIGH)"));
@@ -583,7 +744,7 @@ void PowerManager::turnOnDisplay() {
 
 void PowerManager::turnOffDisplay() {
     if (status.displayOn && status.fieldModeActive) {
-        digitalWrite(DISPLAY_POWER_PIN, DISPLAY_POWER_OFF);
+        powerDomains.release(DOMAIN_DISPLAY, PCLIENT_DISPLAY);
         status.displayOn = false;
         status.displayState = COMP_POWER_OFF;
         displayOffTime = millis();
@@ -731,27 +892,9 @@ void PowerManager::enterFieldSleep() {
         Serial.println(F("Using true deep sleep"));
         enterDeepSleepMode();  // This never returns
     } else {
-        Serial.println(F("Using polling sleep fallback"));
-        
-        // Configure next wake time for polling
-        if (systemSettings && systemStatus && systemStatus->rtcWorking) {
-            DateTime now = rtc.now();
-            uint8_t logInterval = systemSettings->logInterval;
-            
-            int nextMinute = ((now.minute() / logInterval) + 1) * logInterval;
-            int nextHour = now.hour();
-            
-            if (nextMinute >= 60) {
-                nextMinute = 0;
-                nextHour++;
-                if (nextHour >= 24) nextHour = 0;
-            }
-            
-            DateTime nextWake(now.year(), now.month(), now.day(), nextHour, nextMinute, 0);
-            configureRTCWakeup(nextWake.unixtime());
-        }
+        Serial.println(F("Using System ON sleep"));
         
-        // Enter polling-based sleep
+        // Wakes at the time set by updateNextWakeTime()
         enterNRF52Sleep();
     }
 }
@@ -789,7 +932,9 @@ void PowerManager::enableFieldMode() {
     
     // Initialize field mode timing
     status.lastLogTime = millis();
-    updateNextWakeTime(systemSettings ? systemSettings->logInterval : 10);
+    status.totalSleepMs = 0;
+    status.sleepAccountingStart = millis();
+    updateNextWakeTime(getWakeIntervalS());
     
     // Start timeout countdown silently
     resetDisplayTimeout();
@@ -802,6 +947,9 @@ void PowerManager::enableFieldMode() {
     powerDownSensors();
     powerDownAudio();
     
+    // The field buffer takes the card only while it flushes
+    powerDomains.release(DOMAIN_SD_SPI, PCLIENT_LOGGER);
+    
     Serial.println(F("=== FIELD MODE ENABLED ==="));
     Serial.print(F("Log interval: "));
     Serial.print(systemSettings ? systemSettings->logInterval : 10);
@@ -832,6 +980,7 @@ void PowerManager::disableFieldMode() {
 
     // Turn Bluetooth back on for testing mode
     if (bluetoothManager) {
+        holdRadio(true);
         bluetoothManager->setEnabled(true);
         status.bluetoothOn = true;
         status.bluetoothState = COMP_POWER_ON;
@@ -840,6 +989,7 @@ void PowerManager::disableFieldMode() {
     // Power sensors back up for testing mode
     powerUpSensors();
     powerUpAudio();
+    powerDomains.acquire(DOMAIN_SD_SPI, PCLIENT_LOGGER);
     
     Serial.println(F("=== FIELD MODE DISABLED ==="));
     Serial.println(F("Returning to Testing Mode"));
@@ -895,39 +1045,51 @@ bool PowerManager::shouldTakeReading() const {
     return (status.lastWakeSource == WAKE_RTC);
 }
 
-void PowerManager::updateNextWakeTime(uint8_t logIntervalMinutes) {
+uint8_t PowerManager::getLogInterval() const {
+    // The adaptive interval, or settings.logInterval when it is off
+    return adaptiveInterval.getInterval(systemSettings ? systemSettings->logInterval : 10);
+}
+
+uint32_t PowerManager::getWakeIntervalS() const {
+    // A SET_WAKE_SCHEDULE interval takes precedence; the adaptive one
+    // applies only while the schedule follows the log interval
+    return wakeSchedule.getIntervalS(getLogInterval() * 60UL);
+}
+
+void PowerManager::updateNextWakeTime(uint32_t intervalS) {
     status.lastLogTime = millis();
     
-    // Round to next full minute boundary
+    // Alignment and jitter come from the wake schedule
     if (systemStatus && systemStatus->rtcWorking) {
-        DateTime now = rtc.now();
-        
-        // Calculate next interval boundary (round up to next interval minute)
-        int nextMinute = ((now.minute() / logIntervalMinutes) + 1) * logIntervalMinutes;
-        int nextHour = now.hour();
-        
-        // Handle minute overflow
-        if (nextMinute >= 60) {
-            nextMinute = 0;
-            nextHour++;
-            if (nextHour >= 24) nextHour = 0;
-        }
-        
-        DateTime nextReading(now.year(), now.month(), now.day(), nextHour, nextMinute, 0);
-        status.nextWakeTime = nextReading.unixtime() * 1000UL; // Convert to millis
+        scheduledWakeTime = wakeSchedule.nextWake(rtc.now().unixtime(), intervalS);
+        status.nextWakeTime = scheduledWakeTime;
         
+        DateTime nextReading(scheduledWakeTime);
+        char buf[24];
+        snprintf(buf, sizeof(buf), "%02d-%02d %02d:%02d:%02d",
+                 nextReading.month(), nextReading.day(),
+                 nextReading.hour(), nextReading.minute(), nextReading.second());
         Serial.print(F("Next reading at: "));
-        Serial.print(nextHour);
-        Serial.print(F(":"));
-        if (nextMinute < 10) Serial.print(F("0"));
-        Serial.println(nextMinute);
+        Serial.println(buf);
     } else {
         // Fallback if no RTC
-        status.nextWakeTime = status.lastLogTime + (logIntervalMinutes * 60000UL);
+        status.nextWakeTime = status.lastLogTime + intervalS * 1000UL;
         Serial.print(F("Next reading in "));
-        Serial.print(logIntervalMinutes);
-        Serial.println(F(" minutes (no RTC)"));
+        Serial.print(intervalS);
+        Serial.println(F(" s (no RTC)"));
+    }
+}
+
+uint32_t PowerManager::ensureScheduledWake(uint32_t now) {
+    // Replanned when it has gone by, or is further off than any interval
+    // allows (the clock was set since it was planned)
+    uint32_t intervalS = getWakeIntervalS();
+    if (scheduledWakeTime < now + WAKE_MIN_LEAD_S ||
+        scheduledWakeTime > now + 2 * intervalS) {
+        scheduledWakeTime = wakeSchedule.nextWake(now, intervalS);
+        status.nextWakeTime = scheduledWakeTime;
     }
+    return scheduledWakeTime;
 }
 
 bool PowerManager::shouldEnterSleep() {
@@ -940,6 +1102,10 @@ bool PowerManager::isTimeForBufferFlush() const {
     return (timeSinceFlush >= 3600000UL); // 1 hour in milliseconds
 }
 
+void PowerManager::noteBufferFlush() {
+    status.lastFlushTime = millis();
+}
+
 void PowerManager::setWakeSource(bool fromTimer) {
     status.wokenByTimer = fromTimer;
     status.lastWakeSource = fromTimer ? WAKE_TIMER : WAKE_BUTTON;
@@ -964,7 +1130,12 @@ void PowerManager::setupWakeupPin() {
                              NRF_GPIO_PIN_PULLUP, 
                              NRF_GPIO_PIN_SENSE_LOW);
     
-    Serial.println(F("Wake-up pin A1 configured for deep sleep"));
+    // The buttons too, or nothing but the RTC could wake a System OFF sleep
+    for (uint8_t pin : systemOffWakeButtons) {
+        nrf_gpio_cfg_sense_input(digitalPinToPinName(pin), NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_SENSE_LOW);
+    }
+    
+    Serial.println(F("Wake-up pins configured for deep sleep (A1, select, Bluetooth)"));
     Serial.print(F("Pin state: "));
     Serial.println(digitalRead(RTC_INT_PIN) ? "HIGH" : "LOW");
 #endif
@@ -1021,13 +1192,45 @@ void PowerManager::updatePowerMode(float batteryVoltage) {
     calculateRuntimeEstimate(batteryVoltage);
 }
 
-void PowerManager::calculateRuntimeEstimate(float batteryVoltage) {
-    const float BATTERY_CAPACITY_MAH = 1200.0f;
+float PowerManager::getActiveCurrentMa() const {
+    float ma = POWER_TESTING_MA + POWER_SENSORS_MA;
+    if (systemStatus && systemStatus->pdmWorking) {
+        ma += POWER_AUDIO_MA;
+    }
+    if (status.displayOn) {
+        ma += POWER_DISPLAY_MA;
+    }
+    if (status.bluetoothOn) {
+        ma += POWER_BLUETOOTH_MA;
+    }
+    return ma;
+}
+
+void PowerManager::updateBatteryModel(const SensorData& data) {
+    // The battery is read while awake, so the load is the active draw; the
+    // average since the last reading comes from the previous estimate
+    float avgMa = status.dailyUsageEstimateMah / 24.0f;
+    float tempC = data.sensorsValid ? data.temperature : BATTERY_REF_TEMP_C;
+    batteryModel.update(data.batteryVoltage, getActiveCurrentMa(), avgMa, tempC, millis());
     
+    // Field mode never calls updatePowerMode, so refresh the estimate here
+    calculateRuntimeEstimate(data.batteryVoltage);
+}
+
+void PowerManager::calculateRuntimeEstimate(float batteryVoltage) {
     float currentConsumption = POWER_TESTING_MA;
     
     if (status.fieldModeActive) {
-        float awakeTimeRatio = 2.0f / (systemSettings ? systemSettings->logInterval : 10.0f);
+        float intervalS = getWakeIntervalS();
+        float awakeTimeRatio = min(1.0f, 120.0f / intervalS);
+        
+        // Once System ON sleeps have been timed, the measured split replaces
+        // the assumed two minutes awake per interval
+        bool deepSleep = canUseDeepSleep();
+        float measured = getMeasuredAwakeRatio();
+        if (!deepSleep && measured >= 0.0f) {
+            awakeTimeRatio = measured;
+        }
         float activePower = POWER_TESTING_MA + POWER_SENSORS_MA;
         
         if (systemStatus && systemStatus->pdmWorking) {
@@ -1038,9 +1241,18 @@ void PowerManager::calculateRuntimeEstimate(float batteryVoltage) {
         }
         
         // Use appropriate sleep power based on deep sleep capability
-        float sleepPower = canUseDeepSleep() ? POWER_DEEP_SLEEP_MA : POWER_SLEEP_MA;
+        float sleepPower = deepSleep ? POWER_DEEP_SLEEP_MA : POWER_SLEEP_MA;
         
         currentConsumption = (activePower * awakeTimeRatio) + (sleepPower * (1.0f - awakeTimeRatio));
+        
+        // Timed wake phases and sleeps beat both assumptions
+        if (!deepSleep && phaseProfiler.hasEnergyData()) {
+            currentConsumption = phaseProfiler.getAverageCurrentMa();
+        }
+    } else if (powerDomains.isManaged()) {
+        // Peripheral draw from the time each domain was actually on; the
+        // radio is part of POWER_TESTING_MA
+        currentConsumption += powerDomains.getAverageCurrentMa(DOMAIN_MASK_ALL & ~DOMAIN_BIT(DOMAIN_RADIO));
     } else {
         currentConsumption += POWER_DISPLAY_MA + POWER_SENSORS_MA;
         if (systemStatus && systemStatus->pdmWorking) {
@@ -1048,10 +1260,11 @@ void PowerManager::calculateRuntimeEstimate(float batteryVoltage) {
         }
     }
     
-    float batteryLevel = getBatteryLevel(batteryVoltage);
-    float remainingCapacity = BATTERY_CAPACITY_MAH * (batteryLevel / 100.0f);
-    
-    if (currentConsumption > 0) {
+    if (batteryModel.isValid()) {
+        // Charge left from the filter, drain rate as observed once known
+        status.estimatedRuntimeHours = batteryModel.predictRuntimeHours(currentConsumption);
+    } else if (currentConsumption > 0) {
+        float remainingCapacity = BATTERY_CAPACITY_MAH * (getBatteryLevel(batteryVoltage) / 100.0f);
         status.estimatedRuntimeHours = remainingCapacity / currentConsumption;
     } else {
         status.estimatedRuntimeHours = 999.0f;
@@ -1068,6 +1281,8 @@ void PowerManager::powerDownNonEssential() {
     Serial.println(F("Powering down non-essential components for deep sleep"));
     status.sensorState = COMP_POWER_SLEEP;
     status.audioState = COMP_POWER_SLEEP;
+    powerDomains.release(DOMAIN_BME280, PCLIENT_SENSORS);
+    powerDomains.release(DOMAIN_MIC_ADC, PCLIENT_AUDIO);
     
     // Use your existing method:
     powerDownBluetooth();
@@ -1077,27 +1292,33 @@ void PowerManager::powerUpAll() {
     Serial.println(F("Powering up all components after wake"));
     status.sensorState = COMP_POWER_ON;
     status.audioState = COMP_POWER_ON;
+    powerDomains.acquire(DOMAIN_BME280, PCLIENT_SENSORS);
+    powerDomains.acquire(DOMAIN_MIC_ADC, PCLIENT_AUDIO);
     
     // Use your existing method:
     powerUpBluetooth();
 }
 
 void PowerManager::powerDownSensors() {
+    powerDomains.release(DOMAIN_BME280, PCLIENT_SENSORS);
     status.sensorState = COMP_POWER_SLEEP;
     Serial.println(F("PowerManager: Sensors powered down"));
 }
 
 void PowerManager::powerUpSensors() {
+    powerDomains.acquire(DOMAIN_BME280, PCLIENT_SENSORS);
     status.sensorState = COMP_POWER_ON;
     Serial.println(F("PowerManager: Sensors powered up"));
 }
 
 void PowerManager::powerDownAudio() {
+    powerDomains.release(DOMAIN_MIC_ADC, PCLIENT_AUDIO);
     status.audioState = COMP_POWER_OFF;
     Serial.println(F("PowerManager: Audio powered down"));
 }
 
 void PowerManager::powerUpAudio() {
+    powerDomains.acquire(DOMAIN_MIC_ADC, PCLIENT_AUDIO);
     status.audioState = COMP_POWER_ON;
     Serial.println(F("PowerManager: Audio powered up"));
 }
@@ -1106,11 +1327,13 @@ void PowerManager::powerDownBluetooth() {
     if (bluetoothManager) {
         bluetoothManager->setEnabled(false);
     }
+    holdRadio(false);
     status.bluetoothState = COMP_POWER_OFF;
     Serial.println(F("PowerManager: Bluetooth powered down"));
 }
 
 void PowerManager::powerUpBluetooth() {
+    holdRadio(true);
     if (bluetoothManager) {
         bluetoothManager->setEnabled(true);
     }
@@ -1122,17 +1345,56 @@ void PowerManager::powerUpBluetooth() {
 // DEEP SLEEP IMPLEMENTATION
 // =============================================================================
 
+#ifdef NRF52_SERIES
+// nRF52840 RAM map: RAM0-RAM7 hold two 4 KB sections each from the start
+// of RAM, RAM8 six 32 KB sections after them
+static const uint32_t RAM_START = 0x20000000UL;
+static const uint32_t RAM_SMALL_BLOCKS_END = 0x10000UL;
+static const uint32_t RAM_SMALL_BLOCK = 0x2000UL;
+static const uint32_t RAM_SMALL_SECTION = 0x1000UL;
+static const uint32_t RAM_LARGE_SECTION = 0x8000UL;
+
+// System OFF only keeps the RAM sections marked for retention
+static void retainRamForSystemOff(const void* start, size_t length, bool softDevice) {
+    uint32_t offset = (uint32_t)((uintptr_t)start - RAM_START);
+    uint32_t end = offset + length;
+    
+    while (offset < end) {
+        uint8_t block, section;
+        uint32_t sectionSize;
+        if (offset < RAM_SMALL_BLOCKS_END) {
+            block = offset / RAM_SMALL_BLOCK;
+            section = (offset % RAM_SMALL_BLOCK) / RAM_SMALL_SECTION;
+            sectionSize = RAM_SMALL_SECTION;
+        } else {
+            block = 8;
+            section = (offset - RAM_SMALL_BLOCKS_END) / RAM_LARGE_SECTION;
+            sectionSize = RAM_LARGE_SECTION;
+        }
+        
+        uint32_t mask = 1UL << (POWER_RAM_POWER_S0RETENTION_Pos + section);
+        if (softDevice) {
+            sd_power_ram_power_set(block, mask);
+        } else {
+            NRF_POWER->RAM[block].POWERSET = mask;
+        }
+        offset = (offset / sectionSize + 1) * sectionSize;
+    }
+}
+#endif
+
 void PowerManager::enterDeepSleepMode() {
 #ifdef NRF52_SERIES
-    if (!canUseDeepSleep()) {
-        Serial.println(F("Deep sleep not available - using polling fallback"));
+    const char* blocker = getDeepSleepBlocker();
+    if (blocker) {
+        Serial.print(F("Deep sleep not available ("));
+        Serial.print(blocker);
+        Serial.println(F(") - using System ON sleep"));
         enterNRF52Sleep();
         return;
     }
     
     Serial.println(F("PowerManager: Preparing for System OFF deep sleep"));
-
-    saveRetainedState();
     
     // Power down all peripherals
     prepareSleep();
@@ -1140,7 +1402,11 @@ void PowerManager::enterDeepSleepMode() {
     // Calculate next wake time
     extern RTC_PCF8523 rtc;
     DateTime now = rtc.now();
-    uint8_t logInterval = systemSettings ? systemSettings->logInterval : 10;
+    
+    // Settings, microphone flag and unflushed readings for the fast boot
+    if (systemSettings && systemStatus) {
+        fastBoot.save(*systemSettings, *systemStatus, fieldBuffer.getBuffer(), now.unixtime());
+    }
     
     Serial.print(F("Current time: "));
     Serial.print(now.hour());
@@ -1148,17 +1414,14 @@ void PowerManager::enterDeepSleepMode() {
     if (now.minute() < 10) Serial.print(F("0"));
     Serial.println(now.minute());
     
-    // Calculate next interval boundary
-    int nextMinute = ((now.minute() / logInterval) + 1) * logInterval;
-    if (nextMinute >= 60) {
-        nextMinute %= 60;
-    }
-    
-    Serial.print(F("Next wake minute: "));
-    Serial.println(nextMinute);
+    // A target off the minute wakes at the minute before it; the next
+    // boot finds the target in the retained state and counts down the
+    // rest (finishTwoStageWake)
+    RtcWakePlan plan = WakeSchedule::planRtcWake(now.unixtime(), ensureScheduledWake(now.unixtime()));
+    saveRetainedState();
     
     // Program the PCF8523 hardware alarm
-    programRTCAlarm(nextMinute);
+    programRTCWake(plan);
     
     // Small delay to ensure alarm is set
     delay(100);
@@ -1168,78 +1431,120 @@ void PowerManager::enterDeepSleepMode() {
     Serial.println(F("Next message will be from setup() after wake"));
     Serial.flush(); // Ensure all output is sent
     
-    // Configure wake-up pin one more time
+    enterSystemOff();
+#else
+    Serial.println(F("Deep sleep not supported - using System ON sleep"));
+    enterNRF52Sleep();
+#endif
+}
+
+void PowerManager::finishTwoStageWake() {
+#ifdef NRF52_SERIES
+    // Only the minute alarm of a wake planned off the minute lands here
+    // early; anything further off is taken as the wake (clock was set)
+    uint32_t now = rtc.now().unixtime();
+    uint8_t remainingS = WakeSchedule::secondStageS(now, retainedState.nextWakeTime);
+    if (!status.deepSleepCapable || remainingS == 0) return;
+    
+    Serial.print(F("Alarm before the target, counting down "));
+    Serial.print(remainingS);
+    Serial.println(F(" s"));
+    Serial.flush();
+    
+    // Retained state and the fast boot cache are still as saved
+    programRTCWake(WakeSchedule::planRtcWake(now, retainedState.nextWakeTime));
+    enterSystemOff();
+#endif
+}
+
+#ifdef NRF52_SERIES
+void PowerManager::enterSystemOff() {
+    // Configure wake-up pins one more time
     nrf_gpio_cfg_sense_input(digitalPinToPinName(RTC_INT_PIN), 
                              NRF_GPIO_PIN_PULLUP, 
                              NRF_GPIO_PIN_SENSE_LOW);
+    for (uint8_t pin : systemOffWakeButtons) {
+        nrf_gpio_cfg_sense_input(digitalPinToPinName(pin), NRF_GPIO_PIN_PULLUP, NRF_GPIO_PIN_SENSE_LOW);
+    }
+    
+    // Keep the retained blocks powered. A scheduled wake only starts the
+    // SoftDevice if a button brought Bluetooth up, so check which way the
+    // registers have to be written
+    uint8_t softDevice = 0;
+    sd_softdevice_is_enabled(&softDevice);
+    retainRamForSystemOff(&retainedState, sizeof(retainedState), softDevice);
+    retainRamForSystemOff(fastBoot.getCache(), sizeof(FastBootCache), softDevice);
     
     // Enter System OFF - this does not return
     // System will reset when RTC alarm pulls A1 low
-    sd_power_system_off();
+    if (softDevice) {
+        sd_power_system_off();
+    } else {
+        NRF_POWER->SYSTEMOFF = POWER_SYSTEMOFF_SYSTEMOFF_Enter;
+    }
     
     // This line should never be reached
     Serial.println(F("ERROR: System OFF failed!"));
-#else
-    Serial.println(F("Deep sleep not supported - using polling"));
-    enterNRF52Sleep();
-#endif
 }
+#endif
 
-void PowerManager::programRTCAlarm(uint8_t targetMinute) {
-    extern RTC_PCF8523 rtc;
-    (void)rtc; // Suppress unused variable warning
-    
-    Serial.print(F("Programming RTC alarm for minute: "));
-    Serial.println(targetMinute);
-    
-    // Clear any existing alarm flag first
+void PowerManager::programRTCWake(const RtcWakePlan& plan) {
+    // Start from a quiet RTC: the alarm and timer A share the interrupt
+    // line, and a flag left set would hold it low
+    disableRTCWake();
     clearRTCAlarmFlag();
     
-    // PCF8523 Register Map (from datasheet):
-    // 0x0A = Minute_alarm
-    // 0x0B = Hour_alarm  
-    // 0x0C = Day_alarm
-    // 0x0D = Weekday_alarm
-    // 0x01 = Control_2 (contains AIE bit)
-    
-    // Program alarm registers directly via I2C
-    Wire.beginTransmission(0x68);  // PCF8523 I2C address
-    Wire.write(0x0A);              // Start at Minute_alarm register
-    Wire.write(decToBcd(targetMinute)); // Set target minute in BCD
-    Wire.write(0x80);              // Hour_alarm disabled (bit 7 = 1)
-    Wire.write(0x80);              // Day_alarm disabled (bit 7 = 1)
-    Wire.write(0x80);              // Weekday_alarm disabled (bit 7 = 1)
-    Wire.endTransmission();
-    
-    // Enable alarm interrupt in Control_2 register
-    Wire.beginTransmission(0x68);
-    Wire.write(0x01);              // Control_2 register address
-    Wire.endTransmission();
-    
-    Wire.requestFrom(0x68, 1);
-    uint8_t control2 = Wire.read();
-    
-    control2 |= 0x02;              // Set AIE bit (bit 1) to enable alarm interrupt
-    control2 &= ~0x08;             // Clear AF bit (bit 3) - alarm flag
-    
-    Wire.beginTransmission(0x68);
-    Wire.write(0x01);              // Control_2 register
-    Wire.write(control2);
-    Wire.endTransmission();
-    
-    Serial.println(F("RTC hardware alarm programmed"));
+    if (plan.countdown) {
+        Serial.print(F("Programming RTC countdown: "));
+        Serial.print(plan.countdownS);
+        Serial.println(F(" s"));
+        
+        // PCF8523 Register Map (from datasheet):
+        // 0x0F = Tmr_CLKOUT_ctrl (TAM, COF, TAC)
+        // 0x10 = Tmr_A_freq_ctrl
+        // 0x11 = Tmr_A_reg
+        // 0x01 = Control_2 (contains CTAIE bit)
+        Wire.beginTransmission(PCF8523_ADDRESS);
+        Wire.write(PCF8523_REG_TMR_A_FREQ);
+        Wire.write(PCF8523_TMR_1HZ);
+        Wire.write(plan.countdownS);
+        Wire.endTransmission();
+        
+        // Level interrupt, CLKOUT off, timer A counting down
+        updateRtcRegister(PCF8523_REG_TMR_CLKOUT, PCF8523_TAM | PCF8523_TAC_MASK,
+                          PCF8523_COF_DISABLED | PCF8523_TAC_COUNTDOWN);
+        updateRtcRegister(PCF8523_REG_CONTROL_2, 0, PCF8523_CTAIE);
+    } else {
+        Serial.print(F("Programming RTC alarm for day "));
+        Serial.print(plan.day);
+        Serial.print(F(" "));
+        Serial.print(plan.hour);
+        Serial.print(F(":"));
+        if (plan.minute < 10) Serial.print(F("0"));
+        Serial.println(plan.minute);
+        
+        // 0x0A..0x0D = Minute, Hour, Day, Weekday alarm (bit 7 = 1 disables)
+        // 0x00 = Control_1 (contains AIE bit)
+        Wire.beginTransmission(PCF8523_ADDRESS);
+        Wire.write(PCF8523_REG_MINUTE_ALARM);
+        Wire.write(decToBcd(plan.minute));
+        Wire.write(decToBcd(plan.hour));
+        Wire.write(decToBcd(plan.day));
+        Wire.write(PCF8523_ALARM_DISABLE);   // Any weekday
+        Wire.endTransmission();
+        
+        updateRtcRegister(PCF8523_REG_TMR_CLKOUT, 0, PCF8523_COF_DISABLED);
+        updateRtcRegister(PCF8523_REG_CONTROL_1, 0, PCF8523_AIE);
+    }
     
-    // Verify the alarm was set correctly
-    Wire.beginTransmission(0x68);
-    Wire.write(0x0A);
-    Wire.endTransmission();
-    Wire.requestFrom(0x68, 1);
-    uint8_t readBack = Wire.read();
-    Serial.print(F("Alarm minute register: 0x"));
-    Serial.print(readBack, HEX);
-    Serial.print(F(" ("));
-    Serial.print(bcdToDec(readBack));
-    Serial.println(F(")"));
+    Serial.println(F("RTC hardware wake programmed"));
+}
+
+void PowerManager::disableRTCWake() {
+    // Timer A stopped, alarm and countdown interrupts off
+    updateRtcRegister(PCF8523_REG_TMR_CLKOUT, PCF8523_TAC_MASK, 0);
+    updateRtcRegister(PCF8523_REG_CONTROL_1, PCF8523_AIE, 0);
+    updateRtcRegister(PCF8523_REG_CONTROL_2, PCF8523_CTAIE, 0);
 }
 
 
@@ -1253,31 +1558,20 @@ uint8_t PowerManager::bcdToDec(uint8_t val) {
 }
 
 bool PowerManager::canUseDeepSleep() const {
-    Serial.println("=== Deep Sleep Capability Check ===");
-    
-    if (!status.deepSleepCapable) {
-        Serial.println("Deep sleep: Not capable - initializeDeepSleep failed");
-        return false;
-    }
-    
-    if (!settings.useDeepSleep) {
-        Serial.println("Deep sleep: Disabled in settings");
-        return false;
-    }
-    
-    if (!systemStatus || !systemStatus->rtcWorking) {
-        Serial.println("Deep sleep: RTC not working");
-        return false;
-    }
+    // Called on every battery update; the reason is reported by
+    // printPowerStatus() and enterDeepSleepMode() instead
+    return getDeepSleepBlocker() == nullptr;
+}
+
+const char* PowerManager::getDeepSleepBlocker() const {
+    if (!status.deepSleepCapable) return "no System OFF support";
+    if (!settings.useDeepSleep) return "disabled in settings";
+    if (!systemStatus || !systemStatus->rtcWorking) return "RTC not working";
+    if (bluetoothManager && bluetoothManager->needsRadioWhileAsleep()) return "radio in use";
     
     extern RTC_PCF8523 rtc;
-    if (!rtc.isrunning()) {
-        Serial.println("Deep sleep: RTC oscillator not running");
-        return false;
-    }
-    
-    Serial.println("Deep sleep: All checks passed - CAPABLE");
-    return true;
+    if (!rtc.isrunning()) return "RTC oscillator not running";
+    return nullptr;
 }
 
 // =============================================================================
@@ -1375,25 +1669,40 @@ void PowerManager::printPowerStatus() const {
     
     // Deep sleep status
     Serial.print(F("Deep Sleep: "));
-    if (canUseDeepSleep()) {
+    const char* blocker = getDeepSleepBlocker();
+    if (!blocker) {
         Serial.print(F("ENABLED ("));
         Serial.print(status.deepSleepCycles);
         Serial.println(F(" cycles)"));
     } else {
-        Serial.println(F("DISABLED (using polling)"));
+        Serial.print(F("DISABLED ("));
+        Serial.print(blocker);
+        Serial.println(F(", using System ON sleep)"));
+    }
+    
+    float awake = getMeasuredAwakeRatio();
+    if (awake >= 0.0f) {
+        Serial.print(F("Asleep: "));
+        Serial.print((1.0f - awake) * 100.0f, 1);
+        Serial.print(F("% (last "));
+        Serial.print(status.lastSleepMs / 1000);
+        Serial.println(F(" s)"));
     }
     
     Serial.print(F("Wake from deep sleep: "));
     Serial.println(status.wakeFromDeepSleep ? "YES" : "NO");
     
+    batteryModel.printStatus();
+    powerDomains.printStatus();
+    
     Serial.print(F("Est. Runtime: "));
     Serial.print(status.estimatedRuntimeHours, 1);
     Serial.println(F(" hours"));
     
-    if (canUseDeepSleep()) {
+    if (!blocker) {
         Serial.println(F("  (with true deep sleep)"));
     } else {
-        Serial.println(F("  (with polling sleep)"));
+        Serial.println(F("  (with System ON sleep)"));
     }
     
     Serial.println(F("=====================================\n"));
@@ -1403,6 +1712,8 @@ void PowerManager::resetStatistics() {
     status.sleepCycles = 0;
     status.buttonPresses = 0;
     status.totalUptime = millis();
+    status.totalSleepMs = 0;
+    status.sleepAccountingStart = millis();
     Serial.println(F("Power statistics reset"));
 }
 
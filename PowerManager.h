@@ -8,10 +8,15 @@
 
 #include "Config.h"
 #include "DataStructures.h"
+#include "WakeSchedule.h"
 
 // Forward declaration to avoid circular dependency
 class BluetoothManager;
 
+// System ON sleep waits for the RTC alarm; the timer backstop runs this
+// much later so it never races a working alarm
+#define SLEEP_ALARM_MARGIN_MS 5000UL
+
 // =============================================================================
 // POWER MANAGEMENT ENUMERATIONS
 // =============================================================================
@@ -47,7 +52,7 @@ struct PowerStatus {
     PowerMode currentMode;
     bool wokenByTimer;          // true if woken by RTC, false if by button
     uint32_t lastLogTime;       // Last time we took a reading
-    uint32_t nextWakeTime;      // When to wake for next reading
+    uint32_t nextWakeTime;      // Next reading, RTC unix time (millis() without the RTC)
     uint32_t lastFlushTime;     // Last time buffer was flushed
     bool fieldModeActive;
     bool displayOn;
@@ -77,6 +82,11 @@ struct PowerStatus {
     bool deepSleepCapable;      // Can we use true deep sleep?
     uint32_t deepSleepCycles;   // Count of deep sleep cycles
     bool wakeFromDeepSleep;     // Did we just wake from deep sleep?
+    
+    // Measured System ON sleep, for the runtime estimate
+    unsigned long lastSleepMs;
+    unsigned long totalSleepMs;
+    unsigned long sleepAccountingStart; // millis() when field mode started
 };
 
 struct PowerSettings {
@@ -124,7 +134,6 @@ private:
 
     // Retained state management      
     uint16_t calculateRetainedChecksum(const RetainedState& state);
-    void saveRetainedState();
     
     // Power consumption estimates (mA)
     static const float POWER_TESTING_MA;
@@ -137,14 +146,19 @@ private:
     
     // Deep sleep management 
     void setupWakeupPin();
-    void programRTCAlarm(uint8_t targetMinute);
+    void programRTCWake(const RtcWakePlan& plan);
+#ifdef NRF52_SERIES
+    void enterSystemOff();             // Wake pins, retained RAM, then off
+#endif
+    void disableRTCWake();
     void clearRTCAlarmFlag();
+    uint32_t ensureScheduledWake(uint32_t now);
     uint8_t decToBcd(uint8_t val);      // CORRECTED: Convert decimal to BCD
     uint8_t bcdToDec(uint8_t val);      // NEW: Convert BCD to decimal
     
     
-    // Legacy sleep methods (for fallback)
-    void enterNRF52Sleep();
+    bool confirmButtonWake();
+    void recordSleep(unsigned long sleptMs);
     void configureRTCWakeup(uint32_t wakeupTimeUnix);
     bool handleRTCWakeup();
     void setupRTCInterrupt();
@@ -157,6 +171,7 @@ private:
     
     // Internal methods    
     void calculateRuntimeEstimate(float batteryVoltage);
+    float getActiveCurrentMa() const;       // Modelled draw of the present state
     void handleDisplayTimeout();
     void handleBluetoothTimeout();
     void configureButtonWakeup();
@@ -180,7 +195,9 @@ public:
     // Deep sleep initialization and detection
     void initializeWakeDetection(WakeUpSource bootReason);
     bool canUseDeepSleep() const;
+    const char* getDeepSleepBlocker() const;   // nullptr when System OFF is usable
     void setDeepSleepEnabled(bool enabled);
+    void saveRetainedState();
     bool restoreRetainedState();
     void clearRetainedState();
     bool initializeDeepSleep();
@@ -218,8 +235,9 @@ public:
 
     // Field mode sleep management
     bool shouldTakeReading() const;
-    void updateNextWakeTime(uint8_t logIntervalMinutes);
+    void updateNextWakeTime(uint32_t intervalS);
     bool isTimeForBufferFlush() const;
+    void noteBufferFlush();               // Restarts the hourly flush period
     void setWakeSource(bool fromTimer);
     bool wasWokenByTimer() const;
     bool checkForLongPressWake();
@@ -237,6 +255,12 @@ public:
     // Sleep management - UPDATED
     void enterDeepSleep(uint32_t sleepTimeMs);
     void enterDeepSleepMode();      // NEW: True deep sleep (never returns)
+    // Scheduled wake at the minute alarm before an off-minute target: back
+    // to System OFF for the remaining seconds (returns otherwise)
+    void finishTwoStageWake();
+    // System ON sleep (CPU halted between interrupts) until the RTC, a
+    // confirmed button press or the backstop timeout
+    void enterNRF52Sleep();
     void prepareSleep();
     void wakeFromSleep();
     bool canEnterSleep() const;
@@ -252,13 +276,18 @@ public:
     bool didWakeFromDeepSleep() const { return status.wakeFromDeepSleep; }
     
     // Battery and power monitoring
+    void updateBatteryModel(const SensorData& data);   // After each battery reading
     PowerMode getCurrentPowerMode() const;
     float getEstimatedRuntimeHours() const;
     float getDailyUsageEstimate() const;
     unsigned long getUptime() const;
     uint32_t getSleepCycles() const;
     uint32_t getDeepSleepCycles() const { return status.deepSleepCycles; }
+    unsigned long getLastSleepMs() const { return status.lastSleepMs; }
+    float getMeasuredAwakeRatio() const;     // -1 until a sleep has been measured
     uint32_t getButtonPresses() const;
+    uint8_t getLogInterval() const;          // Adaptive or configured log interval, minutes
+    uint32_t getWakeIntervalS() const;       // Seconds to the next field reading
 
     // Settings management
     void setDisplayTimeout(uint8_t minutes);
@@ -0,0 +1,270 @@
+/**
+ * PowerSimulator.cpp
+ * Field deployment energy projection implementation
+ */
+
+#include "PowerSimulator.h"
+#include "WakeSchedule.h"
+#include "BatteryModel.h"
+#include "DataStructures.h"
+
+PowerSimulator powerSimulator;
+
+static const uint64_t DAY_US = 86400ULL * 1000000ULL;
+
+// Wake phase durations (us) until PhaseProfiler has timed a wake. Rough
+// figures from the scheduled wake sequence in main.cpp
+static const uint32_t defaultPhaseUs[PHASE_COUNT] = {
+    20000,     // Stabilize: one loop pass with the sensors powered
+    60000,     // Sensors: battery, BME280, alerts
+    550000,    // Audio capture: 50 blocks 10 ms apart
+    80000,     // FFT
+    2000,      // Buffer
+    600000,    // SD flush, per flush (includes mounting after a fast boot)
+    300000,    // Other: mostly Serial output
+    0          // Sleep: the rest of the interval
+};
+
+PowerSimulator::PowerSimulator() {
+    memset(&result, 0, sizeof(result));
+    hasResult = false;
+    memcpy(wakeUs, defaultPhaseUs, sizeof(wakeUs));
+    memset(dayUs, 0, sizeof(dayUs));
+    day = 0;
+    usedMah = 0.0f;
+    startSoc = 1.0f;
+    fullMah = BATTERY_CAPACITY_MAH;
+    running = false;
+    startTime = 0;
+    defaultS = 0;
+    wakeCostUs = 0;
+    endUs = 0;
+    dayEndUs = 0;
+    sleepFromUs = 0;
+    wake = 0;
+    buffered = 0;
+    lastFlush = 0;
+    runUs = 0;
+}
+
+// =============================================================================
+// MODEL
+// =============================================================================
+
+uint32_t PowerSimulator::getDefaultPhaseUs(uint8_t phase) {
+    return phase < PHASE_COUNT ? defaultPhaseUs[phase] : 0;
+}
+
+void PowerSimulator::loadPhaseCosts() {
+    memcpy(wakeUs, defaultPhaseUs, sizeof(wakeUs));
+    uint32_t cycles = phaseProfiler.getCycles();
+    result.measured = cycles > 0;
+    if (!result.measured) return;
+
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        if (i == PHASE_SLEEP) continue;
+        const PhaseStats& s = phaseProfiler.getStats(i);
+        if (i == PHASE_SD_FLUSH) {
+            // Per flush, not spread over the cycles without one
+            if (s.count) wakeUs[i] = s.totalUs / s.count;
+        } else {
+            // Averaged over every cycle, so phases that only run
+            // sometimes (audio without a microphone) weigh in right
+            wakeUs[i] = s.totalUs / cycles;
+        }
+    }
+}
+
+void PowerSimulator::closeDay() {
+    float dayMah = 0.0f;
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        float mah = (float)dayUs[i] * phaseProfiler.getPhaseCurrent((WakePhase)i) / 3.6e9f;
+        result.phaseMah[i] += mah;
+        result.phaseHours[i] += (float)dayUs[i] / 3.6e9f;
+        dayMah += mah;
+        dayUs[i] = 0;
+    }
+
+    // Crossing empty part way through the day, at that day's rate
+    if (result.daysToEmpty == 0.0f && usedMah + dayMah >= result.usableMah && dayMah > 0.0f) {
+        result.daysToEmpty = day + (result.usableMah - usedMah) / dayMah;
+    }
+    usedMah += dayMah;
+    day++;
+
+    float soc = startSoc - usedMah / fullMah;
+    result.socByDay[day] = (uint8_t)constrain(soc * 100.0f + 0.5f, 0.0f, 100.0f);
+}
+
+// =============================================================================
+// SIMULATION
+// =============================================================================
+
+void PowerSimulator::begin(const SimConfig& config, uint32_t start, uint8_t logIntervalMin) {
+    memset(&result, 0, sizeof(result));
+    memset(dayUs, 0, sizeof(dayUs));
+    day = 0;
+    usedMah = 0.0f;
+    runUs = 0;
+    loadPhaseCosts();
+
+    schedule = wakeSchedule;
+    if (config.intervalS) schedule.overrideInterval(config.intervalS);
+    defaultS = logIntervalMin * 60UL;
+    startTime = start;
+
+    startSoc = config.startSoc;
+    if (startSoc < 0.0f) startSoc = batteryModel.isValid() ? batteryModel.getSoc() : 1.0f;
+    startSoc = constrain(startSoc, 0.0f, 1.0f);
+
+    result.days = constrain(config.days, (uint16_t)1, (uint16_t)SIM_MAX_DAYS);
+    result.intervalS = schedule.getIntervalS(defaultS);
+    fullMah = BATTERY_CAPACITY_MAH * BatteryModel::capacityFactorAt(config.tempC);
+    result.usableMah = startSoc * fullMah;
+    result.socByDay[0] = (uint8_t)(startSoc * 100.0f + 0.5f);
+
+    wakeCostUs = 0;
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        if (i != PHASE_SD_FLUSH && i != PHASE_SLEEP) wakeCostUs += wakeUs[i];
+    }
+
+    // 120 days in microseconds fit easily in 64 bits
+    endUs = result.days * DAY_US;
+    dayEndUs = DAY_US;
+    sleepFromUs = 0;
+    wake = schedule.nextWake(startTime, defaultS);
+    buffered = 0;
+    lastFlush = startTime;
+    running = true;
+}
+
+bool PowerSimulator::step(uint16_t maxDays) {
+    if (!running) return true;
+    unsigned long stepStart = micros();
+    uint16_t stopDay = min((uint16_t)(day + maxDays), result.days);
+
+    while (day < stopDay) {
+        uint64_t wakeUsAt = (uint64_t)(wake - startTime) * 1000000ULL;
+        uint64_t sleepToUs = min(wakeUsAt, endUs);
+
+        // Sleep up to the wake (or the end of the run), closing each day
+        // on the way
+        while (day < result.days) {
+            uint64_t to = min(sleepToUs, dayEndUs);
+            if (to > sleepFromUs) {
+                dayUs[PHASE_SLEEP] += to - sleepFromUs;
+                sleepFromUs = to;
+            }
+            if (sleepToUs < dayEndUs) break;
+            closeDay();
+            dayEndUs += DAY_US;
+        }
+        if (day >= result.days) break;
+
+        // The wake itself, with a flush when the buffer is full or an hour
+        // has gone by, as in handleScheduledWakeState()
+        uint32_t awakeUs = wakeCostUs;
+        for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+            if (i != PHASE_SD_FLUSH && i != PHASE_SLEEP) dayUs[i] += wakeUs[i];
+        }
+        result.wakes++;
+
+        if (++buffered >= MAX_BUFFERED_READINGS || wake - lastFlush >= SIM_FLUSH_PERIOD_S) {
+            dayUs[PHASE_SD_FLUSH] += wakeUs[PHASE_SD_FLUSH];
+            awakeUs += wakeUs[PHASE_SD_FLUSH];
+            buffered = 0;
+            lastFlush = wake;
+            result.flushes++;
+        }
+
+        // The next wake is planned once this one is over, from the whole
+        // seconds the RTC reads then
+        sleepFromUs = wakeUsAt + awakeUs;
+        uint32_t wakeEnd = wake + awakeUs / 1000000UL;
+        wake = schedule.nextWake(wakeEnd, defaultS);
+    }
+
+    uint32_t stepUs = micros() - stepStart;
+    runUs += stepUs;
+    if (stepUs > result.maxStepUs) result.maxStepUs = stepUs;
+    if (day < result.days) return false;
+
+    result.totalMah = usedMah;
+    result.avgCurrentMa = usedMah / (result.days * 24.0f);
+    result.runMs = (uint32_t)(runUs / 1000);
+    running = false;
+    hasResult = true;
+    return true;
+}
+
+const SimResult& PowerSimulator::run(const SimConfig& config, uint32_t start, uint8_t logIntervalMin) {
+    begin(config, start, logIntervalMin);
+    while (!step(SIM_MAX_DAYS)) {}
+    return result;
+}
+
+// =============================================================================
+// DIAGNOSTICS
+// =============================================================================
+
+void PowerSimulator::printReport() const {
+    if (!hasResult) {
+        Serial.println(F("Power simulation: not run"));
+        return;
+    }
+
+    Serial.println(F("=== POWER SIMULATION ==="));
+    Serial.print(result.days);
+    Serial.print(F(" days every "));
+    Serial.print(result.intervalS);
+    Serial.print(F(" s: "));
+    Serial.print(result.wakes);
+    Serial.print(F(" wakes, "));
+    Serial.print(result.flushes);
+    Serial.print(F(" SD flushes ("));
+    Serial.print(result.measured ? F("measured") : F("default"));
+    Serial.print(F(" phase costs, "));
+    Serial.print(result.runMs);
+    Serial.print(F(" ms, longest step "));
+    Serial.print(result.maxStepUs);
+    Serial.println(F(" us)"));
+
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        Serial.print(F("  "));
+        Serial.print(PhaseProfiler::getPhaseName(i));
+        Serial.print(F(": "));
+        Serial.print(result.phaseMah[i], 1);
+        Serial.print(F(" mAh ("));
+        Serial.print(result.totalMah > 0.0f ? result.phaseMah[i] * 100.0f / result.totalMah : 0.0f, 1);
+        Serial.print(F("%), "));
+        Serial.print(result.phaseHours[i], 1);
+        Serial.println(F(" h"));
+    }
+
+    Serial.print(F("Total: "));
+    Serial.print(result.totalMah, 1);
+    Serial.print(F(" mAh of "));
+    Serial.print(result.usableMah, 0);
+    Serial.print(F(" usable, avg "));
+    Serial.print(result.avgCurrentMa, 3);
+    Serial.println(F(" mA"));
+
+    Serial.print(F("Battery empty: "));
+    if (result.daysToEmpty > 0.0f) {
+        Serial.print(F("day "));
+        Serial.println(result.daysToEmpty, 1);
+    } else {
+        Serial.println(F("not within the run"));
+    }
+
+    Serial.print(F("Charge by day:"));
+    for (uint16_t d = 0; d <= result.days; d += 5) {
+        Serial.print(F(" "));
+        Serial.print(d);
+        Serial.print(F(":"));
+        Serial.print(result.socByDay[d]);
+        Serial.print(F("%"));
+    }
+    Serial.println();
+    Serial.println(F("========================"));
+}
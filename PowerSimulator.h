@@ -0,0 +1,122 @@
+/**
+ * PowerSimulator.h
+ * Field deployment energy projection on a virtual clock
+ *
+ * Replays a deployment of up to SIM_MAX_DAYS days without waiting for
+ * it. Wake times come from the real WakeSchedule. Every wake costs the
+ * phases PhaseProfiler has measured (bench defaults until it has), the
+ * field buffer goes to SD when full or hourly as in the main loop, and
+ * the time between wakes is charged at the sleep current. Phase time is
+ * summed in whole microseconds per day, so 40 days at a 10 s interval
+ * add up without float drift.
+ *
+ * A run is advanced a few simulated days per step() so it can be spread
+ * over BLE updates without holding the application lock for the whole
+ * deployment; run() does every step at once. The result records the
+ * total time spent stepping and the longest single step.
+ *
+ * The battery curve is the state of charge at the end of each day,
+ * starting from the battery model's estimate (or a given charge), with
+ * the usable capacity at the given temperature.
+ *
+ * Hive activity is not simulated: an adaptive interval stays on the
+ * step it is on now.
+ */
+
+#ifndef POWER_SIMULATOR_H
+#define POWER_SIMULATOR_H
+
+#include "Config.h"
+#include "PhaseProfiler.h"
+#include "WakeSchedule.h"
+
+#define SIM_MAX_DAYS 120
+#define SIM_DEFAULT_DAYS 40
+#define SIM_FLUSH_PERIOD_S 3600UL        // As isTimeForBufferFlush()
+#define SIM_DAYS_PER_STEP 1              // Simulated days per step() from a BLE update
+
+struct SimConfig {
+    uint16_t days;
+    uint32_t intervalS;          // 0 = the wake schedule in force
+    float tempC;
+    float startSoc;              // 0..1, negative = the battery model's estimate
+};
+
+struct SimResult {
+    uint16_t days;
+    uint32_t intervalS;
+    uint32_t wakes;
+    uint32_t flushes;
+    float phaseHours[PHASE_COUNT];
+    float phaseMah[PHASE_COUNT];
+    float totalMah;
+    float avgCurrentMa;
+    float usableMah;             // Start charge at the simulated temperature
+    float daysToEmpty;           // 0 if the battery outlasts the run
+    bool measured;               // Phase costs measured rather than defaults
+    uint32_t runMs;              // Time spent stepping, all steps together
+    uint32_t maxStepUs;          // Longest single step()
+    uint8_t socByDay[SIM_MAX_DAYS + 1];   // Percent; [0] is the start
+};
+
+class PowerSimulator {
+private:
+    SimResult result;
+    bool hasResult;
+
+    // One wake's cost per phase; PHASE_SD_FLUSH is per flush
+    uint32_t wakeUs[PHASE_COUNT];
+
+    // Running day
+    uint64_t dayUs[PHASE_COUNT];
+    uint16_t day;
+    float usedMah;
+    float startSoc;
+    float fullMah;               // Full charge at the simulated temperature
+
+    // Run state kept between steps; times in microseconds from startTime
+    bool running;
+    WakeSchedule schedule;       // A copy, so an interval under test is never saved
+    uint32_t startTime;
+    uint32_t defaultS;
+    uint32_t wakeCostUs;
+    uint64_t endUs;
+    uint64_t dayEndUs;
+    uint64_t sleepFromUs;
+    uint32_t wake;
+    uint8_t buffered;
+    uint32_t lastFlush;
+    uint64_t runUs;
+
+    void loadPhaseCosts();
+    void closeDay();
+
+public:
+    PowerSimulator();
+
+    // start is the RTC time to start from, logIntervalMin the log
+    // (or adaptive) interval the schedule falls back on
+    void begin(const SimConfig& config, uint32_t start, uint8_t logIntervalMin);
+
+    // Simulates up to maxDays more days; true once the run is complete
+    bool step(uint16_t maxDays);
+
+    // begin() and every step in one call
+    const SimResult& run(const SimConfig& config, uint32_t start, uint8_t logIntervalMin);
+
+    bool isRunning() const { return running; }
+    uint16_t getDay() const { return day; }
+    uint16_t getDays() const { return result.days; }
+    bool hasRun() const { return hasResult; }
+    uint32_t getNextWake() const { return wake; }   // First wake past the last step
+    const SimResult& getResult() const { return result; }
+
+    void printReport() const;
+
+    // Cost of a phase until PhaseProfiler has timed a wake
+    static uint32_t getDefaultPhaseUs(uint8_t phase);
+};
+
+extern PowerSimulator powerSimulator;
+
+#endif // POWER_SIMULATOR_H
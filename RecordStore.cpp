@@ -0,0 +1,353 @@
+/**
+ * RecordStore.cpp
+ * Sequence-numbered binary record journal implementation
+ */
+
+#include "RecordStore.h"
+#include "Utils.h"
+
+#ifdef HAS_INTERNAL_FS
+  #include <Adafruit_LittleFS.h>
+  #include <InternalFileSystem.h>
+#endif
+
+RecordStore recordStore;
+
+RecordStore::RecordStore() {
+    ready = false;
+    baseSeq = 1;
+    nextSeq = 1;
+    skippedSlots = 0;
+    syncStateLoaded = false;
+    memset(&syncState, 0, sizeof(syncState));
+}
+
+// =============================================================================
+// RECORD ENCODING
+// =============================================================================
+
+static uint16_t recordCheck(const uint8_t* bytes) {
+    return crc32Update(0, bytes, RECORD_CHECKED_BYTES) & 0xFFFF;
+}
+
+void RecordStore::encode(const StoredRecord& record, uint8_t* out) {
+    putU32LE(&out[0], record.seq);
+    putU32LE(&out[4], record.timestamp);
+    putU16LE(&out[8], (uint16_t)(int16_t)lroundf(record.temperature * 100.0f));
+    putU16LE(&out[10], (uint16_t)constrain(lroundf(record.humidity * 100.0f), 0L, 65535L));
+    putU16LE(&out[12], (uint16_t)constrain(lroundf(record.pressure * 10.0f), 0L, 65535L));
+    putU16LE(&out[14], (uint16_t)constrain(lroundf(record.batteryVoltage * 1000.0f), 0L, 65535L));
+    putU16LE(&out[16], record.dominantFreq);
+    out[18] = record.soundLevel;
+    out[19] = record.beeState;
+    out[20] = record.alertFlags;
+    out[21] = record.flags;
+    putU16LE(&out[22], recordCheck(out));
+}
+
+bool RecordStore::decode(const uint8_t* in, StoredRecord& record) {
+    if (getU16LE(&in[22]) != recordCheck(in)) {
+        return false;
+    }
+    record.seq = getU32LE(&in[0]);
+    record.timestamp = getU32LE(&in[4]);
+    record.temperature = (int16_t)getU16LE(&in[8]) / 100.0f;
+    record.humidity = getU16LE(&in[10]) / 100.0f;
+    record.pressure = getU16LE(&in[12]) / 10.0f;
+    record.batteryVoltage = getU16LE(&in[14]) / 1000.0f;
+    record.dominantFreq = getU16LE(&in[16]);
+    record.soundLevel = in[18];
+    record.beeState = in[19];
+    record.alertFlags = in[20];
+    record.flags = in[21];
+    return true;
+}
+
+// =============================================================================
+// JOURNAL FILE
+// =============================================================================
+
+bool RecordStore::createFile(uint32_t firstSeq) {
+    SDLib::File file = SD.open(RECORD_STORE_FILE, FILE_WRITE);
+    if (!file) {
+        return false;
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    memset(header, 0, sizeof(header));
+    putU32LE(&header[0], RECORD_STORE_MAGIC);
+    putU32LE(&header[4], firstSeq);
+    putU16LE(&header[8], RECORD_SIZE);
+    bool ok = file.write(header, sizeof(header)) == sizeof(header);
+    file.close();
+    return ok;
+}
+
+bool RecordStore::begin() {
+    loadSyncState();
+
+    if (!SD.exists(RECORD_STORE_FILE)) {
+        // Never hand out a number a client may already hold
+        uint32_t firstSeq = max(syncState.highestCursor + 1, nextSeq);
+        if (!createFile(firstSeq)) {
+            Serial.println(F("RecordStore: cannot create journal"));
+            return false;
+        }
+        baseSeq = firstSeq;
+        nextSeq = firstSeq;
+        ready = true;
+        Serial.print(F("RecordStore: new journal from seq "));
+        Serial.println(baseSeq);
+        return true;
+    }
+
+    SDLib::File file = SD.open(RECORD_STORE_FILE, FILE_READ);
+    if (!file) {
+        return false;
+    }
+
+    uint8_t header[RECORD_HEADER_SIZE];
+    uint32_t size = file.size();
+    bool valid = file.read(header, sizeof(header)) == sizeof(header) &&
+                 getU32LE(&header[0]) == RECORD_STORE_MAGIC &&
+                 getU16LE(&header[8]) == RECORD_SIZE;
+    file.close();
+
+    if (!valid) {
+        Serial.println(F("RecordStore: journal header invalid, starting a new one"));
+        return SD.remove(RECORD_STORE_FILE) && begin();
+    }
+
+    baseSeq = getU32LE(&header[4]);
+    uint32_t dataBytes = size - RECORD_HEADER_SIZE;
+    uint16_t partial = dataBytes % RECORD_SIZE;
+
+    if (partial != 0) {
+        // Interrupted append: pad the slot so the next record stays aligned.
+        // The padding fails its check and is skipped by readers.
+        SDLib::File pad = SD.open(RECORD_STORE_FILE, FILE_WRITE);
+        if (pad) {
+            uint8_t fill[RECORD_SIZE];
+            memset(fill, 0xFF, sizeof(fill));
+            pad.write(fill, RECORD_SIZE - partial);
+            pad.close();
+            dataBytes += RECORD_SIZE - partial;
+            skippedSlots++;
+        }
+    }
+
+    nextSeq = baseSeq + dataBytes / RECORD_SIZE;
+    ready = true;
+
+    Serial.print(F("RecordStore: seq "));
+    Serial.print(baseSeq);
+    Serial.print(F("-"));
+    Serial.println(nextSeq - 1);
+    return true;
+}
+
+uint32_t RecordStore::append(const SensorData& data, uint32_t timestamp, uint8_t flags) {
+    if (!ready && !begin()) {
+        return 0;
+    }
+
+    StoredRecord record;
+    record.seq = nextSeq;
+    record.timestamp = timestamp;
+    record.temperature = data.temperature;
+    record.humidity = data.humidity;
+    record.pressure = data.pressure;
+    record.batteryVoltage = data.batteryVoltage;
+    record.dominantFreq = data.dominantFreq;
+    record.soundLevel = data.soundLevel;
+    record.beeState = data.beeState;
+    record.alertFlags = data.alertFlags;
+    record.flags = flags | (data.sensorsValid ? RECORD_FLAG_SENSORS_VALID : 0);
+
+    uint8_t bytes[RECORD_SIZE];
+    encode(record, bytes);
+
+    SDLib::File file = SD.open(RECORD_STORE_FILE, FILE_WRITE);
+    if (!file) {
+        ready = false;   // Re-scan once the card is back
+        return 0;
+    }
+    size_t written = file.write(bytes, RECORD_SIZE);
+    file.close();
+
+    if (written != RECORD_SIZE) {
+        ready = false;
+        return 0;
+    }
+    return nextSeq++;
+}
+
+uint32_t RecordStore::getFirstSeq() {
+    if (!ready) begin();
+    return baseSeq;
+}
+
+uint32_t RecordStore::getLastSeq() {
+    if (!ready) begin();
+    return nextSeq - 1;
+}
+
+uint32_t RecordStore::countAfter(uint32_t cursor) {
+    if (!ready && !begin()) return 0;
+    uint32_t first = max(cursor + 1, baseSeq);
+    return (first < nextSeq) ? nextSeq - first : 0;
+}
+
+uint32_t RecordStore::offsetOf(uint32_t seq) const {
+    return RECORD_HEADER_SIZE + (seq - baseSeq) * RECORD_SIZE;
+}
+
+bool RecordStore::openAfter(SDLib::File& file, uint32_t cursor) {
+    if (!ready && !begin()) return false;
+
+    file = SD.open(RECORD_STORE_FILE, FILE_READ);
+    if (!file) return false;
+
+    uint32_t first = max(cursor + 1, baseSeq);
+    return file.seek(offsetOf(min(first, nextSeq)));
+}
+
+uint32_t RecordStore::findTime(SDLib::File& file, uint32_t time) {
+    uint32_t lo = baseSeq;
+    uint32_t hi = nextSeq;
+    uint8_t bytes[RECORD_SIZE];
+    StoredRecord record;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+
+        // Padded slots carry no time; use the next valid record instead
+        uint32_t probe = mid;
+        bool found = false;
+        for (; probe < hi; probe++) {
+            if (file.seek(offsetOf(probe)) && file.read(bytes, RECORD_SIZE) == RECORD_SIZE &&
+                decode(bytes, record)) {
+                found = true;
+                break;
+            }
+        }
+
+        if (found && record.timestamp < time) {
+            lo = probe + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// =============================================================================
+// PER-CLIENT CURSORS
+// =============================================================================
+
+uint16_t RecordStore::syncStateChecksum() const {
+    return crc32Update(0, (const uint8_t*)&syncState, offsetof(SyncState, checksum)) & 0xFFFF;
+}
+
+void RecordStore::loadSyncState() {
+    if (syncStateLoaded) return;
+    syncStateLoaded = true;
+
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+    Adafruit_LittleFS_Namespace::File stateFile(InternalFS);
+    if (stateFile.open(SYNC_STATE_FILE, Adafruit_LittleFS_Namespace::FILE_O_READ)) {
+        size_t got = stateFile.read((uint8_t*)&syncState, sizeof(syncState));
+        stateFile.close();
+        if (got == sizeof(syncState) && syncState.magic == SYNC_STATE_MAGIC &&
+            syncState.checksum == syncStateChecksum()) {
+            return;
+        }
+        Serial.println(F("Sync state corrupted - clients will resync"));
+    }
+#endif
+
+    memset(&syncState, 0, sizeof(syncState));
+    syncState.magic = SYNC_STATE_MAGIC;
+}
+
+bool RecordStore::saveSyncState() {
+    syncState.checksum = syncStateChecksum();
+
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+    InternalFS.remove(SYNC_STATE_FILE);   // Write mode appends; start clean
+    Adafruit_LittleFS_Namespace::File stateFile(InternalFS);
+    if (!stateFile.open(SYNC_STATE_FILE, Adafruit_LittleFS_Namespace::FILE_O_WRITE)) {
+        Serial.println(F("Failed to save sync state"));
+        return false;
+    }
+    size_t written = stateFile.write((const uint8_t*)&syncState, sizeof(syncState));
+    stateFile.close();
+    return written == sizeof(syncState);
+#else
+    return true;
+#endif
+}
+
+int8_t RecordStore::findClient(const uint8_t* clientId) const {
+    for (uint8_t i = 0; i < SYNC_MAX_CLIENTS; i++) {
+        if (memcmp(syncState.clients[i].clientId, clientId, SYNC_CLIENT_ID_LEN) == 0) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+uint32_t RecordStore::getClientCursor(const uint8_t* clientId) {
+    loadSyncState();
+    int8_t slot = findClient(clientId);
+    return slot >= 0 ? syncState.clients[slot].cursor : 0;
+}
+
+bool RecordStore::commitClientCursor(const uint8_t* clientId, uint32_t cursor, uint32_t now) {
+    loadSyncState();
+    if (cursor > getLastSeq()) {
+        return false;
+    }
+
+    int8_t slot = findClient(clientId);
+    if (slot < 0) {
+        // New client takes the least recently synced slot
+        slot = 0;
+        for (uint8_t i = 1; i < SYNC_MAX_CLIENTS; i++) {
+            if (syncState.clients[i].lastSyncTime < syncState.clients[slot].lastSyncTime) {
+                slot = i;
+            }
+        }
+        memcpy(syncState.clients[slot].clientId, clientId, SYNC_CLIENT_ID_LEN);
+    }
+
+    syncState.clients[slot].cursor = cursor;
+    syncState.clients[slot].lastSyncTime = now;
+    syncState.highestCursor = max(syncState.highestCursor, cursor);
+    return saveSyncState();
+}
+
+void RecordStore::printStatus() {
+    Serial.println(F("\n=== Record Store ==="));
+    if (!ready && !begin()) {
+        Serial.println(F("Journal unavailable"));
+        Serial.println(F("====================\n"));
+        return;
+    }
+    Serial.print(F("Seq range: ")); Serial.print(baseSeq);
+    Serial.print(F("-")); Serial.println(nextSeq - 1);
+    Serial.print(F("Padded slots: ")); Serial.println(skippedSlots);
+    for (uint8_t i = 0; i < SYNC_MAX_CLIENTS; i++) {
+        if (syncState.clients[i].lastSyncTime == 0) continue;
+        Serial.print(F("Client "));
+        for (uint8_t b = 0; b < SYNC_CLIENT_ID_LEN; b++) {
+            if (syncState.clients[i].clientId[b] < 0x10) Serial.print('0');
+            Serial.print(syncState.clients[i].clientId[b], HEX);
+        }
+        Serial.print(F(": cursor "));
+        Serial.println(syncState.clients[i].cursor);
+    }
+    Serial.println(F("====================\n"));
+}
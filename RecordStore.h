@@ -0,0 +1,129 @@
+/**
+ * RecordStore.h
+ * Sequence-numbered binary record journal for incremental BLE sync
+ *
+ * Every logged reading is also appended to RECORD_STORE_FILE on the SD
+ * card as a fixed-size record. Sequence numbers are implied by position
+ * (seq = baseSeq + index), so finding "everything after cursor N" is a
+ * single seek. A cursor is the last sequence number a client holds;
+ * 0 means "nothing yet".
+ *
+ * File header (16 bytes): [magic u32][baseSeq u32][recordSize u16][reserved 6]
+ * Record (24 bytes)     : [seq u32][time u32][temp i16 x100][humidity u16 x100]
+ *                         [pressure u16 x10][battery u16 mV][freq u16][level u8]
+ *                         [beeState u8][alertFlags u8][flags u8][check u16]
+ *
+ * check is the low 16 bits of the CRC32 of the first 22 bytes. A slot
+ * left half-written by a power loss is padded out at the next boot and
+ * fails the check, so readers skip it without renumbering anything.
+ *
+ * Per-client cursors are kept in internal flash so several phones can
+ * sync independently. They only move on an explicit commit from the
+ * client, which makes an interrupted sync safe to simply restart.
+ */
+
+#ifndef RECORD_STORE_H
+#define RECORD_STORE_H
+
+#include "Config.h"
+#include "DataStructures.h"
+
+// =============================================================================
+// RECORD STORE CONFIGURATION
+// =============================================================================
+
+#define RECORD_STORE_FILE "/RECORDS.BIN"
+#define RECORD_STORE_MAGIC 0x31524748UL      // "HGR1"
+#define RECORD_HEADER_SIZE 16
+#define RECORD_SIZE 24
+#define RECORD_CHECKED_BYTES 22
+
+#define RECORD_FLAG_SENSORS_VALID 0x01
+#define RECORD_FLAG_FIELD_MODE 0x02
+
+#define SYNC_STATE_FILE "/sync.dat"
+#define SYNC_STATE_MAGIC 0x53594E43UL        // "SYNC"
+#define SYNC_MAX_CLIENTS 4
+#define SYNC_CLIENT_ID_LEN 8
+#define SYNC_CURSOR_STORED 0xFFFFFFFFUL      // Sync request: resume from the committed cursor
+
+struct StoredRecord {
+    uint32_t seq;
+    uint32_t timestamp;
+    float temperature;
+    float humidity;
+    float pressure;
+    float batteryVoltage;
+    uint16_t dominantFreq;
+    uint8_t soundLevel;
+    uint8_t beeState;
+    uint8_t alertFlags;
+    uint8_t flags;
+};
+
+struct SyncClientCursor {
+    uint8_t clientId[SYNC_CLIENT_ID_LEN];
+    uint32_t cursor;
+    uint32_t lastSyncTime;         // RTC time of the last commit
+};
+
+struct SyncState {
+    uint32_t magic;
+    uint32_t highestCursor;        // Keeps numbering monotonic if the journal is deleted
+    SyncClientCursor clients[SYNC_MAX_CLIENTS];
+    uint16_t checksum;
+};
+
+// =============================================================================
+// RECORD STORE CLASS
+// =============================================================================
+
+class RecordStore {
+private:
+    bool ready;
+    uint32_t baseSeq;
+    uint32_t nextSeq;
+    uint32_t skippedSlots;         // Padded slots found at startup
+    SyncState syncState;
+    bool syncStateLoaded;
+
+    bool begin();
+    bool createFile(uint32_t firstSeq);
+    void loadSyncState();
+    bool saveSyncState();
+    uint16_t syncStateChecksum() const;
+    int8_t findClient(const uint8_t* clientId) const;
+
+public:
+    RecordStore();
+
+    // Appends one reading; returns its sequence number, or 0 on failure
+    uint32_t append(const SensorData& data, uint32_t timestamp, uint8_t flags = 0);
+
+    uint32_t getFirstSeq();
+    uint32_t getLastSeq();
+    uint32_t countAfter(uint32_t cursor);
+
+    // Opens the journal positioned at the first record after cursor
+    bool openAfter(SDLib::File& file, uint32_t cursor);
+    uint32_t offsetOf(uint32_t seq) const;
+
+    // Binary search over the fixed-size slots for the first record at or
+    // after time. Assumes appends are in time order; records stamped 0
+    // (RTC down) sort as oldest. file must be the open journal.
+    uint32_t findTime(SDLib::File& file, uint32_t time);
+
+    static void encode(const StoredRecord& record, uint8_t* out);
+    static bool decode(const uint8_t* in, StoredRecord& record);
+
+    // Per-client cursors
+    uint32_t getClientCursor(const uint8_t* clientId);
+    bool commitClientCursor(const uint8_t* clientId, uint32_t cursor, uint32_t now);
+
+    void invalidate() { ready = false; }
+    void printStatus();
+};
+
+extern RecordStore recordStore;
+
+#endif // RECORD_STORE_H
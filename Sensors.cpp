@@ -4,13 +4,38 @@
  */
 
 #include "Sensors.h"
+#include "BatteryModel.h"
+#include "Audio.h"
+#include "PhaseProfiler.h"
+
+// BME280 registers used for the split forced conversion
+#define BME280_REG_STATUS 0xF3
+#define BME280_REG_CTRL_MEAS 0xF4
+#define BME280_STATUS_MEASURING 0x08
+#define BME280_MODE_MASK 0x03
+#define BME280_MODE_FORCED 0x01
+#define BME280_CONVERSION_TIMEOUT_MS 50   // X2/X2/X2 takes 16 ms at most
+
+// Microphone capture of a scheduled wake, while the BME280 converts
+#define WAKE_AUDIO_BLOCKS 50
+#define WAKE_AUDIO_BLOCK_MS 10
+
+static uint8_t bmeAddress = 0;
+static bool bmeConversionPending = false;
 
 // =============================================================================
 // SENSOR INITIALIZATION
 // =============================================================================
 void initializeSensors(Adafruit_BME280& bme, SystemStatus& status) {
     // Initialize BME280 (handles temp, humidity, AND pressure)
-    if (bme.begin(0x77) || bme.begin(0x76)) {
+    bmeAddress = 0;
+    if (bme.begin(0x77)) {
+        bmeAddress = 0x77;
+    } else if (bme.begin(0x76)) {
+        bmeAddress = 0x76;
+    }
+    
+    if (bmeAddress) {
         status.bmeWorking = true;
         
         // Configure BME280 for forced mode (power efficient)
@@ -28,27 +53,55 @@ void initializeSensors(Adafruit_BME280& bme, SystemStatus& status) {
     }
 }
 
-void readAllSensors(Adafruit_BME280& bme, SensorData& data, 
-                    SystemSettings& settings, SystemStatus& status) {
+// =============================================================================
+// SENSOR ACQUISITION
+// =============================================================================
 
+static uint8_t readBmeRegister(uint8_t reg) {
+    Wire.beginTransmission(bmeAddress);
+    Wire.write(reg);
+    Wire.endTransmission();
+    
+    Wire.requestFrom((int)bmeAddress, 1);
+    return Wire.available() ? Wire.read() : 0xFF;
+}
 
-    // Add 200ms stabilization delay for sensors after wake-up
-    static unsigned long lastReading = 0;
-    unsigned long currentTime = millis();
-    if (currentTime - lastReading < 200) {
-        delay(200 - (currentTime - lastReading));
+// Starts a forced conversion without waiting for it; the sampling set up
+// by initializeSensors() stays in ctrl_meas and ctrl_hum
+static bool triggerBmeConversion() {
+    uint8_t ctrlMeas = readBmeRegister(BME280_REG_CTRL_MEAS);
+    if (ctrlMeas == 0xFF) return false;
+    
+    Wire.beginTransmission(bmeAddress);
+    Wire.write(BME280_REG_CTRL_MEAS);
+    Wire.write((ctrlMeas & ~BME280_MODE_MASK) | BME280_MODE_FORCED);
+    return Wire.endTransmission() == 0;
+}
+
+static bool waitBmeConversion() {
+    unsigned long start = millis();
+    while (readBmeRegister(BME280_REG_STATUS) & BME280_STATUS_MEASURING) {
+        if (millis() - start >= BME280_CONVERSION_TIMEOUT_MS) return false;
+        delay(1);
     }
-    lastReading = millis();
+    return true;
+}
 
-    // Read battery first
+void beginSensorAcquisition(SensorData& data, SystemStatus& status) {
+    // The SAADC is shared with the microphone, so the battery is sampled
+    // now rather than alongside the audio capture
     readBattery(data);
     
-    // Read BME280 - trigger forced measurement
-    if (status.bmeWorking) {
-        // In forced mode, we need to trigger a measurement
-        bme.takeForcedMeasurement();
-        
-        // Now read the results
+    bmeConversionPending = status.bmeWorking && triggerBmeConversion();
+}
+
+void finishSensorAcquisition(Adafruit_BME280& bme, SensorData& data,
+                             SystemSettings& settings, SystemStatus& status) {
+    bool converted = bmeConversionPending && waitBmeConversion();
+    bmeConversionPending = false;
+    
+    if (converted) {
+        // Results of the conversion started in beginSensorAcquisition()
         float temp = bme.readTemperature();
         float humidity = bme.readHumidity();
         float pressure = bme.readPressure() / 100.0;  // Convert to hPa
@@ -69,6 +122,31 @@ void readAllSensors(Adafruit_BME280& bme, SensorData& data,
     }
 }
 
+void readAllSensors(Adafruit_BME280& bme, SensorData& data, 
+                    SystemSettings& settings, SystemStatus& status) {
+    beginSensorAcquisition(data, status);
+    finishSensorAcquisition(bme, data, settings, status);
+}
+
+void acquireWakeReading(Adafruit_BME280& bme, SensorData& data,
+                        SystemSettings& settings, SystemStatus& status) {
+    phaseProfiler.begin(PHASE_SENSORS);
+    beginSensorAcquisition(data, status);
+    
+    // Without a microphone nothing runs in between, and finish waits
+    // out the conversion
+    if (status.pdmWorking) {
+        phaseProfiler.begin(PHASE_AUDIO_CAPTURE);
+        for (int i = 0; i < WAKE_AUDIO_BLOCKS; i++) {
+            processAudio(data, settings);
+            delay(WAKE_AUDIO_BLOCK_MS);
+        }
+        phaseProfiler.begin(PHASE_SENSORS);
+    }
+    
+    finishSensorAcquisition(bme, data, settings, status);
+}
+
 
 // =============================================================================
 // BATTERY MONITORING
@@ -94,32 +172,9 @@ void readBattery(SensorData& data) {
 // =============================================================================
 
 int getBatteryLevel(float voltage) {
-    // USB power
-    if (voltage >= BATTERY_USB_THRESHOLD) {
-        return 100;
-    }
-    // Battery levels
-    else if (voltage >= BATTERY_FULL) {
-        return 100;
-    }
-    else if (voltage >= BATTERY_HIGH) {
-        return 80;
-    }
-    else if (voltage >= 3.8) {
-        return 60;
-    }
-    else if (voltage >= BATTERY_MED) {
-        return 40;
-    }
-    else if (voltage >= BATTERY_LOW) {
-        return 20;
-    }
-    else if (voltage >= BATTERY_CRITICAL) {
-        return 10;
-    }
-    else {
-        return 0;
-    }
+    // Filtered state of charge once the model has a reading, otherwise
+    // the discharge curve; 100 on USB power
+    return batteryModel.getLevel(voltage);
 }
 
 // =============================================================================
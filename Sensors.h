@@ -9,6 +9,19 @@
 void initializeSensors(Adafruit_BME280& bme, SystemStatus& status);
 void readAllSensors(Adafruit_BME280& bme, SensorData& data, 
                     SystemSettings& settings, SystemStatus& status);
+
+// readAllSensors() in two halves, so other work can run while the BME280
+// converts: begin samples the battery and starts a forced conversion,
+// finish waits for it (if still running) and applies the calibration
+void beginSensorAcquisition(SensorData& data, SystemStatus& status);
+void finishSensorAcquisition(Adafruit_BME280& bme, SensorData& data,
+                             SystemSettings& settings, SystemStatus& status);
+
+// The reading of a scheduled wake: the microphone is captured while the
+// BME280 converts (when there is one), timed as PHASE_SENSORS and
+// PHASE_AUDIO_CAPTURE in an open profiler cycle
+void acquireWakeReading(Adafruit_BME280& bme, SensorData& data,
+                        SystemSettings& settings, SystemStatus& status);
 void runSensorDiagnostics(Adafruit_BME280& bme, SystemStatus& status);
 
 void readBattery(SensorData& data);
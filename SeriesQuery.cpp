@@ -0,0 +1,154 @@
+/**
+ * SeriesQuery.cpp
+ * Time-bucketed aggregate implementation
+ */
+
+#include "SeriesQuery.h"
+#include "Utils.h"
+
+// =============================================================================
+// QUERY SHAPE
+// =============================================================================
+
+bool validateSeriesQuery(const SeriesQuery& query) {
+    if (query.toTime <= query.fromTime) return false;
+    if (query.bucketSeconds < SERIES_MIN_BUCKET_SECONDS) return false;
+    if ((query.fieldMask & ((1 << SERIES_FIELD_COUNT) - 1)) == 0 && !(query.aggMask & SERIES_AGG_COUNT)) return false;
+    if ((query.aggMask & (SERIES_AGG_MIN | SERIES_AGG_MAX | SERIES_AGG_MEAN | SERIES_AGG_COUNT)) == 0) return false;
+    return seriesBucketCount(query) <= SERIES_MAX_BUCKETS;
+}
+
+uint32_t seriesBucketCount(const SeriesQuery& query) {
+    if (query.bucketSeconds == 0 || query.toTime <= query.fromTime) return 0;
+    return (query.toTime - query.fromTime + query.bucketSeconds - 1) / query.bucketSeconds;
+}
+
+uint8_t seriesBucketSize(const SeriesQuery& query) {
+    uint8_t perField = 0;
+    if (query.aggMask & SERIES_AGG_MIN) perField += 2;
+    if (query.aggMask & SERIES_AGG_MAX) perField += 2;
+    if (query.aggMask & SERIES_AGG_MEAN) perField += 2;
+
+    uint8_t fields = 0;
+    for (uint8_t i = 0; i < SERIES_FIELD_COUNT; i++) {
+        if (query.fieldMask & (1 << i)) fields++;
+    }
+    return 2 + ((query.aggMask & SERIES_AGG_COUNT) ? 2 : 0) + fields * perField;
+}
+
+int32_t seriesFieldValue(const StoredRecord& record, uint8_t field) {
+    switch (field) {
+        case SERIES_FIELD_TEMPERATURE: return lroundf(record.temperature * 100.0f);
+        case SERIES_FIELD_HUMIDITY:    return lroundf(record.humidity * 100.0f);
+        case SERIES_FIELD_PRESSURE:    return lroundf(record.pressure * 10.0f);
+        case SERIES_FIELD_BATTERY:     return lroundf(record.batteryVoltage * 1000.0f);
+        case SERIES_FIELD_FREQUENCY:   return record.dominantFreq;
+        case SERIES_FIELD_SOUND_LEVEL: return record.soundLevel;
+        default:                       return 0;
+    }
+}
+
+// =============================================================================
+// AGGREGATOR
+// =============================================================================
+
+SeriesAggregator::SeriesAggregator() {
+    memset(&query, 0, sizeof(query));
+    memset(&current, 0, sizeof(current));
+    open = false;
+    recordsUsed = 0;
+}
+
+void SeriesAggregator::begin(const SeriesQuery& q) {
+    query = q;
+    open = false;
+    recordsUsed = 0;
+}
+
+void SeriesAggregator::startBucket(uint16_t index, const StoredRecord& record) {
+    current.index = index;
+    current.count = 0;
+    for (uint8_t i = 0; i < SERIES_FIELD_COUNT; i++) {
+        int32_t v = seriesFieldValue(record, 1 << i);
+        current.minValue[i] = v;
+        current.maxValue[i] = v;
+        current.sum[i] = 0;
+    }
+    open = true;
+}
+
+bool SeriesAggregator::add(const StoredRecord& record, SeriesBucket& closed) {
+    if (record.timestamp < query.fromTime || record.timestamp >= query.toTime) {
+        return false;
+    }
+    if (!(record.flags & RECORD_FLAG_SENSORS_VALID)) {
+        return false;
+    }
+
+    uint16_t index = (record.timestamp - query.fromTime) / query.bucketSeconds;
+    bool didClose = false;
+
+    if (open && index < current.index) {
+        return false;   // Clock stepped back; that bucket has already gone out
+    }
+    if (open && index != current.index) {
+        closed = current;
+        didClose = true;
+        open = false;
+    }
+    if (!open) {
+        startBucket(index, record);
+    }
+
+    for (uint8_t i = 0; i < SERIES_FIELD_COUNT; i++) {
+        int32_t v = seriesFieldValue(record, 1 << i);
+        current.minValue[i] = min(current.minValue[i], v);
+        current.maxValue[i] = max(current.maxValue[i], v);
+        current.sum[i] += v;
+    }
+    current.count++;
+    recordsUsed++;
+    return didClose;
+}
+
+bool SeriesAggregator::finish(SeriesBucket& closed) {
+    if (!open) return false;
+    closed = current;
+    open = false;
+    return true;
+}
+
+static inline void putI16Clamped(uint8_t* p, int32_t value) {
+    putU16LE(p, (uint16_t)(int16_t)constrain(value, -32768L, 32767L));
+}
+
+uint8_t SeriesAggregator::encode(const SeriesBucket& bucket, uint8_t* out) const {
+    uint8_t pos = 0;
+    putU16LE(&out[pos], bucket.index);
+    pos += 2;
+    if (query.aggMask & SERIES_AGG_COUNT) {
+        putU16LE(&out[pos], (uint16_t)min(bucket.count, (uint32_t)0xFFFF));
+        pos += 2;
+    }
+
+    for (uint8_t i = 0; i < SERIES_FIELD_COUNT; i++) {
+        if (!(query.fieldMask & (1 << i))) continue;
+
+        if (query.aggMask & SERIES_AGG_MIN) {
+            putI16Clamped(&out[pos], bucket.minValue[i]);
+            pos += 2;
+        }
+        if (query.aggMask & SERIES_AGG_MAX) {
+            putI16Clamped(&out[pos], bucket.maxValue[i]);
+            pos += 2;
+        }
+        if (query.aggMask & SERIES_AGG_MEAN) {
+            int64_t sum = bucket.sum[i];
+            int64_t n = bucket.count;
+            int64_t mean = n ? (sum >= 0 ? (sum + n / 2) / n : (sum - n / 2) / n) : 0;
+            putI16Clamped(&out[pos], (int32_t)mean);
+            pos += 2;
+        }
+    }
+    return pos;
+}
@@ -0,0 +1,93 @@
+/**
+ * SeriesQuery.h
+ * Time-bucketed aggregates over the record journal
+ *
+ * A query names a time range, a bucket width, a set of fields and a set
+ * of aggregates. Records are folded into buckets as they are read, so
+ * only the open bucket is held in memory whatever the range.
+ *
+ * Encoded bucket (little-endian, size from seriesBucketSize()):
+ *   [index u16][count u16 if SERIES_AGG_COUNT]
+ *   then for each field bit set, lowest first:
+ *   [min i16 if MIN][max i16 if MAX][mean i16 if MEAN]
+ *
+ * index is (bucket start - fromTime) / bucketSeconds. Buckets without
+ * records are not sent. Values use the journal's fixed-point units:
+ * temperature and humidity x100, pressure x10, battery mV, frequency Hz,
+ * sound level 0-100.
+ */
+
+#ifndef SERIES_QUERY_H
+#define SERIES_QUERY_H
+
+#include "Config.h"
+#include "RecordStore.h"
+
+#define SERIES_FIELD_TEMPERATURE 0x01
+#define SERIES_FIELD_HUMIDITY 0x02
+#define SERIES_FIELD_PRESSURE 0x04
+#define SERIES_FIELD_BATTERY 0x08
+#define SERIES_FIELD_FREQUENCY 0x10
+#define SERIES_FIELD_SOUND_LEVEL 0x20
+#define SERIES_FIELD_COUNT 6
+
+#define SERIES_AGG_MIN 0x01
+#define SERIES_AGG_MAX 0x02
+#define SERIES_AGG_MEAN 0x04
+#define SERIES_AGG_COUNT 0x08
+
+#define SERIES_MAX_BUCKETS 65535
+#define SERIES_MIN_BUCKET_SECONDS 60
+
+struct SeriesQuery {
+    uint32_t fromTime;            // Inclusive
+    uint32_t toTime;              // Exclusive
+    uint32_t bucketSeconds;
+    uint8_t fieldMask;            // SERIES_FIELD_* bits
+    uint8_t aggMask;              // SERIES_AGG_* bits
+};
+
+struct SeriesBucket {
+    uint16_t index;
+    uint32_t count;
+    int32_t minValue[SERIES_FIELD_COUNT];
+    int32_t maxValue[SERIES_FIELD_COUNT];
+    int64_t sum[SERIES_FIELD_COUNT];
+};
+
+// False if the range, bucket width or masks cannot be answered
+bool validateSeriesQuery(const SeriesQuery& query);
+uint32_t seriesBucketCount(const SeriesQuery& query);
+uint8_t seriesBucketSize(const SeriesQuery& query);
+
+// Journal value of one SERIES_FIELD_* field in fixed-point units
+int32_t seriesFieldValue(const StoredRecord& record, uint8_t field);
+
+class SeriesAggregator {
+private:
+    SeriesQuery query;
+    SeriesBucket current;
+    bool open;
+    uint32_t recordsUsed;
+
+    void startBucket(uint16_t index, const StoredRecord& record);
+
+public:
+    SeriesAggregator();
+
+    void begin(const SeriesQuery& query);
+
+    // Folds one record in. Returns true when it closed the previous
+    // bucket, which is then copied to closed. Records outside the range
+    // or older than the open bucket are ignored.
+    bool add(const StoredRecord& record, SeriesBucket& closed);
+
+    // Hands out the last open bucket, if any
+    bool finish(SeriesBucket& closed);
+
+    uint8_t encode(const SeriesBucket& bucket, uint8_t* out) const;
+    uint32_t getRecordsUsed() const { return recordsUsed; }
+    const SeriesQuery& getQuery() const { return query; }
+};
+
+#endif // SERIES_QUERY_H
@@ -5,8 +5,9 @@
 
 #include "Settings.h"
 #include "Utils.h"  // For button functions
+#include "AlertHistory.h"
 
-#ifdef NRF52_SERIES
+#ifdef HAS_INTERNAL_FS
   // Use namespace to avoid ambiguity
   using namespace Adafruit_LittleFS_Namespace;
   // Don't create global file object - we'll create it locally in functions
@@ -49,8 +50,9 @@ uint16_t calculateChecksum(SystemSettings* s) {
     uint16_t sum = 0;
     uint8_t* data = (uint8_t*)s;
     
-    // Calculate checksum for all data except the checksum field itself
-    for (size_t i = 0; i < sizeof(SystemSettings) - sizeof(uint16_t); i++) {
+    // Calculate checksum for all data before the checksum field; the
+    // struct has tail padding, so sizeof minus the field would cover it
+    for (size_t i = 0; i < offsetof(SystemSettings, checksum); i++) {
         sum += data[i];
     }
     
@@ -62,7 +64,7 @@ uint16_t calculateChecksum(SystemSettings* s) {
 // =============================================================================
 
 void loadSettings(SystemSettings& settings) {
-#ifdef NRF52_SERIES
+#ifdef HAS_INTERNAL_FS
     // Initialize internal file system
     InternalFS.begin();
     
@@ -117,7 +119,7 @@ void saveSettings(SystemSettings& settings) {
     Serial.print(F("Checksum calculated: 0x"));
     Serial.println(settings.checksum, HEX);
     
-#ifdef NRF52_SERIES
+#ifdef HAS_INTERNAL_FS
     // Make sure file system is initialized
     InternalFS.begin();
     
@@ -126,6 +128,10 @@ void saveSettings(SystemSettings& settings) {
     
     Serial.println(F("Opening /settings.dat for writing..."));
     
+    // Write mode appends to an existing file, and load reads from the
+    // start, so the old record has to go first
+    InternalFS.remove("/settings.dat");
+    
     // Use the proper Adafruit LittleFS API
     if (settingsFile.open("/settings.dat", FILE_O_WRITE)) {
         Serial.println(F("Settings file opened successfully"));
@@ -170,7 +176,7 @@ void saveSettings(SystemSettings& settings) {
         }
     }
 #else
-    Serial.println(F("Settings saved (in RAM only - not nRF52 platform)"));
+    Serial.println(F("Settings saved (in RAM only - no internal flash)"));
 #endif
 }
 
@@ -234,6 +240,203 @@ void validateSettings(SystemSettings& settings) {
     }
 }
 
+// =============================================================================
+// SETTINGS IMAGE
+// =============================================================================
+
+// Encoded width of each setting id, index 0 unused
+static const uint8_t settingWidths[SETTING_ID_COUNT + 1] = {
+    0, 4, 4, 1, 2, 2, 2, 2, 1, 1, 1, 4, 4, 4, 4, 1
+};
+
+// Accepted range of each setting id, index 0 unused. Values are clamped in
+// float before any integer cast, so an out-of-range float never converts
+struct SettingRange {
+    float lo;
+    float hi;
+    bool integral;
+};
+
+static const SettingRange settingRanges[SETTING_ID_COUNT + 1] = {
+    {   0.0f,    0.0f, false },
+    { -10.0f,   10.0f, false },   // Temperature offset
+    { -20.0f,   20.0f, false },   // Humidity offset
+    {   0.0f,   10.0f, true  },   // Audio sensitivity
+    {  50.0f, 1000.0f, true  },   // Queen freq min
+    {  50.0f, 1000.0f, true  },   // Queen freq max
+    {  50.0f, 1000.0f, true  },   // Swarm freq min
+    {  50.0f, 1000.0f, true  },   // Swarm freq max
+    {   5.0f,   60.0f, true  },   // Log interval: 5, 10, 30 or 60
+    {   1.0f,   30.0f, true  },   // Display timeout
+    {   0.0f,    1.0f, true  },   // Field mode
+    { -10.0f,   40.0f, false },   // Temperature min threshold
+    {   0.0f,   60.0f, false },   // Temperature max threshold
+    {   0.0f,   90.0f, false },   // Humidity min threshold
+    {  20.0f,  100.0f, false },   // Humidity max threshold
+    {   0.0f,  100.0f, true  }    // Stress threshold
+};
+
+bool isSettingValueValid(uint8_t settingId, float value) {
+    if (settingId < 1 || settingId > SETTING_ID_COUNT || value != value) return false;
+
+    const SettingRange& r = settingRanges[settingId];
+    if (value < r.lo || value > r.hi) return false;
+    if (r.integral && value != (float)(long)value) return false;
+    if (settingId == 8) {
+        uint8_t interval = (uint8_t)value;
+        return interval == 5 || interval == 10 || interval == 30 || interval == 60;
+    }
+    return true;
+}
+
+bool applySettingValue(SystemSettings& settings, uint8_t settingId, float value) {
+    if (settingId < 1 || settingId > SETTING_ID_COUNT || value != value) return false;
+    if (settingId != 10) {
+        value = constrain(value, settingRanges[settingId].lo, settingRanges[settingId].hi);
+    }
+
+    switch (settingId) {
+        case 1: // Temperature offset
+            settings.tempOffset = value;
+            break;
+        case 2: // Humidity offset
+            settings.humidityOffset = value;
+            break;
+        case 3: // Audio sensitivity
+            settings.audioSensitivity = (uint8_t)value;
+            break;
+        case 4: // Queen freq min
+            settings.queenFreqMin = (uint16_t)value;
+            break;
+        case 5: // Queen freq max
+            settings.queenFreqMax = (uint16_t)value;
+            break;
+        case 6: // Swarm freq min
+            settings.swarmFreqMin = (uint16_t)value;
+            break;
+        case 7: // Swarm freq max
+            settings.swarmFreqMax = (uint16_t)value;
+            break;
+        case 8: // Log interval
+            {
+                uint8_t interval = (uint8_t)value;
+                if (interval != 5 && interval != 10 && interval != 30 && interval != 60) {
+                    return false;
+                }
+                settings.logInterval = interval;
+            }
+            break;
+        case 9: // Display timeout
+            settings.displayTimeoutMin = (uint8_t)value;
+            break;
+        case 10: // Field mode
+            settings.fieldModeEnabled = (value > 0);
+            break;
+        case 11: // Temperature min threshold
+            settings.tempMin = value;
+            break;
+        case 12: // Temperature max threshold
+            settings.tempMax = value;
+            break;
+        case 13: // Humidity min threshold
+            settings.humidityMin = value;
+            break;
+        case 14: // Humidity max threshold
+            settings.humidityMax = value;
+            break;
+        case 15: // Stress threshold
+            settings.stressThreshold = (uint8_t)value;
+            break;
+        default:
+            return false;
+    }
+    return true;
+}
+
+float getSettingValue(const SystemSettings& settings, uint8_t settingId) {
+    switch (settingId) {
+        case 1:  return settings.tempOffset;
+        case 2:  return settings.humidityOffset;
+        case 3:  return settings.audioSensitivity;
+        case 4:  return settings.queenFreqMin;
+        case 5:  return settings.queenFreqMax;
+        case 6:  return settings.swarmFreqMin;
+        case 7:  return settings.swarmFreqMax;
+        case 8:  return settings.logInterval;
+        case 9:  return settings.displayTimeoutMin;
+        case 10: return settings.fieldModeEnabled ? 1 : 0;
+        case 11: return settings.tempMin;
+        case 12: return settings.tempMax;
+        case 13: return settings.humidityMin;
+        case 14: return settings.humidityMax;
+        case 15: return settings.stressThreshold;
+        default: return 0;
+    }
+}
+
+uint8_t encodeSettingsImage(const SystemSettings& settings, uint8_t* out) {
+    uint8_t pos = 0;
+    out[pos++] = SETTINGS_IMAGE_VERSION;
+
+    for (uint8_t id = 1; id <= SETTING_ID_COUNT; id++) {
+        float value = getSettingValue(settings, id);
+        switch (settingWidths[id]) {
+            case 4: {
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                putU32LE(&out[pos], bits);
+                break;
+            }
+            case 2:
+                putU16LE(&out[pos], (uint16_t)value);
+                break;
+            default:
+                out[pos] = (uint8_t)value;
+                break;
+        }
+        pos += settingWidths[id];
+    }
+    return pos;
+}
+
+bool decodeSettingsImage(const uint8_t* in, uint16_t len, SystemSettings& settings, uint8_t& badId) {
+    badId = 0;
+    if (len < SETTINGS_IMAGE_SIZE || in[0] != SETTINGS_IMAGE_VERSION) {
+        return false;
+    }
+
+    uint8_t pos = 1;
+    for (uint8_t id = 1; id <= SETTING_ID_COUNT; id++) {
+        float value;
+        switch (settingWidths[id]) {
+            case 4: {
+                uint32_t bits = getU32LE(&in[pos]);
+                memcpy(&value, &bits, sizeof(value));
+                break;
+            }
+            case 2:
+                value = getU16LE(&in[pos]);
+                break;
+            default:
+                value = in[pos];
+                break;
+        }
+        pos += settingWidths[id];
+
+        if (!isSettingValueValid(id, value) || !applySettingValue(settings, id, value)) {
+            badId = id;
+            return false;
+        }
+    }
+    return true;
+}
+
+uint32_t settingsImageCrc(const SystemSettings& settings) {
+    uint8_t image[SETTINGS_IMAGE_SIZE];
+    uint8_t len = encodeSettingsImage(settings, image);
+    return crc32Update(0, image, len);
+}
+
 // =============================================================================
 // SETTINGS EXPORT/IMPORT
 // =============================================================================
@@ -313,6 +516,7 @@ void clearUserData() {
         SD.remove("/alerts.log");
         Serial.println(F("Alert history cleared"));
     }
+    alertHistory.clear();
 }
 
 // =============================================================================
@@ -10,7 +10,7 @@
 #include "DataStructures.h"
 
 // For nRF52840, we'll use flash_nrf5x library
-#ifdef NRF52_SERIES
+#ifdef HAS_INTERNAL_FS
   #include <Adafruit_LittleFS.h>
   #include <InternalFileSystem.h>
   using namespace Adafruit_LittleFS_Namespace;
@@ -22,6 +22,27 @@ uint16_t calculateChecksum(SystemSettings* s);
 void loadSettings(SystemSettings& settings);
 void saveSettings(SystemSettings& settings);
 void validateSettings(SystemSettings& settings);
+
+// Settings image: [version u8] then setting ids 1..SETTING_ID_COUNT in
+// order, each little-endian at its natural width (f32, u16 or u8).
+// Used by the bulk Bluetooth settings transaction.
+#define SETTINGS_IMAGE_VERSION 1
+#define SETTINGS_IMAGE_SIZE 38
+#define SETTING_ID_COUNT 15
+
+// Range-checks one value into settings; false for unknown ids or values
+// that cannot be clamped (log interval). Does not validate or save.
+bool applySettingValue(SystemSettings& settings, uint8_t settingId, float value);
+// True if the value is in range as sent: no clamping, whole numbers for
+// integer settings. The bulk transaction rejects anything this refuses.
+bool isSettingValueValid(uint8_t settingId, float value);
+float getSettingValue(const SystemSettings& settings, uint8_t settingId);
+
+// Writes SETTINGS_IMAGE_SIZE bytes and returns the length
+uint8_t encodeSettingsImage(const SystemSettings& settings, uint8_t* out);
+// Applies every field of an image; badId is the first rejected id (0 = header)
+bool decodeSettingsImage(const uint8_t* in, uint16_t len, SystemSettings& settings, uint8_t& badId);
+uint32_t settingsImageCrc(const SystemSettings& settings);
 void exportSettingsToSD(SystemSettings& settings);
 
 // ADDED: Missing function declaration that main.cpp calls
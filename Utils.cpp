@@ -8,7 +8,9 @@
 #include "math.h"
 #include "Settings.h"      // for saveSettings()
 #include "DataLogger.h"    // for SDLib::File
-#include <nrf.h>
+#ifdef NRF52_SERIES
+  #include <nrf.h>
+#endif
 
 // ===========================
 // nRF52 MEMORY MANAGEMENT - 
@@ -284,6 +286,24 @@ bool readButton(int buttonNum) {
     return !digitalRead(pin);
 }
 
+// True when no button is down, bouncing or waiting to be read, so the
+// debouncer does not need polling until the next pin change
+bool buttonsSettled() {
+    for (int i = 0; i < 5; i++) {
+        if (buttonStates[i] || lastButtonStates[i] || buttonPressed[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void attachButtonInterrupts(void (*isr)()) {
+    const int pins[5] = {BTN_UP, BTN_DOWN, BTN_SELECT, BTN_BACK, BTN_BLUETOOTH};
+    for (int i = 0; i < 5; i++) {
+        attachInterrupt(digitalPinToInterrupt(pins[i]), isr, CHANGE);
+    }
+}
+
 // Convenience functions for Bluetooth button
 bool wasBluetoothButtonPressed() {
     return wasButtonPressed(4);
@@ -416,6 +436,47 @@ float fahrenheitToCelsius(float fahrenheit) {
     return (fahrenheit - 32.0) * 5.0 / 9.0;
 }
 
+// =============================================================================
+// CHECKSUM FUNCTIONS
+// =============================================================================
+
+// Nibble-wise table keeps the flash cost at 64 bytes instead of 1 KB
+static const uint32_t CRC32_NIBBLE_TABLE[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length) {
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++) {
+        crc = CRC32_NIBBLE_TABLE[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = CRC32_NIBBLE_TABLE[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+void putU16LE(uint8_t* p, uint16_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+}
+
+void putU32LE(uint8_t* p, uint32_t value) {
+    p[0] = value & 0xFF;
+    p[1] = (value >> 8) & 0xFF;
+    p[2] = (value >> 16) & 0xFF;
+    p[3] = (value >> 24) & 0xFF;
+}
+
+uint16_t getU16LE(const uint8_t* p) {
+    return (uint16_t)p[0] | ((uint16_t)p[1] << 8);
+}
+
+uint32_t getU32LE(const uint8_t* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
 // =============================================================================
 // STATISTICAL FUNCTIONS
 // =============================================================================
@@ -589,7 +650,9 @@ void performSystemReset() {
     Serial.println(F("System reset requested..."));
     delay(100);
     
+#ifdef NRF52_SERIES
     NVIC_SystemReset();
+#endif
 }
 
 void enterDeepSleep(uint32_t seconds) {
@@ -66,6 +66,8 @@ bool shouldRepeat(int button);
 void resetButtonStates();
 bool readButton(int buttonNum);
 bool wasBluetoothButtonPressed();
+bool buttonsSettled();
+void attachButtonInterrupts(void (*isr)());
 bool isBluetoothButtonHeld();
 
 // =============================================================================
@@ -91,6 +93,20 @@ float calculateDewPoint(float temperature, float humidity);
 float celsiusToFahrenheit(float celsius);
 float fahrenheitToCelsius(float fahrenheit);
 
+// =============================================================================
+// CHECKSUM FUNCTIONS
+// =============================================================================
+
+// Standard CRC-32 (IEEE 802.3, reflected, as used by zlib). Start with
+// crc = 0 and feed successive blocks; the returned value is final.
+uint32_t crc32Update(uint32_t crc, const uint8_t* data, size_t length);
+
+// Little-endian packing for BLE packets (no alignment requirements)
+void putU16LE(uint8_t* p, uint16_t value);
+void putU32LE(uint8_t* p, uint32_t value);
+uint16_t getU16LE(const uint8_t* p);
+uint32_t getU32LE(const uint8_t* p);
+
 // =============================================================================
 // STATISTICAL FUNCTIONS
 // =============================================================================
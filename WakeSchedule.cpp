@@ -0,0 +1,235 @@
+/**
+ * WakeSchedule.cpp
+ * Field mode wake time implementation
+ */
+
+#include "WakeSchedule.h"
+#include "Utils.h"
+
+#ifdef NRF52_SERIES
+  #include <nrf.h>
+#endif
+
+#ifdef HAS_INTERNAL_FS
+  #include <Adafruit_LittleFS.h>
+  #include <InternalFileSystem.h>
+  using WakeFile = Adafruit_LittleFS_Namespace::File;
+#endif
+
+WakeSchedule wakeSchedule;
+
+WakeSchedule::WakeSchedule() {
+    memset(&config, 0, sizeof(config));
+    config.version = WAKE_VERSION;
+    config.mode = WAKE_MODE_ALIGNED;
+    config.intervalS = 0;
+    seed = 0;
+}
+
+void WakeSchedule::begin() {
+#ifdef NRF52_SERIES
+    seed = NRF_FICR->DEVICEID[0] ^ NRF_FICR->DEVICEID[1];
+#endif
+    load();
+
+    Serial.print(F("Wake schedule: "));
+    if (config.intervalS) {
+        Serial.print(config.intervalS);
+        Serial.print(F(" s, "));
+    } else {
+        Serial.print(F("log interval, "));
+    }
+    Serial.println(getModeString(getMode()));
+}
+
+// =============================================================================
+// WAKE TIMES
+// =============================================================================
+
+uint32_t WakeSchedule::getIntervalS(uint32_t defaultS) const {
+    uint32_t interval = config.intervalS ? config.intervalS : defaultS;
+    return constrain(interval, WAKE_MIN_INTERVAL_S, WAKE_MAX_INTERVAL_S);
+}
+
+uint32_t WakeSchedule::jitterFor(uint32_t slot, uint32_t jitterS) const {
+    if (jitterS == 0) return 0;
+
+    // Integer hash of device and slot; the same slot always gets the same offset
+    uint32_t h = seed ^ (slot * 0x9E3779B9UL);
+    h ^= h >> 16;
+    h *= 0x85EBCA6BUL;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35UL;
+    h ^= h >> 16;
+    return h % (jitterS + 1);
+}
+
+uint32_t WakeSchedule::nextWake(uint32_t now, uint32_t defaultS) const {
+    uint32_t interval = getIntervalS(defaultS);
+    uint32_t earliest = now + WAKE_MIN_LEAD_S;
+
+    switch (getMode()) {
+        case WAKE_MODE_RELATIVE:
+            return now + interval;
+
+        case WAKE_MODE_JITTERED: {
+            // Up to half an interval, so slots never swap order. The slot
+            // that began before now may still have its wake ahead
+            uint32_t jitter = min((uint32_t)config.jitterS, interval / 2);
+            for (uint32_t slot = now / interval; ; slot++) {
+                uint32_t t = slot * interval + jitterFor(slot, jitter);
+                if (t >= earliest) return t;
+            }
+        }
+
+        case WAKE_MODE_ALIGNED:
+        default: {
+            uint32_t t = (now / interval + 1) * interval;
+            if (t < earliest) t += interval;
+            return t;
+        }
+    }
+}
+
+uint8_t WakeSchedule::upcoming(uint32_t now, uint32_t defaultS, uint32_t* times, uint8_t count) const {
+    uint32_t t = now;
+    for (uint8_t i = 0; i < count; i++) {
+        t = nextWake(t, defaultS);
+        times[i] = t;
+    }
+    return count;
+}
+
+RtcWakePlan WakeSchedule::planRtcWake(uint32_t now, uint32_t wakeTime) {
+    RtcWakePlan plan;
+    memset(&plan, 0, sizeof(plan));
+    plan.wakeTime = wakeTime;
+
+    uint32_t delta = wakeTime > now ? wakeTime - now : 1;
+    if (delta <= WAKE_COUNTDOWN_MAX_S) {
+        plan.countdown = true;
+        plan.countdownS = delta;
+        return plan;
+    }
+
+    // The alarm fires at second 0 of the matching minute; with the day of
+    // month in the match it is unambiguous for anything under a month.
+    // DateTime takes care of hour, day, month and year rollover
+    DateTime alarm(wakeTime - wakeTime % 60);
+    plan.countdown = false;
+    plan.minute = alarm.minute();
+    plan.hour = alarm.hour();
+    plan.day = alarm.day();
+    return plan;
+}
+
+uint8_t WakeSchedule::secondStageS(uint32_t now, uint32_t wakeTime) {
+    if (wakeTime <= now || wakeTime - now > WAKE_COUNTDOWN_MAX_S) return 0;
+    return wakeTime - now;
+}
+
+// =============================================================================
+// CONFIGURATION
+// =============================================================================
+
+void WakeSchedule::configure(uint32_t intervalS, WakeMode mode, uint16_t jitterS) {
+    config.intervalS = intervalS ? constrain(intervalS, WAKE_MIN_INTERVAL_S, WAKE_MAX_INTERVAL_S) : 0;
+    config.mode = (mode <= WAKE_MODE_JITTERED) ? mode : WAKE_MODE_ALIGNED;
+    config.jitterS = jitterS;
+    save();
+
+    Serial.print(F("Wake schedule: "));
+    if (config.intervalS) {
+        Serial.print(config.intervalS);
+        Serial.print(F(" s, "));
+    } else {
+        Serial.print(F("log interval, "));
+    }
+    Serial.print(getModeString(getMode()));
+    if (getMode() == WAKE_MODE_JITTERED) {
+        Serial.print(F(" +0.."));
+        Serial.print(config.jitterS);
+        Serial.print(F(" s"));
+    }
+    Serial.println();
+}
+
+void WakeSchedule::overrideInterval(uint32_t intervalS) {
+    config.intervalS = intervalS ? constrain(intervalS, WAKE_MIN_INTERVAL_S, WAKE_MAX_INTERVAL_S) : 0;
+}
+
+uint32_t WakeSchedule::configCheck(const WakeConfig& c) {
+    return crc32Update(0, (const uint8_t*)&c, offsetof(WakeConfig, check));
+}
+
+bool WakeSchedule::load() {
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+    WakeFile file(InternalFS);
+    if (!file.open(WAKE_FILE, Adafruit_LittleFS_Namespace::FILE_O_READ)) return false;
+
+    WakeConfig stored;
+    bool ok = file.read((uint8_t*)&stored, sizeof(stored)) == sizeof(stored);
+    file.close();
+    if (!ok || stored.version != WAKE_VERSION || stored.check != configCheck(stored)) return false;
+
+    config = stored;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void WakeSchedule::save() {
+    config.version = WAKE_VERSION;
+    config.check = configCheck(config);
+
+#ifdef HAS_INTERNAL_FS
+    InternalFS.begin();
+    InternalFS.remove(WAKE_FILE);
+    WakeFile file(InternalFS);
+    if (!file.open(WAKE_FILE, Adafruit_LittleFS_Namespace::FILE_O_WRITE)) {
+        Serial.println(F("Wake schedule: cannot save"));
+        return;
+    }
+    file.write((const uint8_t*)&config, sizeof(config));
+    file.close();
+#endif
+}
+
+// =============================================================================
+// DIAGNOSTICS
+// =============================================================================
+
+const char* WakeSchedule::getModeString(WakeMode mode) {
+    switch (mode) {
+        case WAKE_MODE_ALIGNED: return "aligned";
+        case WAKE_MODE_RELATIVE: return "relative";
+        case WAKE_MODE_JITTERED: return "jittered";
+        default: return "?";
+    }
+}
+
+void WakeSchedule::printStatus(uint32_t now, uint32_t defaultS) const {
+    Serial.print(F("Wake: every "));
+    Serial.print(getIntervalS(defaultS));
+    Serial.print(F(" s ("));
+    Serial.print(getModeString(getMode()));
+    Serial.print(F("), next"));
+
+    if (now == 0) {
+        Serial.println(F(" unknown (no RTC)"));
+        return;
+    }
+
+    uint32_t times[WAKE_PREVIEW_COUNT];
+    upcoming(now, defaultS, times, WAKE_PREVIEW_COUNT);
+    for (uint8_t i = 0; i < WAKE_PREVIEW_COUNT; i++) {
+        DateTime t(times[i]);
+        char buf[24];
+        snprintf(buf, sizeof(buf), " %02d-%02d %02d:%02d:%02d",
+                 t.month(), t.day(), t.hour(), t.minute(), t.second());
+        Serial.print(buf);
+    }
+    Serial.println();
+}
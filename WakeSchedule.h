@@ -0,0 +1,114 @@
+/**
+ * WakeSchedule.h
+ * Field mode wake times and how the PCF8523 is programmed for them
+ *
+ * Intervals run from 10 s to 24 h, in one of three modes:
+ *
+ *   aligned    on multiples of the interval since midnight 1970, so any
+ *              divisor of a day lands on clock boundaries (the default)
+ *   relative   the interval after the end of the previous wake
+ *   jittered   aligned slot plus a pseudo-random 0..jitter s offset, so
+ *              hives sharing an apiary do not wake in lockstep. The offset
+ *              is a hash of the device ID and the slot number, which makes
+ *              the upcoming wake times computable in advance
+ *
+ * The PCF8523 is programmed with the 1 Hz countdown timer A for wakes up
+ * to 255 s away, and with the minute/hour/day alarm beyond that. The
+ * alarm only matches whole minutes, so a wake that is not on a minute
+ * boundary takes two steps: the alarm at the minute before, then the
+ * countdown for the remaining seconds. In System ON sleep the loop
+ * programs the second step; after System OFF the boot does, from the
+ * target kept in retained RAM, and goes straight back down.
+ *
+ * With no interval configured, the log interval (or the adaptive one)
+ * is used in aligned mode, as before. A configured interval takes
+ * precedence over both: the adaptive interval only speeds up wakes
+ * while the schedule follows the log interval. Configuration is kept
+ * in internal flash.
+ */
+
+#ifndef WAKE_SCHEDULE_H
+#define WAKE_SCHEDULE_H
+
+#include "Config.h"
+
+#define WAKE_FILE "/wake.dat"
+#define WAKE_VERSION 1
+
+#define WAKE_MIN_INTERVAL_S 10UL
+#define WAKE_MAX_INTERVAL_S 86400UL
+#define WAKE_COUNTDOWN_MAX_S 255         // Timer A at 1 Hz
+#define WAKE_MIN_LEAD_S 2                // Closer wakes move to the next slot
+#define WAKE_PREVIEW_COUNT 4             // Upcoming wakes in the BLE reply
+
+enum WakeMode {
+    WAKE_MODE_ALIGNED = 0,
+    WAKE_MODE_RELATIVE = 1,
+    WAKE_MODE_JITTERED = 2
+};
+
+struct WakeConfig {
+    uint8_t version;
+    uint8_t mode;
+    uint16_t jitterS;
+    uint32_t intervalS;          // 0 = follow the log interval
+    uint32_t check;
+};
+
+// One programming step of the RTC
+struct RtcWakePlan {
+    uint32_t wakeTime;           // Final target, RTC unix time
+    bool countdown;              // Timer A, otherwise the alarm
+    uint8_t countdownS;          // 1..255
+    uint8_t minute;              // Alarm match
+    uint8_t hour;
+    uint8_t day;                 // Day of month
+};
+
+class WakeSchedule {
+private:
+    WakeConfig config;
+    uint32_t seed;
+
+    uint32_t jitterFor(uint32_t slot, uint32_t jitterS) const;
+    void save();
+    bool load();
+    static uint32_t configCheck(const WakeConfig& c);
+
+public:
+    WakeSchedule();
+
+    void begin();
+
+    void configure(uint32_t intervalS, WakeMode mode, uint16_t jitterS);
+
+    // Interval change that is not saved, for projections on a copy
+    void overrideInterval(uint32_t intervalS);
+    WakeMode getMode() const { return (WakeMode)config.mode; }
+    uint16_t getJitter() const { return config.jitterS; }
+    bool isOverridden() const { return config.intervalS != 0; }
+
+    // Interval in force; defaultS is the log interval in seconds
+    uint32_t getIntervalS(uint32_t defaultS) const;
+
+    // First wake at least WAKE_MIN_LEAD_S after now
+    uint32_t nextWake(uint32_t now, uint32_t defaultS) const;
+
+    // The next count wakes, each planned from the one before
+    uint8_t upcoming(uint32_t now, uint32_t defaultS, uint32_t* times, uint8_t count) const;
+
+    // Countdown when the target is close enough, else the alarm at the
+    // target's minute (the caller refines from there)
+    static RtcWakePlan planRtcWake(uint32_t now, uint32_t wakeTime);
+
+    // Seconds still to count down when a wake comes in before its target
+    // (the minute alarm of a two-stage wake), 0 when the wake is due
+    static uint8_t secondStageS(uint32_t now, uint32_t wakeTime);
+
+    static const char* getModeString(WakeMode mode);
+    void printStatus(uint32_t now, uint32_t defaultS) const;
+};
+
+extern WakeSchedule wakeSchedule;
+
+#endif // WAKE_SCHEDULE_H
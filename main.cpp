@@ -17,11 +17,20 @@
 #include "PowerManager.h"
 #include "FieldModeBuffer.h"
 #include "Bluetooth.h"
+#include "EventScheduler.h"
+#include "AppTasks.h"
+#include "PhaseProfiler.h"
+#include "AdaptiveInterval.h"
+#include "BatteryModel.h"
+#include "FastBoot.h"
+#include "WakeSchedule.h"
+#include "PowerDomains.h"
 #include <Wire.h>  // Required for I2C communication with PCF8523
 
 #ifdef NRF52_SERIES
 #include <nrf.h>
 #include <nrf_power.h>
+#include <nrf_gpio.h>
 #endif
 
 // State machine handlers
@@ -94,6 +103,44 @@ bool wasInFieldMode = false;
 unsigned long fieldModeStartTime = 0;
 unsigned long lastFieldModeCheck = 0;
 
+// Button edges wake the loop; without them the debouncer is polled
+bool buttonInterruptsAttached = false;
+
+void onButtonInterrupt() {
+    eventScheduler.post(EVT_BUTTON);
+}
+
+// Buttons and wake detection. Every boot path needs these before its
+// first reading
+static void initializeInputs() {
+    pinMode(BTN_UP, INPUT_PULLUP);
+    pinMode(BTN_DOWN, INPUT_PULLUP);
+    pinMode(BTN_SELECT, INPUT_PULLUP);
+    pinMode(BTN_BACK, INPUT_PULLUP);
+    attachButtonInterrupts(onButtonInterrupt);
+    buttonInterruptsAttached = true;
+    Serial.println(F("Buttons: OK"));
+    
+    // *** CRITICAL: Initialize wake detection ***
+    powerManager.initializeWakeDetection(wakeUpReason);
+}
+
+// Tasks, profiling and the wake configuration kept in InternalFS. Last
+// in setup() on every boot path, since the fast and quick wakes return
+// early
+static void startServices() {
+    // Audio, sensor, storage and BLE work moves off the loop from here
+    appTasks.begin();
+    
+    // Enables the cycle counter and loads the phase energy figures
+    phaseProfiler.begin();
+    adaptiveInterval.begin(settings.logInterval);
+    wakeSchedule.begin();
+    
+    // Peripherals are up; switch off the ones this mode does not hold
+    powerDomains.begin();
+}
+
 WakeUpSource detectWakeupSource() {
 #ifdef NRF52_SERIES
     // Check if we have access to nRF52 power registers
@@ -104,11 +151,23 @@ WakeUpSource detectWakeupSource() {
         
         // Use hex values instead of undefined constants
         if (reset_reason & 0x00040000) {  // NRF_POWER_RESETREAS_OFF_Msk equivalent
-            // Woke from System OFF sleep via GPIO pin
+            // Woke from System OFF sleep via GPIO pin. LATCH records which
+            // of the sensed pins (PowerManager::setupWakeupPin) fired
+            WakeUpSource source = WAKE_RTC;
+            if (nrf_gpio_pin_latch_get(digitalPinToPinName(BTN_BLUETOOTH))) {
+                source = WAKE_BLUETOOTH_BUTTON;
+            } else if (nrf_gpio_pin_latch_get(digitalPinToPinName(BTN_SELECT))) {
+                source = WAKE_BUTTON;
+            }
+            nrf_gpio_pin_latch_clear(digitalPinToPinName(BTN_BLUETOOTH));
+            nrf_gpio_pin_latch_clear(digitalPinToPinName(BTN_SELECT));
+            nrf_gpio_pin_latch_clear(digitalPinToPinName(RTC_INT_PIN));
+            
             Serial.print(F("Reset reason: System OFF wake (0x"));
             Serial.print(reset_reason, HEX);
-            Serial.println(F(")"));
-            return WAKE_RTC;
+            Serial.print(F(")"));
+            Serial.println(source == WAKE_RTC ? F(" by RTC") : F(" by button"));
+            return source;
         } else if (reset_reason & 0x00000001) {  // NRF_POWER_RESETREAS_RESETPIN_Msk equivalent
             // Reset pin pressed
             Serial.print(F("Reset reason: Reset pin (0x"));
@@ -139,11 +198,16 @@ WakeUpSource detectWakeupSource() {
 }
 
 void setup() {
+    fastBoot.markBootStart();
+    
     // *** DETECT WAKE-UP REASON FIRST ***
     wakeUpReason = detectWakeupSource();
     
+    // Nobody is watching a scheduled wake, so it never waits for a monitor
     Serial.begin(115200);
-    delay(1000); // Shorter delay for wake-ups
+    if (wakeUpReason != WAKE_RTC && SERIAL_BOOT_WAIT_MS > 0) {
+        delay(SERIAL_BOOT_WAIT_MS);
+    }
     
     // Print wake-up information
     Serial.println(F("=== HiveGuard Hive Monitor v2.0 - Deep Sleep Edition ==="));
@@ -160,6 +224,9 @@ void setup() {
             break;
     }
     
+    // Wake events and timers for the main loop
+    eventScheduler.begin();
+    
     // Initialize I2C and SPI
     Wire.begin();
     Wire.setClock(100000);  // 100kHz for reliable PCF8523 communication
@@ -168,14 +235,58 @@ void setup() {
     // Initialize Power Manager early (before retained state check)
     powerManager.initialize(&systemStatus, &settings);
     
+    // Before the retained state: restoring field mode switches Bluetooth off
+    powerManager.setBluetoothManager(&bluetoothManager);
+    
     // *** CHECK FOR RETAINED STATE RESTORATION ***
+    // A button wake from System OFF resumes field mode too, but with the
+    // normal boot: someone is in front of the device
     bool restoredFromSleep = false;
-    if (wakeUpReason == WAKE_RTC) {
+    if (wakeUpReason == WAKE_RTC || wakeUpReason == WAKE_BUTTON ||
+        wakeUpReason == WAKE_BLUETOOTH_BUTTON) {
         restoredFromSleep = powerManager.restoreRetainedState();
     }
     
-    // If we restored from deep sleep, skip most of the normal initialization
-    if (restoredFromSleep) {
+    BootPath bootPath = fastBoot.choose(wakeUpReason, restoredFromSleep);
+    
+    // Settings (with calibration), microphone flag and unflushed readings
+    // come from retained RAM: no flash mount, no microphone probe, and SD
+    // only once a flush is due
+    if (bootPath == BOOT_FAST) {
+        Serial.println(F("=== FAST WAKE FROM DEEP SLEEP ==="));
+        fastBoot.restore(settings, systemStatus, fieldBuffer.getBuffer());
+        fastBoot.deferStorage();
+        
+        if (rtc.begin()) {
+            systemStatus.rtcWorking = true;
+            if (!rtc.isrunning()) {
+                rtc.start();
+            }
+            powerManager.initializeDeepSleep();
+            
+            // The minute alarm of a wake planned off the minute: count
+            // down the rest in System OFF (does not return then)
+            powerManager.finishTwoStageWake();
+        }
+        
+        initializeSensors(bme, systemStatus);
+        if (systemStatus.pdmWorking) {
+            initializeAudio(systemStatus, false);
+        }
+        initializeInputs();
+        
+        // Nobody is there to connect: the radio waits for a button
+        bluetoothManager.initialize(&systemStatus, &settings, false);
+        
+        currentSystemState = STATE_SCHEDULED_WAKE;
+        stateChangeTime = millis();
+        startServices();
+        return;
+    }
+    
+    // Scheduled wake without a usable cache: skip most of the normal
+    // initialization, but load everything from flash
+    if (bootPath == BOOT_QUICK) {
         Serial.println(F("=== QUICK WAKE FROM DEEP SLEEP ==="));
         
         // Initialize only essential components for reading
@@ -192,6 +303,7 @@ void setup() {
             // Initialize deep sleep capability for quick wake
             if (powerManager.initializeDeepSleep()) {
                 Serial.println(F("Deep sleep: ENABLED (quick wake)"));
+                powerManager.finishTwoStageWake();
             }
         }
         
@@ -208,15 +320,21 @@ void setup() {
         initializeSensors(bme, systemStatus);
         Serial.println(F("Sensors: OK (quick init)"));
         
+        // Probed once here; fast boots reuse the result
+        initializeAudio(systemStatus);
+        
         // Load settings quickly
         loadSettings(settings);
         
         // Initialize field buffer
         fieldBuffer.clearBuffer();
+        initializeInputs();
+        bluetoothManager.initialize(&systemStatus, &settings, false);
         
         // Take reading and go back to sleep
         currentSystemState = STATE_SCHEDULED_WAKE;
         stateChangeTime = millis();
+        startServices();
         Serial.println(F("=== QUICK WAKE COMPLETE ==="));
         return;
     }
@@ -310,19 +428,9 @@ void setup() {
         initializeAudio(systemStatus);
     }
     
-    // Initialize buttons
-    pinMode(BTN_UP, INPUT_PULLUP);
-    pinMode(BTN_DOWN, INPUT_PULLUP);
-    pinMode(BTN_SELECT, INPUT_PULLUP);
-    pinMode(BTN_BACK, INPUT_PULLUP);
-    Serial.println(F("Buttons: OK"));
-    
-    // *** CRITICAL: Initialize wake detection ***
-    powerManager.initializeWakeDetection(wakeUpReason);
-    
-    // Initialize Bluetooth Manager
+    // Buttons, wake detection and Bluetooth
+    initializeInputs();
     bluetoothManager.initialize(&systemStatus, &settings);
-    powerManager.setBluetoothManager(&bluetoothManager);
     
     // Initialize field buffer
     fieldBuffer.clearBuffer();
@@ -331,8 +439,11 @@ void setup() {
     systemStatus.systemReady = true;
     
     // Take initial reading
+    fastBoot.markFirstSample();
     readAllSensors(bme, currentData, settings, systemStatus);
+    powerManager.updateBatteryModel(currentData);
     checkAlerts(currentData, settings, systemStatus);
+    bluetoothManager.onNewReading();
     
     // *** SET INITIAL STATE BASED ON WAKE REASON ***
     if (wakeUpReason == WAKE_RTC) {
@@ -344,6 +455,14 @@ void setup() {
         if (powerManager.didWakeFromDeepSleep()) {
             powerManager.turnOffDisplay();
         }
+    } else if (restoredFromSleep) {
+        Serial.println(F("Entering user wake state (button wake from deep sleep)"));
+        currentSystemState = STATE_USER_WAKE;
+        stateChangeTime = millis();
+        
+        if (wakeUpReason == WAKE_BLUETOOTH_BUTTON) {
+            powerManager.handleBluetoothButtonPress();
+        }
     } else {
         Serial.println(F("Entering normal awake state"));
         currentSystemState = STATE_AWAKE;
@@ -354,6 +473,8 @@ void setup() {
                       currentSpectralFeatures, currentActivityTrend);
     }
     
+    startServices();
+    
     // Show power status (only for normal boot)
     if (wakeUpReason == WAKE_POWER_ON) {
         powerManager.printPowerStatus();
@@ -361,10 +482,43 @@ void setup() {
 }
 
 void loop() {
+    // The UI pass owns shared state; other tasks run while we idle
+    appTasks.lock();
     unsigned long currentTime = millis();
     
-    // Update button states - ALWAYS FIRST
-    updateButtonStates();
+    // Update button states - ALWAYS FIRST. A pin change starts polling
+    // the debouncer; it stops once every button is released and settled
+    static bool buttonPolling = true;
+    if (eventScheduler.take(EVT_BUTTON)) {
+        buttonPolling = true;
+    }
+    if (buttonPolling && eventScheduler.every(TIMER_BUTTONS, BUTTON_POLL_MS)) {
+        updateButtonStates();
+        if (buttonInterruptsAttached && buttonsSettled() && !menuState.settingsMenuActive) {
+            buttonPolling = false;
+        }
+    }
+    
+    // Bluetooth runs on its own events, with a fast poll only while a
+    // client is connected (notification retries, streams, jobs) and a 1 s
+    // one only for timed gateway, beacon or advertising work; an idle or
+    // stopped radio leaves the timer unpolled so it does not wake us
+    // (the BLE task does this when tasks are running)
+    if (!appTasks.isRunning()) {
+        bool bleEvent = eventScheduler.take(EVT_BLE);
+        bool bleTimer = false;
+        if (bluetoothManager.isConnected()) {
+            bleTimer = eventScheduler.every(TIMER_BLUETOOTH, BT_NOTIFY_RETRY_MS);
+        } else if (bluetoothManager.hasTimedWork()) {
+            bleTimer = eventScheduler.every(TIMER_BLUETOOTH, 1000);
+        }
+        if (bleTimer || bleEvent) {
+            bluetoothManager.update();
+        }
+    }
+    
+    // The alarm itself is latched by PowerManager; the event only wakes us
+    eventScheduler.take(EVT_RTC_ALARM);
 
     // Check for Bluetooth button press (highest priority)
     if (wasBluetoothButtonPressed()) {
@@ -398,6 +552,15 @@ void loop() {
             handleUserWakeState(currentTime);
             break;
     }
+    
+    // Sleep until the next timer that was polled this pass, or an event.
+    // The wake states hand over on the very next pass, so they never idle
+    eventScheduler.setMode(currentSystemState);
+    appTasks.setActive(currentSystemState == STATE_AWAKE);
+    appTasks.unlock();
+    if (currentSystemState == STATE_AWAKE || currentSystemState == STATE_SLEEPING) {
+        eventScheduler.idle();
+    }
 }
 
 // =============================================================================
@@ -411,9 +574,6 @@ void handleAwakeState(unsigned long currentTime) {
        return; // Skip everything else when in menu
    }
 
-   // Update Bluetooth manager
-   bluetoothManager.update();
-
    // Handle main navigation buttons
    bool buttonPressed = false;
    
@@ -470,6 +630,7 @@ void handleAwakeState(unsigned long currentTime) {
        updateDisplay(display, currentMode, currentData, settings, systemStatus, rtc,
                      currentSpectralFeatures, currentActivityTrend);
        lastDisplayUpdate = currentTime;
+       eventScheduler.restart(TIMER_DISPLAY);
    }
 
    // Run normal testing mode operation
@@ -484,8 +645,9 @@ void handleAwakeState(unsigned long currentTime) {
            Serial.println(F("STATE: AWAKE → SLEEPING"));
            
            // IMPORTANT: Recalculate next wake time based on current settings
-           // This accounts for any changes made in the settings menu
-           powerManager.updateNextWakeTime(settings.logInterval);
+           // This accounts for any changes made in the settings menu, and
+           // follows the adaptive interval like the scheduled-wake path
+           powerManager.updateNextWakeTime(powerManager.getWakeIntervalS());
            
            currentSystemState = STATE_SLEEPING;
            stateChangeTime = currentTime;
@@ -498,14 +660,8 @@ void handleAwakeState(unsigned long currentTime) {
 
 
 void handleSleepingState(unsigned long currentTime) {
-    // Add debug output to see what's happening
-    static unsigned long lastDebug = 0;
-    if (currentTime - lastDebug > 2000) {  // Every 2 seconds
-        Serial.print(powerManager.isWakeupFromScheduledTimer());        
-        Serial.print(F(", lastWakeSource="));
-        Serial.println(powerManager.getWakeSourceString());
-        lastDebug = currentTime;
-    }
+    // No timers here: only the RTC alarm, buttons and BLE events wake
+    // the loop, so a sleeping unit wakes about as often as it is scheduled
     
     // Update power manager to handle wake-up events
     powerManager.update();
@@ -539,26 +695,45 @@ void handleSleepingState(unsigned long currentTime) {
     }
     
     // In sleep state, we don't update display or run normal operations
-    // Just minimal processing and wait for wake events
-    
-    // Small delay to prevent busy waiting
-    delay(100);
+    // Just minimal processing; loop() idles until the next wake event
+}
+
+// After a fast boot the SD card is only mounted here
+void flushFieldBuffer(uint32_t timestamp) {
+    // The hour runs from the start of the flush, so it does not creep by
+    // the time the card takes
+    powerManager.noteBufferFlush();
+    powerDomains.acquire(DOMAIN_SD_SPI, PCLIENT_FLUSH);
+    fastBoot.ensureStorage(systemStatus);
+    if (fieldBuffer.flushToSD(rtc, systemStatus)) {
+        fastBoot.noteFlush(timestamp);
+    }
+    powerDomains.release(DOMAIN_SD_SPI, PCLIENT_FLUSH);
 }
 
 void handleScheduledWakeState(unsigned long currentTime) {
     Serial.println(F("=== SCHEDULED WAKE: Taking sensor readings ==="));
     
     if (!readingInProgress) {
-        // Power up sensors for this reading
+        phaseProfiler.beginCycle(systemStatus.rtcWorking ? rtc.now().unixtime() : 0);
+        phaseProfiler.begin(PHASE_STABILIZE);
+        
+        // Power up sensors and microphone for this reading
         powerManager.powerUpSensors();
+        powerManager.powerUpAudio();
         Serial.println(F("Sensors powered up, stabilizing..."));
         readingInProgress = true;
         return; // Let sensors stabilize
     }
     
-    // Take sensor readings (includes 200ms stabilization delay)
-    readAllSensors(bme, currentData, settings, systemStatus);
+    // Sample the battery and start the BME280 conversion, capture audio
+    // while it converts, then collect the results
+    fastBoot.markFirstSample();
+    acquireWakeReading(bme, currentData, settings, systemStatus);
+    powerManager.updateBatteryModel(currentData);
     checkAlerts(currentData, settings, systemStatus);
+    bluetoothManager.onNewReading();
+    phaseProfiler.end();
     
     Serial.print(F("Sensors: T="));
     Serial.print(currentData.temperature, 1);
@@ -570,19 +745,17 @@ void handleScheduledWakeState(unsigned long currentTime) {
     Serial.print(currentData.batteryVoltage, 2);
     Serial.println(F("V"));
     
-    // Process audio if available
+    // Process audio if available. The one full analysis feeds both the
+    // reading and the ML buffer below.
+    static AudioAnalysisResult fullResult;
+    AudioAnalysisResult* audioResult = nullptr;
     if (systemStatus.pdmWorking) {
-        Serial.println(F("Collecting audio samples for full analysis..."));
-        
-        // Collect several samples for better analysis
-        for (int i = 0; i < 50; i++) {
-            processAudio(currentData, settings);
-            delay(10);
-        }
-        
-        // Perform full FFT analysis
-        AudioAnalysisResult fullResult = audioProcessor.performFullAnalysis();
+        // Perform full FFT analysis on the samples captured above
+        phaseProfiler.begin(PHASE_FFT);
+        fullResult = audioProcessor.performFullAnalysis();
+        phaseProfiler.end();
         if (fullResult.analysisValid) {
+            audioResult = &fullResult;
             currentData.dominantFreq = fullResult.dominantFreq;
             currentData.soundLevel = fullResult.soundLevel;
             currentData.beeState = fullResult.beeState;
@@ -596,36 +769,38 @@ void handleScheduledWakeState(unsigned long currentTime) {
         }
     }
     
+    // This reading decides how long to sleep until the next one
+    uint32_t timestamp = systemStatus.rtcWorking ? rtc.now().unixtime() : 0;
+    uint8_t nextInterval = adaptiveInterval.update(currentData, audioResult,
+                                                   getBatteryLevel(currentData.batteryVoltage),
+                                                   timestamp, settings.logInterval);
+    // A configured wake schedule interval overrides the adaptive one
+    uint32_t intervalS = wakeSchedule.getIntervalS(nextInterval * 60UL);
+    
     // Add to buffer instead of logging directly
-    // In handleScheduledWakeState(), replace the buffer addition with:
     if (systemStatus.rtcWorking) {
-        uint32_t timestamp = rtc.now().unixtime();
-        
-        // Get the full audio analysis result if available
-        AudioAnalysisResult* audioResult = nullptr;
-        if (systemStatus.pdmWorking) {
-            static AudioAnalysisResult fullResult;
-            fullResult = audioProcessor.performFullAnalysis();
-            if (fullResult.analysisValid) {
-                audioResult = &fullResult;
-            }
-        }
-        
-        if (fieldBuffer.addReading(currentData, timestamp, audioResult)) {
+        phaseProfiler.begin(PHASE_BUFFER);
+        if (fieldBuffer.addReading(currentData, timestamp, audioResult, intervalS)) {
             Serial.print(F("Added FULL ML reading to buffer ("));
             Serial.print(fieldBuffer.getBufferCount());
             Serial.println(F(" readings)"));
         } else {
             Serial.println(F("Buffer full - flushing ML data to SD"));
-            fieldBuffer.flushToSD(rtc, systemStatus);
-            fieldBuffer.addReading(currentData, timestamp, audioResult);
+            phaseProfiler.begin(PHASE_SD_FLUSH);
+            flushFieldBuffer(timestamp);
+            phaseProfiler.begin(PHASE_BUFFER);
+            fieldBuffer.addReading(currentData, timestamp, audioResult, intervalS);
         }
+        phaseProfiler.end();
     }
     
     // Check if it's time to flush buffer
-    if (powerManager.isTimeForBufferFlush() || fieldBuffer.isBufferFull()) {
+    if (powerManager.isTimeForBufferFlush() || fieldBuffer.isBufferFull() ||
+        fastBoot.isFlushDue(timestamp)) {
         Serial.println(F("Flushing buffer to SD..."));
-        fieldBuffer.flushToSD(rtc, systemStatus);
+        phaseProfiler.begin(PHASE_SD_FLUSH);
+        flushFieldBuffer(timestamp);
+        phaseProfiler.end();
     }
     
     // Power down sensors again
@@ -637,13 +812,14 @@ void handleScheduledWakeState(unsigned long currentTime) {
     // Clear wake source BEFORE transitioning to sleeping
     powerManager.clearWakeSource();
     
-    // Configure next wake time using CURRENT settings (accounts for any changes)
-    powerManager.updateNextWakeTime(settings.logInterval);
+    // Configure next wake time from the interval recorded with the reading
+    powerManager.updateNextWakeTime(intervalS);
     
     Serial.println(F("STATE: SCHEDULED_WAKE → SLEEPING"));
     currentSystemState = STATE_SLEEPING;
     stateChangeTime = currentTime;
     readingInProgress = false;
+    phaseProfiler.endCycle();
     
     // Start new sleep cycle with updated settings
     powerManager.enterFieldSleep();
@@ -666,11 +842,54 @@ void handleUserWakeState(unsigned long currentTime) {
 }
 
 
+// Puts a full FFT result on the Sound Monitor screen
+void applyFullAnalysis(const AudioAnalysisResult& fullResult) {
+    if (fullResult.analysisValid) {
+        // Update current data with full analysis
+        currentData.dominantFreq = fullResult.dominantFreq;
+        currentData.soundLevel = fullResult.soundLevel;
+        currentData.beeState = fullResult.beeState;
+        
+        // Update spectral features for display
+        currentSpectralFeatures.spectralCentroid = fullResult.spectralCentroid;
+        currentSpectralFeatures.totalEnergy = fullResult.shortTermEnergy;
+        currentSpectralFeatures.harmonicity = fullResult.harmonicity;
+        
+        // Copy band energies
+        currentSpectralFeatures.bandEnergyRatios[0] = fullResult.bandEnergy0_200Hz;
+        currentSpectralFeatures.bandEnergyRatios[1] = fullResult.bandEnergy200_400Hz;
+        currentSpectralFeatures.bandEnergyRatios[2] = fullResult.bandEnergy400_600Hz;
+        currentSpectralFeatures.bandEnergyRatios[3] = fullResult.bandEnergy600_800Hz;
+        currentSpectralFeatures.bandEnergyRatios[4] = fullResult.bandEnergy800_1000Hz;
+        currentSpectralFeatures.bandEnergyRatios[5] = fullResult.bandEnergy1000PlusHz;
+        
+        // Update activity trend for display
+        currentActivityTrend.currentActivity = fullResult.shortTermEnergy * 10.0; // Scale for display
+        currentActivityTrend.baselineActivity = fullResult.longTermEnergy * 10.0;
+        currentActivityTrend.activityIncrease = fullResult.activityIncrease;
+        currentActivityTrend.abnormalTiming = (fullResult.contextFlags & CONTEXT_EVENING) > 0;
+        
+        Serial.print(F("FFT Complete: Freq="));
+        Serial.print(fullResult.dominantFreq);
+        Serial.print(F("Hz, Centroid="));
+        Serial.print(fullResult.spectralCentroid, 1);
+        Serial.print(F("Hz, Activity="));
+        Serial.print(fullResult.activityIncrease, 2);
+        Serial.print(F("x, Baseline="));
+        Serial.print(currentActivityTrend.baselineActivity, 1);
+        Serial.println(F("%"));
+    } else {
+        Serial.println(F("FFT analysis failed - not enough samples"));
+    }
+}
+
 void handleTestingModeOperation(unsigned long currentTime) {
-    // Read sensors every 5 seconds - UNCHANGED
-    if (currentTime - lastSensorRead >= 5000) {
+    // Read sensors every 5 seconds - the sensor task does this (and the
+    // logging) when tasks are running
+    if (!appTasks.isRunning() && eventScheduler.every(TIMER_SENSORS, 5000)) {
         readAllSensors(bme, currentData, settings, systemStatus);
         checkAlerts(currentData, settings, systemStatus);
+        bluetoothManager.onNewReading();
         lastSensorRead = currentTime;
         
         Serial.print(F("Sensors: T="));
@@ -685,19 +904,20 @@ void handleTestingModeOperation(unsigned long currentTime) {
     }
     
     // Update Power Manager every 5 seconds
-    if (currentTime - lastPowerUpdate >= 5000) {
+    if (eventScheduler.every(TIMER_POWER, 5000)) {
+        powerManager.updateBatteryModel(currentData);
         powerManager.updatePowerMode(currentData.batteryVoltage);
         lastPowerUpdate = currentTime;
         
         // Debug output every 30 seconds
-        static unsigned long lastPowerDebug = 0;
-        if (currentTime - lastPowerDebug >= 30000) {
+        if (eventScheduler.every(TIMER_POWER_DEBUG, 30000)) {
             Serial.println(F("\n=== Power Manager Update ==="));
             Serial.print(F("Battery: "));
             Serial.print(currentData.batteryVoltage, 2);
             Serial.print(F("V ("));
             Serial.print(getBatteryLevel(currentData.batteryVoltage));
             Serial.println(F("%)"));
+            batteryModel.printStatus();
             
             Serial.print(F("Power Mode: "));
             Serial.println(powerManager.getPowerModeString());
@@ -718,80 +938,55 @@ void handleTestingModeOperation(unsigned long currentTime) {
             Serial.print(getStackHighWaterMark());
             Serial.println(F(" bytes"));
             printMemoryInfo(); // Full breakdown
-                        
-            lastPowerDebug = currentTime;
+            appTasks.printStackUsage();
+            eventScheduler.printStats();
+            phaseProfiler.printStats();
+            adaptiveInterval.printStatus(settings.logInterval);
+            wakeSchedule.printStatus(systemStatus.rtcWorking ? rtc.now().unixtime() : 0,
+                                     adaptiveInterval.getInterval(settings.logInterval) * 60UL);
+            fastBoot.printStatus();
         }
     }
     
     // CLEAN AUDIO PROCESSING - No more legacy code!
     if (systemStatus.pdmWorking) {
-        // Always collect audio samples for real-time display (every 100ms)
-        static unsigned long lastAudioSample = 0;
-        if (currentTime - lastAudioSample >= 100) {
+        // Always collect audio samples for real-time display (every 100ms);
+        // with tasks running the audio task samples and we take its values
+        if (appTasks.isRunning()) {
+            appTasks.mergeAudioDisplay(currentData);
+        } else if (eventScheduler.every(TIMER_AUDIO_SAMPLE, 100)) {
             processAudio(currentData, settings);
-            lastAudioSample = currentTime;
         }
         
         // Run full FFT analysis every 5 seconds ONLY when viewing Sound Monitor
-        static unsigned long lastFullAnalysis = 0;
-        if (currentMode == MODE_SOUND && (currentTime - lastFullAnalysis >= 5000)) {
+        if (currentMode == MODE_SOUND && eventScheduler.every(TIMER_FULL_ANALYSIS, 5000)) {
             Serial.println(F("Running full audio analysis for Sound Monitor..."));
             
-            AudioAnalysisResult fullResult = audioProcessor.performFullAnalysis();
-            
-            if (fullResult.analysisValid) {
-                // Update current data with full analysis
-                currentData.dominantFreq = fullResult.dominantFreq;
-                currentData.soundLevel = fullResult.soundLevel;
-                currentData.beeState = fullResult.beeState;
-                
-                // Update spectral features for display
-                currentSpectralFeatures.spectralCentroid = fullResult.spectralCentroid;
-                currentSpectralFeatures.totalEnergy = fullResult.shortTermEnergy;
-                currentSpectralFeatures.harmonicity = fullResult.harmonicity;
-                
-                // Copy band energies
-                currentSpectralFeatures.bandEnergyRatios[0] = fullResult.bandEnergy0_200Hz;
-                currentSpectralFeatures.bandEnergyRatios[1] = fullResult.bandEnergy200_400Hz;
-                currentSpectralFeatures.bandEnergyRatios[2] = fullResult.bandEnergy400_600Hz;
-                currentSpectralFeatures.bandEnergyRatios[3] = fullResult.bandEnergy600_800Hz;
-                currentSpectralFeatures.bandEnergyRatios[4] = fullResult.bandEnergy800_1000Hz;
-                currentSpectralFeatures.bandEnergyRatios[5] = fullResult.bandEnergy1000PlusHz;
-                
-                // Update activity trend for display
-                currentActivityTrend.currentActivity = fullResult.shortTermEnergy * 10.0; // Scale for display
-                currentActivityTrend.baselineActivity = fullResult.longTermEnergy * 10.0;
-                currentActivityTrend.activityIncrease = fullResult.activityIncrease;
-                currentActivityTrend.abnormalTiming = (fullResult.contextFlags & CONTEXT_EVENING) > 0;
-                
-                Serial.print(F("FFT Complete: Freq="));
-                Serial.print(fullResult.dominantFreq);
-                Serial.print(F("Hz, Centroid="));
-                Serial.print(fullResult.spectralCentroid, 1);
-                Serial.print(F("Hz, Activity="));
-                Serial.print(fullResult.activityIncrease, 2);
-                Serial.print(F("x, Baseline="));
-                Serial.print(currentActivityTrend.baselineActivity, 1);
-                Serial.println(F("%"));
+            if (appTasks.isRunning()) {
+                appTasks.requestAnalysis();   // Result arrives on a later pass
             } else {
-                Serial.println(F("FFT analysis failed - not enough samples"));
+                applyFullAnalysis(audioProcessor.performFullAnalysis());
             }
-            
-            lastFullAnalysis = currentTime;
+        }
+        
+        AudioAnalysisResult taskResult;
+        if (appTasks.takeAnalysis(taskResult)) {
+            applyFullAnalysis(taskResult);
         }
     }
         
     // Log data if enabled
-    if (settings.logEnabled) {
+    if (settings.logEnabled && !appTasks.isRunning()) {
         unsigned long logIntervalMs = settings.logInterval * 60000UL;
-        if (currentTime - lastLogTime >= logIntervalMs) {
+        if (eventScheduler.every(TIMER_LOG, logIntervalMs)) {
             logData(currentData, rtc, settings, systemStatus);
             lastLogTime = currentTime;
         }
     }
     
-    // Update display every second (unless button was just pressed)
-    if (currentTime - lastDisplayUpdate >= 1000) {
+    // Update display every second (unless button was just pressed); a
+    // dark display does not keep the timer armed
+    if (powerManager.isDisplayOn() && eventScheduler.every(TIMER_DISPLAY, 1000)) {
         updateDisplay(display, currentMode, currentData, settings, systemStatus, rtc,
                       currentSpectralFeatures, currentActivityTrend);
         lastDisplayUpdate = currentTime;
@@ -0,0 +1,415 @@
+/**
+ * ble_bench.cpp
+ * Latency, bytes on air and throughput of every BLE command over
+ * simulated links
+ *
+ * Each command runs against the real BluetoothManager on a SimTransport
+ * (BleTransport.h), so protocol and pacing changes can be compared
+ * without a radio. Times are virtual and repeatable for a given link.
+ *
+ * A second table sets QUERY_SERIES against downloading the whole record
+ * journal, which is what a client without it has to do to draw a chart.
+ * A third sets each structured response, decoded against BleSchema.h,
+ * against the JSON the firmware used to send: bytes, and host CPU time
+ * to encode the same fields each way.
+ *
+ * Usage: ble_bench [--check]
+ *   --check  exits non-zero if any command times out, answers with an
+ *            error, a transfer fails its CRC, a series query is not
+ *            smaller than the raw download, or a response does not decode
+ *            against its schema (run by ctest)
+ */
+
+#include "BleSimClient.h"
+#include "BleDecoder.h"
+#include "HostFixture.h"
+#include "BleProtocol.h"
+#include "RecordStore.h"
+#include "SeriesQuery.h"
+#include "Utils.h"
+#include <SD.h>
+#include <chrono>
+#include <string>
+
+extern BluetoothManager bluetoothManager;
+
+#define BENCH_FILE "/HIVE_DATA/2025/2025-01.CSV"
+#define BENCH_FILE_SIZE 32768
+#define BENCH_RECORDS 2000
+
+struct BenchLink {
+    const char* name;
+    SimLinkConfig config;
+};
+
+// Central behaviour seen in the field: an old phone on the default MTU,
+// a typical phone, and a fast link with a poor signal
+static const BenchLink LINKS[] = {
+    { "mtu23/30ms",       { 23, 24, 4, 4, 0, 1 } },
+    { "mtu247/15ms",      { 247, 12, 6, 4, 0, 1 } },
+    { "mtu247/7.5ms/2%",  { 247, 6, 8, 6, 20, 7 } },
+};
+
+enum BenchKind {
+    BENCH_RESPONSE,          // One framed response
+    BENCH_TWO_RESPONSES,     // Acknowledged, then the result later
+    BENCH_UNTIL_PACKET,      // Ends with a streamed packet of endType
+    BENCH_TRANSFER           // Windowed transfer with ACKs
+};
+
+struct BenchCase {
+    const char* name;
+    uint8_t command;
+    std::vector<uint8_t> args;
+    BenchKind kind;
+    uint8_t endType;
+    bool lossTolerant;       // Framed responses have no retransmission
+};
+
+static std::vector<uint8_t> u32(uint32_t v) {
+    std::vector<uint8_t> b(4);
+    putU32LE(b.data(), v);
+    return b;
+}
+
+static std::vector<uint8_t> cat(std::initializer_list<std::vector<uint8_t>> parts) {
+    std::vector<uint8_t> out;
+    for (const std::vector<uint8_t>& p : parts) out.insert(out.end(), p.begin(), p.end());
+    return out;
+}
+
+static std::vector<BenchCase> buildCases() {
+    uint32_t from = 1735689600UL;
+    std::vector<uint8_t> name(BENCH_FILE, BENCH_FILE + strlen(BENCH_FILE));
+    std::vector<uint8_t> clientId = { 'b', 'e', 'n', 'c', 'h', 0, 0, 0 };
+
+    return {
+        { "PING",               BT_CMD_PING,               {}, BENCH_RESPONSE, 0, false },
+        { "GET_STATUS",         BT_CMD_GET_STATUS,         {}, BENCH_RESPONSE, 0, false },
+        { "GET_CURRENT_DATA",   BT_CMD_GET_CURRENT_DATA,   {}, BENCH_RESPONSE, 0, false },
+        { "GET_DEVICE_INFO",    BT_CMD_GET_DEVICE_INFO,    {}, BENCH_RESPONSE, 0, false },
+        { "GET_SETTINGS",       BT_CMD_GET_SETTINGS,       {}, BENCH_RESPONSE, 0, false },
+        { "GET_BEE_PRESETS",    BT_CMD_GET_BEE_PRESETS,    {}, BENCH_RESPONSE, 0, false },
+        { "GET_ALERTS",         BT_CMD_GET_ALERTS,         {}, BENCH_RESPONSE, 0, false },
+        { "LIST_FILES",         BT_CMD_LIST_FILES,         {}, BENCH_RESPONSE, 0, false },
+        { "GET_FILE_INFO",      BT_CMD_GET_FILE_INFO,      name, BENCH_RESPONSE, 0, false },
+        { "GET_LINK_INFO",      BT_CMD_GET_LINK_INFO,      {}, BENCH_RESPONSE, 0, false },
+        { "GET_QUEUE_STATS",    BT_CMD_GET_QUEUE_STATS,    {}, BENCH_RESPONSE, 0, false },
+        { "GET_NEIGHBOURS",     BT_CMD_GET_NEIGHBOURS,     {}, BENCH_RESPONSE, 0, false },
+        { "GET_POWER_PROFILE",  BT_CMD_GET_POWER_PROFILE,  {}, BENCH_RESPONSE, 0, false },
+        { "SET_WAKE_SCHEDULE",  BT_CMD_SET_WAKE_SCHEDULE,  cat({ u32(600), { 0 } }), BENCH_RESPONSE, 0, false },
+        { "GET_FILE_DATA",      BT_CMD_GET_FILE_DATA,      name, BENCH_RESPONSE, 0, false },
+        { "SIMULATE_POWER",     BT_CMD_SIMULATE_POWER,     cat({ { 30 }, u32(600), { 15, 100 } }),
+                                BENCH_TWO_RESPONSES, 0, false },
+        { "SYNC_START",         BT_CMD_SYNC_START,         cat({ clientId, u32(0) }),
+                                BENCH_UNTIL_PACKET, BT_RESP_SYNC_END, false },
+        { "QUERY_SERIES",       BT_CMD_QUERY_SERIES,       cat({ u32(from), u32(from + 14 * 86400UL), u32(3600), { 0xFF, 0xFF } }),
+                                BENCH_UNTIL_PACKET, BT_RESP_SERIES_END, false },
+        { "LINK_BENCHMARK",     BT_CMD_LINK_BENCHMARK,     { 200, 0 }, BENCH_UNTIL_PACKET, BT_RESP_BENCH_END, true },
+        { "TRANSFER",           BT_CMD_TRANSFER_START,     {}, BENCH_TRANSFER, 0, true },
+    };
+}
+
+struct BenchResult {
+    bool finished;
+    uint8_t code;
+    uint32_t elapsedUs;
+    uint32_t packets;
+    uint32_t bytes;
+    const char* note;
+};
+
+static BenchResult runCase(BleSimClient& client, const BenchCase& c, const std::vector<uint8_t>& file) {
+    BenchResult result = { false, BT_RESP_OK, 0, 0, 0, "" };
+    SimLinkStats before = client.sim.getStats();
+    uint32_t start = (uint32_t)hostMicros();
+
+    if (c.kind == BENCH_TRANSFER) {
+        SimDownload download;
+        result.finished = client.download(BENCH_FILE, 0, BT_XFER_DEFAULT_WINDOW, download);
+        if (result.finished) {
+            uint32_t crc = crc32Update(0, download.data.data(), download.data.size());
+            if (download.data != file || crc != download.crc) {
+                result.code = BT_RESP_ERROR;
+                result.note = "CRC mismatch";
+            }
+        }
+    } else {
+        size_t scanned = client.packets.size();
+        uint8_t requestId = client.send(c.command, c.args);
+        result.finished = client.runUntil([&] {
+            const SimResponse* r = client.lastResponse(requestId);
+            if (c.kind == BENCH_UNTIL_PACKET) {
+                // Refusals come back framed; the benchmark itself answers only at the end
+                if (r && r->code != BT_RESP_OK) return true;
+                return client.findPacket(c.endType, scanned) != nullptr;
+            }
+            if (r && r->code != BT_RESP_OK) return true;
+            return client.responseCount(requestId) >= (c.kind == BENCH_TWO_RESPONSES ? 2 : 1);
+        });
+        const SimResponse* r = client.lastResponse(requestId);
+        if (r) {
+            result.code = r->code;
+            if (r->seqError) result.note = "frame gap";
+        }
+    }
+
+    result.elapsedUs = (uint32_t)hostMicros() - start;
+    const SimLinkStats& after = client.sim.getStats();
+    result.packets = after.delivered - before.delivered;
+    result.bytes = after.bytesDelivered - before.bytesDelivered;
+
+    // Let the link go idle so the next command starts clean
+    client.runUntil([&] { return client.sim.getBuffered() == 0 && !bluetoothManager.hasPendingCommands(); }, 2000);
+    return result;
+}
+
+struct SeriesCompare {
+    const char* name;
+    uint8_t fieldMask;
+    uint8_t aggMask;
+};
+
+// A dashboard chart and a one-line sparkline over the whole journal
+static const SeriesCompare SERIES_COMPARE[] = {
+    { "hourly all",   0x3F, SERIES_AGG_MIN | SERIES_AGG_MAX | SERIES_AGG_MEAN | SERIES_AGG_COUNT },
+    { "hourly temp",  SERIES_FIELD_TEMPERATURE, SERIES_AGG_MEAN },
+};
+
+// Series queries over the benchmark journal against fetching it raw;
+// returns the number of comparisons the query did not win
+static int compareSeries(const BenchLink& link) {
+    int failures = 0;
+    uint32_t from = 1735689600UL;
+    uint32_t to = from + BENCH_RECORDS * 600UL;
+
+    BleSimClient client;
+    client.begin(link.config);
+
+    SimLinkStats before = client.sim.getStats();
+    uint32_t start = (uint32_t)hostMicros();
+    SimDownload download;
+    bool rawOk = client.download(RECORD_STORE_FILE, 0, BT_XFER_DEFAULT_WINDOW, download) &&
+                 download.data.size() == hostSdFileSize(RECORD_STORE_FILE);
+    double rawMs = ((uint32_t)hostMicros() - start) / 1000.0;
+    uint32_t rawBytes = client.sim.getStats().bytesDelivered - before.bytesDelivered;
+    if (!rawOk) failures++;
+    printf("%-18s %-18s %10.1f %8lu %8s  %s\n", link.name, "raw journal", rawMs,
+           (unsigned long)rawBytes, "", rawOk ? "" : "FAILED");
+    client.runUntil([&] { return client.sim.getBuffered() == 0 && !bluetoothManager.hasPendingCommands(); }, 2000);
+
+    for (const SeriesCompare& s : SERIES_COMPARE) {
+        std::vector<uint8_t> args(14);
+        putU32LE(&args[0], from);
+        putU32LE(&args[4], to);
+        putU32LE(&args[8], 3600);
+        args[12] = s.fieldMask;
+        args[13] = s.aggMask;
+        BenchCase query = { s.name, BT_CMD_QUERY_SERIES, args, BENCH_UNTIL_PACKET, BT_RESP_SERIES_END, false };
+
+        BenchResult r = runCase(client, query, std::vector<uint8_t>());
+        if (r.code == BT_RESP_TOO_LARGE) {
+            printf("%-18s %-18s %10s %8s %8s  needs a larger MTU\n", link.name, s.name, "", "", "");
+            continue;
+        }
+        bool ok = r.finished && r.code == BT_RESP_OK && rawOk && r.bytes < rawBytes;
+        if (!ok) failures++;
+        double ms = r.elapsedUs / 1000.0;
+        printf("%-18s %-18s %10.1f %8lu %7.1f%%  %s\n", link.name, s.name, ms, (unsigned long)r.bytes,
+               rawBytes ? r.bytes * 100.0 / rawBytes : 0.0, ok ? "" : "NOT SMALLER");
+    }
+    return failures;
+}
+
+// =============================================================================
+// ENCODINGS
+// =============================================================================
+
+struct EncodingCase {
+    const char* name;
+    uint8_t command;
+    const char* message;         // BleSchema.h message code
+};
+
+static const EncodingCase ENCODING_CASES[] = {
+    { "GET_CURRENT_DATA",  BT_CMD_GET_CURRENT_DATA,  "CD" },
+    { "GET_DEVICE_INFO",   BT_CMD_GET_DEVICE_INFO,   "DI" },
+    { "GET_SETTINGS",      BT_CMD_GET_SETTINGS,      "ST" },
+    { "LIST_FILES",        BT_CMD_LIST_FILES,        "FL" },
+    { "GET_FILE_INFO",     BT_CMD_GET_FILE_INFO,     "FI" },
+    { "GET_BEE_PRESETS",   BT_CMD_GET_BEE_PRESETS,   "PL" },
+    { "GET_ALERTS",        BT_CMD_GET_ALERTS,        "AL" },
+    { "GET_QUEUE_STATS",   BT_CMD_GET_QUEUE_STATS,   "QS" },
+    { "GET_NEIGHBOURS",    BT_CMD_GET_NEIGHBOURS,    "NL" },
+    { "GET_POWER_PROFILE", BT_CMD_GET_POWER_PROFILE, "PP" },
+};
+
+#define ENCODE_REPEATS 2000
+
+// The JSON responses were one snprintf() object per message, keyed by
+// field name; floats went out with two decimals at most
+static void appendJson(std::string& out, const char* message, const BleFields& fields) {
+    char buf[32];
+    out += '{';
+    for (size_t i = 0; i < fields.size(); i++) {
+        const BleValue& v = fields[i];
+        const BleFieldDesc* desc = findSchemaField(message, v.tag);
+        if (i) out += ',';
+        out += '"';
+        out += desc->name;
+        out += "\":";
+        switch (desc->type) {
+            case BT_FT_F32:  snprintf(buf, sizeof(buf), "%.2f", fieldFloat(v)); break;
+            case BT_FT_I32:  snprintf(buf, sizeof(buf), "%ld", (long)(int32_t)v.scalar); break;
+            case BT_FT_BOOL: snprintf(buf, sizeof(buf), "%s", v.scalar ? "true" : "false"); break;
+            case BT_FT_STR:  out += '"'; out += v.text; out += '"'; buf[0] = 0; break;
+            case BT_FT_LIST:
+                out += '[';
+                for (size_t r = 0; r < v.records.size(); r++) {
+                    if (r) out += ',';
+                    appendJson(out, findListMessage(message, v.tag), v.records[r]);
+                }
+                out += ']';
+                buf[0] = 0;
+                break;
+            default:         snprintf(buf, sizeof(buf), "%lu", (unsigned long)v.scalar); break;
+        }
+        out += buf;
+    }
+    out += '}';
+}
+
+static void writeFields(BleResponseWriter& w, const char* message, const BleFields& fields) {
+    for (const BleValue& v : fields) {
+        switch (findSchemaField(message, v.tag)->type) {
+            case BT_FT_U8:   w.putU8(v.tag, (uint8_t)v.scalar); break;
+            case BT_FT_U16:  w.putU16(v.tag, (uint16_t)v.scalar); break;
+            case BT_FT_U32:  w.putU32(v.tag, v.scalar); break;
+            case BT_FT_I32:  w.putI32(v.tag, (int32_t)v.scalar); break;
+            case BT_FT_F32:  w.putF32(v.tag, fieldFloat(v)); break;
+            case BT_FT_BOOL: w.putBool(v.tag, v.scalar != 0); break;
+            case BT_FT_STR:  w.putStr(v.tag, v.text.c_str()); break;
+            case BT_FT_LIST:
+                w.beginList(v.tag);
+                for (const BleFields& record : v.records) {
+                    w.beginRecord();
+                    writeFields(w, findListMessage(message, v.tag), record);
+                    w.endRecord();
+                }
+                w.endList();
+                break;
+        }
+    }
+}
+
+static bool discardFrame(const uint8_t* data, uint16_t len) {
+    (void)data;
+    (void)len;
+    return true;
+}
+
+// Payload bytes (frame headers included) and ns per encode; both this
+// and the JSON side look fields up in the schema tables as they go
+static uint32_t encodeBinary(const char* message, const BleFields& fields, BleEncoding enc, double& ns) {
+    uint32_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ENCODE_REPEATS; i++) {
+        BleResponseWriter w(discardFrame, BT_CHUNK_SIZE, BT_RESP_OK, 1, enc);
+        writeFields(w, message, fields);
+        w.finish();
+        bytes = w.getTotalBytes();
+    }
+    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ENCODE_REPEATS;
+    return bytes;
+}
+
+static uint32_t encodeJson(const char* message, const BleFields& fields, double& ns) {
+    std::string json;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < ENCODE_REPEATS; i++) {
+        json.clear();
+        appendJson(json, message, fields);
+    }
+    ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / ENCODE_REPEATS;
+    return json.size();
+}
+
+// Each response decoded against its schema, then encoded again as JSON,
+// TLV and CBOR; returns the number that failed to decode or grew
+static int compareEncodings() {
+    int failures = 0;
+    BleSimClient client;
+    client.begin(LINKS[1].config);
+
+    printf("\n%-18s %8s %8s %8s %9s %9s %9s\n", "response", "JSON B", "TLV B", "CBOR B",
+           "JSON ns", "TLV ns", "CBOR ns");
+    for (const EncodingCase& c : ENCODING_CASES) {
+        std::vector<uint8_t> args;
+        if (c.command == BT_CMD_GET_FILE_INFO) args.assign(BENCH_FILE, BENCH_FILE + strlen(BENCH_FILE));
+        const SimResponse* r = client.request(c.command, args);
+        BleFields fields;
+        if (!r || r->code != BT_RESP_OK || !decodeTlv(r->payload, c.message, fields)) {
+            printf("%-18s does not decode as %s\n", c.name, c.message);
+            failures++;
+            continue;
+        }
+
+        double jsonNs, tlvNs, cborNs;
+        uint32_t json = encodeJson(c.message, fields, jsonNs);
+        uint32_t tlv = encodeBinary(c.message, fields, BT_ENC_TLV, tlvNs);
+        uint32_t cbor = encodeBinary(c.message, fields, BT_ENC_CBOR, cborNs);
+        if (tlv >= json) failures++;
+        printf("%-18s %8lu %8lu %8lu %9.0f %9.0f %9.0f%s\n", c.name, (unsigned long)json,
+               (unsigned long)tlv, (unsigned long)cbor, jsonNs, tlvNs, cborNs, tlv < json ? "" : "  NOT SMALLER");
+    }
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    bool check = argc > 1 && strcmp(argv[1], "--check") == 0;
+    int failures = 0;
+
+    hostBootDevice();
+    SD.mkdir("/HIVE_DATA/2025");
+    std::vector<uint8_t> file = hostWriteFile(BENCH_FILE, BENCH_FILE_SIZE);
+    hostAppendRecords(BENCH_RECORDS);
+    std::vector<BenchCase> cases = buildCases();
+
+    printf("%-18s %-18s %6s %10s %7s %8s %9s  %s\n",
+           "link", "command", "code", "latency ms", "packets", "bytes", "kB/s", "");
+
+    for (const BenchLink& link : LINKS) {
+        BleSimClient client;
+        client.begin(link.config);
+
+        for (const BenchCase& c : cases) {
+            if (link.config.lossPermille && !c.lossTolerant) continue;
+
+            BenchResult r = runCase(client, c, file);
+            double ms = r.elapsedUs / 1000.0;
+            double rate = r.elapsedUs ? r.bytes * 1000.0 / r.elapsedUs : 0;
+
+            // Sync and series need an MTU exchange first; that is a refusal, not a fault
+            bool ok = r.finished && (r.code == BT_RESP_OK || r.code == BT_RESP_TOO_LARGE) && !*r.note;
+            if (!ok) failures++;
+
+            printf("%-18s %-18s   0x%02X %10.1f %7lu %8lu %9.2f  %s%s\n",
+                   link.name, c.name, r.code, ms, (unsigned long)r.packets,
+                   (unsigned long)r.bytes, rate, r.finished ? "" : "TIMEOUT ", r.note);
+        }
+    }
+
+    printf("\n%-18s %-18s %10s %8s %8s\n", "link", "series vs raw", "latency ms", "bytes", "of raw");
+    for (const BenchLink& link : LINKS) {
+        if (link.config.lossPermille) continue;   // Series packets have no retransmission
+        failures += compareSeries(link);
+    }
+
+    failures += compareEncodings();
+
+    if (check) {
+        printf("%d failures\n", failures);
+        return failures ? 1 : 0;
+    }
+    return 0;
+}
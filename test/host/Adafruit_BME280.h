@@ -0,0 +1,35 @@
+/**
+ * Adafruit_BME280.h
+ * Host stand-in for the BME280: returns the values the test sets
+ */
+
+#ifndef HOST_ADAFRUIT_BME280_H
+#define HOST_ADAFRUIT_BME280_H
+
+#include <Arduino.h>
+
+class Adafruit_BME280 {
+public:
+    enum sensor_sampling { SAMPLING_NONE, SAMPLING_X1, SAMPLING_X2, SAMPLING_X4, SAMPLING_X8, SAMPLING_X16 };
+    enum sensor_mode { MODE_SLEEP, MODE_FORCED, MODE_NORMAL = 3 };
+    enum sensor_filter { FILTER_OFF, FILTER_X2, FILTER_X4, FILTER_X8, FILTER_X16 };
+    enum standby_duration { STANDBY_MS_0_5, STANDBY_MS_500 = 4 };
+
+    bool begin(uint8_t address = 0x77) { (void)address; return present; }
+    void setSampling(sensor_mode mode, sensor_sampling t, sensor_sampling p, sensor_sampling h,
+                     sensor_filter filter, standby_duration standby) {
+        (void)mode; (void)t; (void)p; (void)h; (void)filter; (void)standby;
+    }
+    bool takeForcedMeasurement() { conversions++; return present; }
+    float readTemperature() { return temperature; }
+    float readHumidity() { return humidity; }
+    float readPressure() { return pressurePa; }
+
+    bool present = true;
+    float temperature = 24.0f;
+    float humidity = 55.0f;
+    float pressurePa = 101325.0f;
+    uint32_t conversions = 0;
+};
+
+#endif // HOST_ADAFRUIT_BME280_H
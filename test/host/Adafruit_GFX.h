@@ -0,0 +1,53 @@
+/**
+ * Adafruit_GFX.h
+ * Host stand-in for the graphics base class: draws nothing
+ */
+
+#ifndef HOST_ADAFRUIT_GFX_H
+#define HOST_ADAFRUIT_GFX_H
+
+#include <Arduino.h>
+
+class Adafruit_GFX : public Print {
+public:
+    Adafruit_GFX(int16_t w, int16_t h) : w(w), h(h) {}
+
+    void setTextSize(int size) { (void)size; }
+    void setTextColor(int color) { (void)color; }
+    void setTextColor(int color, int background) { (void)color; (void)background; }
+    void setCursor(int x, int y) { (void)x; (void)y; }
+    void drawPixel(int16_t x, int16_t y, uint16_t color) { (void)x; (void)y; (void)color; }
+    void drawLine(int x0, int y0, int x1, int y1, int color) { (void)x0; (void)y0; (void)x1; (void)y1; (void)color; }
+    void drawRect(int x, int y, int w, int h, int color) { (void)x; (void)y; (void)w; (void)h; (void)color; }
+    void fillRect(int x, int y, int w, int h, int color) { (void)x; (void)y; (void)w; (void)h; (void)color; }
+    void drawCircle(int x, int y, int r, int color) { (void)x; (void)y; (void)r; (void)color; }
+    void fillCircle(int x, int y, int r, int color) { (void)x; (void)y; (void)r; (void)color; }
+    void drawRoundRect(int x, int y, int w, int h, int r, int color) { (void)x; (void)y; (void)w; (void)h; (void)r; (void)color; }
+    void fillRoundRect(int x, int y, int w, int h, int r, int color) { (void)x; (void)y; (void)w; (void)h; (void)r; (void)color; }
+    void drawFastHLine(int x, int y, int w, int color) { (void)x; (void)y; (void)w; (void)color; }
+    void drawFastVLine(int x, int y, int h, int color) { (void)x; (void)y; (void)h; (void)color; }
+    void drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2, int color) {
+        (void)x0; (void)y0; (void)x1; (void)y1; (void)x2; (void)y2; (void)color;
+    }
+    void fillTriangle(int x0, int y0, int x1, int y1, int x2, int y2, int color) {
+        (void)x0; (void)y0; (void)x1; (void)y1; (void)x2; (void)y2; (void)color;
+    }
+    void getTextBounds(const char* text, int16_t x, int16_t y, int16_t* x1, int16_t* y1, uint16_t* bw, uint16_t* bh) {
+        *x1 = x;
+        *y1 = y;
+        *bw = (uint16_t)(strlen(text) * 6);
+        *bh = 8;
+    }
+    void drawBitmap(int16_t x, int16_t y, const uint8_t* bitmap, int16_t bw, int16_t bh, uint16_t color) {
+        (void)x; (void)y; (void)bitmap; (void)bw; (void)bh; (void)color;
+    }
+    int16_t width() { return w; }
+    int16_t height() { return h; }
+    void setRotation(uint8_t rotation) { (void)rotation; }
+
+private:
+    int16_t w;
+    int16_t h;
+};
+
+#endif // HOST_ADAFRUIT_GFX_H
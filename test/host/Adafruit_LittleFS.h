@@ -0,0 +1,64 @@
+/**
+ * Adafruit_LittleFS.h
+ * Host stand-in for the LittleFS API over an in-memory flash
+ *
+ * Flat namespace of whole paths, as the firmware only keeps a few files
+ * in the root. FILE_O_WRITE creates the file and starts at its end, as
+ * the real library does, so callers that rewrite a file remove it first.
+ * hostFlashReset() erases everything.
+ */
+
+#ifndef HOST_ADAFRUIT_LITTLEFS_H
+#define HOST_ADAFRUIT_LITTLEFS_H
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+class Adafruit_LittleFS;
+
+namespace Adafruit_LittleFS_Namespace {
+
+enum {
+    FILE_O_READ = 0,
+    FILE_O_WRITE = 1
+};
+
+class File {
+private:
+    std::shared_ptr<std::vector<uint8_t>> data;
+    uint32_t pos;
+    bool writable;
+
+public:
+    File() : pos(0), writable(false) {}
+    explicit File(Adafruit_LittleFS& fs) : pos(0), writable(false) { (void)fs; }
+
+    bool open(const char* path, uint8_t mode);
+    operator bool() const { return data != nullptr; }
+    void close() { data.reset(); }
+    uint32_t size() const { return data ? (uint32_t)data->size() : 0; }
+    uint32_t position() const { return pos; }
+    bool seek(uint32_t position);
+    int available() const { return data ? (int)(data->size() - pos) : 0; }
+    int read();
+    int read(void* buffer, uint16_t len);
+    size_t write(uint8_t c) { return write(&c, 1); }
+    size_t write(const uint8_t* buffer, size_t size);
+};
+
+} // namespace Adafruit_LittleFS_Namespace
+
+class Adafruit_LittleFS {
+public:
+    bool begin() { return true; }
+    bool exists(const char* path);
+    bool remove(const char* path);
+    bool format();
+};
+
+// Erases the flash; the next open() finds no files
+void hostFlashReset();
+size_t hostFlashFileSize(const char* path);
+
+#endif // HOST_ADAFRUIT_LITTLEFS_H
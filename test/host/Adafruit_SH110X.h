@@ -0,0 +1,28 @@
+/**
+ * Adafruit_SH110X.h
+ * Host stand-in for the SH1106G OLED: counts refreshes
+ */
+
+#ifndef HOST_ADAFRUIT_SH110X_H
+#define HOST_ADAFRUIT_SH110X_H
+
+#include <Adafruit_GFX.h>
+#include <Wire.h>
+
+#define SH110X_WHITE 1
+#define SH110X_BLACK 0
+
+class Adafruit_SH1106G : public Adafruit_GFX {
+public:
+    Adafruit_SH1106G(int w, int h, TwoWire* wire, int reset) : Adafruit_GFX(w, h) { (void)wire; (void)reset; }
+
+    bool begin(uint8_t address, bool reset) { (void)address; (void)reset; return true; }
+    void clearDisplay() {}
+    void display() { refreshes++; }
+    void setContrast(uint8_t contrast) { (void)contrast; }
+    void oled_command(uint8_t command) { (void)command; }
+
+    uint32_t refreshes = 0;
+};
+
+#endif // HOST_ADAFRUIT_SH110X_H
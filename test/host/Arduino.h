@@ -0,0 +1,185 @@
+/**
+ * Arduino.h
+ * Host stand-in for the Arduino core used by the firmware sources
+ *
+ * Only what the firmware calls is provided. Time is virtual: millis(),
+ * micros() and delay() read and advance a clock the test drives, unless
+ * hostUseRealTime() switches it to the wall clock for threaded tests.
+ * hostSetDelayHook() lets a simulated peer run during a delay().
+ * Pins are plain arrays the test can set, and attached interrupts are
+ * fired by hostFireInterrupt(). Serial output is dropped unless the
+ * HOST_SERIAL environment variable is set.
+ */
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include <string>
+
+using std::min;
+using std::max;
+
+typedef bool boolean;
+typedef uint8_t byte;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define FALLING 2
+#define RISING 3
+#define CHANGE 4
+#define HEX 16
+#define DEC 10
+#define OCT 8
+#define BIN 2
+#define PI 3.14159265358979
+#define F_CPU 64000000
+#define A1 31
+#define A4 28
+#define A6 30
+#define HOST_PIN_COUNT 64
+
+#define F(x) (x)
+#define constrain(a, l, h) ((a) < (l) ? (l) : ((a) > (h) ? (h) : (a)))
+#define digitalPinToInterrupt(p) (p)
+#define digitalPinToPinName(p) (p)
+
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+int analogRead(int pin);
+void analogReadResolution(int bits);
+void attachInterrupt(int pin, void (*handler)(void), int mode);
+void detachInterrupt(int pin);
+
+long map(long x, long inMin, long inMax, long outMin, long outMax);
+long random(long max);
+long random(long min, long max);
+void randomSeed(unsigned long seed);
+void noInterrupts();
+void interrupts();
+
+// =============================================================================
+// HOST CONTROL
+// =============================================================================
+
+uint64_t hostMicros();
+void hostSetMicros(uint64_t us);
+void hostAdvanceMicros(uint64_t us);
+void hostAdvanceMillis(uint64_t ms);
+void hostUseRealTime(bool on);
+
+// Called after every virtual delay(), so a simulated radio keeps running
+// while the firmware waits on it
+void hostSetDelayHook(void (*hook)());
+
+void hostSetPin(int pin, int level);
+int hostGetPin(int pin);
+void hostSetAnalog(int pin, int value);
+void hostSetAnalogSource(int (*source)(int pin, uint64_t us));
+bool hostFireInterrupt(int pin);
+
+// Resets clock, pins, interrupts and the random sequence
+void hostResetArduino();
+
+// =============================================================================
+// STRING
+// =============================================================================
+
+class String {
+private:
+    std::string s;
+
+public:
+    String(const char* text = "");
+    String(const std::string& text) : s(text) {}
+    String(int value);
+    String(unsigned int value);
+    String(long value);
+    String(unsigned long value);
+    String(double value, int decimals = 2);
+
+    String& operator+=(const String& other);
+    String& operator+=(const char* text);
+    String& operator+=(int value);
+    String& operator+=(unsigned long value);
+    String& operator+=(long value);
+    String& operator+=(unsigned int value);
+    friend String operator+(const String& a, const String& b);
+    friend String operator+(const char* a, const String& b);
+    friend String operator+(const String& a, const char* b);
+    bool operator==(const String& other) const { return s == other.s; }
+
+    const char* c_str() const { return s.c_str(); }
+    unsigned int length() const { return (unsigned int)s.size(); }
+};
+
+// =============================================================================
+// PRINT AND SERIAL
+// =============================================================================
+
+class Print {
+private:
+    size_t printNumber(unsigned long long value, int base);
+
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) { (void)c; return 1; }
+    virtual size_t write(const uint8_t* buffer, size_t size);
+    virtual void flush() {}
+
+    size_t print(const char* text);
+    size_t print(const String& text);
+    size_t print(char c);
+    size_t print(double value, int digits = 2);
+    size_t print(int value, int base = DEC);
+    size_t print(unsigned int value, int base = DEC);
+    size_t print(long value, int base = DEC);
+    size_t print(unsigned long value, int base = DEC);
+    size_t print(long long value, int base = DEC);
+    size_t print(unsigned long long value, int base = DEC);
+    size_t print(uint8_t value, int base = DEC) { return print((unsigned int)value, base); }
+    size_t print(uint16_t value, int base = DEC) { return print((unsigned int)value, base); }
+    size_t print(int16_t value, int base = DEC) { return print((int)value, base); }
+    size_t print(bool value) { return print((int)value); }
+    size_t print(float value, int digits = 2) { return print((double)value, digits); }
+
+    size_t println();
+    template <typename T> size_t println(T value) { size_t n = print(value); return n + println(); }
+    template <typename T> size_t println(T value, int format) { size_t n = print(value, format); return n + println(); }
+};
+
+class Stream : public Print {
+public:
+    virtual int available() { return 0; }
+    virtual int read() { return -1; }
+};
+
+class HardwareSerial : public Stream {
+public:
+    void begin(unsigned long baud) { (void)baud; }
+    operator bool() { return true; }
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buffer, size_t size);
+    void flush();
+};
+
+extern HardwareSerial Serial;
+
+#endif // HOST_ARDUINO_H
@@ -0,0 +1,248 @@
+/**
+ * BleDecoder.cpp
+ * Client-side decoding of TLV and CBOR response payloads for host tests
+ */
+
+#define BLE_SCHEMA_TABLES
+#include "BleDecoder.h"
+#include <string.h>
+
+bool BleValue::operator==(const BleValue& other) const {
+    return tag == other.tag && isList == other.isList && isText == other.isText &&
+           scalar == other.scalar && (!isText || text == other.text) && records == other.records;
+}
+
+const BleValue* findField(const BleFields& fields, uint8_t tag) {
+    for (const BleValue& v : fields) {
+        if (v.tag == tag) return &v;
+    }
+    return nullptr;
+}
+
+float fieldFloat(const BleValue& value) {
+    float f;
+    memcpy(&f, &value.scalar, sizeof(f));
+    return f;
+}
+
+// =============================================================================
+// SCHEMA
+// =============================================================================
+
+const BleSchemaTables& bleProtocolSchema() {
+    static const BleSchemaTables tables = {
+        BLE_SCHEMA_FIELDS, sizeof(BLE_SCHEMA_FIELDS) / sizeof(BLE_SCHEMA_FIELDS[0]),
+        BLE_SCHEMA_LISTS, sizeof(BLE_SCHEMA_LISTS) / sizeof(BLE_SCHEMA_LISTS[0])
+    };
+    return tables;
+}
+
+const BleFieldDesc* findSchemaField(const char* message, uint8_t tag, const BleSchemaTables& schema) {
+    for (size_t i = 0; i < schema.fieldCount; i++) {
+        const BleFieldDesc& f = schema.fields[i];
+        if (f.tag == tag && strcmp(f.message, message) == 0) return &f;
+    }
+    return nullptr;
+}
+
+const char* findListMessage(const char* message, uint8_t tag, const BleSchemaTables& schema) {
+    for (size_t i = 0; i < schema.listCount; i++) {
+        const BleListDesc& l = schema.lists[i];
+        if (l.tag == tag && strcmp(l.message, message) == 0) return l.recordMessage;
+    }
+    return nullptr;
+}
+
+// TLV value length of a fixed-size type; -1 for strings and lists
+static int fixedLength(uint8_t type) {
+    switch (type) {
+        case BT_FT_U8:
+        case BT_FT_BOOL: return 1;
+        case BT_FT_U16:  return 2;
+        case BT_FT_U32:
+        case BT_FT_I32:
+        case BT_FT_F32:  return 4;
+        default:         return -1;
+    }
+}
+
+// =============================================================================
+// TLV
+// =============================================================================
+
+namespace {
+
+struct TlvParser {
+    const std::vector<uint8_t>& in;
+    const BleSchemaTables& schema;
+    size_t pos;
+
+    bool atMarker() const {
+        return pos + 1 < in.size() && (in[pos] == BT_TAG_RECORD || in[pos] == BT_TAG_END) && in[pos + 1] == 0;
+    }
+
+    // Fields of message up to the end of input, or to the next record or
+    // list marker
+    bool fields(const char* message, BleFields& out, bool nested) {
+        while (pos < in.size()) {
+            if (nested && atMarker()) return true;
+            if (pos + 2 > in.size()) return false;
+            uint8_t tag = in[pos];
+            uint8_t len = in[pos + 1];
+            pos += 2;
+            if (pos + len > in.size()) return false;
+
+            const BleFieldDesc* desc = findSchemaField(message, tag, schema);
+            if (!desc) return false;
+
+            BleValue v = { tag, false, false, 0, "", {} };
+            if (desc->type == BT_FT_LIST) {
+                const char* recordMessage = findListMessage(message, tag, schema);
+                if (len != 0 || !recordMessage) return false;
+                v.isList = true;
+                if (!list(recordMessage, v)) return false;
+            } else if (desc->type == BT_FT_STR) {
+                v.isText = true;
+                v.text.assign((const char*)&in[pos], len);
+                pos += len;
+            } else {
+                if (len != fixedLength(desc->type)) return false;
+                for (uint8_t i = 0; i < len; i++) v.scalar |= (uint32_t)in[pos + i] << (8 * i);
+                pos += len;
+            }
+            out.push_back(v);
+        }
+        return !nested;
+    }
+
+    bool list(const char* recordMessage, BleValue& v) {
+        while (true) {
+            if (!atMarker()) return false;
+            uint8_t marker = in[pos];
+            pos += 2;
+            if (marker == BT_TAG_END) return true;
+            v.records.push_back({});
+            if (!fields(recordMessage, v.records.back(), true)) return false;
+        }
+    }
+};
+
+} // namespace
+
+bool decodeTlv(const std::vector<uint8_t>& in, const char* message, BleFields& out,
+               const BleSchemaTables& schema) {
+    TlvParser parser = { in, schema, 0 };
+    out.clear();
+    return parser.fields(message, out, false);
+}
+
+// =============================================================================
+// CBOR
+// =============================================================================
+
+namespace {
+
+struct CborParser {
+    const std::vector<uint8_t>& in;
+    size_t pos;
+
+    // Major type and argument; indefinite is set for additional info 31
+    bool head(uint8_t& major, uint32_t& value, bool& indefinite) {
+        if (pos >= in.size()) return false;
+        uint8_t b = in[pos++];
+        major = b >> 5;
+        uint8_t info = b & 0x1F;
+        indefinite = false;
+        if (info < 24) {
+            value = info;
+            return true;
+        }
+        if (info == 31) {
+            indefinite = true;
+            return major >= 2 && major <= 5;    // Only strings, arrays and maps
+        }
+        int bytes = info == 24 ? 1 : info == 25 ? 2 : info == 26 ? 4 : 0;
+        if (bytes == 0 || pos + bytes > in.size()) return false;
+        value = 0;
+        for (int i = 0; i < bytes; i++) value = (value << 8) | in[pos++];
+        return true;
+    }
+
+    bool isBreak() const {
+        return pos < in.size() && in[pos] == 0xFF;
+    }
+
+    bool map(BleFields& out) {
+        uint8_t major;
+        uint32_t n;
+        bool indefinite;
+        if (!head(major, n, indefinite) || major != 5 || !indefinite) return false;
+
+        while (!isBreak()) {
+            BleValue v = { 0, false, false, 0, "", {} };
+            uint32_t key;
+            if (!head(major, key, indefinite) || major != 0 || indefinite || key > 0xFF) return false;
+            v.tag = (uint8_t)key;
+            if (!value(v)) return false;
+            out.push_back(v);
+        }
+        pos++;
+        return true;
+    }
+
+    bool value(BleValue& v) {
+        if (pos >= in.size()) return false;
+        uint8_t b = in[pos];
+        if (b == 0xF4 || b == 0xF5) {
+            v.scalar = b == 0xF5;
+            pos++;
+            return true;
+        }
+        if (b == 0xFA) {
+            if (pos + 5 > in.size()) return false;
+            for (int i = 1; i <= 4; i++) v.scalar = (v.scalar << 8) | in[pos + i];
+            pos += 5;
+            return true;
+        }
+
+        uint8_t major;
+        uint32_t n;
+        bool indefinite;
+        if (!head(major, n, indefinite)) return false;
+        switch (major) {
+            case 0:
+                if (indefinite) return false;
+                v.scalar = n;
+                return true;
+            case 1:
+                if (indefinite) return false;
+                v.scalar = (uint32_t)(-1 - (int64_t)n);
+                return true;
+            case 3:
+                if (indefinite || pos + n > in.size()) return false;
+                v.isText = true;
+                v.text.assign((const char*)&in[pos], n);
+                pos += n;
+                return true;
+            case 4:
+                if (!indefinite) return false;
+                v.isList = true;
+                while (!isBreak()) {
+                    v.records.push_back({});
+                    if (!map(v.records.back())) return false;
+                }
+                pos++;
+                return true;
+            default:
+                return false;
+        }
+    }
+};
+
+} // namespace
+
+bool decodeCbor(const std::vector<uint8_t>& in, BleFields& out) {
+    CborParser parser = { in, 0 };
+    out.clear();
+    return parser.map(out) && parser.pos == in.size();
+}
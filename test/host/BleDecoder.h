@@ -0,0 +1,65 @@
+/**
+ * BleDecoder.h
+ * Client-side decoding of TLV and CBOR response payloads for host tests
+ *
+ * Both encodings decode to the same tree, so a response can be compared
+ * field by field across them. Scalars keep the 32 bits that were sent:
+ * unsigned values as is, signed values two's complement, floats as
+ * their bit pattern and booleans as 0 or 1.
+ *
+ * TLV carries no types, so it is decoded against the tables BleSchema.h
+ * generates: the caller names the message ("CD", "FL", ...) and each tag
+ * is read as its schema type, with list records read as the message
+ * BT_SCHEMA_LISTS gives. Unlike a client in the field, which skips tags
+ * it does not know, the host decoder fails on them and on lengths that
+ * do not match the type, so a response that drifts from the schema is
+ * caught by the tests.
+ */
+
+#ifndef BLE_DECODER_H
+#define BLE_DECODER_H
+
+#include "BleSchema.h"
+#include <stddef.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+struct BleValue {
+    uint8_t tag;
+    bool isList;
+    bool isText;
+    uint32_t scalar;
+    std::string text;
+    std::vector<std::vector<BleValue>> records;
+
+    bool operator==(const BleValue& other) const;
+    bool operator!=(const BleValue& other) const { return !(*this == other); }
+};
+
+typedef std::vector<BleValue> BleFields;
+
+// Field and list tables to decode against; tests may build their own
+struct BleSchemaTables {
+    const BleFieldDesc* fields;
+    size_t fieldCount;
+    const BleListDesc* lists;
+    size_t listCount;
+};
+
+// The protocol's tables, from BleSchema.h
+const BleSchemaTables& bleProtocolSchema();
+
+const BleFieldDesc* findSchemaField(const char* message, uint8_t tag,
+                                    const BleSchemaTables& schema = bleProtocolSchema());
+const char* findListMessage(const char* message, uint8_t tag,
+                            const BleSchemaTables& schema = bleProtocolSchema());
+
+bool decodeTlv(const std::vector<uint8_t>& in, const char* message, BleFields& out,
+               const BleSchemaTables& schema = bleProtocolSchema());
+bool decodeCbor(const std::vector<uint8_t>& in, BleFields& out);
+
+const BleValue* findField(const BleFields& fields, uint8_t tag);
+float fieldFloat(const BleValue& value);
+
+#endif // BLE_DECODER_H
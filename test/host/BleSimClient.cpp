@@ -0,0 +1,264 @@
+/**
+ * BleSimClient.cpp
+ * Simulated BLE central for host tests and the link benchmark
+ */
+
+#include "BleSimClient.h"
+#include "BleProtocol.h"
+#include "Utils.h"
+
+extern BluetoothManager bluetoothManager;
+extern SystemStatus systemStatus;
+extern SystemSettings settings;
+
+static BleSimClient* activeClient = nullptr;
+static uint32_t sentAt[256];
+
+static uint32_t nowUs() {
+    return (uint32_t)hostMicros();
+}
+
+BleSimClient::BleSimClient() {
+    nextRequestId = 1;
+    commandSentUs = 0;
+}
+
+BleSimClient::~BleSimClient() {
+    if (activeClient != this) return;
+    if (bluetoothManager.isConnected()) disconnect();
+    bluetoothManager.setTransport(nullptr);
+    hostSetDelayHook(nullptr);
+    activeClient = nullptr;
+}
+
+// =============================================================================
+// LINK
+// =============================================================================
+
+void BleSimClient::begin(const SimLinkConfig& config) {
+    activeClient = this;
+    sim.advanceTo(nowUs());
+    sim.configure(config);
+    sim.setClient(onRx);
+    sim.setTxCompleteHandler(onTxComplete);
+    hostSetDelayHook(onDelay);
+
+    bluetoothManager.setTransport(&sim);
+    bluetoothManager.initialize(&systemStatus, &settings);
+    if (bluetoothManager.isConnected()) disconnect();
+    bluetoothConnectCallback(1);
+    clear();
+}
+
+void BleSimClient::disconnect(uint8_t reason) {
+    bluetoothDisconnectCallback(1, reason);
+    partial.clear();
+}
+
+void BleSimClient::clear() {
+    responses.clear();
+    packets.clear();
+    statusPackets.clear();
+    partial.clear();
+    sim.resetStats();
+}
+
+void BleSimClient::step(uint32_t us) {
+    hostAdvanceMicros(us);
+    sim.advanceTo(nowUs());
+    bluetoothManager.update();
+}
+
+bool BleSimClient::runUntil(const std::function<bool()>& done, uint32_t timeoutMs) {
+    uint32_t start = millis();
+    while (!done()) {
+        if (millis() - start >= timeoutMs) return false;
+        step();
+    }
+    return true;
+}
+
+void BleSimClient::onRx(const uint8_t* data, uint16_t len, bool status, uint32_t timeUs) {
+    if (activeClient) activeClient->receive(data, len, status, timeUs);
+}
+
+void BleSimClient::onTxComplete() {
+    bluetoothManager.onTxComplete();
+}
+
+void BleSimClient::onDelay() {
+    // The radio keeps draining while the firmware waits in delay()
+    if (activeClient) activeClient->sim.advanceTo(nowUs());
+}
+
+void BleSimClient::receive(const uint8_t* data, uint16_t len, bool status, uint32_t timeUs) {
+    SimPacket packet = { std::vector<uint8_t>(data, data + len), timeUs };
+    if (status) {
+        statusPackets.push_back(packet);
+        return;
+    }
+    if (len < BT_FRAME_HEADER_SIZE || data[0] < BT_RESP_OK || data[0] > BT_RESP_TIMEOUT) {
+        packets.push_back(packet);
+        return;
+    }
+
+    // Response frame: append to the request it answers
+    uint8_t requestId = data[1];
+    uint8_t control = data[2];
+    size_t i = 0;
+    while (i < partial.size() && partial[i].requestId != requestId) i++;
+    if (i == partial.size()) {
+        SimResponse fresh = { requestId, data[0], {}, 0, 0, sentAt[requestId], 0, false };
+        partial.push_back(fresh);
+    }
+    SimResponse& r = partial[i];
+
+    if ((control & BT_FRAME_SEQ_MASK) != (r.frames & BT_FRAME_SEQ_MASK)) r.seqError = true;
+    if (data[0] != r.code) {
+        // Abort frame: the device gave up part way through
+        r.code = data[0];
+        r.payload.clear();
+    }
+    r.payload.insert(r.payload.end(), data + BT_FRAME_HEADER_SIZE, data + len);
+    r.frames++;
+    r.bytes += len;
+
+    if (control & BT_FRAME_LAST) {
+        r.doneUs = timeUs;
+        responses.push_back(r);
+        partial.erase(partial.begin() + i);
+    }
+}
+
+// =============================================================================
+// REQUESTS
+// =============================================================================
+
+uint8_t BleSimClient::send(uint8_t command, const std::vector<uint8_t>& args, uint8_t flags) {
+    uint8_t requestId = nextRequestId;
+    nextRequestId = nextRequestId == 255 ? 1 : nextRequestId + 1;
+
+    std::vector<uint8_t> frame = { BT_FRAME_V2_MARKER, requestId, flags, command };
+    frame.insert(frame.end(), args.begin(), args.end());
+    sentAt[requestId] = nowUs();
+    sendRaw(frame);
+    return requestId;
+}
+
+void BleSimClient::sendRaw(const std::vector<uint8_t>& frame) {
+    commandSentUs = nowUs();
+    bluetoothManager.queueCommand(frame.data(), (uint16_t)frame.size());
+}
+
+const SimResponse* BleSimClient::request(uint8_t command, const std::vector<uint8_t>& args,
+                                         uint8_t count, uint32_t timeoutMs) {
+    uint8_t requestId = send(command, args);
+    if (!runUntil([&] { return responseCount(requestId) >= count; }, timeoutMs)) return nullptr;
+    return lastResponse(requestId);
+}
+
+uint8_t BleSimClient::responseCount(uint8_t requestId) const {
+    uint8_t n = 0;
+    for (const SimResponse& r : responses) {
+        if (r.requestId == requestId) n++;
+    }
+    return n;
+}
+
+const SimResponse* BleSimClient::lastResponse(uint8_t requestId) const {
+    for (size_t i = responses.size(); i > 0; i--) {
+        if (responses[i - 1].requestId == requestId) return &responses[i - 1];
+    }
+    return nullptr;
+}
+
+const SimPacket* BleSimClient::findPacket(uint8_t type, size_t from) const {
+    for (size_t i = from; i < packets.size(); i++) {
+        if (!packets[i].data.empty() && packets[i].data[0] == type) return &packets[i];
+    }
+    return nullptr;
+}
+
+// =============================================================================
+// WINDOWED TRANSFER
+// =============================================================================
+
+bool BleSimClient::download(const char* name, uint32_t offset, uint8_t window, SimDownload& out,
+                            uint32_t stopAfter, uint32_t timeoutMs) {
+    std::vector<uint8_t> args(5);
+    putU32LE(&args[0], offset);
+    args[4] = window;
+    args.insert(args.end(), name, name + strlen(name));
+
+    size_t scanned = packets.size();
+    const SimResponse* reply = request(BT_CMD_TRANSFER_START, args);
+    if (!reply || reply->code != BT_RESP_OK || reply->payload.size() < 13) return false;
+
+    // [transferId][fileSize u32][startOffset u32][payloadSize u16][totalChunks u16]
+    const uint8_t* info = reply->payload.data();
+    uint8_t transferId = info[0];
+    out.fileSize = getU32LE(&info[1]);
+    uint16_t totalChunks = getU16LE(&info[11]);
+    out.data.resize(getU32LE(&info[5]));
+    out.complete = false;
+    out.readError = false;
+    out.acksSent = 0;
+    out.duplicates = 0;
+
+    uint16_t expected = 0;
+    uint16_t sinceAck = 0;
+    uint16_t ackEvery = max(1, window / 2);
+    uint32_t lastProgressMs = millis();
+    uint32_t startMs = millis();
+
+    auto ack = [&] {
+        std::vector<uint8_t> frame = { BT_FRAME_V2_MARKER, 0, 0, BT_CMD_TRANSFER_ACK, transferId, 0, 0 };
+        putU16LE(&frame[5], expected);
+        sendRaw(frame);
+        out.acksSent++;
+        sinceAck = 0;
+    };
+
+    while (millis() - startMs < timeoutMs) {
+        step();
+        for (; scanned < packets.size(); scanned++) {
+            const std::vector<uint8_t>& p = packets[scanned].data;
+            if (p.size() < 2 || p[1] != transferId) continue;
+
+            if (p[0] == BT_RESP_TRANSFER_END && p.size() >= 12) {
+                out.crc = getU32LE(&p[8]);
+                out.complete = true;
+                return true;
+            }
+            if (p[0] == BT_RESP_TRANSFER_ERROR && p.size() >= 4) {
+                out.readError = true;
+                return false;
+            }
+            if (p[0] != BT_RESP_TRANSFER_DATA || p.size() < BT_XFER_HEADER_SIZE) continue;
+
+            uint16_t seq = getU16LE(&p[2]);
+            if (seq != expected) {
+                // Go-back-N: a gap is answered with the sequence still needed
+                if (seq > expected) {
+                    ack();
+                } else {
+                    out.duplicates++;
+                }
+                continue;
+            }
+            out.data.insert(out.data.end(), p.begin() + BT_XFER_HEADER_SIZE, p.end());
+            expected++;
+            sinceAck++;
+            lastProgressMs = millis();
+            if (sinceAck >= ackEvery || expected == totalChunks) ack();
+            if (stopAfter && expected >= stopAfter) return false;
+        }
+
+        // Lost ACKs are recovered by the sender's timeout; repeat ours too
+        if (millis() - lastProgressMs > BT_XFER_ACK_TIMEOUT_MS / 2) {
+            ack();
+            lastProgressMs = millis();
+        }
+    }
+    return false;
+}
@@ -0,0 +1,92 @@
+/**
+ * BleSimClient.h
+ * Simulated BLE central for host tests and the link benchmark
+ *
+ * Drives the global BluetoothManager over a SimTransport. step() advances
+ * the virtual clock, runs the link up to it and calls update(), which is
+ * what the BLE task does on the device. Response frames are reassembled
+ * per request id; every other notification is kept as a raw packet.
+ */
+
+#ifndef BLE_SIM_CLIENT_H
+#define BLE_SIM_CLIENT_H
+
+#include "BleTransport.h"
+#include <functional>
+#include <vector>
+
+#define SIM_STEP_US 1000                 // One BLE task pass
+#define SIM_DEFAULT_TIMEOUT_MS 30000
+
+struct SimPacket {
+    std::vector<uint8_t> data;
+    uint32_t timeUs;
+};
+
+struct SimResponse {
+    uint8_t requestId;
+    uint8_t code;
+    std::vector<uint8_t> payload;
+    uint16_t frames;
+    uint32_t bytes;              // On air, frame headers included
+    uint32_t sentUs;
+    uint32_t doneUs;
+    bool seqError;               // A frame was missing or out of order
+};
+
+struct SimDownload {
+    std::vector<uint8_t> data;
+    uint32_t fileSize;
+    uint32_t crc;                // From the end packet
+    uint32_t acksSent;
+    uint32_t duplicates;
+    bool complete;
+    bool readError;              // Ended by BT_RESP_TRANSFER_ERROR
+};
+
+class BleSimClient {
+private:
+    std::vector<SimResponse> partial;
+    uint8_t nextRequestId;
+    uint32_t commandSentUs;
+
+    static void onRx(const uint8_t* data, uint16_t len, bool status, uint32_t timeUs);
+    static void onTxComplete();
+    static void onDelay();
+    void receive(const uint8_t* data, uint16_t len, bool status, uint32_t timeUs);
+
+public:
+    SimTransport sim;
+    std::vector<SimResponse> responses;   // Completed, in arrival order
+    std::vector<SimPacket> packets;       // Data channel, not response frames
+    std::vector<SimPacket> statusPackets;
+
+    BleSimClient();
+    ~BleSimClient();
+
+    // Configures the link, initializes the manager if needed and connects
+    void begin(const SimLinkConfig& config);
+    void disconnect(uint8_t reason = 0x13);
+    void clear();
+
+    void step(uint32_t us = SIM_STEP_US);
+    bool runUntil(const std::function<bool()>& done, uint32_t timeoutMs = SIM_DEFAULT_TIMEOUT_MS);
+
+    // v2 request; returns the request id used
+    uint8_t send(uint8_t command, const std::vector<uint8_t>& args = {}, uint8_t flags = 0);
+    void sendRaw(const std::vector<uint8_t>& frame);
+
+    // Sends and waits for the given number of responses to this request
+    const SimResponse* request(uint8_t command, const std::vector<uint8_t>& args = {},
+                               uint8_t count = 1, uint32_t timeoutMs = SIM_DEFAULT_TIMEOUT_MS);
+    uint8_t responseCount(uint8_t requestId) const;
+    const SimResponse* lastResponse(uint8_t requestId) const;
+    const SimPacket* findPacket(uint8_t type, size_t from = 0) const;
+
+    // Windowed transfer with cumulative ACKs; drops the link part way
+    // through when stopAfter is non-zero so resume can be exercised
+    bool download(const char* name, uint32_t offset, uint8_t window, SimDownload& out,
+                  uint32_t stopAfter = 0, uint32_t timeoutMs = SIM_DEFAULT_TIMEOUT_MS);
+};
+
+#endif // BLE_SIM_CLIENT_H
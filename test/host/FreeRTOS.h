@@ -0,0 +1,87 @@
+/**
+ * FreeRTOS.h
+ * Host port of the FreeRTOS calls the firmware makes, on POSIX threads
+ *
+ * Tasks are pthreads and run concurrently; priorities are recorded but
+ * not enforced. A tick is 1 ms of wall-clock time, so threaded tests
+ * should switch the Arduino clock to real time with hostUseRealTime().
+ *
+ * Each task gets a host stack of its FreeRTOS size times
+ * HOST_STACK_SCALE (x86-64 frames and libc need more than a Cortex-M4),
+ * painted before the task starts. uxTaskGetStackHighWaterMark() scales
+ * the untouched part back, so it reads in device words and can be
+ * compared with the TASK_STACK_* sizes. It is a guide, not the device
+ * figure.
+ *
+ * semphr.h, queue.h and task.h include this header, as on the device.
+ */
+
+#ifndef HOST_FREERTOS_H
+#define HOST_FREERTOS_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+typedef uint32_t TickType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+typedef struct HostTask* TaskHandle_t;
+typedef struct HostSemaphore* SemaphoreHandle_t;
+typedef struct HostQueue* QueueHandle_t;
+typedef void (*TaskFunction_t)(void* arg);
+
+#define pdFALSE 0
+#define pdTRUE 1
+#define pdPASS pdTRUE
+#define pdFAIL pdFALSE
+#define portMAX_DELAY 0xFFFFFFFFUL
+#define configTICK_RATE_HZ 1000
+#define pdMS_TO_TICKS(ms) ((TickType_t)(ms))
+#define portYIELD_FROM_ISR(woken) ((void)(woken))
+
+// As defined by the Adafruit nRF52 core
+#define TASK_PRIO_LOWEST 0
+#define TASK_PRIO_LOW 1
+#define TASK_PRIO_NORMAL 2
+#define TASK_PRIO_HIGH 3
+
+#define HOST_STACK_SCALE 8
+
+// =============================================================================
+// TASKS
+// =============================================================================
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackWords, void* arg,
+                       UBaseType_t priority, TaskHandle_t* handle);
+TaskHandle_t xTaskGetCurrentTaskHandle();
+TickType_t xTaskGetTickCount();
+void vTaskDelay(TickType_t ticks);
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period);
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task);
+
+void xTaskNotifyGive(TaskHandle_t task);
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken);
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks);
+
+// =============================================================================
+// SEMAPHORES
+// =============================================================================
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* woken);
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t sem);
+
+// =============================================================================
+// QUEUES
+// =============================================================================
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize);
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#endif // HOST_FREERTOS_H
@@ -0,0 +1,318 @@
+/**
+ * HostArduino.cpp
+ * Virtual clock, pins and Print for the host build
+ */
+
+#include <Arduino.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+HardwareSerial Serial;
+
+static std::atomic<uint64_t> clockUs(0);
+static std::atomic<bool> realTime(false);
+static std::chrono::steady_clock::time_point realStart = std::chrono::steady_clock::now();
+static uint64_t realOffsetUs = 0;
+
+static int pinLevel[HOST_PIN_COUNT];
+static int analogLevel[HOST_PIN_COUNT];
+static void (*pinHandler[HOST_PIN_COUNT])(void);
+static int (*analogSource)(int pin, uint64_t us) = nullptr;
+static void (*delayHook)() = nullptr;
+static uint32_t rng = 1;
+static std::mutex serialMutex;
+static const bool serialEcho = getenv("HOST_SERIAL") != nullptr;
+
+// Pull-ups high and the battery reading sane before any test runs
+static struct HostArduinoInit {
+    HostArduinoInit() { hostResetArduino(); }
+} hostArduinoInit;
+
+// =============================================================================
+// CLOCK
+// =============================================================================
+
+uint64_t hostMicros() {
+    if (!realTime) return clockUs;
+    auto elapsed = std::chrono::steady_clock::now() - realStart;
+    return realOffsetUs + std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+}
+
+void hostSetMicros(uint64_t us) {
+    clockUs = us;
+}
+
+void hostAdvanceMicros(uint64_t us) {
+    clockUs += us;
+}
+
+void hostAdvanceMillis(uint64_t ms) {
+    clockUs += ms * 1000ULL;
+}
+
+void hostUseRealTime(bool on) {
+    if (on == realTime) return;
+    if (on) {
+        realOffsetUs = clockUs;
+        realStart = std::chrono::steady_clock::now();
+    } else {
+        clockUs = hostMicros();
+    }
+    realTime = on;
+}
+
+unsigned long millis() {
+    return (unsigned long)(hostMicros() / 1000ULL);
+}
+
+unsigned long micros() {
+    return (unsigned long)hostMicros();
+}
+
+void hostSetDelayHook(void (*hook)()) {
+    delayHook = hook;
+}
+
+void delay(unsigned long ms) {
+    if (realTime) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+    } else {
+        hostAdvanceMillis(ms);
+        if (delayHook) delayHook();
+    }
+}
+
+void delayMicroseconds(unsigned int us) {
+    if (realTime) {
+        std::this_thread::sleep_for(std::chrono::microseconds(us));
+    } else {
+        hostAdvanceMicros(us);
+    }
+}
+
+void yield() {
+    if (realTime) std::this_thread::yield();
+}
+
+// =============================================================================
+// PINS
+// =============================================================================
+
+static bool validPin(int pin) {
+    return pin >= 0 && pin < HOST_PIN_COUNT;
+}
+
+void pinMode(int pin, int mode) {
+    // Pull-ups read high until the test drives the pin
+    if (validPin(pin) && mode == INPUT_PULLUP) pinLevel[pin] = HIGH;
+}
+
+void digitalWrite(int pin, int value) {
+    if (validPin(pin)) pinLevel[pin] = value;
+}
+
+int digitalRead(int pin) {
+    return validPin(pin) ? pinLevel[pin] : LOW;
+}
+
+int analogRead(int pin) {
+    if (!validPin(pin)) return 0;
+    if (analogSource) return analogSource(pin, hostMicros());
+    return analogLevel[pin];
+}
+
+void analogReadResolution(int bits) {
+    (void)bits;
+}
+
+void attachInterrupt(int pin, void (*handler)(void), int mode) {
+    (void)mode;
+    if (validPin(pin)) pinHandler[pin] = handler;
+}
+
+void detachInterrupt(int pin) {
+    if (validPin(pin)) pinHandler[pin] = nullptr;
+}
+
+void hostSetPin(int pin, int level) {
+    if (validPin(pin)) pinLevel[pin] = level;
+}
+
+int hostGetPin(int pin) {
+    return validPin(pin) ? pinLevel[pin] : LOW;
+}
+
+void hostSetAnalog(int pin, int value) {
+    if (validPin(pin)) analogLevel[pin] = value;
+}
+
+void hostSetAnalogSource(int (*source)(int pin, uint64_t us)) {
+    analogSource = source;
+}
+
+bool hostFireInterrupt(int pin) {
+    if (!validPin(pin) || !pinHandler[pin]) return false;
+    pinHandler[pin]();
+    return true;
+}
+
+void hostResetArduino() {
+    realTime = false;
+    clockUs = 0;
+    analogSource = nullptr;
+    delayHook = nullptr;
+    rng = 1;
+    for (int i = 0; i < HOST_PIN_COUNT; i++) {
+        pinLevel[i] = HIGH;
+        analogLevel[i] = 2048;
+        pinHandler[i] = nullptr;
+    }
+    // About 3.9 V through the battery divider
+    analogLevel[A6] = 2220;
+}
+
+// =============================================================================
+// MISC
+// =============================================================================
+
+long map(long x, long inMin, long inMax, long outMin, long outMax) {
+    return (x - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+long random(long max) {
+    if (max <= 0) return 0;
+    rng = rng * 1103515245u + 12345u;
+    return (long)((rng >> 8) % (uint32_t)max);
+}
+
+long random(long min, long max) {
+    return min >= max ? min : min + random(max - min);
+}
+
+void randomSeed(unsigned long seed) {
+    rng = (uint32_t)seed ? (uint32_t)seed : 1;
+}
+
+void noInterrupts() {}
+void interrupts() {}
+
+// =============================================================================
+// STRING
+// =============================================================================
+
+String::String(const char* text) : s(text ? text : "") {}
+String::String(int value) : s(std::to_string(value)) {}
+String::String(unsigned int value) : s(std::to_string(value)) {}
+String::String(long value) : s(std::to_string(value)) {}
+String::String(unsigned long value) : s(std::to_string(value)) {}
+
+String::String(double value, int decimals) {
+    char buffer[48];
+    snprintf(buffer, sizeof(buffer), "%.*f", decimals, value);
+    s = buffer;
+}
+
+String& String::operator+=(const String& other) { s += other.s; return *this; }
+String& String::operator+=(const char* text) { s += text; return *this; }
+String& String::operator+=(int value) { s += std::to_string(value); return *this; }
+String& String::operator+=(unsigned long value) { s += std::to_string(value); return *this; }
+String& String::operator+=(long value) { s += std::to_string(value); return *this; }
+String& String::operator+=(unsigned int value) { s += std::to_string(value); return *this; }
+
+String operator+(const String& a, const String& b) { return String(a.s + b.s); }
+String operator+(const char* a, const String& b) { return String(std::string(a) + b.s); }
+String operator+(const String& a, const char* b) { return String(a.s + b); }
+
+// =============================================================================
+// PRINT
+// =============================================================================
+
+size_t Print::write(const uint8_t* buffer, size_t size) {
+    size_t n = 0;
+    while (size--) n += write(*buffer++);
+    return n;
+}
+
+size_t Print::printNumber(unsigned long long value, int base) {
+    if (base < 2) base = 10;
+    char buffer[66];
+    char* p = &buffer[sizeof(buffer) - 1];
+    *p = '\0';
+    do {
+        int digit = (int)(value % base);
+        *--p = digit < 10 ? '0' + digit : 'A' + digit - 10;
+        value /= base;
+    } while (value);
+    return print(p);
+}
+
+size_t Print::print(const char* text) {
+    return write((const uint8_t*)text, strlen(text));
+}
+
+size_t Print::print(const String& text) {
+    return print(text.c_str());
+}
+
+size_t Print::print(char c) {
+    return write((uint8_t)c);
+}
+
+size_t Print::print(double value, int digits) {
+    char buffer[64];
+    snprintf(buffer, sizeof(buffer), "%.*f", digits, value);
+    return print(buffer);
+}
+
+size_t Print::print(int value, int base) {
+    return print((long long)value, base);
+}
+
+size_t Print::print(unsigned int value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::print(long value, int base) {
+    return print((long long)value, base);
+}
+
+size_t Print::print(unsigned long value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::print(long long value, int base) {
+    if (base == DEC && value < 0) {
+        return print('-') + printNumber((unsigned long long)(-value), base);
+    }
+    return printNumber((unsigned long long)value, base);
+}
+
+size_t Print::print(unsigned long long value, int base) {
+    return printNumber(value, base);
+}
+
+size_t Print::println() {
+    return print("\r\n");
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+    if (serialEcho) {
+        std::lock_guard<std::mutex> guard(serialMutex);
+        fputc(c, stdout);
+    }
+    return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buffer, size_t size) {
+    if (serialEcho) {
+        std::lock_guard<std::mutex> guard(serialMutex);
+        fwrite(buffer, 1, size, stdout);
+    }
+    return size;
+}
+
+void HardwareSerial::flush() {
+    if (serialEcho) fflush(stdout);
+}
@@ -0,0 +1,366 @@
+/**
+ * HostDevices.cpp
+ * Buses, RTC, the in-memory SD card and internal flash for the host build
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+#include <SPI.h>
+#include <SD.h>
+#include <RTClib.h>
+#include <InternalFileSystem.h>
+#include <map>
+
+TwoWire Wire;
+SPIClass SPI;
+SDLib::SDClass SD;
+InternalFileSystem InternalFS;
+
+// =============================================================================
+// DATETIME
+// =============================================================================
+
+// Days since 1970-01-01 for a civil date (proleptic Gregorian)
+static int32_t daysFromCivil(int32_t y, uint32_t m, uint32_t d) {
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+DateTime::DateTime(uint32_t t) {
+    int32_t z = (int32_t)(t / 86400) + 719468;
+    uint32_t secs = t % 86400;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    d = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    m = (uint8_t)(mp < 10 ? mp + 3 : mp - 9);
+    y = (uint16_t)(yoe + era * 400 + (m <= 2));
+    hh = secs / 3600;
+    mm = (secs / 60) % 60;
+    ss = secs % 60;
+}
+
+DateTime::DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t min, uint8_t sec)
+    : y(year), m(month), d(day), hh(hour), mm(min), ss(sec) {
+    if (y < 100) y += 2000;
+}
+
+DateTime::DateTime(const char* date, const char* time) {
+    // "Mmm dd yyyy", "hh:mm:ss" as in __DATE__ and __TIME__
+    static const char months[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    const char* found = strstr(months, std::string(date, 3).c_str());
+    m = found ? (uint8_t)((found - months) / 3 + 1) : 1;
+    d = (uint8_t)atoi(date + 4);
+    y = (uint16_t)atoi(date + 7);
+    hh = (uint8_t)atoi(time);
+    mm = (uint8_t)atoi(time + 3);
+    ss = (uint8_t)atoi(time + 6);
+}
+
+uint8_t DateTime::dayOfTheWeek() const {
+    // 1970-01-01 was a Thursday; Sunday is 0
+    return (uint8_t)((daysFromCivil(y, m, d) + 4) % 7);
+}
+
+uint32_t DateTime::unixtime() const {
+    return (uint32_t)daysFromCivil(y, m, d) * 86400UL + hh * 3600UL + mm * 60UL + ss;
+}
+
+bool DateTime::isValid() const {
+    return y >= 2000 && m >= 1 && m <= 12 && d >= 1 && d <= 31 && hh < 24 && mm < 60 && ss < 60;
+}
+
+String DateTime::timestamp(timestampOpt opt) const {
+    // Room for any uint16_t year and uint8_t fields, valid or not
+    char buffer[32];
+    switch (opt) {
+        case TIMESTAMP_TIME:
+            snprintf(buffer, sizeof(buffer), "%02u:%02u:%02u", hh, mm, ss);
+            break;
+        case TIMESTAMP_DATE:
+            snprintf(buffer, sizeof(buffer), "%u-%02u-%02u", y, m, d);
+            break;
+        default:
+            snprintf(buffer, sizeof(buffer), "%u-%02u-%02uT%02u:%02u:%02u", y, m, d, hh, mm, ss);
+            break;
+    }
+    return String(buffer);
+}
+
+void RTC_PCF8523::adjust(const DateTime& dt) {
+    baseUnix = dt.unixtime();
+    baseMicros = hostMicros();
+    set = true;
+}
+
+DateTime RTC_PCF8523::now() {
+    return DateTime(baseUnix + (uint32_t)((hostMicros() - baseMicros) / 1000000ULL));
+}
+
+// =============================================================================
+// SD CARD
+// =============================================================================
+
+struct HostSdNode {
+    bool directory;
+    std::vector<uint8_t> data;
+};
+
+static std::map<std::string, std::shared_ptr<HostSdNode>> sdTree;
+
+static std::string normalise(const char* path) {
+    std::string p = path ? path : "/";
+    if (p.empty() || p[0] != '/') p = "/" + p;
+    while (p.size() > 1 && p.back() == '/') p.pop_back();
+    return p;
+}
+
+static std::string parentOf(const std::string& path) {
+    size_t slash = path.find_last_of('/');
+    return slash == 0 ? "/" : path.substr(0, slash);
+}
+
+static std::shared_ptr<HostSdNode> rootNode() {
+    auto& root = sdTree["/"];
+    if (!root) {
+        root = std::make_shared<HostSdNode>();
+        root->directory = true;
+    }
+    return root;
+}
+
+void hostSdReset() {
+    sdTree.clear();
+    SD.mounted = false;
+}
+
+size_t hostSdFileSize(const char* path) {
+    auto it = sdTree.find(normalise(path));
+    return it == sdTree.end() ? 0 : it->second->data.size();
+}
+
+namespace SDLib {
+
+File::File() : pos(0), writable(false) {}
+
+File::File(std::shared_ptr<HostSdNode> n, const std::string& p, bool w)
+    : node(n), path(p), pos(0), writable(w) {
+    size_t slash = p.find_last_of('/');
+    baseName = p == "/" ? "/" : p.substr(slash + 1);
+    if (writable) pos = (uint32_t)node->data.size();
+}
+
+bool File::isDirectory() {
+    return node && node->directory;
+}
+
+File File::openNextFile(uint8_t mode) {
+    (void)mode;
+    if (!isDirectory()) return File();
+    // Resumes after the last child, so a full listing is one pass
+    std::string prefix = path == "/" ? "/" : path + "/";
+    auto it = listedLast.empty() ? sdTree.lower_bound(prefix) : sdTree.upper_bound(listedLast);
+    for (; it != sdTree.end(); ++it) {
+        const std::string& p = it->first;
+        if (p.compare(0, prefix.size(), prefix) != 0) break;
+        if (p == prefix || p.size() == prefix.size()) continue;
+        if (p.find('/', prefix.size()) != std::string::npos) continue;
+        listedLast = p;
+        return File(it->second, p, false);
+    }
+    return File();
+}
+
+void File::close() {
+    node.reset();
+}
+
+uint32_t File::size() {
+    return node ? (uint32_t)node->data.size() : 0;
+}
+
+bool File::seek(uint32_t position) {
+    if (!node || !SD.mounted || position > node->data.size()) return false;
+    pos = position;
+    return true;
+}
+
+int File::available() {
+    return node ? (int)(node->data.size() - pos) : 0;
+}
+
+int File::read() {
+    if (!node || !SD.mounted || pos >= node->data.size()) return -1;
+    return node->data[pos++];
+}
+
+int File::read(void* buffer, uint16_t len) {
+    if (!node || !SD.mounted || node->directory) return -1;
+    uint32_t n = min((uint32_t)len, (uint32_t)(node->data.size() - pos));
+    memcpy(buffer, node->data.data() + pos, n);
+    pos += n;
+    return (int)n;
+}
+
+size_t File::write(uint8_t c) {
+    return write(&c, 1);
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!node || !writable || node->directory) return 0;
+    if (pos + size > node->data.size()) node->data.resize(pos + size);
+    memcpy(node->data.data() + pos, buffer, size);
+    pos += (uint32_t)size;
+    return size;
+}
+
+int File::peek() {
+    if (!node || pos >= node->data.size()) return -1;
+    return node->data[pos];
+}
+
+bool SDClass::begin(uint8_t cs) {
+    (void)cs;
+    mounted = present;
+    if (mounted) rootNode();
+    return mounted;
+}
+
+File SDClass::open(const char* path, uint8_t mode) {
+    if (!mounted) return File();
+    std::string p = normalise(path);
+    auto it = sdTree.find(p);
+    if (it != sdTree.end()) {
+        return File(it->second, p, mode == FILE_WRITE && !it->second->directory);
+    }
+    if (mode != FILE_WRITE) return File();
+
+    // Created in an existing directory only, as on a FAT card
+    auto parent = sdTree.find(parentOf(p));
+    if (parent == sdTree.end() || !parent->second->directory) return File();
+    auto node = std::make_shared<HostSdNode>();
+    node->directory = false;
+    sdTree[p] = node;
+    return File(node, p, true);
+}
+
+bool SDClass::exists(const char* path) {
+    return mounted && sdTree.count(normalise(path)) > 0;
+}
+
+bool SDClass::mkdir(const char* path) {
+    if (!mounted) return false;
+    // Makes the missing parents too, as SdFat does
+    std::string p = normalise(path);
+    for (size_t slash = 1; slash != std::string::npos; ) {
+        slash = p.find('/', slash + 1);
+        std::string part = p.substr(0, slash);
+        auto& node = sdTree[part];
+        if (!node) {
+            node = std::make_shared<HostSdNode>();
+            node->directory = true;
+        } else if (!node->directory) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool SDClass::remove(const char* path) {
+    if (!mounted) return false;
+    auto it = sdTree.find(normalise(path));
+    if (it == sdTree.end() || it->second->directory) return false;
+    sdTree.erase(it);
+    return true;
+}
+
+bool SDClass::rmdir(const char* path) {
+    if (!mounted) return false;
+    std::string p = normalise(path);
+    auto it = sdTree.find(p);
+    if (it == sdTree.end() || !it->second->directory || p == "/") return false;
+    auto child = sdTree.upper_bound(p + "/");
+    if (child != sdTree.end() && child->first.compare(0, p.size() + 1, p + "/") == 0) return false;
+    sdTree.erase(it);
+    return true;
+}
+
+} // namespace SDLib
+
+// =============================================================================
+// INTERNAL FLASH
+// =============================================================================
+
+static std::map<std::string, std::shared_ptr<std::vector<uint8_t>>> flashFiles;
+
+void hostFlashReset() {
+    flashFiles.clear();
+}
+
+size_t hostFlashFileSize(const char* path) {
+    auto it = flashFiles.find(normalise(path));
+    return it == flashFiles.end() ? 0 : it->second->size();
+}
+
+bool Adafruit_LittleFS::exists(const char* path) {
+    return flashFiles.count(normalise(path)) > 0;
+}
+
+bool Adafruit_LittleFS::remove(const char* path) {
+    return flashFiles.erase(normalise(path)) > 0;
+}
+
+bool Adafruit_LittleFS::format() {
+    flashFiles.clear();
+    return true;
+}
+
+namespace Adafruit_LittleFS_Namespace {
+
+bool File::open(const char* path, uint8_t mode) {
+    std::string p = normalise(path);
+    auto it = flashFiles.find(p);
+    if (it == flashFiles.end()) {
+        if (mode != FILE_O_WRITE) return false;
+        it = flashFiles.emplace(p, std::make_shared<std::vector<uint8_t>>()).first;
+    }
+    data = it->second;
+    writable = mode == FILE_O_WRITE;
+    pos = writable ? (uint32_t)data->size() : 0;
+    return true;
+}
+
+bool File::seek(uint32_t position) {
+    if (!data || position > data->size()) return false;
+    pos = position;
+    return true;
+}
+
+int File::read() {
+    if (!data || pos >= data->size()) return -1;
+    return (*data)[pos++];
+}
+
+int File::read(void* buffer, uint16_t len) {
+    if (!data) return -1;
+    uint32_t n = min((uint32_t)len, (uint32_t)(data->size() - pos));
+    memcpy(buffer, data->data() + pos, n);
+    pos += n;
+    return (int)n;
+}
+
+size_t File::write(const uint8_t* buffer, size_t size) {
+    if (!data || !writable) return 0;
+    if (pos + size > data->size()) data->resize(pos + size);
+    memcpy(data->data() + pos, buffer, size);
+    pos += (uint32_t)size;
+    return size;
+}
+
+} // namespace Adafruit_LittleFS_Namespace
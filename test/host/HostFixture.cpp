@@ -0,0 +1,58 @@
+/**
+ * HostFixture.cpp
+ * Device state shared by the host tests and the benchmark
+ */
+
+#include "HostFixture.h"
+#include "Settings.h"
+#include "RecordStore.h"
+#include <SD.h>
+#include <RTClib.h>
+
+extern SystemSettings settings;
+extern SystemStatus systemStatus;
+extern RTC_PCF8523 rtc;
+
+void hostBootDevice() {
+    settings = getDefaultSettings();
+    systemStatus.sdWorking = SD.begin(SD_CS_PIN);
+    systemStatus.rtcWorking = rtc.begin();
+    recordStore.invalidate();
+}
+
+std::vector<uint8_t> hostWriteFile(const char* path, uint32_t size, uint32_t seed) {
+    std::vector<uint8_t> bytes;
+    bytes.reserve(size);
+    uint32_t x = seed ? seed : 1;
+    while (bytes.size() < size) {
+        char line[64];
+        x = x * 1103515245u + 12345u;
+        int n = snprintf(line, sizeof(line), "%lu,%.2f,%.1f,%u\r\n",
+                         (unsigned long)(bytes.size() / 24), 20 + (x >> 20) % 1500 / 100.0,
+                         40 + (x >> 8) % 500 / 10.0, (unsigned)(x % 1000));
+        for (int i = 0; i < n && bytes.size() < size; i++) bytes.push_back((uint8_t)line[i]);
+    }
+
+    SD.remove(path);
+    SDLib::File file = SD.open(path, FILE_WRITE);
+    if (file) {
+        file.write(bytes.data(), bytes.size());
+        file.close();
+    }
+    return bytes;
+}
+
+void hostAppendRecords(uint32_t count, uint32_t intervalS) {
+    uint32_t start = rtc.now().unixtime();
+    SensorData data = {};
+    data.sensorsValid = true;
+    for (uint32_t i = 0; i < count; i++) {
+        data.temperature = 20 + (i % 50) * 0.1f;
+        data.humidity = 55 + (i % 20);
+        data.pressure = 1013 + (i % 7);
+        data.batteryVoltage = 3.9f - i * 0.0001f;
+        data.dominantFreq = 220 + i % 100;
+        data.soundLevel = i % 100;
+        recordStore.append(data, start + i * intervalS);
+    }
+}
@@ -0,0 +1,25 @@
+/**
+ * HostFixture.h
+ * Device state shared by the host tests and the benchmark
+ *
+ * hostBootDevice() leaves the firmware globals as setup() would on a
+ * healthy unit: default settings, RTC and a mounted card. The helpers
+ * below fill the card with data the BLE commands can serve.
+ */
+
+#ifndef HOST_FIXTURE_H
+#define HOST_FIXTURE_H
+
+#include "Config.h"
+#include "DataStructures.h"
+#include <vector>
+
+void hostBootDevice();
+
+// Writes size bytes of CSV-like text; the same seed gives the same bytes
+std::vector<uint8_t> hostWriteFile(const char* path, uint32_t size, uint32_t seed = 1);
+
+// Appends count records one interval apart, starting at the RTC time
+void hostAppendRecords(uint32_t count, uint32_t intervalS = 600);
+
+#endif // HOST_FIXTURE_H
@@ -0,0 +1,251 @@
+/**
+ * HostFreeRTOS.cpp
+ * FreeRTOS tasks, semaphores, queues and notifications on POSIX threads
+ */
+
+#include "FreeRTOS.h"
+#include <pthread.h>
+#include <string.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#define STACK_PAINT 0xA5
+
+struct HostTask {
+    pthread_t thread;
+    TaskFunction_t fn;
+    void* arg;
+    const char* name;
+    UBaseType_t priority;
+
+    std::mutex m;
+    std::condition_variable cv;
+    uint32_t notifications;
+
+    uint8_t* stack;              // Lowest address; the stack grows down to it
+    size_t stackBytes;
+};
+
+struct HostSemaphore {
+    std::mutex m;
+    std::condition_variable cv;
+    UBaseType_t count;
+    bool isMutex;
+    TaskHandle_t holder;
+};
+
+struct HostQueue {
+    std::mutex m;
+    std::condition_variable cv;
+    UBaseType_t length;
+    UBaseType_t itemSize;
+    std::deque<std::vector<uint8_t>> items;
+};
+
+// Threads the port did not start (main, test threads) get a handle on
+// first use, so mutex holders and notifications work for them too
+static thread_local TaskHandle_t currentTask = nullptr;
+static const auto tickStart = std::chrono::steady_clock::now();
+
+// True once the predicate holds; waits forever for portMAX_DELAY
+template <typename Pred>
+static bool waitFor(std::condition_variable& cv, std::unique_lock<std::mutex>& lock,
+                    TickType_t ticks, Pred pred) {
+    if (ticks == portMAX_DELAY) {
+        cv.wait(lock, pred);
+        return true;
+    }
+    return cv.wait_for(lock, std::chrono::milliseconds(ticks), pred);
+}
+
+// =============================================================================
+// TASKS
+// =============================================================================
+
+static void* taskEntry(void* param) {
+    TaskHandle_t task = (TaskHandle_t)param;
+    currentTask = task;
+    task->fn(task->arg);
+    return nullptr;              // FreeRTOS tasks never return; nothing to clean up
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char* name, uint32_t stackWords, void* arg,
+                       UBaseType_t priority, TaskHandle_t* handle) {
+    TaskHandle_t task = new HostTask();
+    task->fn = fn;
+    task->arg = arg;
+    task->name = name;
+    task->priority = priority;
+    task->notifications = 0;
+    task->stackBytes = (size_t)stackWords * 4 * HOST_STACK_SCALE;
+    if (task->stackBytes < (size_t)PTHREAD_STACK_MIN) task->stackBytes = PTHREAD_STACK_MIN;
+    task->stack = new uint8_t[task->stackBytes];
+    memset(task->stack, STACK_PAINT, task->stackBytes);
+
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstack(&attr, task->stack, task->stackBytes);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int err = pthread_create(&task->thread, &attr, taskEntry, task);
+    pthread_attr_destroy(&attr);
+    if (err != 0) {
+        delete[] task->stack;
+        delete task;
+        return pdFAIL;
+    }
+    if (handle) *handle = task;
+    return pdPASS;
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    if (!currentTask) {
+        currentTask = new HostTask();
+        currentTask->thread = pthread_self();
+        currentTask->name = "host";
+        currentTask->notifications = 0;
+        currentTask->stack = nullptr;
+        currentTask->stackBytes = 0;
+    }
+    return currentTask;
+}
+
+TickType_t xTaskGetTickCount() {
+    auto elapsed = std::chrono::steady_clock::now() - tickStart;
+    return (TickType_t)std::chrono::duration_cast<std::chrono::milliseconds>(elapsed).count();
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+void vTaskDelayUntil(TickType_t* previousWake, TickType_t period) {
+    *previousWake += period;
+    long remaining = (long)(*previousWake - xTaskGetTickCount());
+    if (remaining > 0) vTaskDelay((TickType_t)remaining);
+}
+
+UBaseType_t uxTaskGetStackHighWaterMark(TaskHandle_t task) {
+    if (!task) task = xTaskGetCurrentTaskHandle();
+    if (!task->stack) return 0;
+
+    size_t untouched = 0;
+    while (untouched < task->stackBytes && task->stack[untouched] == STACK_PAINT) untouched++;
+    return (UBaseType_t)(untouched / 4 / HOST_STACK_SCALE);
+}
+
+void xTaskNotifyGive(TaskHandle_t task) {
+    {
+        std::lock_guard<std::mutex> guard(task->m);
+        task->notifications++;
+    }
+    task->cv.notify_all();
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) {
+    xTaskNotifyGive(task);
+    if (woken) *woken = pdFALSE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) {
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    std::unique_lock<std::mutex> lock(task->m);
+    if (!waitFor(task->cv, lock, ticks, [&] { return task->notifications > 0; })) return 0;
+
+    uint32_t value = task->notifications;
+    task->notifications = clearOnExit ? 0 : value - 1;
+    return value;
+}
+
+// =============================================================================
+// SEMAPHORES
+// =============================================================================
+
+static SemaphoreHandle_t createSemaphore(bool isMutex) {
+    SemaphoreHandle_t sem = new HostSemaphore();
+    sem->count = isMutex ? 1 : 0;
+    sem->isMutex = isMutex;
+    sem->holder = nullptr;
+    return sem;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return createSemaphore(true);
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary() {
+    return createSemaphore(false);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t ticks) {
+    std::unique_lock<std::mutex> lock(sem->m);
+    if (!waitFor(sem->cv, lock, ticks, [&] { return sem->count > 0; })) return pdFALSE;
+    sem->count--;
+    if (sem->isMutex) sem->holder = xTaskGetCurrentTaskHandle();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem) {
+    {
+        std::lock_guard<std::mutex> guard(sem->m);
+        if (sem->count > 0) return pdFALSE;
+        if (sem->isMutex && sem->holder != xTaskGetCurrentTaskHandle()) return pdFALSE;
+        sem->count = 1;
+        sem->holder = nullptr;
+    }
+    sem->cv.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t sem, BaseType_t* woken) {
+    if (woken) *woken = pdFALSE;
+    return xSemaphoreGive(sem);
+}
+
+TaskHandle_t xSemaphoreGetMutexHolder(SemaphoreHandle_t sem) {
+    std::lock_guard<std::mutex> guard(sem->m);
+    return sem->holder;
+}
+
+// =============================================================================
+// QUEUES
+// =============================================================================
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t itemSize) {
+    QueueHandle_t queue = new HostQueue();
+    queue->length = length;
+    queue->itemSize = itemSize;
+    return queue;
+}
+
+BaseType_t xQueueSend(QueueHandle_t queue, const void* item, TickType_t ticks) {
+    {
+        std::unique_lock<std::mutex> lock(queue->m);
+        if (!waitFor(queue->cv, lock, ticks, [&] { return queue->items.size() < queue->length; })) {
+            return pdFALSE;
+        }
+        const uint8_t* bytes = (const uint8_t*)item;
+        queue->items.emplace_back(bytes, bytes + queue->itemSize);
+    }
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t queue, void* item, TickType_t ticks) {
+    {
+        std::unique_lock<std::mutex> lock(queue->m);
+        if (!waitFor(queue->cv, lock, ticks, [&] { return !queue->items.empty(); })) return pdFALSE;
+        memcpy(item, queue->items.front().data(), queue->itemSize);
+        queue->items.pop_front();
+    }
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue) {
+    std::lock_guard<std::mutex> guard(queue->m);
+    return (UBaseType_t)queue->items.size();
+}
@@ -0,0 +1,29 @@
+/**
+ * HostGlobals.cpp
+ * The globals main.cpp owns on the device, for host builds that link
+ * the firmware modules without setup() and loop()
+ */
+
+#include "Config.h"
+#include "DataStructures.h"
+#include "Display.h"
+#include "PowerManager.h"
+#include "Bluetooth.h"
+#include <Wire.h>
+
+Adafruit_SH1106G display(SCREEN_WIDTH, SCREEN_HEIGHT, &Wire, OLED_RESET);
+Adafruit_BME280 bme;
+RTC_PCF8523 rtc;
+BluetoothManager bluetoothManager;
+
+SystemSettings settings;
+SystemStatus systemStatus = {false, false, false, false, false, false};
+SensorData currentData;
+
+float lastTemperature = 0;
+float lastHumidity = 0;
+float lastPressure = 0;
+unsigned long lastEnvReading = 0;
+bool envHistoryValid = false;
+
+PowerManager powerManager;
@@ -0,0 +1,61 @@
+/**
+ * HostTest.cpp
+ * Test runner for the host build
+ */
+
+#include "HostTest.h"
+#include <Arduino.h>
+#include <SD.h>
+#include <InternalFileSystem.h>
+#include <vector>
+
+struct HostTestCase {
+    const char* name;
+    HostTestFn fn;
+};
+
+static std::vector<HostTestCase>& registry() {
+    static std::vector<HostTestCase> tests;
+    return tests;
+}
+
+static int failures = 0;
+
+bool hostTestRegister(const char* name, HostTestFn fn) {
+    registry().push_back({ name, fn });
+    return true;
+}
+
+void hostTestFail(const char* file, int line, const char* expr) {
+    printf("  FAIL %s:%d: %s\n", file, line, expr);
+    failures++;
+}
+
+void hostTestFailValues(const char* file, int line, const char* expr, long long a, long long b) {
+    printf("  FAIL %s:%d: %s (%lld vs %lld)\n", file, line, expr, a, b);
+    failures++;
+}
+
+int main(int argc, char** argv) {
+    const char* filter = argc > 1 ? argv[1] : nullptr;
+    int run = 0;
+    int failed = 0;
+
+    for (const HostTestCase& test : registry()) {
+        if (filter && !strstr(test.name, filter)) continue;
+
+        hostResetArduino();
+        hostSdReset();
+        hostFlashReset();
+        int before = failures;
+        test.fn();
+        run++;
+
+        bool ok = failures == before;
+        if (!ok) failed++;
+        printf("%s %s\n", ok ? "ok  " : "FAIL", test.name);
+    }
+
+    printf("%d tests, %d failed\n", run, failed);
+    return (failed || run == 0) ? 1 : 0;
+}
@@ -0,0 +1,37 @@
+/**
+ * HostTest.h
+ * Minimal test registry for the host build
+ *
+ * TEST(name) { ... } registers a test. CHECK and CHECK_EQ record a failure
+ * and carry on; REQUIRE returns from the test. HostTest.cpp provides
+ * main(), which resets the Arduino, SD and flash shims before each test and runs
+ * every test, or only those whose names contain argv[1].
+ */
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+typedef void (*HostTestFn)();
+
+bool hostTestRegister(const char* name, HostTestFn fn);
+void hostTestFail(const char* file, int line, const char* expr);
+void hostTestFailValues(const char* file, int line, const char* expr, long long a, long long b);
+
+#define TEST(name) \
+    static void name(); \
+    static bool name##Registered = hostTestRegister(#name, name); \
+    static void name()
+
+#define CHECK(cond) \
+    do { if (!(cond)) hostTestFail(__FILE__, __LINE__, #cond); } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        long long checkA = (long long)(a), checkB = (long long)(b); \
+        if (checkA != checkB) hostTestFailValues(__FILE__, __LINE__, #a " == " #b, checkA, checkB); \
+    } while (0)
+
+#define REQUIRE(cond) \
+    do { if (!(cond)) { hostTestFail(__FILE__, __LINE__, #cond); return; } } while (0)
+
+#endif // HOST_TEST_H
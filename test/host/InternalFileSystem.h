@@ -0,0 +1,15 @@
+/**
+ * InternalFileSystem.h
+ * Host stand-in for the nRF52 internal flash file system
+ */
+
+#ifndef HOST_INTERNAL_FILE_SYSTEM_H
+#define HOST_INTERNAL_FILE_SYSTEM_H
+
+#include "Adafruit_LittleFS.h"
+
+class InternalFileSystem : public Adafruit_LittleFS {};
+
+extern InternalFileSystem InternalFS;
+
+#endif // HOST_INTERNAL_FILE_SYSTEM_H
@@ -0,0 +1,95 @@
+/**
+ * RTClib.h
+ * Host stand-in for RTClib: DateTime arithmetic and a PCF8523 that
+ * follows the virtual clock from the time it was last set
+ */
+
+#ifndef HOST_RTCLIB_H
+#define HOST_RTCLIB_H
+
+#include <Arduino.h>
+#include <Wire.h>
+
+class TimeSpan {
+public:
+    TimeSpan(int32_t seconds = 0) : total(seconds) {}
+    TimeSpan(int16_t days, int8_t hours, int8_t minutes, int8_t seconds)
+        : total(days * 86400L + hours * 3600L + minutes * 60L + seconds) {}
+    int32_t totalseconds() const { return total; }
+
+private:
+    int32_t total;
+};
+
+class DateTime {
+public:
+    enum timestampOpt { TIMESTAMP_FULL, TIMESTAMP_TIME, TIMESTAMP_DATE };
+
+    DateTime(uint32_t t = 0);
+    DateTime(uint16_t year, uint8_t month, uint8_t day, uint8_t hour = 0, uint8_t min = 0, uint8_t sec = 0);
+    DateTime(const char* date, const char* time);
+
+    uint16_t year() const { return y; }
+    uint8_t month() const { return m; }
+    uint8_t day() const { return d; }
+    uint8_t hour() const { return hh; }
+    uint8_t minute() const { return mm; }
+    uint8_t second() const { return ss; }
+    uint8_t dayOfTheWeek() const;
+    uint32_t unixtime() const;
+    bool isValid() const;
+    String timestamp(timestampOpt opt = TIMESTAMP_FULL) const;
+
+    DateTime operator+(const TimeSpan& span) const { return DateTime(unixtime() + span.totalseconds()); }
+    DateTime operator-(const TimeSpan& span) const { return DateTime(unixtime() - span.totalseconds()); }
+    TimeSpan operator-(const DateTime& other) const { return TimeSpan((int32_t)(unixtime() - other.unixtime())); }
+    bool operator<(const DateTime& other) const { return unixtime() < other.unixtime(); }
+    bool operator>(const DateTime& other) const { return unixtime() > other.unixtime(); }
+    bool operator==(const DateTime& other) const { return unixtime() == other.unixtime(); }
+
+private:
+    uint16_t y;
+    uint8_t m, d, hh, mm, ss;
+};
+
+enum Pcf8523SqwPinMode { PCF8523_OFF = 7 };
+enum PCF8523TimerClockFreq {
+    PCF8523_Frequency4kHz = 0,
+    PCF8523_Frequency64Hz = 1,
+    PCF8523_FrequencySecond = 2,
+    PCF8523_FrequencyMinute = 3,
+    PCF8523_FrequencyHour = 4
+};
+enum PCF8523TimerIntPulse { PCF8523_LowPulse3x64Hz = 0 };
+enum Pcf8523OffsetMode { PCF8523_TwoHours = 0, PCF8523_OneMinute = 1 };
+#define PCF8523_Capacitor_12_5pF 1
+
+class RTC_PCF8523 {
+public:
+    bool begin(TwoWire* wire = nullptr) { (void)wire; return present; }
+    void adjust(const DateTime& dt);
+    bool lostPower() { return !set; }
+    bool initialized() { return set; }
+    DateTime now();
+    void start() { running = true; }
+    void stop() { running = false; }
+    uint8_t isrunning() { return running; }
+
+    void enableCountdownTimer(PCF8523TimerClockFreq freq, uint8_t count, uint8_t pulse) { (void)pulse; enableCountdownTimer(freq, count); }
+    void enableCountdownTimer(PCF8523TimerClockFreq freq, uint8_t count) { timerFreq = freq; timerCount = count; }
+    void disableCountdownTimer() { timerCount = 0; }
+    void deconfigureAllTimers() { timerCount = 0; }
+    void enableSecondTimer() {}
+    void disableSecondTimer() {}
+    void calibrate(Pcf8523OffsetMode mode, int8_t offset) { (void)mode; (void)offset; }
+
+    bool present = true;
+    bool running = true;
+    bool set = true;
+    uint32_t baseUnix = 1735689600UL;    // 2025-01-01 00:00:00 at virtual time zero
+    uint64_t baseMicros = 0;
+    PCF8523TimerClockFreq timerFreq = PCF8523_FrequencySecond;
+    uint8_t timerCount = 0;
+};
+
+#endif // HOST_RTCLIB_H
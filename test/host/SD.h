@@ -0,0 +1,83 @@
+/**
+ * SD.h
+ * Host stand-in for the SD library over an in-memory file tree
+ *
+ * Paths are kept whole ("/HIVE_DATA/2025/data.csv"); a directory exists
+ * once made, and listing one returns its direct children in name order.
+ * FILE_WRITE creates the file and starts at its end, as the real library
+ * does. Once the card is unmounted with end(), reads and seeks on files
+ * still open fail, as when it is pulled. hostSdReset() empties the card.
+ */
+
+#ifndef HOST_SD_H
+#define HOST_SD_H
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+#define FILE_READ 1
+#define FILE_WRITE 2
+
+struct HostSdNode;
+
+namespace SDLib {
+
+class File : public Stream {
+private:
+    std::shared_ptr<HostSdNode> node;
+    std::string path;
+    std::string baseName;
+    uint32_t pos;
+    bool writable;
+    std::string listedLast;      // Last child openNextFile() returned
+
+public:
+    using Print::write;
+
+    File();
+    File(std::shared_ptr<HostSdNode> node, const std::string& path, bool writable);
+
+    operator bool() const { return node != nullptr; }
+    const char* name() { return baseName.c_str(); }
+    bool isDirectory();
+    File openNextFile(uint8_t mode = 0);
+    void rewindDirectory() { listedLast.clear(); }
+    void close();
+    uint32_t size();
+    uint32_t position() { return pos; }
+    bool seek(uint32_t position);
+    int available();
+    int read();
+    int read(void* buffer, uint16_t len);
+    size_t write(uint8_t c);
+    size_t write(const uint8_t* buffer, size_t size);
+    int peek();
+    void flush() {}
+};
+
+class SDClass {
+public:
+    bool begin(uint8_t cs);
+    void end() { mounted = false; }
+    File open(const char* path, uint8_t mode = FILE_READ);
+    File open(const String& path, uint8_t mode = FILE_READ) { return open(path.c_str(), mode); }
+    bool exists(const char* path);
+    bool mkdir(const char* path);
+    bool remove(const char* path);
+    bool rmdir(const char* path);
+
+    bool present = true;
+    bool mounted = false;
+};
+
+} // namespace SDLib
+
+extern SDLib::SDClass SD;
+using namespace SDLib;
+
+// Empties the card; the next begin() mounts a blank one
+void hostSdReset();
+size_t hostSdFileSize(const char* path);
+
+#endif // HOST_SD_H
@@ -0,0 +1,19 @@
+/**
+ * SPI.h
+ * Host stand-in for the SPI bus
+ */
+
+#ifndef HOST_SPI_H
+#define HOST_SPI_H
+
+class SPIClass {
+public:
+    void begin() { enabled = true; }
+    void end() { enabled = false; }
+
+    bool enabled = false;
+};
+
+extern SPIClass SPI;
+
+#endif // HOST_SPI_H
@@ -0,0 +1,158 @@
+/**
+ * SimApiary.cpp
+ * Multi-node radio medium for the gateway role
+ */
+
+#include "SimApiary.h"
+
+SimApiary::SimApiary() {
+    startMs = 0;
+    rng = 1;
+    nextGatewayAdvMs = 0;
+    lossPermille = 0;
+    memset(&stats, 0, sizeof(stats));
+}
+
+uint32_t SimApiary::nextRandom() {
+    rng = rng * 1103515245u + 12345u;
+    return rng >> 8;
+}
+
+void SimApiary::begin(uint8_t gatewayId, uint8_t periodMin, uint32_t seed) {
+    startMs = millis();
+    rng = seed ? seed : 1;
+    nextGatewayAdvMs = startMs;
+    nodes.clear();
+    memset(&stats, 0, sizeof(stats));
+    gateway.setEnabled(true, periodMin, gatewayId);
+}
+
+SimNode& SimApiary::addNode(uint8_t deviceId, uint16_t intervalMs, int8_t rssi, uint32_t readingPeriodS) {
+    SimNode n = {};
+    n.status.deviceId = deviceId;
+    n.status.batteryVoltage = 3.9f;
+    n.status.temperature = 30.0f + deviceId / 10.0f;
+    n.status.beeState = 1;
+    n.status.readingAgeMinutes = 0;
+    uint8_t addr[6] = { 0xC0, 0x11, 0x22, 0x33, 0x44, deviceId };
+    memcpy(n.addr, addr, sizeof(n.addr));
+    n.intervalMs = intervalMs;
+    n.rssi = rssi;
+    n.on = true;
+    n.readingPeriodS = readingPeriodS;
+
+    // Nodes are not synchronised: random advertising and reading phases
+    uint64_t now = millis();
+    n.nextAdvMs = now + nextRandom() % intervalMs;
+    n.lastReadingMs = now;
+    n.nextReadingMs = now + (uint64_t)(nextRandom() % readingPeriodS) * 1000ULL;
+    nodes.push_back(n);
+    return nodes.back();
+}
+
+SimNode* SimApiary::node(uint8_t deviceId) {
+    for (SimNode& n : nodes) {
+        if (n.status.deviceId == deviceId) return &n;
+    }
+    return nullptr;
+}
+
+uint32_t SimApiary::rtcNow() const {
+    return SIM_APIARY_START + (uint32_t)((millis() - startMs) / 1000);
+}
+
+void SimApiary::advertise(SimNode& n, uint64_t nowMs) {
+    n.advertisements++;
+    stats.advertisements++;
+    if (!gateway.isScanning()) return;
+    if (n.rssi < SIM_RSSI_FLOOR) {
+        stats.outOfRange++;
+        return;
+    }
+    if (nextRandom() % 1000 < lossPermille) {
+        stats.lost++;
+        return;
+    }
+
+    uint64_t age = (nowMs - n.lastReadingMs) / 60000ULL;
+    n.status.readingAgeMinutes = age >= BEACON_AGE_UNKNOWN ? BEACON_AGE_UNKNOWN : (uint8_t)age;
+    n.status.alertLatch = n.latch.getFlags();
+    n.status.alertSeq = n.latch.getSeq();
+    uint8_t payload[BEACON_PAYLOAD_SIZE];
+    uint8_t len = encodeBeaconPayload(n.status, payload);
+    gateway.queueReport(n.addr, n.rssi, payload, len);
+    n.heard++;
+    stats.heard++;
+
+    // The scan callback posts EVT_BLE and the loop files it straight away
+    gateway.processReports(rtcNow());
+}
+
+void SimApiary::takeReading(SimNode& n) {
+    n.status.temperature += (int)(nextRandom() % 21 - 10) / 100.0f;
+    n.status.counter++;
+    n.lastReadingMs = n.nextReadingMs;
+    n.nextReadingMs += (uint64_t)n.readingPeriodS * 1000ULL;
+
+    // As BluetoothManager::onNewReading()
+    n.latch.onReading(n.status.alertFlags);
+    if (n.latch.isPending()) {
+        n.listenFromMs = n.lastReadingMs;
+        n.listenUntilMs = n.lastReadingMs + BEACON_ACK_LISTEN_MS;
+    }
+}
+
+// The gateway's beacon while it has acks; its advertising delay is left
+// out so the nodes' random sequence is the same with or without alerts
+void SimApiary::advertiseAcks(uint64_t nowMs) {
+    if (!gateway.hasAcks()) return;
+    stats.ackBeacons++;
+
+    BeaconStatus own = {};
+    uint8_t payload[BEACON_MAX_PAYLOAD];
+    uint8_t len = encodeBeaconPayload(own, payload);
+    BeaconAck acks[BEACON_MAX_ACKS];
+    len += 2 * encodeBeaconAcks(acks, gateway.getAcks(acks, BEACON_MAX_ACKS), payload + len);
+
+    for (SimNode& n : nodes) {
+        if (!n.on || nowMs < n.listenFromMs || nowMs >= n.listenUntilMs) continue;
+        if (n.rssi < SIM_RSSI_FLOOR || nextRandom() % 1000 < lossPermille) continue;
+        if (n.latch.onGatewayBeacon(n.status.deviceId, payload, len)) {
+            n.acked++;
+            n.listenMs += nowMs - n.listenFromMs;
+            n.listenUntilMs = 0;
+        }
+    }
+}
+
+void SimApiary::run(uint32_t seconds) {
+    uint64_t endMs = millis() + (uint64_t)seconds * 1000ULL;
+    while (millis() < endMs) {
+        gateway.update();
+        bool scanning = gateway.isScanning();
+        uint64_t stepMs = scanning ? SIM_SCAN_STEP_MS : SIM_IDLE_STEP_MS;
+        uint64_t stepEnd = min(millis() + stepMs, endMs);
+
+        for (SimNode& n : nodes) {
+            while (n.nextReadingMs < stepEnd) {
+                // A listen window cut short by the next reading
+                if (n.listenUntilMs > n.nextReadingMs) n.listenUntilMs = n.nextReadingMs;
+                if (n.listenUntilMs) n.listenMs += n.listenUntilMs - n.listenFromMs;
+                n.listenUntilMs = 0;
+                takeReading(n);
+            }
+            while (n.nextAdvMs < stepEnd) {
+                if (n.on) advertise(n, n.nextAdvMs);
+                n.nextAdvMs += n.intervalMs + nextRandom() % (SIM_ADV_DELAY_MAX_MS + 1);
+            }
+        }
+        while (nextGatewayAdvMs < stepEnd) {
+            advertiseAcks(nextGatewayAdvMs);
+            nextGatewayAdvMs += BEACON_DEFAULT_INTERVAL_MS;
+        }
+
+        if (scanning) stats.scanMs += stepEnd - millis();
+        stats.elapsedMs += stepEnd - millis();
+        hostAdvanceMillis(stepEnd - millis());
+    }
+}
@@ -0,0 +1,93 @@
+/**
+ * SimApiary.h
+ * Multi-node radio medium for the gateway role
+ *
+ * Simulated neighbours advertise their status beacon on the virtual
+ * clock, each at its own interval with the 0-10 ms advertising delay the
+ * spec adds to every event. A beacon reaches the gateway only while its
+ * BleGateway is scanning, the node is in range and the medium does not
+ * drop it; it is then queued as the scan callback would and filed on
+ * the next pass, as BluetoothManager::update() does after EVT_BLE.
+ *
+ * Each node takes a new reading every readingPeriodS, which moves its
+ * temperature, bumps the beacon counter and latches any alert it raised.
+ * A node with a latch listens for BEACON_ACK_LISTEN_MS after the reading,
+ * and the gateway's own beacon reaches it then if it carries acks. The
+ * medium counts radio time per node, so the cost of the gateway role can
+ * be checked against the beaconing the nodes do anyway.
+ */
+
+#ifndef SIM_APIARY_H
+#define SIM_APIARY_H
+
+#include "BleGateway.h"
+#include <vector>
+
+#define SIM_APIARY_START 1735732800UL    // 2025-01-01 12:00:00
+#define SIM_ADV_DELAY_MAX_MS 10
+#define SIM_IDLE_STEP_MS 1000            // Clock step while the gateway is not scanning
+#define SIM_SCAN_STEP_MS 5               // and while it is
+
+struct SimNode {
+    BeaconStatus status;
+    uint8_t addr[6];
+    uint16_t intervalMs;
+    int8_t rssi;                 // Below SIM_RSSI_FLOOR: out of range
+    bool on;
+    uint32_t readingPeriodS;
+
+    uint64_t nextAdvMs;
+    uint64_t nextReadingMs;
+    uint64_t lastReadingMs;
+    uint32_t advertisements;
+    uint32_t heard;              // Advertisements the gateway queued
+
+    BeaconAlertLatch latch;
+    uint64_t listenFromMs;
+    uint64_t listenUntilMs;
+    uint64_t listenMs;           // Radio on for acks
+    uint32_t acked;
+};
+
+struct SimApiaryStats {
+    uint32_t advertisements;
+    uint32_t heard;
+    uint32_t lost;               // Dropped by the medium during a scan
+    uint32_t outOfRange;
+    uint64_t scanMs;             // Gateway radio on for scanning
+    uint64_t elapsedMs;
+    uint32_t ackBeacons;         // Gateway beacons that carried acks
+};
+
+#define SIM_RSSI_FLOOR -95
+
+class SimApiary {
+private:
+    uint64_t startMs;
+    uint32_t rng;
+    uint64_t nextGatewayAdvMs;
+
+    uint32_t nextRandom();
+    void advertise(SimNode& node, uint64_t nowMs);
+    void takeReading(SimNode& node);
+    void advertiseAcks(uint64_t nowMs);
+
+public:
+    BleGateway gateway;
+    std::vector<SimNode> nodes;
+    SimApiaryStats stats;
+    uint16_t lossPermille;
+
+    SimApiary();
+
+    // Resets the virtual clock to SIM_APIARY_START and enables the gateway
+    void begin(uint8_t gatewayId, uint8_t periodMin, uint32_t seed = 1);
+    SimNode& addNode(uint8_t deviceId, uint16_t intervalMs = BEACON_DEFAULT_INTERVAL_MS,
+                     int8_t rssi = -60, uint32_t readingPeriodS = 600);
+    SimNode* node(uint8_t deviceId);
+
+    uint32_t rtcNow() const;
+    void run(uint32_t seconds);
+};
+
+#endif // SIM_APIARY_H
@@ -0,0 +1,70 @@
+/**
+ * Wire.h
+ * Host stand-in for the I2C bus: accepts everything and reads nothing,
+ * unless a test puts a device model on it
+ */
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#include <Arduino.h>
+
+#define HOST_WIRE_BUFFER 32
+
+// Answers for one address: a transmission is handed over whole, a read
+// fills up to count bytes
+class HostI2cDevice {
+public:
+    virtual ~HostI2cDevice() {}
+    virtual uint8_t address() const = 0;
+    virtual void receive(const uint8_t* data, size_t len) = 0;
+    virtual size_t request(uint8_t* out, size_t count) = 0;
+};
+
+class TwoWire : public Stream {
+public:
+    using Print::write;
+
+    void begin() { enabled = true; if (onChange) onChange(true); }
+    void end() { enabled = false; if (onChange) onChange(false); }
+    void setClock(uint32_t hz) { (void)hz; }
+    void beginTransmission(uint8_t address) {
+        txAddress = address;
+        txLength = 0;
+    }
+    uint8_t endTransmission(bool stop = true) {
+        (void)stop;
+        if (device && device->address() == txAddress) device->receive(txBuffer, txLength);
+        txLength = 0;
+        return 0;
+    }
+    uint8_t requestFrom(int address, int count) {
+        rxLength = rxPos = 0;
+        if (device && device->address() == address) {
+            rxLength = device->request(rxBuffer, min(count, HOST_WIRE_BUFFER));
+        }
+        return rxLength;
+    }
+    size_t write(uint8_t c) {
+        if (txLength < HOST_WIRE_BUFFER) txBuffer[txLength++] = c;
+        return 1;
+    }
+    int read() { return rxPos < rxLength ? rxBuffer[rxPos++] : -1; }
+    int available() { return rxLength - rxPos; }
+
+    bool enabled = false;
+    void (*onChange)(bool enabled) = nullptr;   // Lets a test see bus ordering
+    HostI2cDevice* device = nullptr;
+
+private:
+    uint8_t txAddress = 0;
+    uint8_t txBuffer[HOST_WIRE_BUFFER];
+    size_t txLength = 0;
+    uint8_t rxBuffer[HOST_WIRE_BUFFER];
+    size_t rxLength = 0;
+    size_t rxPos = 0;
+};
+
+extern TwoWire Wire;
+
+#endif // HOST_WIRE_H
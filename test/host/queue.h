@@ -0,0 +1,6 @@
+/**
+ * queue.h
+ * Host port of FreeRTOS, see FreeRTOS.h
+ */
+
+#include "FreeRTOS.h"
@@ -0,0 +1,6 @@
+/**
+ * semphr.h
+ * Host port of FreeRTOS, see FreeRTOS.h
+ */
+
+#include "FreeRTOS.h"
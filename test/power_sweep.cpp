@@ -0,0 +1,152 @@
+/**
+ * power_sweep.cpp
+ * Deployment projections over a grid of wake intervals and temperatures
+ *
+ * Every grid point is an independent PowerSimulator run, so the grid is
+ * spread over one thread per core. The simulator only reads the shared
+ * wake schedule, phase profiler and battery model, and each thread owns
+ * its instance. Points are stepped a day at a time, as the BLE job does,
+ * and the longest step is reported in host time.
+ *
+ * Usage: power_sweep [--check]
+ *   --check  re-runs the grid serially with run() and fails on any
+ *            difference, then checks that current falls with the
+ *            interval, capacity with the temperature, and that the wake
+ *            count matches the interval (run by ctest)
+ */
+
+#include "PowerSimulator.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#define SWEEP_DAYS SIM_MAX_DAYS
+#define SWEEP_START 1735689600UL         // 2025-01-01 00:00:00
+#define SWEEP_LOG_INTERVAL_MIN 10
+
+static const uint32_t INTERVALS_S[] = { 10, 60, 300, 600, 1800, 3600 };
+static const float TEMPS_C[] = { -10.0f, 5.0f, 20.0f };
+static const size_t INTERVAL_COUNT = sizeof(INTERVALS_S) / sizeof(INTERVALS_S[0]);
+static const size_t TEMP_COUNT = sizeof(TEMPS_C) / sizeof(TEMPS_C[0]);
+
+struct SweepPoint {
+    SimConfig config;
+    SimResult result;
+    double hostMs;
+    double maxStepMs;
+};
+
+static void runPoint(SweepPoint& p) {
+    PowerSimulator sim;
+    auto start = std::chrono::steady_clock::now();
+    double maxStep = 0;
+
+    sim.begin(p.config, SWEEP_START, SWEEP_LOG_INTERVAL_MIN);
+    bool done = false;
+    while (!done) {
+        auto stepStart = std::chrono::steady_clock::now();
+        done = sim.step(SIM_DAYS_PER_STEP);
+        std::chrono::duration<double, std::milli> stepMs = std::chrono::steady_clock::now() - stepStart;
+        if (stepMs.count() > maxStep) maxStep = stepMs.count();
+    }
+
+    std::chrono::duration<double, std::milli> total = std::chrono::steady_clock::now() - start;
+    p.result = sim.getResult();
+    p.hostMs = total.count();
+    p.maxStepMs = maxStep;
+}
+
+static bool sameResult(const SimResult& a, const SimResult& b) {
+    // runMs and maxStepUs are timings, not results
+    return a.wakes == b.wakes && a.flushes == b.flushes && a.totalMah == b.totalMah &&
+           a.daysToEmpty == b.daysToEmpty && a.usableMah == b.usableMah &&
+           memcmp(a.phaseMah, b.phaseMah, sizeof(a.phaseMah)) == 0 &&
+           memcmp(a.socByDay, b.socByDay, sizeof(a.socByDay)) == 0;
+}
+
+static int check(const std::vector<SweepPoint>& grid) {
+    int failures = 0;
+
+    for (const SweepPoint& p : grid) {
+        PowerSimulator serial;
+        const SimResult& r = serial.run(p.config, SWEEP_START, SWEEP_LOG_INTERVAL_MIN);
+        if (!sameResult(r, p.result)) {
+            printf("FAIL %lu s %.0f C: threaded result differs from run()\n",
+                   (unsigned long)p.config.intervalS, p.config.tempC);
+            failures++;
+        }
+
+        // Aligned slots: every slot is taken unless a wake overruns it
+        uint32_t slots = SWEEP_DAYS * 86400UL / p.config.intervalS;
+        if (p.result.wakes > slots || p.result.wakes < slots - slots / 100 - 1) {
+            printf("FAIL %lu s: %lu wakes for %lu slots\n", (unsigned long)p.config.intervalS,
+                   (unsigned long)p.result.wakes, (unsigned long)slots);
+            failures++;
+        }
+    }
+
+    for (size_t t = 0; t < TEMP_COUNT; t++) {
+        for (size_t i = 1; i < INTERVAL_COUNT; i++) {
+            const SimResult& shorter = grid[t * INTERVAL_COUNT + i - 1].result;
+            const SimResult& longer = grid[t * INTERVAL_COUNT + i].result;
+            if (!(longer.avgCurrentMa < shorter.avgCurrentMa)) {
+                printf("FAIL %.0f C: %lu s does not draw less than %lu s\n", TEMPS_C[t],
+                       (unsigned long)longer.intervalS, (unsigned long)shorter.intervalS);
+                failures++;
+            }
+        }
+    }
+    for (size_t i = 0; i < INTERVAL_COUNT; i++) {
+        for (size_t t = 1; t < TEMP_COUNT; t++) {
+            const SimResult& colder = grid[(t - 1) * INTERVAL_COUNT + i].result;
+            const SimResult& warmer = grid[t * INTERVAL_COUNT + i].result;
+            if (!(colder.usableMah <= warmer.usableMah)) {
+                printf("FAIL %lu s: more usable charge at %.0f C than %.0f C\n",
+                       (unsigned long)INTERVALS_S[i], TEMPS_C[t - 1], TEMPS_C[t]);
+                failures++;
+            }
+        }
+    }
+
+    printf("%d failures\n", failures);
+    return failures;
+}
+
+int main(int argc, char** argv) {
+    bool checking = argc > 1 && strcmp(argv[1], "--check") == 0;
+
+    std::vector<SweepPoint> grid;
+    for (float temp : TEMPS_C) {
+        for (uint32_t interval : INTERVALS_S) {
+            SweepPoint p = {};
+            p.config = { SWEEP_DAYS, interval, temp, 1.0f };
+            grid.push_back(p);
+        }
+    }
+
+    std::atomic<size_t> next(0);
+    unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<std::thread> workers;
+    auto start = std::chrono::steady_clock::now();
+    for (unsigned i = 0; i < threads; i++) {
+        workers.emplace_back([&] {
+            for (size_t n; (n = next++) < grid.size();) runPoint(grid[n]);
+        });
+    }
+    for (std::thread& w : workers) w.join();
+    std::chrono::duration<double, std::milli> wall = std::chrono::steady_clock::now() - start;
+
+    printf("%8s %6s %8s %8s %9s %9s %10s %9s %9s\n", "interval", "temp", "wakes", "flushes",
+           "mAh/day", "avg mA", "empty day", "host ms", "max step");
+    for (const SweepPoint& p : grid) {
+        const SimResult& r = p.result;
+        printf("%7lus %5.0fC %8lu %8lu %9.2f %9.3f %10.1f %9.2f %9.3f\n",
+               (unsigned long)r.intervalS, p.config.tempC, (unsigned long)r.wakes,
+               (unsigned long)r.flushes, r.totalMah / r.days, r.avgCurrentMa,
+               r.daysToEmpty, p.hostMs, p.maxStepMs);
+    }
+    printf("%zu points, %u threads, %.1f ms\n", grid.size(), threads, wall.count());
+
+    return checking && check(grid) ? 1 : 0;
+}
@@ -0,0 +1,334 @@
+/**
+ * test_adaptive_interval.cpp
+ * Trace-driven runs of the adaptive field interval: each reading is
+ * taken at the interval the previous one chose, as in field mode, and
+ * the trace decides what the hive is doing at that time. The interval
+ * is recorded in the field data file
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "AdaptiveInterval.h"
+#include "FieldModeBuffer.h"
+#include <InternalFileSystem.h>
+#include <RTClib.h>
+#include <SD.h>
+#include <string>
+#include <vector>
+
+#define DAY_START 1735689600UL           // 2025-01-01 00:00:00
+#define BASE_INTERVAL 10
+
+// What a reading sees: audio activity versus baseline, alert flags and
+// the battery, by minute of the day
+struct TracePoint {
+    float activity;
+    uint8_t alerts;
+    int batteryPercent;
+};
+
+typedef TracePoint (*HiveTrace)(uint32_t minute);
+
+struct TraceStep {
+    uint32_t minute;
+    uint8_t interval;
+    ActivityLevel level;
+};
+
+static std::vector<TraceStep> runTrace(AdaptiveInterval& adapt, HiveTrace trace, uint32_t minutes,
+                                       uint8_t base = BASE_INTERVAL) {
+    std::vector<TraceStep> steps;
+    uint32_t minute = 0;
+    while (minute < minutes) {
+        TracePoint p = trace(minute);
+        SensorData data = {};
+        data.alertFlags = p.alerts;
+        data.beeState = BEE_NORMAL;
+        AudioAnalysisResult audio = {};
+        audio.analysisValid = true;
+        audio.activityIncrease = p.activity;
+
+        uint8_t interval = adapt.update(data, &audio, p.batteryPercent, DAY_START + minute * 60, base);
+        steps.push_back({ minute, interval, adapt.getLastActivity() });
+        minute += interval;
+    }
+    return steps;
+}
+
+static const TraceStep* firstAfter(const std::vector<TraceStep>& steps, uint32_t minute) {
+    for (const TraceStep& s : steps) {
+        if (s.minute >= minute) return &s;
+    }
+    return nullptr;
+}
+
+static uint32_t wakesBetween(const std::vector<TraceStep>& steps, uint32_t from, uint32_t to) {
+    uint32_t n = 0;
+    for (const TraceStep& s : steps) {
+        if (s.minute >= from && s.minute < to) n++;
+    }
+    return n;
+}
+
+static void enable(AdaptiveInterval& adapt, uint16_t budget = 0) {
+    adapt.configure(true, budget, 1);
+    adapt.begin(BASE_INTERVAL);
+}
+
+// =============================================================================
+// TRACES
+// =============================================================================
+
+static TracePoint calmDay(uint32_t minute) {
+    (void)minute;
+    return { 1.0f, ALERT_NONE, 80 };
+}
+
+// Calm, then an hour of swarm build-up from 10:00, then calm again
+static TracePoint swarmMorning(uint32_t minute) {
+    bool swarming = minute >= 600 && minute < 660;
+    return { swarming ? 2.5f : 1.0f, ALERT_NONE, 80 };
+}
+
+// Hovers around the calm threshold: one calm reading, one normal
+static TracePoint borderline(uint32_t minute) {
+    static uint32_t readings = 0;
+    if (minute == 0) readings = 0;
+    return { (readings++ % 2) ? ADAPT_ACTIVITY_CALM + 0.05f : 1.0f, ALERT_NONE, 80 };
+}
+
+static TracePoint calmLowBattery(uint32_t minute) {
+    (void)minute;
+    return { 1.0f, ALERT_NONE, 20 };
+}
+
+// Quiet audio, but a swarm alert raised from 08:00 to 08:30 and a
+// temperature alert from 14:00 to 15:00
+static TracePoint alertsOnly(uint32_t minute) {
+    uint8_t alerts = ALERT_NONE;
+    if (minute >= 480 && minute < 510) alerts = ALERT_SWARM_RISK;
+    if (minute >= 840 && minute < 900) alerts = ALERT_TEMP_HIGH;
+    return { 1.0f, alerts, 80 };
+}
+
+static TracePoint batteryAlertOnly(uint32_t minute) {
+    (void)minute;
+    return { 1.0f, ALERT_LOW_BATTERY, 80 };
+}
+
+static TracePoint swarmAllDay(uint32_t minute) {
+    (void)minute;
+    return { 3.0f, ALERT_NONE, 80 };
+}
+
+// =============================================================================
+// TESTS
+// =============================================================================
+
+TEST(disabledKeepsTheBaseInterval) {
+    AdaptiveInterval adapt;
+    adapt.begin(BASE_INTERVAL);
+    std::vector<TraceStep> steps = runTrace(adapt, swarmMorning, 1440);
+    for (const TraceStep& s : steps) CHECK_EQ(s.interval, BASE_INTERVAL);
+    CHECK_EQ(steps.size(), 1440 / BASE_INTERVAL);
+}
+
+TEST(calmHiveStaysAtTheBaseInterval) {
+    AdaptiveInterval adapt;
+    enable(adapt);
+    std::vector<TraceStep> steps = runTrace(adapt, calmDay, 1440);
+    for (const TraceStep& s : steps) CHECK_EQ(s.interval, BASE_INTERVAL);
+}
+
+TEST(swarmSpeedsUpAtOnceAndSlowsDownInSteps) {
+    AdaptiveInterval adapt;
+    enable(adapt);
+    std::vector<TraceStep> steps = runTrace(adapt, swarmMorning, 1440);
+
+    // The first reading inside the build-up goes straight to 1 min
+    const TraceStep* onset = firstAfter(steps, 600);
+    REQUIRE(onset);
+    CHECK_EQ(onset->level, ACTIVITY_HIGH);
+    CHECK_EQ(onset->interval, 1);
+    CHECK_EQ(wakesBetween(steps, 600, 660), 60);
+
+    // From the last swarm reading, back up the ladder one step per
+    // ADAPT_CALM_READINGS readings: 1 -> 2 -> 5 -> 10 min, never skipping
+    // a step
+    uint8_t previous = 1;
+    uint32_t atStep = 0;
+    for (const TraceStep& s : steps) {
+        if (s.minute < 659) continue;
+        CHECK(s.interval >= previous);
+        if (s.interval != previous) {
+            CHECK_EQ(atStep, ADAPT_CALM_READINGS);
+            CHECK(previous == 1 ? s.interval == 2 : previous == 2 ? s.interval == 5 : s.interval == 10);
+            atStep = 0;
+        }
+        atStep++;
+        previous = s.interval;
+    }
+    CHECK_EQ(previous, BASE_INTERVAL);
+    const TraceStep* settled = firstAfter(steps, 720);
+    REQUIRE(settled);
+    CHECK_EQ(settled->interval, BASE_INTERVAL);
+}
+
+TEST(borderlineHiveDoesNotFlap) {
+    AdaptiveInterval adapt;
+    enable(adapt);
+    // Get off the base interval first, then feed the borderline trace
+    runTrace(adapt, swarmAllDay, 5);
+    std::vector<TraceStep> steps = runTrace(adapt, borderline, 600);
+
+    // Calm readings never come three in a row, so the step holds
+    uint32_t changes = 0;
+    for (size_t i = 1; i < steps.size(); i++) {
+        if (steps[i].interval != steps[i - 1].interval) changes++;
+    }
+    CHECK_EQ(changes, 0);
+    CHECK_EQ(steps.back().interval, 1);
+}
+
+TEST(lowBatteryLetsCalmHiveSlowToAnHour) {
+    AdaptiveInterval adapt;
+    enable(adapt);
+    std::vector<TraceStep> steps = runTrace(adapt, calmLowBattery, 1440);
+    CHECK_EQ(steps.back().interval, 60);
+
+    // 10 -> 15 -> 30 -> 60, three calm readings each; the reading that
+    // steps up counts for the step it leaves
+    const TraceStep* hour = nullptr;
+    for (const TraceStep& s : steps) {
+        if (s.interval == 60) { hour = &s; break; }
+    }
+    REQUIRE(hour);
+    CHECK_EQ(hour->minute, 2 * 10 + 3 * 15 + 3 * 30);
+
+    // Healthy battery: the base interval is the floor
+    AdaptiveInterval healthy;
+    enable(healthy);
+    CHECK_EQ(runTrace(healthy, calmDay, 1440).back().interval, BASE_INTERVAL);
+}
+
+TEST(alertsOverrideQuietAudio) {
+    AdaptiveInterval adapt;
+    enable(adapt);
+    std::vector<TraceStep> steps = runTrace(adapt, alertsOnly, 1440);
+
+    const TraceStep* swarm = firstAfter(steps, 480);
+    REQUIRE(swarm);
+    CHECK_EQ(swarm->level, ACTIVITY_HIGH);
+    CHECK_EQ(swarm->interval, 1);
+
+    // A colony alert without swarm signs holds no slower than 5 min
+    const TraceStep* temp = firstAfter(steps, 840);
+    REQUIRE(temp);
+    CHECK_EQ(temp->level, ACTIVITY_ELEVATED);
+    CHECK(temp->interval <= ADAPT_ELEVATED_MAX_MIN);
+    for (const TraceStep& s : steps) {
+        if (s.minute >= 840 && s.minute < 900) CHECK(s.interval <= ADAPT_ELEVATED_MAX_MIN);
+    }
+}
+
+TEST(batteryAlertIsNotColonyActivity) {
+    AdaptiveInterval adapt;
+    enable(adapt);
+    std::vector<TraceStep> steps = runTrace(adapt, batteryAlertOnly, 240);
+    for (const TraceStep& s : steps) {
+        CHECK_EQ(s.level, ACTIVITY_CALM);
+        CHECK_EQ(s.interval, BASE_INTERVAL);
+    }
+}
+
+TEST(budgetThrottlesAllDaySwarm) {
+    AdaptiveInterval adapt;
+    enable(adapt, ADAPT_DEFAULT_BUDGET_MAH);
+    std::vector<TraceStep> steps = runTrace(adapt, swarmAllDay, 1440);
+
+    // A burst is allowed at the start of the day, then the budget holds
+    // the rate down
+    CHECK_EQ(steps.front().interval, 1);
+    CHECK(steps.back().interval > 1);
+
+    // Spent over the day, as the budget check counts it, stays in budget
+    float spent = steps.size() * ADAPT_DEFAULT_WAKE_MAH + 0.15f * 24.0f;
+    CHECK(spent <= ADAPT_DEFAULT_BUDGET_MAH);
+
+    // Without a budget the whole day runs at 1 min
+    AdaptiveInterval unlimited;
+    enable(unlimited, 0);
+    CHECK_EQ(runTrace(unlimited, swarmAllDay, 1440).size(), 1440);
+}
+
+TEST(configurationSurvivesRestart) {
+    AdaptiveInterval adapt;
+    adapt.configure(true, 20, 2);
+
+    AdaptiveInterval restarted;
+    restarted.begin(BASE_INTERVAL);
+    CHECK(restarted.isEnabled());
+    CHECK_EQ(restarted.getBudget(), 20);
+    std::vector<TraceStep> steps = runTrace(restarted, swarmMorning, 700);
+    CHECK_EQ(firstAfter(steps, 600)->interval, 2);
+}
+
+// =============================================================================
+// FIELD DATA FILE
+// =============================================================================
+
+extern SystemStatus systemStatus;
+extern RTC_PCF8523 rtc;
+
+static std::vector<std::string> readLines(const char* path) {
+    std::vector<std::string> lines(1);
+    SDLib::File file = SD.open(path, FILE_READ);
+    int c;
+    while (file && (c = file.read()) >= 0) {
+        if (c == '\n') lines.emplace_back();
+        else if (c != '\r') lines.back() += (char)c;
+    }
+    if (lines.back().empty()) lines.pop_back();
+    return lines;
+}
+
+static size_t columns(const std::string& line) {
+    size_t n = 1;
+    for (char c : line) n += c == ',';
+    return n;
+}
+
+static std::vector<std::string> flushOneReading(const char* path, uint32_t intervalS) {
+    FieldModeBufferManager buffer;
+    buffer.addReading(SensorData(), rtc.now().unixtime(), nullptr, intervalS);
+    buffer.flushToSD(rtc, systemStatus);
+    return readLines(path);
+}
+
+TEST(intervalColumnOnlyInFilesThatHaveIt) {
+    hostBootDevice();
+    DateTime now = rtc.now();
+    char path[12];
+    sprintf(path, "/H%02d%02d.CSV", now.year() % 100, now.month());
+
+    // A new file has the column, and each reading is one row of the header's width
+    SD.remove(path);
+    std::vector<std::string> lines = flushOneReading(path, 90);
+    REQUIRE(lines.size() == 2);
+    CHECK(lines[0].substr(lines[0].size() - 11) == ",Interval_S");
+    CHECK(lines[1].substr(lines[1].size() - 3) == ",90");
+    CHECK_EQ(columns(lines[1]), columns(lines[0]));
+
+    // A file begun by older firmware keeps its layout for the month
+    SD.remove(path);
+    std::string header = lines[0].substr(0, lines[0].size() - 11);
+    SDLib::File old = SD.open(path, FILE_WRITE);
+    REQUIRE(old);
+    old.println(header.c_str());
+    old.close();
+    lines = flushOneReading(path, 90);
+    REQUIRE(lines.size() == 2);
+    CHECK(lines[0] == header);
+    CHECK_EQ(columns(lines[1]), columns(header));
+    SD.remove(path);
+}
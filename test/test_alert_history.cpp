@@ -0,0 +1,307 @@
+/**
+ * test_alert_history.cpp
+ * Alert transition detection, ring wraparound, reload after a reset and
+ * GET_ALERTS paging over a simulated link
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "BleDecoder.h"
+#include "BleProtocol.h"
+#include "AlertHistory.h"
+#include "Utils.h"
+#include <InternalFileSystem.h>
+
+static SensorData reading(float temperature, float humidity = 60.0f, float battery = 3.9f) {
+    SensorData data;
+    memset(&data, 0, sizeof(data));
+    data.temperature = temperature;
+    data.humidity = humidity;
+    data.batteryVoltage = battery;
+    data.dominantFreq = 250;
+    data.soundLevel = 40;
+    data.sensorsValid = true;
+    return data;
+}
+
+// Toggles ALERT_TEMP_HIGH count times, one event each, a minute apart
+static void toggleTempHigh(AlertHistory& history, uint32_t count, uint32_t startTime = 1000) {
+    for (uint32_t i = 0; i < count; i++) {
+        uint8_t flags = (i % 2 == 0) ? ALERT_TEMP_HIGH : ALERT_NONE;
+        history.update(flags, reading(30.0f + i % 10), startTime + i * 60);
+    }
+}
+
+static std::vector<AlertEvent> queryAll(AlertHistory& history, AlertQuery query) {
+    std::vector<AlertEvent> all;
+    AlertEvent page[ALERT_HISTORY_MAX_PAGE];
+    bool more = true;
+    while (more && all.size() < 1000) {
+        uint8_t n = history.query(query, page, more);
+        all.insert(all.end(), page, page + n);
+        if (n == 0) break;
+        query.beforeSeq = page[n - 1].seq;
+    }
+    return all;
+}
+
+// =============================================================================
+// TRANSITION DETECTION
+// =============================================================================
+
+TEST(raiseAndClearLoggedOncePerFlag) {
+    alertHistory.clear();
+    CHECK_EQ(alertHistory.update(ALERT_TEMP_HIGH, reading(41.0f), 100), 1);
+    CHECK_EQ(alertHistory.update(ALERT_TEMP_HIGH, reading(42.0f), 200), 0);
+    CHECK_EQ(alertHistory.update(ALERT_NONE, reading(30.0f), 300), 1);
+    CHECK_EQ(alertHistory.update(ALERT_NONE, reading(30.0f), 400), 0);
+    CHECK_EQ(alertHistory.getStoredEvents(), 2);
+    CHECK_EQ(alertHistory.getRaiseCount(0), 1);
+    CHECK_EQ(alertHistory.getActiveFlags(), ALERT_NONE);
+
+    AlertQuery query = {};
+    AlertEvent events[ALERT_HISTORY_MAX_PAGE];
+    bool more;
+    REQUIRE(alertHistory.query(query, events, more) == 2);
+    CHECK(!more);
+    // Newest first
+    CHECK_EQ(events[0].seq, 2);
+    CHECK_EQ(events[0].raised, 0);
+    CHECK_EQ(events[0].timestamp, 300);
+    CHECK_EQ(events[1].seq, 1);
+    CHECK_EQ(events[1].raised, 1);
+    CHECK_EQ(events[1].alertFlag, ALERT_TEMP_HIGH);
+    CHECK(events[1].value == 41.0f);
+}
+
+TEST(simultaneousFlagsGetOneEventEach) {
+    alertHistory.clear();
+    uint8_t flags = ALERT_TEMP_HIGH | ALERT_HUMIDITY_LOW | ALERT_LOW_BATTERY;
+    CHECK_EQ(alertHistory.update(flags, reading(40.0f, 20.0f, 3.2f), 500), 3);
+    CHECK_EQ(alertHistory.getActiveFlags(), flags);
+
+    AlertQuery query = {};
+    AlertEvent events[ALERT_HISTORY_MAX_PAGE];
+    bool more;
+    REQUIRE(alertHistory.query(query, events, more) == 3);
+    // Applied lowest bit first, each snapshot shows the flags so far
+    CHECK_EQ(events[2].alertFlag, ALERT_TEMP_HIGH);
+    CHECK_EQ(events[2].activeFlags, ALERT_TEMP_HIGH);
+    CHECK(events[2].value == 40.0f);
+    CHECK_EQ(events[1].alertFlag, ALERT_HUMIDITY_LOW);
+    CHECK_EQ(events[1].activeFlags, ALERT_TEMP_HIGH | ALERT_HUMIDITY_LOW);
+    CHECK(events[1].value == 20.0f);
+    CHECK_EQ(events[0].alertFlag, ALERT_LOW_BATTERY);
+    CHECK_EQ(events[0].activeFlags, flags);
+    CHECK(events[0].value == 3.2f);
+
+    // Swapping one flag for another is a clear and a raise
+    CHECK_EQ(alertHistory.update(ALERT_TEMP_LOW | ALERT_HUMIDITY_LOW | ALERT_LOW_BATTERY,
+                                 reading(2.0f, 20.0f, 3.2f), 600), 2);
+    REQUIRE(alertHistory.query(query, events, more) == 5);
+    CHECK_EQ(events[1].alertFlag, ALERT_TEMP_HIGH);
+    CHECK_EQ(events[1].raised, 0);
+    CHECK_EQ(events[0].alertFlag, ALERT_TEMP_LOW);
+    CHECK_EQ(events[0].raised, 1);
+}
+
+// =============================================================================
+// RING STORAGE
+// =============================================================================
+
+TEST(ringFileIsPreSized) {
+    alertHistory.clear();
+    CHECK_EQ(hostFlashFileSize(ALERT_HISTORY_FILE), ALERT_HISTORY_CAPACITY * sizeof(AlertEvent));
+    toggleTempHigh(alertHistory, 300);
+    // Every write is in place, the file never grows
+    CHECK_EQ(hostFlashFileSize(ALERT_HISTORY_FILE), ALERT_HISTORY_CAPACITY * sizeof(AlertEvent));
+}
+
+TEST(wraparoundKeepsNewestEvents) {
+    alertHistory.clear();
+    const uint32_t total = ALERT_HISTORY_CAPACITY * 2 + 37;
+    toggleTempHigh(alertHistory, total);
+    CHECK_EQ(alertHistory.getStoredEvents(), ALERT_HISTORY_CAPACITY);
+
+    AlertQuery query = {};
+    std::vector<AlertEvent> all = queryAll(alertHistory, query);
+    REQUIRE(all.size() == ALERT_HISTORY_CAPACITY);
+    for (uint32_t i = 0; i < all.size(); i++) {
+        CHECK_EQ(all[i].seq, total - i);
+        CHECK_EQ(all[i].timestamp, 1000 + (total - i - 1) * 60);
+    }
+}
+
+TEST(reloadRecoversSequenceAndActiveFlags) {
+    alertHistory.clear();
+    toggleTempHigh(alertHistory, ALERT_HISTORY_CAPACITY + 11);
+    alertHistory.update(ALERT_TEMP_LOW | ALERT_QUEEN_ISSUE, reading(3.0f), 90000);
+    uint8_t active = alertHistory.getActiveFlags();
+    uint32_t stored = alertHistory.getStoredEvents();
+
+    // A fresh instance reads the ring back, as after a reset
+    AlertHistory rebooted;
+    CHECK_EQ(rebooted.getActiveFlags(), active);
+    CHECK_EQ(rebooted.getStoredEvents(), stored);
+
+    // A condition that persists across the reset is not logged again
+    CHECK_EQ(rebooted.update(active, reading(3.0f), 90060), 0);
+    CHECK_EQ(rebooted.update(ALERT_TEMP_LOW, reading(3.0f), 90120), 1);
+
+    AlertQuery query = {};
+    AlertEvent events[ALERT_HISTORY_MAX_PAGE];
+    bool more;
+    REQUIRE(rebooted.query(query, events, more) > 0);
+    CHECK_EQ(events[0].seq, ALERT_HISTORY_CAPACITY + 11 + 3 + 1);
+    CHECK_EQ(events[0].alertFlag, ALERT_QUEEN_ISSUE);
+    CHECK_EQ(events[0].raised, 0);
+}
+
+TEST(corruptSlotIsSkipped) {
+    alertHistory.clear();
+    toggleTempHigh(alertHistory, 5);
+
+    // Flip a byte inside event 3's slot
+    Adafruit_LittleFS_Namespace::File file(InternalFS);
+    REQUIRE(file.open(ALERT_HISTORY_FILE, Adafruit_LittleFS_Namespace::FILE_O_WRITE));
+    file.seek(3 * sizeof(AlertEvent) + offsetof(AlertEvent, value));
+    file.write((uint8_t)0x5A);
+    file.close();
+
+    AlertHistory rebooted;
+    AlertQuery query = {};
+    std::vector<AlertEvent> all = queryAll(rebooted, query);
+    REQUIRE(all.size() == 4);
+    for (const AlertEvent& e : all) CHECK(e.seq != 3);
+    CHECK_EQ(rebooted.getActiveFlags(), ALERT_TEMP_HIGH);
+}
+
+// =============================================================================
+// QUERIES
+// =============================================================================
+
+TEST(queryFiltersByTimeAndType) {
+    alertHistory.clear();
+    toggleTempHigh(alertHistory, 20, 1000);
+    alertHistory.update(ALERT_SWARM_RISK, reading(30.0f), 5000);
+    alertHistory.update(ALERT_NONE, reading(30.0f), 5060);
+
+    AlertQuery query = {};
+    query.fromTime = 1000 + 5 * 60;
+    query.toTime = 1000 + 9 * 60;
+    std::vector<AlertEvent> inRange = queryAll(alertHistory, query);
+    CHECK_EQ(inRange.size(), 5);
+    for (const AlertEvent& e : inRange) {
+        CHECK(e.timestamp >= query.fromTime && e.timestamp <= query.toTime);
+    }
+
+    query = {};
+    query.typeMask = ALERT_SWARM_RISK;
+    std::vector<AlertEvent> swarm = queryAll(alertHistory, query);
+    REQUIRE(swarm.size() == 2);
+    CHECK_EQ(swarm[0].raised, 0);
+    CHECK_EQ(swarm[1].raised, 1);
+}
+
+TEST(pagingWithBeforeSeqVisitsEveryEventOnce) {
+    alertHistory.clear();
+    toggleTempHigh(alertHistory, 50);
+
+    AlertQuery query = {};
+    query.maxEvents = 7;
+    AlertEvent page[ALERT_HISTORY_MAX_PAGE];
+    bool more = true;
+    uint32_t expected = 50, pages = 0;
+    while (more) {
+        uint8_t n = alertHistory.query(query, page, more);
+        REQUIRE(n > 0);
+        for (uint8_t i = 0; i < n; i++) CHECK_EQ(page[i].seq, expected--);
+        query.beforeSeq = page[n - 1].seq;
+        pages++;
+    }
+    CHECK_EQ(expected, 0);
+    CHECK_EQ(pages, (50 + 6) / 7);
+
+    // Page sizes above the cap are clamped
+    query = {};
+    query.maxEvents = 200;
+    CHECK_EQ(alertHistory.query(query, page, more), ALERT_HISTORY_MAX_PAGE);
+    CHECK(more);
+}
+
+// =============================================================================
+// OVER THE LINK
+// =============================================================================
+
+struct AlertPage {
+    std::vector<uint32_t> seqs;
+    bool more;
+    uint32_t nextBefore;
+    uint8_t active;
+    uint32_t stored;
+    uint16_t frames;
+};
+
+static std::vector<uint8_t> alertArgs(uint8_t max, uint32_t beforeSeq) {
+    std::vector<uint8_t> args(14, 0);
+    args[9] = max;
+    putU32LE(&args[10], beforeSeq);
+    return args;
+}
+
+static bool alertsOverLink(BleSimClient& client, const std::vector<uint8_t>& args, bool cbor, AlertPage& out) {
+    uint8_t id = client.send(BT_CMD_GET_ALERTS, args, cbor ? BT_REQ_FLAG_CBOR : 0);
+    if (!client.runUntil([&] { return client.responseCount(id) == 1; })) return false;
+    const SimResponse* r = client.lastResponse(id);
+    BleFields fields;
+    if (r->code != BT_RESP_OK || r->seqError) return false;
+    if (!(cbor ? decodeCbor(r->payload, fields) : decodeTlv(r->payload, "AL", fields))) return false;
+
+    const BleValue* alerts = findField(fields, BT_AL_alerts);
+    if (!alerts) return false;
+    out.seqs.clear();
+    for (const BleFields& record : alerts->records) {
+        const BleValue* seq = findField(record, BT_AE_seq);
+        if (seq) out.seqs.push_back(seq->scalar);
+    }
+    out.more = findField(fields, BT_AL_more)->scalar;
+    out.nextBefore = out.more ? findField(fields, BT_AL_nextBefore)->scalar : 0;
+    out.active = findField(fields, BT_AL_active)->scalar;
+    out.stored = findField(fields, BT_AL_stored)->scalar;
+    out.frames = r->frames;
+    return true;
+}
+
+static void pageThroughLink(uint16_t mtu, bool cbor) {
+    hostBootDevice();
+    alertHistory.clear();
+    toggleTempHigh(alertHistory, 40);
+
+    BleSimClient client;
+    client.begin({ mtu, 24, 4, 4, 0, 1 });
+    AlertPage page;
+    uint32_t expected = 40, requests = 0;
+    page.nextBefore = 0;
+    do {
+        REQUIRE(alertsOverLink(client, alertArgs(0, page.nextBefore), cbor, page));
+        REQUIRE(!page.seqs.empty());
+        // Without the cap a full page at 20-byte packets overflows the queue
+        if (mtu == 23) CHECK(page.seqs.size() < ALERT_HISTORY_MAX_PAGE);
+        for (uint32_t seq : page.seqs) CHECK_EQ(seq, expected--);
+        CHECK_EQ(page.stored, 40);
+        CHECK_EQ(page.active, ALERT_NONE);
+        requests++;
+    } while (page.more && requests < 100);
+    CHECK_EQ(expected, 0);
+}
+
+TEST(alertsPagedOverLinkAtLargeMtu) {
+    pageThroughLink(247, false);
+    pageThroughLink(247, true);
+}
+
+TEST(alertsPagedOverLinkAtSmallMtu) {
+    pageThroughLink(23, false);
+    pageThroughLink(23, true);
+}
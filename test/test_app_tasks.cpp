@@ -0,0 +1,155 @@
+/**
+ * test_app_tasks.cpp
+ * The task layout on the pthreads FreeRTOS port
+ *
+ * The tasks start once and keep running between tests, as on the
+ * device; every test takes the system lock before touching shared state.
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "AppTasks.h"
+#include "EventScheduler.h"
+#include <atomic>
+#include <functional>
+#include <thread>
+
+extern SensorData currentData;
+extern SystemSettings settings;
+extern SystemStatus systemStatus;
+extern RTC_PCF8523 rtc;
+
+static const uint16_t STACK_WORDS[APP_TASK_COUNT] = {
+    TASK_STACK_AUDIO, TASK_STACK_SENSOR, TASK_STACK_STORAGE, TASK_STACK_BLE
+};
+
+static std::atomic<uint32_t> microphoneReads(0);
+
+static int countMicrophoneReads(int pin, uint64_t us) {
+    (void)us;
+    if (pin == AUDIO_INPUT_PIN) microphoneReads++;
+    return 2048;
+}
+
+static bool startTasks() {
+    hostUseRealTime(true);
+    if (appTasks.isRunning()) return true;
+    hostBootDevice();
+    settings.logEnabled = false;
+    return appTasks.begin();
+}
+
+static bool waitUntil(const std::function<bool()>& done, unsigned long timeoutMs) {
+    unsigned long start = millis();
+    while (!done()) {
+        if (millis() - start > timeoutMs) return false;
+        delay(5);
+    }
+    return true;
+}
+
+static uint32_t logFileSize() {
+    DateTime now = rtc.now();
+    char filename[12];
+    sprintf(filename, "/H%02d%02d.CSV", now.year() % 100, now.month());
+    return (uint32_t)hostSdFileSize(filename);
+}
+
+TEST(tasksStartAndReportStack) {
+    REQUIRE(startTasks());
+    CHECK(appTasks.begin());                 // A second call changes nothing
+    delay(150);
+    for (uint8_t i = 0; i < APP_TASK_COUNT; i++) {
+        uint32_t free = appTasks.getStackFree(i);
+        CHECK(free > 0);
+        CHECK(free < STACK_WORDS[i] * 4u);
+    }
+}
+
+TEST(storageTaskWritesQueuedReadings) {
+    REQUIRE(startTasks());
+    appTasks.lock();
+    systemStatus.sdWorking = SD.begin(SD_CS_PIN);
+    uint32_t before = logFileSize();
+    SensorData reading = currentData;
+    appTasks.unlock();
+
+    CHECK(appTasks.queueStorage(STORE_LOG_READING, &reading));
+    CHECK(waitUntil([&] {
+        appTasks.lock();
+        uint32_t size = logFileSize();
+        appTasks.unlock();
+        return size > before;
+    }, 2000));
+}
+
+TEST(fullStorageQueueDropsRequest) {
+    REQUIRE(startTasks());
+    appTasks.lock();
+    // The storage task takes one request and waits for the lock; the
+    // queue holds the rest
+    int accepted = 0;
+    for (int i = 0; i < TASK_STORAGE_QUEUE + 2; i++) {
+        if (appTasks.queueStorage(STORE_FLUSH_FIELD_BUFFER, nullptr)) accepted++;
+        delay(20);
+    }
+    appTasks.unlock();
+    CHECK_EQ(accepted, TASK_STORAGE_QUEUE + 1);
+    delay(100);
+}
+
+TEST(samplingContinuesWhileSystemLockIsHeld) {
+    REQUIRE(startTasks());
+    appTasks.lock();
+    systemStatus.pdmWorking = true;
+    microphoneReads = 0;
+    hostSetAnalogSource(countMicrophoneReads);
+    appTasks.setActive(true);
+
+    // As a slow SD write or display refresh would
+    delay(600);
+    uint32_t reads = microphoneReads;
+    appTasks.setActive(false);
+    appTasks.unlock();
+    CHECK(reads >= 4);
+    delay(150);
+    hostSetAnalogSource(nullptr);
+}
+
+TEST(analysisRequestIsAnsweredByAudioTask) {
+    REQUIRE(startTasks());
+    appTasks.lock();
+    systemStatus.pdmWorking = true;
+    appTasks.unlock();
+    appTasks.setActive(true);
+
+    AudioAnalysisResult result;
+    CHECK(!appTasks.takeAnalysis(result));
+    CHECK(appTasks.requestAnalysis());
+    CHECK(waitUntil([&] { return appTasks.takeAnalysis(result); }, 2000));
+    appTasks.setActive(false);
+    delay(150);
+}
+
+TEST(unlockedWaitLetsOtherTasksIn) {
+    REQUIRE(startTasks());
+    std::atomic<bool> entered(false);
+    appTasks.lock();
+    std::thread other([&] {
+        appTasks.lock();
+        entered = true;
+        appTasks.unlock();
+    });
+    CHECK(!appTasks.unlockedWait(200));
+    CHECK(entered);
+    appTasks.unlock();
+    other.join();
+}
+
+TEST(bleEventsGoToBleTask) {
+    REQUIRE(startTasks());
+    eventScheduler.post(EVT_BLE);
+    CHECK(!eventScheduler.take(EVT_BLE));
+    eventScheduler.post(EVT_BUTTON);
+    CHECK(eventScheduler.take(EVT_BUTTON));
+}
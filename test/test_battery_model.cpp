@@ -0,0 +1,205 @@
+/**
+ * test_battery_model.cpp
+ * State of charge and runtime against synthetic discharges: a simulated
+ * cell is drained at a known current, read through its internal
+ * resistance with ADC noise, and the model has to follow it
+ */
+
+#include "HostTest.h"
+#include "BatteryModel.h"
+
+#define HOUR_MS 3600000UL
+
+// Discharge curve of the simulated cell, SoC % to open-circuit volts
+static const float cellCurve[][2] = {
+    {   0, 3.27f }, {   5, 3.61f }, {  10, 3.69f }, {  15, 3.71f },
+    {  20, 3.73f }, {  30, 3.77f }, {  40, 3.79f }, {  50, 3.82f },
+    {  60, 3.87f }, {  70, 3.92f }, {  80, 3.98f }, {  90, 4.06f },
+    { 100, 4.20f }
+};
+
+struct SimCell {
+    float chargeMah;             // Nominal charge left, as at 25 C
+    float tempC;
+    uint32_t noiseState;
+
+    float usableCapacity() const {
+        return BATTERY_CAPACITY_MAH * BatteryModel::capacityFactorAt(tempC);
+    }
+
+    // Share of the nominal charge left, what the model reports as SoC
+    float soc() const {
+        return chargeMah / BATTERY_CAPACITY_MAH;
+    }
+
+    float usableMah() const {
+        return soc() * usableCapacity();
+    }
+
+    float ocv() const {
+        float percent = soc() * 100.0f;
+        for (int i = 1; i < 13; i++) {
+            if (percent <= cellCurve[i][0]) {
+                float t = (percent - cellCurve[i - 1][0]) / (cellCurve[i][0] - cellCurve[i - 1][0]);
+                return cellCurve[i - 1][1] + t * (cellCurve[i][1] - cellCurve[i - 1][1]);
+            }
+        }
+        return cellCurve[12][1];
+    }
+
+    float resistance() const {
+        if (tempC >= BATTERY_REF_TEMP_C) return BATTERY_R_INTERNAL_OHM;
+        return BATTERY_R_INTERNAL_OHM * (1.0f + 0.03f * (BATTERY_REF_TEMP_C - tempC));
+    }
+
+    // Deterministic ADC noise, uniform within +/- amplitude
+    float noise(float amplitude) {
+        noiseState = noiseState * 1103515245u + 12345u;
+        return ((int)((noiseState >> 8) % 2001) - 1000) / 1000.0f * amplitude;
+    }
+
+    float terminalVoltage(float loadMa, float noiseV) {
+        return ocv() - loadMa / 1000.0f * resistance() + noise(noiseV);
+    }
+
+    void drain(float ma, float hours) {
+        // A cold cell gives up its usable charge faster
+        chargeMah -= ma * hours / BatteryModel::capacityFactorAt(tempC);
+        if (chargeMah < 0.0f) chargeMah = 0.0f;
+    }
+};
+
+static SimCell makeCell(float socPercent, float tempC) {
+    return { socPercent / 100.0f * BATTERY_CAPACITY_MAH, tempC, 12345u };
+}
+
+// Hourly readings under a reading load, draining avgMa in between;
+// returns the largest SoC error seen once the filter has settled
+static float runDischarge(BatteryModel& model, SimCell& cell, float avgMa, float loadMa,
+                          float noiseV, uint32_t hours, uint32_t settleHours = 6) {
+    float worst = 0.0f;
+    unsigned long nowMs = HOUR_MS;
+    model.update(cell.terminalVoltage(loadMa, noiseV), loadMa, avgMa, cell.tempC, nowMs);
+    for (uint32_t h = 1; h <= hours && cell.soc() > 0.05f; h++) {
+        cell.drain(avgMa, 1.0f);
+        nowMs += HOUR_MS;
+        model.update(cell.terminalVoltage(loadMa, noiseV), loadMa, avgMa, cell.tempC, nowMs);
+        if (h >= settleHours) worst = max(worst, fabsf(model.getSoc() - cell.soc()));
+    }
+    return worst;
+}
+
+// =============================================================================
+// TESTS
+// =============================================================================
+
+TEST(curveLookupAtTheTablePoints) {
+    CHECK_EQ(batteryOcvToPercent(4.20f), 100);
+    CHECK_EQ(batteryOcvToPercent(3.82f), 50);
+    CHECK_EQ(batteryOcvToPercent(3.27f), 0);
+    CHECK_EQ(batteryOcvToPercent(3.00f), 0);
+    CHECK_EQ(batteryOcvToPercent(3.805f), 45);
+}
+
+TEST(noReadingLeavesTheModelUnset) {
+    BatteryModel model;
+    model.update(0.0f, 10.0f, 10.0f, 25.0f, HOUR_MS);
+    CHECK(!model.isValid());
+    CHECK_EQ(model.getLevel(3.82f), 50);
+    CHECK(model.predictRuntimeHours(5.0f) == 999.0f);
+}
+
+TEST(tracksAFullDischargeThroughTheFlatMiddle) {
+    BatteryModel model;
+    SimCell cell = makeCell(95, 25.0f);
+    // 10 mA average, 15 mA while the ADC reads, 15 mV noise
+    float worst = runDischarge(model, cell, 10.0f, 15.0f, 0.015f, 200);
+
+    CHECK(cell.soc() <= 0.05f);
+    CHECK(worst < 0.05f);
+    CHECK(abs(model.getLevel(3.5f) - (int)(cell.soc() * 100.0f + 0.5f)) <= 3);
+
+    // The filter is more certain than a single curve reading
+    CHECK(model.getSocSigma() < sqrtf(BATTERY_INITIAL_VARIANCE) / 2.0f);
+}
+
+TEST(loadSagIsCorrectedBeforeTheLookup) {
+    // A reading taken while the radio draws 250 mA
+    SimCell cell = makeCell(60, 25.0f);
+    float loaded = cell.terminalVoltage(250.0f, 0.0f);
+
+    BatteryModel model;
+    model.update(loaded, 250.0f, 5.0f, cell.tempC, HOUR_MS);
+    CHECK(abs(model.getLevel(loaded) - 60) <= 1);
+
+    // Read as open-circuit it would look several points emptier
+    CHECK(batteryOcvToPercent(loaded) <= 55);
+}
+
+TEST(coldCellSagsMoreAndIsStillCorrected) {
+    SimCell warm = makeCell(60, 25.0f);
+    SimCell cold = makeCell(60, 0.0f);
+    float warmV = warm.terminalVoltage(250.0f, 0.0f);
+    float coldV = cold.terminalVoltage(250.0f, 0.0f);
+    CHECK(coldV < warmV - 0.005f);
+
+    BatteryModel model;
+    model.update(coldV, 250.0f, 5.0f, cold.tempC, HOUR_MS);
+    CHECK(abs(model.getLevel(coldV) - 60) <= 1);
+}
+
+TEST(coldCellLosesUsableCharge) {
+    BatteryModel warmModel;
+    SimCell warm = makeCell(80, 25.0f);
+    float warmWorst = runDischarge(warmModel, warm, 10.0f, 15.0f, 0.01f, 24);
+
+    BatteryModel coldModel;
+    SimCell cold = makeCell(80, 0.0f);
+    float coldWorst = runDischarge(coldModel, cold, 10.0f, 15.0f, 0.01f, 24);
+
+    // Same current, more state of charge gone in the cold
+    CHECK(cold.soc() < warm.soc() - 0.03f);
+    CHECK(warmWorst < 0.04f);
+    CHECK(coldWorst < 0.04f);
+
+    // And less of what is left can be used
+    CHECK(fabsf(coldModel.getRemainingMah() - cold.usableMah()) < 0.04f * BATTERY_CAPACITY_MAH);
+    CHECK(coldModel.getRemainingMah() < warmModel.getRemainingMah() * 0.9f);
+}
+
+TEST(runtimeFromTheObservedDrain) {
+    BatteryModel model;
+    SimCell cell = makeCell(90, 25.0f);
+
+    // Before a window closes the modelled current is used
+    model.update(cell.terminalVoltage(15.0f, 0.0f), 15.0f, 8.0f, cell.tempC, HOUR_MS);
+    CHECK(model.getObservedDrainMa() == 0.0f);
+    CHECK(fabsf(model.predictRuntimeHours(4.0f) - model.getRemainingMah() / 4.0f) < 0.01f);
+
+    // The device really draws 8 mA though the model says 4
+    runDischarge(model, cell, 8.0f, 15.0f, 0.01f, 3 * BATTERY_RATE_WINDOW_H);
+    CHECK(model.getObservedDrainMa() > 0.0f);
+    CHECK(fabsf(model.getObservedDrainMa() - 8.0f) < 1.5f);
+
+    float trueHours = cell.usableMah() / 8.0f;
+    CHECK(fabsf(model.predictRuntimeHours(4.0f) - trueHours) < trueHours * 0.15f);
+}
+
+TEST(usbHoldsTheFilterAndRestartsFromTheCurve) {
+    BatteryModel model;
+    SimCell cell = makeCell(50, 25.0f);
+    runDischarge(model, cell, 10.0f, 15.0f, 0.0f, 12);
+
+    model.update(4.8f, 15.0f, 10.0f, 25.0f, 20 * HOUR_MS);
+    CHECK(model.isCharging());
+    CHECK_EQ(model.getLevel(4.8f), 100);
+    CHECK(model.predictRuntimeHours(5.0f) == 999.0f);
+
+    // Charged to 85% while on the cable
+    SimCell charged = makeCell(85, 25.0f);
+    float v = charged.terminalVoltage(15.0f, 0.0f);
+    model.update(v, 15.0f, 10.0f, 25.0f, 30 * HOUR_MS);
+    CHECK(!model.isCharging());
+    CHECK(abs(model.getLevel(v) - 85) <= 1);
+    CHECK(model.getObservedDrainMa() == 0.0f);
+}
@@ -0,0 +1,421 @@
+/**
+ * test_ble_beacon.cpp
+ * Status beacon payload encoding, power estimate and the beacon mode of
+ * the Bluetooth manager, with the alert latch and the gateway's acks
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "Bluetooth.h"
+#include "BleBeacon.h"
+#include "BleGateway.h"
+#include "Utils.h"
+
+extern BluetoothManager bluetoothManager;
+extern SensorData currentData;
+
+static BeaconStatus sampleStatus() {
+    BeaconStatus s;
+    s.deviceId = 42;
+    s.batteryVoltage = 3.9f;
+    s.temperature = 34.56f;
+    s.beeState = BEE_NORMAL;
+    s.abscondingRisk = 17;
+    s.alertFlags = ALERT_TEMP_HIGH | ALERT_LOW_BATTERY;
+    s.readingAgeMinutes = 3;
+    s.counter = 200;
+    s.alertLatch = ALERT_SWARM_RISK | ALERT_TEMP_HIGH;
+    s.alertSeq = 7;
+    return s;
+}
+
+// =============================================================================
+// PAYLOAD
+// =============================================================================
+
+TEST(payloadLayout) {
+    uint8_t p[BEACON_PAYLOAD_SIZE];
+    REQUIRE(encodeBeaconPayload(sampleStatus(), p) == BEACON_PAYLOAD_SIZE);
+    CHECK_EQ(getU16LE(&p[0]), BEACON_COMPANY_ID);
+    CHECK_EQ(p[2], BEACON_VERSION);
+    CHECK_EQ(p[3], 42);
+    CHECK_EQ(p[4], 195);
+    CHECK_EQ((int16_t)getU16LE(&p[5]), 3456);
+    CHECK_EQ(p[7], BEE_NORMAL);
+    CHECK_EQ(p[8], 17);
+    CHECK_EQ(p[9], ALERT_TEMP_HIGH | ALERT_LOW_BATTERY);
+    CHECK_EQ(p[10], 3);
+    CHECK_EQ(p[11], 200);
+    CHECK_EQ(p[12], ALERT_SWARM_RISK | ALERT_TEMP_HIGH);
+    CHECK_EQ(p[13], 7);
+}
+
+TEST(payloadFitsLegacyAdvertising) {
+    // Flags plus the manufacturer AD structure within the 31-byte limit,
+    // with a gateway's full list of acks too
+    CHECK(BEACON_FLAGS_BYTES + BEACON_AD_HEADER_BYTES + BEACON_MAX_PAYLOAD <= 31);
+}
+
+TEST(payloadRoundTrip) {
+    uint8_t p[BEACON_PAYLOAD_SIZE];
+    BeaconStatus in = sampleStatus();
+    encodeBeaconPayload(in, p);
+    BeaconStatus out;
+    REQUIRE(decodeBeaconPayload(p, sizeof(p), out));
+    CHECK_EQ(out.deviceId, in.deviceId);
+    CHECK(fabsf(out.batteryVoltage - in.batteryVoltage) <= 0.01f);
+    CHECK(fabsf(out.temperature - in.temperature) <= 0.005f);
+    CHECK_EQ(out.beeState, in.beeState);
+    CHECK_EQ(out.abscondingRisk, in.abscondingRisk);
+    CHECK_EQ(out.alertFlags, in.alertFlags);
+    CHECK_EQ(out.readingAgeMinutes, in.readingAgeMinutes);
+    CHECK_EQ(out.counter, in.counter);
+    CHECK_EQ(out.alertLatch, in.alertLatch);
+    CHECK_EQ(out.alertSeq, in.alertSeq);
+}
+
+TEST(outOfRangeValuesClamp) {
+    uint8_t p[BEACON_PAYLOAD_SIZE];
+    BeaconStatus s = sampleStatus();
+    BeaconStatus out;
+
+    s.batteryVoltage = 6.0f;
+    s.temperature = -400.0f;
+    encodeBeaconPayload(s, p);
+    REQUIRE(decodeBeaconPayload(p, sizeof(p), out));
+    CHECK_EQ(p[4], 255);
+    CHECK_EQ((int16_t)getU16LE(&p[5]), -32768);
+
+    s.batteryVoltage = -1.0f;
+    s.temperature = -12.34f;
+    encodeBeaconPayload(s, p);
+    REQUIRE(decodeBeaconPayload(p, sizeof(p), out));
+    CHECK_EQ(p[4], 0);
+    CHECK(fabsf(out.temperature + 12.34f) <= 0.005f);
+}
+
+TEST(foreignPayloadsRejected) {
+    uint8_t p[BEACON_PAYLOAD_SIZE];
+    BeaconStatus out;
+    encodeBeaconPayload(sampleStatus(), p);
+    CHECK(!decodeBeaconPayload(p, BEACON_PAYLOAD_SIZE - 1, out));
+
+    uint8_t other[BEACON_PAYLOAD_SIZE];
+    memcpy(other, p, sizeof(p));
+    putU16LE(other, 0x0059);                 // Another company's record
+    CHECK(!decodeBeaconPayload(other, sizeof(other), out));
+
+    memcpy(other, p, sizeof(p));
+    other[2] = BEACON_VERSION + 1;
+    CHECK(!decodeBeaconPayload(other, sizeof(other), out));
+}
+
+// =============================================================================
+// ALERT LATCH
+// =============================================================================
+
+// A gateway beacon acknowledging the given latches
+static uint8_t gatewayBeacon(const std::vector<BeaconAck>& acks, uint8_t* out) {
+    uint8_t len = encodeBeaconPayload(sampleStatus(), out);
+    return len + 2 * encodeBeaconAcks(acks.data(), acks.size(), out + len);
+}
+
+TEST(acksFollowTheStatusRecord) {
+    uint8_t p[BEACON_MAX_PAYLOAD + 4];
+    std::vector<BeaconAck> acks;
+    for (uint8_t i = 0; i < BEACON_MAX_ACKS + 2; i++) acks.push_back({ (uint8_t)(i + 1), (uint8_t)(i * 3) });
+    uint8_t len = gatewayBeacon(acks, p);
+    CHECK_EQ(len, BEACON_MAX_PAYLOAD);
+
+    BeaconAck out[BEACON_MAX_ACKS];
+    REQUIRE(decodeBeaconAcks(p, len, out, BEACON_MAX_ACKS) == BEACON_MAX_ACKS);
+    CHECK_EQ(out[5].deviceId, 6);
+    CHECK_EQ(out[5].alertSeq, 15);
+
+    // A plain status record, or not a beacon at all, carries none
+    CHECK_EQ(decodeBeaconAcks(p, BEACON_PAYLOAD_SIZE, out, BEACON_MAX_ACKS), 0);
+    p[2] = BEACON_VERSION + 1;
+    CHECK_EQ(decodeBeaconAcks(p, len, out, BEACON_MAX_ACKS), 0);
+}
+
+TEST(latchHoldsARaiseUntilAcknowledged) {
+    BeaconAlertLatch latch;
+    uint8_t p[BEACON_MAX_PAYLOAD];
+
+    latch.onReading(ALERT_SWARM_RISK);
+    latch.onReading(0);
+    CHECK(latch.isPending());
+    CHECK_EQ(latch.getFlags(), ALERT_SWARM_RISK);
+    CHECK_EQ(latch.getSeq(), 1);
+
+    // Acks for another node or an older raise leave it
+    CHECK(!latch.onGatewayBeacon(9, p, gatewayBeacon({ { 8, 1 }, { 9, 0 } }, p)));
+    CHECK(latch.isPending());
+    CHECK(latch.onGatewayBeacon(9, p, gatewayBeacon({ { 8, 1 }, { 9, 1 } }, p)));
+    CHECK(!latch.isPending());
+
+    // An alert still active is not raised again; a new one is
+    latch.onReading(ALERT_TEMP_HIGH);
+    latch.onReading(ALERT_TEMP_HIGH);
+    CHECK_EQ(latch.getSeq(), 2);
+    latch.onReading(0);
+    latch.onReading(ALERT_TEMP_HIGH);
+    CHECK_EQ(latch.getSeq(), 3);
+}
+
+TEST(raiseDuringTheAckIsKept) {
+    BeaconAlertLatch latch;
+    uint8_t p[BEACON_MAX_PAYLOAD];
+    latch.onReading(ALERT_TEMP_HIGH);
+
+    // The gateway filed sequence 1; the node has raised another since
+    latch.onReading(ALERT_TEMP_HIGH | ALERT_QUEEN_ISSUE);
+    CHECK(!latch.onGatewayBeacon(9, p, gatewayBeacon({ { 9, 1 } }, p)));
+    CHECK_EQ(latch.getFlags(), ALERT_TEMP_HIGH | ALERT_QUEEN_ISSUE);
+}
+
+// =============================================================================
+// POWER ESTIMATE
+// =============================================================================
+
+TEST(currentFallsWithInterval) {
+    float atDefault = estimateBeaconCurrentUa(BEACON_DEFAULT_INTERVAL_MS, BEACON_PAYLOAD_SIZE);
+    CHECK(atDefault > 3.0f && atDefault < 4.5f);
+
+    // One event per interval: the current is inversely proportional
+    float atMin = estimateBeaconCurrentUa(BEACON_MIN_INTERVAL_MS, BEACON_PAYLOAD_SIZE);
+    CHECK(fabsf(atMin - atDefault * 2) < 0.01f);
+    CHECK(estimateBeaconCurrentUa(BEACON_MAX_INTERVAL_MS, BEACON_PAYLOAD_SIZE) < 1.0f);
+    CHECK(estimateBeaconCurrentUa(0, BEACON_PAYLOAD_SIZE) == 0);
+
+    // Longer records cost air time
+    CHECK(estimateBeaconCurrentUa(BEACON_DEFAULT_INTERVAL_MS, 26) > atDefault);
+}
+
+TEST(beaconPowerBudget) {
+    // Benchmark: average current and daily charge per interval
+    printf("  interval ms   uA    mAh/day\n");
+    for (uint16_t ms : { (uint16_t)1000, (uint16_t)2000, (uint16_t)5000, (uint16_t)10240 }) {
+        float ua = estimateBeaconCurrentUa(ms, BEACON_PAYLOAD_SIZE);
+        printf("  %11u  %5.2f  %7.3f\n", ms, ua, ua * 24 / 1000.0f);
+        CHECK(ua > 0);
+    }
+}
+
+// =============================================================================
+// BEACON MODE
+// =============================================================================
+
+// Not discoverable and not connected, so the beacon is the only radio use.
+// The manager outlives each test, so every test starts its clock a day
+// later or update() could still be inside the last test's one-second gate.
+static void beaconOnly(uint16_t intervalMs = BEACON_DEFAULT_INTERVAL_MS) {
+    static uint64_t startDay = 0;
+    hostBootDevice();
+    hostSetMicros(++startDay * 86400000000ULL);
+    bluetoothManager.getSettings().enabled = false;
+    bluetoothManager.start();
+    bluetoothManager.getState().clientConnected = false;
+    bluetoothManager.getState().status = BT_STATUS_OFF;
+    bluetoothManager.setBeacon(true, intervalMs);
+
+    memset(&currentData, 0, sizeof(currentData));
+    currentData.batteryVoltage = 3.7f;
+    currentData.temperature = 33.0f;
+    currentData.beeState = BEE_NORMAL;
+    currentData.alertFlags = ALERT_HUMIDITY_HIGH;
+}
+
+// update() runs its radio housekeeping once a second
+static void tick(uint32_t seconds = 1) {
+    for (uint32_t i = 0; i < seconds; i++) {
+        hostAdvanceMillis(1000);
+        bluetoothManager.update();
+    }
+}
+
+static BeaconStatus onAir() {
+    BeaconStatus s;
+    memset(&s, 0, sizeof(s));
+    decodeBeaconPayload(bluetoothManager.getBeaconPayload(), BEACON_PAYLOAD_SIZE, s);
+    return s;
+}
+
+TEST(beaconAdvertisesCurrentReading) {
+    beaconOnly();
+    bluetoothManager.onNewReading();
+    tick();
+    CHECK_EQ(bluetoothManager.getStatus(), BT_STATUS_BEACON);
+    CHECK(bluetoothManager.needsRadioWhileAsleep());
+
+    BeaconStatus s = onAir();
+    CHECK_EQ(s.deviceId, bluetoothManager.getSettings().deviceId);
+    CHECK(fabsf(s.batteryVoltage - 3.7f) <= 0.01f);
+    CHECK(fabsf(s.temperature - 33.0f) <= 0.005f);
+    CHECK_EQ(s.alertFlags, ALERT_HUMIDITY_HIGH);
+    CHECK_EQ(s.readingAgeMinutes, 0);
+}
+
+TEST(readingAgeAndCounterTrackReadings) {
+    beaconOnly();
+    bluetoothManager.onNewReading();
+    tick();
+    uint8_t counter = onAir().counter;
+
+    tick(3 * 60);
+    CHECK_EQ(onAir().readingAgeMinutes, 3);
+    CHECK_EQ(onAir().counter, counter);
+
+    // A new reading resets the age and tells scanners the data is fresh
+    currentData.temperature = 35.5f;
+    bluetoothManager.onNewReading();
+    tick();
+    CHECK_EQ(onAir().readingAgeMinutes, 0);
+    CHECK_EQ(onAir().counter, (uint8_t)(counter + 1));
+    CHECK(fabsf(onAir().temperature - 35.5f) <= 0.005f);
+
+    // The age saturates instead of wrapping
+    tick(5 * 3600);
+    CHECK_EQ(onAir().readingAgeMinutes, BEACON_AGE_UNKNOWN);
+}
+
+TEST(beaconCarriesTheLatchUntilTheGatewayAcks) {
+    beaconOnly();
+    currentData.alertFlags = ALERT_SWARM_RISK;
+    bluetoothManager.onNewReading();
+    currentData.alertFlags = 0;
+    bluetoothManager.onNewReading();
+    tick();
+    CHECK(onAir().alertLatch & ALERT_SWARM_RISK);
+    CHECK_EQ(onAir().alertFlags, 0);
+    CHECK(bluetoothManager.isListeningForAck());
+
+    // Heard from the gateway while listening after the reading
+    uint8_t p[BEACON_MAX_PAYLOAD];
+    uint8_t id = bluetoothManager.getSettings().deviceId;
+    uint8_t seq = bluetoothManager.getAlertLatch().getSeq();
+    bluetoothManager.queueGatewayBeacon(p, gatewayBeacon({ { id, seq } }, p));
+    tick();
+    CHECK(!bluetoothManager.getAlertLatch().isPending());
+    CHECK(!bluetoothManager.isListeningForAck());
+    CHECK_EQ(onAir().alertLatch, 0);
+}
+
+TEST(listeningStopsAfterTheWindow) {
+    beaconOnly();
+    currentData.alertFlags = ALERT_QUEEN_ISSUE;
+    bluetoothManager.onNewReading();
+    REQUIRE(bluetoothManager.isListeningForAck());
+    tick(BEACON_ACK_LISTEN_MS / 1000 + 1);
+    CHECK(!bluetoothManager.isListeningForAck());
+    CHECK(bluetoothManager.getAlertLatch().isPending());
+
+    // Nothing to hand over without the beacon
+    bluetoothManager.setBeacon(false, 0);
+    currentData.alertFlags = 0;
+    bluetoothManager.onNewReading();
+    currentData.alertFlags = ALERT_TEMP_LOW;
+    bluetoothManager.onNewReading();
+    CHECK(!bluetoothManager.isListeningForAck());
+}
+
+TEST(gatewayBeaconsItsAcks) {
+    beaconOnly();
+    bluetoothManager.setBeacon(false, 0);
+    bleGateway.setEnabled(true, GATEWAY_DEFAULT_PERIOD_MIN, bluetoothManager.getSettings().deviceId);
+    REQUIRE(bleGateway.isEnabled());
+    tick();
+    CHECK_EQ(bluetoothManager.getStatus(), BT_STATUS_OFF);
+
+    // A neighbour's beacon with a latched alert
+    BeaconStatus neighbour = sampleStatus();
+    neighbour.deviceId = 7;
+    uint8_t p[BEACON_MAX_PAYLOAD];
+    uint8_t addr[6] = { 1, 2, 3, 4, 5, 7 };
+    encodeBeaconPayload(neighbour, p);
+    bleGateway.processBeacon(addr, -60, p, BEACON_PAYLOAD_SIZE, 1735689600UL);
+    tick();
+
+    CHECK_EQ(bluetoothManager.getStatus(), BT_STATUS_BEACON);
+    BeaconAck acks[BEACON_MAX_ACKS];
+    REQUIRE(decodeBeaconAcks(bluetoothManager.getBeaconPayload(), bluetoothManager.getBeaconPayloadLength(),
+                             acks, BEACON_MAX_ACKS) == 1);
+    CHECK_EQ(acks[0].deviceId, 7);
+    CHECK_EQ(acks[0].alertSeq, 7);
+
+    // Seen cleared: nothing left to hand over
+    neighbour.alertLatch = 0;
+    encodeBeaconPayload(neighbour, p);
+    bleGateway.processBeacon(addr, -60, p, BEACON_PAYLOAD_SIZE, 1735689700UL);
+    tick();
+    CHECK(!bleGateway.hasAcks());
+    bleGateway.setEnabled(false, GATEWAY_DEFAULT_PERIOD_MIN, 0);
+}
+
+TEST(discoverableWinsOverBeacon) {
+    beaconOnly();
+    tick();
+    REQUIRE(bluetoothManager.getStatus() == BT_STATUS_BEACON);
+    bluetoothManager.getSettings().enabled = true;
+    tick();
+    CHECK_EQ(bluetoothManager.getStatus(), BT_STATUS_ADVERTISING);
+}
+
+TEST(timedWorkOnlyWhileTheRadioHasSomethingToTime) {
+    // Beacon refreshes, then nothing at all
+    beaconOnly();
+    CHECK(bluetoothManager.hasTimedWork());
+    bluetoothManager.setBeacon(false, 0);
+    tick();
+    REQUIRE(bluetoothManager.getStatus() == BT_STATUS_OFF);
+    CHECK(!bluetoothManager.hasTimedWork());
+
+    // Scan windows
+    bleGateway.setEnabled(true, GATEWAY_DEFAULT_PERIOD_MIN, bluetoothManager.getSettings().deviceId);
+    CHECK(bluetoothManager.hasTimedWork());
+    bleGateway.setEnabled(false, GATEWAY_DEFAULT_PERIOD_MIN, 0);
+    CHECK(!bluetoothManager.hasTimedWork());
+
+    // Advertising is started on the next tick, then only events matter
+    bluetoothManager.getSettings().enabled = true;
+    CHECK(bluetoothManager.hasTimedWork());
+    tick();
+    REQUIRE(bluetoothManager.getStatus() == BT_STATUS_ADVERTISING);
+    CHECK(!bluetoothManager.hasTimedWork());
+    bluetoothManager.getSettings().enabled = false;
+    CHECK(bluetoothManager.hasTimedWork());
+    bluetoothManager.getState().status = BT_STATUS_OFF;
+}
+
+TEST(intervalClampedToAdvertisingLimits) {
+    beaconOnly(100);
+    CHECK_EQ(bluetoothManager.getSettings().beaconIntervalMs, BEACON_MIN_INTERVAL_MS);
+    bluetoothManager.setBeacon(true, 60000);
+    CHECK_EQ(bluetoothManager.getSettings().beaconIntervalMs, BEACON_MAX_INTERVAL_MS);
+    bluetoothManager.setBeacon(true, 0);
+    CHECK_EQ(bluetoothManager.getSettings().beaconIntervalMs, BEACON_DEFAULT_INTERVAL_MS);
+}
+
+TEST(setBeaconRepliesWithEstimatedCurrent) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 12, 8, 4, 0, 1 });
+
+    const SimResponse* r = client.request(BT_CMD_SET_BEACON, { 1, 0xD0, 0x07 });
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_OK);
+    REQUIRE(r->payload.size() == 2);
+    uint16_t expected = (uint16_t)(estimateBeaconCurrentUa(2000, BEACON_PAYLOAD_SIZE) * 10);
+    CHECK_EQ(getU16LE(r->payload.data()), expected);
+    CHECK(bluetoothManager.getSettings().beaconEnabled);
+
+    r = client.request(BT_CMD_SET_BEACON, { 0 });
+    REQUIRE(r != nullptr);
+    CHECK_EQ(getU16LE(r->payload.data()), 0);
+    CHECK(!bluetoothManager.getSettings().beaconEnabled);
+
+    r = client.request(BT_CMD_SET_BEACON);
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_ERROR);
+}
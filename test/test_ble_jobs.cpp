@@ -0,0 +1,203 @@
+/**
+ * test_ble_jobs.cpp
+ * Long-running BLE commands as jobs: bounded work per update(), progress
+ * on the status characteristic and the loop's cadence during a transfer
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "Bluetooth.h"
+#include "EventScheduler.h"
+#include "Utils.h"
+
+extern BluetoothManager bluetoothManager;
+
+#define BIG_FILE "/BIG_TEST.CSV"
+#define BIG_FILE_SIZE (2UL * 1024 * 1024)
+
+static std::vector<uint8_t> nameArgs(const char* name) {
+    return std::vector<uint8_t>(name, name + strlen(name));
+}
+
+static std::vector<const SimPacket*> jobStatus(const BleSimClient& client, uint8_t jobType) {
+    std::vector<const SimPacket*> found;
+    for (const SimPacket& p : client.statusPackets) {
+        if (p.data.size() == BT_STATUS_PACKET_SIZE && p.data[1] == jobType) found.push_back(&p);
+    }
+    return found;
+}
+
+// =============================================================================
+// FILE STREAM
+// =============================================================================
+
+TEST(multiMegabyteStreamKeepsLoopOnSchedule) {
+    hostBootDevice();
+    std::vector<uint8_t> bytes = hostWriteFile(BIG_FILE, BIG_FILE_SIZE);
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+
+    // The timers loop() polls while awake; the BLE pass runs between them
+    EventScheduler s;
+    s.every(TIMER_AUDIO_SAMPLE, 100);
+    s.every(TIMER_SENSORS, 5000);
+    unsigned long lastAudio = millis(), lastSensors = millis();
+    unsigned long worstAudioGap = 0, worstSensorGap = 0;
+    uint32_t worstUpdateUs = 0;
+
+    uint8_t requestId = client.send(BT_CMD_GET_FILE_DATA, nameArgs(BIG_FILE));
+    unsigned long start = millis();
+    while (client.responseCount(requestId) == 0 && millis() - start < 120000UL) {
+        if (s.every(TIMER_AUDIO_SAMPLE, 100)) {
+            worstAudioGap = max(worstAudioGap, millis() - lastAudio);
+            lastAudio = millis();
+        }
+        if (s.every(TIMER_SENSORS, 5000)) {
+            worstSensorGap = max(worstSensorGap, millis() - lastSensors);
+            lastSensors = millis();
+        }
+
+        // A blocking sender would spend virtual time in delay() here
+        hostAdvanceMicros(SIM_STEP_US);
+        client.sim.advanceTo((uint32_t)hostMicros());
+        uint64_t before = hostMicros();
+        bluetoothManager.update();
+        worstUpdateUs = max(worstUpdateUs, (uint32_t)(hostMicros() - before));
+    }
+
+    const SimResponse* reply = client.lastResponse(requestId);
+    REQUIRE(reply);
+    CHECK_EQ(reply->code, BT_RESP_OK);
+    CHECK(!reply->seqError);
+    CHECK(reply->payload == bytes);
+    CHECK(millis() - start > 10000);         // Long enough to span many sensor periods
+
+    CHECK_EQ(worstUpdateUs, 0);
+    CHECK(worstAudioGap <= 100);
+    CHECK(worstSensorGap <= 5000);
+}
+
+TEST(streamProgressOnStatusCharacteristic) {
+    hostBootDevice();
+    hostWriteFile(BIG_FILE, 200000);
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    const SimResponse* reply = client.request(BT_CMD_GET_FILE_DATA, nameArgs(BIG_FILE));
+    REQUIRE(reply && reply->payload.size() == 200000);
+
+    std::vector<const SimPacket*> status = jobStatus(client, BT_JOB_FILE_STREAM);
+    REQUIRE(status.size() >= 3);
+    CHECK_EQ(status.front()->data[0], BT_STATUS_TRANSFERRING);
+    CHECK_EQ(status.front()->data[3], 0);
+    CHECK_EQ(getU32LE(&status.front()->data[8]), 200000);
+    CHECK_EQ(status.back()->data[3], 100);
+    CHECK_EQ(getU32LE(&status.back()->data[4]), 200000);
+
+    // Percent only grows, and periodic reports between the first and last
+    // are rate limited, give or take a few connection events on the air
+    for (size_t i = 1; i < status.size(); i++) {
+        CHECK(status[i]->data[3] >= status[i - 1]->data[3]);
+        if (i + 1 < status.size()) {
+            CHECK(status[i]->timeUs - status[i - 1]->timeUs >= BT_JOB_PROGRESS_INTERVAL_MS * 1000UL - 20000);
+        }
+    }
+}
+
+TEST(commandsAnsweredDuringStream) {
+    hostBootDevice();
+    hostWriteFile(BIG_FILE, 200000);
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    uint8_t streamId = client.send(BT_CMD_GET_FILE_DATA, nameArgs(BIG_FILE));
+    for (int i = 0; i < 50; i++) client.step();
+
+    const SimResponse* ping = client.request(BT_CMD_PING, {}, 1, 1000);
+    REQUIRE(ping);
+    CHECK_EQ(ping->code, BT_RESP_OK);
+    CHECK_EQ(client.responseCount(streamId), 0);
+
+    const SimResponse* second = client.request(BT_CMD_GET_FILE_DATA, nameArgs(BIG_FILE), 1, 1000);
+    REQUIRE(second);
+    CHECK_EQ(second->code, BT_RESP_BUSY);
+    CHECK(client.runUntil([&] { return client.responseCount(streamId) == 1; }));
+}
+
+TEST(disconnectCancelsStream) {
+    hostBootDevice();
+    hostWriteFile(BIG_FILE, 200000);
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    client.send(BT_CMD_GET_FILE_DATA, nameArgs(BIG_FILE));
+    for (int i = 0; i < 50; i++) client.step();
+    client.disconnect();
+
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    const SimResponse* again = client.request(BT_CMD_GET_FILE_DATA, nameArgs(BIG_FILE));
+    REQUIRE(again);
+    CHECK_EQ(again->code, BT_RESP_OK);
+    CHECK_EQ(again->payload.size(), 200000);
+}
+
+TEST(disconnectDropsQueuedCommands) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+
+    // Written just before the link drops, never run
+    uint8_t stale[3];
+    for (int i = 0; i < 3; i++) stale[i] = client.send(BT_CMD_PING);
+    client.disconnect();
+
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    const SimResponse* ping = client.request(BT_CMD_PING);
+    REQUIRE(ping);
+    CHECK_EQ(ping->code, BT_RESP_OK);
+    for (int i = 0; i < 20; i++) client.step();
+    CHECK_EQ(client.responses.size(), 1);
+    for (int i = 0; i < 3; i++) CHECK_EQ(client.responseCount(stale[i]), 0);
+}
+
+// =============================================================================
+// AUDIO CALIBRATION
+// =============================================================================
+
+TEST(calibrationAcceptedAtOnceAndAnsweredWhenDone) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 8, 4, 0, 1 });
+    unsigned long start = millis();
+    uint8_t requestId = client.send(BT_CMD_START_AUDIO_CALIBRATION, { 3 });
+    REQUIRE(client.runUntil([&] { return client.responseCount(requestId) == 1; }, 1000));
+    CHECK_EQ(client.lastResponse(requestId)->code, BT_RESP_OK);
+    CHECK(millis() - start < 100);
+
+    // The loop keeps running: other commands are served while it samples
+    const SimResponse* ping = client.request(BT_CMD_PING, {}, 1, 1000);
+    REQUIRE(ping);
+    CHECK(millis() - start < 1000);
+    CHECK_EQ(client.responseCount(requestId), 1);
+
+    REQUIRE(client.runUntil([&] { return client.responseCount(requestId) == 2; }, 5000));
+    CHECK(millis() - start >= 3000);
+    const SimResponse* result = client.lastResponse(requestId);
+    CHECK_EQ(result->code, BT_RESP_OK);
+    CHECK(!result->payload.empty());
+
+    std::vector<const SimPacket*> status = jobStatus(client, BT_JOB_AUDIO_CALIBRATION);
+    REQUIRE(status.size() >= 4);
+    CHECK_EQ(getU32LE(&status.front()->data[8]), 3);
+    CHECK_EQ(status.back()->data[3], 100);
+}
+
+TEST(calibrationRefusedWhileStreaming) {
+    hostBootDevice();
+    hostWriteFile(BIG_FILE, 200000);
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    client.send(BT_CMD_GET_FILE_DATA, nameArgs(BIG_FILE));
+    client.step();
+    const SimResponse* reply = client.request(BT_CMD_START_AUDIO_CALIBRATION, { 3 }, 1, 1000);
+    REQUIRE(reply);
+    CHECK_EQ(reply->code, BT_RESP_BUSY);
+}
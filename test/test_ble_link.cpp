@@ -0,0 +1,309 @@
+/**
+ * test_ble_link.cpp
+ * SimTransport behaviour, response framing, link tuning and the benchmark
+ */
+
+#include "HostTest.h"
+#include "BleSimClient.h"
+#include "HostFixture.h"
+#include "BleProtocol.h"
+#include "Utils.h"
+
+extern BluetoothManager bluetoothManager;
+
+static std::vector<std::vector<uint8_t>> received;
+static uint32_t txCompletes;
+
+static void collect(const uint8_t* data, uint16_t len, bool status, uint32_t timeUs) {
+    (void)status;
+    (void)timeUs;
+    received.push_back(std::vector<uint8_t>(data, data + len));
+}
+
+static void countTxComplete() {
+    txCompletes++;
+}
+
+static SimTransport& freshSim(SimTransport& sim, const SimLinkConfig& config) {
+    received.clear();
+    txCompletes = 0;
+    sim.configure(config);
+    sim.setClient(collect);
+    sim.setTxCompleteHandler(countTxComplete);
+    return sim;
+}
+
+TEST(simRefusesWhenBufferFull) {
+    SimTransport sim;
+    freshSim(sim, { 247, 24, 4, 4, 0, 1 });
+    uint8_t packet[20] = { 0 };
+    for (int i = 0; i < 4; i++) CHECK(sim.notifyData(packet, sizeof(packet)));
+    CHECK(!sim.notifyData(packet, sizeof(packet)));
+    CHECK_EQ(sim.getStats().refused, 1);
+    CHECK_EQ(sim.getBuffered(), 4);
+}
+
+TEST(simRefusesPacketsLargerThanMtu) {
+    SimTransport sim;
+    freshSim(sim, { 23, 24, 4, 4, 0, 1 });
+    uint8_t packet[21] = { 0 };
+    CHECK(sim.notifyData(packet, 20));
+    CHECK(!sim.notifyData(packet, 21));
+}
+
+TEST(simSendsPacketsPerEventInOrder) {
+    SimTransport sim;
+    freshSim(sim, { 247, 8, 8, 2, 0, 1 });     // 10 ms interval
+    for (uint8_t i = 0; i < 5; i++) CHECK(sim.notifyData(&i, 1));
+
+    sim.advanceTo(9999);
+    CHECK_EQ(received.size(), 0);
+    sim.advanceTo(10000);
+    CHECK_EQ(received.size(), 2);
+    sim.advanceTo(30000);
+    REQUIRE(received.size() == 5);
+    for (uint8_t i = 0; i < 5; i++) CHECK_EQ(received[i][0], i);
+    CHECK_EQ(txCompletes, 3);
+    CHECK_EQ(sim.getStats().events, 3);
+}
+
+TEST(simLossIsRepeatableForASeed) {
+    uint32_t lost[2];
+    for (int run = 0; run < 2; run++) {
+        SimTransport sim;
+        freshSim(sim, { 247, 6, 8, 8, 100, 42 });
+        uint8_t packet[8] = { 0 };
+        for (int i = 0; i < 1000; i++) {
+            sim.notifyData(packet, sizeof(packet));
+            sim.advanceTo((i + 1) * 7500);
+        }
+        lost[run] = sim.getStats().lost;
+        CHECK_EQ(sim.getStats().delivered + sim.getStats().lost, 1000);
+    }
+    CHECK_EQ(lost[0], lost[1]);
+    CHECK(lost[0] > 50 && lost[0] < 150);
+}
+
+TEST(simConnIntervalRequestTakesEffect) {
+    SimTransport sim;
+    freshSim(sim, { 247, 24, 8, 1, 0, 1 });
+    sim.requestConnInterval(0, 6);
+    TransportLinkInfo info;
+    CHECK(sim.getLinkInfo(0, info));
+    CHECK_EQ(info.connInterval, 6);
+    CHECK_EQ(info.mtu, 247);
+}
+
+TEST(pingAnsweredWithRequestId) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+    uint8_t requestId = client.send(BT_CMD_PING);
+    REQUIRE(client.runUntil([&] { return client.responseCount(requestId) == 1; }, 1000));
+    const SimResponse* r = client.lastResponse(requestId);
+    CHECK_EQ(r->code, BT_RESP_OK);
+    CHECK_EQ(r->frames, 1);
+    CHECK(!r->seqError);
+}
+
+TEST(v1RequestAnsweredWithRequestIdZero) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+    client.sendRaw({ BT_CMD_PING });
+    REQUIRE(client.runUntil([&] { return client.responseCount(0) == 1; }, 1000));
+    CHECK_EQ(client.lastResponse(0)->code, BT_RESP_OK);
+}
+
+TEST(longResponseSpansFramesOnSmallMtu) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+    const SimResponse* reply = client.request(BT_CMD_GET_SETTINGS);
+    REQUIRE(reply);
+    SimResponse small = *reply;
+    CHECK(small.frames > 1);
+    CHECK(!small.seqError);
+
+    client.begin({ 247, 24, 4, 4, 0, 1 });
+    const SimResponse* large = client.request(BT_CMD_GET_SETTINGS);
+    REQUIRE(large);
+    CHECK(large->frames < small.frames);
+    CHECK(large->payload == small.payload);
+}
+
+TEST(disconnectDropsQueuedCommands) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+    client.send(BT_CMD_PING);
+    client.disconnect();
+    CHECK(!bluetoothManager.isConnected());
+    CHECK(!bluetoothManager.hasPendingCommands());
+}
+
+TEST(disconnectOfAnotherHandleIsIgnored) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+    bluetoothDisconnectCallback(7, 0x13);
+    CHECK(bluetoothManager.isConnected());
+    const SimResponse* reply = client.request(BT_CMD_PING);
+    REQUIRE(reply);
+    CHECK_EQ(reply->code, BT_RESP_OK);
+}
+
+TEST(updateHandlesBoundedCommandBurst) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 8, 4, 0, 1 });
+    for (int i = 0; i < BT_COMMANDS_PER_UPDATE + 1; i++) client.send(BT_CMD_PING);
+    CHECK(bluetoothManager.hasPendingCommands());
+
+    bluetoothManager.update();
+    CHECK(bluetoothManager.hasPendingCommands());
+    bluetoothManager.update();
+    CHECK(!bluetoothManager.hasPendingCommands());
+    CHECK(client.runUntil([&] { return client.responses.size() == BT_COMMANDS_PER_UPDATE + 1; }, 1000));
+}
+
+// =============================================================================
+// LINK TUNING AND BENCHMARK
+// =============================================================================
+
+static uint16_t currentInterval(BleSimClient& client) {
+    TransportLinkInfo info;
+    client.sim.getLinkInfo(0, info);
+    return info.connInterval;
+}
+
+static size_t countPackets(const BleSimClient& client, uint8_t type) {
+    size_t n = 0;
+    for (const SimPacket& p : client.packets) {
+        if (!p.data.empty() && p.data[0] == type) n++;
+    }
+    return n;
+}
+
+TEST(linkInfoReportsNegotiatedMtu) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 8, 4, 0, 1 });
+    const SimResponse* reply = client.request(BT_CMD_GET_LINK_INFO);
+    REQUIRE(reply && reply->payload.size() == 10);
+    const uint8_t* p = reply->payload.data();
+    CHECK_EQ(getU16LE(&p[0]), 247);
+    CHECK_EQ(getU16LE(&p[2]), notifyPayloadForMtu(247));
+    CHECK_EQ(getU16LE(&p[6]), 24);
+    CHECK_EQ(p[9], 0);
+}
+
+TEST(benchmarkSendsFullPacketsAndSummary) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 4, 4, 0, 1 });
+    client.send(BT_CMD_LINK_BENCHMARK, { 100, 0 });
+    REQUIRE(client.runUntil([&] { return client.findPacket(BT_RESP_BENCH_END) != nullptr; }));
+
+    CHECK_EQ(countPackets(client, BT_RESP_BENCH_DATA), 100);
+    for (const SimPacket& p : client.packets) {
+        if (p.data[0] == BT_RESP_BENCH_DATA) CHECK_EQ(p.data.size(), notifyPayloadForMtu(247));
+    }
+    const SimPacket* end = client.findPacket(BT_RESP_BENCH_END);
+    REQUIRE(end->data.size() == 23);
+    CHECK_EQ(getU16LE(&end->data[1]), 100);
+    CHECK_EQ(getU32LE(&end->data[3]), 100UL * notifyPayloadForMtu(247));
+    // The send buffer filled up, so the SoftDevice pushed back at least once
+    CHECK(getU16LE(&end->data[11]) > 0);
+    CHECK_EQ(getU16LE(&end->data[13]), 247);
+}
+
+TEST(benchmarkSummaryFitsSmallMtu) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+    client.send(BT_CMD_LINK_BENCHMARK, { 10, 0 });
+    REQUIRE(client.runUntil([&] { return client.findPacket(BT_RESP_BENCH_END) != nullptr; }));
+    CHECK_EQ(countPackets(client, BT_RESP_BENCH_DATA), 10);
+    CHECK_EQ(client.findPacket(BT_RESP_BENCH_END)->data.size(), 13);
+}
+
+TEST(benchmarkAcknowledgedBeforeItsPackets) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 4, 4, 0, 1 });
+    const SimResponse* ack = client.request(BT_CMD_LINK_BENCHMARK, { 10, 0 });
+    REQUIRE(ack);
+    CHECK_EQ(ack->code, BT_RESP_OK);
+    REQUIRE(ack->payload.size() == 4);
+    CHECK_EQ(getU16LE(&ack->payload[0]), 10);
+    CHECK_EQ(getU16LE(&ack->payload[2]), notifyPayloadForMtu(247));
+    CHECK(client.packets.empty() || ack->doneUs <= client.packets[0].timeUs);
+    CHECK(client.runUntil([&] { return client.findPacket(BT_RESP_BENCH_END) != nullptr; }));
+}
+
+TEST(benchmarkRefusedWhileJobRuns) {
+    hostBootDevice();
+    hostWriteFile("/BENCH.CSV", 100000);
+    BleSimClient client;
+    client.begin({ 247, 24, 4, 4, 0, 1 });
+    const char* name = "/BENCH.CSV";
+    uint8_t streamId = client.send(BT_CMD_GET_FILE_DATA, std::vector<uint8_t>(name, name + strlen(name)));
+    for (int i = 0; i < 5; i++) client.step();
+
+    const SimResponse* reply = client.request(BT_CMD_LINK_BENCHMARK, { 10, 0 });
+    REQUIRE(reply);
+    CHECK_EQ(reply->code, BT_RESP_BUSY);
+    CHECK(client.runUntil([&] { return client.responseCount(streamId) == 1; }));
+    CHECK(client.findPacket(BT_RESP_BENCH_DATA) == nullptr);
+
+    // A second benchmark is refused while the first one runs
+    client.send(BT_CMD_LINK_BENCHMARK, { 200, 0 });
+    client.step();
+    const SimResponse* second = client.request(BT_CMD_LINK_BENCHMARK, { 10, 0 });
+    REQUIRE(second);
+    CHECK_EQ(second->code, BT_RESP_BUSY);
+}
+
+TEST(benchmarkOfZeroPacketsRefused) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 4, 4, 0, 1 });
+    const SimResponse* reply = client.request(BT_CMD_LINK_BENCHMARK, { 0, 0 });
+    REQUIRE(reply);
+    CHECK_EQ(reply->code, BT_RESP_ERROR);
+}
+
+TEST(bulkIntervalOnlyWhileStreaming) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 4, 4, 0, 1 });
+    client.send(BT_CMD_LINK_BENCHMARK, { 0xE8, 0x03 });     // 1000 packets
+    REQUIRE(client.runUntil([&] { return countPackets(client, BT_RESP_BENCH_DATA) > 0; }));
+    CHECK_EQ(currentInterval(client), BT_CONN_INTERVAL_BULK);
+
+    REQUIRE(client.runUntil([&] { return client.findPacket(BT_RESP_BENCH_END) != nullptr; }));
+    client.step();
+    CHECK_EQ(currentInterval(client), BT_CONN_INTERVAL_IDLE);
+    const SimResponse* info = client.request(BT_CMD_GET_LINK_INFO);
+    REQUIRE(info && info->payload.size() == 10);
+    CHECK_EQ(info->payload[9], 0);
+}
+
+TEST(bulkIntervalSpeedsUpBenchmark) {
+    uint32_t elapsed[2];
+    for (int run = 0; run < 2; run++) {
+        hostBootDevice();
+        BleSimClient client;
+        client.begin({ 247, 80, 8, 4, 0, 1 });
+        uint32_t start = client.sim.getTime();
+        client.send(BT_CMD_LINK_BENCHMARK, { 200, 0 });
+        REQUIRE(client.runUntil([&] {
+            // Second run: hold the link at the idle interval throughout
+            if (run == 1) client.sim.requestConnInterval(0, 80);
+            return client.findPacket(BT_RESP_BENCH_END) != nullptr;
+        }, 60000));
+        elapsed[run] = client.sim.getTime() - start;
+    }
+    CHECK(elapsed[0] * 5 < elapsed[1]);
+}
@@ -0,0 +1,278 @@
+/**
+ * test_ble_protocol.cpp
+ * Request header parsing, response framing and TLV/CBOR round trips
+ */
+
+#include "HostTest.h"
+#include "BleDecoder.h"
+#include "BleProtocol.h"
+#include "BleSchema.h"
+#include "Bluetooth.h"
+#include <random>
+
+static std::vector<std::vector<uint8_t>> frames;
+static int refuseFrom;                   // Frame index the sender starts refusing, -1 never
+
+static bool captureFrame(const uint8_t* data, uint16_t len) {
+    if (refuseFrom >= 0 && (int)frames.size() >= refuseFrom) return false;
+    frames.push_back(std::vector<uint8_t>(data, data + len));
+    return true;
+}
+
+static void resetCapture(int refuse = -1) {
+    frames.clear();
+    refuseFrom = refuse;
+}
+
+// Checks the frame headers and joins the payloads
+static bool reassemble(uint8_t response, uint8_t requestId, uint16_t maxPacket, std::vector<uint8_t>& payload) {
+    payload.clear();
+    for (size_t i = 0; i < frames.size(); i++) {
+        const std::vector<uint8_t>& f = frames[i];
+        if (f.size() < BT_FRAME_HEADER_SIZE || f.size() > maxPacket) return false;
+        if (f[0] != response || f[1] != requestId) return false;
+        if ((f[2] & BT_FRAME_SEQ_MASK) != (i & BT_FRAME_SEQ_MASK)) return false;
+        if (((f[2] & BT_FRAME_LAST) != 0) != (i + 1 == frames.size())) return false;
+        payload.insert(payload.end(), f.begin() + BT_FRAME_HEADER_SIZE, f.end());
+    }
+    return !frames.empty();
+}
+
+static BleValue scalarValue(uint8_t tag, uint32_t scalar) {
+    return { tag, false, false, scalar, "", {} };
+}
+
+// =============================================================================
+// RANDOM RESPONSES
+// =============================================================================
+
+// Writes random fields and returns what a decoder should read back.
+// The fuzz message "FZ" gives every tag below FUZZ_LIST_TAG a fixed type
+// (tag % 7, in BleFieldType order) and every tag from it a list of "FZ"
+// records, so TLV decodes against a schema as real messages do.
+#define FUZZ_LIST_TAG 0xE0
+#define FUZZ_LIST_TAGS 16
+#define FUZZ_SCALAR_TYPES 7
+
+static const BleSchemaTables& fuzzSchema() {
+    static std::vector<BleFieldDesc> fields;
+    static std::vector<BleListDesc> lists;
+    static BleSchemaTables tables;
+    if (fields.empty()) {
+        for (int tag = 0; tag < FUZZ_LIST_TAG + FUZZ_LIST_TAGS; tag++) {
+            uint8_t type = tag < FUZZ_LIST_TAG ? tag % FUZZ_SCALAR_TYPES : BT_FT_LIST;
+            fields.push_back({ "FZ", (uint8_t)tag, "field", type });
+            if (type == BT_FT_LIST) lists.push_back({ "FZ", (uint8_t)tag, "FZ" });
+        }
+        tables = { fields.data(), fields.size(), lists.data(), lists.size() };
+    }
+    return tables;
+}
+
+static BleFields writeFields(BleResponseWriter& w, std::mt19937& rng, int depth) {
+    BleFields expected;
+    int count = rng() % 8;
+    for (int i = 0; i < count; i++) {
+        int type = rng() % (depth < 2 ? FUZZ_SCALAR_TYPES + 1 : FUZZ_SCALAR_TYPES);
+        // Tags either side of the CBOR one-byte head limit (23/24) as
+        // often as any other
+        uint8_t tag = rng() % 4 == 0 ? 21 + type
+                                     : (rng() % (FUZZ_LIST_TAG / FUZZ_SCALAR_TYPES)) * FUZZ_SCALAR_TYPES + type;
+        uint32_t bits = rng();
+        // Edge values as often as random ones
+        static const uint32_t edges[] = { 0, 23, 24, 31, 255, 256, 0xFFFF, 0x10000, 0xFFFFFFFF, 0x80000000 };
+        if (rng() % 2) bits = edges[rng() % (sizeof(edges) / sizeof(edges[0]))];
+
+        switch (type) {
+            case 0:
+                w.putU8(tag, (uint8_t)bits);
+                expected.push_back(scalarValue(tag, (uint8_t)bits));
+                break;
+            case 1:
+                w.putU16(tag, (uint16_t)bits);
+                expected.push_back(scalarValue(tag, (uint16_t)bits));
+                break;
+            case 2:
+                w.putU32(tag, bits);
+                expected.push_back(scalarValue(tag, bits));
+                break;
+            case 3:
+                w.putI32(tag, (int32_t)bits);
+                expected.push_back(scalarValue(tag, bits));
+                break;
+            case 4: {
+                float f;
+                memcpy(&f, &bits, sizeof(f));
+                w.putF32(tag, f);
+                expected.push_back(scalarValue(tag, bits));
+                break;
+            }
+            case 5:
+                w.putBool(tag, bits & 1);
+                expected.push_back(scalarValue(tag, bits & 1));
+                break;
+            case 6: {
+                std::string s(rng() % 2 ? rng() % 40 : rng() % 300, 'a');
+                for (char& c : s) c = 'a' + rng() % 26;
+                w.putStr(tag, s.c_str());
+                if (s.size() > 255) s.resize(255);
+                expected.push_back({ tag, false, true, 0, s, {} });
+                break;
+            }
+            default: {
+                uint8_t listTag = FUZZ_LIST_TAG + rng() % FUZZ_LIST_TAGS;
+                BleValue v = { listTag, true, false, 0, "", {} };
+                w.beginList(listTag);
+                int records = rng() % 4;
+                for (int r = 0; r < records; r++) {
+                    w.beginRecord();
+                    v.records.push_back(writeFields(w, rng, depth + 1));
+                    w.endRecord();
+                }
+                w.endList();
+                expected.push_back(v);
+                break;
+            }
+        }
+    }
+    return expected;
+}
+
+// =============================================================================
+// TESTS
+// =============================================================================
+
+TEST(v2HeaderSetsRequestIdAndEncoding) {
+    uint8_t frame[] = { BT_FRAME_V2_MARKER, 7, BT_REQ_FLAG_CBOR, BT_CMD_PING, 0x42 };
+    uint8_t* data = frame;
+    uint16_t len = sizeof(frame);
+    uint8_t requestId;
+    BleEncoding enc;
+    CHECK(parseRequestHeader(data, len, requestId, enc));
+    CHECK_EQ(requestId, 7);
+    CHECK_EQ(enc, BT_ENC_CBOR);
+    CHECK_EQ(len, 2);
+    CHECK_EQ(data[0], BT_CMD_PING);
+}
+
+TEST(v1AndShortFramesParse) {
+    uint8_t v1[] = { BT_CMD_PING };
+    uint8_t* data = v1;
+    uint16_t len = 1;
+    uint8_t requestId = 9;
+    BleEncoding enc = BT_ENC_CBOR;
+    CHECK(parseRequestHeader(data, len, requestId, enc));
+    CHECK_EQ(requestId, 0);
+    CHECK_EQ(enc, BT_ENC_TLV);
+    CHECK(data == v1);
+
+    uint8_t truncated[] = { BT_FRAME_V2_MARKER, 7, 0 };
+    data = truncated;
+    len = sizeof(truncated);
+    CHECK(!parseRequestHeader(data, len, requestId, enc));
+    len = 0;
+    CHECK(!parseRequestHeader(data, len, requestId, enc));
+}
+
+TEST(cborSmallIntegersUseShortestHead) {
+    resetCapture();
+    BleResponseWriter w(captureFrame, 247, BT_RESP_OK, 1, BT_ENC_CBOR);
+    w.putU8(1, 23);
+    w.putU8(2, 24);
+    w.putU32(3, 31);
+    w.putI32(4, -1);
+    w.putU16(24, 0x100);
+    CHECK(w.finish());
+
+    std::vector<uint8_t> payload;
+    REQUIRE(reassemble(BT_RESP_OK, 1, 247, payload));
+    const std::vector<uint8_t> expected = { 0xBF, 0x01, 0x17, 0x02, 0x18, 0x18, 0x03, 0x18, 0x1F,
+                                            0x04, 0x20, 0x18, 0x18, 0x19, 0x01, 0x00, 0xFF };
+    CHECK(payload == expected);
+}
+
+TEST(randomResponsesRoundTrip) {
+    std::mt19937 rng(53);
+    const uint16_t packetSizes[] = { 20, 64, 244 };
+
+    for (int run = 0; run < 300; run++) {
+        BleEncoding enc = run % 2 ? BT_ENC_CBOR : BT_ENC_TLV;
+        uint16_t maxPacket = packetSizes[run % 3];
+        uint8_t requestId = (uint8_t)run;
+
+        resetCapture();
+        BleResponseWriter w(captureFrame, maxPacket, BT_RESP_OK, requestId, enc);
+        BleFields expected = writeFields(w, rng, 0);
+        REQUIRE(w.finish());
+        CHECK_EQ(w.getFrameCount(), frames.size());
+
+        std::vector<uint8_t> payload;
+        REQUIRE(reassemble(BT_RESP_OK, requestId, maxPacket, payload));
+        BleFields decoded;
+        bool ok = enc == BT_ENC_CBOR ? decodeCbor(payload, decoded) : decodeTlv(payload, "FZ", decoded, fuzzSchema());
+        CHECK(ok);
+        CHECK(decoded == expected);
+        if (!ok || decoded != expected) {
+            printf("  run %d, %s, packet %u\n", run, enc == BT_ENC_CBOR ? "CBOR" : "TLV", maxPacket);
+            return;
+        }
+    }
+}
+
+TEST(refusedFrameEndsWithErrorFrame) {
+    resetCapture(2);
+    BleResponseWriter w(captureFrame, 20, BT_RESP_OK, 5, BT_ENC_TLV);
+    for (uint8_t i = 0; i < 20; i++) w.putU32(i, i);
+    // The sender takes frames again once the writer has given up
+    refuseFrom = -1;
+    w.putU32(21, 21);
+    CHECK(!w.finish());
+
+    REQUIRE(frames.size() == 3);
+    CHECK_EQ(frames[2].size(), BT_FRAME_HEADER_SIZE);
+    CHECK_EQ(frames[2][0], BT_RESP_ERROR);
+    CHECK_EQ(frames[2][1], 5);
+    CHECK(frames[2][2] & BT_FRAME_LAST);
+}
+
+static BleNotifyQueue* frameQueue;
+
+static bool queueFrame(const uint8_t* data, uint16_t len) {
+    return frameQueue->sendOrDrop(data, len);
+}
+
+TEST(errorFrameWaitsBehindAFullQueue) {
+    // The link takes nothing until the writer is done
+    resetCapture(0);
+    BleNotifyQueue queue;
+    queue.setSink(captureFrame);
+    frameQueue = &queue;
+
+    BleResponseWriter w(queueFrame, 20, BT_RESP_OK, 6, BT_ENC_TLV);
+    for (uint8_t i = 0; i < 100; i++) w.putU32(i, i);
+    CHECK(!w.finish());
+    CHECK_EQ(queue.getPending(), BT_NOTIFY_QUEUE_DEPTH + 1);
+    CHECK_EQ(queue.getStats().dropped, 1);
+
+    // A command answered meanwhile lines up behind it
+    uint8_t busy[BT_FRAME_HEADER_SIZE] = { BT_RESP_BUSY, 7, BT_FRAME_LAST };
+    CHECK(queue.sendOrDrop(busy, sizeof(busy)));
+
+    refuseFrom = -1;
+    queue.onTxComplete();
+    queue.pump();
+    CHECK_EQ(queue.getPending(), 0);
+
+    // The frames that fitted, then the error frame that ends them
+    REQUIRE(frames.size() == BT_NOTIFY_QUEUE_DEPTH + 2);
+    for (uint8_t i = 0; i < BT_NOTIFY_QUEUE_DEPTH; i++) {
+        CHECK_EQ(frames[i][0], BT_RESP_OK);
+        CHECK_EQ(frames[i][2], i);
+    }
+    const std::vector<uint8_t>& end = frames[BT_NOTIFY_QUEUE_DEPTH];
+    CHECK_EQ(end.size(), BT_FRAME_HEADER_SIZE);
+    CHECK_EQ(end[0], BT_RESP_ERROR);
+    CHECK_EQ(end[1], 6);
+    CHECK(end[2] & BT_FRAME_LAST);
+    CHECK_EQ(frames.back()[0], BT_RESP_BUSY);
+}
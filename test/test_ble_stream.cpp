@@ -0,0 +1,366 @@
+/**
+ * test_ble_stream.cpp
+ * Live stream encoding, keyframes, rate control and bytes per second
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "BleStream.h"
+#include "Bluetooth.h"
+#include "Utils.h"
+
+extern SensorData currentData;
+
+#define MASK_ENV ((1ULL << BT_SF_temperature) | (1ULL << BT_SF_humidity) | \
+                  (1ULL << BT_SF_pressure) | (1ULL << BT_SF_batteryVoltage))
+#define MASK_ALL ((1ULL << BT_SF_COUNT) - 1)
+
+static std::vector<std::vector<uint8_t>> sent;
+static bool refuseSends;
+
+static bool capturePacket(const uint8_t* data, uint16_t len) {
+    if (refuseSends) return false;
+    sent.push_back(std::vector<uint8_t>(data, data + len));
+    return true;
+}
+
+static void freshStream(BleStream& s) {
+    sent.clear();
+    refuseSends = false;
+    currentData = SensorData();
+    s.setSender(capturePacket);
+    hostSetMicros(1000000);                 // lastSendTime 0 means never sent
+}
+
+// Advances in 10 ms steps, pumping as BluetoothManager::update() would
+static void runFor(BleStream& s, unsigned long ms, uint16_t maxPacket = 244, uint16_t connInterval = 6) {
+    for (unsigned long t = 0; t < ms; t += 10) {
+        s.pump(maxPacket, connInterval);
+        hostAdvanceMillis(10);
+    }
+}
+
+// =============================================================================
+// CLIENT-SIDE DECODER
+// =============================================================================
+
+static uint32_t readVarint(const std::vector<uint8_t>& p, size_t& pos) {
+    uint32_t v = 0;
+    for (uint8_t shift = 0; pos < p.size(); shift += 7) {
+        uint8_t b = p[pos++];
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if (!(b & 0x80)) break;
+    }
+    return v;
+}
+
+static int32_t unzigzag(uint32_t v) {
+    return (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+}
+
+struct StreamDecoder {
+    uint64_t mask;
+    uint8_t bins;
+    int32_t values[BT_SF_COUNT];
+    uint8_t spectrum[BT_STREAM_MAX_BINS];
+    uint32_t dtMs;
+    bool synced;
+
+    StreamDecoder(uint64_t m, uint8_t b) : mask(m), bins(b), dtMs(0), synced(false) {
+        memset(values, 0, sizeof(values));
+        memset(spectrum, 0, sizeof(spectrum));
+    }
+
+    // False when the packet is malformed or a delta arrives before a keyframe
+    bool apply(const std::vector<uint8_t>& p) {
+        if (p.size() < BT_STREAM_HEADER_SIZE || p[0] != BT_RESP_STREAM) return false;
+        bool keyframe = p[2] & 0x01;
+        if (!keyframe && !synced) return false;
+        size_t pos = BT_STREAM_HEADER_SIZE;
+        dtMs = readVarint(p, pos);
+        for (uint8_t f = 0; f < BT_SF_COUNT; f++) {
+            if (!(mask & (1ULL << f))) continue;
+            int32_t v = unzigzag(readVarint(p, pos));
+            values[f] = keyframe ? v : values[f] + v;
+        }
+        if (p[2] & 0x02) {
+            for (uint8_t b = 0; b < bins; b++) {
+                spectrum[b] = keyframe ? p[pos++] : spectrum[b] + unzigzag(readVarint(p, pos));
+            }
+        }
+        synced = true;
+        return pos == p.size();
+    }
+};
+
+// =============================================================================
+// ENCODING
+// =============================================================================
+
+TEST(firstPacketIsKeyframeWithScaledValues) {
+    BleStream s;
+    freshStream(s);
+    currentData.temperature = 34.56f;
+    currentData.humidity = 61.2f;
+    currentData.pressure = 1009.3f;
+    currentData.batteryVoltage = 3.912f;
+    REQUIRE(s.subscribe(MASK_ENV, 1000, 0));
+    s.pump(244, 6);
+    REQUIRE(sent.size() == 1);
+    CHECK_EQ(sent[0][0], BT_RESP_STREAM);
+    CHECK_EQ(sent[0][1], 0);
+    CHECK_EQ(sent[0][2], 0x01);
+
+    StreamDecoder d(MASK_ENV, 0);
+    REQUIRE(d.apply(sent[0]));
+    CHECK_EQ(d.values[BT_SF_temperature], 3456);
+    CHECK_EQ(d.values[BT_SF_humidity], 6120);
+    CHECK_EQ(d.values[BT_SF_pressure], 10093);
+    CHECK_EQ(d.values[BT_SF_batteryVoltage], 3912);
+}
+
+TEST(deltasReconstructEveryValue) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ENV, 100, 0));
+    StreamDecoder d(MASK_ENV, 0);
+    for (int i = 0; i < 100; i++) {
+        currentData.temperature = 20 + (i * 37 % 200) * 0.1f;
+        currentData.humidity = 90 - (i % 40);
+        currentData.pressure = 1000 + (i % 7) * 3.3f;
+        currentData.batteryVoltage = 4.2f - i * 0.003f;
+        size_t before = sent.size();
+        runFor(s, 100);
+        REQUIRE(sent.size() == before + 1);
+        REQUIRE(d.apply(sent.back()));
+        CHECK_EQ(d.values[BT_SF_temperature], lroundf(currentData.temperature * 100));
+        CHECK_EQ(d.values[BT_SF_humidity], lroundf(currentData.humidity * 100));
+        CHECK_EQ(d.values[BT_SF_pressure], lroundf(currentData.pressure * 10));
+        CHECK_EQ(d.values[BT_SF_batteryVoltage], lroundf(currentData.batteryVoltage * 1000));
+    }
+}
+
+TEST(keyframeEverySixteenPackets) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ENV, 100, 0));
+    runFor(s, 100 * 40);
+    REQUIRE(sent.size() >= 40);
+    for (size_t i = 0; i < 40; i++) {
+        CHECK_EQ(sent[i][1], (uint8_t)i);
+        CHECK_EQ(sent[i][2] & 0x01, i % BT_STREAM_KEYFRAME_EVERY == 0 ? 1 : 0);
+    }
+}
+
+TEST(unchangedValuesCostOneBytePerField) {
+    BleStream s;
+    freshStream(s);
+    currentData.temperature = 25;
+    currentData.pressure = 1013;
+    REQUIRE(s.subscribe(MASK_ENV, 100, 0));
+    runFor(s, 300);
+    REQUIRE(sent.size() >= 2);
+    CHECK(sent[0].size() > sent[1].size());
+    CHECK_EQ(sent[1].size(), BT_STREAM_HEADER_SIZE + 1 + 4);
+}
+
+TEST(decoderResyncsAtKeyframeAfterLoss) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ENV, 100, 0));
+    for (int i = 0; i < 40; i++) {
+        currentData.temperature = 10 + i;
+        runFor(s, 100);
+    }
+    StreamDecoder d(MASK_ENV, 0);
+    REQUIRE(d.apply(sent[0]));
+    // Lose 1..5; deltas after the gap are skipped until seq 16
+    for (size_t i = 6; i < sent.size(); i++) {
+        if (sent[i][2] & 0x01) d.synced = false;
+        if (i < BT_STREAM_KEYFRAME_EVERY) continue;
+        REQUIRE(d.apply(sent[i]));
+        CHECK_EQ(d.values[BT_SF_temperature], (10 + (int)i) * 100);
+    }
+}
+
+TEST(spectrumBinsRoundDownToPowerOfTwo) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(0, 100, 12));
+    s.pump(244, 6);
+    REQUIRE(sent.size() == 1);
+    CHECK_EQ(sent[0][2], 0x03);
+    CHECK_EQ(sent[0].size(), BT_STREAM_HEADER_SIZE + 1 + 8);
+    CHECK(!s.subscribe(0, 100, 0));
+}
+
+TEST(spectrumHalvedWhenPacketTooSmall) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ENV, 100, 32));
+    s.pump(20, 24);                         // Default MTU: 32 bins do not fit
+    CHECK_EQ(sent.size(), 0);
+    runFor(s, 100, 20, 24);
+    REQUIRE(sent.size() >= 1);
+    CHECK(sent[0].size() <= 20);
+    CHECK(s.isActive());
+}
+
+TEST(unsubscribesWhenFieldsNeverFit) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ALL, 100, 0));
+    s.pump(20, 24);
+    CHECK(!s.isActive());
+    CHECK_EQ(sent.size(), 0);
+}
+
+// =============================================================================
+// RATE CONTROL
+// =============================================================================
+
+TEST(sendsAtRequestedInterval) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ENV, 250, 0));
+    runFor(s, 10000);
+    CHECK(sent.size() >= 39 && sent.size() <= 41);
+    CHECK_EQ(s.getStats().rateLimited, 0);
+}
+
+TEST(intervalClampedToLimits) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ENV, 10, 0));
+    CHECK_EQ(s.getEffectiveInterval(244, 6), BT_STREAM_MIN_INTERVAL_MS);
+    REQUIRE(s.subscribe(MASK_ENV, 65000, 0));
+    CHECK_EQ(s.getEffectiveInterval(244, 6), BT_STREAM_MAX_INTERVAL_MS);
+}
+
+TEST(slowLinkStretchesInterval) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ALL, 100, 32));
+    runFor(s, 200);                          // Learns the packet size
+    uint16_t fast = s.getEffectiveInterval(244, 6);
+    uint16_t slow = s.getEffectiveInterval(244, 400);     // 500 ms events
+    CHECK_EQ(fast, 100);
+    CHECK(slow > 100);
+
+    // Half of the budget at most: packet bytes per interval vs link bytes
+    uint32_t packetLen = sent.back().size();
+    CHECK(packetLen * 1000UL / slow <= 244UL * 1000 / 500 / BT_STREAM_LINK_SHARE + 1);
+
+    sent.clear();
+    runFor(s, 10000, 244, 400);
+    CHECK(sent.size() <= 10000UL / slow + 1);
+    CHECK(s.getStats().rateLimited > 0);
+}
+
+TEST(backsOffOnRefusalAndRecovers) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ENV, 100, 0));
+    s.pump(244, 6);
+    refuseSends = true;
+    runFor(s, 2000);
+    CHECK(s.getStats().notifyFailures > 0);
+    CHECK(s.getEffectiveInterval(244, 6) >= 400);
+
+    refuseSends = false;
+    runFor(s, 60000);
+    CHECK_EQ(s.getEffectiveInterval(244, 6), 100);
+}
+
+TEST(refusedPacketDoesNotBreakDeltas) {
+    BleStream s;
+    freshStream(s);
+    REQUIRE(s.subscribe(MASK_ENV, 100, 0));
+    StreamDecoder d(MASK_ENV, 0);
+    for (int i = 0; i < 30; i++) {
+        currentData.humidity = 40 + i;
+        refuseSends = (i % 3 == 1);
+        size_t before = sent.size();
+        runFor(s, 400);
+        for (size_t k = before; k < sent.size(); k++) REQUIRE(d.apply(sent[k]));
+        if (sent.size() > before) CHECK_EQ(d.values[BT_SF_humidity], (40 + i) * 100);
+    }
+}
+
+// =============================================================================
+// OVER THE LINK
+// =============================================================================
+
+static std::vector<uint8_t> subscribeArgs(uint64_t mask, uint16_t intervalMs, uint8_t bins) {
+    std::vector<uint8_t> args(11);
+    putU32LE(&args[0], (uint32_t)mask);
+    putU32LE(&args[4], (uint32_t)(mask >> 32));
+    putU16LE(&args[8], intervalMs);
+    args[10] = bins;
+    return args;
+}
+
+static size_t streamPackets(const BleSimClient& client) {
+    size_t n = 0;
+    for (const SimPacket& p : client.packets) n += p.data[0] == BT_RESP_STREAM;
+    return n;
+}
+
+TEST(subscribeOverLinkRepliesWithInterval) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 8, 4, 0, 1 });
+    const SimResponse* reply = client.request(BT_CMD_STREAM_SUBSCRIBE, subscribeArgs(MASK_ENV, 200, 8));
+    REQUIRE(reply && reply->code == BT_RESP_OK && reply->payload.size() == 2);
+    CHECK_EQ(getU16LE(reply->payload.data()), 200);
+
+    unsigned long start = millis();
+    client.runUntil([&] { return millis() - start >= 5000; });
+    CHECK(streamPackets(client) >= 24 && streamPackets(client) <= 26);
+
+    REQUIRE(client.request(BT_CMD_STREAM_UNSUBSCRIBE));
+    size_t stopped = streamPackets(client);
+    start = millis();
+    client.runUntil([&] { return millis() - start >= 2000; });
+    CHECK_EQ(streamPackets(client), stopped);
+}
+
+TEST(subscribeWithNoFieldsRefused) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 8, 4, 0, 1 });
+    const SimResponse* reply = client.request(BT_CMD_STREAM_SUBSCRIBE, subscribeArgs(0, 200, 0));
+    REQUIRE(reply);
+    CHECK_EQ(reply->code, BT_RESP_ERROR);
+}
+
+TEST(bytesPerSecondVersusFields) {
+    // Benchmark: 10 s at 10 Hz with values changing every packet
+    const uint8_t fieldCounts[] = { 1, 4, 8, 16, 38 };
+    uint32_t previous = 0;
+    for (uint8_t n : fieldCounts) {
+        for (uint8_t bins : { (uint8_t)0, (uint8_t)16 }) {
+            BleStream s;
+            freshStream(s);
+            uint64_t mask = n >= 64 ? ~0ULL : (1ULL << n) - 1;
+            REQUIRE(s.subscribe(mask, 100, bins));
+            for (int i = 0; i < 100; i++) {
+                currentData.temperature = 20 + (i % 13) * 0.37f;
+                currentData.humidity = 50 + (i % 7) * 1.1f;
+                runFor(s, 100);
+            }
+            uint32_t bytes = 0;
+            for (const std::vector<uint8_t>& p : sent) bytes += p.size();
+            uint32_t perSecond = bytes / 10;
+            printf("  %2u fields, %2u bins: %4u B/s, %u B keyframe\n", n, bins, perSecond,
+                   (unsigned)sent[0].size());
+            if (bins == 0) {
+                CHECK(perSecond >= previous);
+                previous = perSecond;
+            }
+            // Deltas keep the average well under a keyframe per packet
+            CHECK(perSecond < sent[0].size() * 10);
+        }
+    }
+}
@@ -0,0 +1,265 @@
+/**
+ * test_ble_transfer.cpp
+ * Windowed transfer: window, go-back-N, timeouts, resume and CRC
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "BleTransfer.h"
+#include "Bluetooth.h"
+#include "Utils.h"
+
+#define TEST_FILE "/XFER_TEST.CSV"
+
+static std::vector<std::vector<uint8_t>> sent;
+static bool refuseSends;
+
+static bool captureChunk(const uint8_t* data, uint16_t len) {
+    if (refuseSends) return false;
+    sent.push_back(std::vector<uint8_t>(data, data + len));
+    return true;
+}
+
+static uint16_t chunkSeq(const std::vector<uint8_t>& packet) {
+    return getU16LE(&packet[2]);
+}
+
+// A session on a 64-byte link: 60-byte chunks
+static bool startSession(BleTransfer& t, uint32_t fileSize, uint32_t offset, uint8_t window, uint8_t* info) {
+    sent.clear();
+    refuseSends = false;
+    hostBootDevice();
+    hostWriteFile(TEST_FILE, fileSize);
+    t.setSender(captureChunk);
+    uint16_t infoLen;
+    return t.begin(TEST_FILE, offset, window, 64, info, infoLen) == XFER_START_OK && infoLen == 13;
+}
+
+// =============================================================================
+// SESSION
+// =============================================================================
+
+TEST(sendsNoMoreThanTheWindow) {
+    BleTransfer t;
+    uint8_t info[16];
+    REQUIRE(startSession(t, 6000, 0, 4, info));
+    CHECK_EQ(getU16LE(&info[9]), 60);
+    CHECK_EQ(getU16LE(&info[11]), 100);
+
+    t.pump();
+    t.pump();
+    REQUIRE(sent.size() == 4);
+    for (uint16_t i = 0; i < 4; i++) CHECK_EQ(chunkSeq(sent[i]), i);
+
+    CHECK(t.acknowledge(info[0], 2));
+    t.pump();
+    REQUIRE(sent.size() == 6);
+    CHECK_EQ(chunkSeq(sent[5]), 5);
+}
+
+TEST(progressAckDoesNotResendChunksInFlight) {
+    BleTransfer t;
+    uint8_t info[16];
+    REQUIRE(startSession(t, 6000, 0, 8, info));
+    t.pump();
+    REQUIRE(sent.size() == 8);
+
+    CHECK(t.acknowledge(info[0], 3));
+    t.pump();
+    REQUIRE(sent.size() == 11);
+    CHECK_EQ(chunkSeq(sent[8]), 8);
+    CHECK_EQ(t.getStats().chunksRetransmitted, 0);
+}
+
+TEST(repeatedAckRewindsToMissingChunkOnce) {
+    BleTransfer t;
+    uint8_t info[16];
+    REQUIRE(startSession(t, 6000, 0, 8, info));
+    t.pump();
+    REQUIRE(sent.size() == 8);
+
+    CHECK(t.acknowledge(info[0], 3));
+    CHECK(t.acknowledge(info[0], 3));
+    CHECK(t.acknowledge(info[0], 3));
+    t.pump();
+    REQUIRE(sent.size() == 16);
+    CHECK_EQ(chunkSeq(sent[8]), 3);
+    CHECK_EQ(t.getStats().chunksRetransmitted, 5);
+    CHECK(!t.acknowledge(info[0], 40));      // Never sent
+    CHECK(!t.acknowledge(info[0] + 1, 3));   // Another session
+}
+
+TEST(silentClientTimesOutThenAborts) {
+    BleTransfer t;
+    uint8_t info[16];
+    REQUIRE(startSession(t, 6000, 0, 4, info));
+    t.pump();
+    REQUIRE(sent.size() == 4);
+
+    delay(BT_XFER_ACK_TIMEOUT_MS + 1);
+    t.pump();
+    REQUIRE(sent.size() == 8);
+    CHECK_EQ(chunkSeq(sent[4]), 0);
+    CHECK_EQ(t.getStats().timeouts, 1);
+
+    for (int i = 0; i < BT_XFER_MAX_RETRIES; i++) {
+        delay(BT_XFER_ACK_TIMEOUT_MS + 1);
+        t.pump();
+    }
+    CHECK_EQ(t.getState(), XFER_IDLE);
+}
+
+TEST(refusedChunkIsSentAgain) {
+    BleTransfer t;
+    uint8_t info[16];
+    REQUIRE(startSession(t, 6000, 0, 4, info));
+    refuseSends = true;
+    t.pump();
+    CHECK_EQ(sent.size(), 0);
+    CHECK_EQ(t.getStats().notifyFailures, 1);
+    refuseSends = false;
+    t.pump();
+    REQUIRE(sent.size() == 4);
+    CHECK_EQ(chunkSeq(sent[0]), 0);
+}
+
+TEST(readErrorEndsTheTransfer) {
+    // Not a refusal to retry: the error packet goes out once there is
+    // room, naming the chunk that could not be read
+    BleTransfer t;
+    uint8_t info[16];
+    REQUIRE(startSession(t, 6000, 0, 4, info));
+    t.pump();
+    REQUIRE(sent.size() == 4);
+
+    SD.end();
+    CHECK(t.acknowledge(info[0], 2));
+    refuseSends = true;
+    t.pump();
+    CHECK_EQ(t.getState(), XFER_FAILING);
+    CHECK(t.isActive());
+    CHECK(!t.acknowledge(info[0], 4));
+    refuseSends = false;
+    t.pump();
+    REQUIRE(sent.size() == 5);
+    REQUIRE(sent[4].size() == 4);
+    CHECK_EQ(sent[4][0], BT_RESP_TRANSFER_ERROR);
+    CHECK_EQ(sent[4][1], info[0]);
+    CHECK_EQ(chunkSeq(sent[4]), 4);
+    CHECK_EQ(t.getState(), XFER_IDLE);
+    CHECK_EQ(t.getStats().notifyFailures, 0);
+}
+
+TEST(endCarriesWholeFileCrcAfterResume) {
+    BleTransfer t;
+    uint8_t info[16];
+    hostBootDevice();
+    std::vector<uint8_t> file = hostWriteFile(TEST_FILE, 1000);
+    REQUIRE(startSession(t, 1000, 700, 8, info));
+    CHECK_EQ(getU32LE(&info[5]), 700);
+    CHECK_EQ(getU16LE(&info[11]), 5);
+
+    t.pump();
+    REQUIRE(sent.size() == 5);
+    CHECK(t.acknowledge(info[0], 5));
+    t.pump();
+    REQUIRE(sent.size() == 6);
+    const std::vector<uint8_t>& end = sent.back();
+    REQUIRE(end.size() == 12);
+    CHECK_EQ(end[0], BT_RESP_TRANSFER_END);
+    CHECK_EQ(getU32LE(&end[4]), 1000);
+    CHECK_EQ(getU32LE(&end[8]), crc32Update(0, file.data(), file.size()));
+    CHECK_EQ(t.getState(), XFER_DONE);
+}
+
+TEST(badStartsAreRefused) {
+    BleTransfer t;
+    uint8_t info[16];
+    uint16_t infoLen;
+    hostBootDevice();
+    hostWriteFile(TEST_FILE, 1000);
+    CHECK_EQ(t.begin("/NOPE.CSV", 0, 8, 64, info, infoLen), XFER_START_NOT_FOUND);
+    CHECK_EQ(t.begin(TEST_FILE, 1001, 8, 64, info, infoLen), XFER_START_BAD_OFFSET);
+    CHECK_EQ(t.begin(TEST_FILE, 0, 8, BT_XFER_HEADER_SIZE + BT_XFER_MIN_PAYLOAD - 1, info, infoLen),
+             XFER_START_BAD_LINK);
+    CHECK_EQ(t.getState(), XFER_IDLE);
+}
+
+// =============================================================================
+// OVER THE SIMULATED LINK
+// =============================================================================
+
+TEST(lossyLinkDownloadMatchesFile) {
+    hostBootDevice();
+    std::vector<uint8_t> file = hostWriteFile(TEST_FILE, 20000, 3);
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 50, 7 });       // 5% loss
+
+    SimDownload d;
+    REQUIRE(client.download(TEST_FILE, 0, BT_XFER_DEFAULT_WINDOW, d, 0, 30000));
+    CHECK(client.sim.getStats().lost > 0);
+    CHECK(d.data == file);
+    CHECK_EQ(d.crc, crc32Update(0, file.data(), file.size()));
+}
+
+TEST(smallMtuDownloadMatchesFile) {
+    hostBootDevice();
+    std::vector<uint8_t> file = hostWriteFile(TEST_FILE, 3000, 4);
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+
+    SimDownload d;
+    REQUIRE(client.download(TEST_FILE, 0, 4, d));
+    CHECK(d.data == file);
+    CHECK_EQ(d.crc, crc32Update(0, file.data(), file.size()));
+}
+
+TEST(downloadResumesAfterReconnect) {
+    hostBootDevice();
+    std::vector<uint8_t> file = hostWriteFile(TEST_FILE, 20000, 5);
+    BleSimClient client;
+    client.begin({ 247, 12, 8, 4, 0, 1 });
+
+    SimDownload first;
+    CHECK(!client.download(TEST_FILE, 0, BT_XFER_DEFAULT_WINDOW, first, 20));
+    REQUIRE(first.data.size() > 0 && first.data.size() < file.size());
+    client.disconnect();
+
+    client.begin({ 247, 12, 8, 4, 0, 1 });
+    SimDownload rest;
+    uint32_t offset = first.data.size();
+    REQUIRE(client.download(TEST_FILE, offset, BT_XFER_DEFAULT_WINDOW, rest));
+    REQUIRE(rest.data.size() == file.size());
+    memcpy(rest.data.data(), first.data.data(), offset);
+    CHECK(rest.data == file);
+    CHECK_EQ(rest.crc, crc32Update(0, file.data(), file.size()));
+}
+
+TEST(readErrorEndsTheJobAndTheBulkInterval) {
+    hostBootDevice();
+    std::vector<uint8_t> file = hostWriteFile(TEST_FILE, 20000, 6);
+    BleSimClient client;
+    client.begin({ 247, 12, 8, 4, 0, 1 });
+
+    SimDownload first;
+    CHECK(!client.download(TEST_FILE, 0, BT_XFER_DEFAULT_WINDOW, first, 20));
+    TransportLinkInfo info;
+    client.sim.getLinkInfo(0, info);
+    CHECK_EQ(info.connInterval, BT_CONN_INTERVAL_BULK);
+
+    // The card goes away part way; the client is told instead of timing out
+    SD.end();
+    REQUIRE(client.runUntil([&] { return client.findPacket(BT_RESP_TRANSFER_ERROR) != nullptr; }));
+    client.step();
+    client.sim.getLinkInfo(0, info);
+    CHECK_EQ(info.connInterval, BT_CONN_INTERVAL_IDLE);
+
+    // Nothing is left running, so the resume is not refused as busy
+    SD.begin(SD_CS_PIN);
+    SimDownload rest;
+    uint32_t offset = first.data.size();
+    REQUIRE(client.download(TEST_FILE, offset, BT_XFER_DEFAULT_WINDOW, rest));
+    memcpy(rest.data.data(), first.data.data(), offset);
+    CHECK(rest.data == file);
+}
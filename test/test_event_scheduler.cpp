@@ -0,0 +1,243 @@
+/**
+ * test_event_scheduler.cpp
+ * Timers, events and wakeups per hour on a virtual clock
+ */
+
+#include "HostTest.h"
+#include "EventScheduler.h"
+
+#define HOUR_MS 3600000UL
+
+// The sleep the scheduler asked for, and an event to post part way
+static EventScheduler* sched;
+static unsigned long lastSleepMs;
+static unsigned long postAt;             // 0 = nothing to post
+static SchedulerEvent postEvent;
+static unsigned long alarmPeriodMs;      // 0 = no RTC alarms
+static unsigned long nextAlarm;
+
+static void virtualSleep(unsigned long ms) {
+    lastSleepMs = ms;
+    unsigned long wakeAt = millis() + ms;
+    if (alarmPeriodMs && (long)(nextAlarm - wakeAt) < 0) {
+        hostAdvanceMillis(nextAlarm > millis() ? nextAlarm - millis() : 0);
+        sched->post(EVT_RTC_ALARM);
+        nextAlarm += alarmPeriodMs;
+        return;
+    }
+    if (postAt && (long)(postAt - wakeAt) < 0) {
+        hostAdvanceMillis(postAt > millis() ? postAt - millis() : 0);
+        sched->post(postEvent);
+        postAt = 0;
+        return;
+    }
+    hostAdvanceMillis(ms);
+}
+
+static void useVirtualClock(EventScheduler& s) {
+    sched = &s;
+    lastSleepMs = 0;
+    postAt = 0;
+    s.setClock(nullptr, virtualSleep);
+}
+
+// The timers loop() polls in each state with no client connected, the
+// buttons settled and the display on while awake, as in main.cpp. The
+// BLE housekeeping timer is only polled while the radio has timed work.
+static void loopPass(EventScheduler& s, uint8_t state, bool microphone, bool radioWork = false) {
+    if (radioWork) s.every(TIMER_BLUETOOTH, 1000);
+    if (state == 0) {
+        s.every(TIMER_SENSORS, 5000);
+        if (s.every(TIMER_POWER, 5000)) s.every(TIMER_POWER_DEBUG, 30000);
+        if (microphone) s.every(TIMER_AUDIO_SAMPLE, 100);
+        s.every(TIMER_LOG, 10 * 60000UL);
+        s.every(TIMER_DISPLAY, 1000);
+    }
+    s.take(EVT_RTC_ALARM);
+    s.setMode(state);
+    s.idle();
+}
+
+// alarmMs: period of the RTC alarm the field schedule programs
+static float wakeupsPerHour(uint8_t state, bool microphone, bool radioWork = false,
+                            unsigned long alarmMs = 0) {
+    EventScheduler s;
+    useVirtualClock(s);
+    alarmPeriodMs = alarmMs;
+    nextAlarm = millis() + alarmMs;
+    unsigned long start = millis();
+    while (millis() - start < HOUR_MS) loopPass(s, state, microphone, radioWork);
+    alarmPeriodMs = 0;
+    return s.getWakeupsPerHour(state);
+}
+
+// =============================================================================
+// TIMERS
+// =============================================================================
+
+TEST(timerFiresOncePerPeriodOnPhase) {
+    EventScheduler s;
+    useVirtualClock(s);
+    CHECK(!s.every(TIMER_LOG, 100));         // Arms
+    hostAdvanceMillis(50);
+    CHECK(!s.every(TIMER_LOG, 100));
+    hostAdvanceMillis(50);
+    CHECK(s.every(TIMER_LOG, 100));
+    CHECK(!s.every(TIMER_LOG, 100));
+    hostAdvanceMillis(130);                  // Late, but the phase holds
+    CHECK(s.every(TIMER_LOG, 100));
+    hostAdvanceMillis(70);
+    CHECK(s.every(TIMER_LOG, 100));
+}
+
+TEST(missedPeriodsFireOnce) {
+    EventScheduler s;
+    useVirtualClock(s);
+    s.every(TIMER_LOG, 100);
+    hostAdvanceMillis(1050);
+    CHECK(s.every(TIMER_LOG, 100));
+    CHECK(!s.every(TIMER_LOG, 100));
+    hostAdvanceMillis(99);
+    CHECK(!s.every(TIMER_LOG, 100));
+    hostAdvanceMillis(1);
+    CHECK(s.every(TIMER_LOG, 100));
+}
+
+TEST(changedPeriodRearmsFromNow) {
+    EventScheduler s;
+    useVirtualClock(s);
+    s.every(TIMER_LOG, 100);
+    hostAdvanceMillis(90);
+    CHECK(!s.every(TIMER_LOG, 500));
+    hostAdvanceMillis(400);
+    CHECK(!s.every(TIMER_LOG, 500));
+    hostAdvanceMillis(100);
+    CHECK(s.every(TIMER_LOG, 500));
+}
+
+TEST(restartAndStop) {
+    EventScheduler s;
+    useVirtualClock(s);
+    s.every(TIMER_DISPLAY, 1000);
+    hostAdvanceMillis(900);
+    s.restart(TIMER_DISPLAY);
+    hostAdvanceMillis(200);
+    CHECK(!s.every(TIMER_DISPLAY, 1000));
+    hostAdvanceMillis(800);
+    CHECK(s.every(TIMER_DISPLAY, 1000));
+
+    s.stop(TIMER_DISPLAY);
+    hostAdvanceMillis(5000);
+    CHECK(!s.every(TIMER_DISPLAY, 1000));    // Arms again
+}
+
+// =============================================================================
+// IDLE
+// =============================================================================
+
+TEST(idleSleepsUntilNearestPolledDeadline) {
+    EventScheduler s;
+    useVirtualClock(s);
+    s.every(TIMER_LOG, 1000);
+    s.every(TIMER_DISPLAY, 300);
+    s.idle();
+    CHECK_EQ(lastSleepMs, 300);
+
+    CHECK(s.every(TIMER_DISPLAY, 300));
+    s.every(TIMER_LOG, 1000);
+    s.idle();
+    CHECK_EQ(lastSleepMs, 300);
+}
+
+TEST(unpolledTimerStopsWaking) {
+    EventScheduler s;
+    useVirtualClock(s);
+    s.every(TIMER_AUDIO_SAMPLE, 100);
+    s.idle();
+    CHECK_EQ(lastSleepMs, 100);
+    s.idle();
+    CHECK_EQ(lastSleepMs, SCHED_MAX_IDLE_MS);
+}
+
+TEST(dueTimerOrPendingEventSkipsSleep) {
+    EventScheduler s;
+    useVirtualClock(s);
+    s.every(TIMER_LOG, 100);
+    hostAdvanceMillis(100);
+    s.every(TIMER_DISPLAY, 1000);
+    s.idle();                                // TIMER_LOG is due and not consumed
+    CHECK_EQ(lastSleepMs, 0);
+    CHECK_EQ(s.getModeStats(0).wakeups, 0);
+
+    s.post(EVT_BUTTON);
+    s.idle();
+    CHECK_EQ(lastSleepMs, 0);
+    CHECK(s.take(EVT_BUTTON));
+    CHECK(!s.take(EVT_BUTTON));
+}
+
+TEST(eventEndsSleepEarly) {
+    EventScheduler s;
+    useVirtualClock(s);
+    unsigned long start = millis();
+    postAt = start + 250;
+    postEvent = EVT_BLE;
+    s.every(TIMER_LOG, 10000);
+    s.idle();
+    CHECK_EQ(millis() - start, 250);
+    CHECK(s.take(EVT_BLE));
+    CHECK_EQ(s.getModeStats(0).wakeups, 1);
+    CHECK_EQ(s.getModeStats(0).sleepMs, 250);
+}
+
+TEST(waitForEventTimesOutWithoutEvents) {
+    EventScheduler s;
+    useVirtualClock(s);
+    CHECK(!s.waitForEvent(40));
+    CHECK_EQ(lastSleepMs, 40);
+    postAt = millis() + 10;
+    postEvent = EVT_RTC_ALARM;
+    CHECK(s.waitForEvent(40));
+}
+
+// =============================================================================
+// WAKEUPS PER HOUR
+// =============================================================================
+
+TEST(wakeupsPerHourByMode) {
+    float awakeAudio = wakeupsPerHour(0, true);
+    float awake = wakeupsPerHour(0, false);
+    printf("  wakeups/h: awake %.0f (%.0f with audio)\n", awake, awakeAudio);
+
+    // The fastest polled timer sets the rate: audio 100 ms, display 1 s;
+    // everything else shares those wakeups
+    CHECK(awakeAudio >= 35900 && awakeAudio <= 36000);
+    CHECK(awake >= 3590 && awake <= 3600);
+}
+
+TEST(sleepingWakesOnlyWhenScheduled) {
+    // Field mode at 10 and 60 min, radio off or idle
+    float tenMinutes = wakeupsPerHour(1, false, false, 10 * 60000UL);
+    float hourly = wakeupsPerHour(1, false, false, 60 * 60000UL);
+    printf("  wakeups/h asleep: %.1f at 10 min, %.1f hourly\n", tenMinutes, hourly);
+    CHECK(tenMinutes >= 6.0f && tenMinutes <= 6.5f);
+    CHECK(hourly >= 1.0f && hourly <= 1.5f);
+
+    // A beacon's refresh is real work and keeps its 1 s timer
+    CHECK(wakeupsPerHour(1, false, true, 10 * 60000UL) >= 3590);
+}
+
+TEST(statsAreKeptPerMode) {
+    EventScheduler s;
+    useVirtualClock(s);
+    for (int i = 0; i < 60; i++) loopPass(s, 0, false);
+    for (int i = 0; i < 60; i++) loopPass(s, 1, false);
+    CHECK(s.getModeStats(0).wakeups > 0);
+    CHECK(s.getModeStats(1).wakeups > 0);
+    CHECK_EQ(s.getModeStats(2).wakeups, 0);
+    CHECK(s.getModeStats(1).sleepMs <= s.getModeStats(1).totalMs);
+
+    s.resetStats();
+    CHECK_EQ(s.getModeStats(0).wakeups, 0);
+    CHECK(s.getWakeupsPerHour(0) == 0.0f);
+}
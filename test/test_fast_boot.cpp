@@ -0,0 +1,249 @@
+/**
+ * test_fast_boot.cpp
+ * Boot path decisions after a System OFF wake: which wakes may skip the
+ * normal boot, when the retained state and the fast boot cache are
+ * trusted, and that a scheduled wake leaves the radio off until a user
+ * wakes the device
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "FastBoot.h"
+#include "PowerManager.h"
+#include "Bluetooth.h"
+#include "Settings.h"
+
+extern SystemSettings settings;
+extern SystemStatus systemStatus;
+
+static SystemSettings validSettings() {
+    SystemSettings s = getDefaultSettings();
+    s.magicNumber = SETTINGS_MAGIC_NUMBER;
+    s.checksum = calculateChecksum(&s);
+    return s;
+}
+
+static FastBootCache* cacheBytes() {
+    return const_cast<FastBootCache*>(fastBoot.getCache());
+}
+
+// A cache as enterDeepSleepMode() leaves it
+static void saveCache() {
+    memset(cacheBytes(), 0, sizeof(FastBootCache));
+    FastBoot before;
+    before.choose(WAKE_POWER_ON, false);
+    FieldModeBuffer buffer = {};
+    buffer.count = 3;
+    systemStatus.pdmWorking = true;
+    before.save(validSettings(), systemStatus, buffer, 1735689600UL);
+}
+
+// A power manager in field mode, as it is just before System OFF
+static void enterFieldMode(PowerManager& pm) {
+    settings.fieldModeEnabled = true;
+    pm.initialize(&systemStatus, &settings);
+}
+
+// =============================================================================
+// PATH DECISION
+// =============================================================================
+
+TEST(onlyScheduledWakesSkipTheNormalBoot) {
+    CHECK_EQ(chooseBootPath(WAKE_RTC, true, true), BOOT_FAST);
+    CHECK_EQ(chooseBootPath(WAKE_RTC, true, false), BOOT_QUICK);
+
+    // No field mode to resume
+    CHECK_EQ(chooseBootPath(WAKE_RTC, false, true), BOOT_FULL);
+    CHECK_EQ(chooseBootPath(WAKE_RTC, false, false), BOOT_FULL);
+
+    // Someone is in front of the device
+    const WakeUpSource others[] = { WAKE_POWER_ON, WAKE_BUTTON, WAKE_BLUETOOTH_BUTTON, WAKE_UNKNOWN };
+    for (WakeUpSource reason : others) {
+        CHECK_EQ(chooseBootPath(reason, true, true), BOOT_FULL);
+        CHECK_EQ(chooseBootPath(reason, false, false), BOOT_FULL);
+    }
+}
+
+// =============================================================================
+// CACHE VALIDITY
+// =============================================================================
+
+TEST(savedCacheGivesAFastBoot) {
+    saveCache();
+    FastBoot boot;
+    CHECK_EQ(boot.choose(WAKE_RTC, true), BOOT_FAST);
+    CHECK(boot.isCacheValid());
+
+    SystemSettings restored = {};
+    SystemStatus status = {};
+    FieldModeBuffer buffer = {};
+    boot.restore(restored, status, buffer);
+    CHECK_EQ(restored.magicNumber, SETTINGS_MAGIC_NUMBER);
+    CHECK_EQ(restored.checksum, calculateChecksum(&restored));
+    CHECK(status.pdmWorking);
+    CHECK_EQ(buffer.count, 3);
+}
+
+TEST(clearedRamIsNotACache) {
+    memset(cacheBytes(), 0, sizeof(FastBootCache));
+    FastBoot boot;
+    CHECK_EQ(boot.choose(WAKE_RTC, true), BOOT_QUICK);
+    CHECK(!boot.isCacheValid());
+}
+
+TEST(cacheFromAnotherLayoutIsRefused) {
+    saveCache();
+    cacheBytes()->version = FAST_BOOT_VERSION + 1;
+    FastBoot boot;
+    CHECK_EQ(boot.choose(WAKE_RTC, true), BOOT_QUICK);
+}
+
+TEST(damagedCacheIsRefused) {
+    // RAM contents are only retained while powered; any flipped bit in
+    // the block must fail the check
+    const size_t offsets[] = { offsetof(FastBootCache, micPresent),
+                               offsetof(FastBootCache, settings) + 4,
+                               offsetof(FastBootCache, buffer),
+                               offsetof(FastBootCache, lastFlushTime) };
+    for (size_t offset : offsets) {
+        saveCache();
+        ((uint8_t*)cacheBytes())[offset] ^= 0x10;
+        FastBoot boot;
+        CHECK_EQ(boot.choose(WAKE_RTC, true), BOOT_QUICK);
+    }
+}
+
+TEST(settingsThatFailTheirOwnChecksumAreRefused) {
+    // The block check passes, but what was cached was already bad
+    saveCache();
+    FastBootCache* cache = cacheBytes();
+    cache->settings.checksum ^= 0xFFFF;
+    FastBoot resealed;
+    resealed.choose(WAKE_RTC, true);
+    resealed.save(cache->settings, systemStatus, cache->buffer, 1735689600UL);
+
+    FastBoot boot;
+    CHECK_EQ(boot.choose(WAKE_RTC, true), BOOT_QUICK);
+}
+
+TEST(validCacheOnAButtonWakeStillBootsFully) {
+    saveCache();
+    FastBoot boot;
+    CHECK_EQ(boot.choose(WAKE_BUTTON, true), BOOT_FULL);
+    CHECK(boot.isCacheValid());
+}
+
+// =============================================================================
+// RETAINED STATE
+// =============================================================================
+
+TEST(retainedFieldModeIsRestored) {
+    hostBootDevice();
+    PowerManager before;
+    enterFieldMode(before);
+    before.saveRetainedState();
+
+    settings.fieldModeEnabled = false;
+    PowerManager after;
+    after.initialize(&systemStatus, &settings);
+    CHECK(after.restoreRetainedState());
+    CHECK(after.isFieldModeActive());
+    CHECK(settings.fieldModeEnabled);
+}
+
+TEST(clearedRetainedStateIsNotRestored) {
+    hostBootDevice();
+    PowerManager before;
+    enterFieldMode(before);
+    before.saveRetainedState();
+    before.clearRetainedState();
+
+    PowerManager after;
+    after.initialize(&systemStatus, &settings);
+    CHECK(!after.restoreRetainedState());
+}
+
+TEST(testingModeIsNotResumed) {
+    hostBootDevice();
+    settings.fieldModeEnabled = false;
+    PowerManager before;
+    before.initialize(&systemStatus, &settings);
+    before.saveRetainedState();
+
+    PowerManager after;
+    after.initialize(&systemStatus, &settings);
+    CHECK(!after.restoreRetainedState());
+}
+
+// =============================================================================
+// RADIO ON A SCHEDULED WAKE
+// =============================================================================
+
+TEST(restoredFieldModeSwitchesTheRadioOff) {
+    hostBootDevice();
+    PowerManager before;
+    enterFieldMode(before);
+    before.saveRetainedState();
+
+    // setup() order: manager set before the retained state is restored
+    BluetoothManager bt;
+    bt.getSettings().enabled = true;
+    PowerManager after;
+    after.initialize(&systemStatus, &settings);
+    after.setBluetoothManager(&bt);
+    REQUIRE(after.restoreRetainedState());
+    CHECK(!bt.getSettings().enabled);
+    CHECK(!bt.isStarted());
+}
+
+TEST(scheduledWakeDefersTheRadioUntilAUserWake) {
+    hostBootDevice();
+    PowerManager before;
+    enterFieldMode(before);
+    before.saveRetainedState();
+
+    BluetoothManager bt;
+    PowerManager pm;
+    pm.initialize(&systemStatus, &settings);
+    pm.setBluetoothManager(&bt);
+    REQUIRE(pm.restoreRetainedState());
+    bt.initialize(&systemStatus, &settings, false);
+    CHECK(!bt.isStarted());
+
+    // The reading and the way back to sleep leave it off
+    bt.update();
+    pm.powerDownBluetooth();
+    CHECK(!bt.isStarted());
+    CHECK_EQ(bt.getStatus(), BT_STATUS_OFF);
+
+    // A button brings the dashboard and the radio up
+    pm.wakeFromFieldSleep();
+    CHECK(bt.isStarted());
+    CHECK(bt.getSettings().enabled);
+    CHECK_EQ(bt.getStatus(), BT_STATUS_ADVERTISING);
+}
+
+TEST(bluetoothButtonStartsTheDeferredRadio) {
+    hostBootDevice();
+    PowerManager before;
+    enterFieldMode(before);
+    before.saveRetainedState();
+
+    BluetoothManager bt;
+    PowerManager pm;
+    pm.initialize(&systemStatus, &settings);
+    pm.setBluetoothManager(&bt);
+    REQUIRE(pm.restoreRetainedState());
+    bt.initialize(&systemStatus, &settings, false);
+
+    pm.handleBluetoothButtonPress();
+    CHECK(bt.isStarted());
+    CHECK_EQ(bt.getStatus(), BT_STATUS_ADVERTISING);
+}
+
+TEST(normalBootStartsTheRadio) {
+    hostBootDevice();
+    BluetoothManager bt;
+    bt.initialize(&systemStatus, &settings);
+    CHECK(bt.isStarted());
+}
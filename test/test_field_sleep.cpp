@@ -0,0 +1,260 @@
+/**
+ * test_field_sleep.cpp
+ * System ON sleep as enterNRF52Sleep() runs it: the scheduler's wait is
+ * replaced by a virtual sleep that raises scripted pin interrupts (the
+ * PCF8523 INT line, a button, a bounce) at their time, and the test
+ * checks what woke the device, when, and what it slept through
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "PowerManager.h"
+#include "WakeSchedule.h"
+#include "EventScheduler.h"
+#include "Utils.h"
+#include <RTClib.h>
+#include <vector>
+#include <algorithm>
+
+extern SystemSettings settings;
+extern SystemStatus systemStatus;
+extern RTC_PCF8523 rtc;
+
+// A pin goes to level at atMs, and its interrupt fires on the change
+struct PinEdge {
+    unsigned long atMs;
+    int pin;
+    int level;
+};
+
+static std::vector<PinEdge> script;
+static uint32_t waits;
+
+// Sleeps until the timeout or the next scripted edge, whichever is first
+static void scriptedSleep(unsigned long ms) {
+    waits++;
+    std::stable_sort(script.begin(), script.end(),
+                     [](const PinEdge& a, const PinEdge& b) { return a.atMs < b.atMs; });
+    unsigned long until = millis() + ms;
+    if (script.empty() || script.front().atMs > until) {
+        hostAdvanceMillis(ms);
+        return;
+    }
+    PinEdge edge = script.front();
+    script.erase(script.begin());
+    if (edge.atMs > millis()) hostAdvanceMillis(edge.atMs - millis());
+    hostSetPin(edge.pin, edge.level);
+
+    // Buttons interrupt on either edge, the RTC line only when it falls
+    if (edge.pin != RTC_INT_PIN || edge.level == LOW) hostFireInterrupt(edge.pin);
+}
+
+static void onButton() {
+    eventScheduler.post(EVT_BUTTON);
+}
+
+// Virtual ms at which the RTC reaches unix time t
+static unsigned long rtcAt(uint32_t t) {
+    return millis() + (t - rtc.now().unixtime()) * 1000UL;
+}
+
+// The alarm pulls INT low and holds it until the flag is cleared
+static void rtcFiresAt(uint32_t t) {
+    script.push_back({ rtcAt(t), RTC_INT_PIN, LOW });
+}
+
+static void press(int pin, unsigned long atMs, unsigned long holdMs) {
+    script.push_back({ atMs, pin, LOW });
+    script.push_back({ atMs + holdMs, pin, HIGH });
+}
+
+// Field mode with the display off, the next wake planned as the loop
+// plans it; returns the target
+static uint32_t fallAsleep(PowerManager& pm) {
+    hostBootDevice();
+    settings.fieldModeEnabled = true;
+    pm.initialize(&systemStatus, &settings);
+    attachButtonInterrupts(onButton);
+    resetButtonStates();
+    script.clear();
+    waits = 0;
+    eventScheduler.begin();
+    eventScheduler.setClock(nullptr, scriptedSleep);
+    pm.updateNextWakeTime(pm.getWakeIntervalS());
+    return pm.getPowerStatus().nextWakeTime;
+}
+
+static void wakeUp() {
+    eventScheduler.setClock(nullptr, nullptr);
+    wakeSchedule.overrideInterval(0);
+    wakeSchedule = WakeSchedule();
+}
+
+// =============================================================================
+// RTC
+// =============================================================================
+
+TEST(rtcAlarmEndsTheSleep) {
+    PowerManager pm;
+    uint32_t target = fallAsleep(pm);
+    uint32_t start = rtc.now().unixtime();
+    REQUIRE(target > start);
+    rtcFiresAt(target);
+
+    pm.enterNRF52Sleep();
+    wakeUp();
+
+    CHECK_EQ(pm.getPowerStatus().lastWakeSource, WAKE_RTC);
+    CHECK_EQ(rtc.now().unixtime(), target);
+    CHECK_EQ(pm.getLastSleepMs(), (target - start) * 1000UL);
+
+    // One wait, cut short by the interrupt; no polling in between
+    CHECK_EQ(waits, 1);
+    CHECK(script.empty());
+}
+
+TEST(minuteAlarmBeforeTheTargetSleepsOnForTheSeconds) {
+    PowerManager pm;
+    fallAsleep(pm);
+    wakeSchedule.configure(330, WAKE_MODE_RELATIVE, 0);
+    uint32_t start = rtc.now().unixtime();
+    pm.updateNextWakeTime(pm.getWakeIntervalS());
+    uint32_t target = pm.getPowerStatus().nextWakeTime;
+    REQUIRE(target == start + 330);
+    REQUIRE(target % 60 != 0);
+
+    // Stage one: the alarm at the minute; stage two: timer A
+    rtcFiresAt(target - target % 60);
+    script.push_back({ rtcAt(target - target % 60) + 1, RTC_INT_PIN, HIGH });
+    rtcFiresAt(target);
+
+    pm.enterNRF52Sleep();
+    wakeUp();
+
+    CHECK_EQ(pm.getPowerStatus().lastWakeSource, WAKE_RTC);
+    CHECK_EQ(rtc.now().unixtime(), target);
+    CHECK_EQ(pm.getLastSleepMs(), 330000UL);
+}
+
+TEST(strayRtcEdgeLongBeforeTheTargetIsSleptThrough) {
+    PowerManager pm;
+    uint32_t target = fallAsleep(pm);
+    uint32_t start = rtc.now().unixtime();
+    REQUIRE(target - start > 60);
+
+    // A glitch on INT half a minute in: the RTC says it is not time yet
+    script.push_back({ millis() + 30000, RTC_INT_PIN, LOW });
+    script.push_back({ millis() + 30001, RTC_INT_PIN, HIGH });
+    rtcFiresAt(target);
+
+    pm.enterNRF52Sleep();
+    wakeUp();
+
+    CHECK_EQ(pm.getPowerStatus().lastWakeSource, WAKE_RTC);
+    CHECK_EQ(rtc.now().unixtime(), target);
+    CHECK(waits >= 3);
+}
+
+TEST(missedAlarmWakesOnTheBackstop) {
+    PowerManager pm;
+    uint32_t target = fallAsleep(pm);
+    uint32_t start = rtc.now().unixtime();
+
+    // INT never moves
+    pm.enterNRF52Sleep();
+    wakeUp();
+
+    CHECK_EQ(pm.getPowerStatus().lastWakeSource, WAKE_TIMER);
+    CHECK_EQ(pm.getLastSleepMs(), (target - start) * 1000UL + SLEEP_ALARM_MARGIN_MS);
+}
+
+// =============================================================================
+// BUTTONS
+// =============================================================================
+
+TEST(buttonPressWakesBeforeTheAlarm) {
+    PowerManager pm;
+    uint32_t target = fallAsleep(pm);
+    unsigned long pressAt = millis() + 90000;
+    press(BTN_SELECT, pressAt, 300);
+    rtcFiresAt(target);
+
+    pm.enterNRF52Sleep();
+    wakeUp();
+
+    CHECK_EQ(pm.getPowerStatus().lastWakeSource, WAKE_BUTTON);
+    CHECK(pm.isWakeupFromButton());
+
+    // Woken at the press, confirmed within the debounce check
+    CHECK(millis() > pressAt + DEBOUNCE_DELAY);
+    CHECK(millis() <= pressAt + DEBOUNCE_DELAY + BUTTON_POLL_MS * 3);
+    CHECK(rtc.now().unixtime() < target);
+}
+
+TEST(bluetoothButtonWakesToo) {
+    PowerManager pm;
+    uint32_t target = fallAsleep(pm);
+    press(BTN_BLUETOOTH, millis() + 5000, 200);
+    rtcFiresAt(target);
+
+    pm.enterNRF52Sleep();
+    wakeUp();
+
+    CHECK_EQ(pm.getPowerStatus().lastWakeSource, WAKE_BUTTON);
+    CHECK(rtc.now().unixtime() < target);
+}
+
+TEST(bounceIsNotAPress) {
+    PowerManager pm;
+    uint32_t target = fallAsleep(pm);
+
+    // 5 ms low, shorter than the debounce window, then the alarm
+    press(BTN_UP, millis() + 60000, 5);
+    rtcFiresAt(target);
+
+    pm.enterNRF52Sleep();
+    wakeUp();
+
+    CHECK_EQ(pm.getPowerStatus().lastWakeSource, WAKE_RTC);
+    CHECK_EQ(rtc.now().unixtime(), target);
+    CHECK(script.empty());
+}
+
+TEST(releaseEdgeOfAnEarlierPressIsNotAWake) {
+    PowerManager pm;
+    uint32_t target = fallAsleep(pm);
+
+    // The button went down while awake and comes up during the sleep
+    hostSetPin(BTN_DOWN, LOW);
+    updateButtonStates();
+    hostAdvanceMillis(DEBOUNCE_DELAY + 1);
+    updateButtonStates();
+    wasButtonPressed(1);
+    script.push_back({ millis() + 2000, BTN_DOWN, HIGH });
+    rtcFiresAt(target);
+
+    pm.enterNRF52Sleep();
+    wakeUp();
+
+    CHECK_EQ(pm.getPowerStatus().lastWakeSource, WAKE_RTC);
+    CHECK_EQ(rtc.now().unixtime(), target);
+}
+
+TEST(alarmDuringTheDebounceCheckWins) {
+    PowerManager pm;
+    uint32_t target = fallAsleep(pm);
+
+    // Pressed 20 ms before the alarm: the alarm is the wake, and the
+    // press is left for the loop's debouncer
+    unsigned long alarmMs = rtcAt(target);
+    press(BTN_SELECT, alarmMs - 20, 300);
+    rtcFiresAt(target);
+
+    pm.enterNRF52Sleep();
+    wakeUp();
+
+    CHECK_EQ(pm.getPowerStatus().lastWakeSource, WAKE_RTC);
+    CHECK_EQ(rtc.now().unixtime(), target);
+    CHECK(millis() < alarmMs + DEBOUNCE_DELAY);
+    CHECK(!buttonsSettled());
+}
@@ -0,0 +1,310 @@
+/**
+ * test_file_catalog.cpp
+ * Paged file listing: names, summaries, paging, sorting, filters and
+ * response size over a simulated link
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "BleDecoder.h"
+#include "BleProtocol.h"
+#include "FileCatalog.h"
+#include "Utils.h"
+#include <SD.h>
+#include <set>
+
+static void writeText(const char* path, const char* text) {
+    SD.remove(path);
+    SDLib::File file = SD.open(path, FILE_WRITE);
+    file.write((const uint8_t*)text, strlen(text));
+    file.close();
+}
+
+// count small files in the root, plus every month of the given years
+// under /HIVE_DATA
+static uint32_t fillCard(uint32_t count, uint16_t fromYear = 0, uint16_t toYear = 0) {
+    char path[CATALOG_PATH_LEN];
+    for (uint32_t i = 0; i < count; i++) {
+        snprintf(path, sizeof(path), "/L%05u.TXT", (unsigned)i);
+        std::string text(1 + i % 97, 'x');
+        writeText(path, text.c_str());
+    }
+    uint32_t files = count;
+    for (uint16_t y = fromYear; y && y <= toYear; y++) {
+        snprintf(path, sizeof(path), "/HIVE_DATA/%u", y);
+        SD.mkdir(path);
+        for (uint8_t m = 1; m <= 12; m++) {
+            snprintf(path, sizeof(path), "/HIVE_DATA/%u/%u-%02u.CSV", y, y, m);
+            hostWriteFile(path, 200 + m * 10 + (y % 10), y * 100 + m);
+            files++;
+        }
+    }
+    return files;
+}
+
+// Follows the continuation token to the end, as the app does
+static std::vector<CatalogEntry> listAll(CatalogQuery query, uint32_t& pages, uint32_t& total) {
+    std::vector<CatalogEntry> all;
+    CatalogEntry page[CATALOG_MAX_PAGE];
+    bool more = true;
+    pages = 0;
+    query.hasToken = false;
+    while (more && pages < 10000) {
+        uint8_t n = selectCatalogPage(query, page, total, more);
+        all.insert(all.end(), page, page + n);
+        pages++;
+        if (n == 0) break;
+        query.hasToken = true;
+        query.tokenKey = page[n - 1].key;
+        query.tokenTie = page[n - 1].tie;
+    }
+    return all;
+}
+
+// =============================================================================
+// NAMES AND SUMMARIES
+// =============================================================================
+
+TEST(monthParsedFromBothNameForms) {
+    uint16_t year;
+    uint8_t month;
+    CHECK(parseLogFileMonth("/H2507.CSV", year, month));
+    CHECK_EQ(year, 2025);
+    CHECK_EQ(month, 7);
+    CHECK(parseLogFileMonth("/HIVE_DATA/2024/2024-12.CSV", year, month));
+    CHECK_EQ(year, 2024);
+    CHECK_EQ(month, 12);
+    CHECK(!parseLogFileMonth("/H2513.CSV", year, month));
+    CHECK(!parseLogFileMonth("/RECORDS.BIN", year, month));
+    CHECK_EQ(year, 0);
+}
+
+TEST(logSummaryFromFirstAndLastLines) {
+    hostBootDevice();
+    std::string text = "DateTime,Unix,Temp\n";
+    for (int i = 0; i < 50; i++) {
+        char line[48];
+        snprintf(line, sizeof(line), "2025-01-01 00:%02d,%lu,21.50\n", i, 1735689600UL + i * 60);
+        text += line;
+    }
+    writeText("/H2501.CSV", text.c_str());
+    LogFileStats stats;
+    REQUIRE(readLogFileStats("/H2501.CSV", stats));
+    CHECK_EQ(stats.firstTime, 1735689600UL);
+    CHECK_EQ(stats.lastTime, 1735689600UL + 49 * 60);
+    CHECK_EQ(stats.records, 50);
+    CHECK(!readLogFileStats("/NOPE.CSV", stats));
+}
+
+// =============================================================================
+// PAGING
+// =============================================================================
+
+TEST(thousandsOfFilesListedOnceEach) {
+    hostBootDevice();
+    uint32_t files = fillCard(3000, 2020, 2024);
+    CatalogQuery query = { CATALOG_SORT_DIRECTORY, CATALOG_MAX_PAGE, 0, 0, false, 0, 0 };
+    uint32_t pages, total;
+    std::vector<CatalogEntry> all = listAll(query, pages, total);
+    CHECK_EQ(total, files);
+    CHECK_EQ(all.size(), files);
+    CHECK_EQ(pages, (files + CATALOG_MAX_PAGE - 1) / CATALOG_MAX_PAGE);
+    std::set<std::string> names;
+    for (const CatalogEntry& e : all) names.insert(e.path);
+    CHECK_EQ(names.size(), files);
+}
+
+TEST(timeOrderHoldsAcrossPages) {
+    hostBootDevice();
+    fillCard(0, 2019, 2025);
+    for (uint8_t sort : { (uint8_t)CATALOG_SORT_TIME_ASC, (uint8_t)CATALOG_SORT_TIME_DESC }) {
+        CatalogQuery query = { sort, 5, 0, 0, false, 0, 0 };
+        uint32_t pages, total;
+        std::vector<CatalogEntry> all = listAll(query, pages, total);
+        REQUIRE(all.size() == 7 * 12);
+        for (size_t i = 1; i < all.size(); i++) {
+            uint32_t a = all[i - 1].year * 12 + all[i - 1].month;
+            uint32_t b = all[i].year * 12 + all[i].month;
+            CHECK(sort == CATALOG_SORT_TIME_ASC ? a < b : a > b);
+        }
+    }
+}
+
+TEST(sizeOrderHoldsAcrossPages) {
+    hostBootDevice();
+    fillCard(300);
+    CatalogQuery query = { CATALOG_SORT_SIZE_DESC, 7, 0, 0, false, 0, 0 };
+    uint32_t pages, total;
+    std::vector<CatalogEntry> all = listAll(query, pages, total);
+    REQUIRE(all.size() == 300);
+    for (size_t i = 1; i < all.size(); i++) CHECK(all[i - 1].size >= all[i].size);
+}
+
+TEST(filterByYearAndMonth) {
+    hostBootDevice();
+    fillCard(100, 2023, 2025);
+    writeText("/H2407.CSV", "x\n");
+    CatalogQuery query = { CATALOG_SORT_TIME_ASC, CATALOG_MAX_PAGE, 2024, 0, false, 0, 0 };
+    uint32_t pages, total;
+    std::vector<CatalogEntry> all = listAll(query, pages, total);
+    CHECK_EQ(total, 13);
+    CHECK_EQ(all.size(), 13);
+    for (const CatalogEntry& e : all) CHECK_EQ(e.year, 2024);
+
+    query.month = 7;
+    all = listAll(query, pages, total);
+    CHECK_EQ(total, 2);
+    query.year = 0;
+    all = listAll(query, pages, total);
+    CHECK_EQ(total, 4);
+}
+
+TEST(filesAddedBetweenPagesAreNotRepeated) {
+    hostBootDevice();
+    fillCard(0, 2020, 2021);
+    CatalogQuery query = { CATALOG_SORT_TIME_ASC, 6, 0, 0, false, 0, 0 };
+    CatalogEntry page[CATALOG_MAX_PAGE];
+    uint32_t total;
+    bool more;
+    uint8_t n = selectCatalogPage(query, page, total, more);
+    REQUIRE(n == 6 && more);
+    std::string lastSent = page[5].path;
+
+    // An older month appears before the next request; the token is a key,
+    // so the client continues after what it already has
+    SD.mkdir("/HIVE_DATA/2019");
+    hostWriteFile("/HIVE_DATA/2019/2019-05.CSV", 300);
+    query.hasToken = true;
+    query.tokenKey = page[5].key;
+    query.tokenTie = page[5].tie;
+    n = selectCatalogPage(query, page, total, more);
+    REQUIRE(n == 6);
+    CHECK_EQ(total, 25);
+    for (uint8_t i = 0; i < n; i++) CHECK(lastSent != page[i].path);
+    CHECK_EQ(page[0].year, 2020);
+    CHECK_EQ(page[0].month, 7);
+}
+
+// =============================================================================
+// OVER THE LINK
+// =============================================================================
+
+struct ListedPage {
+    std::vector<std::string> names;
+    uint32_t total;
+    bool more;
+    uint32_t nextKey, nextTie;
+    uint32_t bytes;
+    uint16_t frames;
+};
+
+static bool listOverLink(BleSimClient& client, const std::vector<uint8_t>& args, bool cbor, ListedPage& out) {
+    uint8_t id = client.send(BT_CMD_LIST_FILES, args, cbor ? BT_REQ_FLAG_CBOR : 0);
+    if (!client.runUntil([&] { return client.responseCount(id) == 1; })) return false;
+    const SimResponse* r = client.lastResponse(id);
+    BleFields fields;
+    if (r->code != BT_RESP_OK || r->seqError) return false;
+    if (!(cbor ? decodeCbor(r->payload, fields) : decodeTlv(r->payload, "FL", fields))) return false;
+
+    const BleValue* files = findField(fields, BT_FL_files);
+    if (!files) return false;
+    out.names.clear();
+    for (const BleFields& record : files->records) {
+        const BleValue* name = findField(record, BT_FE_name);
+        if (name) out.names.push_back(name->text);
+    }
+    out.total = findField(fields, BT_FL_total)->scalar;
+    out.more = findField(fields, BT_FL_more)->scalar;
+    out.nextKey = out.more ? findField(fields, BT_FL_nextKey)->scalar : 0;
+    out.nextTie = out.more ? findField(fields, BT_FL_nextTie)->scalar : 0;
+    out.bytes = r->bytes;
+    out.frames = r->frames;
+    return true;
+}
+
+static std::vector<uint8_t> listArgs(uint8_t sort, uint8_t pageSize, const ListedPage* after = nullptr) {
+    std::vector<uint8_t> args = { sort, pageSize, 0, 0, 0 };
+    if (after) {
+        args.resize(13);
+        putU32LE(&args[5], after->nextKey);
+        putU32LE(&args[9], after->nextTie);
+    }
+    return args;
+}
+
+TEST(pagedListingOverLinkCoversCard) {
+    hostBootDevice();
+    uint32_t files = fillCard(150, 2024, 2025);
+    BleSimClient client;
+    client.begin({ 247, 12, 8, 4, 0, 1 });
+
+    std::set<std::string> seen;
+    ListedPage page;
+    REQUIRE(listOverLink(client, listArgs(CATALOG_SORT_DIRECTORY, 0), false, page));
+    uint32_t requests = 1;
+    for (const std::string& n : page.names) seen.insert(n);
+    while (page.more && requests < 100) {
+        ListedPage previous = page;
+        REQUIRE(listOverLink(client, listArgs(CATALOG_SORT_DIRECTORY, 0, &previous), requests % 2 == 1, page));
+        for (const std::string& n : page.names) seen.insert(n);
+        requests++;
+    }
+    CHECK_EQ(page.total, files);
+    CHECK_EQ(seen.size(), files);
+    CHECK_EQ(requests, (files + CATALOG_MAX_PAGE - 1) / CATALOG_MAX_PAGE);
+}
+
+TEST(unknownSortIsRejected) {
+    hostBootDevice();
+    fillCard(10, 2025, 2025);
+    BleSimClient client;
+    client.begin({ 247, 12, 8, 4, 0, 1 });
+    const SimResponse* reply = client.request(BT_CMD_LIST_FILES, listArgs(CATALOG_SORT_SIZE_DESC + 1, 0));
+    REQUIRE(reply);
+    CHECK_EQ(reply->code, BT_RESP_ERROR);
+}
+
+TEST(smallMtuPagesShrinkToFitTheQueue) {
+    hostBootDevice();
+    uint32_t files = fillCard(40, 2025, 2025);
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+
+    // Without the cap a 16-entry page overflows the notify queue at
+    // 20-byte packets and the response ends in an error frame
+    std::set<std::string> seen;
+    ListedPage page;
+    uint32_t requests = 0;
+    do {
+        ListedPage previous = page;
+        REQUIRE(listOverLink(client, listArgs(CATALOG_SORT_SIZE_DESC, 16, requests ? &previous : nullptr),
+                             requests % 2 == 1, page));
+        CHECK(page.names.size() > 0 && page.names.size() < 16);
+        for (const std::string& n : page.names) seen.insert(n);
+        requests++;
+    } while (page.more && requests < 100);
+    CHECK_EQ(seen.size(), files);
+}
+
+TEST(listingResponseSize) {
+    // Benchmark: bytes on air per entry for a page of monthly logs
+    hostBootDevice();
+    fillCard(0, 2024, 2025);
+    printf("  entries   mtu   encoding  frames  bytes  per entry\n");
+    for (uint16_t mtu : { (uint16_t)23, (uint16_t)247 }) {
+        for (bool cbor : { false, true }) {
+            BleSimClient client;
+            client.begin({ mtu, 12, 8, 4, 0, 1 });
+            ListedPage page;
+            REQUIRE(listOverLink(client, listArgs(CATALOG_SORT_TIME_ASC, 16), cbor, page));
+            uint32_t entries = page.names.size();
+            REQUIRE(entries > 0);
+            printf("  %7u  %4u   %-8s  %6u  %5u  %9u\n", entries, mtu, cbor ? "CBOR" : "TLV",
+                   page.frames, page.bytes, page.bytes / entries);
+            CHECK(page.bytes / entries < 80);
+            CHECK(page.frames <= BT_NOTIFY_QUEUE_DEPTH + 8);
+            if (mtu == 247) CHECK_EQ(entries, 16);
+        }
+    }
+}
@@ -0,0 +1,243 @@
+/**
+ * test_gateway.cpp
+ * The gateway role against a simulated apiary of beaconing nodes
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "SimApiary.h"
+#include <string>
+
+#define GATEWAY_ID 100
+#define APIARY_SIZE 20
+
+static std::string readFile(const char* path) {
+    std::string text;
+    SDLib::File f = SD.open(path, FILE_READ);
+    if (!f) return text;
+    int c;
+    while ((c = f.read()) >= 0) text += (char)c;
+    f.close();
+    return text;
+}
+
+// Data lines, without the header
+static int countRows(uint8_t deviceId, const char* file) {
+    char path[32];
+    snprintf(path, sizeof(path), GATEWAY_DIR "/N%03u/%s", deviceId, file);
+    std::string text = readFile(path);
+    int lines = 0;
+    for (char c : text) lines += c == '\n';
+    return lines > 0 ? lines - 1 : 0;
+}
+
+static void startApiary(SimApiary& apiary, uint8_t periodMin, uint32_t seed = 1) {
+    hostBootDevice();
+    apiary.begin(GATEWAY_ID, periodMin, seed);
+    for (uint8_t id = 1; id <= APIARY_SIZE; id++) apiary.addNode(id);
+}
+
+TEST(oneScanCoversTheApiary) {
+    SimApiary apiary;
+    startApiary(apiary, GATEWAY_DEFAULT_PERIOD_MIN);
+    apiary.run(GATEWAY_SCAN_WINDOW_MS / 1000 + 2);
+
+    CHECK_EQ(apiary.gateway.getNeighbourCount(), APIARY_SIZE);
+    for (uint8_t id = 1; id <= APIARY_SIZE; id++) {
+        CHECK(apiary.node(id)->heard >= 2);
+        CHECK_EQ(countRows(id, "SAMPLES.CSV"), 1);
+    }
+    CHECK(!apiary.gateway.isScanning());
+}
+
+TEST(ownBeaconAndOutOfRangeNodesAreNotNeighbours) {
+    SimApiary apiary;
+    hostBootDevice();
+    apiary.begin(GATEWAY_ID, GATEWAY_DEFAULT_PERIOD_MIN);
+    apiary.addNode(1);
+    apiary.addNode(GATEWAY_ID);
+    apiary.addNode(2, BEACON_DEFAULT_INTERVAL_MS, SIM_RSSI_FLOOR - 1);
+    apiary.run(10);
+
+    CHECK_EQ(apiary.gateway.getNeighbourCount(), 1);
+    CHECK(apiary.stats.outOfRange > 0);
+    CHECK(!SD.exists(GATEWAY_DIR "/N100"));
+}
+
+TEST(eachReadingIsFiledOnce) {
+    SimApiary apiary;
+    startApiary(apiary, 15);
+    apiary.run(2 * 3600 + 60);
+
+    // Readings every 10 min, scans every 15: every scan sees a new one,
+    // and its repeats within the window are not filed again
+    for (uint8_t id = 1; id <= APIARY_SIZE; id++) {
+        CHECK_EQ(countRows(id, "SAMPLES.CSV"), 9);
+    }
+}
+
+TEST(silentNeighbourGoesOffline) {
+    SimApiary apiary;
+    startApiary(apiary, 5);
+    apiary.run(60);
+    const GatewayNeighbour* n = apiary.gateway.getNeighbour(0);
+    REQUIRE(n);
+    uint8_t id = n->deviceId;
+    CHECK(apiary.gateway.isOnline(*n, apiary.rtcNow()));
+
+    apiary.node(id)->on = false;
+    apiary.run(GATEWAY_OFFLINE_PERIODS * 5 * 60 + 60);
+    CHECK(!apiary.gateway.isOnline(*n, apiary.rtcNow()));
+    const GatewayNeighbour* other = apiary.gateway.getNeighbour(1);
+    REQUIRE(other);
+    CHECK(apiary.gateway.isOnline(*other, apiary.rtcNow()));
+}
+
+TEST(alertTransitionsAreLogged) {
+    SimApiary apiary;
+    startApiary(apiary, 5);
+    apiary.run(60);
+    SimNode* n = apiary.node(3);
+
+    n->status.alertFlags = 0x04;
+    n->status.counter++;
+    apiary.run(5 * 60);
+    n->status.alertFlags = 0;
+    n->status.counter++;
+    apiary.run(5 * 60);
+
+    CHECK_EQ(countRows(3, "ALERTS.CSV"), 2);
+    std::string alerts = readFile(GATEWAY_DIR "/N003/ALERTS.CSV");
+    CHECK(alerts.find(",4,1") != std::string::npos);
+    CHECK(alerts.find(",4,0") != std::string::npos);
+    CHECK_EQ(countRows(4, "ALERTS.CSV"), 0);
+}
+
+TEST(alertBetweenScansIsFiledFromTheLatch) {
+    SimApiary apiary;
+    startApiary(apiary, 15);
+    apiary.run(60);
+    SimNode* n = apiary.node(3);
+    n->readingPeriodS = 60;
+    n->nextReadingMs = millis() + 1000;
+
+    // Raised for one reading, well inside the gap between two scans
+    n->status.alertFlags = ALERT_SWARM_RISK;
+    apiary.run(60);
+    n->status.alertFlags = 0;
+    apiary.run(120);
+    CHECK(n->latch.isPending());
+    CHECK_EQ(countRows(3, "ALERTS.CSV"), 0);
+
+    // The next scan files the raise and its clear, and the gateway's
+    // beacon clears the latch after a reading or two
+    apiary.run(15 * 60);
+    CHECK_EQ(countRows(3, "ALERTS.CSV"), 2);
+    std::string alerts = readFile(GATEWAY_DIR "/N003/ALERTS.CSV");
+    CHECK(alerts.find("," + std::to_string(ALERT_SWARM_RISK) + ",1") != std::string::npos);
+    CHECK(alerts.find("," + std::to_string(ALERT_SWARM_RISK) + ",0") != std::string::npos);
+    CHECK(!n->latch.isPending());
+    CHECK_EQ(n->acked, 1);
+
+    // The next scan sees the latch cleared: nothing filed twice, no acks
+    apiary.run(15 * 60);
+    CHECK_EQ(countRows(3, "ALERTS.CSV"), 2);
+    CHECK(!apiary.gateway.hasAcks());
+    const GatewayNeighbour* g = nullptr;
+    for (uint8_t i = 0; i < apiary.gateway.getNeighbourCount(); i++) {
+        if (apiary.gateway.getNeighbour(i)->deviceId == 3) g = apiary.gateway.getNeighbour(i);
+    }
+    REQUIRE(g);
+    CHECK_EQ(g->alertRaises, 1);
+    CHECK(g->alertsSeen & ALERT_SWARM_RISK);
+}
+
+TEST(latchHeldWhileTheGatewayIsOutOfReach) {
+    SimApiary apiary;
+    startApiary(apiary, 15);
+    apiary.run(60);
+    SimNode* n = apiary.node(5);
+    int8_t rssi = n->rssi;
+    n->rssi = SIM_RSSI_FLOOR - 1;
+    n->status.alertFlags = ALERT_TEMP_HIGH;
+    n->nextReadingMs = millis() + 1000;
+    apiary.run(60);
+    n->status.alertFlags = 0;
+    apiary.run(2 * 3600);
+
+    // Every reading listened, for the window and no longer
+    CHECK(n->latch.isPending());
+    CHECK_EQ(n->acked, 0);
+    CHECK(n->listenMs >= 12 * (uint64_t)BEACON_ACK_LISTEN_MS);
+    CHECK(n->listenMs <= 13 * (uint64_t)BEACON_ACK_LISTEN_MS);
+
+    n->rssi = rssi;
+    apiary.run(3600);
+    CHECK(!n->latch.isPending());
+    CHECK_EQ(countRows(5, "ALERTS.CSV"), 2);
+}
+
+TEST(manyLatchesAreAcknowledgedInTurns) {
+    SimApiary apiary;
+    startApiary(apiary, 5);
+    apiary.run(60);
+    for (uint8_t id = 1; id <= 2 * BEACON_MAX_ACKS; id++) {
+        apiary.node(id)->status.alertFlags = ALERT_HUMIDITY_HIGH;
+    }
+    apiary.run(3 * 3600);
+
+    for (uint8_t id = 1; id <= APIARY_SIZE; id++) {
+        CHECK_EQ(apiary.node(id)->latch.isPending(), false);
+        CHECK_EQ(countRows(id, "ALERTS.CSV"), id <= 2 * BEACON_MAX_ACKS ? 1 : 0);
+    }
+    CHECK(!apiary.gateway.hasAcks());
+}
+
+TEST(dailySummaryClosesAtMidnight) {
+    SimApiary apiary;
+    startApiary(apiary, 30);
+    apiary.run(13 * 3600);                   // 12:00 to 01:00 the next day
+
+    for (uint8_t id = 1; id <= APIARY_SIZE; id++) {
+        CHECK_EQ(countRows(id, "DAILY.CSV"), 1);
+    }
+    std::string daily = readFile(GATEWAY_DIR "/N001/DAILY.CSV");
+    CHECK(daily.find("1735689600,") != std::string::npos);
+}
+
+TEST(lossyMediumStillCoversApiary) {
+    SimApiary apiary;
+    startApiary(apiary, 15, 9);
+    apiary.lossPermille = 300;
+    apiary.run(3600);
+
+    CHECK(apiary.stats.lost > 0);
+    CHECK_EQ(apiary.gateway.getNeighbourCount(), APIARY_SIZE);
+    for (uint8_t i = 0; i < APIARY_SIZE; i++) {
+        CHECK(apiary.gateway.isOnline(*apiary.gateway.getNeighbour(i), apiary.rtcNow()));
+    }
+}
+
+TEST(gatewayRadioTimeStaysSmall) {
+    SimApiary apiary;
+    startApiary(apiary, GATEWAY_DEFAULT_PERIOD_MIN);
+    apiary.run(24 * 3600);
+
+    // Without alerts neighbours spend nothing extra; the gateway scans a
+    // few seconds per period, which its estimate should match
+    float duty = (float)apiary.stats.scanMs / apiary.stats.elapsedMs;
+    float measuredUa = duty * GATEWAY_SCAN_CURRENT_MA * 1000.0f;
+    float estimateUa = apiary.gateway.estimateScanCurrentUa();
+    printf("  scan duty %.2f%%, %.1f uA (estimate %.1f uA), beacon %.1f uA per node\n",
+           duty * 100, measuredUa, estimateUa,
+           estimateBeaconCurrentUa(BEACON_DEFAULT_INTERVAL_MS, BEACON_PAYLOAD_SIZE));
+    CHECK(duty < 0.01f);
+    CHECK(fabsf(measuredUa - estimateUa) < estimateUa * 0.05f);
+    for (const SimNode& n : apiary.nodes) {
+        // 2 s plus a mean 5 ms advertising delay, gateway or not
+        CHECK(n.advertisements > 43000 && n.advertisements < 43200);
+        CHECK(n.heard < n.advertisements / 100);
+        CHECK_EQ(n.listenMs, 0);
+    }
+    CHECK_EQ(apiary.stats.ackBeacons, 0);
+}
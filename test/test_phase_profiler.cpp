@@ -0,0 +1,341 @@
+/**
+ * test_phase_profiler.cpp
+ * Wake-cycle phase accounting on a fake cycle counter: per-cycle sums,
+ * the remainder in PHASE_OTHER, counter wrap, histogram, energy figures
+ * and the copy kept in internal flash. A BME280 model on the host I2C
+ * bus times the scheduled-wake reading: its conversion runs under the
+ * audio capture, and without a microphone the reading waits for it
+ */
+
+#include "HostTest.h"
+#include "PhaseProfiler.h"
+#include "Sensors.h"
+#include "Settings.h"
+#include <InternalFileSystem.h>
+#include <Wire.h>
+
+// A 64 MHz cycle counter driven by the virtual clock; like the DWT
+// counter it wraps after about 67 s
+#define FAKE_TICKS_PER_US 64
+
+static uint32_t fakeTicks() {
+    return (uint32_t)(hostMicros() * FAKE_TICKS_PER_US);
+}
+
+static void useFakeClock(PhaseProfiler& profiler) {
+    profiler.setClock(fakeTicks, FAKE_TICKS_PER_US);
+}
+
+// One wake as handleScheduledWakeState() times it, ms per phase
+static void runCycle(PhaseProfiler& profiler, uint32_t stabilizeMs, uint32_t audioMs, uint32_t otherMs) {
+    profiler.beginCycle(1735689600UL);
+    profiler.begin(PHASE_STABILIZE);
+    hostAdvanceMillis(stabilizeMs);
+    profiler.begin(PHASE_SENSORS);
+    hostAdvanceMillis(3);
+    profiler.begin(PHASE_AUDIO_CAPTURE);
+    hostAdvanceMillis(audioMs);
+    profiler.begin(PHASE_SENSORS);
+    hostAdvanceMillis(2);
+    profiler.begin(PHASE_FFT);
+    hostAdvanceMillis(40);
+    profiler.end();
+    hostAdvanceMillis(otherMs);
+    profiler.endCycle();
+}
+
+TEST(phasesAddUpWithinACycle) {
+    PhaseProfiler profiler;
+    useFakeClock(profiler);
+    runCycle(profiler, 100, 500, 30);
+
+    CHECK_EQ(profiler.getCycles(), 1);
+    CHECK(!profiler.isInCycle());
+    CHECK_EQ(profiler.getStats(PHASE_STABILIZE).totalUs, 100000);
+    CHECK_EQ(profiler.getStats(PHASE_AUDIO_CAPTURE).totalUs, 500000);
+    CHECK_EQ(profiler.getStats(PHASE_FFT).totalUs, 40000);
+
+    // Entered twice, one sample for the cycle
+    CHECK_EQ(profiler.getStats(PHASE_SENSORS).count, 1);
+    CHECK_EQ(profiler.getStats(PHASE_SENSORS).totalUs, 5000);
+
+    // Time outside every named phase
+    CHECK_EQ(profiler.getStats(PHASE_OTHER).totalUs, 30000);
+
+    // Phases that did not run take no sample
+    CHECK_EQ(profiler.getStats(PHASE_SD_FLUSH).count, 0);
+    CHECK_EQ(profiler.getStats(PHASE_SLEEP).count, 0);
+}
+
+TEST(maximumAndCountAcrossCycles) {
+    PhaseProfiler profiler;
+    useFakeClock(profiler);
+    runCycle(profiler, 100, 500, 10);
+    runCycle(profiler, 300, 500, 10);
+    runCycle(profiler, 200, 500, 10);
+
+    const PhaseStats& s = profiler.getStats(PHASE_STABILIZE);
+    CHECK_EQ(profiler.getCycles(), 3);
+    CHECK_EQ(s.count, 3);
+    CHECK_EQ(s.totalUs, 600000);
+    CHECK_EQ(s.maxUs, 300000);
+}
+
+TEST(phaseCallsOutsideACycleAreIgnored) {
+    PhaseProfiler profiler;
+    useFakeClock(profiler);
+    profiler.begin(PHASE_SENSORS);
+    hostAdvanceMillis(50);
+    profiler.end();
+    profiler.endCycle();
+
+    CHECK_EQ(profiler.getCycles(), 0);
+    CHECK_EQ(profiler.getStats(PHASE_SENSORS).count, 0);
+}
+
+TEST(endCycleClosesTheOpenPhase) {
+    PhaseProfiler profiler;
+    useFakeClock(profiler);
+    profiler.beginCycle(0);
+    profiler.begin(PHASE_SD_FLUSH);
+    hostAdvanceMillis(250);
+    profiler.endCycle();
+
+    CHECK_EQ(profiler.getStats(PHASE_SD_FLUSH).totalUs, 250000);
+    CHECK_EQ(profiler.getStats(PHASE_OTHER).count, 0);
+
+    // A cycle left open is closed by the next one
+    profiler.beginCycle(0);
+    profiler.begin(PHASE_BUFFER);
+    hostAdvanceMillis(5);
+    profiler.beginCycle(0);
+    CHECK_EQ(profiler.getCycles(), 2);
+    CHECK_EQ(profiler.getStats(PHASE_BUFFER).totalUs, 5000);
+}
+
+TEST(longPhaseSurvivesCounterWrap) {
+    PhaseProfiler profiler;
+    useFakeClock(profiler);
+    hostSetMicros(60000000ULL);
+    profiler.beginCycle(0);
+    profiler.begin(PHASE_SD_FLUSH);
+    // Past the 32-bit wrap of a 64 MHz counter
+    hostAdvanceMillis(90000);
+    profiler.endCycle();
+
+    CHECK_EQ(profiler.getStats(PHASE_SD_FLUSH).totalUs, 90000000ULL);
+}
+
+TEST(histogramPercentiles) {
+    PhaseProfiler profiler;
+    for (int i = 0; i < 9; i++) profiler.record(PHASE_FFT, 3000);     // 2-3 ms bucket
+    profiler.record(PHASE_FFT, 900000);                                // 512-1023 ms bucket
+
+    CHECK_EQ(profiler.getStats(PHASE_FFT).histogram[2], 9);
+    CHECK_EQ(profiler.getStats(PHASE_FFT).histogram[10], 1);
+    CHECK_EQ(profiler.getPercentileMs(PHASE_FFT, 50), 4);
+    CHECK_EQ(profiler.getPercentileMs(PHASE_FFT, 90), 4);
+    CHECK_EQ(profiler.getPercentileMs(PHASE_FFT, 100), 1024);
+
+    // Sub-millisecond steps land in the first bucket
+    profiler.record(PHASE_BUFFER, 400);
+    CHECK_EQ(profiler.getStats(PHASE_BUFFER).histogram[0], 1);
+}
+
+TEST(energyFromMeasuredPhases) {
+    PhaseProfiler profiler;
+    useFakeClock(profiler);
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) profiler.setPhaseCurrent((WakePhase)i, 0.0f);
+    profiler.setPhaseCurrent(PHASE_AUDIO_CAPTURE, 10.0f);
+    profiler.setPhaseCurrent(PHASE_SLEEP, 0.1f);
+
+    CHECK(!profiler.hasEnergyData());
+    profiler.beginCycle(0);
+    profiler.begin(PHASE_AUDIO_CAPTURE);
+    hostAdvanceMillis(1000);
+    profiler.endCycle();
+    CHECK(!profiler.hasEnergyData());
+
+    profiler.record(PHASE_SLEEP, 99000000UL);
+    CHECK(profiler.hasEnergyData());
+
+    // 1 s at 10 mA and 99 s at 0.1 mA
+    float expectMa = (10.0f * 1 + 0.1f * 99) / 100.0f;
+    CHECK(fabsf(profiler.getAverageCurrentMa() - expectMa) < 0.001f);
+    CHECK(fabsf(profiler.getMahPerDay() - expectMa * 24.0f) < 0.01f);
+    CHECK(fabsf(profiler.getWakeMah() - 10.0f / 3600.0f) < 1e-6f);
+    CHECK(fabsf(profiler.getPhaseMahPerDay(PHASE_AUDIO_CAPTURE) - 2.4f) < 0.01f);
+}
+
+TEST(profileSavedEveryFewCyclesAndRestored) {
+    PhaseProfiler profiler;
+    useFakeClock(profiler);
+    for (int i = 0; i < PHASE_SAVE_CYCLES - 1; i++) runCycle(profiler, 100, 500, 10);
+    CHECK(!InternalFS.exists(PHASE_PROFILE_FILE));
+    runCycle(profiler, 100, 500, 10);
+    CHECK_EQ(hostFlashFileSize(PHASE_PROFILE_FILE), sizeof(PhaseProfileImage));
+
+    PhaseProfiler restored;
+    restored.begin();
+    CHECK_EQ(restored.getCycles(), PHASE_SAVE_CYCLES);
+    CHECK_EQ(restored.getStats(PHASE_STABILIZE).totalUs, profiler.getStats(PHASE_STABILIZE).totalUs);
+    CHECK_EQ(restored.getFirstTime(), 1735689600UL);
+}
+
+TEST(damagedProfileStartsFresh) {
+    PhaseProfiler profiler;
+    useFakeClock(profiler);
+    runCycle(profiler, 100, 500, 10);
+    profiler.save();
+
+    // Flip a byte in the middle of the stored image
+    Adafruit_LittleFS_Namespace::File file(InternalFS);
+    REQUIRE(file.open(PHASE_PROFILE_FILE, Adafruit_LittleFS_Namespace::FILE_O_WRITE));
+    REQUIRE(file.seek(sizeof(PhaseProfileImage) / 2));
+    uint8_t flipped = (uint8_t)~file.read();
+    file.seek(sizeof(PhaseProfileImage) / 2);
+    file.write(&flipped, 1);
+    file.close();
+
+    PhaseProfiler restored;
+    restored.begin();
+    CHECK_EQ(restored.getCycles(), 0);
+}
+
+// =============================================================================
+// WAKE READING TIMELINE
+// =============================================================================
+
+// BME280 on the bus: a forced conversion started through ctrl_meas runs
+// for FAKE_BME_CONVERSION_US, with the measuring bit set in status
+#define FAKE_BME_CONVERSION_US 16000ULL
+#define BME_REG_STATUS 0xF3
+#define BME_REG_CTRL_MEAS 0xF4
+
+class FakeBme : public HostI2cDevice {
+public:
+    uint8_t ctrlMeas = 0x48;          // X2 temperature and pressure, sleep mode
+    uint8_t pointer = 0;
+    uint32_t conversions = 0;
+    uint64_t startedUs = 0;
+    uint32_t busyReads = 0;           // Status reads that found it measuring
+    uint64_t lastStatusUs = 0;
+    bool stuck = false;
+
+    bool measuring() const {
+        return conversions && (stuck || hostMicros() < startedUs + FAKE_BME_CONVERSION_US);
+    }
+
+    uint8_t address() const override { return 0x77; }
+
+    void receive(const uint8_t* data, size_t len) override {
+        if (len == 0) return;
+        pointer = data[0];
+        if (len > 1 && pointer == BME_REG_CTRL_MEAS) {
+            ctrlMeas = data[1];
+            if ((ctrlMeas & 0x03) == 0x01) {
+                conversions++;
+                startedUs = hostMicros();
+            }
+        }
+    }
+
+    size_t request(uint8_t* out, size_t count) override {
+        if (count == 0) return 0;
+        if (pointer == BME_REG_STATUS) {
+            lastStatusUs = hostMicros();
+            if (measuring()) busyReads++;
+            out[0] = measuring() ? 0x08 : 0x00;
+        } else if (pointer == BME_REG_CTRL_MEAS) {
+            // Back to sleep mode once the conversion is done
+            out[0] = measuring() ? ctrlMeas : (ctrlMeas & ~0x03);
+        } else {
+            out[0] = 0;
+        }
+        return 1;
+    }
+};
+
+extern SystemSettings settings;
+extern SystemStatus systemStatus;
+
+// One scheduled-wake reading on the global profiler, as
+// handleScheduledWakeState() takes it
+static SensorData wakeReading(FakeBme& fake, bool microphone) {
+    Adafruit_BME280 bme;
+    SensorData data = {};
+    settings = getDefaultSettings();
+    systemStatus = {};
+    Wire.device = &fake;
+    initializeSensors(bme, systemStatus);
+    systemStatus.pdmWorking = microphone;
+
+    phaseProfiler = PhaseProfiler();
+    useFakeClock(phaseProfiler);
+    phaseProfiler.beginCycle(1735689600UL);
+    acquireWakeReading(bme, data, settings, systemStatus);
+    phaseProfiler.endCycle();
+    Wire.device = nullptr;
+    return data;
+}
+
+TEST(bmeConvertsWhileAudioIsCaptured) {
+    FakeBme fake;
+    uint64_t start = hostMicros();
+    SensorData data = wakeReading(fake, true);
+
+    CHECK(data.sensorsValid);
+    CHECK_EQ(fake.conversions, 1);
+
+    // Started before the capture, collected after it without waiting
+    CHECK(fake.startedUs - start < 1000);
+    CHECK(fake.lastStatusUs >= fake.startedUs + FAKE_BME_CONVERSION_US);
+    CHECK_EQ(fake.busyReads, 0);
+
+    // The conversion costs the sensor phase nothing
+    CHECK_EQ(phaseProfiler.getStats(PHASE_AUDIO_CAPTURE).count, 1);
+    CHECK(phaseProfiler.getStats(PHASE_AUDIO_CAPTURE).totalUs >= 500000);
+    CHECK(phaseProfiler.getStats(PHASE_SENSORS).totalUs < FAKE_BME_CONVERSION_US);
+}
+
+TEST(withoutMicrophoneFinishWaitsForTheConversion) {
+    FakeBme fake;
+    SensorData data = wakeReading(fake, false);
+
+    // Nothing between begin and finish: the result is read only once
+    // the measuring bit has cleared
+    CHECK(data.sensorsValid);
+    CHECK_EQ(fake.conversions, 1);
+    CHECK(fake.busyReads > 0);
+    CHECK(fake.lastStatusUs >= fake.startedUs + FAKE_BME_CONVERSION_US);
+    CHECK(fabsf(data.temperature - (24.0f + settings.tempOffset)) < 0.01f);
+
+    CHECK_EQ(phaseProfiler.getStats(PHASE_AUDIO_CAPTURE).count, 0);
+    CHECK(phaseProfiler.getStats(PHASE_SENSORS).totalUs >= FAKE_BME_CONVERSION_US);
+    CHECK(phaseProfiler.getStats(PHASE_SENSORS).totalUs < FAKE_BME_CONVERSION_US + 2000);
+}
+
+TEST(conversionThatNeverEndsIsNotAReading) {
+    FakeBme fake;
+    fake.stuck = true;
+    SensorData data = wakeReading(fake, false);
+
+    CHECK(!data.sensorsValid);
+    CHECK_EQ(fake.conversions, 1);
+    CHECK(phaseProfiler.getStats(PHASE_SENSORS).totalUs >= 50000);
+}
+
+TEST(missingBmeIsNotTriggered) {
+    FakeBme fake;
+    Adafruit_BME280 bme;
+    bme.present = false;
+    SensorData data = {};
+    systemStatus = {};
+    Wire.device = &fake;
+    initializeSensors(bme, systemStatus);
+    acquireWakeReading(bme, data, settings, systemStatus);
+    Wire.device = nullptr;
+
+    CHECK(!data.sensorsValid);
+    CHECK_EQ(fake.conversions, 0);
+}
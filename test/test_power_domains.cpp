@@ -0,0 +1,185 @@
+/**
+ * test_power_domains.cpp
+ * Reference counting, parent ordering and sleep state of the power domains
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "PowerDomains.h"
+#include "PowerManager.h"
+#include "EventScheduler.h"
+#include <Wire.h>
+#include <SPI.h>
+#include <vector>
+
+extern SystemSettings settings;
+extern SystemStatus systemStatus;
+
+// Display pin level each time the I2C bus switched, in order
+static std::vector<int> displayPinAtBusChange;
+
+static void recordBusChange(bool enabled) {
+    (void)enabled;
+    displayPinAtBusChange.push_back(hostGetPin(DISPLAY_POWER_PIN));
+}
+
+TEST(domainStaysOnUntilLastClientReleases) {
+    PowerDomainManager m;
+    m.begin();
+    CHECK(!m.isOn(DOMAIN_SD_SPI));
+
+    m.acquire(DOMAIN_SD_SPI, PCLIENT_LOGGER);
+    m.acquire(DOMAIN_SD_SPI, PCLIENT_FLUSH);
+    CHECK(m.isOn(DOMAIN_SD_SPI));
+    CHECK(SPI.enabled);
+
+    m.release(DOMAIN_SD_SPI, PCLIENT_LOGGER);
+    CHECK(m.isOn(DOMAIN_SD_SPI));
+    m.release(DOMAIN_SD_SPI, PCLIENT_FLUSH);
+    CHECK(!m.isOn(DOMAIN_SD_SPI));
+    CHECK(!SPI.enabled);
+    CHECK_EQ(m.getSwitchOns(DOMAIN_SD_SPI), 1);
+}
+
+TEST(acquiringTwiceTakesOneReference) {
+    PowerDomainManager m;
+    m.begin();
+    m.acquire(DOMAIN_MIC_ADC, PCLIENT_AUDIO);
+    m.acquire(DOMAIN_MIC_ADC, PCLIENT_AUDIO);
+    m.release(DOMAIN_MIC_ADC, PCLIENT_AUDIO);
+    CHECK(!m.isOn(DOMAIN_MIC_ADC));
+    CHECK_EQ(m.getClients(DOMAIN_MIC_ADC), 0);
+}
+
+TEST(doubleReleaseDoesNotDropAnotherClient) {
+    PowerDomainManager m;
+    m.begin();
+    m.acquire(DOMAIN_I2C, PCLIENT_SYSTEM);
+    m.acquire(DOMAIN_I2C, PCLIENT_RADIO);
+    m.release(DOMAIN_I2C, PCLIENT_RADIO);
+    m.release(DOMAIN_I2C, PCLIENT_RADIO);
+    m.release(DOMAIN_I2C, PCLIENT_GATEWAY);     // Never acquired
+    CHECK(m.isOn(DOMAIN_I2C));
+    CHECK_EQ(m.getClients(DOMAIN_I2C), PCLIENT_SYSTEM);
+
+    m.release(DOMAIN_I2C, PCLIENT_SYSTEM);
+    CHECK(!m.isOn(DOMAIN_I2C));
+}
+
+TEST(childHoldsParentWhileOn) {
+    PowerDomainManager m;
+    m.begin();
+    m.acquire(DOMAIN_BME280, PCLIENT_SENSORS);
+    CHECK(m.isOn(DOMAIN_I2C));
+    CHECK_EQ(m.getClients(DOMAIN_I2C), 0);
+
+    m.release(DOMAIN_BME280, PCLIENT_SENSORS);
+    CHECK(!m.isOn(DOMAIN_BME280));
+    CHECK(!m.isOn(DOMAIN_I2C));
+}
+
+TEST(parentHeldDirectlyOutlivesChild) {
+    PowerDomainManager m;
+    m.begin();
+    m.acquire(DOMAIN_I2C, PCLIENT_SYSTEM);
+    m.acquire(DOMAIN_DISPLAY, PCLIENT_DISPLAY);
+    m.release(DOMAIN_DISPLAY, PCLIENT_DISPLAY);
+    CHECK(!m.isOn(DOMAIN_DISPLAY));
+    CHECK(m.isOn(DOMAIN_I2C));
+}
+
+TEST(busComesUpBeforeAndGoesDownAfterDisplay) {
+    PowerDomainManager m;
+    m.begin();
+    displayPinAtBusChange.clear();
+    Wire.onChange = recordBusChange;
+
+    m.acquire(DOMAIN_DISPLAY, PCLIENT_DISPLAY);
+    CHECK_EQ(hostGetPin(DISPLAY_POWER_PIN), DISPLAY_POWER_ON);
+    m.release(DOMAIN_DISPLAY, PCLIENT_DISPLAY);
+    CHECK_EQ(hostGetPin(DISPLAY_POWER_PIN), DISPLAY_POWER_OFF);
+    Wire.onChange = nullptr;
+
+    // Bus up while the display was still off, bus down once it was off again
+    REQUIRE(displayPinAtBusChange.size() == 2);
+    CHECK_EQ(displayPinAtBusChange[0], DISPLAY_POWER_OFF);
+    CHECK_EQ(displayPinAtBusChange[1], DISPLAY_POWER_OFF);
+}
+
+TEST(displayGetsItsSettleTime) {
+    PowerDomainManager m;
+    m.begin();
+    unsigned long before = millis();
+    m.acquire(DOMAIN_DISPLAY, PCLIENT_DISPLAY);
+    CHECK(millis() - before >= 50);
+}
+
+TEST(beginSwitchesOffOnlyUnheldDomains) {
+    PowerDomainManager m;
+    m.acquire(DOMAIN_I2C, PCLIENT_SYSTEM);
+    m.release(DOMAIN_I2C, PCLIENT_SYSTEM);
+    CHECK(m.isOn(DOMAIN_I2C));                  // Not managed yet
+    m.acquire(DOMAIN_SD_SPI, PCLIENT_LOGGER);
+
+    m.begin();
+    CHECK_EQ(m.getOnMask(), DOMAIN_BIT(DOMAIN_SD_SPI));
+    CHECK_EQ(m.getSwitchOns(DOMAIN_SD_SPI), 0);
+}
+
+TEST(onTimeAndAverageCurrentFollowTheClock) {
+    PowerDomainManager m;
+    m.begin();
+    hostAdvanceMillis(1000);
+    m.acquire(DOMAIN_RADIO, PCLIENT_RADIO);
+    hostAdvanceMillis(1000);
+    m.release(DOMAIN_RADIO, PCLIENT_RADIO);
+
+    CHECK_EQ(m.getOnMs(DOMAIN_RADIO), 1000);
+    float expected = m.getCurrentMa(DOMAIN_RADIO) / 2;
+    CHECK(fabs(m.getAverageCurrentMa() - expected) < 0.01f);
+    CHECK_EQ((int)(m.getAverageCurrentMa(DOMAIN_BIT(DOMAIN_I2C)) * 1000), 0);
+}
+
+// =============================================================================
+// WAKE CYCLE
+// =============================================================================
+
+static std::vector<uint8_t> maskWhileAsleep;
+
+static void recordSleep(unsigned long ms) {
+    maskWhileAsleep.push_back(powerDomains.getOnMask());
+    hostAdvanceMillis(ms);
+}
+
+TEST(nothingLeftOnWhileAsleepAcrossWakeCycles) {
+    hostBootDevice();
+    settings.fieldModeEnabled = true;
+    powerDomains = PowerDomainManager();
+    maskWhileAsleep.clear();
+    eventScheduler.setClock(nullptr, recordSleep);
+
+    PowerManager pm;
+    pm.initialize(&systemStatus, &settings);
+    powerDomains.begin();
+
+    // Timer wake: a reading, then straight back to sleep
+    pm.enterFieldSleep();
+    pm.powerUpSensors();
+    pm.powerUpAudio();
+    pm.powerDownAudio();
+    pm.powerDownSensors();
+
+    // Button wake: dashboard and radio up, then the display times out
+    pm.enterFieldSleep();
+    pm.wakeFromFieldSleep();
+    CHECK(powerDomains.isOn(DOMAIN_DISPLAY));
+    CHECK(powerDomains.isOn(DOMAIN_RADIO));
+    pm.enterFieldSleep();
+
+    eventScheduler.setClock(nullptr, nullptr);
+    REQUIRE(maskWhileAsleep.size() >= 3);
+    for (uint8_t mask : maskWhileAsleep) CHECK_EQ(mask, 0);
+
+    // The loop takes the bus back as soon as it wakes
+    CHECK_EQ(powerDomains.getOnMask(), DOMAIN_BIT(DOMAIN_I2C));
+}
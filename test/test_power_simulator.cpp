@@ -0,0 +1,288 @@
+/**
+ * test_power_simulator.cpp
+ * Step-wise simulation and the SIMULATE_POWER job over a simulated link.
+ * The projection is checked against the firmware itself: PowerManager
+ * plans and sleeps through each wake on a virtual RTC, with the interval
+ * from adaptiveInterval.update(), and must wake as often and at the same
+ * times as the simulation says
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "BleDecoder.h"
+#include "BleProtocol.h"
+#include "PowerSimulator.h"
+#include "PowerManager.h"
+#include "AdaptiveInterval.h"
+#include "EventScheduler.h"
+#include <RTClib.h>
+
+#define TEST_START 1735689600UL          // 2025-01-01 00:00:00
+
+// [days u8][intervalS u32][tempC i8][startPct u8]
+static std::vector<uint8_t> simulateArgs(uint8_t days, uint32_t intervalS) {
+    return { days, (uint8_t)intervalS, (uint8_t)(intervalS >> 8), (uint8_t)(intervalS >> 16),
+             (uint8_t)(intervalS >> 24), 20, 100 };
+}
+
+TEST(stepwiseRunMatchesSingleRun) {
+    SimConfig config = { 40, 600, 5.0f, 1.0f };
+    PowerSimulator whole;
+    SimResult expected = whole.run(config, TEST_START, 10);
+
+    PowerSimulator stepped;
+    stepped.begin(config, TEST_START, 10);
+    int steps = 0;
+    while (!stepped.step(SIM_DAYS_PER_STEP)) steps++;
+    const SimResult& r = stepped.getResult();
+
+    CHECK_EQ(steps + 1, 40 / SIM_DAYS_PER_STEP);
+    CHECK(!stepped.isRunning());
+    CHECK_EQ(r.days, expected.days);
+    CHECK_EQ(r.wakes, expected.wakes);
+    CHECK_EQ(r.flushes, expected.flushes);
+    CHECK(r.totalMah == expected.totalMah);
+    CHECK(r.daysToEmpty == expected.daysToEmpty);
+    CHECK(memcmp(r.socByDay, expected.socByDay, sizeof(r.socByDay)) == 0);
+}
+
+TEST(wakeCountFollowsInterval) {
+    SimConfig config = { 10, 600, 20.0f, 1.0f };
+    PowerSimulator sim;
+    const SimResult& r = sim.run(config, TEST_START, 10);
+    CHECK_EQ(r.intervalS, 600);
+    CHECK(r.wakes >= 10 * 144 - 1 && r.wakes <= 10 * 144);
+    CHECK(r.flushes >= 10 * 24 - 1);
+    CHECK(r.socByDay[0] == 100);
+    CHECK(r.socByDay[10] < r.socByDay[0]);
+}
+
+TEST(resultReachesClientWholeOnSmallMtu) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+    const SimResponse* reply = client.request(BT_CMD_SIMULATE_POWER, simulateArgs(30, 600), 2, 5000);
+    REQUIRE(reply);
+    CHECK_EQ(reply->code, BT_RESP_OK);
+    CHECK(!reply->seqError);
+    CHECK(reply->frames > BT_NOTIFY_QUEUE_DEPTH);
+
+    BleFields fields;
+    REQUIRE(decodeTlv(reply->payload, "PS", fields));
+    const BleValue* days = findField(fields, BT_PS_days);
+    const BleValue* curve = findField(fields, BT_PS_curve);
+    const BleValue* phases = findField(fields, BT_PS_phases);
+    REQUIRE(days && curve && phases);
+    CHECK_EQ(days->scalar, 30);
+    CHECK_EQ(curve->records.size(), 31);
+    CHECK_EQ(phases->records.size(), PHASE_COUNT);
+    CHECK(!powerSimulator.isRunning());
+}
+
+TEST(cborResultMatchesTlv) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 12, 8, 4, 0, 1 });
+    const SimResponse* tlv = client.request(BT_CMD_SIMULATE_POWER, simulateArgs(20, 300), 2, 5000);
+    REQUIRE(tlv);
+    BleFields tlvFields;
+    REQUIRE(decodeTlv(tlv->payload, "PS", tlvFields));
+
+    uint8_t requestId = client.send(BT_CMD_SIMULATE_POWER, simulateArgs(20, 300), BT_REQ_FLAG_CBOR);
+    REQUIRE(client.runUntil([&] { return client.responseCount(requestId) == 2; }, 5000));
+    BleFields cborFields;
+    REQUIRE(decodeCbor(client.lastResponse(requestId)->payload, cborFields));
+
+    const uint8_t compared[] = { BT_PS_curve, BT_PS_days, BT_PS_intervalS, BT_PS_wakes,
+                                 BT_PS_flushes, BT_PS_totalMah, BT_PS_usableMah };
+    for (uint8_t tag : compared) {
+        const BleValue* a = findField(tlvFields, tag);
+        const BleValue* b = findField(cborFields, tag);
+        REQUIRE(a && b);
+        CHECK(*a == *b);
+    }
+}
+
+TEST(secondSimulationWhileRunningIsBusy) {
+    hostBootDevice();
+    BleSimClient client;
+    client.begin({ 247, 24, 8, 4, 0, 1 });
+    uint8_t first = client.send(BT_CMD_SIMULATE_POWER, simulateArgs(SIM_MAX_DAYS, 600));
+    REQUIRE(client.runUntil([&] { return client.responseCount(first) == 1; }, 1000));
+    CHECK(powerSimulator.isRunning());
+
+    const SimResponse* second = client.request(BT_CMD_SIMULATE_POWER, simulateArgs(10, 600));
+    REQUIRE(second);
+    CHECK_EQ(second->code, BT_RESP_BUSY);
+    CHECK(client.runUntil([&] { return client.responseCount(first) == 2; }, 20000));
+}
+
+// =============================================================================
+// AGAINST THE FIRMWARE
+// =============================================================================
+
+extern SystemSettings settings;
+extern SystemStatus systemStatus;
+extern RTC_PCF8523 rtc;
+
+static PowerManager* sleeping;
+
+// System ON sleep until the PCF8523 raises INT at the planned wake, on
+// the second boundary as the alarm does
+static void rtcSleep(unsigned long ms) {
+    hostSetPin(RTC_INT_PIN, HIGH);
+    uint32_t now = rtc.now().unixtime();
+    uint32_t target = sleeping->getPowerStatus().nextWakeTime;
+    unsigned long untilAlarm = (target - now) * 1000UL - (unsigned long)(hostMicros() / 1000 % 1000);
+    if (target <= now || untilAlarm > ms) {
+        hostAdvanceMillis(ms);
+        return;
+    }
+    hostAdvanceMillis(untilAlarm);
+    hostSetPin(RTC_INT_PIN, LOW);
+    hostFireInterrupt(RTC_INT_PIN);
+}
+
+struct FieldRun {
+    uint32_t start;
+    uint32_t wakes;
+    uint32_t flushes;
+    uint32_t nextWake;           // Planned after the last wake of the run
+    uint8_t lastInterval;
+};
+
+// The field loop for days: each wake takes the simulator's default phase
+// costs, flushes as handleScheduledWakeState() does, then lets the
+// adaptive interval and the power manager plan and sleep to the next one
+static FieldRun runField(uint16_t days, const AudioAnalysisResult& audio) {
+    PowerManager pm;
+    settings.fieldModeEnabled = true;
+    pm.initialize(&systemStatus, &settings);
+    sleeping = &pm;
+    eventScheduler.begin();
+    eventScheduler.setClock(nullptr, rtcSleep);
+
+    uint32_t wakeMs = 0;
+    for (uint8_t i = 0; i < PHASE_COUNT; i++) {
+        if (i != PHASE_SD_FLUSH && i != PHASE_SLEEP) wakeMs += PowerSimulator::getDefaultPhaseUs(i) / 1000;
+    }
+    uint32_t flushMs = PowerSimulator::getDefaultPhaseUs(PHASE_SD_FLUSH) / 1000;
+
+    FieldRun run = {};
+    run.start = rtc.now().unixtime();
+    uint32_t end = run.start + days * 86400UL;
+    SensorData data = {};
+    uint8_t buffered = 0;
+
+    pm.updateNextWakeTime(pm.getWakeIntervalS());
+    while (pm.getPowerStatus().nextWakeTime < end) {
+        pm.enterFieldSleep();
+        if (pm.getPowerStatus().lastWakeSource != WAKE_RTC) break;
+        run.wakes++;
+
+        hostAdvanceMillis(wakeMs);
+        if (++buffered >= MAX_BUFFERED_READINGS || pm.isTimeForBufferFlush()) {
+            pm.noteBufferFlush();
+            hostAdvanceMillis(flushMs);
+            buffered = 0;
+            run.flushes++;
+        }
+
+        run.lastInterval = adaptiveInterval.update(data, &audio, 90, rtc.now().unixtime(),
+                                                   settings.logInterval);
+        pm.clearWakeSource();
+        pm.updateNextWakeTime(wakeSchedule.getIntervalS(run.lastInterval * 60UL));
+    }
+    run.nextWake = pm.getPowerStatus().nextWakeTime;
+
+    eventScheduler.setClock(nullptr, nullptr);
+    sleeping = nullptr;
+    return run;
+}
+
+static AudioAnalysisResult activity(float increase) {
+    AudioAnalysisResult audio = {};
+    audio.analysisValid = true;
+    audio.activityIncrease = increase;
+    return audio;
+}
+
+static void checkAgainstSimulation(const FieldRun& run, uint16_t days, uint8_t logIntervalMin) {
+    SimConfig config = { days, 0, 20.0f, 1.0f };
+    PowerSimulator sim;
+    const SimResult& r = sim.run(config, run.start, logIntervalMin);
+    CHECK_EQ(r.wakes, run.wakes);
+    CHECK_EQ(r.flushes, run.flushes);
+    CHECK_EQ(sim.getNextWake(), run.nextWake);
+}
+
+TEST(firmwareWakesAsSimulatedOnAlignedSlots) {
+    hostBootDevice();
+    FieldRun run = runField(2, activity(1.3f));
+    CHECK_EQ(run.wakes, 2 * 144 - 1);
+    checkAgainstSimulation(run, 2, settings.logInterval);
+}
+
+TEST(firmwareWakesAsSimulatedOnRelativeIntervals) {
+    // Each wake counts from the end of the last, so any difference in
+    // how long a wake takes adds up over the day
+    hostBootDevice();
+    wakeSchedule.configure(90, WAKE_MODE_RELATIVE, 0);
+    FieldRun run = runField(1, activity(1.3f));
+    CHECK(run.wakes > 900);
+    checkAgainstSimulation(run, 1, settings.logInterval);
+    wakeSchedule = WakeSchedule();
+}
+
+TEST(adaptiveStepHeldByNormalActivityIsSimulated) {
+    // An elevated reading before the run puts the interval on 5 min;
+    // normal activity afterwards holds it, as the simulation assumes
+    hostBootDevice();
+    adaptiveInterval.configure(true, 0, 1);
+    adaptiveInterval.update(SensorData(), nullptr, 90, 0, settings.logInterval);
+    AudioAnalysisResult elevated = activity(1.6f);
+    REQUIRE(adaptiveInterval.update(SensorData(), &elevated, 90, 0, settings.logInterval) == 5);
+
+    uint8_t step = adaptiveInterval.getInterval(settings.logInterval);
+    FieldRun run = runField(1, activity(1.3f));
+    CHECK_EQ(run.lastInterval, 5);
+    CHECK_EQ(run.wakes, 287);
+    checkAgainstSimulation(run, 1, step);
+    adaptiveInterval = AdaptiveInterval();
+}
+
+TEST(calmHiveWakesLessThanSimulated) {
+    // Hive activity is not simulated: a calm hive slows back to the base
+    // interval, so the projection from a fast step is the upper bound
+    hostBootDevice();
+    adaptiveInterval.configure(true, 0, 1);
+    AudioAnalysisResult elevated = activity(1.6f);
+    REQUIRE(adaptiveInterval.update(SensorData(), &elevated, 90, 0, settings.logInterval) == 5);
+
+    uint8_t step = adaptiveInterval.getInterval(settings.logInterval);
+    FieldRun run = runField(1, activity(1.0f));
+    CHECK_EQ(run.lastInterval, settings.logInterval);
+
+    SimConfig config = { 1, 0, 20.0f, 1.0f };
+    PowerSimulator sim;
+    CHECK(run.wakes < sim.run(config, run.start, step).wakes);
+    CHECK(run.wakes > sim.run(config, run.start, settings.logInterval).wakes);
+    adaptiveInterval = AdaptiveInterval();
+}
+
+TEST(configuredIntervalTakesPrecedenceOverAdaptiveStep) {
+    // With a wake schedule interval set, the adaptive step changes nothing
+    hostBootDevice();
+    adaptiveInterval.configure(true, 0, 1);
+    AudioAnalysisResult elevated = activity(1.6f);
+    REQUIRE(adaptiveInterval.update(SensorData(), &elevated, 90, 0, settings.logInterval) == 5);
+    wakeSchedule.configure(1800, WAKE_MODE_ALIGNED, 0);
+
+    FieldRun run = runField(1, activity(1.3f));
+    CHECK_EQ(run.lastInterval, 5);
+    CHECK_EQ(run.wakes, 47);
+    checkAgainstSimulation(run, 1, settings.logInterval);
+    wakeSchedule = WakeSchedule();
+    adaptiveInterval = AdaptiveInterval();
+}
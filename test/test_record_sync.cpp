@@ -0,0 +1,290 @@
+/**
+ * test_record_sync.cpp
+ * Record journal numbering, per-client cursors and interrupted syncs
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "Bluetooth.h"
+#include "RecordStore.h"
+#include "Utils.h"
+#include <SD.h>
+
+// The sync state outlives the card between tests, as internal flash
+// would, so each test uses its own client ids
+static std::vector<uint8_t> clientId(const char* name) {
+    std::vector<uint8_t> id(SYNC_CLIENT_ID_LEN, 0);
+    memcpy(id.data(), name, min(strlen(name), (size_t)SYNC_CLIENT_ID_LEN));
+    return id;
+}
+
+static std::vector<uint8_t> syncArgs(const std::vector<uint8_t>& id, uint32_t cursor) {
+    std::vector<uint8_t> args = id;
+    args.resize(SYNC_CLIENT_ID_LEN + 4);
+    putU32LE(&args[SYNC_CLIENT_ID_LEN], cursor);
+    return args;
+}
+
+struct SyncRun {
+    std::vector<StoredRecord> records;
+    uint32_t firstSeq;           // From the start reply
+    uint32_t lastSeq;
+    uint32_t count;
+    uint32_t endCursor;
+    uint32_t endRecords;
+    bool crcOk;
+    bool complete;
+};
+
+// Runs one SYNC_START; with stopAfter set the link drops after that many
+// data packets, as when the phone walks out of range
+static bool runSync(BleSimClient& client, const std::vector<uint8_t>& id, uint32_t cursor,
+                    SyncRun& out, uint32_t stopAfter = 0) {
+    out = SyncRun();
+    size_t from = client.packets.size();
+    const SimResponse* reply = client.request(BT_CMD_SYNC_START, syncArgs(id, cursor));
+    if (!reply || reply->code != BT_RESP_OK || reply->payload.size() != 13) return false;
+    out.firstSeq = getU32LE(&reply->payload[0]);
+    out.lastSeq = getU32LE(&reply->payload[4]);
+    out.count = getU32LE(&reply->payload[8]);
+
+    uint32_t crc = 0;
+    uint32_t dataPackets = 0;
+    size_t next = from;
+    bool ended = client.runUntil([&] {
+        for (; next < client.packets.size(); next++) {
+            const std::vector<uint8_t>& p = client.packets[next].data;
+            if (p[0] == BT_RESP_SYNC_END) {
+                out.endCursor = getU32LE(&p[2]);
+                out.endRecords = getU32LE(&p[6]);
+                out.crcOk = getU32LE(&p[10]) == crc;
+                out.complete = true;
+                return true;
+            }
+            if (p[0] != BT_RESP_SYNC_DATA) continue;
+            CHECK_EQ(p.size(), BT_SYNC_HEADER_SIZE + p[2] * RECORD_SIZE);
+            crc = crc32Update(crc, &p[BT_SYNC_HEADER_SIZE], p.size() - BT_SYNC_HEADER_SIZE);
+            for (uint8_t i = 0; i < p[2]; i++) {
+                StoredRecord r;
+                if (RecordStore::decode(&p[BT_SYNC_HEADER_SIZE + i * RECORD_SIZE], r)) out.records.push_back(r);
+            }
+            if (stopAfter && ++dataPackets >= stopAfter) return true;
+        }
+        return false;
+    });
+    if (!out.complete && stopAfter) client.disconnect();
+    return ended;
+}
+
+static uint32_t commit(BleSimClient& client, const std::vector<uint8_t>& id, uint32_t cursor) {
+    const SimResponse* reply = client.request(BT_CMD_SYNC_COMMIT, syncArgs(id, cursor));
+    return reply ? reply->code : 0xFF;
+}
+
+// =============================================================================
+// JOURNAL
+// =============================================================================
+
+TEST(recordRoundTripsAndCheckCatchesDamage) {
+    StoredRecord r = { 42, 1735732800, -3.25f, 61.5f, 1009.3f, 3.912f, 245, 37, 2, 0x05, 0x01 };
+    uint8_t bytes[RECORD_SIZE];
+    RecordStore::encode(r, bytes);
+    StoredRecord back;
+    REQUIRE(RecordStore::decode(bytes, back));
+    CHECK_EQ(back.seq, 42);
+    CHECK_EQ(back.timestamp, 1735732800);
+    CHECK_EQ(lroundf(back.temperature * 100), -325);
+    CHECK_EQ(lroundf(back.pressure * 10), 10093);
+    CHECK_EQ(lroundf(back.batteryVoltage * 1000), 3912);
+    CHECK_EQ(back.dominantFreq, 245);
+    CHECK_EQ(back.alertFlags, 0x05);
+
+    bytes[9] ^= 0x10;
+    CHECK(!RecordStore::decode(bytes, back));
+}
+
+TEST(appendsNumberConsecutively) {
+    hostBootDevice();
+    hostAppendRecords(100);
+    uint32_t first = recordStore.getFirstSeq();
+    CHECK_EQ(recordStore.getLastSeq(), first + 99);
+    CHECK_EQ(recordStore.countAfter(0), 100);
+    CHECK_EQ(recordStore.countAfter(first + 89), 10);
+    CHECK_EQ(recordStore.countAfter(first + 99), 0);
+    CHECK_EQ(hostSdFileSize(RECORD_STORE_FILE), RECORD_HEADER_SIZE + 100 * RECORD_SIZE);
+}
+
+TEST(tornAppendPaddedAndSkipped) {
+    hostBootDevice();
+    hostAppendRecords(5);
+    uint32_t first = recordStore.getFirstSeq();
+    SDLib::File file = SD.open(RECORD_STORE_FILE, FILE_WRITE);
+    uint8_t half[10] = { 0 };
+    file.write(half, sizeof(half));
+    file.close();
+
+    recordStore.invalidate();               // Next boot
+    hostAppendRecords(5);
+    CHECK_EQ(recordStore.getLastSeq(), first + 10);
+    CHECK_EQ(hostSdFileSize(RECORD_STORE_FILE), RECORD_HEADER_SIZE + 11 * RECORD_SIZE);
+
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    SyncRun run;
+    REQUIRE(runSync(client, clientId("torn"), 0, run));
+    CHECK_EQ(run.records.size(), 10);
+    CHECK_EQ(run.records[4].seq, first + 4);
+    CHECK_EQ(run.records[5].seq, first + 6);
+    CHECK_EQ(run.endCursor, first + 10);
+    CHECK(run.crcOk);
+}
+
+TEST(numberingSurvivesDeletedJournal) {
+    hostBootDevice();
+    hostAppendRecords(20);
+    uint32_t last = recordStore.getLastSeq();
+    REQUIRE(recordStore.commitClientCursor(clientId("deleted").data(), last, 1000));
+
+    SD.remove(RECORD_STORE_FILE);
+    recordStore.invalidate();
+    hostAppendRecords(3);
+    CHECK_EQ(recordStore.getFirstSeq(), last + 1);
+    CHECK_EQ(recordStore.countAfter(recordStore.getClientCursor(clientId("deleted").data())), 3);
+}
+
+// =============================================================================
+// CLIENT CURSORS
+// =============================================================================
+
+TEST(clientsKeepIndependentCursors) {
+    hostBootDevice();
+    hostAppendRecords(30);
+    uint32_t first = recordStore.getFirstSeq();
+    std::vector<uint8_t> a = clientId("phoneA"), b = clientId("phoneB");
+    REQUIRE(recordStore.commitClientCursor(a.data(), first + 19, 2000));
+    REQUIRE(recordStore.commitClientCursor(b.data(), first + 4, 2001));
+    CHECK_EQ(recordStore.getClientCursor(a.data()), first + 19);
+    CHECK_EQ(recordStore.getClientCursor(b.data()), first + 4);
+    CHECK_EQ(recordStore.getClientCursor(clientId("stranger").data()), 0);
+    CHECK(!recordStore.commitClientCursor(a.data(), first + 30, 2002));
+    CHECK_EQ(recordStore.getClientCursor(a.data()), first + 19);
+}
+
+TEST(newClientEvictsLeastRecentlySynced) {
+    hostBootDevice();
+    hostAppendRecords(10);
+    uint32_t first = recordStore.getFirstSeq();
+    const char* names[] = { "evict0", "evict1", "evict2", "evict3" };
+    for (uint32_t i = 0; i < SYNC_MAX_CLIENTS; i++) {
+        REQUIRE(recordStore.commitClientCursor(clientId(names[i]).data(), first + i, 5000 + i));
+    }
+    REQUIRE(recordStore.commitClientCursor(clientId("evict4").data(), first + 9, 6000));
+    CHECK_EQ(recordStore.getClientCursor(clientId("evict0").data()), 0);
+    CHECK_EQ(recordStore.getClientCursor(clientId("evict1").data()), first + 1);
+    CHECK_EQ(recordStore.getClientCursor(clientId("evict4").data()), first + 9);
+}
+
+// =============================================================================
+// SYNC OVER THE LINK
+// =============================================================================
+
+TEST(fullSyncDeliversEveryRecordOnce) {
+    hostBootDevice();
+    hostAppendRecords(500);
+    uint32_t first = recordStore.getFirstSeq();
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    SyncRun run;
+    REQUIRE(runSync(client, clientId("full"), 0, run));
+    CHECK_EQ(run.count, 500);
+    CHECK_EQ(run.firstSeq, first);
+    REQUIRE(run.records.size() == 500);
+    for (uint32_t i = 0; i < 500; i++) CHECK_EQ(run.records[i].seq, first + i);
+    CHECK_EQ(run.endCursor, first + 499);
+    CHECK_EQ(run.endRecords, 500);
+    CHECK(run.crcOk);
+}
+
+TEST(interruptedSyncsResumeWithoutGapsOrDuplicates) {
+    hostBootDevice();
+    hostAppendRecords(1000);
+    uint32_t first = recordStore.getFirstSeq();
+    std::vector<uint8_t> id = clientId("walker");
+    BleSimClient client;
+
+    // The phone keeps what it received and resumes from the last record,
+    // dropping out after a different number of packets each time
+    std::vector<uint32_t> held;
+    uint32_t cursor = 0;
+    uint32_t attempts = 0;
+    for (uint32_t cut = 3; attempts < 20; cut += 4, attempts++) {
+        client.begin({ 247, 6, 8, 4, 0, 1 });
+        SyncRun run;
+        REQUIRE(runSync(client, id, cursor, run, cut));
+        for (const StoredRecord& r : run.records) held.push_back(r.seq);
+        if (!run.records.empty()) cursor = run.records.back().seq;
+        if (run.complete) {
+            CHECK_EQ(run.endCursor, cursor);
+            break;
+        }
+    }
+    CHECK(attempts > 3);
+    REQUIRE(held.size() == 1000);
+    for (uint32_t i = 0; i < 1000; i++) CHECK_EQ(held[i], first + i);
+
+    // Nothing is committed until the phone says so
+    CHECK_EQ(recordStore.getClientCursor(id.data()), 0);
+    CHECK_EQ(commit(client, id, cursor), BT_RESP_OK);
+    CHECK_EQ(recordStore.getClientCursor(id.data()), first + 999);
+}
+
+TEST(storedCursorSyncsOnlyNewRecords) {
+    hostBootDevice();
+    hostAppendRecords(50);
+    std::vector<uint8_t> a = clientId("storedA"), b = clientId("storedB");
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    SyncRun run;
+    REQUIRE(runSync(client, a, 0, run));
+    REQUIRE(commit(client, a, run.endCursor) == BT_RESP_OK);
+
+    hostAppendRecords(7);
+    REQUIRE(runSync(client, a, SYNC_CURSOR_STORED, run));
+    CHECK_EQ(run.records.size(), 7);
+    CHECK(run.crcOk);
+
+    // The other phone never synced and still gets everything
+    REQUIRE(runSync(client, b, SYNC_CURSOR_STORED, run));
+    CHECK_EQ(run.records.size(), 57);
+}
+
+TEST(commitBeyondLastRecordRefused) {
+    hostBootDevice();
+    hostAppendRecords(5);
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    CHECK_EQ(commit(client, clientId("ahead"), recordStore.getLastSeq() + 1), BT_RESP_ERROR);
+}
+
+TEST(syncNeedsRoomForOneRecord) {
+    hostBootDevice();
+    hostAppendRecords(5);
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+    const SimResponse* reply = client.request(BT_CMD_SYNC_START, syncArgs(clientId("small"), 0));
+    REQUIRE(reply);
+    CHECK_EQ(reply->code, BT_RESP_TOO_LARGE);
+}
+
+TEST(emptySyncEndsAtOnce) {
+    hostBootDevice();
+    hostAppendRecords(5);
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+    SyncRun run;
+    REQUIRE(runSync(client, clientId("empty"), recordStore.getLastSeq(), run));
+    CHECK_EQ(run.count, 0);
+    CHECK_EQ(run.endRecords, 0);
+    CHECK_EQ(run.endCursor, recordStore.getLastSeq());
+}
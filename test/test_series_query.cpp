@@ -0,0 +1,347 @@
+/**
+ * test_series_query.cpp
+ * Bucket aggregation and encoding, and QUERY_SERIES over a simulated link
+ * checked against the same aggregation run over the journal directly
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "Bluetooth.h"
+#include "RecordStore.h"
+#include "SeriesQuery.h"
+#include "Utils.h"
+#include <RTClib.h>
+#include <SD.h>
+
+extern RTC_PCF8523 rtc;
+
+#define T0 1735689600UL                  // 2025-01-01 00:00:00
+#define ALL_FIELDS 0x3F
+#define ALL_AGGS (SERIES_AGG_MIN | SERIES_AGG_MAX | SERIES_AGG_MEAN | SERIES_AGG_COUNT)
+
+static StoredRecord makeRecord(uint32_t timestamp, float temperature, uint8_t flags = RECORD_FLAG_SENSORS_VALID) {
+    StoredRecord r = {};
+    r.timestamp = timestamp;
+    r.temperature = temperature;
+    r.humidity = 60.0f;
+    r.pressure = 1013.2f;
+    r.batteryVoltage = 3.85f;
+    r.dominantFreq = 250;
+    r.soundLevel = 40;
+    r.flags = flags;
+    return r;
+}
+
+static int16_t getI16LE(const uint8_t* p) {
+    return (int16_t)getU16LE(p);
+}
+
+// =============================================================================
+// QUERY SHAPE
+// =============================================================================
+
+TEST(validationRejectsUnanswerableQueries) {
+    SeriesQuery q = { T0, T0 + 86400, 3600, SERIES_FIELD_TEMPERATURE, SERIES_AGG_MEAN };
+    CHECK(validateSeriesQuery(q));
+
+    SeriesQuery empty = q;
+    empty.toTime = empty.fromTime;
+    CHECK(!validateSeriesQuery(empty));
+
+    SeriesQuery fine = q;
+    fine.bucketSeconds = SERIES_MIN_BUCKET_SECONDS - 1;
+    CHECK(!validateSeriesQuery(fine));
+
+    SeriesQuery noFields = q;
+    noFields.fieldMask = 0;
+    CHECK(!validateSeriesQuery(noFields));
+    noFields.aggMask = SERIES_AGG_COUNT;
+    CHECK(validateSeriesQuery(noFields));
+
+    SeriesQuery noAggs = q;
+    noAggs.aggMask = 0;
+    CHECK(!validateSeriesQuery(noAggs));
+
+    // One bucket too many for the u16 index
+    SeriesQuery tooLong = q;
+    tooLong.bucketSeconds = 60;
+    tooLong.toTime = T0 + (SERIES_MAX_BUCKETS + 1) * 60UL;
+    CHECK(!validateSeriesQuery(tooLong));
+    tooLong.toTime -= 60;
+    CHECK(validateSeriesQuery(tooLong));
+}
+
+TEST(bucketCountAndSize) {
+    SeriesQuery q = { T0, T0 + 86400, 3600, SERIES_FIELD_TEMPERATURE, SERIES_AGG_MEAN };
+    CHECK_EQ(seriesBucketCount(q), 24);
+    q.toTime += 1;
+    CHECK_EQ(seriesBucketCount(q), 25);
+
+    CHECK_EQ(seriesBucketSize(q), 2 + 2);
+    q.aggMask = ALL_AGGS;
+    q.fieldMask = SERIES_FIELD_TEMPERATURE | SERIES_FIELD_BATTERY;
+    CHECK_EQ(seriesBucketSize(q), 2 + 2 + 2 * 6);
+    q.fieldMask = ALL_FIELDS;
+    CHECK_EQ(seriesBucketSize(q), 2 + 2 + 6 * 6);
+}
+
+TEST(fieldsInJournalUnits) {
+    StoredRecord r = makeRecord(T0, -3.456f);
+    CHECK_EQ(seriesFieldValue(r, SERIES_FIELD_TEMPERATURE), -346);
+    CHECK_EQ(seriesFieldValue(r, SERIES_FIELD_HUMIDITY), 6000);
+    CHECK_EQ(seriesFieldValue(r, SERIES_FIELD_PRESSURE), 10132);
+    CHECK_EQ(seriesFieldValue(r, SERIES_FIELD_BATTERY), 3850);
+    CHECK_EQ(seriesFieldValue(r, SERIES_FIELD_FREQUENCY), 250);
+    CHECK_EQ(seriesFieldValue(r, SERIES_FIELD_SOUND_LEVEL), 40);
+}
+
+// =============================================================================
+// AGGREGATION
+// =============================================================================
+
+TEST(recordsFoldIntoBuckets) {
+    SeriesAggregator agg;
+    agg.begin({ T0, T0 + 3 * 3600, 3600, SERIES_FIELD_TEMPERATURE, ALL_AGGS });
+    SeriesBucket closed;
+
+    CHECK(!agg.add(makeRecord(T0 + 60, 20.0f), closed));
+    CHECK(!agg.add(makeRecord(T0 + 1800, 22.0f), closed));
+    CHECK(!agg.add(makeRecord(T0 + 3599, 24.5f), closed));
+
+    // Crossing into the next hour hands out the first one
+    REQUIRE(agg.add(makeRecord(T0 + 3600, 30.0f), closed));
+    CHECK_EQ(closed.index, 0);
+    CHECK_EQ(closed.count, 3);
+    CHECK_EQ(closed.minValue[0], 2000);
+    CHECK_EQ(closed.maxValue[0], 2450);
+    CHECK_EQ(closed.sum[0], 2000 + 2200 + 2450);
+
+    // Hour 2 has nothing; the jump to hour 3 closes hour 1 only
+    REQUIRE(agg.add(makeRecord(T0 + 2 * 3600 + 5, 31.0f), closed));
+    CHECK_EQ(closed.index, 1);
+    CHECK_EQ(closed.count, 1);
+
+    REQUIRE(agg.finish(closed));
+    CHECK_EQ(closed.index, 2);
+    CHECK(!agg.finish(closed));
+    CHECK_EQ(agg.getRecordsUsed(), 5);
+}
+
+TEST(recordsOutsideTheQueryAreIgnored) {
+    SeriesAggregator agg;
+    agg.begin({ T0, T0 + 7200, 3600, SERIES_FIELD_TEMPERATURE, ALL_AGGS });
+    SeriesBucket closed;
+
+    CHECK(!agg.add(makeRecord(T0 - 1, 99.0f), closed));
+    CHECK(!agg.add(makeRecord(T0 + 7200, 99.0f), closed));
+    CHECK(!agg.add(makeRecord(T0 + 10, 99.0f, 0), closed));        // Sensors failed
+    CHECK(!agg.add(makeRecord(T0 + 3700, 21.0f), closed));
+
+    // Clock stepped back into a bucket that has gone out
+    CHECK(!agg.add(makeRecord(T0 + 100, 99.0f), closed));
+
+    REQUIRE(agg.finish(closed));
+    CHECK_EQ(closed.index, 1);
+    CHECK_EQ(closed.maxValue[0], 2100);
+    CHECK_EQ(agg.getRecordsUsed(), 1);
+}
+
+TEST(encodedLayoutFollowsTheMasks) {
+    SeriesAggregator agg;
+    agg.begin({ T0, T0 + 3600, 600, SERIES_FIELD_TEMPERATURE | SERIES_FIELD_SOUND_LEVEL, ALL_AGGS });
+    SeriesBucket closed;
+    agg.add(makeRecord(T0 + 1200, -1.0f), closed);
+    agg.add(makeRecord(T0 + 1300, -2.0f), closed);
+    StoredRecord loud = makeRecord(T0 + 1400, -2.5f);
+    loud.soundLevel = 90;
+    agg.add(loud, closed);
+    REQUIRE(agg.finish(closed));
+
+    uint8_t out[64];
+    uint8_t len = agg.encode(closed, out);
+    CHECK_EQ(len, seriesBucketSize(agg.getQuery()));
+
+    // [index][count] then temperature min/max/mean, sound min/max/mean
+    CHECK_EQ(getU16LE(&out[0]), 2);
+    CHECK_EQ(getU16LE(&out[2]), 3);
+    CHECK_EQ(getI16LE(&out[4]), -250);
+    CHECK_EQ(getI16LE(&out[6]), -100);
+    CHECK_EQ(getI16LE(&out[8]), -183);       // -550 / 3, rounded away from zero
+    CHECK_EQ(getI16LE(&out[10]), 40);
+    CHECK_EQ(getI16LE(&out[12]), 90);
+    CHECK_EQ(getI16LE(&out[14]), 57);
+
+    // Mean only: [index][mean] per field
+    agg.begin({ T0, T0 + 3600, 600, SERIES_FIELD_TEMPERATURE, SERIES_AGG_MEAN });
+    CHECK_EQ(agg.encode(closed, out), 4);
+    CHECK_EQ(getI16LE(&out[2]), -183);
+}
+
+TEST(valuesClampToSixteenBits) {
+    SeriesAggregator agg;
+    agg.begin({ T0, T0 + 3600, 3600, SERIES_FIELD_TEMPERATURE, SERIES_AGG_MIN | SERIES_AGG_MAX });
+    SeriesBucket closed;
+    agg.add(makeRecord(T0, 400.0f), closed);
+    agg.add(makeRecord(T0 + 1, -400.0f), closed);
+    REQUIRE(agg.finish(closed));
+
+    uint8_t out[16];
+    agg.encode(closed, out);
+    CHECK_EQ(getI16LE(&out[2]), -32768);
+    CHECK_EQ(getI16LE(&out[4]), 32767);
+}
+
+// =============================================================================
+// OVER THE LINK
+// =============================================================================
+
+struct SeriesRun {
+    uint32_t buckets;            // From the start reply
+    uint8_t bucketSize;
+    std::vector<std::vector<uint8_t>> received;
+    uint32_t endBuckets;
+    uint32_t endRecords;
+    uint32_t endBytes;
+    uint32_t dataBytes;
+};
+
+static std::vector<uint8_t> seriesArgs(const SeriesQuery& q) {
+    std::vector<uint8_t> args(14);
+    putU32LE(&args[0], q.fromTime);
+    putU32LE(&args[4], q.toTime);
+    putU32LE(&args[8], q.bucketSeconds);
+    args[12] = q.fieldMask;
+    args[13] = q.aggMask;
+    return args;
+}
+
+static uint8_t runSeries(BleSimClient& client, const SeriesQuery& q, SeriesRun& out) {
+    out = SeriesRun();
+    size_t next = client.packets.size();
+    const SimResponse* reply = client.request(BT_CMD_QUERY_SERIES, seriesArgs(q));
+    if (!reply) return 0xFF;
+    if (reply->code != BT_RESP_OK) return reply->code;
+    CHECK_EQ(reply->payload.size(), 11);
+    out.buckets = getU32LE(&reply->payload[0]);
+    out.bucketSize = reply->payload[4];
+
+    bool ended = client.runUntil([&] {
+        for (; next < client.packets.size(); next++) {
+            const std::vector<uint8_t>& p = client.packets[next].data;
+            if (p[0] == BT_RESP_SERIES_END) {
+                out.endBuckets = getU16LE(&p[2]);
+                out.endRecords = getU32LE(&p[4]);
+                out.endBytes = getU32LE(&p[12]);
+                return true;
+            }
+            if (p[0] != BT_RESP_SERIES_DATA) continue;
+            CHECK_EQ(p.size(), BT_SERIES_HEADER_SIZE + p[2] * out.bucketSize);
+            out.dataBytes += p.size();
+            for (uint8_t i = 0; i < p[2]; i++) {
+                const uint8_t* b = &p[BT_SERIES_HEADER_SIZE + i * out.bucketSize];
+                out.received.push_back(std::vector<uint8_t>(b, b + out.bucketSize));
+            }
+        }
+        return false;
+    });
+    return ended ? BT_RESP_OK : 0xFF;
+}
+
+// The same query run straight over the journal on the card
+static std::vector<std::vector<uint8_t>> aggregateJournal(const SeriesQuery& q) {
+    std::vector<std::vector<uint8_t>> buckets;
+    SeriesAggregator agg;
+    agg.begin(q);
+    SeriesBucket closed;
+    uint8_t encoded[64];
+
+    File file = SD.open(RECORD_STORE_FILE, FILE_READ);
+    file.seek(RECORD_HEADER_SIZE);
+    uint8_t slot[RECORD_SIZE];
+    while (file.read(slot, RECORD_SIZE) == RECORD_SIZE) {
+        StoredRecord r;
+        if (!RecordStore::decode(slot, r)) continue;
+        if (agg.add(r, closed)) {
+            uint8_t len = agg.encode(closed, encoded);
+            buckets.push_back(std::vector<uint8_t>(encoded, encoded + len));
+        }
+    }
+    file.close();
+    if (agg.finish(closed)) {
+        uint8_t len = agg.encode(closed, encoded);
+        buckets.push_back(std::vector<uint8_t>(encoded, encoded + len));
+    }
+    return buckets;
+}
+
+TEST(queryOverTheLinkMatchesTheJournal) {
+    hostBootDevice();
+    uint32_t start = rtc.now().unixtime();
+    hostAppendRecords(2 * 144);          // Two days at 10 min
+
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+
+    // Starts an hour early so the first bucket has no records
+    SeriesQuery q = { start - 3600, start + 2 * 86400, 3600, ALL_FIELDS, ALL_AGGS };
+    SeriesRun run;
+    REQUIRE(runSeries(client, q, run) == BT_RESP_OK);
+
+    std::vector<std::vector<uint8_t>> expected = aggregateJournal(q);
+    CHECK_EQ(run.buckets, 49);
+    CHECK_EQ(expected.size(), 48);
+    CHECK(run.received == expected);
+    CHECK_EQ(getU16LE(&run.received[0][0]), 1);
+    CHECK_EQ(run.endBuckets, 48);
+    CHECK_EQ(run.endRecords, 288);
+    CHECK_EQ(run.endBytes, run.dataBytes + BT_SERIES_END_SIZE);
+
+    // Hourly summaries in a fraction of the raw records' size
+    CHECK(run.endBytes * 2 < 288 * RECORD_SIZE);
+}
+
+TEST(narrowQueryScansOnlyItsRange) {
+    hostBootDevice();
+    uint32_t start = rtc.now().unixtime();
+    hostAppendRecords(1000);
+
+    BleSimClient client;
+    client.begin({ 247, 6, 8, 4, 0, 1 });
+
+    SeriesQuery q = { start + 3 * 86400, start + 4 * 86400, 86400,
+                      SERIES_FIELD_TEMPERATURE, SERIES_AGG_MEAN | SERIES_AGG_COUNT };
+    SeriesRun run;
+    REQUIRE(runSeries(client, q, run) == BT_RESP_OK);
+    REQUIRE(run.received.size() == 1);
+    CHECK(run.received == aggregateJournal(q));
+    CHECK_EQ(getU16LE(&run.received[0][2]), 144);
+    CHECK_EQ(run.endRecords, 144);
+
+    // Past the last record: no buckets, just the end packet
+    SeriesQuery later = { start + 30 * 86400, start + 31 * 86400, 3600, ALL_FIELDS, ALL_AGGS };
+    REQUIRE(runSeries(client, later, run) == BT_RESP_OK);
+    CHECK(run.received.empty());
+    CHECK_EQ(run.endBuckets, 0);
+}
+
+TEST(bucketLargerThanThePacketRefused) {
+    hostBootDevice();
+    uint32_t start = rtc.now().unixtime();
+    hostAppendRecords(10);
+
+    BleSimClient client;
+    client.begin({ 23, 24, 4, 4, 0, 1 });
+
+    SeriesRun run;
+    SeriesQuery wide = { start, start + 86400, 3600, ALL_FIELDS, ALL_AGGS };
+    CHECK_EQ(runSeries(client, wide, run), BT_RESP_TOO_LARGE);
+
+    // A narrow bucket fits the default MTU
+    SeriesQuery narrow = { start, start + 86400, 3600, SERIES_FIELD_TEMPERATURE, SERIES_AGG_MEAN };
+    CHECK_EQ(runSeries(client, narrow, run), BT_RESP_OK);
+    CHECK_EQ(run.endRecords, 10);
+
+    SeriesQuery invalid = { start, start, 3600, SERIES_FIELD_TEMPERATURE, SERIES_AGG_MEAN };
+    CHECK_EQ(runSeries(client, invalid, run), BT_RESP_ERROR);
+}
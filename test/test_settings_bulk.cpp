@@ -0,0 +1,323 @@
+/**
+ * test_settings_bulk.cpp
+ * Settings image encode/decode, per-value validation, the atomic bulk
+ * transaction over a simulated link and persistence in internal flash
+ */
+
+#include "HostTest.h"
+#include "HostFixture.h"
+#include "BleSimClient.h"
+#include "BleDecoder.h"
+#include "Bluetooth.h"
+#include "Settings.h"
+#include "Utils.h"
+#include <InternalFileSystem.h>
+
+extern SystemSettings settings;
+
+static std::vector<uint8_t> pairArgs(const std::vector<std::pair<uint8_t, float>>& pairs) {
+    std::vector<uint8_t> args = { BT_SETTINGS_PAIRS, (uint8_t)pairs.size() };
+    for (const auto& p : pairs) {
+        uint8_t pair[BT_SETTINGS_PAIR_SIZE];
+        uint32_t bits;
+        memcpy(&bits, &p.second, sizeof(bits));
+        pair[0] = p.first;
+        putU32LE(&pair[1], bits);
+        args.insert(args.end(), pair, pair + sizeof(pair));
+    }
+    return args;
+}
+
+static std::vector<uint8_t> imageArgs(const SystemSettings& s) {
+    uint8_t image[SETTINGS_IMAGE_SIZE];
+    uint8_t len = encodeSettingsImage(s, image);
+    std::vector<uint8_t> args = { BT_SETTINGS_IMAGE };
+    args.insert(args.end(), image, image + len);
+    return args;
+}
+
+static bool sameImage(const SystemSettings& a, const SystemSettings& b) {
+    return settingsImageCrc(a) == settingsImageCrc(b);
+}
+
+static void connect(BleSimClient& client) {
+    hostBootDevice();
+    client.begin({ 247, 12, 8, 4, 0, 1 });
+}
+
+// =============================================================================
+// IMAGE
+// =============================================================================
+
+TEST(imageHasFixedSize) {
+    uint8_t image[SETTINGS_IMAGE_SIZE];
+    SystemSettings s = getDefaultSettings();
+    CHECK_EQ(encodeSettingsImage(s, image), SETTINGS_IMAGE_SIZE);
+    CHECK_EQ(image[0], SETTINGS_IMAGE_VERSION);
+    // tempOffset is the first field, a raw little-endian float
+    uint32_t bits = getU32LE(&image[1]);
+    float tempOffset;
+    memcpy(&tempOffset, &bits, sizeof(tempOffset));
+    CHECK(tempOffset == s.tempOffset);
+}
+
+TEST(imageRoundTrip) {
+    SystemSettings s = getDefaultSettings();
+    s.tempOffset = -1.25f;
+    s.humidityOffset = 3.5f;
+    s.audioSensitivity = 7;
+    s.queenFreqMin = 320;
+    s.queenFreqMax = 510;
+    s.logInterval = 30;
+    s.fieldModeEnabled = true;
+    s.tempMin = 12.5f;
+    s.tempMax = 38.0f;
+    s.stressThreshold = 66;
+
+    uint8_t image[SETTINGS_IMAGE_SIZE];
+    encodeSettingsImage(s, image);
+    SystemSettings out = getDefaultSettings();
+    uint8_t badId = 99;
+    REQUIRE(decodeSettingsImage(image, sizeof(image), out, badId));
+    CHECK_EQ(badId, 0);
+    for (uint8_t id = 1; id <= SETTING_ID_COUNT; id++) {
+        CHECK(getSettingValue(out, id) == getSettingValue(s, id));
+    }
+    CHECK(sameImage(out, s));
+}
+
+TEST(imageHeaderChecked) {
+    uint8_t image[SETTINGS_IMAGE_SIZE];
+    SystemSettings out = getDefaultSettings();
+    uint8_t badId;
+    encodeSettingsImage(getDefaultSettings(), image);
+    CHECK(!decodeSettingsImage(image, SETTINGS_IMAGE_SIZE - 1, out, badId));
+    CHECK_EQ(badId, 0);
+    image[0] = SETTINGS_IMAGE_VERSION + 1;
+    CHECK(!decodeSettingsImage(image, SETTINGS_IMAGE_SIZE, out, badId));
+    CHECK_EQ(badId, 0);
+}
+
+TEST(imageReportsFirstBadField) {
+    uint8_t image[SETTINGS_IMAGE_SIZE];
+    encodeSettingsImage(getDefaultSettings(), image);
+    image[9] = 11;                           // Audio sensitivity, after two f32 fields
+    SystemSettings out = getDefaultSettings();
+    uint8_t badId;
+    CHECK(!decodeSettingsImage(image, sizeof(image), out, badId));
+    CHECK_EQ(badId, 3);
+}
+
+// =============================================================================
+// VALUES
+// =============================================================================
+
+TEST(singleSettingClampsButBulkRejects) {
+    SystemSettings s = getDefaultSettings();
+    CHECK(!isSettingValueValid(1, 50.0f));
+    REQUIRE(applySettingValue(s, 1, 50.0f));
+    CHECK(s.tempOffset == 10.0f);
+    CHECK(!isSettingValueValid(4, 40000.0f));
+    REQUIRE(applySettingValue(s, 4, 40000.0f));
+    CHECK_EQ(s.queenFreqMin, 1000);
+}
+
+TEST(integerSettingsNeedWholeNumbers) {
+    CHECK(isSettingValueValid(3, 4.0f));
+    CHECK(!isSettingValueValid(3, 4.5f));
+    CHECK(isSettingValueValid(1, 4.5f));
+    CHECK(!isSettingValueValid(10, 0.5f));
+}
+
+TEST(logIntervalTakesListedValuesOnly) {
+    SystemSettings s = getDefaultSettings();
+    for (uint8_t v : { 5, 10, 30, 60 }) {
+        CHECK(isSettingValueValid(8, v));
+        CHECK(applySettingValue(s, 8, v));
+        CHECK_EQ(s.logInterval, v);
+    }
+    CHECK(!isSettingValueValid(8, 15.0f));
+    CHECK(!applySettingValue(s, 8, 15.0f));
+    CHECK_EQ(s.logInterval, 60);
+}
+
+TEST(unknownIdsAndNanRejected) {
+    SystemSettings s = getDefaultSettings();
+    CHECK(!isSettingValueValid(0, 1.0f));
+    CHECK(!isSettingValueValid(SETTING_ID_COUNT + 1, 1.0f));
+    CHECK(!applySettingValue(s, SETTING_ID_COUNT + 1, 1.0f));
+    CHECK(!isSettingValueValid(1, NAN));
+    CHECK(!applySettingValue(s, 1, NAN));
+    CHECK(sameImage(s, getDefaultSettings()));
+}
+
+// =============================================================================
+// BULK TRANSACTION
+// =============================================================================
+
+TEST(pairsAppliedAndAcknowledgedWithImage) {
+    BleSimClient client;
+    connect(client);
+    const SimResponse* r = client.request(BT_CMD_SET_SETTINGS_BULK,
+        pairArgs({ { 1, 1.5f }, { 8, 10.0f }, { 11, 15.0f }, { 12, 36.0f }, { 15, 80.0f } }));
+    REQUIRE(r != nullptr);
+    REQUIRE(r->code == BT_RESP_OK);
+    CHECK(settings.tempOffset == 1.5f);
+    CHECK_EQ(settings.logInterval, 10);
+    CHECK(settings.tempMin == 15.0f);
+    CHECK(settings.tempMax == 36.0f);
+    CHECK_EQ(settings.stressThreshold, 80);
+
+    BleFields fields;
+    REQUIRE(decodeTlv(r->payload, "ST", fields));
+    CHECK_EQ(findField(fields, BT_ST_imageVersion)->scalar, SETTINGS_IMAGE_VERSION);
+    CHECK_EQ(findField(fields, BT_ST_imageCrc)->scalar, settingsImageCrc(settings));
+    CHECK_EQ(findField(fields, BT_ST_logInterval)->scalar, 10);
+    CHECK_EQ(findField(fields, BT_ST_stressThreshold)->scalar, 80);
+}
+
+TEST(oneBadPairRejectsTheBatch) {
+    BleSimClient client;
+    connect(client);
+    SystemSettings before = settings;
+    const SimResponse* r = client.request(BT_CMD_SET_SETTINGS_BULK,
+        pairArgs({ { 1, 2.0f }, { 3, 12.0f }, { 15, 50.0f } }));
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_ERROR);
+    REQUIRE(r->payload.size() == 1);
+    CHECK_EQ(r->payload[0], 3);
+    CHECK(sameImage(settings, before));
+}
+
+TEST(inconsistentBatchRejected) {
+    BleSimClient client;
+    connect(client);
+    SystemSettings before = settings;
+    // Each value is in range, but min ends up above max
+    const SimResponse* r = client.request(BT_CMD_SET_SETTINGS_BULK,
+        pairArgs({ { 11, 35.0f }, { 12, 20.0f } }));
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_ERROR);
+    CHECK_EQ(r->payload[0], 0);
+    CHECK(sameImage(settings, before));
+
+    // The same two values in a consistent order pass
+    r = client.request(BT_CMD_SET_SETTINGS_BULK, pairArgs({ { 11, 20.0f }, { 12, 35.0f } }));
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_OK);
+}
+
+TEST(pairCountLimitedToOneWrite) {
+    BleSimClient client;
+    connect(client);
+    std::vector<std::pair<uint8_t, float>> pairs;
+    for (uint8_t id = 1; id <= BT_SETTINGS_MAX_PAIRS; id++) pairs.push_back({ id, getSettingValue(settings, id) });
+    CHECK(4 + pairArgs(pairs).size() <= BT_COMMAND_MAX_LEN);
+    const SimResponse* r = client.request(BT_CMD_SET_SETTINGS_BULK, pairArgs(pairs));
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_OK);
+
+    // Count above the limit, or more pairs claimed than sent
+    std::vector<uint8_t> args = pairArgs(pairs);
+    args[1] = BT_SETTINGS_MAX_PAIRS + 1;
+    r = client.request(BT_CMD_SET_SETTINGS_BULK, args);
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_ERROR);
+    args = pairArgs({ { 1, 1.0f } });
+    args[1] = 2;
+    r = client.request(BT_CMD_SET_SETTINGS_BULK, args);
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_ERROR);
+}
+
+TEST(fullImageAppliedAtOnce) {
+    BleSimClient client;
+    connect(client);
+    SystemSettings wanted = getDefaultSettings();
+    wanted.humidityOffset = -4.0f;
+    wanted.swarmFreqMin = 400;
+    wanted.swarmFreqMax = 600;
+    wanted.displayTimeoutMin = 20;
+    wanted.humidityMin = 30.0f;
+    wanted.humidityMax = 85.0f;
+
+    const SimResponse* r = client.request(BT_CMD_SET_SETTINGS_BULK, imageArgs(wanted));
+    REQUIRE(r != nullptr);
+    REQUIRE(r->code == BT_RESP_OK);
+    CHECK(sameImage(settings, wanted));
+    BleFields fields;
+    REQUIRE(decodeTlv(r->payload, "ST", fields));
+    CHECK_EQ(findField(fields, BT_ST_imageCrc)->scalar, settingsImageCrc(wanted));
+}
+
+TEST(singleSettingNeedsFullValue) {
+    BleSimClient client;
+    connect(client);
+    const SimResponse* r = client.request(BT_CMD_SET_SETTING, { 1, 0, 0 });
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_ERROR);
+
+    float value = 2.75f;
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    std::vector<uint8_t> args(5);
+    args[0] = 1;
+    putU32LE(&args[1], bits);
+    r = client.request(BT_CMD_SET_SETTING, args);
+    REQUIRE(r != nullptr);
+    CHECK_EQ(r->code, BT_RESP_OK);
+    CHECK(settings.tempOffset == 2.75f);
+}
+
+// =============================================================================
+// PERSISTENCE
+// =============================================================================
+
+TEST(appliedSettingsSurviveReboot) {
+    BleSimClient client;
+    connect(client);
+    SystemSettings wanted = getDefaultSettings();
+    wanted.queenFreqMin = 300;
+    wanted.queenFreqMax = 450;
+    wanted.logInterval = 60;
+    REQUIRE(client.request(BT_CMD_SET_SETTINGS_BULK, imageArgs(wanted))->code == BT_RESP_OK);
+
+    SystemSettings loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    loadSettings(loaded);
+    CHECK(sameImage(loaded, wanted));
+}
+
+TEST(resavingReplacesTheStoredRecord) {
+    // Write mode appends, so each save must replace the file rather than
+    // leave the first record in front for the next load to read
+    SystemSettings s = getDefaultSettings();
+    saveSettings(s);
+    for (uint8_t interval : { 5, 10, 30 }) {
+        s.logInterval = interval;
+        saveSettings(s);
+    }
+    CHECK_EQ(hostFlashFileSize("/settings.dat"), sizeof(SystemSettings));
+
+    SystemSettings loaded;
+    memset(&loaded, 0, sizeof(loaded));
+    loadSettings(loaded);
+    CHECK_EQ(loaded.logInterval, 30);
+}
+
+TEST(missingOrCorruptFileFallsBackToDefaults) {
+    SystemSettings loaded;
+    loadSettings(loaded);
+    CHECK(sameImage(loaded, getDefaultSettings()));
+    CHECK_EQ(hostFlashFileSize("/settings.dat"), sizeof(SystemSettings));
+
+    // Flip a byte; the checksum catches it
+    Adafruit_LittleFS_Namespace::File file(InternalFS);
+    REQUIRE(file.open("/settings.dat", Adafruit_LittleFS_Namespace::FILE_O_WRITE));
+    file.seek(0);
+    file.write((uint8_t)0xA5);
+    file.close();
+    loaded.logInterval = 60;
+    loadSettings(loaded);
+    CHECK(sameImage(loaded, getDefaultSettings()));
+}
@@ -0,0 +1,228 @@
+/**
+ * test_wake_schedule.cpp
+ * Wake times in each mode and how the PCF8523 is programmed for them:
+ * a simulated RTC fires each plan, and a wake that comes in before its
+ * target is finished with the countdown as the boot does after System
+ * OFF. Dates cover month, year and leap day rollover
+ */
+
+#include "HostTest.h"
+#include "WakeSchedule.h"
+#include <RTClib.h>
+#include <InternalFileSystem.h>
+
+static uint32_t at(uint16_t y, uint8_t mo, uint8_t d, uint8_t h, uint8_t mi, uint8_t s) {
+    return DateTime(y, mo, d, h, mi, s).unixtime();
+}
+
+// When the PCF8523 raises its interrupt for a plan programmed at now:
+// timer A after countdownS seconds, the alarm at second 0 of the first
+// minute matching minute, hour and day of month
+static uint32_t rtcFires(uint32_t now, const RtcWakePlan& plan) {
+    if (plan.countdown) return now + plan.countdownS;
+    for (uint32_t t = now - now % 60 + 60; t < now + 32 * 86400UL; t += 60) {
+        DateTime d(t);
+        if (d.minute() == plan.minute && d.hour() == plan.hour && d.day() == plan.day) return t;
+    }
+    return 0;
+}
+
+// System OFF: each wake is a boot, which goes back down for what is left
+static uint32_t systemOffWake(uint32_t now, uint32_t target, uint8_t* boots = nullptr) {
+    uint32_t t = rtcFires(now, WakeSchedule::planRtcWake(now, target));
+    uint8_t n = 1;
+    while (t && WakeSchedule::secondStageS(t, target)) {
+        t = rtcFires(t, WakeSchedule::planRtcWake(t, target));
+        n++;
+    }
+    if (boots) *boots = n;
+    return t;
+}
+
+// =============================================================================
+// RTC PLANS
+// =============================================================================
+
+TEST(closeTargetsUseTheCountdown) {
+    uint32_t now = at(2025, 6, 10, 12, 0, 17);
+    RtcWakePlan plan = WakeSchedule::planRtcWake(now, now + WAKE_COUNTDOWN_MAX_S);
+    CHECK(plan.countdown);
+    CHECK_EQ(plan.countdownS, WAKE_COUNTDOWN_MAX_S);
+    CHECK_EQ(rtcFires(now, plan), now + WAKE_COUNTDOWN_MAX_S);
+
+    // A target already gone still wakes, a second later
+    plan = WakeSchedule::planRtcWake(now, now - 5);
+    CHECK(plan.countdown);
+    CHECK_EQ(plan.countdownS, 1);
+}
+
+TEST(alarmMatchesTheMinuteOfTheTarget) {
+    uint32_t now = at(2025, 6, 10, 12, 0, 17);
+    RtcWakePlan plan = WakeSchedule::planRtcWake(now, at(2025, 6, 10, 13, 20, 45));
+    CHECK(!plan.countdown);
+    CHECK_EQ(plan.day, 10);
+    CHECK_EQ(plan.hour, 13);
+    CHECK_EQ(plan.minute, 20);
+    CHECK_EQ(rtcFires(now, plan), at(2025, 6, 10, 13, 20, 0));
+}
+
+TEST(secondStageOnlyBeforeTheTarget) {
+    uint32_t target = at(2025, 6, 10, 13, 20, 45);
+    CHECK_EQ(WakeSchedule::secondStageS(target - 45, target), 45);
+    CHECK_EQ(WakeSchedule::secondStageS(target - 1, target), 1);
+    CHECK_EQ(WakeSchedule::secondStageS(target, target), 0);
+    CHECK_EQ(WakeSchedule::secondStageS(target + 30, target), 0);
+
+    // Further off than a countdown reaches: the clock was set, take it
+    CHECK_EQ(WakeSchedule::secondStageS(target - WAKE_COUNTDOWN_MAX_S - 1, target), 0);
+    CHECK_EQ(WakeSchedule::secondStageS(target, 0), 0);
+}
+
+TEST(systemOffWakesExactlyOffTheMinute) {
+    // Targets from just past the countdown range to a day, any second
+    uint32_t now = at(2025, 6, 10, 12, 0, 17);
+    for (uint32_t delta = WAKE_COUNTDOWN_MAX_S + 1; delta < 86400; delta += 613) {
+        uint8_t boots = 0;
+        uint32_t target = now + delta;
+        CHECK_EQ(systemOffWake(now, target, &boots), target);
+        CHECK_EQ(boots, target % 60 ? 2 : 1);
+    }
+}
+
+TEST(alarmRollsOverTheMonthEnd) {
+    uint32_t now = at(2025, 4, 30, 23, 58, 40);
+    uint32_t target = at(2025, 5, 1, 0, 10, 17);
+    RtcWakePlan plan = WakeSchedule::planRtcWake(now, target);
+    CHECK_EQ(plan.day, 1);
+    CHECK_EQ(plan.hour, 0);
+    CHECK_EQ(plan.minute, 10);
+    CHECK_EQ(systemOffWake(now, target), target);
+
+    // 31-day month into a 30-day one
+    now = at(2025, 8, 31, 23, 50, 0);
+    target = at(2025, 9, 1, 0, 0, 30);
+    CHECK_EQ(systemOffWake(now, target), target);
+}
+
+TEST(alarmRollsOverTheYear) {
+    uint32_t now = at(2025, 12, 31, 23, 57, 12);
+    uint32_t target = at(2026, 1, 1, 0, 5, 30);
+    RtcWakePlan plan = WakeSchedule::planRtcWake(now, target);
+    CHECK(!plan.countdown);
+    CHECK_EQ(plan.day, 1);
+    CHECK_EQ(plan.hour, 0);
+    CHECK_EQ(plan.minute, 5);
+    CHECK_EQ(rtcFires(now, plan), at(2026, 1, 1, 0, 5, 0));
+    CHECK_EQ(systemOffWake(now, target), target);
+
+    // A daily interval planned the evening before
+    now = at(2025, 12, 31, 18, 0, 0);
+    target = at(2026, 1, 1, 6, 0, 0);
+    CHECK_EQ(systemOffWake(now, target), target);
+}
+
+TEST(alarmOnAndOverTheLeapDay) {
+    // 2028 is a leap year: Feb 28 -> Feb 29 -> Mar 1
+    uint32_t now = at(2028, 2, 28, 23, 55, 0);
+    uint32_t target = at(2028, 2, 29, 0, 3, 45);
+    RtcWakePlan plan = WakeSchedule::planRtcWake(now, target);
+    CHECK_EQ(plan.day, 29);
+    CHECK_EQ(systemOffWake(now, target), target);
+
+    now = at(2028, 2, 29, 23, 58, 0);
+    target = at(2028, 3, 1, 0, 7, 10);
+    plan = WakeSchedule::planRtcWake(now, target);
+    CHECK_EQ(plan.day, 1);
+    CHECK_EQ(systemOffWake(now, target), target);
+
+    // 2027 is not: Feb 28 goes straight to Mar 1
+    now = at(2027, 2, 28, 23, 58, 0);
+    target = at(2027, 3, 1, 0, 7, 10);
+    plan = WakeSchedule::planRtcWake(now, target);
+    CHECK_EQ(plan.day, 1);
+    CHECK_EQ(systemOffWake(now, target), target);
+}
+
+// =============================================================================
+// WAKE TIMES
+// =============================================================================
+
+TEST(alignedWakesLandOnClockBoundaries) {
+    WakeSchedule schedule;
+    uint32_t now = at(2025, 12, 31, 23, 52, 30);
+    uint32_t times[WAKE_PREVIEW_COUNT];
+    schedule.upcoming(now, 600, times, WAKE_PREVIEW_COUNT);
+    CHECK_EQ(times[0], at(2026, 1, 1, 0, 0, 0));
+    CHECK_EQ(times[1], at(2026, 1, 1, 0, 10, 0));
+    CHECK_EQ(times[3], at(2026, 1, 1, 0, 30, 0));
+
+    // A wake closer than the lead moves to the next slot
+    CHECK_EQ(schedule.nextWake(at(2026, 1, 1, 0, 9, 59), 600), at(2026, 1, 1, 0, 20, 0));
+}
+
+TEST(relativeWakesFollowTheLastOne) {
+    WakeSchedule schedule;
+    schedule.overrideInterval(0);
+    schedule.configure(90, WAKE_MODE_RELATIVE, 0);
+    uint32_t now = at(2028, 2, 28, 23, 59, 7);
+    CHECK_EQ(schedule.nextWake(now, 600), now + 90);
+    CHECK_EQ(DateTime(schedule.nextWake(now, 600)).day(), 29);
+}
+
+TEST(jitterIsRepeatableAndKeepsTheOrder) {
+    WakeSchedule schedule;
+    schedule.configure(600, WAKE_MODE_JITTERED, 120);
+    uint32_t now = at(2025, 12, 31, 23, 0, 0);
+    uint32_t times[WAKE_PREVIEW_COUNT];
+    uint32_t again[WAKE_PREVIEW_COUNT];
+    schedule.upcoming(now, 600, times, WAKE_PREVIEW_COUNT);
+    schedule.upcoming(now, 600, again, WAKE_PREVIEW_COUNT);
+
+    for (uint8_t i = 0; i < WAKE_PREVIEW_COUNT; i++) {
+        CHECK_EQ(times[i], again[i]);
+        CHECK(times[i] % 600 <= 120);
+        if (i) CHECK(times[i] > times[i - 1]);
+    }
+
+    // Jitter is capped at half the interval
+    schedule.configure(60, WAKE_MODE_JITTERED, 3600);
+    schedule.upcoming(now, 600, times, WAKE_PREVIEW_COUNT);
+    for (uint8_t i = 0; i < WAKE_PREVIEW_COUNT; i++) CHECK(times[i] % 60 <= 30);
+}
+
+TEST(configurationSurvivesRestart) {
+    WakeSchedule schedule;
+    schedule.configure(300, WAKE_MODE_JITTERED, 45);
+    CHECK_EQ(hostFlashFileSize(WAKE_FILE), sizeof(WakeConfig));
+
+    WakeSchedule restarted;
+    restarted.begin();
+    CHECK(restarted.isOverridden());
+    CHECK_EQ(restarted.getIntervalS(600), 300);
+    CHECK_EQ(restarted.getMode(), WAKE_MODE_JITTERED);
+    CHECK_EQ(restarted.getJitter(), 45);
+
+    // Projections on a copy are not saved
+    restarted.overrideInterval(60);
+    WakeSchedule again;
+    again.begin();
+    CHECK_EQ(again.getIntervalS(600), 300);
+}
+
+TEST(damagedConfigurationIsIgnored) {
+    WakeSchedule schedule;
+    schedule.configure(300, WAKE_MODE_RELATIVE, 0);
+
+    Adafruit_LittleFS_Namespace::File file(InternalFS);
+    REQUIRE(file.open(WAKE_FILE, Adafruit_LittleFS_Namespace::FILE_O_WRITE));
+    REQUIRE(file.seek(offsetof(WakeConfig, intervalS)));
+    uint8_t flipped = (uint8_t)~file.read();
+    file.seek(offsetof(WakeConfig, intervalS));
+    file.write(&flipped, 1);
+    file.close();
+
+    WakeSchedule restarted;
+    restarted.begin();
+    CHECK(!restarted.isOverridden());
+    CHECK_EQ(restarted.getMode(), WAKE_MODE_ALIGNED);
+}